@@ -246,6 +246,10 @@ void DoWriteOutput(const ConfigParameters& config)
 
     SimpleOutputWriter<ElemType> writer(net, 1);
 
+    wstring outputFormat = config(L"outputFormat", L"text");
+    if (outputFormat != L"text" && outputFormat != L"binary")
+        InvalidArgument("write command: Invalid outputFormat '%ls', expected 'text' or 'binary'.", outputFormat.c_str());
+
     if (config.Exists("writer"))
     {
         ConfigParameters writerConfig(config(L"writer"));
@@ -253,6 +257,14 @@ void DoWriteOutput(const ConfigParameters& config)
         DataWriter testDataWriter(writerConfig);
         writer.WriteOutput(testDataReader, mbSize[0], testDataWriter, outputNodeNamesVector, epochSize, writerUnittest);
     }
+    else if (config.Exists("outputPath") && outputFormat == L"binary")
+    {
+        wstring outputPath = config(L"outputPath");
+        wstring outputPrecision = config(L"outputPrecision", L"float");
+        auto elementType = BinaryOutputFile::ParseElementType(outputPrecision);
+        size_t chunkSizeInBytes = config(L"outputChunkSizeInBytes", (size_t)32 * 1024 * 1024);
+        writer.WriteOutputBinary(testDataReader, mbSize[0], outputPath, outputNodeNamesVector, elementType, chunkSizeInBytes, epochSize, MPIWrapper::GetInstance());
+    }
     else if (config.Exists("outputPath"))
     {
         wstring outputPath = config(L"outputPath");
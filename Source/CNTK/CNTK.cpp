@@ -23,6 +23,7 @@
 #include "NDLNetworkBuilder.h"
 #include "ModelEditLanguage.h"
 #include "CPUMatrix.h" // used for SetNumThreads()
+#include "CPUNumaBinding.h"
 #include "CommonMatrix.h"
 #include "SGD.h"
 #include "MPIWrapper.h"
@@ -81,7 +82,8 @@ void SetupProfiling(ProfilerContext& profilerContext, const ConfigParamType& con
         profilerContext.Init(workDir + L"/profiler",
                              config(L"profilerBufferSize", static_cast<uint64_t>(32 * 1024 * 1024)),
                              std::to_wstring(nodeRank),
-                             config(L"profilerSyncGpu", true));
+                             config(L"profilerSyncGpu", true),
+                             config(L"profilerNodes", false));
     }
 }
 
@@ -175,6 +177,31 @@ static void DisableLegacyUsage(const ConfigParameters& TopLevelConfig, const Con
     }
 }
 
+// The built-in parameter server of DataParallelASGD (see ASGDHelper.cpp) calls MPI from a server thread next to the
+// training thread, which needs MPI to be initialized with MPI_THREAD_MULTIPLE. Only ask for that if a command trains that way.
+static bool UsesBuiltInParameterServer(const ConfigParameters& TopLevelConfig, const ConfigArray& commands)
+{
+#ifdef ASGD_PARALLEL_SUPPORT
+    // DataParallelASGD runs on the Multiverso parameter server
+    return false;
+#else
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        ConfigParameters commandParams(TopLevelConfig(commands[i]));
+        if (!commandParams.Exists(L"SGD"))
+            continue;
+        ConfigParameters sgd(commandParams(L"SGD"));
+        if (!sgd.Exists(L"ParallelTrain"))
+            continue;
+        ConfigParameters parallelTrain(sgd(L"ParallelTrain"));
+        wstring parallelizationMethod = parallelTrain(L"parallelizationMethod", L"none");
+        if (EqualCI(parallelizationMethod, L"DataParallelASGD"))
+            return true;
+    }
+    return false;
+#endif
+}
+
 // When running in parallel with MPI, only commands in 'commandstoRunOnAllRanks' should
 // be run in parallel across multiple ranks. Others should only run on rank 0
 const std::set<std::string> commandstoRunOnAllRanks = { "train", "trainRNN", "adapt", "test", "eval", "cv", "devtest", "bnstat" };
@@ -191,7 +218,12 @@ void DoCommands(const ConfigParameters& config, const shared_ptr<MPIWrapper>& mp
     {
         // Setting specified number of threads.
         int numCPUThreads = config(L"numCPUThreads", "0");
-        numCPUThreads = CPUMatrix<ElemType>::SetNumThreads(numCPUThreads);
+        wstring numaBindingMode = config(L"numaBinding", L"none");
+        auto numaBinding = ParseNumaBindingMode(numaBindingMode);
+        if (numaBinding != NumaBindingMode::None)
+            numCPUThreads = CPUNumaBinding::Bind(numaBinding, numCPUThreads);
+        else
+            numCPUThreads = CPUMatrix<ElemType>::SetNumThreads(numCPUThreads);
         if (numCPUThreads > 0)
         {
             LOGPRINTF(stderr, "Using %d CPU threads.\n", numCPUThreads);
@@ -507,11 +539,16 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
 
     if (paralleltrain)
     {
-        mpi = MPIWrapper::GetInstance(true /*create*/);
+        // The SGD blocks cannot be read here without executing the actions, so DataParallelASGD with the built-in
+        // parameter server must ask for MPI_THREAD_MULTIPLE explicitly.
+        mpi = MPIWrapper::GetInstance(true /*create*/, config(L"mpiThreadMultiple", false));
     }  
 
     Globals::SetShareNodeValueMatrices(config(L"shareNodeValueMatrices", true));
     Globals::SetGradientAccumulationOptimization(config(L"optimizeGradientAccumulation", true));
+    Globals::SetRecurrentLoopPipelining(config(L"pipelineRecurrentLoops", false));
+    wstring compiledNetworkCacheDir = config(L"compiledNetworkCacheDir", L"");
+    Globals::SetCompiledNetworkCacheDirectory(compiledNetworkCacheDir);
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
 
@@ -543,7 +580,12 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
     else
     {
         int numCPUThreads = config(L"numCPUThreads", 0);
-        numCPUThreads = CPUMatrix<float /*any will do*/>::SetNumThreads(numCPUThreads);
+        wstring numaBindingMode = config(L"numaBinding", L"none");
+        auto numaBinding = ParseNumaBindingMode(numaBindingMode);
+        if (numaBinding != NumaBindingMode::None)
+            numCPUThreads = CPUNumaBinding::Bind(numaBinding, numCPUThreads);
+        else
+            numCPUThreads = CPUMatrix<float /*any will do*/>::SetNumThreads(numCPUThreads);
         if (numCPUThreads > 0)
             LOGPRINTF(stderr, "Using %d CPU threads.\n", numCPUThreads);
     }
@@ -655,11 +697,14 @@ int wmainOldCNTKConfig(int argc, wchar_t* argv[])
 
     if (paralleltrain)
     {
-       mpi = MPIWrapper::GetInstance(true /*create*/);
+       mpi = MPIWrapper::GetInstance(true /*create*/, config(L"mpiThreadMultiple", UsesBuiltInParameterServer(config, command)));
     } 
 
     Globals::SetShareNodeValueMatrices(config(L"shareNodeValueMatrices", true));
     Globals::SetGradientAccumulationOptimization(config(L"optimizeGradientAccumulation", true));
+    Globals::SetRecurrentLoopPipelining(config(L"pipelineRecurrentLoops", false));
+    wstring compiledNetworkCacheDir = config(L"compiledNetworkCacheDir", L"");
+    Globals::SetCompiledNetworkCacheDirectory(compiledNetworkCacheDir);
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
 
@@ -594,6 +594,7 @@ namespace CNTK
         friend class BlockMomentumDistributedLearner;
         friend class Internal::VariableResolver;
         friend class Trainer;
+        friend class BeamSearchDecoder;
 
         template <typename T, typename ...CtorArgTypes>
         friend inline std::shared_ptr<T> MakeSharedObject(CtorArgTypes&& ...ctorArgs);
@@ -4999,6 +5000,101 @@ namespace CNTK
     ///
     CNTK_API EvaluatorPtr CreateEvaluator(const FunctionPtr& evaluationFunction, const std::vector<ProgressWriterPtr>& progressWriters = {});
 
+    ///
+    /// A hypothesis produced by the BeamSearchDecoder: the decoded tokens (without the start and end tokens)
+    /// and the sum of their log probabilities.
+    ///
+    struct BeamSearchHypothesis
+    {
+        std::vector<size_t> m_tokens;
+        double m_score;
+
+        // False if the hypothesis was cut off at the maximum length before the end token was produced.
+        bool m_isComplete;
+    };
+
+    ///
+    /// BeamSearchDecoder runs batched beam search over a step Function that computes one decoding step
+    /// of a recurrent model: given the previous token and the recurrent state it produces the log probabilities
+    /// of the next token and the new recurrent state.
+    /// All hypotheses of all utterances are evaluated in a single Forward call per step. The recurrent state
+    /// is kept on the compute device between steps and is reordered with a column gather when beams are
+    /// extended, so the prefix is never re-evaluated. Hypotheses that can no longer make it into the beam
+    /// of finished hypotheses are pruned early.
+    ///
+    class BeamSearchDecoder : public std::enable_shared_from_this<BeamSearchDecoder>
+    {
+    public:
+        ///
+        /// Decodes the specified number of utterances. Returns for each utterance at most BeamWidth() hypotheses
+        /// sorted by descending score.
+        /// 'initialStates' optionally map state inputs to per-utterance initial values (a batch of 'numberOfUtterances'
+        /// samples), missing states start from zero. 'contexts' map the remaining batch-axis inputs of the step Function
+        /// (e.g. the encoder output) to per-utterance values, which are replicated across the hypotheses of the utterance.
+        ///
+        CNTK_API std::vector<std::vector<BeamSearchHypothesis>> Decode(size_t numberOfUtterances,
+            const std::unordered_map<Variable, ValuePtr>& initialStates = {},
+            const std::unordered_map<Variable, ValuePtr>& contexts = {},
+            const DeviceDescriptor& computeDevice = DeviceDescriptor::UseDefaultDevice());
+
+        size_t BeamWidth() const { return m_beamWidth; }
+        size_t MaxLength() const { return m_maxLength; }
+
+        ///
+        /// Number of tokens (hypothesis extensions) evaluated and the number of decoding steps since construction.
+        ///
+        size_t TotalNumberOfEvaluatedTokens() const { return m_totalNumberOfEvaluatedTokens; }
+        size_t TotalNumberOfSteps() const { return m_totalNumberOfSteps; }
+
+        CNTK_API virtual ~BeamSearchDecoder() {}
+
+    private:
+        template <typename T, typename ...CtorArgTypes>
+        friend inline std::shared_ptr<T> MakeSharedObject(CtorArgTypes&& ...ctorArgs);
+
+        BeamSearchDecoder(const FunctionPtr& stepFunction, const Variable& tokenInput, const Variable& logProbabilities,
+            const std::vector<std::pair<Variable, Variable>>& stateInputsToOutputs,
+            size_t startToken, size_t endToken, size_t beamWidth, size_t maxLength);
+
+        template <typename ElementType>
+        std::vector<std::vector<BeamSearchHypothesis>> Decode(size_t numberOfUtterances,
+            const std::unordered_map<Variable, ValuePtr>& initialStates,
+            const std::unordered_map<Variable, ValuePtr>& contexts,
+            const DeviceDescriptor& computeDevice);
+
+        // Gathers the columns of a [sampleSize x numberOfColumns] view in the order given by 'columnIndices'.
+        template <typename ElementType>
+        static NDArrayViewPtr GatherColumns(const NDArrayViewPtr& source, const Microsoft::MSR::CNTK::Matrix<ElementType>& columnIndices);
+
+        FunctionPtr m_stepFunction;
+        Variable m_tokenInput;
+        Variable m_logProbabilities;
+        std::vector<std::pair<Variable, Variable>> m_stateInputsToOutputs;
+        size_t m_vocabularySize;
+        size_t m_startToken;
+        size_t m_endToken;
+        size_t m_beamWidth;
+        size_t m_maxLength;
+
+        size_t m_totalNumberOfEvaluatedTokens;
+        size_t m_totalNumberOfSteps;
+    };
+
+    ///
+    /// Construct a BeamSearchDecoder.
+    /// 'tokenInput' is the argument of 'stepFunction' that receives the one-hot encoded previous token, 'logProbabilities'
+    /// is the output with the log probabilities of the next token over the same vocabulary. Each pair of 'stateInputsToOutputs'
+    /// connects a state output of a step to the state input of the next step. All these variables must only have the batch axis.
+    ///
+    CNTK_API BeamSearchDecoderPtr CreateBeamSearchDecoder(const FunctionPtr& stepFunction,
+        const Variable& tokenInput,
+        const Variable& logProbabilities,
+        const std::vector<std::pair<Variable, Variable>>& stateInputsToOutputs,
+        size_t startToken,
+        size_t endToken,
+        size_t beamWidth,
+        size_t maxLength);
+
     ///
     /// Trainer is the top-level abstraction responsible for the orchestration of the training of a model
     /// using the specified learners and training data either explicitly supplied as Value objects or from
@@ -5358,6 +5454,14 @@ namespace CNTK
         ///
         Internal::Optional<bool> isMultithreaded;
 
+        ///
+        /// Switches the grouping of sequences of similar length into the same minibatch on and off. The grouping happens within the
+        /// randomization window and reduces the padding in minibatches of sequences with a wide length spread. It requires randomization.
+        /// 'lengthBucketSizeInSamples' is the size of a group of similar sequences, zero means the size of the first requested minibatch.
+        ///
+        bool isLengthBucketingEnabled{ false };
+        size_t lengthBucketSizeInSamples{ 0 };
+
         ///
         /// Deserializers to be used in the composite reader.
         ///
@@ -5616,6 +5720,12 @@ namespace CNTK
     ///
     CNTK_API DistributedCommunicatorPtr MPICommunicator(size_t packThresholdSizeInBytes = Internal::DefaultPackThresholdSizeInBytes());
 
+    ///
+    /// Built-in MPI-based communicator that aggregates through shared memory among the workers on the same host,
+    /// and through MPI only among one worker per host.
+    ///
+    CNTK_API DistributedCommunicatorPtr HierarchicalMPICommunicator(size_t packThresholdSizeInBytes = Internal::DefaultPackThresholdSizeInBytes());
+
     ///
     /// Distributed communicator that allows quantized aggregations.
     ///
@@ -212,6 +212,9 @@ namespace CNTK
     class Evaluator;
     typedef std::shared_ptr<Evaluator> EvaluatorPtr;
 
+    class BeamSearchDecoder;
+    typedef std::shared_ptr<BeamSearchDecoder> BeamSearchDecoderPtr;
+
     class Trainer;
     typedef std::shared_ptr<Trainer> TrainerPtr;
 
@@ -299,8 +302,16 @@ namespace CNTK
         CNTK_API void EnableGradientAccumulationOptimization();
         CNTK_API void DisableGradientAccumulationOptimization();
 
+        // Run chains of stacked recurrent loops on the CPU as a wavefront, one thread per loop. Affects networks compiled afterwards.
+        CNTK_API void EnableRecurrentLoopPipelining();
+        CNTK_API void DisableRecurrentLoopPipelining();
+
+        // Directory in which networks keep the results of their compilation (loop analysis, validated shapes, memory-sharing plan)
+        // to speed up the next start with the same model. An empty string disables this.
+        CNTK_API void SetCompiledNetworkCacheDirectory(const std::wstring& directory);
+
         static const uint64_t DefaultProfilerBufferSize = 32 * 1024 * 1024;
-        CNTK_API void StartProfiler(const std::wstring& profilerDir = L"profiler", bool profilerSyncGpu = false, size_t profilerBufferSize = DefaultProfilerBufferSize);
+        CNTK_API void StartProfiler(const std::wstring& profilerDir = L"profiler", bool profilerSyncGpu = false, size_t profilerBufferSize = DefaultProfilerBufferSize, bool profilerNodes = false);
         CNTK_API void EnableProfiler();
         CNTK_API void DisableProfiler();
         CNTK_API void StopProfiler();
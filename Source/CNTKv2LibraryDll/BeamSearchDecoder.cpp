@@ -0,0 +1,425 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "CNTKLibrary.h"
+#include "Utils.h"
+#include "Matrix.h"
+#include <algorithm>
+#include <numeric>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace CNTK
+{
+    namespace
+    {
+        bool HasOnlyBatchAxis(const Variable& variable)
+        {
+            return variable.DynamicAxes().size() == 1 && variable.DynamicAxes()[0] == Axis::DefaultBatchAxis();
+        }
+
+        // Returns the data of a per-utterance value as a [sampleSize x numberOfUtterances] view on the compute device.
+        NDArrayViewPtr AsPerUtteranceView(const Variable& variable, const ValuePtr& value, size_t numberOfUtterances, const DeviceDescriptor& device)
+        {
+            if (!value)
+                InvalidArgument("BeamSearchDecoder: The value of the input '%S' is null.", variable.AsString().c_str());
+
+            if (value->IsSparse())
+                InvalidArgument("BeamSearchDecoder: The value of the input '%S' must be dense.", variable.AsString().c_str());
+
+            if (value->GetDataType() != variable.GetDataType())
+                InvalidArgument("BeamSearchDecoder: The data type of the value of the input '%S' does not match the data type of the input.", variable.AsString().c_str());
+
+            auto sampleSize = variable.Shape().TotalSize();
+            auto data = value->Data();
+            if (data->Shape().TotalSize() != sampleSize * numberOfUtterances)
+                InvalidArgument("BeamSearchDecoder: The value of the input '%S' of shape '%S' must contain exactly one sample per utterance (%zu utterances).",
+                                variable.AsString().c_str(), data->Shape().AsString().c_str(), numberOfUtterances);
+
+            if (data->Device() != device)
+                data = data->DeepClone(device);
+
+            return data->AsShape(NDShape({ sampleSize, numberOfUtterances }));
+        }
+
+        template <typename ElementType>
+        Matrix<ElementType> CreateColumnIndices(const std::vector<size_t>& indices, const DeviceDescriptor& device)
+        {
+            std::vector<ElementType> buffer(indices.begin(), indices.end());
+            return Matrix<ElementType>(1, buffer.size(), buffer.data(), AsCNTKImplDeviceId(device));
+        }
+    }
+
+    template <typename ElementType>
+    /*static*/ NDArrayViewPtr BeamSearchDecoder::GatherColumns(const NDArrayViewPtr& source, const Matrix<ElementType>& columnIndices)
+    {
+        auto target = MakeSharedObject<NDArrayView>(source->GetDataType(), NDShape({ source->Shape()[0], columnIndices.GetNumCols() }), source->Device());
+        target->GetWritableMatrix<ElementType>(1)->DoGatherColumnsOf(0, columnIndices, *source->GetMatrix<ElementType>(1), 1);
+        return target;
+    }
+
+    BeamSearchDecoderPtr CreateBeamSearchDecoder(const FunctionPtr& stepFunction,
+        const Variable& tokenInput,
+        const Variable& logProbabilities,
+        const std::vector<std::pair<Variable, Variable>>& stateInputsToOutputs,
+        size_t startToken,
+        size_t endToken,
+        size_t beamWidth,
+        size_t maxLength)
+    {
+        return MakeSharedObject<BeamSearchDecoder>(stepFunction, tokenInput, logProbabilities, stateInputsToOutputs, startToken, endToken, beamWidth, maxLength);
+    }
+
+    BeamSearchDecoder::BeamSearchDecoder(const FunctionPtr& stepFunction, const Variable& tokenInput, const Variable& logProbabilities,
+        const std::vector<std::pair<Variable, Variable>>& stateInputsToOutputs,
+        size_t startToken, size_t endToken, size_t beamWidth, size_t maxLength)
+        : m_stepFunction(stepFunction),
+          m_tokenInput(tokenInput),
+          m_logProbabilities(logProbabilities),
+          m_stateInputsToOutputs(stateInputsToOutputs),
+          m_vocabularySize(0),
+          m_startToken(startToken),
+          m_endToken(endToken),
+          m_beamWidth(beamWidth),
+          m_maxLength(maxLength),
+          m_totalNumberOfEvaluatedTokens(0),
+          m_totalNumberOfSteps(0)
+    {
+        if (!m_stepFunction)
+            InvalidArgument("BeamSearchDecoder: The step function is not allowed to be null.");
+
+        if (m_beamWidth == 0 || m_maxLength == 0)
+            InvalidArgument("BeamSearchDecoder: The beam width and the maximum length must be positive.");
+
+        auto arguments = m_stepFunction->Arguments();
+        auto outputs = m_stepFunction->Outputs();
+        auto checkArgument = [&arguments](const Variable& variable)
+        {
+            if (std::find(arguments.begin(), arguments.end(), variable) == arguments.end())
+                InvalidArgument("BeamSearchDecoder: '%S' is not an argument of the step function.", variable.AsString().c_str());
+            if (!HasOnlyBatchAxis(variable))
+                InvalidArgument("BeamSearchDecoder: The input '%S' must only have the batch axis.", variable.AsString().c_str());
+        };
+        auto checkOutput = [&outputs](const Variable& variable)
+        {
+            if (std::find(outputs.begin(), outputs.end(), variable) == outputs.end())
+                InvalidArgument("BeamSearchDecoder: '%S' is not an output of the step function.", variable.AsString().c_str());
+            if (!HasOnlyBatchAxis(variable))
+                InvalidArgument("BeamSearchDecoder: The output '%S' must only have the batch axis.", variable.AsString().c_str());
+        };
+
+        checkArgument(m_tokenInput);
+        checkOutput(m_logProbabilities);
+
+        m_vocabularySize = m_logProbabilities.Shape().TotalSize();
+        if (m_tokenInput.Shape().TotalSize() != m_vocabularySize)
+            InvalidArgument("BeamSearchDecoder: The token input '%S' and the log probabilities '%S' must have the same vocabulary size.",
+                            m_tokenInput.AsString().c_str(), m_logProbabilities.AsString().c_str());
+
+        if (m_startToken >= m_vocabularySize || m_endToken >= m_vocabularySize)
+            InvalidArgument("BeamSearchDecoder: The start token (%zu) and the end token (%zu) must be smaller than the vocabulary size (%zu).",
+                            m_startToken, m_endToken, m_vocabularySize);
+
+        if (m_tokenInput.GetDataType() != m_logProbabilities.GetDataType())
+            InvalidArgument("BeamSearchDecoder: The token input and the log probabilities must have the same data type.");
+
+        for (const auto& state : m_stateInputsToOutputs)
+        {
+            checkArgument(state.first);
+            checkOutput(state.second);
+
+            if (state.first == m_tokenInput)
+                InvalidArgument("BeamSearchDecoder: The token input cannot be a state input.");
+
+            if (state.first.Shape() != state.second.Shape() || state.first.GetDataType() != state.second.GetDataType())
+                InvalidArgument("BeamSearchDecoder: The state input '%S' and the state output '%S' must have the same shape and data type.",
+                                state.first.AsString().c_str(), state.second.AsString().c_str());
+
+            if (state.first.IsSparse() || state.first.GetDataType() != m_logProbabilities.GetDataType())
+                InvalidArgument("BeamSearchDecoder: The state '%S' must be dense and have the data type of the log probabilities.", state.first.AsString().c_str());
+        }
+    }
+
+    std::vector<std::vector<BeamSearchHypothesis>> BeamSearchDecoder::Decode(size_t numberOfUtterances,
+        const std::unordered_map<Variable, ValuePtr>& initialStates,
+        const std::unordered_map<Variable, ValuePtr>& contexts,
+        const DeviceDescriptor& computeDevice)
+    {
+        if (numberOfUtterances == 0)
+            InvalidArgument("BeamSearchDecoder: The number of utterances must be positive.");
+
+        switch (m_logProbabilities.GetDataType())
+        {
+        case DataType::Float:
+            return Decode<float>(numberOfUtterances, initialStates, contexts, computeDevice);
+        case DataType::Double:
+            return Decode<double>(numberOfUtterances, initialStates, contexts, computeDevice);
+        default:
+            LogicError("BeamSearchDecoder: Unsupported DataType %s.", DataTypeName(m_logProbabilities.GetDataType()));
+        }
+    }
+
+    template <typename ElementType>
+    std::vector<std::vector<BeamSearchHypothesis>> BeamSearchDecoder::Decode(size_t numberOfUtterances,
+        const std::unordered_map<Variable, ValuePtr>& initialStates,
+        const std::unordered_map<Variable, ValuePtr>& contexts,
+        const DeviceDescriptor& computeDevice)
+    {
+        // The token history of all hypotheses is a forest, every hypothesis refers to its last token.
+        struct HistoryEntry
+        {
+            size_t m_parent;
+            size_t m_token;
+        };
+        const size_t noHistory = SIZE_MAX;
+
+        // Hypotheses of the same utterance are contiguous and ordered by utterance.
+        struct ActiveHypothesis
+        {
+            size_t m_utterance;
+            size_t m_history;
+            double m_score;
+        };
+
+        struct FinishedHypothesis
+        {
+            size_t m_history;
+            double m_score;
+            bool m_isComplete;
+        };
+
+        struct Candidate
+        {
+            size_t m_hypothesis;
+            size_t m_token;
+            double m_score;
+        };
+
+        auto byDescendingScore = [](const Candidate& a, const Candidate& b) { return a.m_score > b.m_score; };
+
+        // Initial states and contexts, one column per utterance.
+        std::vector<NDArrayViewPtr> states;
+        for (const auto& state : m_stateInputsToOutputs)
+        {
+            auto initialState = initialStates.find(state.first);
+            if (initialState == initialStates.end())
+                states.push_back(MakeSharedObject<NDArrayView>(ElementType(0), NDShape({ state.first.Shape().TotalSize(), numberOfUtterances }), computeDevice));
+            else
+                states.push_back(AsPerUtteranceView(state.first, initialState->second, numberOfUtterances, computeDevice));
+        }
+
+        for (const auto& initialState : initialStates)
+        {
+            auto isStateInput = [&initialState](const std::pair<Variable, Variable>& s) { return s.first == initialState.first; };
+            if (std::find_if(m_stateInputsToOutputs.begin(), m_stateInputsToOutputs.end(), isStateInput) == m_stateInputsToOutputs.end())
+                InvalidArgument("BeamSearchDecoder: '%S' is not a state input.", initialState.first.AsString().c_str());
+        }
+
+        std::vector<std::pair<Variable, NDArrayViewPtr>> contextViews;
+        for (const auto& argument : m_stepFunction->Arguments())
+        {
+            auto isStateInput = [&argument](const std::pair<Variable, Variable>& s) { return s.first == argument; };
+            if (argument == m_tokenInput || std::find_if(m_stateInputsToOutputs.begin(), m_stateInputsToOutputs.end(), isStateInput) != m_stateInputsToOutputs.end())
+                continue;
+
+            auto context = contexts.find(argument);
+            if (context == contexts.end())
+                InvalidArgument("BeamSearchDecoder: No context value was specified for the argument '%S' of the step function.", argument.AsString().c_str());
+
+            if (!HasOnlyBatchAxis(argument))
+                InvalidArgument("BeamSearchDecoder: The context '%S' must only have the batch axis.", argument.AsString().c_str());
+
+            contextViews.push_back({ argument, AsPerUtteranceView(argument, context->second, numberOfUtterances, computeDevice) });
+        }
+
+        if (contextViews.size() != contexts.size())
+            InvalidArgument("BeamSearchDecoder: Some of the specified contexts are not arguments of the step function.");
+
+        std::vector<HistoryEntry> history;
+        std::vector<ActiveHypothesis> active;
+        for (size_t u = 0; u < numberOfUtterances; ++u)
+            active.push_back({ u, noHistory, 0.0 });
+
+        std::vector<std::vector<FinishedHypothesis>> finished(numberOfUtterances);
+
+        // Columns of the per-utterance contexts for the current hypotheses; contexts are only regathered when it changes.
+        std::vector<size_t> contextColumns;
+        std::vector<NDArrayViewPtr> gatheredContexts(contextViews.size());
+
+        std::vector<Candidate> candidates;
+        std::vector<size_t> tokenOrder(m_vocabularySize);
+        std::vector<ElementType> denseTokens;
+        for (size_t step = 0; step < m_maxLength && !active.empty(); ++step)
+        {
+            const size_t numberOfHypotheses = active.size();
+
+            // Inputs of the step.
+            std::unordered_map<Variable, ValuePtr> arguments;
+            std::vector<size_t> previousTokens(numberOfHypotheses);
+            for (size_t h = 0; h < numberOfHypotheses; ++h)
+                previousTokens[h] = active[h].m_history == noHistory ? m_startToken : history[active[h].m_history].m_token;
+
+            if (m_tokenInput.IsSparse())
+                arguments[m_tokenInput] = Value::CreateBatch<ElementType>(m_vocabularySize, previousTokens, computeDevice, /*readOnly =*/ true);
+            else
+            {
+                denseTokens.assign(m_vocabularySize * numberOfHypotheses, 0);
+                for (size_t h = 0; h < numberOfHypotheses; ++h)
+                    denseTokens[h * m_vocabularySize + previousTokens[h]] = 1;
+                arguments[m_tokenInput] = Value::CreateBatch<ElementType>(m_tokenInput.Shape(), denseTokens, computeDevice, /*readOnly =*/ true);
+            }
+
+            for (size_t i = 0; i < m_stateInputsToOutputs.size(); ++i)
+            {
+                const auto& input = m_stateInputsToOutputs[i].first;
+                arguments[input] = MakeSharedObject<Value>(states[i]->AsShape(input.Shape().AppendShape({ numberOfHypotheses })));
+            }
+
+            std::vector<size_t> utterances(numberOfHypotheses);
+            for (size_t h = 0; h < numberOfHypotheses; ++h)
+                utterances[h] = active[h].m_utterance;
+
+            if (utterances != contextColumns && !contextViews.empty())
+            {
+                auto columnIndices = CreateColumnIndices<ElementType>(utterances, computeDevice);
+                for (size_t i = 0; i < contextViews.size(); ++i)
+                    gatheredContexts[i] = GatherColumns<ElementType>(contextViews[i].second, columnIndices);
+                contextColumns = utterances;
+            }
+
+            for (size_t i = 0; i < contextViews.size(); ++i)
+            {
+                const auto& input = contextViews[i].first;
+                arguments[input] = MakeSharedObject<Value>(gatheredContexts[i]->AsShape(input.Shape().AppendShape({ numberOfHypotheses })));
+            }
+
+            std::unordered_map<Variable, ValuePtr> outputs = { { m_logProbabilities, nullptr } };
+            for (const auto& state : m_stateInputsToOutputs)
+                outputs[state.second] = nullptr;
+
+            m_stepFunction->Forward(arguments, outputs, computeDevice);
+
+            m_totalNumberOfEvaluatedTokens += numberOfHypotheses;
+            m_totalNumberOfSteps++;
+
+            // Only the scores are brought back to the CPU to select the candidates, the states stay on the device.
+            auto logProbabilities = outputs[m_logProbabilities]->Data()->DeepClone(DeviceDescriptor::CPUDevice(), /*readOnly =*/ true);
+            if (logProbabilities->Shape().TotalSize() != m_vocabularySize * numberOfHypotheses)
+                LogicError("BeamSearchDecoder: The log probabilities '%S' have an unexpected shape '%S' for %zu hypotheses.",
+                           m_logProbabilities.AsString().c_str(), logProbabilities->Shape().AsString().c_str(), numberOfHypotheses);
+            const ElementType* scores = logProbabilities->DataBuffer<ElementType>();
+
+            // Each utterance keeps the best BeamWidth() extensions of its hypotheses; only the best BeamWidth()
+            // tokens of every hypothesis can make it into the beam.
+            const size_t tokensPerHypothesis = std::min(m_beamWidth, m_vocabularySize);
+            std::vector<ActiveHypothesis> nextActive;
+            std::vector<size_t> parentColumns;
+            for (size_t begin = 0; begin < numberOfHypotheses;)
+            {
+                const size_t utterance = active[begin].m_utterance;
+                size_t end = begin;
+                while (end < numberOfHypotheses && active[end].m_utterance == utterance)
+                    end++;
+
+                candidates.clear();
+                for (size_t h = begin; h < end; ++h)
+                {
+                    const ElementType* hypothesisScores = scores + h * m_vocabularySize;
+                    std::iota(tokenOrder.begin(), tokenOrder.end(), 0);
+                    std::partial_sort(tokenOrder.begin(), tokenOrder.begin() + tokensPerHypothesis, tokenOrder.end(),
+                                      [hypothesisScores](size_t a, size_t b) { return hypothesisScores[a] > hypothesisScores[b]; });
+                    for (size_t k = 0; k < tokensPerHypothesis; ++k)
+                        candidates.push_back({ h, tokenOrder[k], active[h].m_score + hypothesisScores[tokenOrder[k]] });
+                }
+
+                const size_t beamSize = std::min(m_beamWidth, candidates.size());
+                std::partial_sort(candidates.begin(), candidates.begin() + beamSize, candidates.end(), byDescendingScore);
+
+                auto& utteranceFinished = finished[utterance];
+                const size_t firstExtension = nextActive.size();
+                for (size_t k = 0; k < beamSize; ++k)
+                {
+                    const auto& candidate = candidates[k];
+                    const auto& parent = active[candidate.m_hypothesis];
+                    if (candidate.m_token == m_endToken)
+                    {
+                        utteranceFinished.push_back({ parent.m_history, candidate.m_score, true });
+                        continue;
+                    }
+
+                    history.push_back({ parent.m_history, candidate.m_token });
+                    nextActive.push_back({ utterance, history.size() - 1, candidate.m_score });
+                    parentColumns.push_back(candidate.m_hypothesis);
+                }
+
+                // Log probabilities are not positive, so the score of a hypothesis never grows: once there are
+                // BeamWidth() finished hypotheses, active hypotheses scoring below the worst of them are dropped.
+                if (utteranceFinished.size() >= m_beamWidth)
+                {
+                    std::nth_element(utteranceFinished.begin(), utteranceFinished.begin() + m_beamWidth - 1, utteranceFinished.end(),
+                                     [](const FinishedHypothesis& a, const FinishedHypothesis& b) { return a.m_score > b.m_score; });
+                    utteranceFinished.resize(m_beamWidth);
+                    const double threshold = utteranceFinished.back().m_score;
+
+                    size_t kept = firstExtension;
+                    for (size_t i = firstExtension; i < nextActive.size(); ++i)
+                    {
+                        if (nextActive[i].m_score <= threshold)
+                            continue;
+                        nextActive[kept] = nextActive[i];
+                        parentColumns[kept] = parentColumns[i];
+                        kept++;
+                    }
+                    nextActive.resize(kept);
+                    parentColumns.resize(kept);
+                }
+
+                begin = end;
+            }
+
+            // Reorder the new states so that they follow the surviving hypotheses.
+            if (!nextActive.empty())
+            {
+                auto columnIndices = CreateColumnIndices<ElementType>(parentColumns, computeDevice);
+                for (size_t i = 0; i < m_stateInputsToOutputs.size(); ++i)
+                {
+                    auto newState = outputs[m_stateInputsToOutputs[i].second]->Data();
+                    newState = newState->AsShape(NDShape({ m_stateInputsToOutputs[i].second.Shape().TotalSize(), numberOfHypotheses }));
+                    states[i] = GatherColumns<ElementType>(newState, columnIndices);
+                }
+            }
+
+            active.swap(nextActive);
+        }
+
+        // Hypotheses that reached the maximum length.
+        for (const auto& hypothesis : active)
+            finished[hypothesis.m_utterance].push_back({ hypothesis.m_history, hypothesis.m_score, false });
+
+        std::vector<std::vector<BeamSearchHypothesis>> result(numberOfUtterances);
+        for (size_t u = 0; u < numberOfUtterances; ++u)
+        {
+            auto& utteranceFinished = finished[u];
+            std::stable_sort(utteranceFinished.begin(), utteranceFinished.end(),
+                             [](const FinishedHypothesis& a, const FinishedHypothesis& b) { return a.m_score > b.m_score; });
+            if (utteranceFinished.size() > m_beamWidth)
+                utteranceFinished.resize(m_beamWidth);
+
+            for (const auto& f : utteranceFinished)
+            {
+                BeamSearchHypothesis hypothesis;
+                hypothesis.m_score = f.m_score;
+                hypothesis.m_isComplete = f.m_isComplete;
+                for (size_t h = f.m_history; h != noHistory; h = history[h].m_parent)
+                    hypothesis.m_tokens.push_back(history[h].m_token);
+                std::reverse(hypothesis.m_tokens.begin(), hypothesis.m_tokens.end());
+                result[u].push_back(std::move(hypothesis));
+            }
+        }
+
+        return result;
+    }
+}
@@ -171,7 +171,22 @@ namespace CNTK
             Microsoft::MSR::CNTK::Globals::SetGradientAccumulationOptimization(/* enable = */ false);
         }
 
-        void StartProfiler(const wstring& profilerDir, bool profilerSyncGpu, size_t profilerBufferSize)
+        void EnableRecurrentLoopPipelining()
+        {
+            Microsoft::MSR::CNTK::Globals::SetRecurrentLoopPipelining(/* enable = */ true);
+        }
+
+        void DisableRecurrentLoopPipelining()
+        {
+            Microsoft::MSR::CNTK::Globals::SetRecurrentLoopPipelining(/* enable = */ false);
+        }
+
+        void SetCompiledNetworkCacheDirectory(const std::wstring& directory)
+        {
+            Microsoft::MSR::CNTK::Globals::SetCompiledNetworkCacheDirectory(directory);
+        }
+
+        void StartProfiler(const wstring& profilerDir, bool profilerSyncGpu, size_t profilerBufferSize, bool profilerNodes)
         {
 #ifndef CNTK_UWP
             std::wstring logSuffix = L"";
@@ -185,7 +200,8 @@ namespace CNTK
                 profilerDir,
                 profilerBufferSize,
                 logSuffix,
-                profilerSyncGpu);
+                profilerSyncGpu,
+                profilerNodes);
 #endif
         }
 
@@ -9,6 +9,7 @@
 #include "CompositeFunction.h"
 #include <tuple>
 #include "ComputationNetworkBuilder.h"
+#include "MinibatchSource.h"
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -21,6 +22,49 @@ namespace CNTK
         typedef std::shared_ptr<ComputationNode<float>> ComputationNodePtr;
         const auto& minibatchSourceStreams = minibatchSource->StreamInfos();
 
+        // The built-in composite source computes the statistics directly from the chunks of its deserializers, much faster than
+        // reading all data one minibatch at a time through a network of Mean and InvStdDev nodes.
+        auto compositeMinibatchSource = std::dynamic_pointer_cast<CompositeMinibatchSource>(minibatchSource);
+        if (compositeMinibatchSource)
+        {
+            std::vector<std::wstring> streamNames;
+            for (const auto& currentStreamKV : computedMeanAndInvStdDevs)
+            {
+                if (minibatchSourceStreams.find(currentStreamKV.first) == minibatchSourceStreams.end())
+                    InvalidArgument("Stream '%S' for which mean and variance are to be computed, is not supported by the specified minibatchSource.", currentStreamKV.first.AsString().c_str());
+                streamNames.push_back(currentStreamKV.first.m_name);
+            }
+
+            std::map<std::wstring, StreamStatistics> statistics;
+            if (compositeMinibatchSource->ComputeStreamStatistics(streamNames, statistics))
+            {
+                auto assign = [&device](NDArrayViewPtr& result, const NDShape& shape, const std::vector<double>& values)
+                {
+                    std::vector<float> buffer(values.begin(), values.end());
+                    auto cpuView = MakeSharedObject<NDArrayView>(shape, buffer.data(), buffer.size(), DeviceDescriptor::CPUDevice(), /*readOnly=*/true);
+                    if (result == nullptr)
+                        result = MakeSharedObject<NDArrayView>(DataType::Float, shape, device);
+                    result->CopyFrom(*cpuView);
+                };
+
+                for (auto& currentStreamKV : computedMeanAndInvStdDevs)
+                {
+                    const auto& currentStatistics = statistics.at(currentStreamKV.first.m_name);
+                    if (currentStatistics.GetCount() == 0)
+                        RuntimeError("ComputeInputPerDimMeansAndInvStdDevs: Stream '%S' has no samples.", currentStreamKV.first.AsString().c_str());
+
+                    // same floor as in InvStdDevNode
+                    auto invStdDev = currentStatistics.GetVariance();
+                    for (auto& v : invStdDev)
+                        v = 1 / sqrt(std::max(v, 1e-10));
+
+                    assign(currentStreamKV.second.first, currentStreamKV.first.m_sampleLayout, currentStatistics.GetMean());
+                    assign(currentStreamKV.second.second, currentStreamKV.first.m_sampleLayout, invStdDev);
+                }
+                return;
+            }
+        }
+
         auto computationNetwork = std::make_shared<ComputationNetwork>(AsCNTKImplDeviceId(device));
         ComputationNetworkBuilder<float> builder(*computationNetwork);
 
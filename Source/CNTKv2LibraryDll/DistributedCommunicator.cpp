@@ -34,6 +34,11 @@ namespace CNTK
         return std::make_shared<MPICommunicatorImpl>(packThresholdSizeInBytes);
     }
 
+    DistributedCommunicatorPtr HierarchicalMPICommunicator(size_t packThresholdSizeInBytes)
+    {
+        return std::make_shared<MPICommunicatorImpl>(packThresholdSizeInBytes, true /*useHierarchicalAllReduce*/);
+    }
+
     void DistributedCommunicator::Finalize()
     {
         auto mpi = MPIWrapper::GetInstance(false);
@@ -69,13 +74,15 @@ namespace CNTK
         return nullptr; // Make compiler happy.
     }
 
-    MPICommunicatorImpl::MPICommunicatorImpl(size_t packThresholdSizeInBytes)
+    MPICommunicatorImpl::MPICommunicatorImpl(size_t packThresholdSizeInBytes, bool useHierarchicalAllReduce)
     {
         m_mpi = MPIWrapper::GetInstance();
         if (m_mpi == nullptr)
         {
             m_mpi = MPIWrapper::GetInstance(true /*create*/);
         }
+        if (useHierarchicalAllReduce)
+            m_mpi->SetUseHierarchicalAllReduce(true);
         m_currentWorker.m_globalRank = m_mpi->CurrentNodeRank();
         m_currentWorker.m_hostId = std::wstring(m_mpi->CurrentNodeName());
         for (size_t i = 0; i < m_mpi->NumNodesInUse(); ++i)
@@ -555,7 +562,8 @@ namespace CNTK
             return;
         }
 
-        if (m_mpi->UseGpuGdr())
+        // The hierarchical all-reduce is synchronous, and reduces values on the CPU only.
+        if (m_mpi->UseGpuGdr() || (dataOnCPU && m_mpi->UseHierarchicalAllReduce()))
         {
             if (inputData == outputData)
                 m_mpi->AllReduce(outputData, numElements);
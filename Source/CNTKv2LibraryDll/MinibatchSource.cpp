@@ -524,6 +524,9 @@ namespace CNTK
 
             if (configuration.isFrameModeEnabled && configuration.truncationLength != 0)
                 LogicError("MinibatchSourceConfig: truncation and frame mode are mutually exclusive options.");
+
+            if (configuration.isLengthBucketingEnabled && configuration.randomizationWindowInChunks == 0 && configuration.randomizationWindowInSamples == 0)
+                LogicError("MinibatchSourceConfig: length bucketing requires randomization.");
         }
 
         Dictionary ToDictionary(const ::CNTK::MinibatchSourceConfig& configuration)
@@ -558,6 +561,13 @@ namespace CNTK
             }
 
             augmentedConfiguration[L"frameMode"] = configuration.isFrameModeEnabled;
+
+            if (configuration.isLengthBucketingEnabled)
+            {
+                augmentedConfiguration[L"bucketByLength"] = true;
+                augmentedConfiguration[L"lengthBucketSizeInSamples"] = configuration.lengthBucketSizeInSamples;
+            }
+
             augmentedConfiguration[L"traceLevel"] = static_cast<size_t>(configuration.traceLevel);
 
             bool defaultMultithreaded = false;
@@ -574,6 +584,7 @@ namespace CNTK
                     { L"Base64ImageDeserializer",      L"ImageReader" },
                     { L"HTKFeatureDeserializer",       L"HTKDeserializers" },
                     { L"HTKMLFDeserializer",           L"HTKDeserializers" },
+                    { L"DSSMDeserializer",             L"DSSMReader" },
                 };
 
                 auto deserializerTypeName = deserializerConfig[L"type"].Value<std::wstring>();
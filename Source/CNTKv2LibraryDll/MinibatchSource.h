@@ -35,6 +35,17 @@ namespace CNTK
 
         bool IsInfinite() override;
 
+        // Per-dimension statistics of the streams directly from the chunks of the deserializers, bypassing minibatch formation.
+        // Returns false if the reader cannot compute them for these streams.
+        bool ComputeStreamStatistics(const std::vector<std::wstring>& streamNames, std::map<std::wstring, Microsoft::MSR::CNTK::StreamStatistics>& statistics)
+        {
+            uint64_t fingerprint;
+            if (!m_shim->GetStreamStatisticsFingerprint(streamNames, fingerprint))
+                return false;
+            m_shim->ComputeStreamStatistics(streamNames, /*workerRank=*/0, /*numWorkers=*/1, statistics);
+            return true;
+        }
+
     private:
         static Microsoft::MSR::CNTK::InputStreamDescription GetInputStreamDescription(const StreamInformation& s, const DeviceDescriptor& device)
         {
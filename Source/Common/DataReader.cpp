@@ -388,6 +388,22 @@ bool DataReader::GetData(const std::wstring& sectionName, size_t numRecords, voi
     return bRet;
 }
 
+// Only for a single reader, because the readers of a composition may not agree on the chunks.
+bool DataReader::GetStreamStatisticsFingerprint(const std::vector<std::wstring>& streamNames, uint64_t& fingerprint)
+{
+    if (m_ioNames.size() != 1)
+        return false;
+    return m_dataReaders[m_ioNames.front()]->GetStreamStatisticsFingerprint(streamNames, fingerprint);
+}
+
+void DataReader::ComputeStreamStatistics(const std::vector<std::wstring>& streamNames, size_t workerRank, size_t numWorkers,
+                                         std::map<std::wstring, StreamStatistics>& statistics)
+{
+    if (m_ioNames.size() != 1)
+        LogicError("ComputeStreamStatistics: not supported for a composition of readers.");
+    m_dataReaders[m_ioNames.front()]->ComputeStreamStatistics(streamNames, workerRank, numWorkers, statistics);
+}
+
 bool DataReader::DataEnd()
 {
     bool bRet = true;
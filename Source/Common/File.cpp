@@ -999,6 +999,7 @@ static const std::unordered_map<std::wstring, std::wstring> s_deprecatedReaderWr
     { L"SparsePCReader",        L"Cntk.Reader.SparsePC" },
     { L"Kaldi2Reader",          L"Cntk.Reader.Kaldi2" },
     { L"BinaryReader",          L"Cntk.Reader.Binary" },
+    { L"DSSMReader",            L"Cntk.Reader.DSSM" },
 
     // legacy writer mapping
     { L"HTKMLFWriter",          L"Cntk.Reader.HTKMLF" },
@@ -15,4 +15,6 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
     std::atomic<bool> Globals::m_enableShareNodeValueMatrices(true);
     std::atomic<bool> Globals::m_optimizeGradientAccumulation(true);
+    std::atomic<bool> Globals::m_pipelineRecurrentLoops(false);
+    std::wstring Globals::m_compiledNetworkCacheDirectory;
 }}}
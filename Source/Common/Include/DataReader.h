@@ -27,6 +27,7 @@
 #include "Sequences.h"
 #include "Config.h" // for ConfigParameters
 #include "ScriptableObjects.h"
+#include "StreamStatistics.h"
 #include <map>
 #include <string>
 #include <memory>
@@ -318,6 +319,21 @@ public:
         return false;
     }
 
+    // Per-dimension statistics of input streams computed directly from the deserializer chunks, bypassing minibatch formation.
+    // Returns false if this reader cannot provide them for all of the given streams, e.g. because they are transformed.
+    // Otherwise 'fingerprint' identifies the data (chunk table and stream layouts), for validating statistics saved earlier.
+    virtual bool GetStreamStatisticsFingerprint(const std::vector<std::wstring>& /*streamNames*/, uint64_t& /*fingerprint*/)
+    {
+        return false;
+    }
+    // Computes the statistics over every numWorkers-th chunk, starting with chunk workerRank. Chunks are processed in parallel.
+    // The caller merges the results of all workers, see StreamStatistics::MergeAcrossWorkers().
+    virtual void ComputeStreamStatistics(const std::vector<std::wstring>& /*streamNames*/, size_t /*workerRank*/, size_t /*numWorkers*/,
+                                         std::map<std::wstring, StreamStatistics>& /*statistics*/)
+    {
+        NOT_IMPLEMENTED;
+    }
+
     bool GetFrame(StreamMinibatchInputs& /*matrices*/, const size_t /*tidx*/, vector<size_t>& /*history*/)
     {
         NOT_IMPLEMENTED;
@@ -470,6 +486,10 @@ public:
     // returns: true if data remains to be read, false if the end of data was reached
     virtual bool GetData(const std::wstring& sectionName, size_t numRecords, void* data, size_t& dataBufferSize, size_t recordStart = 0);
 
+    virtual bool GetStreamStatisticsFingerprint(const std::vector<std::wstring>& streamNames, uint64_t& fingerprint) override;
+    virtual void ComputeStreamStatistics(const std::vector<std::wstring>& streamNames, size_t workerRank, size_t numWorkers,
+                                         std::map<std::wstring, StreamStatistics>& statistics) override;
+
     virtual bool DataEnd();
     // TODO: The return value if this is never used except in loops where we do an &=. It is not clear whether that is a bug or intentionally prevents DataEnd() from being called.
     //       Once this is understood, we can change the return value to void.
@@ -355,6 +355,24 @@ public:
     // resetRNN - flags whether to reset memory cells of RNN. 
     //
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output, bool resetRNN) = 0;
+
+    //
+    // ForwardPass - Evaluate a batch of sequences of possibly different lengths in one call. The sequences are
+    // computed side by side, like the parallel sequences of a minibatch during training.
+    // inputs - one set of input buffers per sequence, each laid out as for the single-sequence calls above
+    // sequenceStarts - one flag per sequence: true if the sequence begins with this call, false if it continues
+    //                  the sequence at the same position of the previous call. A sequence can only be continued if
+    //                  it was a longest one of the previous call.
+    // outputs - one set of preallocated output buffers per sequence, each receiving the frames of its sequence only.
+    // A single dense input sequence on the CPU is bound as matrix storage without copying it; all outputs are
+    // written directly into the caller's buffers.
+    //
+    virtual void ForwardPass(const std::vector<Values<ElemType>>& inputs, const std::vector<bool>& sequenceStarts, std::vector<Values<ElemType>>& outputs) = 0;
+
+    //
+    // Same as above, but takes references to static arrays instead of std::vector.
+    //
+    virtual void ForwardPass(const std::vector<ValueRefs<ElemType>>& inputs, const std::vector<bool>& sequenceStarts, std::vector<ValueRefs<ElemType>>& outputs) = 0;
 };
 
 template <typename ElemType>
@@ -0,0 +1,82 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Float16.h -- conversion between float and IEEE 754 half precision (binary16) values stored as uint16_t
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Rounds to nearest even. Values too large for half precision become infinity, NaNs stay NaNs.
+inline uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    uint32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (exponent == 0xff) // infinity or NaN
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+
+    int halfExponent = (int)exponent - 127 + 15;
+    if (halfExponent >= 0x1f) // overflow
+        return sign | 0x7c00;
+
+    if (halfExponent <= 0) // subnormal or zero
+    {
+        if (halfExponent < -10)
+            return sign;
+        mantissa |= 0x800000; // implicit leading one
+        uint32_t shift = (uint32_t)(14 - halfExponent);
+        uint32_t halfMantissa = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (halfMantissa & 1)))
+            halfMantissa++;
+        return sign | (uint16_t)halfMantissa;
+    }
+
+    uint16_t half = sign | (uint16_t)(halfExponent << 10) | (uint16_t)(mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        half++; // may carry into the exponent, which correctly rounds up to the next power of two or infinity
+    return half;
+}
+
+inline float HalfToFloat(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+
+    uint32_t bits;
+    if (exponent == 0x1f) // infinity or NaN
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    else if (exponent != 0)
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    else if (mantissa == 0)
+        bits = sign;
+    else // subnormal, normalize
+    {
+        exponent = 127 - 15 + 1;
+        while (!(mantissa & 0x400))
+        {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+}}}
@@ -0,0 +1,39 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Fnv1aHash.h -- 64-bit FNV-1a hash, for keys of files that are shared across processes and runs (unlike std::hash)
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+static const uint64_t Fnv1aHashSeed = 0xcbf29ce484222325ULL;
+
+// Hashes are built up incrementally, starting from Fnv1aHashSeed: hash = Fnv1aHash(hash, ...).
+inline uint64_t Fnv1aHash(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+// includes the terminator, so that concatenations of strings differ
+inline uint64_t Fnv1aHash(uint64_t hash, const std::wstring& s)
+{
+    return Fnv1aHash(hash, s.c_str(), (s.size() + 1) * sizeof(wchar_t));
+}
+
+template <class T>
+inline uint64_t Fnv1aHash(uint64_t hash, T value)
+{
+    return Fnv1aHash(hash, &value, sizeof(value));
+}
+
+}}}
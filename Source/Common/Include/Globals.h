@@ -6,6 +6,7 @@
 #pragma once
 
 #include <atomic>
+#include <string>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -28,11 +29,21 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         static void SetShareNodeValueMatrices(bool enable) { m_enableShareNodeValueMatrices = enable; }
         static bool ShouldEnableShareNodeValueMatrices() { return m_enableShareNodeValueMatrices; }
 
+        // Run chains of stacked recurrent loops as a wavefront, one thread per loop (CPU only). Set this before the network is compiled.
+        static void SetRecurrentLoopPipelining(bool enable) { m_pipelineRecurrentLoops = enable; }
+        static bool ShouldPipelineRecurrentLoops() { return m_pipelineRecurrentLoops; }
+
+        // Directory for the CompiledNetworkCache files, empty to disable the cache. Set this at startup, before any network is compiled.
+        static void SetCompiledNetworkCacheDirectory(const std::wstring& directory) { m_compiledNetworkCacheDirectory = directory; }
+        static const std::wstring& GetCompiledNetworkCacheDirectory() { return m_compiledNetworkCacheDirectory; }
+
     private:
         static std::atomic<bool> m_forceDeterministicAlgorithms;
         // The global flag to enable matrices values in forward and backward prop
         static std::atomic<bool> m_enableShareNodeValueMatrices;
         static std::atomic<bool> m_forceConstantRandomSeed;
         static std::atomic<bool> m_optimizeGradientAccumulation;
+        static std::atomic<bool> m_pipelineRecurrentLoops;
+        static std::wstring m_compiledNetworkCacheDirectory;
     };
 }}}
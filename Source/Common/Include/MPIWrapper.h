@@ -61,7 +61,7 @@ extern int operator||(int rc, const MpiFail &what);
 class MPIWrapper;
 typedef std::shared_ptr<MPIWrapper> MPIWrapperPtr;
 
-extern "C" void GetMpiWrapper(MPIWrapper **mpi);
+extern "C" void GetMpiWrapper(MPIWrapper **mpi, bool concurrentCalls);
 
 // Note: This is now a pure interface, so please don't add
 //       any functionality to this class.
@@ -77,7 +77,8 @@ public:
     MPIWrapper() {}
     virtual ~MPIWrapper() {}
 
-    static MPIWrapperPtr GetInstance(bool create = false);
+    // 'concurrentCalls' (only used with 'create') initializes MPI with MPI_THREAD_MULTIPLE rather than MPI_THREAD_SERIALIZED
+    static MPIWrapperPtr GetInstance(bool create = false, bool concurrentCalls = false);
     static void DeleteInstance();
     static MPIWrapperPtr s_mpi;
 
@@ -93,6 +94,14 @@ public:
     // Use GPUDirect RDMA support
     virtual bool UseGpuGdr() = 0;
 
+    // Whether the data-exchange functions may be called from several threads at once (MPI_THREAD_MULTIPLE)
+    virtual bool SupportsConcurrentCalls() const = 0;
+
+    // Sum float/double AllReduce()s within each host through shared memory first, and only across hosts through MPI,
+    // among one leader rank per host. This is a collective setting: all ranks must set it the same way.
+    virtual void SetUseHierarchicalAllReduce(bool enable) = 0;
+    virtual bool UseHierarchicalAllReduce() const = 0;
+
     // -----------------------------------------------------------------------
     // data-exchange functions (wrappers around MPI functions)
     // -----------------------------------------------------------------------
@@ -0,0 +1,182 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// StreamStatistics.h -- per-dimension mean and variance of the samples of an input stream, mergeable across threads and workers
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "File.h"
+#include "fileutil.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Partial statistics over a set of samples: their number, the per-dimension mean, and the per-dimension sum of squared
+// deviations from that mean. Results over disjoint sets of samples are combined with the pairwise update of Chan et al.,
+// which, unlike accumulating sums of squares, does not lose precision when the mean is large compared to the deviation.
+// This is what MeanNode and InvStdDevNode compute, but without going through the network one minibatch at a time.
+class StreamStatistics
+{
+public:
+    StreamStatistics(size_t dimension = 0)
+        : m_count(0), m_mean(dimension, 0.0), m_sumOfSquaredDeviations(dimension, 0.0)
+    {
+    }
+
+    StreamStatistics(size_t count, std::vector<double>&& mean, std::vector<double>&& sumOfSquaredDeviations)
+        : m_count(count), m_mean(std::move(mean)), m_sumOfSquaredDeviations(std::move(sumOfSquaredDeviations))
+    {
+        if (m_mean.size() != m_sumOfSquaredDeviations.size())
+            LogicError("StreamStatistics: mean and sum of squared deviations differ in dimension.");
+    }
+
+    size_t GetDimension() const { return m_mean.size(); }
+    size_t GetCount() const { return m_count; }
+    const std::vector<double>& GetMean() const { return m_mean; }
+
+    // population variance (normalized by the number of samples), like InvStdDevNode
+    std::vector<double> GetVariance() const
+    {
+        std::vector<double> variance(m_sumOfSquaredDeviations);
+        if (m_count > 0)
+            for (auto& v : variance)
+                v /= m_count;
+        return variance;
+    }
+
+    // adds the statistics over another, disjoint set of samples
+    void Merge(const StreamStatistics& other)
+    {
+        if (other.GetDimension() != GetDimension())
+            LogicError("StreamStatistics: cannot merge statistics of dimension %d into %d.", (int)other.GetDimension(), (int)GetDimension());
+        if (other.m_count == 0)
+            return;
+
+        size_t totalCount = m_count + other.m_count;
+        double otherWeight = (double)other.m_count / totalCount;
+        double crossWeight = (double)m_count * other.m_count / totalCount;
+        for (size_t i = 0; i < m_mean.size(); i++)
+        {
+            double delta = other.m_mean[i] - m_mean[i];
+            m_mean[i] += delta * otherWeight;
+            m_sumOfSquaredDeviations[i] += other.m_sumOfSquaredDeviations[i] + delta * delta * crossWeight;
+        }
+        m_count = totalCount;
+    }
+
+    // Replaces the partial statistics of this worker by those over the samples of all workers.
+    // 'sumAcrossWorkers' must replace a vector by its elementwise sum over all workers, e.g. with an MPI all-reduce.
+    // Two reductions: the first yields the overall mean, the second the sum of squared deviations from it,
+    // to which every worker contributes its own plus the correction for the difference of its mean from the overall one.
+    void MergeAcrossWorkers(const std::function<void(std::vector<double>&)>& sumAcrossWorkers)
+    {
+        size_t dimension = GetDimension();
+        std::vector<double> buffer(dimension + 1);
+        buffer[0] = (double)m_count;
+        for (size_t i = 0; i < dimension; i++)
+            buffer[i + 1] = m_count * m_mean[i];
+        sumAcrossWorkers(buffer);
+
+        double totalCount = buffer[0];
+        std::vector<double> mean(dimension, 0.0);
+        if (totalCount > 0)
+            for (size_t i = 0; i < dimension; i++)
+                mean[i] = buffer[i + 1] / totalCount;
+
+        buffer.resize(dimension);
+        for (size_t i = 0; i < dimension; i++)
+        {
+            double delta = m_mean[i] - mean[i];
+            buffer[i] = m_sumOfSquaredDeviations[i] + m_count * delta * delta;
+        }
+        sumAcrossWorkers(buffer);
+
+        m_count = (size_t)totalCount;
+        m_mean = std::move(mean);
+        m_sumOfSquaredDeviations = std::move(buffer);
+    }
+
+    void Save(File& fstream) const
+    {
+        fstream << m_count << m_mean.size();
+        for (size_t i = 0; i < m_mean.size(); i++)
+            fstream << m_mean[i] << m_sumOfSquaredDeviations[i];
+    }
+
+    void Load(File& fstream)
+    {
+        size_t dimension;
+        fstream >> m_count >> dimension;
+        m_mean.resize(dimension);
+        m_sumOfSquaredDeviations.resize(dimension);
+        for (size_t i = 0; i < dimension; i++)
+            fstream >> m_mean[i] >> m_sumOfSquaredDeviations[i];
+    }
+
+private:
+    size_t m_count;
+    std::vector<double> m_mean;
+    std::vector<double> m_sumOfSquaredDeviations;
+};
+
+// ---------------------------------------------------------------------------
+// sidecar file with the statistics of the input streams of a corpus, so that later jobs on the same data skip computing them
+// The fingerprint identifies the data (see IDataReader::GetStreamStatisticsFingerprint()); a file with another one is ignored.
+// ---------------------------------------------------------------------------
+
+static const size_t s_streamStatisticsFileVersion = 1;
+
+inline void SaveStreamStatistics(const std::wstring& path, uint64_t fingerprint, const std::map<std::wstring, StreamStatistics>& statistics)
+{
+    msra::files::make_intermediate_dirs(path);
+
+    // several jobs may compute the same statistics at the same time, so the file appears atomically
+    std::wstring tmpPath = path + L".tmp" + std::to_wstring(GetCurrentProcessId());
+    {
+        File fstream(tmpPath, FileOptions::fileOptionsBinary | FileOptions::fileOptionsWrite);
+        fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BStreamStatistics");
+        fstream << s_streamStatisticsFileVersion << fingerprint << statistics.size();
+        for (const auto& iter : statistics)
+        {
+            fstream << iter.first;
+            iter.second.Save(fstream);
+        }
+        fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EStreamStatistics");
+    }
+    renameOrDie(tmpPath, path);
+}
+
+// Returns false if there is no file, or it is of another version or fingerprint. Otherwise 'statistics' receives all streams in it.
+inline bool TryLoadStreamStatistics(const std::wstring& path, uint64_t fingerprint, std::map<std::wstring, StreamStatistics>& statistics)
+{
+    if (!fexists(path))
+        return false;
+
+    File fstream(path, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
+    fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BStreamStatistics");
+    size_t version, numStreams;
+    uint64_t fileFingerprint;
+    fstream >> version >> fileFingerprint;
+    if (version != s_streamStatisticsFileVersion || fileFingerprint != fingerprint)
+        return false;
+
+    fstream >> numStreams;
+    statistics.clear();
+    for (size_t i = 0; i < numStreams; i++)
+    {
+        std::wstring name;
+        fstream >> name;
+        statistics[name].Load(fstream);
+    }
+    fstream.GetMarker(FileMarker::fileMarkerEndSection, L"EStreamStatistics");
+    return true;
+}
+
+}}}
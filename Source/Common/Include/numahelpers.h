@@ -10,8 +10,14 @@
 #ifndef __unix__
 #include <Windows.h>
 #include "pplhelpers.h"
+#else
+#include <fstream>
 #endif
 #include <stdexcept>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
 #include "simple_checked_arrays.h"
 #include "Basics.h" // for FormatWin32Error
 
@@ -26,11 +32,52 @@ static inline void overridenode(int n = -1)
     node_override = n;
 }
 
+// parse a Linux processor or node list, e.g. "0-3,8,10-11"
+static inline std::vector<int> parseprocessorlist(const std::string &list)
+{
+    std::vector<int> result;
+    std::stringstream stream(list);
+    std::string range;
+    while (getline(stream, range, ','))
+    {
+        if (range.empty() || range.find_first_not_of(" \t\r\n") == std::string::npos)
+            continue;
+
+        int first = 0, last = 0;
+        auto dash = range.find('-');
+        try
+        {
+            first = std::stoi(range.substr(0, dash));
+            last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        }
+        catch (const std::logic_error &)
+        {
+            InvalidArgument("Invalid processor list '%s'.", list.c_str());
+        }
+
+        if (first < 0 || last < first)
+            InvalidArgument("Invalid processor list '%s'.", list.c_str());
+
+        for (int p = first; p <= last; p++)
+            result.push_back(p);
+    }
+    return result;
+}
+
 // get the number of NUMA nodes we would like to distinguish
 static inline size_t getnumnodes()
 {
 #ifdef CNTK_UWP
     return 1;
+#elif defined(__unix__)
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string list;
+    if (!online || !getline(online, list))
+        return 1;
+    auto nodes = parseprocessorlist(list);
+    if (nodes.empty())
+        return 1;
+    return *std::max_element(nodes.begin(), nodes.end()) + 1;
 #else
     ULONG n;
     if (!GetNumaHighestNodeNumber(&n))
@@ -39,6 +86,33 @@ static inline size_t getnumnodes()
 #endif
 }
 
+// get the logical processors of a NUMA node (empty if there are none or the node does not exist)
+static inline std::vector<int> getnodeprocessors(size_t node)
+{
+    std::vector<int> processors;
+#ifdef CNTK_UWP
+    node;
+#elif defined(__unix__)
+    std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string list;
+    if (cpulist && getline(cpulist, list))
+        processors = parseprocessorlist(list);
+#else
+    ULONGLONG mask = 0;
+    if (node <= 0xff && GetNumaNodeProcessorMask((UCHAR) node, &mask))
+    {
+        for (int p = 0; p < (int) (8 * sizeof(mask)); p++)
+        {
+            if (mask & ((ULONGLONG) 1 << p))
+                processors.push_back(p);
+        }
+    }
+#endif
+    return processors;
+}
+
+#ifndef __unix__
+
 // execute body (node, i, n), i in [0,n) on all NUMA nodes in small chunks
 template <typename FUNCTION>
 void parallel_for_on_each_numa_node(bool multistep, const FUNCTION &body)
@@ -203,6 +277,8 @@ static inline size_t getmostspaciousnumanode()
 #endif
 }
 
+#endif // __unix__
+
 #if 0 // this is no longer used (we now parallelize the big matrix products directly)
 // class to manage multiple copies of data on local NUMA nodes
 template<class DATATYPE,class CACHEDTYPE> class numalocaldatacache
@@ -30,13 +30,32 @@ class MPIWrapperMpi : public MPIWrapper
     int m_numMPINodes;
     size_t m_numNodesInUse;
     bool m_multiHost;
+    int m_threadLevelSupport;
 
     // MPI communicator that reflects the current subset selection
     MPI_Comm m_currentComm;
 
+    // state of the hierarchical AllReduce(), set up by the first call (see InitHierarchicalAllReduce())
+    bool m_useHierarchicalAllReduce;
+    mutable bool m_hierarchicalAllReduceInitialized;
+    mutable MPI_Comm m_hostComm;      // the ranks on this host
+    mutable MPI_Comm m_leaderComm;    // rank 0 of the host communicator of every host; MPI_COMM_NULL on the other ranks
+    mutable MPI_Win m_hostWindow;     // shared memory segment of m_hostComm
+    mutable char* m_hostSlots;        // one input slot per rank on this host, followed by the result slot
+    mutable int m_hostRank;
+    mutable int m_hostSize;
+    mutable int m_numHosts;
+    static const size_t c_hostSlotBytes = 4 * 1024 * 1024;
+
+    void InitHierarchicalAllReduce() const;
+    void FreeHierarchicalAllReduce() const;
+    void SyncHost() const;
+    template <class ElemType>
+    void HierarchicalAllReduce(ElemType* sendData, ElemType* receiveData, size_t numElements) const;
+
     // MPI_Init() is loading the msmpi.dll. Failing to load the dll will terminate the
     // application.
-    int MPI_Init_DL();
+    int MPI_Init_DL(bool concurrentCalls);
 
     // Workaround for the issue with MPI hanging when we have non-0 exit codes from CNTK processes
     // OpenMPI has a confirmed race condition on killing child process vs. handling their non-zero exit statuses, resulting
@@ -49,7 +68,7 @@ class MPIWrapperMpi : public MPIWrapper
     static void MPIWorkaroundAtExit();
 
 public:
-    MPIWrapperMpi();
+    MPIWrapperMpi(bool concurrentCalls);
 
     // Note: we don't clear the sub-communication here although we should, because in case of a crash, this prevents the EXE from terminating.
     // It's OK since this class is a singleton anyway that gets instantiated exactly once at program startup.
@@ -75,6 +94,11 @@ public:
     // Use GPUDirect RDMA support
     virtual bool UseGpuGdr() override;
 
+    virtual bool SupportsConcurrentCalls() const override;
+
+    virtual void SetUseHierarchicalAllReduce(bool enable) override;
+    virtual bool UseHierarchicalAllReduce() const override;
+
     // -----------------------------------------------------------------------
     // data-exchange functions (wrappers around MPI functions)
     // -----------------------------------------------------------------------
@@ -172,6 +196,11 @@ public:
     // Use GPUDirect RDMA
     virtual bool UseGpuGdr() override;
 
+    virtual bool SupportsConcurrentCalls() const override;
+
+    virtual void SetUseHierarchicalAllReduce(bool enable) override;
+    virtual bool UseHierarchicalAllReduce() const override;
+
     // -----------------------------------------------------------------------
     // data-exchange functions (wrappers around MPI functions)
     // -----------------------------------------------------------------------
@@ -259,10 +288,10 @@ public:
 //       empty stubs.
 // -----------------------------------------------------------------------
 
-extern "C" void GetMpiWrapper(MPIWrapper **mpi)
+extern "C" void GetMpiWrapper(MPIWrapper **mpi, bool concurrentCalls)
 {
 #if HAS_MPI
-    *mpi = new MPIWrapperMpi();
+    *mpi = new MPIWrapperMpi(concurrentCalls);
 #else
     *mpi = new MPIWrapperEmpty();
 #endif
@@ -311,7 +340,7 @@ int operator||(int rc, const MpiFail &what)
 //       to make this threadsafe, remove the "create" parameter,
 //       replace the s_mpi init with a run-once statement (or guard it with a mutex),
 //       and remove the DeleteInstance() function.
-MPIWrapperPtr MPIWrapper::GetInstance(bool create)
+MPIWrapperPtr MPIWrapper::GetInstance(bool create, bool concurrentCalls)
 {
     if (create)
     {
@@ -322,7 +351,7 @@ MPIWrapperPtr MPIWrapper::GetInstance(bool create)
             MPIWrapper *mpi = nullptr;
 
             // retrieves the raw pointer
-            GetMpiWrapper(&mpi);
+            GetMpiWrapper(&mpi, concurrentCalls);
             if (mpi == nullptr)
                 LogicError("Creating MPIWrapper failed to retrieve instance!");
 
@@ -372,8 +401,17 @@ MPI_Datatype MPIWrapper::GetDataType(size_t *)
 
 int MPIWrapperMpi::s_myRank = -1;
 
-MPIWrapperMpi::MPIWrapperMpi()
-    : m_currentComm(MPI_COMM_WORLD)
+MPIWrapperMpi::MPIWrapperMpi(bool concurrentCalls)
+    : m_currentComm(MPI_COMM_WORLD),
+      m_useHierarchicalAllReduce(false),
+      m_hierarchicalAllReduceInitialized(false),
+      m_hostComm(MPI_COMM_NULL),
+      m_leaderComm(MPI_COMM_NULL),
+      m_hostWindow(MPI_WIN_NULL),
+      m_hostSlots(nullptr),
+      m_hostRank(0),
+      m_hostSize(1),
+      m_numHosts(1)
 {
     static bool initialized = false;
     if (initialized)
@@ -387,7 +425,8 @@ MPIWrapperMpi::MPIWrapperMpi()
         fflush(stderr);
     }
 
-    MPI_Init_DL() || MpiFail("mpiaggregator: MPI_Init");
+    MPI_Init_DL(concurrentCalls) || MpiFail("mpiaggregator: MPI_Init");
+    MPI_Query_thread(&m_threadLevelSupport) || MpiFail("mpiaggregator: MPI_Query_thread");
     MPI_Comm_rank(MPI_COMM_WORLD, &m_myRank);
     MPI_Comm_size(MPI_COMM_WORLD, &m_numMPINodes);
     m_numNodesInUse = m_numMPINodes;
@@ -450,7 +489,7 @@ MPIWrapperMpi::~MPIWrapperMpi()
 
 // MPI_Init() is loading the msmpi.dll. Failing to load the dll will terminate the
 // application.
-int MPIWrapperMpi::MPI_Init_DL()
+int MPIWrapperMpi::MPI_Init_DL(bool concurrentCalls)
 {
     // don't initialize if that has been done already
     int flag = 0;
@@ -460,11 +499,13 @@ int MPIWrapperMpi::MPI_Init_DL()
 
     int argc = 0;
     char **argv = NULL;
-    // TODO(qiwye) Multiverso(parameter server) will benefit from MPI_THREAD_MULTIPLE .
+    // Only the built-in parameter server of DataParallelASGD (see ASGDHelper.cpp) calls MPI from a second thread and asks
+    // for MPI_THREAD_MULTIPLE, which can make all MPI calls slower. If the library does not provide it, the parameter
+    // server reports that (see SupportsConcurrentCalls()); everything else works with MPI_THREAD_SERIALIZED.
     int requiredThreadLevelSupport = MPI_THREAD_SERIALIZED;
     int provided;
-    int ret = MPI_Init_thread(&argc, &argv, requiredThreadLevelSupport, &provided);
-    if (provided != requiredThreadLevelSupport)
+    int ret = MPI_Init_thread(&argc, &argv, concurrentCalls ? MPI_THREAD_MULTIPLE : requiredThreadLevelSupport, &provided);
+    if (provided < requiredThreadLevelSupport)
         LogicError("Failed to initialize MPI with the desired level of thread support");
 
     return ret;
@@ -515,6 +556,9 @@ void MPIWrapperMpi::RequestNodes(const char *msg, size_t requestednodes /*defaul
 {
     Ping("requestnodes (before change)");
 
+    // the host and leader communicators of the hierarchical AllReduce() are split from the current one
+    FreeHierarchicalAllReduce();
+
     // undo current split
 #ifdef USE2NDCOMM
     if (m_currentComm != MPI_COMM_WORLD /*no subset*/ && m_currentComm != MPI_COMM_NULL /*idle nodes*/)
@@ -597,6 +641,8 @@ MPI_Comm MPIWrapperMpi::Communicator() const
 
 int MPIWrapperMpi::Finalize(void)
 {
+    FreeHierarchicalAllReduce();
+
     return MPI_Finalize();
 }
 
@@ -667,6 +713,115 @@ bool MPIWrapperMpi::UseGpuGdr()
 #endif
 }
 
+bool MPIWrapperMpi::SupportsConcurrentCalls() const
+{
+    return m_threadLevelSupport == MPI_THREAD_MULTIPLE;
+}
+
+void MPIWrapperMpi::SetUseHierarchicalAllReduce(bool enable)
+{
+    m_useHierarchicalAllReduce = enable;
+}
+
+bool MPIWrapperMpi::UseHierarchicalAllReduce() const
+{
+    return m_useHierarchicalAllReduce;
+}
+
+// Splits the ranks into one communicator per host, plus one among the first rank of every host,
+// and allocates the shared memory segment of this host. This is collective, like the AllReduce() calling it.
+void MPIWrapperMpi::InitHierarchicalAllReduce() const
+{
+    MPI_Comm_split_type(Communicator(), MPI_COMM_TYPE_SHARED, m_myRank, MPI_INFO_NULL, &m_hostComm) || MpiFail("hierarchical allreduce: MPI_Comm_split_type");
+    MPI_Comm_rank(m_hostComm, &m_hostRank) || MpiFail("hierarchical allreduce: MPI_Comm_rank");
+    MPI_Comm_size(m_hostComm, &m_hostSize) || MpiFail("hierarchical allreduce: MPI_Comm_size");
+    MPI_Comm_split(Communicator(), m_hostRank == 0 ? 0 : MPI_UNDEFINED, m_myRank, &m_leaderComm) || MpiFail("hierarchical allreduce: MPI_Comm_split");
+    if (m_leaderComm != MPI_COMM_NULL)
+        MPI_Comm_size(m_leaderComm, &m_numHosts) || MpiFail("hierarchical allreduce: MPI_Comm_size");
+    MPI_Bcast(&m_numHosts, 1, MPI_INT, 0, m_hostComm) || MpiFail("hierarchical allreduce: MPI_Bcast");
+
+    // the first rank of the host allocates all slots, so that they are contiguous
+    char* base;
+    MPI_Aint size = m_hostRank == 0 ? (MPI_Aint)(c_hostSlotBytes * (m_hostSize + 1)) : 0;
+    MPI_Win_allocate_shared(size, 1, MPI_INFO_NULL, m_hostComm, &base, &m_hostWindow) || MpiFail("hierarchical allreduce: MPI_Win_allocate_shared");
+    int dispUnit;
+    MPI_Win_shared_query(m_hostWindow, 0, &size, &dispUnit, &m_hostSlots) || MpiFail("hierarchical allreduce: MPI_Win_shared_query");
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, m_hostWindow) || MpiFail("hierarchical allreduce: MPI_Win_lock_all");
+    m_hierarchicalAllReduceInitialized = true;
+
+    fprintf(stderr, "hierarchical allreduce: %d ranks on this host, %d hosts\n", m_hostSize, m_numHosts);
+    fflush(stderr);
+}
+
+// Frees what InitHierarchicalAllReduce() set up, so that the next call sets it up again. This is collective as well.
+void MPIWrapperMpi::FreeHierarchicalAllReduce() const
+{
+    if (m_hostWindow != MPI_WIN_NULL)
+    {
+        MPI_Win_unlock_all(m_hostWindow);
+        MPI_Win_free(&m_hostWindow);
+    }
+    if (m_leaderComm != MPI_COMM_NULL)
+        MPI_Comm_free(&m_leaderComm);
+    if (m_hostComm != MPI_COMM_NULL)
+        MPI_Comm_free(&m_hostComm);
+    m_hostSlots = nullptr;
+    m_hierarchicalAllReduceInitialized = false;
+}
+
+// makes the writes of every rank on this host to the shared memory segment visible to the others
+void MPIWrapperMpi::SyncHost() const
+{
+    MPI_Win_sync(m_hostWindow) || MpiFail("hierarchical allreduce: MPI_Win_sync");
+    MPI_Barrier(m_hostComm) || MpiFail("hierarchical allreduce: MPI_Barrier");
+    MPI_Win_sync(m_hostWindow) || MpiFail("hierarchical allreduce: MPI_Win_sync");
+}
+
+// Sums the data of all ranks in chunks of one slot. Each rank copies its chunk into its slot, then sums one stripe
+// of the chunk over all slots into the result slot. The first rank of each host reduces the result slot across hosts,
+// and every rank copies it out.
+template <class ElemType>
+void MPIWrapperMpi::HierarchicalAllReduce(ElemType* sendData, ElemType* receiveData, size_t numElements) const
+{
+    if (!m_hierarchicalAllReduceInitialized)
+        InitHierarchicalAllReduce();
+    if (sendData == MPI_IN_PLACE)
+        sendData = receiveData;
+
+    const size_t chunkElements = c_hostSlotBytes / sizeof(ElemType);
+    ElemType* mySlot = reinterpret_cast<ElemType*>(m_hostSlots + c_hostSlotBytes * m_hostRank);
+    ElemType* result = reinterpret_cast<ElemType*>(m_hostSlots + c_hostSlotBytes * m_hostSize);
+    for (size_t chunkBegin = 0; chunkBegin < numElements; chunkBegin += chunkElements)
+    {
+        size_t count = std::min(chunkElements, numElements - chunkBegin);
+        memcpy(mySlot, sendData + chunkBegin, count * sizeof(ElemType));
+        SyncHost();
+
+        const long long stripeBegin = (long long)(count * m_hostRank / m_hostSize);
+        const long long stripeEnd = (long long)(count * (m_hostRank + 1) / m_hostSize);
+#pragma omp parallel for if (stripeEnd - stripeBegin > 65536)
+        for (long long i = stripeBegin; i < stripeEnd; i++)
+        {
+            const ElemType* slot = reinterpret_cast<const ElemType*>(m_hostSlots);
+            ElemType sum = slot[i];
+            for (int r = 1; r < m_hostSize; r++)
+                sum += slot[r * chunkElements + i];
+            result[i] = sum;
+        }
+        SyncHost();
+
+        if (m_numHosts > 1)
+        {
+            if (m_leaderComm != MPI_COMM_NULL)
+                MPI_Allreduce(MPI_IN_PLACE, result, (int)count, GetDataType(result), MPI_SUM, m_leaderComm) || MpiFail("hierarchical allreduce: MPI_Allreduce");
+            SyncHost();
+        }
+
+        // The result slot is not written again before every rank has passed the first SyncHost() of the next chunk.
+        memcpy(receiveData + chunkBegin, result, count * sizeof(ElemType));
+    }
+}
+
 size_t MPIWrapperMpi::NumNodesInUse() const
 {
     return m_numNodesInUse;
@@ -772,11 +927,15 @@ void MPIWrapperMpi::AllReduce(int* sendData, int* receiveData, size_t numElement
 
 void MPIWrapperMpi::AllReduce(double* sendData, double* receiveData, size_t numElements, MPI_Op op) const
 {
+    if (m_useHierarchicalAllReduce && op == MPI_SUM && numElements > 0)
+        return HierarchicalAllReduce(sendData, receiveData, numElements);
     MPI_Allreduce(sendData, receiveData, (int)numElements, GetDataType(sendData), op, Communicator()) || MpiFail("Allreduce: MPI_Allreduce");
 }
 
 void MPIWrapperMpi::AllReduce(float* sendData, float* receiveData, size_t numElements, MPI_Op op) const
 {
+    if (m_useHierarchicalAllReduce && op == MPI_SUM && numElements > 0)
+        return HierarchicalAllReduce(sendData, receiveData, numElements);
     MPI_Allreduce(sendData, receiveData, (int)numElements, GetDataType(sendData), op, Communicator()) || MpiFail("Allreduce: MPI_Allreduce");
 }
 
@@ -978,6 +1137,20 @@ bool MPIWrapperEmpty::UseGpuGdr()
     return false;
 }
 
+bool MPIWrapperEmpty::SupportsConcurrentCalls() const
+{
+    return true;
+}
+
+void MPIWrapperEmpty::SetUseHierarchicalAllReduce(bool enable)
+{
+}
+
+bool MPIWrapperEmpty::UseHierarchicalAllReduce() const
+{
+    return false;
+}
+
 int MPIWrapperEmpty::Finalize(void)
 {
     return MPI_UNDEFINED;
@@ -0,0 +1,162 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
+
+#include "Basics.h"
+#include "CompiledNetworkCache.h"
+#include "File.h"
+#include "fileutil.h"
+#include <cinttypes>
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// version of the cache file format; files of other versions are ignored
+static const size_t s_compiledNetworkCacheVersion = 1;
+
+/*static*/ wstring CompiledNetworkCache::PathOf(const wstring& directory, uint64_t key)
+{
+    char name[64];
+    sprintf(name, "network-%016" PRIx64 ".compiled", key);
+    wstring path = directory;
+    if (!path.empty() && path.back() != L'/' && path.back() != L'\\')
+        path += L'/';
+    return path + msra::strfun::utf16(name);
+}
+
+/*static*/ shared_ptr<CompiledNetworkCache> CompiledNetworkCache::TryLoad(const wstring& directory, uint64_t key)
+{
+    wstring path = PathOf(directory, key);
+    if (!fexists(path))
+        return nullptr;
+
+    try
+    {
+        File fstream(path, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
+        fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BCompiledNetwork");
+        size_t version;
+        uint64_t fileKey;
+        fstream >> version >> fileKey;
+        if (version != s_compiledNetworkCacheVersion || fileKey != key)
+            return nullptr;
+
+        auto cache = make_shared<CompiledNetworkCache>(key);
+
+        size_t numNodes;
+        fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BEvalOrder");
+        fstream >> numNodes;
+        cache->m_evalOrder.resize(numNodes);
+        for (auto& name : cache->m_evalOrder)
+            fstream >> name;
+        fstream.GetMarker(FileMarker::fileMarkerEndSection, L"EEvalOrder");
+
+        size_t numLoops;
+        fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BLoops");
+        fstream >> numLoops;
+        cache->m_loops.resize(numLoops);
+        for (auto& loop : cache->m_loops)
+        {
+            fstream >> loop.m_sourceNodeName >> loop.m_steppingDirection >> numNodes;
+            loop.m_nestedNodeNames.resize(numNodes);
+            for (auto& name : loop.m_nestedNodeNames)
+                fstream >> name;
+        }
+        fstream.GetMarker(FileMarker::fileMarkerEndSection, L"ELoops");
+
+        fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BNodeStates");
+        fstream >> numNodes;
+        for (size_t i = 0; i < numNodes; i++)
+        {
+            wstring name;
+            NodeState state;
+            fstream >> name;
+            state.m_sampleLayout.Load(fstream);
+            fstream >> state.m_hasMBLayout >> state.m_needsGradient;
+            cache->m_nodeStates[name] = state;
+        }
+        fstream.GetMarker(FileMarker::fileMarkerEndSection, L"ENodeStates");
+
+        size_t numPlans;
+        fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BMemoryPlans");
+        fstream >> numPlans;
+        for (size_t i = 0; i < numPlans; i++)
+        {
+            uint64_t requestsHash;
+            size_t numRequests;
+            fstream >> requestsHash >> numRequests;
+            auto& plan = cache->m_memoryPlans[requestsHash];
+            plan.resize(numRequests);
+            for (auto& memoryId : plan)
+                fstream >> memoryId;
+        }
+        fstream.GetMarker(FileMarker::fileMarkerEndSection, L"EMemoryPlans");
+
+        fstream.GetMarker(FileMarker::fileMarkerEndSection, L"ECompiledNetwork");
+        return cache;
+    }
+    catch (const exception& e)
+    {
+        // a damaged cache file only costs the time to recompute it
+        fprintf(stderr, "CompiledNetworkCache: ignoring unreadable cache file '%ls': %s\n", path.c_str(), e.what());
+        return nullptr;
+    }
+}
+
+void CompiledNetworkCache::Save(const wstring& directory) const
+{
+    wstring path = PathOf(directory, m_key);
+    msra::files::make_intermediate_dirs(path);
+
+    // Processes with the same network may write at the same time. Each writes its own temporary file, and the last rename wins.
+    wstring tmpPath = path + L".tmp" + to_wstring(GetCurrentProcessId());
+    {
+        File fstream(tmpPath, FileOptions::fileOptionsBinary | FileOptions::fileOptionsWrite);
+        fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BCompiledNetwork");
+        fstream << s_compiledNetworkCacheVersion << m_key;
+
+        fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BEvalOrder");
+        fstream << m_evalOrder.size();
+        for (const auto& name : m_evalOrder)
+            fstream << name;
+        fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EEvalOrder");
+
+        fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BLoops");
+        fstream << m_loops.size();
+        for (const auto& loop : m_loops)
+        {
+            fstream << loop.m_sourceNodeName << loop.m_steppingDirection << loop.m_nestedNodeNames.size();
+            for (const auto& name : loop.m_nestedNodeNames)
+                fstream << name;
+        }
+        fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ELoops");
+
+        fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BNodeStates");
+        fstream << m_nodeStates.size();
+        for (const auto& iter : m_nodeStates)
+        {
+            fstream << iter.first;
+            iter.second.m_sampleLayout.Save(fstream);
+            fstream << iter.second.m_hasMBLayout << iter.second.m_needsGradient;
+        }
+        fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ENodeStates");
+
+        fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BMemoryPlans");
+        fstream << m_memoryPlans.size();
+        for (const auto& iter : m_memoryPlans)
+        {
+            fstream << iter.first << iter.second.size();
+            for (auto memoryId : iter.second)
+                fstream << memoryId;
+        }
+        fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EMemoryPlans");
+
+        fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ECompiledNetwork");
+    }
+    renameOrDie(tmpPath, path);
+}
+
+}}}
@@ -0,0 +1,86 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "TensorShape.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// ===========================================================================
+// CompiledNetworkCache -- results of ComputationNetwork::CompileNetwork() and AllocateAllMatrices(), persisted across processes
+//
+// For networks with many nodes, loop analysis, the validation passes and the memory-sharing optimization dominate startup,
+// and every worker and every evaluation process repeats them for the same model. The cache file stores
+//  - the loop-corrected global evaluation order and the recurrent loops (restored instead of running FormRecurrentLoops())
+//  - the validated sample layout of every node (lets ValidateNetwork() stop as soon as all nodes have reached it)
+//  - the buffer assignments of MatrixPool::OptimizedMemoryAllocation() for every set of requests seen so far
+// The file name is derived from a hash of the network structure and the shapes of its leaves (see ComputationNetwork::GetCompiledNetworkCacheKey()).
+// Memory plans are keyed by a hash of the requests themselves, so any change of the requests simply misses.
+// The cache is enabled by Globals::SetCompiledNetworkCacheDirectory(), i.e. the 'compiledNetworkCacheDir' config parameter.
+// ===========================================================================
+
+class CompiledNetworkCache
+{
+public:
+    struct Loop
+    {
+        std::wstring m_sourceNodeName;
+        int m_steppingDirection;
+        std::vector<std::wstring> m_nestedNodeNames; // in loop order
+    };
+
+    struct NodeState
+    {
+        TensorShape m_sampleLayout;
+        bool m_hasMBLayout;
+        bool m_needsGradient;
+
+        bool operator==(const NodeState& other) const
+        {
+            return m_sampleLayout == other.m_sampleLayout && m_hasMBLayout == other.m_hasMBLayout && m_needsGradient == other.m_needsGradient;
+        }
+    };
+
+    CompiledNetworkCache(uint64_t key)
+        : m_key(key)
+    {
+    }
+
+    uint64_t Key() const { return m_key; }
+
+    // path of the cache file for 'key' in 'directory'
+    static std::wstring PathOf(const std::wstring& directory, uint64_t key);
+
+    // returns nullptr if there is no cache file for 'key', or it is unreadable or of another version
+    static std::shared_ptr<CompiledNetworkCache> TryLoad(const std::wstring& directory, uint64_t key);
+
+    // writes into a temporary file first, so that concurrent processes never see a partial file
+    void Save(const std::wstring& directory) const;
+
+    // returns nullptr if there is no plan for these requests
+    const std::vector<int>* FindMemoryPlan(uint64_t requestsHash) const
+    {
+        auto iter = m_memoryPlans.find(requestsHash);
+        return iter != m_memoryPlans.end() ? &iter->second : nullptr;
+    }
+
+public:
+    std::vector<std::wstring> m_evalOrder; // global evaluation order after FormRecurrentLoops()
+    std::vector<Loop> m_loops;             // [loopId]
+    std::map<std::wstring, NodeState> m_nodeStates;
+    std::map<uint64_t, std::vector<int>> m_memoryPlans; // [hash of the requests] -> memory id of every request
+
+private:
+    uint64_t m_key;
+};
+
+}}}
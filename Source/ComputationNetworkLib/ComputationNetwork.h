@@ -13,6 +13,7 @@
 #include "ComputationNode.h"
 #include "ScriptableObjects.h"
 #include "ComputationEnvironment.h"
+#include "CompiledNetworkCache.h"
 
 #include <map>
 #include <string>
@@ -29,6 +30,10 @@
 #include <chrono>
 #include <unordered_map>
 #include <set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -51,6 +56,7 @@ public:
     ComputationNetwork() :
         m_randomSeedOffset(0),
         m_isCompiled(false),
+        m_isCompiledFromCache(false),
         m_areMatricesAllocated(false),
         m_pMBLayoutOfNetwork(make_shared<MBLayout>(1, 0, ComputationNodeBase::DefaultDynamicAxisName)),
         m_environment(make_shared<ComputationEnvironment>())
@@ -154,6 +160,7 @@ public:
 
         combinedEvalOrder = SortByGlobalEvalOrder(combinedEvalOrder);
         set<ComputationNodeBasePtr> completedSEQNodes;
+        std::vector<ComputationNodeBasePtr> flowControlOrder;
         for (auto& node : combinedEvalOrder)
         {
             if (node->IsPartOfLoop())
@@ -161,14 +168,14 @@ public:
                 shared_ptr<SEQTraversalFlowControlNode> recInfo = FindInRecurrentLoops(m_allSEQNodes, node);
                 assert(recInfo != nullptr);
                 if (completedSEQNodes.insert(recInfo).second)
-                    node = recInfo;
-                else
-                    node = nullptr;
+                    flowControlOrder.push_back(recInfo);
             }
-
-            if (node)
-                action(node);
+            else
+                flowControlOrder.push_back(node);
         }
+
+        for (auto& node : ApplyWavefronts(m_allWavefronts, move(flowControlOrder)))
+            action(node);
     }
 
     template <class NODESET> // version that takes multiple nodes
@@ -246,6 +253,7 @@ private:
     size_t ValidateNodes(list<ComputationNodeBasePtr> nodes, bool isFirstPass, bool isFinalValidationPass);
     bool ValidateNode(ComputationNodeBasePtr node, bool isFinalValidationPass) const;
     void MarkValueNonSharableNodes();
+    void MarkSharedReducedPrecisionWeights();
     void ChangeNodeInputs(ComputationNodeBasePtr fromNode, ComputationNodeBasePtr toNode);
 
 private:
@@ -256,7 +264,19 @@ private:
     bool IsCompiled() const { return m_isCompiled; }
     bool AreMatricesAllocated() const { return m_areMatricesAllocated; }
     void VerifyIsCompiled(const char* where) const;
+
+    // compiled-network cache, see CompiledNetworkCache.h
+    void LookUpCompiledNetworkCache();
+    bool RestoreRecurrentLoops(const CompiledNetworkCache& cache);
+    bool HasReachedCachedState(const ComputationNodeBasePtr& node) const;
+    void UpdateCompiledNetworkCache();
+    void SaveCompiledNetworkCache() const;
 public:
+    // identifies the network structure and the shapes of inputs and parameters, i.e. everything the results of CompileNetwork() depend on
+    uint64_t GetCompiledNetworkCacheKey() const;
+    // true if the last CompileNetwork() restored its results from a cache file
+    bool IsCompiledFromCache() const { return m_isCompiledFromCache; }
+
     void AllocateAllMatrices(const std::vector<ComputationNodeBasePtr>& evalRootNodes, const std::vector<ComputationNodeBasePtr>& outValueRootNodes, ComputationNodeBasePtr trainRootNode);
 
     // From the set of nodes extract all nodes which are used as accumulator nodes.
@@ -285,6 +305,8 @@ private:
     void DetermineLoopForwardOrderR(std::unordered_set<ComputationNodeBasePtr>& visited, std::unordered_set<ComputationNodeBasePtr>& recStack, std::list<ComputationNodeBasePtr>& nodesStack, ComputationNodeBasePtr cur);
     void GatherLoopNodesR(const ComputationNodeBasePtr& rootNode, std::unordered_set<ComputationNodeBasePtr>& visited, std::map<int, std::list<ComputationNodeBasePtr>>& recurrentResult, std::list<ComputationNodeBasePtr>& noRecurrentResult);
     void ReorderLoops(std::list<ComputationNodeBasePtr>& nodes, const std::map<int, std::list<ComputationNodeBasePtr>>& /*recurrentNodes*/, const std::list<ComputationNodeBasePtr>& /*noRecurrentNodes*/);
+    // This groups stacked loops into WavefrontFlowControlNodes. It needs the MBLayouts, and is therefore called after validation.
+    void FormWavefronts();
 
 public:
     // -----------------------------------------------------------------------
@@ -375,9 +397,12 @@ public:
 
 protected:
     class SEQTraversalFlowControlNode;
+    class WavefrontFlowControlNode;
 
 private:
     static std::shared_ptr<SEQTraversalFlowControlNode> FindInRecurrentLoops(const std::vector<std::shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const ComputationNodeBasePtr& node);
+    static std::shared_ptr<WavefrontFlowControlNode> FindInWavefronts(const std::vector<std::shared_ptr<WavefrontFlowControlNode>>& wavefronts, const ComputationNodeBasePtr& node);
+    static std::vector<ComputationNodeBasePtr> ApplyWavefronts(const std::vector<std::shared_ptr<WavefrontFlowControlNode>>& wavefronts, std::vector<ComputationNodeBasePtr> flowControlOrder);
 
 public:
     // -----------------------------------------------------------------------
@@ -1212,6 +1237,100 @@ protected:
         // Base::m_nestedNodes contains all top-level nodes, in evaluation order
     };
 
+    // -----------------------------------------------------------------------
+    // WavefrontFlowControlNode -- FlowControlNode to traverse stacked recurrent loops as a wavefront
+    //
+    // A chain of recurrent loops (stages) with the same time axis and stepping
+    // direction, where each loop consumes the ones before it frame by frame,
+    // possibly through non-recurrent nodes between them. Those are computed
+    // frame by frame as part of the stage that follows them.
+    // Each stage runs on its own thread and follows the stage before it by one
+    // time step, so that stage k computes step t while stage k-1 computes step t+1.
+    // The threads are kept for the lifetime of the node and wait for the next minibatch in between.
+    // Backprop runs the stages in the reverse order, with a distance that
+    // keeps the frames into which the delay nodes of a stage propagate apart
+    // from those of the stage before it. Gradients into nodes outside of the
+    // wavefront are propagated afterwards, for all frames at once.
+    // Formed only for the CPU, if Globals::ShouldPipelineRecurrentLoops().
+    // -----------------------------------------------------------------------
+
+    class WavefrontFlowControlNode : public FlowControlNode
+    {
+    public: // m_nestedNodes needed public by ComputationNetwork::FindInWavefronts()
+        typedef FlowControlNode Base;
+        using Base::m_nestedNodes;
+
+    public:
+        virtual const std::wstring OperationName() const override
+        {
+            return L"WavefrontFlowControlNode";
+        }
+        virtual void BeginForwardProp() override;
+        virtual void ForwardProp(const FrameRange&) override;
+        virtual void EndForwardProp() override;
+        virtual void PostForwardAndBackProp() override;
+        virtual void BeginBackprop() override;
+        virtual void BackpropTo(const size_t inputIndex, const FrameRange&) override
+        {
+            NOT_IMPLEMENTED;
+        }
+        virtual void EndBackprop() override;
+        virtual void Backprop(const FrameRange& fr, bool childrenInThisLoop, bool childrenInOuterLoop) override;
+        virtual void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool);
+        virtual void ReleaseMatricesAfterForwardProp(MatrixPool& matrixPool);
+        virtual void AllocateGradientMatricesForInputs(MatrixPool& matrixPool);
+        virtual void RequestMatricesBeforeBackprop(MatrixPool& matrixPool);
+        virtual void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool);
+        virtual bool IsOutOfDateWrtInputs() const override;
+
+        // Appends a stage. 'nodesBefore' are the non-recurrent nodes between the previous loop and this one.
+        void AddStage(const std::vector<ComputationNodeBasePtr>& nodesBefore, const shared_ptr<SEQTraversalFlowControlNode>& loop);
+        size_t GetNumStages() const
+        {
+            return m_stages.size();
+        }
+        bool IsMember(const ComputationNodeBase* node) const
+        {
+            return m_members.find(node) != m_members.end();
+        }
+        // the nodes of all stages, in evaluation order
+        std::vector<ComputationNodeBasePtr> GetStageNodes() const;
+
+    private:
+        // Runs all stages over all time steps, stage s on thread s. For backprop, in reverse.
+        void RunStages(bool backprop);
+
+        // Runs job(s) for every stage s on the worker thread of the stage, and waits for all of them.
+        void RunOnWorkers(const std::function<void(size_t)>& job);
+        // Body of the worker thread of stage s, which waits for the jobs after the first 'jobsDone' ones.
+        void RunWorker(size_t s, size_t jobsDone);
+
+        struct Stage
+        {
+            shared_ptr<SEQTraversalFlowControlNode> m_loop;
+            std::vector<ComputationNodeBasePtr> m_nodesBefore; // non-recurrent nodes computed frame by frame before the loop
+            std::vector<ComputationNodeBasePtr> m_nodes;       // m_nodesBefore followed by the nodes of m_loop, in evaluation order
+        };
+        std::vector<Stage> m_stages;
+        std::unordered_set<const ComputationNodeBase*> m_members; // all nodes in m_stages[].m_nodes
+        int m_maxTimeStep;                                        // largest time step of the delay nodes in the loops
+
+        // worker threads, one per stage, started by the first RunStages()
+        std::vector<std::thread> m_workers;
+        std::mutex m_workersMutex;
+        std::condition_variable m_jobStarted;
+        std::condition_variable m_jobDone;
+        const std::function<void(size_t)>* m_job; // the job of the current RunOnWorkers() call
+        size_t m_jobNumber;                       // incremented for every job, so that a worker runs each job once
+        size_t m_numWorkersRunning;
+        bool m_stopWorkers;
+
+    public:
+        // Base::m_nestedNodes contains the SEQTraversalFlowControlNodes and the non-recurrent nodes of all stages, in evaluation order
+        WavefrontFlowControlNode(const shared_ptr<SEQTraversalFlowControlNode>& firstLoop);
+        ~WavefrontFlowControlNode();
+    };
+
 public:
     // -----------------------------------------------------------------------
     // data members
@@ -1266,10 +1385,13 @@ private:
     std::vector<ComputationNodeBasePtr> m_allRoots;
 
     std::vector<std::shared_ptr<SEQTraversalFlowControlNode>> m_allSEQNodes; // [loopId] cached set of SEQTraversalFlowControlNodes to allow sharing and idempotence of FormRecurrentLoops()
+    std::vector<std::shared_ptr<WavefrontFlowControlNode>> m_allWavefronts;  // stacked loops that are traversed as a wavefront, see FormWavefronts()
 
     // cache for evaluation ordering:
     bool m_isCompiled; // CompileNetwork has been called
+    bool m_isCompiledFromCache; // CompileNetwork restored loops and shapes from m_compiledNetworkCache
     bool m_areMatricesAllocated; // AllocateAllMatrices has been called
+    std::shared_ptr<CompiledNetworkCache> m_compiledNetworkCache; // nullptr unless Globals::GetCompiledNetworkCacheDirectory() is set
 
     // cached network iterations
     std::map<const ComputationNodeBasePtr, std::list<ComputationNodeBasePtr>> m_evalOrders; // [out node] flat depth-first traversal starting from out node
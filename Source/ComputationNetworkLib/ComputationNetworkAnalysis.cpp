@@ -9,6 +9,11 @@
 #include "ComputationNode.h"
 #include "ComputationNetwork.h"
 #include "RecurrentNodes.h"
+#include "LinearAlgebraNodes.h"
+#include "NonlinearityNodes.h"
+#include "ReshapingNodes.h"
+#include "TrainingNodes.h"
+#include "Globals.h"
 #include <string>
 #include <set>
 
@@ -475,4 +480,167 @@ static int DetermineLoopDirection(const std::vector<ComputationNodeBasePtr>& nes
     return steppingDirection;
 }
 
+
+// -----------------------------------------------------------------------
+// wavefronts of stacked loops
+// -----------------------------------------------------------------------
+
+// checks whether a non-recurrent node between two stacked loops can be computed frame by frame as part of a wavefront
+// Dropout keeps its mask per column, and draws the mask of an element from the position of the element in the minibatch,
+// so computing it frame by frame in time order gives the same mask as computing it for the whole minibatch at once.
+static bool CanComputeFrameByFrame(const ComputationNodeBasePtr& node, int steppingDirection)
+{
+    static const set<wstring> operations =
+    {
+        OperationNameOf(PlusNode), OperationNameOf(MinusNode), OperationNameOf(ElementTimesNode), OperationNameOf(TimesNode),
+        OperationNameOf(SigmoidNode), OperationNameOf(TanhNode), OperationNameOf(RectifiedLinearNode), OperationNameOf(ExpNode),
+        OperationNameOf(SliceNode), OperationNameOf(RowStackNode)
+    };
+    if (node->Is<IRecurrentNode>())
+        return false;
+    // Dropout draws its mask from the random stream in the order the frames are computed. That order only matches
+    // the one of the whole minibatch when the loops step forward in time.
+    if (node->OperationName() == OperationNameOf(DropoutNode))
+        return steppingDirection > 0;
+    return operations.find(node->OperationName()) != operations.end();
+}
+
+static bool CanRunOnOwnThread(const vector<ComputationNodeBasePtr>& nodes)
+{
+    for (auto& node : nodes)
+    {
+        if (node->GetDeviceId() != CPUDEVICE || !node->HasMBLayout())
+            return false;
+    }
+    return true;
+}
+
+// FormWavefronts() -- group chains of stacked loops (e.g. the layers of a deep LSTM) into WavefrontFlowControlNodes,
+// which run the loops concurrently, each one a time step behind the one before it.
+// A chain starts with a loop and follows the global evaluation order. Loops that use the chain join it if they have the same
+// time axis and stepping direction. Non-recurrent nodes that use the chain are computed frame by frame as part of the next loop that
+// needs them, if they are simple enough (CanComputeFrameByFrame()). All other nodes that use the chain must be computed after it,
+// and so must anything that uses those.
+// The resulting wavefronts are patched into the nested networks (see ApplyWavefronts()).
+// Only used on the CPU, where the loops of typical models are too small to keep all cores busy.
+void ComputationNetwork::FormWavefronts()
+{
+    if (!Globals::ShouldPipelineRecurrentLoops() || m_allSEQNodes.size() < 2)
+        return;
+
+    // the global evaluation order, with loops as single entries
+    vector<ComputationNodeBasePtr> flowControlOrder;
+    set<ComputationNodeBasePtr> loopsSeen;
+    for (auto& node : GetEvalOrder(nullptr))
+    {
+        if (!node->IsPartOfLoop())
+            flowControlOrder.push_back(node);
+        else
+        {
+            auto loop = FindInRecurrentLoops(m_allSEQNodes, node);
+            if (loopsSeen.insert(loop).second)
+                flowControlOrder.push_back(loop);
+        }
+    }
+
+    set<ComputationNodeBasePtr> loopsInWavefronts;
+    for (size_t i = 0; i < flowControlOrder.size(); i++)
+    {
+        auto firstLoop = dynamic_pointer_cast<SEQTraversalFlowControlNode>(flowControlOrder[i]);
+        if (!firstLoop || loopsInWavefronts.find(firstLoop) != loopsInWavefronts.end() || !CanRunOnOwnThread(firstLoop->m_nestedNodes))
+            continue;
+
+        auto wavefront = make_shared<WavefrontFlowControlNode>(firstLoop);
+        vector<ComputationNodeBasePtr> pending;                // nodes to be computed frame by frame, once a loop needs them
+        unordered_set<const ComputationNodeBase*> pendingSet;  // same as a set
+        unordered_set<const ComputationNodeBase*> nodesAfter;  // nodes that must be computed after the wavefront
+        vector<wstring> loopNames(1, firstLoop->NodeName());
+        for (size_t j = i + 1; j < flowControlOrder.size(); j++)
+        {
+            const auto& entry = flowControlOrder[j];
+            auto loop = dynamic_pointer_cast<SEQTraversalFlowControlNode>(entry);
+            const vector<ComputationNodeBasePtr> nodes = loop ? loop->m_nestedNodes : vector<ComputationNodeBasePtr>(1, entry);
+
+            bool usesWavefront = false, usesNodesAfter = false;
+            for (auto& node : nodes)
+            {
+                for (auto& input : node->GetInputs())
+                {
+                    usesWavefront |= wavefront->IsMember(input.get()) || pendingSet.find(input.get()) != pendingSet.end();
+                    usesNodesAfter |= nodesAfter.find(input.get()) != nodesAfter.end();
+                }
+            }
+            if (!usesWavefront && !usesNodesAfter) // computed before the wavefront
+                continue;
+
+            if (!usesNodesAfter && loop && loopsInWavefronts.find(loop) == loopsInWavefronts.end() &&
+                loop->GetMBLayout() == firstLoop->GetMBLayout() && loop->m_steppingDirection == firstLoop->m_steppingDirection &&
+                CanRunOnOwnThread(loop->m_nestedNodes))
+            {
+                // the pending nodes that the loop needs become part of its stage (traverse backwards, so that inputs are found after their users)
+                unordered_set<const ComputationNodeBase*> needed;
+                auto markInputs = [&](const ComputationNodeBasePtr& node)
+                {
+                    for (auto& input : node->GetInputs())
+                    {
+                        if (pendingSet.find(input.get()) != pendingSet.end())
+                            needed.insert(input.get());
+                    }
+                };
+                for (auto& node : nodes)
+                    markInputs(node);
+                vector<ComputationNodeBasePtr> nodesBefore, stillPending;
+                for (auto nodeIter = pending.rbegin(); nodeIter != pending.rend(); nodeIter++)
+                {
+                    if (needed.find(nodeIter->get()) != needed.end())
+                    {
+                        markInputs(*nodeIter);
+                        nodesBefore.insert(nodesBefore.begin(), *nodeIter);
+                        pendingSet.erase(nodeIter->get());
+                    }
+                    else
+                        stillPending.insert(stillPending.begin(), *nodeIter);
+                }
+                pending = move(stillPending);
+
+                wavefront->AddStage(nodesBefore, loop);
+                loopNames.push_back(loop->NodeName());
+            }
+            else if (!usesNodesAfter && !loop && CanComputeFrameByFrame(entry, firstLoop->m_steppingDirection) && entry->GetMBLayout() == firstLoop->GetMBLayout() && CanRunOnOwnThread(nodes))
+            {
+                pending.push_back(entry);
+                pendingSet.insert(entry.get());
+            }
+            else
+            {
+                for (auto& node : nodes)
+                    nodesAfter.insert(node.get());
+            }
+        }
+
+        if (wavefront->GetNumStages() < 2)
+            continue;
+        for (auto& loop : wavefront->m_nestedNodes)
+        {
+            if (loop->Is<SEQTraversalFlowControlNode>())
+                loopsInWavefronts.insert(loop);
+        }
+        m_allWavefronts.push_back(wavefront);
+
+        if (TraceLevel() > 0)
+        {
+            fprintf(stderr, "\n%ls --> %d loops\n", wavefront->NodeName().c_str(), (int)loopNames.size());
+            for (auto& name : loopNames)
+                fprintf(stderr, "\t%ls", name.c_str());
+            fprintf(stderr, "\n");
+        }
+    }
+
+    for (auto& iter : m_nestedNetworks)
+    {
+        auto& nestedNodes = iter.second->As<FlowControlNode>()->m_nestedNodes;
+        nestedNodes = ApplyWavefronts(m_allWavefronts, move(nestedNodes));
+    }
+}
+
 }}}
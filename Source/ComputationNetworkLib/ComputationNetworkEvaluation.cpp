@@ -11,12 +11,22 @@
 #include "RecurrentNodes.h"
 #include "InputAndParamNodes.h"
 #include "LinearAlgebraNodes.h"
+#include "CompiledNetworkCache.h"
+#include "Globals.h"
+#include "PerformanceProfiler.h"
 #include <string>
 #include <vector>
 #include <list>
 #include <set>
 #include <algorithm>
 #include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
@@ -113,6 +123,37 @@ ComputationNodeBasePtr ComputationNetwork::GetNestedNetwork(const ComputationNod
 
 template<class ElemType> static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient);
 
+// Times the forward or backward computation of a node, if node profiling is on (profilerNodes=true).
+// The time of a loop is only shown on the timeline; the summary report has the time of the nodes inside it.
+// Events of the nodes inside a loop are not recorded for every time step (event=false), they would fill up the event buffer.
+class ScopeNodeProfile
+{
+public:
+    ScopeNodeProfile(const ComputationNodeBasePtr& node, bool backward, bool event = true)
+#ifndef CNTK_UWP
+        : m_node(ProfilerNodesEnabled() ? node.get() : nullptr), m_backward(backward), m_event(event)
+    {
+        if (m_node)
+            m_state = ProfilerNodeTimeBegin();
+    }
+
+    ~ScopeNodeProfile()
+    {
+        if (m_node)
+            ProfilerNodeTimeEnd(m_state, m_node->NodeName(), m_node->OperationName(), m_backward, /*summary=*/!dynamic_cast<FlowControlNode*>(m_node), m_event);
+    }
+
+private:
+    ComputationNodeBase* m_node;
+    bool m_backward;
+    bool m_event;
+    ProfilerNodeState m_state;
+#else
+    {
+    }
+#endif
+};
+
 ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(const std::vector<shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const std::list<ComputationNodeBasePtr>& allNodes /*must be in eval order*/)
 {
     // traverse the network in evaluation order and create a new list that replaces all recurrence by a SEQTraversalFlowControlNode
@@ -144,9 +185,12 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
 {
     if (node->IsOutOfDateWrtInputs())
     {
-        node->BeginForwardProp();
-        node->ForwardProp(fr.WithLayout(node->GetMBLayout()));
-        node->EndForwardProp();
+        {
+            ScopeNodeProfile profile(node, /*backward=*/false);
+            node->BeginForwardProp();
+            node->ForwardProp(fr.WithLayout(node->GetMBLayout()));
+            node->EndForwardProp();
+        }
 
         node->BumpEvalTimeStamp();
 
@@ -182,9 +226,12 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
     {
         auto& node = *pnode;
 
-        node->BeginBackprop();
-        node->Backprop(fr.WithLayout(node->GetMBLayout()), true /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
-        node->EndBackprop();
+        {
+            ScopeNodeProfile profile(node, /*backward=*/true);
+            node->BeginBackprop();
+            node->Backprop(fr.WithLayout(node->GetMBLayout()), true /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
+            node->EndBackprop();
+        }
 
         // Extreme Tracing, part 2/4
         if (node->HasEnvironmentPtr() && node->Environment().ShouldDumpNode() && node->NeedsGradient())
@@ -270,7 +317,10 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
     {
         for (auto& node : m_nestedNodes)
         {
-            node->ForwardProp(t);
+            {
+                ScopeNodeProfile profile(node, /*backward=*/false, /*event=*/false);
+                node->ForwardProp(t);
+            }
             node->BumpEvalTimeStamp();
         }
     }
@@ -310,6 +360,7 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
         for (auto nodeIter2 = recurrentNodes.rbegin(); nodeIter2 != recurrentNodes.rend(); ++nodeIter2)
         {
             auto& node2 = *nodeIter2;
+            ScopeNodeProfile profile(node2, /*backward=*/true, /*event=*/false);
             node2->Backprop(t, true /*childrenInThisLoop*/, false /*childrenInOuterLoop*/);
             // The above flags tell Backprop() to skip back-propagation from inside a node into
             // a node that is outside the loop, which is done later in EndBackprop() in PAR mode.
@@ -334,6 +385,7 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
     for (auto nodeIter2 = m_nestedNodes.rbegin(); nodeIter2 != m_nestedNodes.rend(); ++nodeIter2)
     {
         auto& node2 = *nodeIter2;
+        ScopeNodeProfile profile(node2, /*backward=*/true, /*event=*/false);
         node2->Backprop(FrameRange(m_nestedNodes[0]->GetMBLayout()), false /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
     }
 
@@ -401,6 +453,430 @@ bool ComputationNetwork::SEQTraversalFlowControlNode::IsOutOfDateWrtInputs() con
     return false;
 }
 
+// -----------------------------------------------------------------------
+// WavefrontFlowControlNode methods -- implements wavefront traversal of stacked loops
+//
+// The loops (stages) are unrolled like in SEQ mode, but each one on its own
+// thread. A stage computes a time step once the stage before it has computed
+// that step, so that all stages are busy at the same time, on different steps.
+// -----------------------------------------------------------------------
+
+ComputationNetwork::WavefrontFlowControlNode::WavefrontFlowControlNode(const shared_ptr<SEQTraversalFlowControlNode>& firstLoop)
+    : m_maxTimeStep(0), m_job(nullptr), m_jobNumber(0), m_numWorkersRunning(0), m_stopWorkers(false)
+{
+    SetNodeName(L"Wavefront[" + firstLoop->NodeName() + L"]");
+    LinkToMBLayout(firstLoop->GetMBLayout());
+    AddStage(vector<ComputationNodeBasePtr>(), firstLoop);
+}
+
+ComputationNetwork::WavefrontFlowControlNode::~WavefrontFlowControlNode()
+{
+    {
+        lock_guard<std::mutex> lock(m_workersMutex);
+        m_stopWorkers = true;
+    }
+    m_jobStarted.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+void ComputationNetwork::WavefrontFlowControlNode::AddStage(const vector<ComputationNodeBasePtr>& nodesBefore, const shared_ptr<SEQTraversalFlowControlNode>& loop)
+{
+    Stage stage;
+    stage.m_loop = loop;
+    stage.m_nodesBefore = nodesBefore;
+    stage.m_nodes = nodesBefore;
+    stage.m_nodes.insert(stage.m_nodes.end(), loop->m_nestedNodes.begin(), loop->m_nestedNodes.end());
+    for (auto& node : stage.m_nodes)
+    {
+        m_members.insert(node.get());
+        if (node->NeedsGradient())
+            m_needsGradient = true;
+        if (node->Is<IRecurrentNode>())
+            m_maxTimeStep = max(m_maxTimeStep, abs(node->As<IRecurrentNode>()->GetRecurrenceTimeStep()));
+    }
+
+    m_nestedNodes.insert(m_nestedNodes.end(), nodesBefore.begin(), nodesBefore.end());
+    m_nestedNodes.push_back(loop);
+    m_stages.push_back(move(stage));
+}
+
+vector<ComputationNodeBasePtr> ComputationNetwork::WavefrontFlowControlNode::GetStageNodes() const
+{
+    vector<ComputationNodeBasePtr> nodes;
+    for (auto& stage : m_stages)
+        nodes.insert(nodes.end(), stage.m_nodes.begin(), stage.m_nodes.end());
+    return nodes;
+}
+
+/*virtual*/ void ComputationNetwork::WavefrontFlowControlNode::BeginForwardProp() /*override*/
+{
+    for (auto& stage : m_stages)
+    {
+        for (auto& node : stage.m_nodesBefore)
+            node->BeginForwardProp();
+        stage.m_loop->BeginForwardProp();
+    }
+}
+
+/*virtual*/ void ComputationNetwork::WavefrontFlowControlNode::ForwardProp(const FrameRange&) /*override*/
+{
+    RunStages(/*backprop=*/false);
+
+    // Extreme Tracing, part 3/4
+    for (auto& stage : m_stages)
+    {
+        for (auto& node : stage.m_nodes)
+        {
+            if (node->HasEnvironmentPtr() && node->Environment().ShouldDumpNode())
+                DumpNode<float>(node, /*dumpGradient=*/false) || DumpNode<double>(node, false);
+        }
+    }
+}
+
+/*virtual*/ void ComputationNetwork::WavefrontFlowControlNode::EndForwardProp() /*override*/
+{
+    for (auto& stage : m_stages)
+    {
+        for (auto& node : stage.m_nodesBefore)
+            node->EndForwardProp();
+        stage.m_loop->EndForwardProp();
+    }
+}
+
+/*virtual*/ void ComputationNetwork::WavefrontFlowControlNode::PostForwardAndBackProp() /*override*/
+{
+    for (auto& stage : m_stages)
+    {
+        for (auto& node : stage.m_nodesBefore)
+            node->PostForwardAndBackProp();
+        stage.m_loop->PostForwardAndBackProp();
+    }
+}
+
+/*virtual*/ void ComputationNetwork::WavefrontFlowControlNode::BeginBackprop() /*override*/
+{
+    for (auto& stage : m_stages)
+    {
+        for (auto& node : stage.m_nodesBefore)
+            node->BeginBackprop();
+        stage.m_loop->BeginBackprop();
+    }
+}
+
+/*virtual*/ void ComputationNetwork::WavefrontFlowControlNode::Backprop(const FrameRange&, bool childrenInThisLoop, bool childrenInOuterLoop) /*override*/
+{
+    childrenInThisLoop, childrenInOuterLoop; // TODO: think through what these mean when coming from PAR mode
+    RunStages(/*backprop=*/true);
+
+    // The stages only propagate into nodes of the wavefront. Like SEQTraversalFlowControlNode::EndBackprop(), we
+    // propagate into all other nodes (e.g. the parameters) afterwards, in PAR mode.
+    FrameRange fr(GetMBLayout());
+    for (auto stage = m_stages.rbegin(); stage != m_stages.rend(); stage++)
+    {
+        for (auto nodeIter = stage->m_nodes.rbegin(); nodeIter != stage->m_nodes.rend(); nodeIter++)
+        {
+            ScopeNodeProfile profile(*nodeIter, /*backward=*/true, /*event=*/false);
+            (*nodeIter)->BackpropToInputs(fr, [this](const ComputationNodeBase* child) { return !IsMember(child); });
+        }
+    }
+
+    // Extreme Tracing, part 4
+    for (auto& stage : m_stages)
+    {
+        for (auto& node : stage.m_nodes)
+        {
+            if (node->HasEnvironmentPtr() && node->Environment().ShouldDumpNode() && node->NeedsGradient())
+                DumpNode<float>(node, /*dumpGradient=*/true) || DumpNode<double>(node, true);
+        }
+    }
+}
+
+// Not SEQTraversalFlowControlNode::EndBackprop(), which would propagate into the nodes outside of the loops a second time.
+/*virtual*/ void ComputationNetwork::WavefrontFlowControlNode::EndBackprop() /*override*/
+{
+    for (auto& stage : m_stages)
+    {
+        for (auto& node : stage.m_nodes)
+            node->EndBackprop();
+    }
+}
+
+void ComputationNetwork::WavefrontFlowControlNode::RunStages(bool backprop)
+{
+    // the time steps, in the order of the forward computation
+    vector<FrameRange> steps;
+    FrameRangeIteration range(GetMBLayout(), m_stages.front().m_loop->m_steppingDirection);
+    for (auto t = range.begin(); t != range.end(); t++)
+        steps.push_back(t);
+    const size_t numSteps = steps.size();
+    const size_t numStages = m_stages.size();
+    if (numSteps == 0)
+        return;
+
+    // The column mask of the layout is created when it is first used, which must not happen concurrently.
+    if (GetMBLayout()->HasGaps())
+        GetMBLayout()->GetColumnsValidityMask(CPUDEVICE);
+
+    // Stage s computes step i once the stage it follows (s-1, or s+1 in backprop) has completed it.
+    // In backprop, the delay nodes of the stage that follows propagate into steps up to m_maxTimeStep further back,
+    // which must not overlap with the steps that are still being propagated into the node before it.
+    const size_t distance = backprop ? (size_t)m_maxTimeStep + 1 : 1;
+    vector<size_t> completedSteps(numStages, 0);
+    vector<exception_ptr> errors(numStages);
+    bool failed = false;
+    std::mutex mutex;
+    condition_variable progress;
+#ifdef _OPENMP
+    const int numThreadsPerStage = max(1, omp_get_max_threads() / (int)numStages); // the stages share the cores
+#endif
+
+    auto runStage = [&](size_t s)
+    {
+#ifdef _OPENMP
+        omp_set_num_threads(numThreadsPerStage);
+#endif
+        const Stage& stage = m_stages[s];
+        const bool isFirst = backprop ? s + 1 == numStages : s == 0;
+        const size_t previous = backprop ? s + 1 : s - 1;
+        try
+        {
+            for (size_t i = 0; i < numSteps; i++)
+            {
+                if (!isFirst)
+                {
+                    unique_lock<std::mutex> lock(mutex);
+                    progress.wait(lock, [&]() { return failed || completedSteps[previous] >= min(numSteps, i + distance); });
+                    if (failed)
+                        return;
+                }
+
+                if (!backprop)
+                {
+                    for (auto& node : stage.m_nodes)
+                    {
+                        {
+                            ScopeNodeProfile profile(node, /*backward=*/false, /*event=*/false);
+                            node->ForwardProp(steps[i]);
+                        }
+                        node->BumpEvalTimeStamp();
+                    }
+                }
+                else
+                {
+                    for (auto nodeIter = stage.m_nodes.rbegin(); nodeIter != stage.m_nodes.rend(); nodeIter++)
+                    {
+                        ScopeNodeProfile profile(*nodeIter, /*backward=*/true, /*event=*/false);
+                        (*nodeIter)->BackpropToInputs(steps[numSteps - 1 - i], [this](const ComputationNodeBase* child) { return IsMember(child); });
+                    }
+                }
+
+                {
+                    lock_guard<std::mutex> lock(mutex);
+                    completedSteps[s] = i + 1;
+                }
+                progress.notify_all();
+            }
+        }
+        catch (...)
+        {
+            {
+                lock_guard<std::mutex> lock(mutex);
+                errors[s] = current_exception();
+                failed = true;
+            }
+            progress.notify_all();
+        }
+    };
+
+    RunOnWorkers(runStage);
+
+    for (auto& error : errors)
+    {
+        if (error)
+            rethrow_exception(error);
+    }
+}
+
+void ComputationNetwork::WavefrontFlowControlNode::RunOnWorkers(const function<void(size_t)>& job)
+{
+    // Started once; if starting a thread fails, the ones started so far are kept and the next call starts the rest.
+    while (m_workers.size() < m_stages.size())
+    {
+        size_t s = m_workers.size(), jobsDone = m_jobNumber;
+        m_workers.emplace_back([this, s, jobsDone]() { RunWorker(s, jobsDone); });
+    }
+
+    unique_lock<std::mutex> lock(m_workersMutex);
+    m_job = &job;
+    m_jobNumber++;
+    m_numWorkersRunning = m_workers.size();
+    m_jobStarted.notify_all();
+    m_jobDone.wait(lock, [this]() { return m_numWorkersRunning == 0; });
+    m_job = nullptr;
+}
+
+void ComputationNetwork::WavefrontFlowControlNode::RunWorker(size_t s, size_t jobsDone)
+{
+    for (;;)
+    {
+        const function<void(size_t)>* job;
+        {
+            unique_lock<std::mutex> lock(m_workersMutex);
+            m_jobStarted.wait(lock, [&]() { return m_stopWorkers || m_jobNumber != jobsDone; });
+            if (m_stopWorkers)
+                return;
+            jobsDone = m_jobNumber;
+            job = m_job;
+        }
+
+        (*job)(s); // does not throw, the stages capture their exceptions
+
+        {
+            lock_guard<std::mutex> lock(m_workersMutex);
+            m_numWorkersRunning--;
+        }
+        m_jobDone.notify_all();
+    }
+}
+
+/*virtual*/ void ComputationNetwork::WavefrontFlowControlNode::RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) /*override*/
+{
+    for (auto& stage : m_stages)
+    {
+        for (auto& node : stage.m_nodesBefore)
+            node->RequestMatricesBeforeForwardProp(matrixPool);
+        stage.m_loop->RequestMatricesBeforeForwardProp(matrixPool);
+    }
+}
+/*virtual*/ void ComputationNetwork::WavefrontFlowControlNode::ReleaseMatricesAfterForwardProp(MatrixPool& matrixPool) /*override*/
+{
+}
+/*virtual*/ void ComputationNetwork::WavefrontFlowControlNode::AllocateGradientMatricesForInputs(MatrixPool& matrixPool) /*override*/
+{
+    for (auto stage = m_stages.rbegin(); stage != m_stages.rend(); stage++)
+    {
+        stage->m_loop->AllocateGradientMatricesForInputs(matrixPool);
+        for (auto nodeIter = stage->m_nodesBefore.rbegin(); nodeIter != stage->m_nodesBefore.rend(); nodeIter++)
+            (*nodeIter)->AllocateGradientMatricesForInputs(matrixPool);
+    }
+}
+/*virtual*/ void ComputationNetwork::WavefrontFlowControlNode::RequestMatricesBeforeBackprop(MatrixPool& matrixPool) /*override*/
+{
+}
+/*virtual*/ void ComputationNetwork::WavefrontFlowControlNode::ReleaseMatricesAfterBackprop(MatrixPool& matrixPool) /*override*/
+{
+    for (auto stage = m_stages.rbegin(); stage != m_stages.rend(); stage++)
+    {
+        stage->m_loop->ReleaseMatricesAfterBackprop(matrixPool);
+        for (auto nodeIter = stage->m_nodesBefore.rbegin(); nodeIter != stage->m_nodesBefore.rend(); nodeIter++)
+        {
+            if ((*nodeIter)->NeedsGradient())
+                (*nodeIter)->ReleaseMatricesAfterBackprop(matrixPool);
+        }
+    }
+}
+
+bool ComputationNetwork::WavefrontFlowControlNode::IsOutOfDateWrtInputs() const
+{
+    for (auto& stage : m_stages)
+    {
+        if (stage.m_loop->IsOutOfDateWrtInputs())
+            return true;
+        for (auto& node : stage.m_nodesBefore)
+        {
+            if (node->IsOutOfDateWrtInputs())
+                return true;
+        }
+    }
+    return false;
+}
+
+/*static*/ shared_ptr<ComputationNetwork::WavefrontFlowControlNode> ComputationNetwork::FindInWavefronts(const std::vector<std::shared_ptr<WavefrontFlowControlNode>>& wavefronts, const ComputationNodeBasePtr& node)
+{
+    for (auto& iter : wavefronts)
+    {
+        if (iter->IsMember(node.get()))
+            return iter;
+    }
+    return nullptr;
+}
+
+// calls 'action' for every node of an entry of a FlowControlNode, e.g. for the nodes inside a loop
+template <typename ActionFunc>
+static void ForEachNestedNode(const ComputationNodeBasePtr& entry, const ActionFunc& action)
+{
+    auto flowControlNode = dynamic_pointer_cast<FlowControlNode>(entry);
+    if (!flowControlNode)
+        action(entry);
+    else
+    {
+        for (auto& node : flowControlNode->m_nestedNodes)
+            ForEachNestedNode(node, action);
+    }
+}
+
+// Replaces the members of the wavefronts among the entries of a PARTraversalFlowControlNode by the wavefronts.
+// A wavefront is only used if all of its members are there. It takes the place of its last member; entries between its members
+// are moved before it, except for those that use it, which are moved after it. If one of the members uses the latter, the entries are left as they are.
+/*static*/ vector<ComputationNodeBasePtr> ComputationNetwork::ApplyWavefronts(const std::vector<std::shared_ptr<WavefrontFlowControlNode>>& wavefronts, vector<ComputationNodeBasePtr> flowControlOrder)
+{
+    for (auto& wavefront : wavefronts)
+    {
+        const auto& members = wavefront->m_nestedNodes;
+        auto isMember = [&](const ComputationNodeBasePtr& entry) { return find(members.begin(), members.end(), entry) != members.end(); };
+        size_t first = flowControlOrder.size(), last = 0, numMembers = 0;
+        for (size_t i = 0; i < flowControlOrder.size(); i++)
+        {
+            if (isMember(flowControlOrder[i]))
+            {
+                first = min(first, i);
+                last = i;
+                numMembers++;
+            }
+        }
+        if (numMembers != members.size())
+            continue;
+
+        vector<ComputationNodeBasePtr> before, after;
+        set<const ComputationNodeBase*> nodesAfter;
+        bool valid = true;
+        for (size_t i = first; i <= last && valid; i++)
+        {
+            const auto& entry = flowControlOrder[i];
+            bool usesWavefront = false, usesNodesAfter = false;
+            ForEachNestedNode(entry, [&](const ComputationNodeBasePtr& node)
+            {
+                for (auto& input : node->GetInputs())
+                {
+                    usesWavefront |= wavefront->IsMember(input.get());
+                    usesNodesAfter |= nodesAfter.find(input.get()) != nodesAfter.end();
+                }
+            });
+
+            if (isMember(entry))
+                valid = !usesNodesAfter;
+            else if (usesWavefront || usesNodesAfter)
+            {
+                ForEachNestedNode(entry, [&](const ComputationNodeBasePtr& node) { nodesAfter.insert(node.get()); });
+                after.push_back(entry);
+            }
+            else
+                before.push_back(entry);
+        }
+        if (!valid)
+            continue;
+
+        vector<ComputationNodeBasePtr> order(flowControlOrder.begin(), flowControlOrder.begin() + first);
+        order.insert(order.end(), before.begin(), before.end());
+        order.push_back(wavefront);
+        order.insert(order.end(), after.begin(), after.end());
+        order.insert(order.end(), flowControlOrder.begin() + last + 1, flowControlOrder.end());
+        flowControlOrder = move(order);
+    }
+    return flowControlOrder;
+}
+
 // TODO: do this on PARTraversalFlowControlNode
 void ComputationNetwork::ResetEvalTimeStamps()
 {
@@ -458,9 +934,12 @@ void ComputationNetwork::PrintComputationTree(const ComputationNodeBasePtr& root
 void ComputationNetwork::InvalidateCompiledNetwork()
 {
     m_isCompiled = false;
+    m_isCompiledFromCache = false;
+    m_compiledNetworkCache = nullptr;
     m_allSEQNodes.clear();
     m_evalOrders.clear();
     m_nestedNetworks.clear();
+    m_allWavefronts.clear();
     m_inputValues.clear();
     m_learnableParameters.clear();
 }
@@ -512,8 +991,13 @@ void ComputationNetwork::CompileNetwork()
     // TODO: Don't use m_inputValues, traverse ourselves, to remove dependency on FormEvalOrder().
     ResetMBLayouts();
 
+    // STEP: Look up the results of an earlier compilation of the same network (see CompiledNetworkCache.h).
+    // On success, this restores the recurrent loops and the loop-corrected global eval order.
+    LookUpCompiledNetworkCache();
+
     // STEP: Discover nested loops.
-    FormRecurrentLoops(nullptr); // form the global one  --TODO: just use this; should be no need to do this for each root
+    if (!m_isCompiledFromCache)
+        FormRecurrentLoops(nullptr); // form the global one  --TODO: just use this; should be no need to do this for each root
     //for (auto& node : m_allRoots)
     //    FormRecurrentLoops(node); // BUGBUG: These calls are needed because they patch EvalOrders. Will be unnecessary once we move this out.
 
@@ -531,6 +1015,12 @@ void ComputationNetwork::CompileNetwork()
     // STEP: Infer node dimensions.
     ValidateNetwork();
 
+    // STEP: Group stacked loops that can run concurrently, if enabled.
+    FormWavefronts();
+
+    // STEP: Remember loops and dimensions for the next compilation of this network.
+    UpdateCompiledNetworkCache();
+
     // STEP: Optimize the network.
     // :)
 
@@ -801,23 +1291,28 @@ size_t ComputationNetwork::ValidateNodes(list<ComputationNodeBasePtr> nodes, boo
         bool valid = false;
         if (hasVisitedChild || isLeaf) // got at least one child: it makes sense to call Validate()
         {
-            string prevPrototype = node->FormatOperationPrototype("");
+            // (formatting the prototypes is expensive for large networks, so it is only done for logging)
+            string prevPrototype = TraceLevel() > 0 ? node->FormatOperationPrototype("") : string();
             bool unchanged;
             try
             {
                 unchanged = !ValidateNode(node, isFinalValidationPass);
-                string updatedPrototype = node->FormatOperationPrototype("");
-#if 0           // print prototype in final validation pass. Problematic for tracking down validation errors in loops.
-                unchanged;
-                if (isFinalValidationPass)
-#else           // print prototype upon every change (useful for debugging)
-                if (isFirstPass || !unchanged || prevPrototype != updatedPrototype)
+                if (TraceLevel() > 0)
+                {
+                    string updatedPrototype = node->FormatOperationPrototype("");
+#if 0               // print prototype in final validation pass. Problematic for tracking down validation errors in loops.
+                    unchanged;
+                    if (isFinalValidationPass)
+#else               // print prototype upon every change (useful for debugging)
+                    if (isFirstPass || !unchanged || prevPrototype != updatedPrototype)
 #endif
-                    if (TraceLevel() > 0)
-                    fprintf(stderr, "Validating --> %s\n", updatedPrototype.c_str());
+                        fprintf(stderr, "Validating --> %s\n", updatedPrototype.c_str());
+                }
             }
             catch (...) // if validation failed then print the prototype anyway so one can see the input args
             {
+                if (TraceLevel() <= 0)
+                    prevPrototype = node->FormatOperationPrototype("");
                 fprintf(stderr, "Validating --> %s FAILED\n", prevPrototype.c_str());
                 throw;
             }
@@ -830,6 +1325,10 @@ size_t ComputationNetwork::ValidateNodes(list<ComputationNodeBasePtr> nodes, boo
                 LogicError("ValidateSubNetwork: %ls %ls operation in final validation although not all children were visited?", node->NodeName().c_str(), node->OperationName().c_str());
             // if all children valid then
             valid = (allChildrenVisited && unchanged) || isLeaf;
+            // A node outside of loops whose inputs are all validated will not change anymore once it has reached the state an earlier
+            // compilation of this network ended with. This saves the pass that would otherwise just confirm that nothing changes.
+            if (!valid && !isFinalValidationPass && allChildrenVisited && m_isCompiledFromCache && !node->IsPartOfLoop())
+                valid = HasReachedCachedState(node);
         }
         // count those that we need to redo
         if (!valid)
@@ -838,6 +1337,188 @@ size_t ComputationNetwork::ValidateNodes(list<ComputationNodeBasePtr> nodes, boo
     return todo;
 }
 
+// -----------------------------------------------------------------------
+// compiled-network cache (see CompiledNetworkCache.h)
+// -----------------------------------------------------------------------
+
+uint64_t ComputationNetwork::GetCompiledNetworkCacheKey() const
+{
+    uint64_t hash = Fnv1aHashSeed;
+    auto addString = [&hash](const wstring& s) { hash = Fnv1aHash(hash, s); };
+    auto addValue  = [&hash](size_t value)     { hash = Fnv1aHash(hash, value); };
+
+    for (const auto& iter : m_nameToNodeMap) // (sorted by name, i.e. independent of the order of construction)
+    {
+        const auto& node = iter.second;
+        addString(node->NodeName());
+        addString(node->OperationName());
+        addValue(node->Is<ComputationNode<float>>() ? 0 : 1);
+        addValue(node->GetNumInputs());
+        for (const auto& input : node->GetInputs())
+            addString(input->NodeName());
+        addValue(node->IsParameterUpdateRequired());
+        // the shapes of inputs and parameters determine all others
+        if (node->IsLeaf())
+        {
+            const auto& dims = node->GetSampleLayout().GetDims();
+            addValue(dims.size());
+            for (auto dim : dims)
+                addValue(dim);
+            if (node->Is<ITakesDynamicAxis>())
+                addString(node->As<ITakesDynamicAxis>()->GetRequestedDynamicAxis());
+        }
+    }
+
+    // explicitly specified roots, see DetermineSetOfAllRoots()
+    for (const auto* group : { &m_criterionNodes, &m_evaluationNodes, &m_outputNodes })
+    {
+        addValue(group->size());
+        for (const auto& node : *group)
+            addString(node->NodeName());
+    }
+    return hash;
+}
+
+// load the cache file of this network, if the cache is enabled, and restore the recurrent loops from it
+// Without a usable cache file, this prepares an empty cache to be filled in by UpdateCompiledNetworkCache().
+void ComputationNetwork::LookUpCompiledNetworkCache()
+{
+    m_compiledNetworkCache = nullptr;
+    m_isCompiledFromCache = false;
+
+    const auto& directory = Globals::GetCompiledNetworkCacheDirectory();
+    if (directory.empty())
+        return;
+
+    uint64_t key = GetCompiledNetworkCacheKey();
+    auto cache = CompiledNetworkCache::TryLoad(directory, key);
+    if (cache && RestoreRecurrentLoops(*cache))
+    {
+        m_compiledNetworkCache = cache;
+        m_isCompiledFromCache = true;
+    }
+    else
+        m_compiledNetworkCache = make_shared<CompiledNetworkCache>(key);
+
+    if (TraceLevel() > 0)
+        fprintf(stderr, "\nCompiled-network cache: %ls %ls.\n", m_isCompiledFromCache ? L"using" : L"creating", CompiledNetworkCache::PathOf(directory, key).c_str());
+}
+
+// set up m_allSEQNodes and the loop-corrected global eval order, as FormRecurrentLoops(nullptr) would
+// Returns false, leaving the network untouched, if the cache does not match the nodes of this network.
+bool ComputationNetwork::RestoreRecurrentLoops(const CompiledNetworkCache& cache)
+{
+    const auto& nodes = GetEvalOrder(nullptr);
+    if (cache.m_evalOrder.size() != nodes.size())
+        return false;
+
+    auto findNode = [this](const wstring& name) -> ComputationNodeBasePtr
+    {
+        auto iter = m_nameToNodeMap.find(name);
+        return iter != m_nameToNodeMap.end() ? iter->second : nullptr;
+    };
+
+    // the cached order must be a permutation of the nodes
+    unordered_set<ComputationNodeBasePtr> remainingNodes(nodes.begin(), nodes.end());
+    list<ComputationNodeBasePtr> evalOrder;
+    for (const auto& name : cache.m_evalOrder)
+    {
+        auto node = findNode(name);
+        if (!node || remainingNodes.erase(node) == 0)
+            return false;
+        evalOrder.push_back(node);
+    }
+
+    vector<vector<ComputationNodeBasePtr>> nestedNodesOfLoops;
+    for (const auto& loop : cache.m_loops)
+    {
+        if (!findNode(loop.m_sourceNodeName))
+            return false;
+        nestedNodesOfLoops.push_back(vector<ComputationNodeBasePtr>());
+        for (const auto& name : loop.m_nestedNodeNames)
+        {
+            auto node = findNode(name);
+            if (!node)
+                return false;
+            nestedNodesOfLoops.back().push_back(node);
+        }
+    }
+
+    for (auto& node : nodes)
+        node->PurgeStateForFormingRecurrentLoops();
+    for (size_t loopId = 0; loopId < cache.m_loops.size(); loopId++)
+    {
+        SEQTraversalFlowControlNode rInfo((int)loopId, findNode(cache.m_loops[loopId].m_sourceNodeName));
+        rInfo.m_nestedNodes = move(nestedNodesOfLoops[loopId]);
+        for (auto& node : rInfo.m_nestedNodes)
+        {
+            node->m_isPartOfLoop = true;
+            node->m_loopId = rInfo.m_loopId;
+        }
+        rInfo.m_steppingDirection = cache.m_loops[loopId].m_steppingDirection;
+        m_allSEQNodes.push_back(make_shared<SEQTraversalFlowControlNode>(move(rInfo)));
+    }
+    UpdateEvalOrder(nullptr, evalOrder);
+    return true;
+}
+
+// true if the node and its inputs have the dimensions that an earlier compilation of this network ended with
+bool ComputationNetwork::HasReachedCachedState(const ComputationNodeBasePtr& node) const
+{
+    const auto& nodeStates = m_compiledNetworkCache->m_nodeStates;
+    auto hasReachedCachedState = [&nodeStates](const ComputationNodeBasePtr& n)
+    {
+        auto iter = nodeStates.find(n->NodeName());
+        return iter != nodeStates.end() && iter->second == CompiledNetworkCache::NodeState{ n->GetSampleLayout(), n->HasMBLayout(), n->m_needsGradient };
+    };
+
+    if (!hasReachedCachedState(node))
+        return false;
+    for (const auto& input : node->GetInputs())
+    {
+        if (!hasReachedCachedState(input))
+            return false;
+    }
+    return true;
+}
+
+// fill in a newly created cache after validation, and write it
+void ComputationNetwork::UpdateCompiledNetworkCache()
+{
+    if (!m_compiledNetworkCache || m_isCompiledFromCache)
+        return;
+
+    auto& cache = *m_compiledNetworkCache;
+    for (const auto& node : GetEvalOrder(nullptr))
+    {
+        cache.m_evalOrder.push_back(node->NodeName());
+        cache.m_nodeStates[node->NodeName()] = CompiledNetworkCache::NodeState{ node->GetSampleLayout(), node->HasMBLayout(), node->m_needsGradient };
+    }
+    for (const auto& loop : m_allSEQNodes)
+    {
+        CompiledNetworkCache::Loop cachedLoop;
+        cachedLoop.m_sourceNodeName = loop->m_sourceNode->NodeName();
+        cachedLoop.m_steppingDirection = loop->m_steppingDirection;
+        for (const auto& node : loop->m_nestedNodes)
+            cachedLoop.m_nestedNodeNames.push_back(node->NodeName());
+        cache.m_loops.push_back(move(cachedLoop));
+    }
+    SaveCompiledNetworkCache();
+}
+
+// The cache only saves time; not being able to write it must not fail the job.
+void ComputationNetwork::SaveCompiledNetworkCache() const
+{
+    try
+    {
+        m_compiledNetworkCache->Save(Globals::GetCompiledNetworkCacheDirectory());
+    }
+    catch (const exception& e)
+    {
+        fprintf(stderr, "WARNING: Could not write the compiled-network cache: %s\n", e.what());
+    }
+}
+
 // -----------------------------------------------------------------------
 // memory allocation
 // -----------------------------------------------------------------------
@@ -916,6 +1597,27 @@ void ComputationNetwork::MarkValueNonSharableNodes()
     }
 }
 
+// tell ReducedPrecisionTimes nodes whether other nodes read their weights too (e.g. tied embeddings), in which case
+// the full-precision weights must be kept
+void ComputationNetwork::MarkSharedReducedPrecisionWeights()
+{
+    auto reducedPrecisionTimesNodes = GetNodesWithType(OperationNameOf(ReducedPrecisionTimesNode));
+    if (reducedPrecisionTimesNodes.empty())
+        return;
+
+    auto parents = CreateParentsMap();
+    for (auto& node : reducedPrecisionTimesNodes)
+    {
+        bool shared = parents[node->GetInputs()[0]].size() > 1;
+        auto nodef = dynamic_pointer_cast<ReducedPrecisionTimesNode<float>>(node);
+        if (nodef)
+            nodef->SetWeightsReadByOtherNodes(shared);
+        auto noded = dynamic_pointer_cast<ReducedPrecisionTimesNode<double>>(node);
+        if (noded)
+            noded->SetWeightsReadByOtherNodes(shared);
+    }
+}
+
 // From the set of nodes extract all nodes which are used as accumulator nodes.
 set<ComputationNodeBasePtr> ComputationNetwork::ExtractNodesWhichAccumulateResult(set<ComputationNodeBasePtr> candidates)
 {
@@ -1067,6 +1769,9 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
     // Due to special topology, if a node is solely induced by parameters, its function value should not be shared
     MarkValueNonSharableNodes();
 
+    // Weights converted to 16 bits by ReducedPrecisionTimes are only released if no other node reads them
+    MarkSharedReducedPrecisionWeights();
+
     bool performingBackPropagation = (trainRootNode != nullptr);
 
     // Create a composite Eval order with the specified nodes as roots
@@ -1139,7 +1844,20 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
     m_matrixPool.Reset();
 
     TravserseInSortedGlobalEvalOrder(forwardPropRoots, [&outputValueNeededDuringBackProp, &parentsMap, this](const ComputationNodeBasePtr& node) {
-        if (node->Is<SEQTraversalFlowControlNode>())
+        if (node->Is<WavefrontFlowControlNode>())
+        {
+            // like a loop: the stages run concurrently, so none of their matrices may be shared with each other
+            auto wavefront = node->As<WavefrontFlowControlNode>();
+            auto stageNodes = wavefront->GetStageNodes();
+            for (auto& stageNode : stageNodes)
+                stageNode->SetOutputNeededDuringBackprop(outputValueNeededDuringBackProp[stageNode]);
+
+            wavefront->RequestMatricesBeforeForwardProp(m_matrixPool);
+
+            for (auto& stageNode : stageNodes)
+                ReleaseMatricesAfterEvalForChildren(stageNode, parentsMap);
+        }
+        else if (node->Is<SEQTraversalFlowControlNode>())
         {
             auto seqTraversalFlowControlNode = node->As<SEQTraversalFlowControlNode>();
             for (auto& loopNode : seqTraversalFlowControlNode->m_nestedNodes)
@@ -1162,7 +1880,8 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
 
     if (trainRootNode != nullptr)
     {
-        const std::list<ComputationNodeBasePtr>& backPropNodes = GetEvalOrder(trainRootNode);
+        // the entries that Backprop() of the criterion traverses, i.e. with loops and wavefronts as single entries
+        const std::vector<ComputationNodeBasePtr>& backPropNodes = GetNestedNetwork(trainRootNode)->As<FlowControlNode>()->m_nestedNodes;
 
         // compact the alias map for cases like s = a + b + c + d
 
@@ -1215,7 +1934,6 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         m_matrixPool.SetAliasInfo(compactGradientAliasMap, compactGradientAliasRootMap);
 
         // now, simulate the gradient computation order to determine how to allocate matrices
-        set<ComputationNodeBasePtr> completedGradient;
 
         // we need to call it here since we always compute gradients for children and root node is not children of other node
         trainRootNode->RequestMatricesBeforeBackprop(m_matrixPool);
@@ -1223,19 +1941,14 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         for (auto iter = backPropNodes.rbegin(); iter != backPropNodes.rend(); iter++) // for gradient computation, traverse in reverse order
         {
             auto n = *iter;
-            if (n->IsPartOfLoop())
+            if (n->Is<SEQTraversalFlowControlNode>() || n->Is<WavefrontFlowControlNode>())
             {
-                std::vector<ComputationNodeBasePtr> recurrentNodes;
-                shared_ptr<SEQTraversalFlowControlNode> recInfo = FindInRecurrentLoops(m_allSEQNodes, n);
-                if (completedGradient.insert(recInfo).second)
-                {
-                    // SEQ mode: allocate all in loop first, then deallocate again
-                    // TODO: next step: use PARTraversalFlowControlNode::AllocateGradientMatricesForInputs() and ReleaseMatricesAfterBackprop()...
-                    // BUGBUG: naw, ^^ would not work! Wrong order! Need to rethink this. Need to make AllocateEvalMatrices() and AllocateGradientMatrices() the virtual functions.
-                    recInfo->AllocateGradientMatricesForInputs(m_matrixPool);
-                    // Loops are computed sample by sample so we have to allocate them all
-                    recInfo->ReleaseMatricesAfterBackprop(m_matrixPool);
-                }
+                // SEQ mode: allocate all in loop first, then deallocate again
+                // TODO: next step: use PARTraversalFlowControlNode::AllocateGradientMatricesForInputs() and ReleaseMatricesAfterBackprop()...
+                // BUGBUG: naw, ^^ would not work! Wrong order! Need to rethink this. Need to make AllocateEvalMatrices() and AllocateGradientMatrices() the virtual functions.
+                n->AllocateGradientMatricesForInputs(m_matrixPool);
+                // Loops are computed sample by sample so we have to allocate them all
+                n->ReleaseMatricesAfterBackprop(m_matrixPool);
             }
             else
             {
@@ -1248,7 +1961,20 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         }
     }
 
-    m_matrixPool.OptimizedMemoryAllocation(); 
+    // reuse the memory plan of an earlier run with the same requests, if there is one
+    uint64_t requestsHash = 0;
+    const MatrixPool::MemoryPlan* memoryPlan = nullptr;
+    if (m_compiledNetworkCache)
+    {
+        requestsHash = m_matrixPool.GetRequestsHash();
+        memoryPlan = m_compiledNetworkCache->FindMemoryPlan(requestsHash);
+    }
+    auto newMemoryPlan = m_matrixPool.OptimizedMemoryAllocation(memoryPlan);
+    if (m_compiledNetworkCache && !memoryPlan)
+    {
+        m_compiledNetworkCache->m_memoryPlans[requestsHash] = move(newMemoryPlan);
+        SaveCompiledNetworkCache();
+    }
     m_areMatricesAllocated = true;
 
     // TO DO: At the time of AllocateAllMatrices we don't know the minibatch size. In theory one may allocate memory again once we start to receive
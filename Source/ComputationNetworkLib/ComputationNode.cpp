@@ -64,6 +64,30 @@ void ComputationNode<ElemType>::LazyZeroGradient(const ComputationNodeBase* grad
 
 template<class ElemType>
 void ComputationNode<ElemType>::Backprop(const FrameRange& fr, bool childrenInThisLoop, bool childrenInOuterLoop) /*override*/
+{
+    if (fr.IsAllFrames() && IsPartOfLoop() && childrenInThisLoop)
+        LogicError("%ls %ls operation: Backprop called with whole-batch FrameRange on node that participates in a loop", NodeName().c_str(), OperationName().c_str());
+
+    BackpropToInputs(fr, [&](const ComputationNodeBase* child)
+    {
+        if (!((childrenInThisLoop  && child->IsPartOfLoop() == IsPartOfLoop()) ||
+              (childrenInOuterLoop && child->IsPartOfLoop() != IsPartOfLoop()) ))
+            return false;
+
+        // If we propagate from a loop to a node that is outside the loop, we are not efficient.
+        // This case is handled by SEQTraversalFlowControlNode::Backprop().
+        // The check below is to verify that.
+        if (IsPartOfLoop() && !child->IsPartOfLoop() && !fr.IsAllFrames())
+        {
+            LogicError("Backprop: Inefficiency: %ls %ls operation in loop propagates gradient to non-loop %ls %ls\n",
+                       NodeName().c_str(), OperationName().c_str(), child->NodeName().c_str(), child->OperationName().c_str());
+        }
+        return true;
+    });
+}
+
+template<class ElemType>
+void ComputationNode<ElemType>::BackpropToInputs(const FrameRange& fr, const std::function<bool(const ComputationNodeBase*)>& isSelected) /*override*/
 {
     // Normally our gradient matrix was created as an input of another node.
     // This does not happen though in the special case of a node inside a loop
@@ -84,15 +108,10 @@ void ComputationNode<ElemType>::Backprop(const FrameRange& fr, bool childrenInTh
         LazyZeroGradient(this); // set gradient to 0 if this is the first time
 #endif
 
-    if (fr.IsAllFrames() && IsPartOfLoop() && childrenInThisLoop)
-        LogicError("%ls %ls operation: Backprop called with whole-batch FrameRange on node that participates in a loop", NodeName().c_str(), OperationName().c_str());
-
     for (size_t i = 0; i < m_inputs.size(); i++)
     {
         ComputationNodePtr child = Input(i);
-        if (child->m_needsGradient &&
-            ((childrenInThisLoop  && child->IsPartOfLoop() == IsPartOfLoop()) ||
-             (childrenInOuterLoop && child->IsPartOfLoop() != IsPartOfLoop()) ))
+        if (child->m_needsGradient && isSelected(child.get()))
         {
             // fprintf(stderr, "Backprop: %ls %ls operation -> child %d %ls %ls\n", NodeName().c_str(), OperationName().c_str(), (int)i, child->NodeName().c_str(), child->OperationName().c_str());
             if (!m_needsGradient)
@@ -102,15 +121,6 @@ void ComputationNode<ElemType>::Backprop(const FrameRange& fr, bool childrenInTh
 #endif
             child->LazyZeroGradient(this); // set gradient to 0 if this is the first time
 
-            // If we propagate from a loop to a node that is outside the loop, we are not efficient.
-            // This case is handled by SEQTraversalFlowControlNode::Backprop().
-            // The check below is to verify that.
-            if (IsPartOfLoop() && !child->IsPartOfLoop() && !fr.IsAllFrames())
-            {
-                LogicError("Backprop: Inefficiency: %ls %ls operation in loop propagates gradient to non-loop %ls %ls\n",
-                           NodeName().c_str(), OperationName().c_str(), child->NodeName().c_str(), child->OperationName().c_str());
-            }
-
             // before backprop, verify gradient optimization info
             Input(i)->VerifyGradientOptimization(this);
 
@@ -24,6 +24,7 @@
 #include <algorithm>
 #include <assert.h>
 #include <atomic>
+#include <functional>
 
 #define DEFAULT_HIDDEN_ACTIVATION 0.1
 
@@ -110,6 +111,8 @@ struct /*interface*/ IComputationNode
     // --- this is meant to be overridden by ControlFlowNodes
 
     virtual void Backprop(const FrameRange& fr, bool childrenInThisLoop, bool childrenInOuterLoop) = 0;
+    // like Backprop(), but into those inputs only for which 'isSelected' returns true (see WavefrontFlowControlNode)
+    virtual void BackpropToInputs(const FrameRange& fr, const std::function<bool(const ComputationNodeBase*)>& isSelected) = 0;
 
     // --- optional overrides that add functionality
 
@@ -1777,6 +1780,7 @@ public:
     // this is the entry point from Network; while it will call virtual BackpropTo() into the actual node implementation
     // TODO: move to -Base (or -Network?)
     void Backprop(const FrameRange& fr, bool childrenInThisLoop, bool childrenInOuterLoop) override;
+    void BackpropToInputs(const FrameRange& fr, const std::function<bool(const ComputationNodeBase*)>& isSelected) override;
 
     // lazy resetting of gradient
     // This performs the actual zeroing out.
@@ -2261,6 +2265,7 @@ public:
     virtual void PrintSelf(bool) const override { NOT_IMPLEMENTED; }
     virtual void ValidateInferInputDimsFrom(const TensorShape&) override { NOT_IMPLEMENTED; }
     virtual void SetInput(const size_t, const Microsoft::MSR::CNTK::ComputationNodeBase::ComputationNodeBasePtr&) override { NOT_IMPLEMENTED; }
+    virtual void BackpropToInputs(const FrameRange&, const std::function<bool(const ComputationNodeBase*)>&) override { NOT_IMPLEMENTED; }
     virtual void MaskMissingValueColumnsToZero(const Microsoft::MSR::CNTK::FrameRange&) override { NOT_IMPLEMENTED; }
     virtual void MaskMissingGradientColumnsToZero(const Microsoft::MSR::CNTK::FrameRange&) override { NOT_IMPLEMENTED; }
     virtual void InvalidateMissingValueColumns(const Microsoft::MSR::CNTK::FrameRange&) override { NOT_IMPLEMENTED; }
@@ -2291,7 +2296,11 @@ struct ILateAttachingNode { virtual void LateAttachInputs() = 0; };
 // IRecurrentNode -- interface implemented by ComputationNodes that can be recurrent
 // =======================================================================
 
-struct IRecurrentNode { virtual int GetRecurrenceSteppingDirection() const = 0; };
+struct IRecurrentNode
+{
+    virtual int GetRecurrenceSteppingDirection() const = 0;
+    virtual int GetRecurrenceTimeStep() const = 0; // distance in frames between the input that is read and the output that is written
+};
 
 // =======================================================================
 // IFreezable -- nodes that have parameters that can be frozen
@@ -2305,6 +2314,8 @@ struct IFreezable { virtual void FreezeParameters() { } };
 // TODO: We can use this interface in more places.
 // =======================================================================
 
+class StreamStatistics;
+
 struct IPreComputeNode
 {
     // check whether node has already undergone precomputation
@@ -2312,6 +2323,9 @@ struct IPreComputeNode
     // call this with 'false' at start and with 'true' at end
     // This is used for resetting and updating from accumulators.
     virtual void MarkComputed(const bool hasComputed) = 0;
+    // alternatively, set the result from the statistics of the input computed elsewhere, e.g. directly from the deserializers
+    // Returns false if this node cannot be computed from them.
+    virtual bool SetFromStatistics(const StreamStatistics&) { return false; }
 };
 
 // =======================================================================
@@ -579,116 +579,130 @@ public:
     ElemType ComputeEditDistanceError(Matrix<ElemType>& firstSeq, const Matrix<ElemType> & secondSeq, MBLayoutPtr pMBLayout, 
         float subPen, float delPen, float insPen, bool squashInputs, const vector<size_t>& tokensToIgnore)
     {
-        std::vector<int> firstSeqVec, secondSeqVec;
+        // bring both rows of labels to the CPU at once; the sequences are then read directly from the packed layout
+        unique_ptr<ElemType[]> firstLabels(firstSeq.CopyToArray());
+        unique_ptr<ElemType[]> secondLabels(secondSeq.CopyToArray());
 
-        // Edit distance between subsequences
-        Matrix<float> grid(CPUDEVICE);
-        
-        // Number of insertions between subsequences
-        Matrix<float> insMatrix(CPUDEVICE);
-        
-        //Number of deletions between subsequences
-        Matrix<float> delMatrix(CPUDEVICE);
+        const auto& sequences = pMBLayout->GetAllSequences();
+        const long long numSequences = (long long)sequences.size();
+        const bool countSecondSeq = Base::HasEnvironmentPtr() && Base::Environment().IsV2Library();
 
-        // Number of substitutions between subsequences
-        Matrix<float> subMatrix(CPUDEVICE);
+        // number of errors and of reference samples, per sequence
+        vector<float> wrongSamples(sequences.size(), 0.0f);
+        vector<size_t> sampleNums(sequences.size(), 0);
 
-        float del, ins, sub;
+        // the sequences are independent, so they are distributed over the threads
+#pragma omp parallel
+        {
+            std::vector<int> firstSeqVec, secondSeqVec, secondSeqReversed;
+            std::vector<float> workspace;
+
+#pragma omp for schedule(dynamic)
+            for (long long k = 0; k < numSequences; k++)
+            {
+                const auto& sequence = sequences[k];
+                if (sequence.seqId == GAP_SEQUENCE_ID || pMBLayout->GetNumSequenceFramesInCurrentMB(sequence) == 0)
+                    continue;
+
+                ExtractSampleSequence(firstLabels.get(), *pMBLayout, sequence, squashInputs, tokensToIgnore, firstSeqVec);
+                ExtractSampleSequence(secondLabels.get(), *pMBLayout, sequence, squashInputs, tokensToIgnore, secondSeqVec);
+
+                sampleNums[k] = countSecondSeq ? secondSeqVec.size() : firstSeqVec.size();
+                wrongSamples[k] = ComputeEditDistance(firstSeqVec, secondSeqVec, subPen, delPen, insPen, secondSeqReversed, workspace);
+            }
+        }
+
+        // sum up in sequence order, so that the result does not depend on the number of threads
         ElemType wrongSampleNum = 0.0;
         size_t totalSampleNum = 0, totalframeNum = 0;
-        size_t sequenceStartFrame = 0;
-
-        for (const auto& sequence : pMBLayout->GetAllSequences())
+        for (size_t k = 0; k < sequences.size(); k++)
         {
-            if (sequence.seqId == GAP_SEQUENCE_ID)
+            if (sequences[k].seqId == GAP_SEQUENCE_ID)
                 continue;
 
-            auto numFrames = pMBLayout->GetNumSequenceFramesInCurrentMB(sequence);
+            totalframeNum += pMBLayout->GetNumSequenceFramesInCurrentMB(sequences[k]);
+            totalSampleNum += sampleNums[k];
+            wrongSampleNum += wrongSamples[k];
+        }
 
-            if (numFrames > 0)
-            {
-                totalframeNum += numFrames;
-
-                auto columnIndices = pMBLayout->GetColumnIndices(sequence);
-
-                ExtractSampleSequence(firstSeq, columnIndices, squashInputs, tokensToIgnore, firstSeqVec);
-                ExtractSampleSequence(secondSeq, columnIndices, squashInputs, tokensToIgnore, secondSeqVec);
-
-                //calculate edit distance
-                size_t firstSize = firstSeqVec.size();
-                size_t secondSize = secondSeqVec.size();
-                if (Base::HasEnvironmentPtr() && Base::Environment().IsV2Library())
-                    totalSampleNum += secondSize;
-                else 
-                    totalSampleNum += firstSize;
-
-                grid.Resize(firstSize + 1, secondSize + 1);
-                insMatrix.Resize(firstSize + 1, secondSize + 1);
-                delMatrix.Resize(firstSize + 1, secondSize + 1);
-                subMatrix.Resize(firstSize + 1, secondSize + 1);
-                insMatrix.SetValue(0.0f);
-                delMatrix.SetValue(0.0f);
-                subMatrix.SetValue(0.0f);
-
-                for (size_t i = 0; i < firstSize + 1; i++)
-                {
-                    grid(i, 0) = (float)(i * delPen);
-                    delMatrix(i, 0) = (float)i;
-                }
+        return (ElemType)(wrongSampleNum * totalframeNum / totalSampleNum);
+    }
 
-                for (size_t j = 0; j < secondSize + 1; j++)
-                {
-                    grid(0, j) = (float)(j * insPen);
-                    insMatrix(0, j) = (float)j;
-                }
-                for (size_t i = 1; i < firstSize + 1; i++)
-                {
-                    for (size_t j = 1; j < secondSize + 1; j++)
-                    {
-                        if (firstSeqVec[i - 1] == secondSeqVec[j - 1])
-                        {
-                            grid(i, j) = grid(i - 1, j - 1);
-                            insMatrix(i, j) = insMatrix(i - 1, j - 1);
-                            delMatrix(i, j) = delMatrix(i - 1, j - 1);
-                            subMatrix(i, j) = subMatrix(i - 1, j - 1);
-                        }
-                        else
-                        {
-                            del = grid(i - 1, j) + delPen; //deletion 
-                            ins = grid(i, j - 1) + insPen;  //insertion
-                            sub = grid(i - 1, j - 1) + subPen; //substitution 
-                            if (sub <= del && sub <= ins)
-                            {
-                                insMatrix(i, j) = insMatrix(i - 1, j - 1);
-                                delMatrix(i, j) = delMatrix(i - 1, j - 1);
-                                subMatrix(i, j) = subMatrix(i - 1, j - 1) + 1.0f;
-                                grid(i, j) = sub;
-                            }
-                            else if (del < ins)
-                            {
-                                insMatrix(i, j) = insMatrix(i - 1, j);
-                                subMatrix(i, j) = subMatrix(i - 1, j);
-                                delMatrix(i, j) = delMatrix(i - 1, j) + 1.0f;
-                                grid(i, j) = del;
-                            }
-                            else
-                            {
-                                delMatrix(i, j) = delMatrix(i, j - 1);
-                                subMatrix(i, j) = subMatrix(i, j - 1);
-                                insMatrix(i, j) = insMatrix(i, j - 1) + 1.0f;
-                                grid(i, j) = ins;
-                            }
-                        }
-                    }
-                }
+    // Returns the number of insertions, deletions and substitutions on the cheapest alignment of the two sequences.
+    // The cost of aligning the first i samples of firstSeq with the first j samples of secondSeq depends only on the cells
+    // (i-1, j), (i, j-1) and (i-1, j-1). Hence all cells on an anti-diagonal i + j = d can be computed at once from the
+    // two previous anti-diagonals, by a loop without dependencies between its iterations that the compiler can vectorize.
+    // Ties are broken in favor of substitution, then deletion, then insertion.
+    // secondSeqReversed and workspace are scratch buffers, kept by the caller to avoid reallocations.
+    static float ComputeEditDistance(const vector<int>& firstSeq, const vector<int>& secondSeq, float subPen, float delPen, float insPen,
+                                     vector<int>& secondSeqReversed, vector<float>& workspace)
+    {
+        const int firstSize = (int)firstSeq.size();
+        const int secondSize = (int)secondSeq.size();
+
+        // secondSeq[j - 1] for the cells (i, j) of anti-diagonal d is secondSeqReversed[secondSize - d + i], i.e. consecutive in i
+        secondSeqReversed.assign(secondSeq.rbegin(), secondSeq.rend());
+        const int* first = firstSeq.data();
+        const int* secondReversed = secondSeqReversed.data();
+
+        // three anti-diagonals (the current one and the two before), indexed by i, each with the cost of the cells and
+        // the number of edits (insertions + deletions + substitutions) on the path to them
+        const size_t stride = firstSize + 1;
+        workspace.resize(6 * stride);
+        float* grid[3];
+        float* errors[3];
+        for (int b = 0; b < 3; b++)
+        {
+            grid[b] = workspace.data() + (2 * b) * stride;
+            errors[b] = workspace.data() + (2 * b + 1) * stride;
+        }
 
-                wrongSampleNum += insMatrix(firstSize, secondSize) + delMatrix(firstSize, secondSize) + subMatrix(firstSize, secondSize);
+        for (int d = 0; d <= firstSize + secondSize; d++)
+        {
+            float* gridC = grid[d % 3];
+            float* errorsC = errors[d % 3];
+            const float* gridP1 = grid[(d + 2) % 3];
+            const float* errorsP1 = errors[(d + 2) % 3];
+            const float* gridP2 = grid[(d + 1) % 3];
+            const float* errorsP2 = errors[(d + 1) % 3];
+
+            // cells on the borders: (0, d) is reached by insertions only, (d, 0) by deletions only
+            if (d <= secondSize)
+            {
+                gridC[0] = (float)(d * insPen);
+                errorsC[0] = (float)d;
+            }
+            if (d <= firstSize && d > 0)
+            {
+                gridC[d] = (float)(d * delPen);
+                errorsC[d] = (float)d;
             }
 
-            sequenceStartFrame += numFrames;
+            // inner cells (i, d - i)
+            const int iBegin = std::max(1, d - secondSize);
+            const int iEnd = std::min(d - 1, firstSize);
+            const int* secondAtI = secondReversed + (secondSize - d);
+            for (int i = iBegin; i <= iEnd; i++)
+            {
+                const int match = first[i - 1] == secondAtI[i];
+                const float subCost = gridP2[i - 1] + (match ? 0.0f : subPen); // from (i - 1, j - 1)
+                const float delCost = gridP1[i - 1] + delPen;                  // from (i - 1, j)
+                const float insCost = gridP1[i] + insPen;                      // from (i, j - 1)
+                const int takeSub = match | ((subCost <= delCost) & (subCost <= insCost));
+                const int takeDel = delCost < insCost;
+                const float delInsCost = takeDel ? delCost : insCost;
+                gridC[i] = takeSub ? subCost : delInsCost;
+
+                // The edit count is blended with 0/1 weights rather than selected, so that all of its loads are
+                // unconditional; otherwise the compiler does not if-convert the loop.
+                const float subWeight = takeSub ? 1.0f : 0.0f;
+                const float delWeight = takeDel ? 1.0f - subWeight : 0.0f;
+                const float insWeight = 1.0f - subWeight - delWeight;
+                errorsC[i] = subWeight * (errorsP2[i - 1] + (match ? 0.0f : 1.0f)) + delWeight * (errorsP1[i - 1] + 1.0f) + insWeight * (errorsP1[i] + 1.0f);
+            }
         }
 
-        return (ElemType)(wrongSampleNum * totalframeNum / totalSampleNum);
+        return errors[(firstSize + secondSize) % 3][firstSize];
     }
 
     virtual void Save(File& fstream) const override
@@ -726,39 +740,27 @@ private:
     float m_insPen;
     std::vector<size_t> m_tokensToIgnore;
 
-    // Clear out_SampleSeqVec and extract a vector of samples from the matrix into out_SampleSeqVec.
-    static void ExtractSampleSequence(const Matrix<ElemType>& firstSeq, vector<size_t>& columnIndices, bool squashInputs, const vector<size_t>& tokensToIgnore, std::vector<int>& out_SampleSeqVec)
+    // Clear out_SampleSeqVec and extract the samples of one sequence from the packed row of labels into out_SampleSeqVec.
+    static void ExtractSampleSequence(const ElemType* labels, const MBLayout& mbLayout, const MBLayout::SequenceInfo& sequence, bool squashInputs, const vector<size_t>& tokensToIgnore, std::vector<int>& out_SampleSeqVec)
     {
         out_SampleSeqVec.clear();
 
-        // Get the first element in the sequence
-        size_t lastId = (int)firstSeq(0, columnIndices[0]);
-        if (std::find(tokensToIgnore.begin(), tokensToIgnore.end(), lastId) == tokensToIgnore.end())
-            out_SampleSeqVec.push_back(lastId);
+        const size_t numParallelSequences = mbLayout.GetNumParallelSequences();
+        const size_t tBegin = (size_t)std::max(sequence.tBegin, (ptrdiff_t)0);
+        const size_t tEnd = std::min(sequence.tEnd, mbLayout.GetNumTimeSteps());
 
-        // Remaining elements
-        if (squashInputs)
+        size_t lastId = 0;
+        for (size_t t = tBegin; t < tEnd; t++)
         {
-            //squash sequences of identical samples
-            for (size_t i = 1; i < columnIndices.size(); i++)
-            {
-                size_t refId = (int)firstSeq(0, columnIndices[i]);
-                if (lastId != refId)
-                {
-                    lastId = refId;
-                    if (std::find(tokensToIgnore.begin(), tokensToIgnore.end(), refId) == tokensToIgnore.end())
-                        out_SampleSeqVec.push_back(refId);
-                }
-            }
-        }
-        else
-        {
-            for (size_t i = 1; i < columnIndices.size(); i++)
-            {
-                auto refId = (int)firstSeq(0, columnIndices[i]);
-                if (std::find(tokensToIgnore.begin(), tokensToIgnore.end(), refId) == tokensToIgnore.end())
-                    out_SampleSeqVec.push_back(refId);
-            }
+            size_t refId = (int)labels[t * numParallelSequences + sequence.s];
+
+            // squash sequences of identical samples
+            if (squashInputs && t != tBegin && refId == lastId)
+                continue;
+
+            lastId = refId;
+            if (std::find(tokensToIgnore.begin(), tokensToIgnore.end(), refId) == tokensToIgnore.end())
+                out_SampleSeqVec.push_back((int)refId);
         }
     }
 };
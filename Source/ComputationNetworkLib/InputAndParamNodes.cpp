@@ -424,6 +424,8 @@ void LearnableParameter<ElemType>::Save(File& fstream) const /*override*/
 {
     if (!m_initString.empty())
         LogicError("LearnableParameter: Cannot Save() before deferred initialization has completed.");
+    if (Value().GetNumElements() != GetSampleLayout().GetNumElements())
+        LogicError("LearnableParameter: Cannot Save() %ls, whose values were released (e.g. by ReducedPrecisionTimes).", NodeDescription().c_str());
     Base::Save(fstream);
     fstream << m_learningRateMultiplier;
     m_sampleLayout.Save(fstream);
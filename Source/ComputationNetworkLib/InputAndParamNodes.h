@@ -584,6 +584,38 @@ public:
             Matrix<ElemType> sliceInput1Value = InputRef(1).MaskedValueFor(t);
             Matrix<ElemType> sliceOutputGrad = MaskedGradientFor(t);
 
+            // With sparse (one-hot) input only the embeddings of the words in the minibatch get a gradient, so, as in TimesNode,
+            // the gradient of the embedding matrix is kept in sparse block column format: one column per distinct word, which the
+            // learners and the gradient aggregation consume directly instead of a dense gradient of the size of the whole table.
+            // A new matrix is allocated instead of switching the type in place, since the old one may be shared with other nodes.
+            // This is done on the CPU only; on the GPU the gradient stays dense.
+            bool isSparseLookup = InputRef(0).Value().GetDeviceId() == CPUDEVICE &&
+                                  InputRef(1).Value().GetMatrixType() == SPARSE &&
+                                  InputRef(1).GetSampleMatrixNumRows() == InputRef(0).GetAsMatrixNumCols(); // sparse matrices cannot be reshaped for several words per sample
+            if (isSparseLookup &&
+                InputRef(0).GetPreferredGradientMatrixType() == UNDETERMINED &&
+                Gradient().GetMatrixType() == DENSE)
+            {
+                auto& currentInput0GradientMatrixRef = InputRef(0).Gradient();
+                InputRef(0).GradientPtrRef() =
+                    std::make_shared<Matrix<ElemType>>(
+                        currentInput0GradientMatrixRef.GetNumRows(),
+                        currentInput0GradientMatrixRef.GetNumCols(),
+                        currentInput0GradientMatrixRef.GetPreferredDeviceId(),
+                        SPARSE,
+                        MatrixFormat::matrixFormatSparseBlockCol);
+                InputRef(0).SetPreferredGradientMatrixType(SPARSE);
+            }
+            else if (!isSparseLookup &&
+                     InputRef(0).GetPreferredGradientMatrixType() != DENSE)
+            {
+                // as in TimesNode, if the gradient was previously accumulated as sparse for a dense input, switch to dense
+                if (InputRef(0).GetPreferredGradientMatrixType() == SPARSE)
+                    InputRef(0).Gradient().SwitchToMatrixType(DENSE, matrixFormatDense, true);
+
+                InputRef(0).SetPreferredGradientMatrixType(DENSE);
+            }
+
             BackpropToLeft(sliceInput1Value, InputRef(0).GradientAsMatrix(), sliceOutputGrad);
         }
         else if (inputIndex == 1) // right derivative (input)
@@ -21,6 +21,7 @@
 #include <assert.h>
 #include <set>
 #include "Quantizers.h"
+#include "ReducedPrecision.h"
 #include "InputAndParamNodes.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -1171,6 +1172,127 @@ public:
 template class QuantizedTimesNode<float>;
 template class QuantizedTimesNode<double>;
 
+// Matrix product with the weights stored in 16 bits. If the left operand is a LearnableParameter, it is converted to
+// 'precision' ('float16' or 'bfloat16') at the first evaluation, and the products read only this copy, converting it
+// back tile by tile. Sums are accumulated in ElemType. This halves the memory bandwidth needed for the weights,
+// which is what limits CPU inference at small minibatch sizes, at the cost of rounding the weights.
+// The first evaluation in inference mode releases the full-precision weights, so that only the 16-bit copy stays in
+// memory, unless other nodes read them as well. The network cannot be saved after that.
+// Like QuantizedTimes, this is for inference on CPU only and is put into a trained network with the Edit command:
+// ...
+// node => if node.name == 'LSTMoutput1.output' then ReducedPrecisionTimes(node.inputs[0], node.inputs[1], precision='bfloat16') else node,
+// ...
+// Other parameters - refer to the base multiplication class
+template <class ElemType>
+class ReducedPrecisionTimesNode : public TimesNodeBase<ElemType, false>
+{
+    typedef TimesNodeBase<ElemType, false> Base;
+    UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName()
+    {
+        return L"ReducedPrecisionTimes";
+    }
+
+private:
+    ReducedPrecisionFormat m_precision;
+    bool m_weightsReadByOtherNodes; // set by the network; the full-precision weights are then kept
+
+    void CreateMultiplier()
+    {
+        this->m_pQuantizedMultiplier = make_shared<ReducedPrecisionMultiplier<ElemType>>(m_precision);
+    }
+
+public:
+    ReducedPrecisionTimesNode(DEVICEID_TYPE deviceId, const wstring& name, const wstring& precision = L"bfloat16", size_t outputRank = 1, int inferInputRankToMap = Base::NoInferredInputRank)
+        : Base(deviceId, name, outputRank, inferInputRankToMap), m_precision(ReducedPrecisionFormatFromName(precision)), m_weightsReadByOtherNodes(false)
+    {
+        if (deviceId != CPUDEVICE)
+            LogicError("Reduced precision operation is supposed to be used on CPU device only.");
+
+        CreateMultiplier();
+    }
+
+    ReducedPrecisionTimesNode(const ScriptableObjects::IConfigRecordPtr configp)
+        : ReducedPrecisionTimesNode(configp->Get(L"deviceId"), L"<placeholder>", configp->Get(L"precision"), configp->Get(L"outputRank"), configp->Get(L"inferInputRankToMap"))
+    {
+        AttachInputsFromConfig(configp, this->GetExpectedNumInputs());
+    }
+
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
+    {
+        Base::CopyTo(nodeP, newName, flags);
+        if (flags & CopyNodeFlags::copyNodeValue)
+        {
+            auto node = dynamic_pointer_cast<ReducedPrecisionTimesNode<ElemType>>(nodeP);
+            node->m_precision = m_precision;
+            node->CreateMultiplier();
+        }
+    }
+
+    void Save(File& fstream) const
+    {
+        Base::Save(fstream);
+        fstream << std::wstring(ReducedPrecisionFormatName(m_precision));
+    }
+
+    virtual void Load(File& fstream, size_t modelVersion) override
+    {
+        Base::Load(fstream, modelVersion);
+        std::wstring precision;
+        fstream >> precision;
+        m_precision = ReducedPrecisionFormatFromName(precision);
+        CreateMultiplier();
+    }
+
+    void SetWeightsReadByOtherNodes(bool weightsReadByOtherNodes) { m_weightsReadByOtherNodes = weightsReadByOtherNodes; }
+
+    virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
+    {
+        auto weights = dynamic_pointer_cast<LearnableParameter<ElemType>>(Input(0));
+        if (weights)
+            this->m_pQuantizedMultiplier->SetIsAConstant(true);
+
+        auto multiplier = static_pointer_cast<ReducedPrecisionMultiplier<ElemType>>(this->m_pQuantizedMultiplier);
+        if (!weights || !multiplier->HasConvertedA())
+        {
+            Base::ForwardProp(fr);
+
+            // When inferring, the weights are not read in full precision anymore, so release them, unless other nodes
+            // read them too. They cannot be saved after this.
+            if (weights && multiplier->HasConvertedA() && Environment().IsInferring())
+            {
+                if (!m_weightsReadByOtherNodes)
+                    weights->Value().Resize(0, 0, 0, /*growOnly=*/false);
+                else
+                    fprintf(stderr, "WARNING: %ls %ls operation: Keeping the full-precision weights %ls, since other nodes read them as well.\n",
+                            NodeName().c_str(), OperationName().c_str(), weights->NodeName().c_str());
+            }
+            return;
+        }
+
+        // The product of the 16-bit weights [m x k] and the input, whose samples are flattened into columns of k.
+        const auto& shapeA = InputRef(0).GetSampleLayout();
+        size_t m = 1;
+        for (size_t i = 0; i < this->OutputRank(); i++)
+            m *= shapeA[i];
+        size_t k = shapeA.GetNumElements() / m;
+        Matrix<ElemType> input1 = InputRef(1).ValueFor(fr);
+        Matrix<ElemType> output = ValueFor(fr);
+        if (input1.GetMatrixType() != DENSE || input1.GetNumElements() % k != 0 || output.GetNumElements() != input1.GetNumElements() / k * m)
+            LogicError("%ls %ls operation: Unexpected input or output dimensions.", NodeName().c_str(), OperationName().c_str());
+        multiplier->Multiply((int)m, (int)(input1.GetNumElements() / k), (int)k, nullptr, input1.Data(), output.Data());
+    }
+
+    virtual void /*ComputationNode::*/ BackpropTo(const size_t /*inputIndex*/, const FrameRange& /*fr*/) override
+    {
+        // This operation is intended only for inference
+        NOT_IMPLEMENTED;
+    }
+};
+
+template class ReducedPrecisionTimesNode<float>;
+template class ReducedPrecisionTimesNode<double>;
+
 // -----------------------------------------------------------------------
 // SumElementsNode (input)
 // Sums up all elements in the input across all samples into a single scalar.
@@ -18,6 +18,7 @@
 #include "Basics.h"
 #include "Matrix.h"
 #include "ComputationNode.h"
+#include "Fnv1aHash.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -69,9 +70,15 @@ class MatrixPool
 public:
     typedef const void* AliasNodePtr; // use as an identifier in place of ComputationNodeBasePtr to avoid include order issue
 
+    // The assignment of requests to buffers computed by OptimizedMemoryAllocation() only depends on the requests, and takes time
+    // quadratic in the number of requests in the worst case. So it can be kept and handed back in for identical requests (see CompiledNetworkCache).
+    // A plan holds the memory id of every float request followed by every double request, in request order.
+    typedef vector<int> MemoryPlan;
+
 protected:
     vector<MemRequestInfo<float>> m_memRequestInfoFloatVec; 
     vector<MemRequestInfo<double>> m_memRequestInfoDoubleVec;
+    unordered_map<const void*, size_t> m_memRequestIndex; // [first matrix pointer of a request] -> index into the request vector of its type
     set<DEVICEID_TYPE> m_deviceIDSet; 
     int m_stepCounter; 
 
@@ -106,14 +113,10 @@ public:
     template <class ElemType>
     MemRequestInfo<ElemType>* GetMemInfo(shared_ptr<Matrix<ElemType>> *pMatrixPtr)
     {
-        vector<MemRequestInfo<ElemType>>& memInfoVec = GetMemRequestInfoVec<ElemType>();
-        // iterate through the vector and find the pointer memInfo
-        for (auto& memInfo : memInfoVec)
-        {
-            if (memInfo.pMatrixPtrs[0] == pMatrixPtr)
-                return &memInfo;
-        }
-        return nullptr;
+        auto iter = m_memRequestIndex.find(pMatrixPtr);
+        if (iter == m_memRequestIndex.end())
+            return nullptr;
+        return &GetMemRequestInfoVec<ElemType>()[iter->second];
     }
 
     template <class ElemType>
@@ -138,6 +141,7 @@ public:
     {
         vector<MemRequestInfo<ElemType>>& memInfoVec = GetMemRequestInfoVec<ElemType>(); 
         MemRequestInfo<ElemType> memInfo(deviceId, pMatrixPtr, matrixSize, mbScale, isWorkSpace, m_stepCounter);
+        m_memRequestIndex.insert(make_pair(pMatrixPtr, memInfoVec.size())); // (a repeated request keeps the index of the first one)
         memInfoVec.push_back(memInfo); 
         m_deviceIDSet.insert(deviceId); 
         m_stepCounter++; 
@@ -146,12 +150,34 @@ public:
         *pMatrixPtr = make_shared<Matrix<ElemType>>(deviceId);
     }
 
-    void OptimizedMemoryAllocation()
+    // identifies the requests made so far, and thereby the plan OptimizedMemoryAllocation() computes for them
+    uint64_t GetRequestsHash()
+    {
+        // sparse requests do not participate in the optimization
+        RemoveSparseRequests<float>();
+        RemoveSparseRequests<double>();
+
+        uint64_t hash = Fnv1aHashSeed;
+        hash = HashRequests<float>(hash);
+        hash = HashRequests<double>(hash);
+        return hash;
+    }
+
+    // Assigns a buffer to every request. If 'plan' is given, it must have been returned by an earlier call with the same GetRequestsHash().
+    MemoryPlan OptimizedMemoryAllocation(const MemoryPlan* plan = nullptr)
     {
+        RemoveSparseRequests<float>();
+        RemoveSparseRequests<double>();
+
+        size_t numFloatRequests = m_memRequestInfoFloatVec.size();
+        if (plan && plan->size() != numFloatRequests + m_memRequestInfoDoubleVec.size())
+            LogicError("MatrixPool: The memory plan does not match the requests.");
+
         // MatrixPool is not templated, so we call both float and double versions here 
-        OptimizedMemoryAllocationFunc<float>(); 
-        OptimizedMemoryAllocationFunc<double>();
-        return; 
+        MemoryPlan result;
+        OptimizedMemoryAllocationFunc<float>(plan ? plan->data() : nullptr, result);
+        OptimizedMemoryAllocationFunc<double>(plan ? plan->data() + numFloatRequests : nullptr, result);
+        return result;
     }
 
     void SetAliasInfo(
@@ -246,33 +272,99 @@ private:
     }
 
     template <class ElemType>
-    void OptimizedMemoryAllocationFunc()
+    void RemoveSparseRequests()
     {
-        vector<MemRequestInfo<ElemType>>& memInfoVec = GetMemRequestInfoVec<ElemType>();
-        if (memInfoVec.empty())
-            return; 
-
         // remove all requests that has been marked as sparse matrices, those will not participate in memory sharing 
-        for (auto iter = memInfoVec.begin(); iter != memInfoVec.end(); )
+        vector<MemRequestInfo<ElemType>>& memInfoVec = GetMemRequestInfoVec<ElemType>();
+        auto isSparse = [](const MemRequestInfo<ElemType>& memInfo)
         {
-            bool hasSparse = false;
-            for (auto matPtr : iter->pMatrixPtrs)
+            for (auto matPtr : memInfo.pMatrixPtrs)
             {
                 if ((*matPtr)->GetMatrixType() == SPARSE)
-                {
-                    hasSparse = true;
-                    break;
-                }
+                    return true;
             }
+            return false;
+        };
+        bool hasSparse = false;
+        for (const auto& memInfo : memInfoVec)
+        {
+            if (isSparse(memInfo))
+            {
+                m_memRequestIndex.erase(memInfo.pMatrixPtrs[0]);
+                hasSparse = true;
+            }
+        }
+        if (!hasSparse)
+            return;
 
-            if (hasSparse)
-                memInfoVec.erase(iter);
-            else
-                iter++; 
+        memInfoVec.erase(std::remove_if(memInfoVec.begin(), memInfoVec.end(), isSparse), memInfoVec.end());
+        for (size_t i = memInfoVec.size(); i-- > 0;) // backwards, so that a repeated request keeps the index of the first one
+            m_memRequestIndex[memInfoVec[i].pMatrixPtrs[0]] = i;
+    }
+
+    template <class ElemType>
+    uint64_t HashRequests(uint64_t hash)
+    {
+        const vector<MemRequestInfo<ElemType>>& memInfoVec = GetMemRequestInfoVec<ElemType>();
+        hash = Fnv1aHash(hash, memInfoVec.size());
+        for (const auto& memInfo : memInfoVec)
+        {
+            hash = Fnv1aHash(hash, memInfo.deviceId);
+            hash = Fnv1aHash(hash, memInfo.matrixSize);
+            hash = Fnv1aHash(hash, memInfo.mbScale);
+            hash = Fnv1aHash(hash, memInfo.isWorkSpace);
+            hash = Fnv1aHash(hash, memInfo.allocStep);
+            hash = Fnv1aHash(hash, memInfo.releaseStep);
         }
+        return hash;
+    }
 
+    // assigns memory ids to the requests, from 'planMemoryIds' or by optimization, creates the buffers, and appends the memory ids to 'resultPlan'
+    template <class ElemType>
+    void OptimizedMemoryAllocationFunc(const int* planMemoryIds, MemoryPlan& resultPlan)
+    {
+        vector<MemRequestInfo<ElemType>>& memInfoVec = GetMemRequestInfoVec<ElemType>();
+        if (memInfoVec.empty())
+            return; 
+
+        if (planMemoryIds)
+        {
+            for (size_t i = 0; i < memInfoVec.size(); i++)
+                memInfoVec[i].SetMemoryId(planMemoryIds[i]);
+        }
+        else
+            ComputeMemoryIds(memInfoVec);
+
+        // now assign the actual pointers, one buffer per memory id of each device and workspace flag
+        map<pair<DEVICEID_TYPE, bool>, vector<shared_ptr<Matrix<ElemType>>>> buffers;
+        for (auto& memInfo : memInfoVec)
+        {
+            if (memInfo.memoryId < 0)
+                LogicError("MatrixPool: A request was not assigned any memory.");
+            auto& buffersOfGroup = buffers[make_pair(memInfo.deviceId, memInfo.isWorkSpace)];
+            if (buffersOfGroup.size() <= (size_t)memInfo.memoryId)
+                buffersOfGroup.resize(memInfo.memoryId + 1);
+            auto& matrixPtr = buffersOfGroup[memInfo.memoryId];
+            if (!matrixPtr)
+                matrixPtr = make_shared<Matrix<ElemType>>(memInfo.deviceId);
+            for (auto pOutMatrixPtr : memInfo.pMatrixPtrs)
+                *pOutMatrixPtr = matrixPtr;
+            resultPlan.push_back(memInfo.memoryId);
+        }
+    }
+
+    template <class ElemType>
+    void ComputeMemoryIds(vector<MemRequestInfo<ElemType>>& memInfoVec)
+    {
         // sort the memory request from largest size to smallest 
-        std::sort(memInfoVec.begin(), memInfoVec.end(), greater_than_mem_req_size<ElemType>());
+        // (This sorts pointers, such that memInfoVec itself stays in request order, which the memory plan refers to.)
+        vector<MemRequestInfo<ElemType>*> sortedMemInfoVec;
+        for (auto& memInfo : memInfoVec)
+            sortedMemInfoVec.push_back(&memInfo);
+        std::sort(sortedMemInfoVec.begin(), sortedMemInfoVec.end(), [](const MemRequestInfo<ElemType>* info1, const MemRequestInfo<ElemType>* info2)
+        {
+            return greater_than_mem_req_size<ElemType>()(*info1, *info2);
+        });
 
         std::vector<bool> workspaceFlagVec = {true, false};
         for (auto& devId : m_deviceIDSet)
@@ -283,8 +375,9 @@ private:
                 vector<MemAllocInfo> memAllocInfoVec;
                 int memoryCounter = 0;
                 // we start with memory request that is scalable with minibatch size(usually those require larger memory size)
-                for (auto& memInfo : memInfoVec)
+                for (auto pMemInfo : sortedMemInfoVec)
                 {
+                    auto& memInfo = *pMemInfo;
                     // check if it's the proper device
                     if (memInfo.deviceId != devId || memInfo.isWorkSpace != wsFlag || !memInfo.mbScale)
                         continue;
@@ -325,8 +418,9 @@ private:
                 }
 
                 // rescan the request list and this time allocate for those that doesn't depend on minibatch size 
-                for (auto& memInfo : memInfoVec)
+                for (auto pMemInfo : sortedMemInfoVec)
                 {
+                    auto& memInfo = *pMemInfo;
                     // check if it's the proper device
                     if (memInfo.deviceId != devId || memInfo.isWorkSpace != wsFlag || memInfo.mbScale)
                         continue;
@@ -365,24 +459,6 @@ private:
                         memoryCounter++;
                     }
                 }
-
-                // now assign the actual pointers 
-                for (int i = 0; i < memoryCounter; i++)
-                {
-                    auto matrixPtr = make_shared<Matrix<ElemType>>(devId);
-                    if (!matrixPtr) // this can't really happen, because we haven't started allocating memory yet
-                        LogicError("MatrixPool: failed to get a valid matrix.");
-                    for (auto& memInfo : memInfoVec)
-                    {
-                        if (memInfo.deviceId == devId && memInfo.isWorkSpace == wsFlag && memInfo.memoryId == i)
-                        {
-                            for (auto pOutMatrixPtr : memInfo.pMatrixPtrs)
-                            {
-                                *pOutMatrixPtr = matrixPtr;
-                            }
-                        }
-                    }
-                }
             }
         }
     }
@@ -9,6 +9,7 @@
 #include "InputAndParamNodes.h"
 #include "LinearAlgebraNodes.h"
 #include "Matrix.h"
+#include "StreamStatistics.h"
 
 #include <iostream>
 #include <list>
@@ -191,6 +192,22 @@ public:
     }
 
 protected:
+    // sets the result to a column vector computed from the statistics of the input, see SetFromStatistics()
+    void SetComputedValue(const StreamStatistics& statistics, const std::vector<double>& value)
+    {
+        if (IsAccumulating())
+            LogicError("%ls %ls operation: SetFromStatistics() called while accumulating.", NodeName().c_str(), OperationName().c_str());
+        if (statistics.GetCount() == 0)
+            LogicError("%ls %ls operation: No data accumulated during precomputation.", NodeName().c_str(), OperationName().c_str());
+        if (value.size() != GetSampleLayout().GetNumElements())
+            InvalidArgument("%ls %ls operation: Statistics of dimension %d do not match the input dimension %d.",
+                            NodeName().c_str(), OperationName().c_str(), (int)value.size(), (int)GetSampleLayout().GetNumElements());
+
+        std::vector<ElemType> column(value.begin(), value.end());
+        Value().SetValue(column.size(), 1, Value().GetDeviceId(), column.data());
+        m_hasComputed = true;
+    }
+
     size_t m_numSamples; // (SIZE_MAX while outside accumulation state)
     bool IsAccumulating() const { return m_numSamples != SIZE_MAX; }
 };
@@ -199,7 +216,8 @@ protected:
     ComputationNodeBoilerplate;               \
     UsingPreComputedNodeMembers;              \
     using Base::m_numSamples;                 \
-    using Base::IsAccumulating
+    using Base::IsAccumulating;               \
+    using Base::SetComputedValue
 
 // -----------------------------------------------------------------------
 // MeanNode (features)
@@ -248,6 +266,12 @@ public:
 
         UpdateRunningAverage(InputRef(0), mean, m_numSamples);
     }
+
+    virtual bool /*IPreComputeNode::*/ SetFromStatistics(const StreamStatistics& statistics) override
+    {
+        SetComputedValue(statistics, statistics.GetMean());
+        return true;
+    }
 };
 
 template class MeanNode<float>;
@@ -342,6 +366,16 @@ public:
         m_numSamples += InputRef(0).GetMBLayout()->GetActualNumSamples();
     }
 
+    virtual bool /*IPreComputeNode::*/ SetFromStatistics(const StreamStatistics& statistics) override
+    {
+        // same floor as in MarkComputed()
+        auto invStdDev = statistics.GetVariance();
+        for (auto& v : invStdDev)
+            v = 1 / sqrt(max(v, 1e-10));
+        SetComputedValue(statistics, invStdDev);
+        return true;
+    }
+
     virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
     {
         Base::CopyTo(nodeP, newName, flags);
@@ -1184,6 +1184,11 @@ public:
             return 0;
     }
 
+    virtual int /*IRecurrentNode::*/ GetRecurrenceTimeStep() const override
+    {
+        return abs(m_fromOffset);
+    }
+
     virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
     {
         Base::CopyTo(nodeP, newName, flags);
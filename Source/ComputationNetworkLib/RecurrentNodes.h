@@ -71,6 +71,7 @@ public:
     virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
     virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override;
     virtual int /*IRecurrentNode::*/ GetRecurrenceSteppingDirection() const override { return -direction; }
+    virtual int /*IRecurrentNode::*/ GetRecurrenceTimeStep() const override { return m_timeStep; }
     virtual NodeStatePtr /*IStatefulNode::*/ ExportState() override;
     virtual void /*IStatefulNode::*/ ImportState(const NodeStatePtr& pImportedState) override;
     int TimeStep() const { return m_timeStep; }
@@ -13,6 +13,7 @@
 
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <algorithm>
 #include <map>
 #include <string>
 #include <vector>
@@ -1489,7 +1490,11 @@ public:
           m_softMax(deviceId),
           m_grdToSoftMaxInput(deviceId),
           m_clsLogSoftmax(deviceId),
-          m_clsSoftmax(deviceId)
+          m_clsSoftmax(deviceId),
+          m_groupByClass(false),
+          m_groupedFrameIndices(deviceId),
+          m_groupedObs(deviceId),
+          m_grdToObs(deviceId)
     {
     }
 
@@ -1533,6 +1538,12 @@ private:
 
         ComputeSoftMaxPartial(); // Note: Flag m_needRecomputeGradientToSoftmaxInput guards so that this computes only once.
 
+        if (m_groupByClass)
+        {
+            BackpropToGroupedByClass(inputIndex);
+            return;
+        }
+
         ForColumnsWithClass([&](size_t /*s*/, size_t /*t*/, const FrameRange& fr, size_t /*y_t*/, size_t c_t, size_t sz, size_t lft_bnd, size_t nbr_wrd)
         {
             // compute prb - 1 and prb
@@ -1579,7 +1590,21 @@ private:
     // gradient of cross entropy w.r.t. to input to softmax
     void ComputeSoftMaxPartial()
     {
-        if (m_needRecomputeGradientToSoftmaxInput)
+        if (m_needRecomputeGradientToSoftmaxInput && m_groupByClass)
+        {
+            // (softmax - 1 at the word) * gradient, for all frames at once
+            if (!m_targetOffsets.empty())
+            {
+                m_grdToSoftMaxInput.SetValue(m_softMax);
+                ElemType* grdToSoftMaxInput = m_grdToSoftMaxInput.Data();
+                for (size_t offset : m_targetOffsets)
+                    grdToSoftMaxInput[offset] -= 1;
+                Matrix<ElemType>::Scale(Gradient(), m_grdToSoftMaxInput);
+            }
+
+            m_needRecomputeGradientToSoftmaxInput = false;
+        }
+        else if (m_needRecomputeGradientToSoftmaxInput)
         {
             m_grdToSoftMaxInput.Resize(1, m_totalNbrWords); // buffer that contains a concatenation of class-conditional values
 
@@ -1609,9 +1634,6 @@ public:
         // get the label matrix to CPU, ideally in location=BOTH state
         InputRef(LABELDATA).Value().TransferToDeviceIfNotThere(CPUDEVICE, /*ismoved =*/ false/*means: BOTH state OK*/, /*emptyTransfer =*/ false, /*updatePreferredDevice =*/ false);
 
-        auto& functionValues = Value();
-
-        const size_t hdSize = InputRef(INPUTDATA).GetSampleMatrixNumRows();
         assert(m_nbrCls == InputRef(CLASSPROBINDATA).GetSampleMatrixNumRows());
 
         // compute the class posteriors
@@ -1619,6 +1641,26 @@ public:
         m_clsLogSoftmax.InplaceLogSoftmax(true);   // log
         m_clsSoftmax.AssignExpOf(m_clsLogSoftmax); // non-log
 
+        // on the CPU, the frames are processed class by class; see ForwardPropGroupedByClass()
+        m_groupByClass = CanGroupByClass();
+        if (m_groupByClass)
+            ForwardPropGroupedByClass();
+        else
+            ForwardPropPerFrame();
+
+#if NANCHECK
+        Value().HasNan("ClassBasedCrossEntropyWithSoftmax");
+#endif
+        m_needRecomputeGradientToSoftmaxInput = true;
+    }
+
+private:
+    // one matrix-vector product and softmax per frame
+    void ForwardPropPerFrame()
+    {
+        auto& functionValues = Value();
+        const size_t hdSize = InputRef(INPUTDATA).GetSampleMatrixNumRows();
+
         // create a large workspace to contain all class-conditioned probs concatenated
         m_totalNbrWords = ForColumnsWithClass([](size_t /*s*/, size_t /*t*/, const FrameRange& /*fr*/, size_t y_t, size_t /*c_t*/, size_t /*sz*/, size_t lft_bnd, size_t nbr_wrd)
         {
@@ -1671,13 +1713,226 @@ public:
         });
 
         functionValues *= (-1);
+    }
 
-#if NANCHECK
-        functionValues.HasNan("ClassBasedCrossEntropyWithSoftmax");
-#endif
-        m_needRecomputeGradientToSoftmaxInput = true;
+    // On the CPU, the per-frame products above are too small to be efficient. All frames of a class use the same
+    // columns of the weight matrix, so the frames are sorted by class, and each class needs one matrix product over
+    // all of its frames. The classes are independent, and are processed in parallel.
+    // The concatenated buffers m_logSoftmax, m_softMax and m_grdToSoftMaxInput are then ordered by class: each class
+    // has a block that is the [nbr_wrd x number of frames] matrix of the class-conditional values of its frames.
+    struct ClassGroup
+    {
+        size_t c_t;     // class index
+        size_t lft_bnd; // index of first word belonging to the class
+        size_t nbr_wrd; // number of words in the class
+        size_t begin;   // the frames of the class are m_groupedFrames[begin..end)
+        size_t end;
+        size_t sz;      // offset of the block of the class in the concatenated buffers
+    };
+
+    bool CanGroupByClass()
+    {
+        return m_deviceId == CPUDEVICE &&
+               InputRef(INPUTDATA).Value().GetMatrixType() == MatrixType::DENSE &&
+               InputRef(EMBEDDINGMATRIX).Value().GetMatrixType() == MatrixType::DENSE;
+    }
+
+    // the block of a class in one of the concatenated buffers, as a [nbr_wrd x number of frames] matrix
+    static Matrix<ElemType> ClassBlock(const Matrix<ElemType>& buffer, const ClassGroup& group)
+    {
+        size_t numFrames = group.end - group.begin;
+        Matrix<ElemType> block = buffer.ColumnSlice(group.sz, group.nbr_wrd * numFrames);
+        block.Reshape(group.nbr_wrd, numFrames);
+        return block;
+    }
+
+    // sort the frames by class (stable, so the frames of a class stay in column order), and check the labels
+    void GroupFramesByClass()
+    {
+        const auto& pMBLayout = InputRef(LABELDATA).GetMBLayout();
+        const size_t nS = pMBLayout->GetNumParallelSequences();
+        const size_t numCols = pMBLayout->GetNumCols();
+        const ElemType* lbl = InputRef(LABELDATA).Value().Data(); // [4 x numCols]
+
+        vector<size_t> lft_bnds(m_nbrCls), nbr_wrds(m_nbrCls), numFramesOfClass(m_nbrCls, 0);
+        for (size_t j = 0; j < numCols; j++)
+        {
+            if (pMBLayout->IsGap(FrameRange(pMBLayout, j / nS).Sequence(j % nS))) // skip gaps
+                continue;
+
+            const ElemType* lbl_t = lbl + 4 * j;
+            size_t y_t = (size_t)lbl_t[0];
+            size_t c_t = (size_t)lbl_t[1];
+            size_t lft_bnd = (size_t)lbl_t[2];
+            size_t nbr_wrd = (size_t)lbl_t[3] - lft_bnd;
+            if (c_t >= m_nbrCls)
+                LogicError("ClassBasedCrossEntropyWithSoftmax: Class index out of bounds.");
+            if (nbr_wrd == 0)
+                LogicError("ClassBasedCrossEntropyWithSoftmax: Encountered a class of size 0.");
+            if (y_t < lft_bnd || y_t >= lft_bnd + nbr_wrd)
+                LogicError("ClassBasedCrossEntropyWithSoftmax: Word index out of bounds of class-member index range (word not a class member).");
+            if (numFramesOfClass[c_t] == 0)
+            {
+                lft_bnds[c_t] = lft_bnd;
+                nbr_wrds[c_t] = nbr_wrd;
+            }
+            else if (lft_bnds[c_t] != lft_bnd || nbr_wrds[c_t] != nbr_wrd)
+                LogicError("ClassBasedCrossEntropyWithSoftmax: Class %d has different word ranges in the same minibatch.", (int)c_t);
+            numFramesOfClass[c_t]++;
+        }
+
+        m_classGroups.clear();
+        size_t numFrames = 0;
+        m_totalNbrWords = 0;
+        for (size_t c_t = 0; c_t < m_nbrCls; c_t++)
+        {
+            if (numFramesOfClass[c_t] == 0)
+                continue;
+            m_classGroups.push_back(ClassGroup{ c_t, lft_bnds[c_t], nbr_wrds[c_t], numFrames, numFrames, m_totalNbrWords });
+            numFrames += numFramesOfClass[c_t];
+            m_totalNbrWords += numFramesOfClass[c_t] * nbr_wrds[c_t];
+        }
+
+        // fill in the frames; ClassGroup::end is advanced up to its final value
+        vector<size_t> groupOfClass(m_nbrCls);
+        for (size_t g = 0; g < m_classGroups.size(); g++)
+            groupOfClass[m_classGroups[g].c_t] = g;
+        m_groupedFrames.resize(numFrames);
+        m_targetOffsets.resize(numFrames);
+        vector<ElemType> groupedFrameIndices(numFrames);
+        for (size_t j = 0; j < numCols; j++)
+        {
+            if (pMBLayout->IsGap(FrameRange(pMBLayout, j / nS).Sequence(j % nS)))
+                continue;
+
+            size_t y_t = (size_t)lbl[4 * j];
+            auto& group = m_classGroups[groupOfClass[(size_t)lbl[4 * j + 1]]];
+            size_t k = group.end++;
+            m_groupedFrames[k] = j;
+            m_targetOffsets[k] = group.sz + (k - group.begin) * group.nbr_wrd + (y_t - group.lft_bnd);
+            groupedFrameIndices[k] = (ElemType)j;
+        }
+        if (numFrames > 0)
+            m_groupedFrameIndices.SetValue(1, numFrames, CPUDEVICE, groupedFrameIndices.data());
+
+        // the classes can update their columns of the weight gradient in parallel, unless their word ranges overlap
+        vector<pair<size_t, size_t>> wordRanges;
+        for (const auto& group : m_classGroups)
+            wordRanges.push_back(make_pair(group.lft_bnd, group.lft_bnd + group.nbr_wrd));
+        sort(wordRanges.begin(), wordRanges.end());
+        m_classWordRangesOverlap = false;
+        for (size_t g = 1; g < wordRanges.size(); g++)
+            m_classWordRangesOverlap |= wordRanges[g].first < wordRanges[g - 1].second;
+    }
+
+    void ForwardPropGroupedByClass()
+    {
+        GroupFramesByClass();
+
+        m_softMax.Resize(1, m_totalNbrWords);
+        m_logSoftmax.Resize(1, m_totalNbrWords);
+        if (m_groupedFrames.empty())
+        {
+            Value().SetValue(0);
+            return;
+        }
+
+        // hidden activations of the frames in class order [hdSize x numFrames]
+        m_groupedObs.DoGatherColumnsOf(0, m_groupedFrameIndices, InputRef(INPUTDATA).Value(), 1);
+
+        Matrix<ElemType>& weight = InputRef(EMBEDDINGMATRIX).ValueAsMatrix();
+        const long long numGroups = (long long)m_classGroups.size();
+#pragma omp parallel for schedule(dynamic)
+        for (long long g = 0; g < numGroups; g++)
+        {
+            const ClassGroup& group = m_classGroups[g];
+            Matrix<ElemType> weightForClass = weight.ColumnSlice(group.lft_bnd, group.nbr_wrd);            // [hdSize x nbr_wrd]
+            Matrix<ElemType> obs = m_groupedObs.ColumnSlice(group.begin, group.end - group.begin);          // [hdSize x numFrames]
+            Matrix<ElemType> logSoftMax_c = ClassBlock(m_logSoftmax, group);                                // [nbr_wrd x numFrames]
+            Matrix<ElemType> softMax_c = ClassBlock(m_softMax, group);
+
+            // log softmax(W' x_t) and its non-log version, for all frames of the class
+            logSoftMax_c.AssignProductOf(weightForClass, true, obs, false);
+            logSoftMax_c.InplaceLogSoftmax(true);
+            softMax_c.SetValue(logSoftMax_c);
+            softMax_c.InplaceExp();
+        }
+
+        // add the words' class-conditional log posteriors and the class log posteriors
+        const ElemType* logSoftmax = m_logSoftmax.Data();
+        const ElemType* clsLogSoftmax = m_clsLogSoftmax.Data();
+        double objective = 0;
+        for (const auto& group : m_classGroups)
+            for (size_t k = group.begin; k < group.end; k++)
+                objective += logSoftmax[m_targetOffsets[k]] + clsLogSoftmax[m_groupedFrames[k] * m_nbrCls + group.c_t];
+        Value().SetValue((ElemType)-objective);
+    }
+
+    void BackpropToGroupedByClass(size_t inputIndex)
+    {
+        if (m_groupedFrames.empty())
+            return;
+
+        const long long numGroups = (long long)m_classGroups.size();
+        switch (inputIndex)
+        {
+            case 1:
+            {
+                // gradient to input, computed in class order and then added to the frames' columns
+                Matrix<ElemType>& weight = InputRef(EMBEDDINGMATRIX).ValueAsMatrix();
+                m_grdToObs.Resize(m_groupedObs.GetNumRows(), m_groupedObs.GetNumCols());
+#pragma omp parallel for schedule(dynamic)
+                for (long long g = 0; g < numGroups; g++)
+                {
+                    const ClassGroup& group = m_classGroups[g];
+                    Matrix<ElemType> weightForClass = weight.ColumnSlice(group.lft_bnd, group.nbr_wrd);
+                    Matrix<ElemType> grd_c = m_grdToObs.ColumnSlice(group.begin, group.end - group.begin);
+                    grd_c.AssignProductOf(weightForClass, false, ClassBlock(m_grdToSoftMaxInput, group), false);
+                }
+                InputRef(INPUTDATA).Gradient().DoScatterColumnsOf(1, m_groupedFrameIndices, m_grdToObs, 1);
+                break;
+            }
+            case 2:
+            {
+                // gradient to input weight; each class updates its own columns
+                Matrix<ElemType>& grdToWgt = InputRef(EMBEDDINGMATRIX).GradientAsMatrix();
+                bool parallel = !m_classWordRangesOverlap && grdToWgt.GetMatrixType() == MatrixType::DENSE;
+#pragma omp parallel for schedule(dynamic) if (parallel)
+                for (long long g = 0; g < numGroups; g++)
+                {
+                    const ClassGroup& group = m_classGroups[g];
+                    Matrix<ElemType> obs = m_groupedObs.ColumnSlice(group.begin, group.end - group.begin);
+                    Matrix<ElemType> grd_to_wgt_c = grdToWgt.ColumnSlice(group.lft_bnd, group.nbr_wrd);
+                    Matrix<ElemType>::MultiplyAndAdd(obs, false, ClassBlock(m_grdToSoftMaxInput, group), true, grd_to_wgt_c);
+                }
+                break;
+            }
+            case 3:
+            {
+                // (class softmax - 1 at the class) * gradient, per frame
+                ElemType* grd = InputRef(CLASSPROBINDATA).Gradient().Data();
+                const ElemType* clsSoftmax = m_clsSoftmax.Data();
+                const ElemType gradient = Gradient().Get00Element();
+                const size_t nbrCls = m_nbrCls;
+#pragma omp parallel for schedule(dynamic)
+                for (long long g = 0; g < numGroups; g++)
+                {
+                    const ClassGroup& group = m_classGroups[g];
+                    for (size_t k = group.begin; k < group.end; k++)
+                    {
+                        ElemType* grd_t = grd + m_groupedFrames[k] * nbrCls;
+                        const ElemType* clsSoftmax_t = clsSoftmax + m_groupedFrames[k] * nbrCls;
+                        for (size_t i = 0; i < nbrCls; i++)
+                            grd_t[i] = clsSoftmax_t[i] * gradient;
+                        grd_t[group.c_t] -= gradient;
+                    }
+                }
+                break;
+            }
+        }
     }
 
+public:
     virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
     {
         Base::Validate(isFinalValidationPass);
@@ -1713,6 +1968,16 @@ protected:
 
     size_t m_nbrCls;
     size_t m_totalNbrWords;
+
+    // frames grouped by class, see ForwardPropGroupedByClass()
+    bool m_groupByClass;                    // the concatenated buffers are ordered by class
+    std::vector<ClassGroup> m_classGroups;  // the classes that occur in the minibatch
+    std::vector<size_t> m_groupedFrames;    // column index of each frame, in class order
+    std::vector<size_t> m_targetOffsets;    // offset of each frame's word in the concatenated buffers
+    Matrix<ElemType> m_groupedFrameIndices; // m_groupedFrames as a [1 x numFrames] map for gathering/scattering columns
+    Matrix<ElemType> m_groupedObs;          // hidden activations in class order
+    Matrix<ElemType> m_grdToObs;            // gradient to the hidden activations in class order
+    bool m_classWordRangesOverlap;
 };
 
 template class ClassBasedCrossEntropyWithSoftmaxNode<float>;
@@ -2227,6 +2492,8 @@ protected:
 // -----------------------------------------------------------------------
 // DropoutNode (input) -- perform drop-out
 // Output is scaled such that no post-scaling is necessary.
+// On the CPU the mask is kept with one bit per element (see PackedMaskRows()),
+// and generated and applied by fused kernels; on the GPU it is a matrix of 0/scale values.
 // -----------------------------------------------------------------------
 template <class ElemType>
 class DropoutNode : public ComputationNode<ElemType>, public NumInputs<1>, public DropoutNodeBase, public RngUser
@@ -2256,17 +2523,21 @@ public:
 
         if (InputRef(0).IsGradientInitializedBy(this))
         {
-            if (IsEnabled())
-                sliceInput0Grad.AssignElementProductOf(sliceOutputGrad, DataFor(*m_maskOfDropout, fr));
-            else
+            if (!IsEnabled())
                 sliceInput0Grad.AssignValuesOf(sliceOutputGrad);
+            else if (HasPackedMask())
+                sliceInput0Grad.AssignDropoutGradientOf(sliceOutputGrad, DataFor(*m_maskOfDropout, fr), GetDropoutScale());
+            else
+                sliceInput0Grad.AssignElementProductOf(sliceOutputGrad, DataFor(*m_maskOfDropout, fr));
         }
         else
         {
-            if (IsEnabled())
-                sliceInput0Grad.AddElementProductOf(sliceOutputGrad, DataFor(*m_maskOfDropout, fr));
-            else
+            if (!IsEnabled())
                 sliceInput0Grad += sliceOutputGrad;
+            else if (HasPackedMask())
+                sliceInput0Grad.AddDropoutGradientOf(sliceOutputGrad, DataFor(*m_maskOfDropout, fr), GetDropoutScale());
+            else
+                sliceInput0Grad.AddElementProductOf(sliceOutputGrad, DataFor(*m_maskOfDropout, fr));
         }
     }
 
@@ -2281,7 +2552,9 @@ public:
     {
         Base::UpdateFunctionMBSize();
         // resize temporaries to their proper size
-        if (IsEnabled())
+        if (IsEnabled() && HasPackedMask())
+            m_maskOfDropout->Resize(PackedMaskRows<ElemType>(Input(0)->Value().GetNumRows()), Input(0)->Value().GetNumCols());
+        else if (IsEnabled())
             m_maskOfDropout->Resize(Input(0)->Value());
     }
 
@@ -2294,11 +2567,18 @@ public:
         {
             sliceOutputValue.SetValue(sliceInput0Value);
         }
+        else if (HasPackedMask())
+        {
+            // determine drop-out mask for this minibatch and apply it, in one pass
+            auto sliceMask = DataFor(*m_maskOfDropout, fr);
+            sliceOutputValue.AssignDropoutOf(sliceInput0Value, sliceMask, (ElemType)GetDropoutRate(), GetDropoutScale(), GetRNGHandle());
+            UpdateRngOffset(GetRngOffset() + sliceInput0Value.GetNumElements());
+        }
         else
         {
             // determine drop-out mask for this minibatch
             auto sliceMask = DataFor(*m_maskOfDropout, fr);
-            sliceMask.SetUniformRandomMask((ElemType)GetDropoutRate(), (ElemType)(1.0 / (1.0 - GetDropoutRate())) /*pre-scaled*/, GetRNGHandle());
+            sliceMask.SetUniformRandomMask((ElemType)GetDropoutRate(), GetDropoutScale() /*pre-scaled*/, GetRNGHandle());
             // apply dropout mask
             sliceOutputValue.AssignElementProductOf(sliceMask, sliceInput0Value);
             UpdateRngOffset(GetRngOffset() + sliceMask.GetNumElements());
@@ -2330,10 +2610,12 @@ public:
     virtual void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool)
     {
         Base::RequestMatricesBeforeForwardProp(matrixPool);
-        RequestMatrixFromPool(m_maskOfDropout, matrixPool);
+        size_t sampleSize = GetSampleLayout().GetNumElements();
+        RequestMatrixFromPool(m_maskOfDropout, matrixPool, HasPackedMask() ? PackedMaskRows<ElemType>(sampleSize) : sampleSize, HasMBLayout());
     }
 
     // release gradient and temp matrices that no longer needed after all the children's gradients are computed.
+    // The mask is needed until this node's own backprop, and is shared with other requests of the pool afterwards.
     virtual void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool)
     {
         Base::ReleaseMatricesAfterBackprop(matrixPool);
@@ -2341,6 +2623,17 @@ public:
     }
 
 private:
+    bool HasPackedMask() const
+    {
+        return m_deviceId == CPUDEVICE;
+    }
+
+    // pre-scaling of the kept values, such that no post-scaling is necessary
+    ElemType GetDropoutScale() const
+    {
+        return (ElemType)(1.0 / (1.0 - GetDropoutRate()));
+    }
+
     shared_ptr<Matrix<ElemType>> m_maskOfDropout;
 };
 
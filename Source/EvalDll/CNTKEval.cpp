@@ -15,6 +15,7 @@
 #include "Actions.h"
 #include "CNTKEval.h"
 #include "CPUMatrix.h" // for SetNumThreads()
+#include "CPUNumaBinding.h"
 #include "SimpleOutputWriter.h"
 #include "NDLNetworkBuilder.h"
 #ifdef LEAKDETECT
@@ -24,6 +25,9 @@
 #include "InputAndParamNodes.h"
 #include "latticearchive.h"
 #include <limits>
+#include <algorithm>
+#include <cstring>
+#include <memory>
 #include "RecurrentNodes.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -34,9 +38,16 @@ void CNTKEvalBase<ElemType>::Init(const std::string& config)
 {
     m_config.Parse(config);
     size_t nThreads = m_config("numCPUThreads", "1");
-    CPUMatrix<ElemType>::SetNumThreads(nThreads);
+    wstring numaBindingMode = m_config(L"numaBinding", L"none");
+    auto numaBinding = ParseNumaBindingMode(numaBindingMode);
+    if (numaBinding != NumaBindingMode::None)
+        CPUNumaBinding::Bind(numaBinding, (int)nThreads);
+    else
+        CPUMatrix<ElemType>::SetNumThreads(nThreads);
 
     Globals::SetShareNodeValueMatrices(m_config(L"shareNodeValueMatrices", true));
+    wstring compiledNetworkCacheDir = m_config(L"compiledNetworkCacheDir", L"");
+    Globals::SetCompiledNetworkCacheDirectory(compiledNetworkCacheDir);
 }
 
 
@@ -300,76 +311,215 @@ VariableSchema CNTKEvalExtended<ElemType>::GetInputSchema() const
     return inputLayouts;
 }
 
+// Lets a matrix use a caller's buffer as its storage for the lifetime of this object. The matrix gets its own
+// storage back afterwards, since a matrix on an external buffer cannot be resized by later calls.
+template <typename ElemType>
+class ScopedExternalBuffer
+{
+public:
+    ScopedExternalBuffer(Matrix<ElemType>& matrix, size_t numRows, size_t numCols, ElemType* data)
+        : m_matrix(matrix), m_ownStorage(std::move(matrix))
+    {
+        m_matrix = Matrix<ElemType>(numRows, numCols, data, CPUDEVICE, matrixFlagDontOwnBuffer);
+    }
+
+    ~ScopedExternalBuffer()
+    {
+        m_matrix = std::move(m_ownStorage);
+    }
+
+private:
+    Matrix<ElemType>& m_matrix;
+    Matrix<ElemType> m_ownStorage;
+};
+
+// Validates the buffer of one input sequence and returns its number of samples.
+template <typename ElemType, template<typename> class ValueContainer>
+static size_t GetNumSamples(const ValueBuffer<ElemType, ValueContainer>& buffer, MatrixType type, size_t numRows, const wstring& inputName)
+{
+    if (buffer.m_buffer.data() == nullptr)
+        RuntimeError("Input %ls: Buffer is not allocated.", inputName.c_str());
+    if (type == MatrixType::DENSE)
+    {
+        if (buffer.m_buffer.size() % numRows != 0)
+            RuntimeError("Input %ls: Expected input data to be a multiple of %" PRIu64 ", but it is %" PRIu64 ".", 
+                         inputName.c_str(), numRows, buffer.m_buffer.size());
+        if (buffer.m_buffer.size() == 0)
+            RuntimeError("Input %ls: Expected at least one element.", inputName.c_str());
+    }
+    else if (type == MatrixType::SPARSE)
+    {
+        if (buffer.m_colIndices.data() == nullptr)
+            RuntimeError("Input %ls: Due to sparse input format, expected colIndices array, but was nullptr.", inputName.c_str());
+        if (buffer.m_indices.data() == nullptr)
+            RuntimeError("Input %ls: Due to sparse input format, expected Indices array, but was nullptr.", inputName.c_str());
+        if (buffer.m_colIndices.size() < 2)
+            RuntimeError("Input %ls: Expected at least one element (2 entries in colIndices array).", inputName.c_str());
+        if (buffer.m_colIndices[0] != 0)
+            RuntimeError("Input %ls: First element of column indices must be 0", inputName.c_str());
+        if (buffer.m_colIndices[buffer.m_colIndices.size() - 1] != buffer.m_indices.size())
+            RuntimeError("Input %ls: Last element of column indices must be equal to the size of indices (%ld), but was %d", 
+                         inputName.c_str(), buffer.m_indices.size(), 
+                         buffer.m_colIndices[buffer.m_colIndices.size() - 1]);
+    }
+
+    size_t numCols = type == MatrixType::DENSE ? buffer.m_buffer.size() / numRows : buffer.m_colIndices.size() - 1;
+    if (numCols < 1)
+        RuntimeError("Input: the number of column must be greater than or equal to 1.");
+    return numCols;
+}
+
 template<typename ElemType>
 template<template<typename> class ValueContainer>
-void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<ElemType, ValueContainer> >& inputs, std::vector<ValueBuffer<ElemType, ValueContainer> >& outputs, bool resetRNN)
+void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<ElemType, ValueContainer> >* inputs, std::vector<ValueBuffer<ElemType, ValueContainer> >* outputs,
+                                              const std::vector<bool>& sequenceStarts)
 {
     if (!m_started)
         RuntimeError("ForwardPass() called before StartForwardEvaluation()");
 
-    if (inputs.size() != (size_t)std::distance(m_inputMatrices.begin(), m_inputMatrices.end()))
-        RuntimeError("Expected %d inputs, but got %d.", (int)std::distance(m_inputMatrices.begin(), m_inputMatrices.end()), (int)inputs.size());
+    const size_t numSequences = sequenceStarts.size();
+    if (numSequences == 0)
+        RuntimeError("Expected at least one sequence.");
 
-    if (outputs.size() != m_outputNodes.size())
-        RuntimeError("Expected %d outputs, but got %d.", (int)m_outputNodes.size(), (int)outputs.size());
+    const size_t numInputs = (size_t)std::distance(m_inputMatrices.begin(), m_inputMatrices.end());
+    for (size_t s = 0; s < numSequences; ++s)
+    {
+        if (inputs[s].size() != numInputs)
+            RuntimeError("Expected %d inputs, but got %d.", (int)numInputs, (int)inputs[s].size());
+        if (outputs[s].size() != m_outputNodes.size())
+            RuntimeError("Expected %d outputs, but got %d.", (int)m_outputNodes.size(), (int)outputs[s].size());
+    }
 
+    // Inputs with the same dynamic axis share their layout, and must agree on the lengths of the sequences.
+    std::map<const MBLayout*, std::vector<size_t>> sequenceLengths;
+    std::vector<std::unique_ptr<ScopedExternalBuffer<ElemType>>> externalBuffers; // released after the outputs have been read
     size_t i = 0;
     for (auto& inputNode : m_inputNodes)
     {
-        // const cast: The matrix class takes this over without copying and could theoretically change the contents,
-        // though it doesn't in this case.
-        auto& buffer = const_cast<ValueBuffer<ElemType, ValueContainer>&>(inputs[i]);
         auto matrix = dynamic_pointer_cast<Matrix<ElemType>>(inputNode->ValuePtr());
         auto type = matrix->GetMatrixType();
         size_t numRows = inputNode->GetSampleLayout().GetNumElements();
 
-        if (buffer.m_buffer.data() == nullptr)
-            RuntimeError("Input %ls: Buffer is not allocated.", m_inputNodes[i]->GetName().c_str());
-        if (type == MatrixType::DENSE)
+        std::vector<size_t> lengths(numSequences);
+        for (size_t s = 0; s < numSequences; ++s)
+            lengths[s] = GetNumSamples(inputs[s][i], type, numRows, inputNode->GetName());
+        size_t numTimeSteps = *std::max_element(lengths.begin(), lengths.end());
+        size_t numCols = numTimeSteps * numSequences;
+
+        const auto& pMBLayout = inputNode->GetMBLayout();
+        auto known = sequenceLengths.find(pMBLayout.get());
+        if (known == sequenceLengths.end())
         {
-            if (buffer.m_buffer.size() % numRows != 0)
-                RuntimeError("Input %ls: Expected input data to be a multiple of %" PRIu64 ", but it is %" PRIu64 ".", 
-                             m_inputNodes[i]->GetName().c_str(), numRows, buffer.m_buffer.size());
-            if (buffer.m_buffer.size() == 0)
-                RuntimeError("Input %ls: Expected at least one element.", m_inputNodes[i]->GetName().c_str());
+            const auto& previousLengths = m_previousSequenceLengths[pMBLayout.get()];
+            size_t previousNumTimeSteps = previousLengths.empty() ? 0 : *std::max_element(previousLengths.begin(), previousLengths.end());
+            // A recurrent node carries its state over in the layout of the previous call, one column per parallel sequence.
+            bool continuesSequence = std::find(sequenceStarts.begin(), sequenceStarts.end(), false) != sequenceStarts.end();
+            if (continuesSequence && !previousLengths.empty() && numSequences != previousLengths.size())
+                RuntimeError("Input %ls: Sequences cannot be continued with %d parallel sequences, since the previous call had %d.",
+                             inputNode->GetName().c_str(), (int)numSequences, (int)previousLengths.size());
+
+            pMBLayout->Init(numSequences, numTimeSteps);
+            for (size_t s = 0; s < numSequences; ++s)
+            {
+                // A recurrent node continues a sequence from the last time steps of the previous minibatch.
+                if (!sequenceStarts[s] && !previousLengths.empty() && previousLengths[s] != previousNumTimeSteps)
+                    RuntimeError("Input %ls: Sequence %d cannot be continued, since it was not a longest sequence of the previous call.",
+                                 inputNode->GetName().c_str(), (int)s);
+
+                // SentinelValueIndicatingUnspecifedSequenceBeginIdx is used to specify the lower bound of look-back step of recurrent nodes
+                pMBLayout->AddSequence(s, s, sequenceStarts[s] ? 0 : SentinelValueIndicatingUnspecifedSequenceBeginIdx, lengths[s]);
+                if (lengths[s] < numTimeSteps)
+                    pMBLayout->AddGap(s, lengths[s], numTimeSteps);
+            }
+            sequenceLengths[pMBLayout.get()] = lengths;
         }
-        else if (type == MatrixType::SPARSE)
+        else if (known->second != lengths)
+            RuntimeError("Input %ls: The sequences must have the same lengths as in the other inputs of the same dynamic axis.", inputNode->GetName().c_str());
+
+        // const cast: The matrix class takes this over without copying and could theoretically change the contents,
+        // though it doesn't in this case.
+        if (type == MatrixType::DENSE && numSequences == 1 && matrix->GetDeviceId() == CPUDEVICE)
         {
-            if (buffer.m_colIndices.data() == nullptr)
-                RuntimeError("Input %ls: Due to sparse input format, expected colIndices array, but was nullptr.", m_inputNodes[i]->GetName().c_str());
-            if (buffer.m_indices.data() == nullptr)
-                RuntimeError("Input %ls: Due to sparse input format, expected Indices array, but was nullptr.", m_inputNodes[i]->GetName().c_str());
-            if (buffer.m_colIndices.size() < 2)
-                RuntimeError("Input %ls: Expected at least one element (2 entries in colIndices array).", m_inputNodes[i]->GetName().c_str());
-            if (buffer.m_colIndices[0] != 0)
-                RuntimeError("Input %ls: First element of column indices must be 0", m_inputNodes[i]->GetName().c_str());
-            if (buffer.m_colIndices[buffer.m_colIndices.size() - 1] != buffer.m_indices.size())
-                RuntimeError("Input %ls: Last element of column indices must be equal to the size of indices (%ld), but was %d", 
-                             m_inputNodes[i]->GetName().c_str(), buffer.m_indices.size(), 
-                             buffer.m_colIndices[buffer.m_colIndices.size() - 1]);
+            // the layout of a single sequence is that of the matrix: use the caller's buffer in place
+            auto& buffer = const_cast<ValueBuffer<ElemType, ValueContainer>&>(inputs[0][i]);
+            externalBuffers.push_back(std::make_unique<ScopedExternalBuffer<ElemType>>(*matrix, numRows, numCols, buffer.m_buffer.data()));
         }
-
-        int numCols = type == MatrixType::DENSE ? buffer.m_buffer.size() / numRows : buffer.m_colIndices.size() - 1;
-        if (numCols < 1)
-            RuntimeError("Input: the number of column must be greater than or equal to 1.");
-        inputNode->GetMBLayout()->Init(1, numCols);
-        
-        // SentinelValueIndicatingUnspecifedSequenceBeginIdx is used to specify the lower bound of look-back step of recurrent nodes
-        inputNode->GetMBLayout()->AddSequence(0, 0, resetRNN ? 0 : SentinelValueIndicatingUnspecifedSequenceBeginIdx, numCols);
-
-        if (type == MatrixType::DENSE)
-            matrix->SetValue(numRows, numCols, matrix->GetDeviceId(), buffer.m_buffer.data(), matrixFlagNormal);
-        else if (type == MatrixType::SPARSE)
+        else if (type == MatrixType::DENSE)
+        {
+            // Interleave the sequences, with sample t of sequence s in column t * numSequences + s. Gaps are zeroed.
+            // On the CPU, this writes into the matrix storage directly; a GPU matrix is uploaded in one piece.
+            std::vector<ElemType> staging;
+            ElemType* data;
+            if (matrix->GetDeviceId() == CPUDEVICE)
+            {
+                matrix->Resize(numRows, numCols);
+                data = matrix->Data();
+            }
+            else
+            {
+                staging.resize(numRows * numCols);
+                data = staging.data();
+            }
+            for (size_t s = 0; s < numSequences; ++s)
+            {
+                const ElemType* sequence = inputs[s][i].m_buffer.data();
+                for (size_t t = 0; t < numTimeSteps; ++t)
+                {
+                    ElemType* column = data + (t * numSequences + s) * numRows;
+                    if (t < lengths[s])
+                        memcpy(column, sequence + t * numRows, numRows * sizeof(ElemType));
+                    else
+                        memset(column, 0, numRows * sizeof(ElemType));
+                }
+            }
+            if (!staging.empty())
+                matrix->SetValue(numRows, numCols, matrix->GetDeviceId(), staging.data(), matrixFlagNormal);
+        }
+        else if (type == MatrixType::SPARSE && numSequences == 1)
         {
             // In the sparse case the m_data layout is identical to CUDA's CSC layout
             // (see http://docs.nvidia.com/cuda/cusparse/#compressed-sparse-column-format-csc).
+            auto& buffer = const_cast<ValueBuffer<ElemType, ValueContainer>&>(inputs[0][i]);
             matrix->SetMatrixFromCSCFormat(buffer.m_colIndices.data(), buffer.m_indices.data(), buffer.m_buffer.data(),
                                            buffer.m_buffer.size(), numRows, numCols);
         }
+        else if (type == MatrixType::SPARSE)
+        {
+            // merge the CSC arrays of the sequences in the interleaved column order; gap columns are empty
+            size_t nnz = 0;
+            for (size_t s = 0; s < numSequences; ++s)
+                nnz += inputs[s][i].m_indices.size();
+            std::vector<CPUSPARSE_INDEX_TYPE> colStarts(numCols + 1);
+            std::vector<CPUSPARSE_INDEX_TYPE> indices;
+            std::vector<ElemType> values;
+            indices.reserve(nnz);
+            values.reserve(nnz);
+            for (size_t t = 0; t < numTimeSteps; ++t)
+            {
+                for (size_t s = 0; s < numSequences; ++s)
+                {
+                    size_t j = t * numSequences + s;
+                    colStarts[j] = (CPUSPARSE_INDEX_TYPE)indices.size();
+                    if (t >= lengths[s])
+                        continue;
+                    const auto& buffer = inputs[s][i];
+                    for (auto k = buffer.m_colIndices[t]; k < buffer.m_colIndices[t + 1]; ++k)
+                    {
+                        indices.push_back(buffer.m_indices[k]);
+                        values.push_back(buffer.m_buffer[k]);
+                    }
+                }
+            }
+            colStarts[numCols] = (CPUSPARSE_INDEX_TYPE)indices.size();
+            matrix->SetMatrixFromCSCFormat(colStarts.data(), indices.data(), values.data(), values.size(), numRows, numCols);
+        }
 
         ++i;
     }
 
+    for (auto& layoutAndLengths : sequenceLengths)
+        m_previousSequenceLengths[layoutAndLengths.first] = std::move(layoutAndLengths.second);
+
     ComputationNetwork::BumpEvalTimeStamp(m_inputNodes);
     this->m_net->ForwardProp(m_outputNodes);
 
@@ -378,55 +528,114 @@ void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<Elem
         auto node = m_outputNodes[i2];
         
         shared_ptr<Matrix<ElemType>> outputMatrix = dynamic_pointer_cast<Matrix<ElemType>>(node->ValuePtr());
-        auto pMBLayout = node->GetMBLayout();
-        if (!pMBLayout)
+        size_t numRows = outputMatrix->GetNumRows();
+
+        // Read the frames from the matrix storage on the CPU. A GPU matrix is downloaded in one piece.
+        std::vector<ElemType> staging;
+        const ElemType* data;
+        if (outputMatrix->GetDeviceId() == CPUDEVICE)
+            data = outputMatrix->Data();
+        else
         {
-            pMBLayout = make_shared<MBLayout>();
-            pMBLayout->InitAsFrameMode(1); // treat this as if we have one single sample
+            staging.resize(outputMatrix->GetNumElements());
+            ElemType* stagingData = staging.data();
+            size_t stagingSize = staging.size();
+            outputMatrix->CopyToArray(stagingData, stagingSize);
+            data = stagingData;
         }
 
-        const auto& seq = pMBLayout->GetAllSequences();
-        if (seq.size() != 1)
-            RuntimeError("Only 1 output sequence supported by this API");
-
-        ValueContainer<ElemType>& vec = outputs[i2].m_buffer;
+        for (size_t s = 0; s < numSequences; ++s)
+            outputs[s][i2].m_buffer.resize(0);
 
-        size_t numElements = outputMatrix->GetNumElements();
-
-        if (vec.capacity() < numElements)
+        auto pMBLayout = node->GetMBLayout();
+        if (!pMBLayout)
         {
-            // Bad luck - we can't reallocate memory of an external object at this point.
-            RuntimeError("Not enough space in output buffer for output '%ls'.", node->GetName().c_str());
+            // an output without dynamic axis is the same for every sequence
+            for (size_t s = 0; s < numSequences; ++s)
+            {
+                ValueContainer<ElemType>& vec = outputs[s][i2].m_buffer;
+                size_t numElements = outputMatrix->GetNumElements();
+                if (vec.capacity() < numElements)
+                    RuntimeError("Not enough space in output buffer for output '%ls'.", node->GetName().c_str());
+                vec.resize(numElements);
+                memcpy(const_cast<ElemType*>(vec.data()), data, numElements * sizeof(ElemType));
+            }
+            continue;
         }
 
-        vec.resize(numElements);
-        ElemType* data = const_cast<ElemType*>(vec.data());
-        outputMatrix->CopyToArray(data, numElements);
+        // The output layout may differ from the input layout (e.g. after a reduction along the sequence); its sequences
+        // are mapped back to the caller's through their ids, which are the indices of the sequences in this call.
+        size_t numParallelSequences = pMBLayout->GetNumParallelSequences();
+        size_t numTimeSteps = pMBLayout->GetNumTimeSteps();
+        for (const auto& seq : pMBLayout->GetAllSequences())
+        {
+            if (seq.seqId == GAP_SEQUENCE_ID)
+                continue;
+            if (seq.seqId >= numSequences)
+                RuntimeError("Output '%ls': Cannot map sequence %d to an input sequence.", node->GetName().c_str(), (int)seq.seqId);
+
+            size_t tBegin = (size_t)std::max(seq.tBegin, (ptrdiff_t)0);
+            size_t tEnd = std::min(seq.tEnd, numTimeSteps);
+            size_t numElements = tEnd > tBegin ? (tEnd - tBegin) * numRows : 0;
+
+            ValueContainer<ElemType>& vec = outputs[seq.seqId][i2].m_buffer;
+            if (vec.capacity() < numElements)
+            {
+                // Bad luck - we can't reallocate memory of an external object at this point.
+                RuntimeError("Not enough space in output buffer for output '%ls'.", node->GetName().c_str());
+            }
+
+            vec.resize(numElements);
+            ElemType* target = const_cast<ElemType*>(vec.data());
+            if (numParallelSequences == 1)
+                memcpy(target, data + tBegin * numRows, numElements * sizeof(ElemType));
+            else
+            {
+                for (size_t t = tBegin; t < tEnd; ++t)
+                    memcpy(target + (t - tBegin) * numRows, data + (t * numParallelSequences + seq.s) * numRows, numRows * sizeof(ElemType));
+            }
+        }
     }
 }
 
 template<typename ElemType>
 void CNTKEvalExtended<ElemType>::ForwardPass(const Values<ElemType>& inputs, Values<ElemType>& outputs)
 {
-    ForwardPassT(inputs, outputs, true);
+    ForwardPassT(&inputs, &outputs, { true });
 }
 
 template<typename ElemType>
 void CNTKEvalExtended<ElemType>::ForwardPass(const Values<ElemType>& inputs, Values<ElemType>& outputs, bool resetRNN)
 {
-    ForwardPassT(inputs, outputs, resetRNN);
+    ForwardPassT(&inputs, &outputs, { resetRNN });
 }
 
 template<typename ElemType>
 void CNTKEvalExtended<ElemType>::ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& outputs)
 {
-    ForwardPassT(inputs, outputs, true);
+    ForwardPassT(&inputs, &outputs, { true });
 }
 
 template<typename ElemType>
 void CNTKEvalExtended<ElemType>::ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& outputs, bool resetRNN)
 {
-    ForwardPassT(inputs, outputs, resetRNN);
+    ForwardPassT(&inputs, &outputs, { resetRNN });
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPass(const std::vector<Values<ElemType>>& inputs, const std::vector<bool>& sequenceStarts, std::vector<Values<ElemType>>& outputs)
+{
+    if (inputs.size() != sequenceStarts.size() || outputs.size() != sequenceStarts.size())
+        RuntimeError("Expected inputs and outputs for %d sequences, but got %d and %d.", (int)sequenceStarts.size(), (int)inputs.size(), (int)outputs.size());
+    ForwardPassT(inputs.data(), outputs.data(), sequenceStarts);
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPass(const std::vector<ValueRefs<ElemType>>& inputs, const std::vector<bool>& sequenceStarts, std::vector<ValueRefs<ElemType>>& outputs)
+{
+    if (inputs.size() != sequenceStarts.size() || outputs.size() != sequenceStarts.size())
+        RuntimeError("Expected inputs and outputs for %d sequences, but got %d and %d.", (int)sequenceStarts.size(), (int)inputs.size(), (int)outputs.size());
+    ForwardPassT(inputs.data(), outputs.data(), sequenceStarts);
 }
 
 template <typename ElemType>
@@ -107,6 +107,10 @@ public:
 
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output, bool resetRNN) override;
 
+    virtual void ForwardPass(const std::vector<Values<ElemType>>& inputs, const std::vector<bool>& sequenceStarts, std::vector<Values<ElemType>>& outputs) override;
+
+    virtual void ForwardPass(const std::vector<ValueRefs<ElemType>>& inputs, const std::vector<bool>& sequenceStarts, std::vector<ValueRefs<ElemType>>& outputs) override;
+
     virtual void Destroy() override;
 
     virtual void CreateNetwork(const std::string& networkDescription) override
@@ -127,9 +131,14 @@ private:
     StreamMinibatchInputs m_inputMatrices;
     bool m_started;
 
+    // sequence lengths of the previous call, per input layout, to validate sequences that continue from there
+    std::map<const MBLayout*, std::vector<size_t>> m_previousSequenceLengths;
+
+    // 'inputs' and 'outputs' point to one set of buffers per sequence
     template<template<typename> class ValueContainer> 
-    void ForwardPassT(const std::vector < ValueBuffer<ElemType, ValueContainer> >& inputs,
-                      std::vector < ValueBuffer<ElemType, ValueContainer> >& outputs, bool resetRNN);
+    void ForwardPassT(const std::vector < ValueBuffer<ElemType, ValueContainer> >* inputs,
+                      std::vector < ValueBuffer<ElemType, ValueContainer> >* outputs,
+                      const std::vector<bool>& sequenceStarts);
 
 };
 } } }
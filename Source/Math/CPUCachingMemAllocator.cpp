@@ -0,0 +1,277 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "CPUCachingMemAllocator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+namespace {
+
+// Every block is preceded by a header of one alignment unit, so that the pool can find the size class on Free().
+struct BlockHeader
+{
+    size_t m_sizeClass;
+    size_t m_requestedSize;
+};
+static_assert(sizeof(BlockHeader) <= CPUCachingMemAllocator::Alignment, "Block header must fit into the alignment.");
+
+const size_t s_numberOfSmallClasses = 16;              // 64, 128, ..., 1024 bytes
+const size_t s_numberOfClassesPerPowerOfTwo = 4;       // 1280, 1536, 1792, 2048, 2560, ...
+const size_t s_smallClassesLimitLog2 = 10;             // 1024 bytes
+const size_t s_numberOfSizeClasses = s_numberOfSmallClasses + (64 - s_smallClassesLimitLog2) * s_numberOfClassesPerPowerOfTwo;
+const size_t s_defaultMaxCachedBytes = (size_t)1 << 30;
+
+const size_t s_parallelZeroFillThreshold = (size_t)1 << 20;
+const size_t s_parallelFirstTouchThreshold = (size_t)1 << 18;
+const size_t s_zeroFillChunkSize = (size_t)1 << 16;
+
+inline size_t FloorLog2(size_t value)
+{
+    size_t result = 0;
+    while (value >>= 1)
+        result++;
+    return result;
+}
+
+void* SystemAlloc(size_t size)
+{
+#ifdef _WIN32
+    return _aligned_malloc(size, CPUCachingMemAllocator::Alignment);
+#else
+    void* p = nullptr;
+    return posix_memalign(&p, CPUCachingMemAllocator::Alignment, size) == 0 ? p : nullptr;
+#endif
+}
+
+void SystemFree(void* p)
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+// Large buffers are zeroed by all threads. The static schedule matches the one of the CPUMatrix kernels.
+void ZeroFill(void* p, size_t size, size_t parallelThreshold = s_parallelZeroFillThreshold)
+{
+    if (size < parallelThreshold)
+    {
+        memset(p, 0, size);
+        return;
+    }
+
+    long numberOfChunks = (long)((size + s_zeroFillChunkSize - 1) / s_zeroFillChunkSize);
+#pragma omp parallel for schedule(static)
+    for (long i = 0; i < numberOfChunks; i++)
+    {
+        size_t begin = i * s_zeroFillChunkSize;
+        memset((char*)p + begin, 0, std::min(s_zeroFillChunkSize, size - begin));
+    }
+}
+
+inline BlockHeader* GetHeader(void* p)
+{
+    return reinterpret_cast<BlockHeader*>((char*)p - CPUCachingMemAllocator::Alignment);
+}
+
+inline void* GetPayload(void* block)
+{
+    return (char*)block + CPUCachingMemAllocator::Alignment;
+}
+
+}
+
+CPUCachingMemAllocator& CPUCachingMemAllocator::Instance()
+{
+    // Intentionally leaked, see the header.
+    static CPUCachingMemAllocator* s_instance = new CPUCachingMemAllocator();
+    return *s_instance;
+}
+
+CPUCachingMemAllocator::CPUCachingMemAllocator()
+    : m_freeBlocks(s_numberOfSizeClasses), m_maxCachedBytes(s_defaultMaxCachedBytes), m_statistics{}, m_parallelFirstTouch(false)
+{
+}
+
+/*static*/ size_t CPUCachingMemAllocator::GetSizeClass(size_t size)
+{
+    if (size <= ((size_t)1 << s_smallClassesLimitLog2))
+        return size == 0 ? 0 : (size - 1) / Alignment;
+
+    // size is in (2^p, 2^(p+1)], split into four classes.
+    size_t p = FloorLog2(size - 1);
+    size_t step = (size_t)1 << (p - 2);
+    size_t k = (size - 1 - ((size_t)1 << p)) / step;
+    return s_numberOfSmallClasses + (p - s_smallClassesLimitLog2) * s_numberOfClassesPerPowerOfTwo + k;
+}
+
+/*static*/ size_t CPUCachingMemAllocator::GetClassSize(size_t sizeClass)
+{
+    if (sizeClass < s_numberOfSmallClasses)
+        return (sizeClass + 1) * Alignment;
+
+    size_t p = s_smallClassesLimitLog2 + (sizeClass - s_numberOfSmallClasses) / s_numberOfClassesPerPowerOfTwo;
+    size_t k = (sizeClass - s_numberOfSmallClasses) % s_numberOfClassesPerPowerOfTwo;
+    return ((size_t)1 << p) + (k + 1) * ((size_t)1 << (p - 2));
+}
+
+void* CPUCachingMemAllocator::Malloc(size_t size)
+{
+    return Malloc(size, /*zeroFill=*/false);
+}
+
+void* CPUCachingMemAllocator::Malloc(size_t size, bool zeroFill)
+{
+    if (size == 0)
+        return nullptr;
+
+    if (size > SIZE_MAX / 2)
+        throw std::bad_alloc();
+
+    size_t sizeClass = GetSizeClass(size);
+    size_t classSize = GetClassSize(sizeClass);
+
+    void* block = nullptr;
+    bool isNewBlock = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_statistics.m_numberOfAllocations++;
+        auto& freeBlocks = m_freeBlocks[sizeClass];
+        if (!freeBlocks.empty())
+        {
+            block = freeBlocks.back();
+            freeBlocks.pop_back();
+            m_statistics.m_numberOfCacheHits++;
+            m_statistics.m_cachedBytes -= classSize;
+        }
+        m_statistics.m_requestedBytesInUse += size;
+        m_statistics.m_bytesInUse += classSize;
+    }
+
+    if (!block)
+    {
+        block = SystemAlloc(Alignment + classSize);
+        if (!block)
+        {
+            // Give the cached blocks back and retry once.
+            ReleaseCachedMemory();
+            block = SystemAlloc(Alignment + classSize);
+        }
+
+        if (!block)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_statistics.m_requestedBytesInUse -= size;
+            m_statistics.m_bytesInUse -= classSize;
+            throw std::bad_alloc();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_statistics.m_peakBytes = std::max(m_statistics.m_peakBytes, m_statistics.m_bytesInUse + m_statistics.m_cachedBytes);
+        isNewBlock = true;
+    }
+
+    auto header = reinterpret_cast<BlockHeader*>(block);
+    header->m_sizeClass = sizeClass;
+    header->m_requestedSize = size;
+
+    void* p = GetPayload(block);
+    if (isNewBlock && m_parallelFirstTouch && classSize >= s_parallelFirstTouchThreshold)
+        ZeroFill(p, classSize, s_parallelFirstTouchThreshold); // places the pages, and zeroes them as a side effect
+    else if (zeroFill)
+        ZeroFill(p, size);
+    return p;
+}
+
+void CPUCachingMemAllocator::Free(void* p)
+{
+    if (!p)
+        return;
+
+    auto header = GetHeader(p);
+    size_t sizeClass = header->m_sizeClass;
+    size_t classSize = GetClassSize(sizeClass);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_statistics.m_requestedBytesInUse -= header->m_requestedSize;
+        m_statistics.m_bytesInUse -= classSize;
+        if (m_statistics.m_cachedBytes + classSize <= m_maxCachedBytes)
+        {
+            m_freeBlocks[sizeClass].push_back(header);
+            m_statistics.m_cachedBytes += classSize;
+            return;
+        }
+    }
+
+    SystemFree(header);
+}
+
+void CPUCachingMemAllocator::SetMaxCachedBytes(size_t maxCachedBytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_maxCachedBytes = maxCachedBytes;
+    }
+    TrimCache(maxCachedBytes);
+}
+
+size_t CPUCachingMemAllocator::GetMaxCachedBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_maxCachedBytes;
+}
+
+void CPUCachingMemAllocator::ReleaseCachedMemory()
+{
+    TrimCache(0);
+}
+
+// Releases cached blocks, biggest first, until at most maxCachedBytes are cached.
+void CPUCachingMemAllocator::TrimCache(size_t maxCachedBytes)
+{
+    std::vector<void*> blocks;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t sizeClass = m_freeBlocks.size(); sizeClass-- > 0 && m_statistics.m_cachedBytes > maxCachedBytes;)
+        {
+            auto& freeBlocks = m_freeBlocks[sizeClass];
+            size_t classSize = GetClassSize(sizeClass);
+            while (!freeBlocks.empty() && m_statistics.m_cachedBytes > maxCachedBytes)
+            {
+                blocks.push_back(freeBlocks.back());
+                freeBlocks.pop_back();
+                m_statistics.m_cachedBytes -= classSize;
+            }
+        }
+    }
+
+    for (auto block : blocks)
+        SystemFree(block);
+}
+
+CPUMemoryPoolStatistics CPUCachingMemAllocator::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+// Resets the counters, the byte counts reflect the current state of the pool.
+void CPUCachingMemAllocator::ResetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_statistics.m_numberOfAllocations = 0;
+    m_statistics.m_numberOfCacheHits = 0;
+    m_statistics.m_peakBytes = m_statistics.m_bytesInUse + m_statistics.m_cachedBytes;
+}
+} } }
@@ -0,0 +1,113 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "MemAllocator.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+#ifdef _WIN32
+#ifdef MATH_EXPORTS
+#define MATH_API __declspec(dllexport)
+#else
+#define MATH_API __declspec(dllimport)
+#endif
+#else // no DLLs on Linux
+#define MATH_API
+#endif
+
+// Statistics of the CPU memory pool.
+struct CPUMemoryPoolStatistics
+{
+    size_t m_numberOfAllocations; // number of Malloc calls
+    size_t m_numberOfCacheHits;   // number of allocations served by a cached block
+    size_t m_requestedBytesInUse; // bytes requested by the blocks currently in use
+    size_t m_bytesInUse;          // size class bytes of the blocks currently in use
+    size_t m_cachedBytes;         // bytes of the free blocks kept for reuse
+    size_t m_peakBytes;           // peak of the bytes held by the pool (in use + cached)
+
+    // Fraction of allocations that did not have to go to the system allocator.
+    double HitRate() const
+    {
+        return m_numberOfAllocations == 0 ? 0.0 : (double)m_numberOfCacheHits / m_numberOfAllocations;
+    }
+
+    // Fraction of the memory held by the pool that is not used by requested data:
+    // rounding up to the size classes plus the cached free blocks.
+    double Fragmentation() const
+    {
+        size_t heldBytes = m_bytesInUse + m_cachedBytes;
+        return heldBytes == 0 ? 0.0 : 1.0 - (double)m_requestedBytesInUse / heldBytes;
+    }
+};
+
+// Caching allocator for the buffers of CPU matrices.
+// Blocks are 64-byte aligned and rounded up to a size class: multiples of 64 bytes up to 1KB, then four classes
+// per power of two. Freed blocks are kept in per class free lists and handed out again by the next allocation
+// of the same class, up to a limit on the total number of cached bytes, above which blocks go back to the system.
+// Blocks are not initialized unless zero filling is requested.
+// The pool is thread safe. All blocks must be returned through Free() of the same pool.
+class MATH_API CPUCachingMemAllocator : public MemAllocator
+{
+public:
+    // The pool used by CPUMatrix and CPUSparseMatrix. It is never destroyed, so that matrices
+    // with static storage duration can release their buffers at any time.
+    static CPUCachingMemAllocator& Instance();
+
+    template <class T>
+    static T* Allocate(size_t numElements, bool zeroFill = false)
+    {
+        return static_cast<T*>(Instance().Malloc(numElements * sizeof(T), zeroFill));
+    }
+
+    template <class T>
+    static void Deallocate(T* p)
+    {
+        Instance().Free(p);
+    }
+
+    void* Malloc(size_t size) override;
+    void* Malloc(size_t size, bool zeroFill);
+    void Free(void* p) override;
+
+    // Limits the number of bytes kept in the free lists. 0 disables caching.
+    void SetMaxCachedBytes(size_t maxCachedBytes);
+    size_t GetMaxCachedBytes() const;
+
+    // Returns all cached blocks to the system.
+    void ReleaseCachedMemory();
+
+    CPUMemoryPoolStatistics GetStatistics() const;
+    void ResetStatistics();
+
+    // When enabled, large blocks fresh from the system are first touched by all OpenMP threads with a static
+    // schedule, so that with bound threads (see CPUNumaBinding) their pages are placed on the node of the thread
+    // that processes them.
+    void SetParallelFirstTouch(bool enable) { m_parallelFirstTouch = enable; }
+    bool GetParallelFirstTouch() const { return m_parallelFirstTouch; }
+
+    static const size_t Alignment = 64;
+
+private:
+    CPUCachingMemAllocator();
+    CPUCachingMemAllocator(const CPUCachingMemAllocator&) = delete;
+    CPUCachingMemAllocator& operator=(const CPUCachingMemAllocator&) = delete;
+
+    static size_t GetSizeClass(size_t size);
+    static size_t GetClassSize(size_t sizeClass);
+
+    void TrimCache(size_t maxCachedBytes);
+
+    mutable std::mutex m_mutex;
+    std::vector<std::vector<void*>> m_freeBlocks; // [size class] cached blocks
+    size_t m_maxCachedBytes;
+    CPUMemoryPoolStatistics m_statistics;
+    std::atomic<bool> m_parallelFirstTouch;
+};
+} } }
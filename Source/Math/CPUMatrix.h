@@ -14,6 +14,7 @@
 #include <ctime>
 #include <limits.h>
 #include "QuantizedOperations.h"
+#include "ReducedPrecision.h"
 
 //#include "GPUMatrix.h"
 //#include "CPUSparseMatrix.h"
@@ -161,6 +162,8 @@ public:
     void SetGaussianRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed = USE_TIME_BASED_SEED);
     void SetTruncatedNormalRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed = USE_TIME_BASED_SEED);
     void SetUniformRandomMask(const ElemType maskRate, const ElemType scaleValue, RNGHandle& rngHandle);
+    CPUMatrix<ElemType>& AssignDropoutOf(const CPUMatrix<ElemType>& input, CPUMatrix<ElemType>& packedMask, const ElemType dropoutRate, const ElemType scaleValue, RNGHandle& rngHandle);
+    CPUMatrix<ElemType>& AddDropoutGradientOf(const CPUMatrix<ElemType>& gradient, const CPUMatrix<ElemType>& packedMask, const ElemType scaleValue, const ElemType beta);
     void AddGaussianRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed = USE_TIME_BASED_SEED);
 
     CPUMatrix<ElemType> Transpose();
@@ -418,6 +421,7 @@ public:
 public:
     // This functions do not depend on <ElemType>, i.e. you can call them on any <ElemType>
     static int SetNumThreads(int numThreads);
+    static void SetNumThreadsForCurrentThread(int numThreads); // limits only the parallel regions started by the calling thread
     static int GetMaxNumThreads();
 
     static void SetCompatibleMode();
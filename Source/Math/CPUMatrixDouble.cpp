@@ -9,4 +9,5 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
     // explicit instantiations, due to CPUMatrix being too big and causing VS2015 cl crash.
     template class MATH_API CPUMatrix<double>;
+    template class MATH_API ReducedPrecisionMultiplier<double>;
 }}}
\ No newline at end of file
@@ -21,4 +21,5 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
     // explicit instantiations, due to CPUMatrix being too big and causing VS2015 cl crash.
     template class MATH_API CPUMatrix<float>;
+    template class MATH_API ReducedPrecisionMultiplier<float>;
 }}}
\ No newline at end of file
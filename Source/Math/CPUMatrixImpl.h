@@ -12,6 +12,7 @@
 
 #include "CPUMatrix.h"
 #include "TensorOps.h"
+#include "PerformanceProfiler.h"
 #include <assert.h>
 #include <stdexcept>
 #include <omp.h>
@@ -126,6 +127,14 @@ static ElemType* NewArray(size_t n)
     return p;
 }
 
+// helper to allocate the buffer of a matrix from the CPU memory pool, freed by the matrix storage
+// The buffer is 64-byte aligned and only initialized if zeroFill is set. Like NewArray, it has an even number of elements.
+template <class ElemType>
+static ElemType* NewPooledArray(size_t n, bool zeroFill)
+{
+    return CPUCachingMemAllocator::Allocate<ElemType>(AsMultipleOf(n, 2), zeroFill);
+}
+
 template <class ElemType>
 CPUMatrix<ElemType>::CPUMatrix(const size_t numRows, const size_t numCols)
 {
@@ -137,7 +146,7 @@ CPUMatrix<ElemType>::CPUMatrix(const size_t numRows, const size_t numCols)
 
     if (GetNumElements() != 0)
     {
-        SetBuffer(NewArray<ElemType>(GetNumElements()), GetNumElements() * sizeof(ElemType));
+        SetBuffer(NewPooledArray<ElemType>(GetNumElements(), /*zeroFill=*/true), GetNumElements() * sizeof(ElemType));
     }
 }
 
@@ -875,7 +884,8 @@ void CPUMatrix<ElemType>::SetValue(const size_t numRows, const size_t numCols, E
     if (matrixFlags & matrixFlagDontOwnBuffer)
     {
         // free previous array allocation if any before overwriting
-        delete[] Buffer();
+        if (!HasExternalBuffer())
+            CPUCachingMemAllocator::Deallocate(Buffer());
 
         m_numRows = numRows;
         m_numCols = numCols;
@@ -1028,33 +1038,85 @@ void CPUMatrix<ElemType>::SetUniformRandomValue(const ElemType low, const ElemTy
 }
 
 
+// Maps a word of the random stream to the open interval (0, 1), so that log(u) and log(1 - u) are finite.
+// For float only 23 bits are used, so that the result is exact and cannot round to 1.
 template <class ElemType>
-void CPUMatrix<ElemType>::SetUniformRandomValue(RNGHandle& rngHandle, const ElemType low, const ElemType high)
+static inline ElemType UniformFromRandomWord(uint32_t word)
 {
-    if (IsEmpty())
-        LogicError("SetUniformRandomValue: Matrix is empty.");
+    if (sizeof(ElemType) == sizeof(float))
+        return (ElemType)(((word >> 9) + 0.5f) * (1.0f / 8388608));
+    else
+        return (ElemType)((word + 0.5) * (1.0 / 4294967296.0));
+}
+
+// Fills data[0..n) from the next words of the stream of 'rng', which is then advanced by 'consumed' (>= n) words.
+// transform(out, words, count) computes 'count' elements from as many words (rounded up to a multiple of 2).
+// Batches of elements are generated in parallel, each from its own range of the stream, so that
+// the result does not depend on the number of threads.
+template <class ElemType, class TransformFunction>
+static void GenerateFromRandomStream(CPURNGHandle& rng, ElemType* data, size_t n, uint64_t consumed, const TransformFunction& transform)
+{
+    const size_t c_batchSize = 1024; // even, so that pairs of words do not straddle batches
+    const uint64_t offset = rng.Offset();
+    const long long numBatches = (long long)((n + c_batchSize - 1) / c_batchSize);
+
+#pragma omp parallel for if (numBatches > 1)
+    for (long long batch = 0; batch < numBatches; batch++)
+    {
+        uint32_t words[c_batchSize];
+        size_t begin = (size_t)batch * c_batchSize;
+        size_t count = std::min(c_batchSize, n - begin);
+        rng.Generate(offset + begin, AsMultipleOf(count, 2), words);
+        transform(data + begin, words, count);
+    }
+
+    rng.Advance(consumed);
+}
 
+static CPURNGHandle& GetCPURNGHandle(RNGHandle& rngHandle)
+{
     CPURNGHandle* cpuRNGHandle = dynamic_cast<CPURNGHandle*>(&rngHandle);
     if (cpuRNGHandle == nullptr)
         LogicError("rngHandle must be a CPURNGHandle.");
+    return *cpuRNGHandle;
+}
 
-    boost::random::uniform_real_distribution<ElemType> r(low, high);
-    std::generate(Data(), Data() + GetNumElements(), [&cpuRNGHandle, &r]() {return r(cpuRNGHandle->Generator()); });
+template <class ElemType>
+void CPUMatrix<ElemType>::SetUniformRandomValue(RNGHandle& rngHandle, const ElemType low, const ElemType high)
+{
+    if (IsEmpty())
+        LogicError("SetUniformRandomValue: Matrix is empty.");
+
+    size_t n = GetNumElements();
+    GenerateFromRandomStream(GetCPURNGHandle(rngHandle), Data(), n, n, [low, high](ElemType* out, const uint32_t* words, size_t count)
+    {
+        const ElemType range = high - low;
+        for (size_t i = 0; i < count; i++)
+            out[i] = low + range * UniformFromRandomWord<ElemType>(words[i]);
+    });
 }
 
+// Box-Muller transform: every pair of words gives a pair of independent normally distributed values.
+// Consumes an even number of words, as the GPU version does.
 template <class ElemType>
 void CPUMatrix<ElemType>::SetGaussianRandomValue(RNGHandle& rngHandle, const ElemType mean, const ElemType stdev)
 {
     if (IsEmpty())
         LogicError("SetGaussianRandomValue: Matrix is empty.");
 
-    CPURNGHandle* cpuRNGHandle = dynamic_cast<CPURNGHandle*>(&rngHandle);
-    if (cpuRNGHandle == nullptr)
-        LogicError("rngHandle must be a CPURNGHandle.");
-
-    boost::random::normal_distribution<ElemType> r(mean, stdev);
-    auto n = AsMultipleOf(GetNumElements(), 2);
-    std::generate(Data(), Data() + n, [&cpuRNGHandle, &r]() {return r(cpuRNGHandle->Generator()); });
+    size_t n = GetNumElements();
+    GenerateFromRandomStream(GetCPURNGHandle(rngHandle), Data(), n, AsMultipleOf(n, 2), [mean, stdev](ElemType* out, const uint32_t* words, size_t count)
+    {
+        const ElemType twoPi = (ElemType)(2 * 3.14159265358979323846);
+        for (size_t i = 0; i < count; i += 2)
+        {
+            ElemType radius = stdev * sqrt(-2 * log(UniformFromRandomWord<ElemType>(words[i])));
+            ElemType angle = twoPi * UniformFromRandomWord<ElemType>(words[i + 1]);
+            out[i] = mean + radius * cos(angle);
+            if (i + 1 < count)
+                out[i + 1] = mean + radius * sin(angle);
+        }
+    });
 }
 
 template <class ElemType>
@@ -1063,12 +1125,12 @@ void CPUMatrix<ElemType>::SetGumbelRandomValue(RNGHandle& rngHandle, const ElemT
     if (IsEmpty())
         LogicError("SetGumbelRandomValue: Matrix is empty.");
 
-    CPURNGHandle* cpuRNGHandle = dynamic_cast<CPURNGHandle*>(&rngHandle);
-    if (cpuRNGHandle == nullptr)
-        LogicError("rngHandle must be a CPURNGHandle.");
-
-    boost::random::uniform_real_distribution<ElemType> r(0, 1);
-    std::generate(Data(), Data() + GetNumElements(), [&cpuRNGHandle, &r, loc, scale]() {return loc - scale * log(-log1p(-r(cpuRNGHandle->Generator()))); });
+    size_t n = GetNumElements();
+    GenerateFromRandomStream(GetCPURNGHandle(rngHandle), Data(), n, n, [loc, scale](ElemType* out, const uint32_t* words, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+            out[i] = loc - scale * log(-log1p(-UniformFromRandomWord<ElemType>(words[i])));
+    });
 }
 
 
@@ -1162,35 +1224,101 @@ void CPUMatrix<ElemType>::SetUniformRandomMask(const ElemType maskRate, const El
     if (IsEmpty())
         LogicError("SetUniformRandomValue: Matrix is empty.");
 
-    CPURNGHandle* cpuRNGHandle = dynamic_cast<CPURNGHandle*>(&rngHandle);
-    if (cpuRNGHandle == nullptr)
-        LogicError("rngHandle must be a CPURNGHandle.");
+    size_t n = GetNumElements();
+    GenerateFromRandomStream(GetCPURNGHandle(rngHandle), Data(), n, n, [maskRate, scaleValue](ElemType* out, const uint32_t* words, size_t count)
+    {
+        // without a branch, which would be mispredicted for half of the elements at typical dropout rates
+        for (size_t i = 0; i < count; i++)
+            out[i] = scaleValue * (ElemType)(UniformFromRandomWord<ElemType>(words[i]) > maskRate);
+    });
+}
 
-    auto& us = *this;
-    boost::random::uniform_real_distribution<ElemType> r(0, 1);
-    long m = (long) GetNumRows(), n = (long) GetNumCols();
-    ElemType v;
-    for (long j = 0; j < n; j++)
+// Dropout with a mask of one bit per element, packed column by column as described at PackedMaskRows().
+// The mask is drawn from the same words of the stream as SetUniformRandomMask() would use, and the stream is advanced by
+// the number of elements. Columns are processed in parallel in batches of c_dropoutBatchSize rows, each from its own range of the stream.
+static const size_t c_dropoutBatchSize = 1024; // multiple of 32, so that batches start at a word of the mask
+
+template <class ElemType>
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignDropoutOf(const CPUMatrix<ElemType>& input, CPUMatrix<ElemType>& packedMask, const ElemType dropoutRate, const ElemType scaleValue, RNGHandle& rngHandle)
+{
+    const size_t rows = input.GetNumRows(), cols = input.GetNumCols();
+    if (packedMask.GetNumRows() != PackedMaskRows<ElemType>(rows) || packedMask.GetNumCols() != cols)
+        InvalidArgument("AssignDropoutOf: The mask has %d x %d elements, expected %d x %d.", (int)packedMask.GetNumRows(), (int)packedMask.GetNumCols(), (int)PackedMaskRows<ElemType>(rows), (int)cols);
+
+    RequireSize(rows, cols);
+    CPURNGHandle& rng = GetCPURNGHandle(rngHandle);
+    const uint64_t offset = rng.Offset();
+    const size_t batchesPerColumn = (rows + c_dropoutBatchSize - 1) / c_dropoutBatchSize;
+    const long long numBatches = (long long)(batchesPerColumn * cols);
+
+#pragma omp parallel for if (numBatches > 1)
+    for (long long batch = 0; batch < numBatches; batch++)
     {
-        // four-way unrolling
-        for (long i = 0; i < (m & ~3); i += 4)
+        uint32_t words[c_dropoutBatchSize];
+        const size_t j = (size_t)batch / batchesPerColumn;
+        const size_t begin = ((size_t)batch % batchesPerColumn) * c_dropoutBatchSize;
+        const size_t count = std::min(c_dropoutBatchSize, rows - begin);
+        rng.Generate(offset + j * rows + begin, count, words);
+
+        const ElemType* in = input.Data() + j * input.GetNumRows() + begin;
+        ElemType* out = Data() + j * GetNumRows() + begin;
+        uint32_t* mask = reinterpret_cast<uint32_t*>(packedMask.Data() + j * packedMask.GetNumRows()) + begin / 32;
+        // 32 elements, one word of the mask, at a time; the keep flags go through a small array so that the loops vectorize
+        for (size_t w = 0; w * 32 < count; w++)
         {
-            v = r(cpuRNGHandle->Generator());
-            us(i, j) = v <= maskRate ? 0 : scaleValue;
-            v = r(cpuRNGHandle->Generator());
-            us(i + 1, j) = v <= maskRate ? 0 : scaleValue;
-            v = r(cpuRNGHandle->Generator());
-            us(i + 2, j) = v <= maskRate ? 0 : scaleValue;
-            v = r(cpuRNGHandle->Generator());
-            us(i + 3, j) = v <= maskRate ? 0 : scaleValue;
+            const size_t n = std::min<size_t>(32, count - w * 32);
+            const uint32_t* r = words + w * 32;
+            uint32_t keep[32] = {};
+            for (size_t k = 0; k < n; k++)
+                keep[k] = UniformFromRandomWord<ElemType>(r[k]) > dropoutRate;
+            uint32_t bits = 0;
+            for (size_t k = 0; k < 32; k++)
+                bits |= keep[k] << k;
+            mask[w] = bits;
+            for (size_t k = 0; k < n; k++)
+                out[w * 32 + k] = scaleValue * (ElemType)keep[k] * in[w * 32 + k];
         }
-        // handle remaining stuffs
-        for (long i = m & ~3; i < m; i++)
+    }
+
+    rng.Advance(rows * cols);
+    return *this;
+}
+
+// this = beta * this + mask .* gradient * scaleValue, with the mask of AssignDropoutOf(). 'this' is not read if beta == 0.
+template <class ElemType>
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::AddDropoutGradientOf(const CPUMatrix<ElemType>& gradient, const CPUMatrix<ElemType>& packedMask, const ElemType scaleValue, const ElemType beta)
+{
+    const size_t rows = gradient.GetNumRows(), cols = gradient.GetNumCols();
+    if (packedMask.GetNumRows() != PackedMaskRows<ElemType>(rows) || packedMask.GetNumCols() != cols)
+        InvalidArgument("AddDropoutGradientOf: The mask has %d x %d elements, expected %d x %d.", (int)packedMask.GetNumRows(), (int)packedMask.GetNumCols(), (int)PackedMaskRows<ElemType>(rows), (int)cols);
+    if (GetNumRows() != rows || GetNumCols() != cols)
+        InvalidArgument("AddDropoutGradientOf: The input matrix dimensions do not match [this].");
+
+#pragma omp parallel for if (cols > 1 && rows * cols > c_dropoutBatchSize)
+    for (long long jj = 0; jj < (long long)cols; jj++)
+    {
+        const size_t j = (size_t)jj;
+        const ElemType* in = gradient.Data() + j * gradient.GetNumRows();
+        ElemType* out = Data() + j * GetNumRows();
+        const uint32_t* mask = reinterpret_cast<const uint32_t*>(packedMask.Data() + j * packedMask.GetNumRows());
+        for (size_t i = 0; i < rows; i += 32)
         {
-            v = r(cpuRNGHandle->Generator());
-            us(i, j) = v <= maskRate ? 0 : scaleValue;
+            const size_t n = std::min<size_t>(32, rows - i);
+            const uint32_t bits = mask[i / 32];
+            if (beta == 0)
+            {
+                for (size_t k = 0; k < n; k++)
+                    out[i + k] = scaleValue * (ElemType)((bits >> k) & 1) * in[i + k];
+            }
+            else
+            {
+                for (size_t k = 0; k < n; k++)
+                    out[i + k] = beta * out[i + k] + scaleValue * (ElemType)((bits >> k) & 1) * in[i + k];
+            }
         }
     }
+
+    return *this;
 }
 
 template <class ElemType>
@@ -1522,14 +1650,14 @@ void CPUMatrix<ElemType>::Resize(const size_t numRows, const size_t numCols, boo
     if (numElements > GetSizeAllocated() ||                 // grow allocation
         (!growOnly && (numElements != GetSizeAllocated()))) // shrink allocation (not if 'growOnly')
     {
-        // reallocate buffer
+        // reallocate buffer, the content is not preserved so it is not initialized either
         ElemType* pArray = nullptr;
         if (numElements > 0)
         {
-            pArray = NewArray<ElemType>(numElements);
+            pArray = NewPooledArray<ElemType>(numElements, /*zeroFill=*/false);
         }
         // success: update the object
-        delete[] Buffer();
+        CPUCachingMemAllocator::Deallocate(Buffer());
 
         SetBuffer(pArray, numElements * sizeof(ElemType));
         SetSizeAllocated(numElements);
@@ -5026,6 +5154,8 @@ void CPUMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const CPUMatrix
 
     ldc = (int) c.GetNumRows();
 
+    PROFILE_KERNEL(profilerKernelGemm, 2ll * m * n * k, ((long long) m * k + (long long) k * n + (beta == 0 ? 1 : 2) * (long long) m * n) * sizeof(ElemType));
+
     if (pQuantizedMultiplier == nullptr)
     {
         if (sizeof(ElemType) == sizeof(double))
@@ -5048,6 +5178,65 @@ void CPUMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const CPUMatrix
     }
 }
 
+// A[m,k]*B[k,n] = C[m,n], with A kept in 16 bits if it is constant. See ReducedPrecision.h.
+template <class ElemType>
+void ReducedPrecisionMultiplier<ElemType>::Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C)
+{
+    if (!this->IsAConstant())
+    {
+        CPUMatrix<ElemType> a(m, k, A, matrixFlagDontOwnBuffer);
+        CPUMatrix<ElemType> b(k, n, B, matrixFlagDontOwnBuffer);
+        CPUMatrix<ElemType> c(m, n, C, matrixFlagDontOwnBuffer);
+        CPUMatrix<ElemType>::MultiplyAndWeightedAdd(1, a, false, b, false, 0, c);
+        return;
+    }
+
+    if (m_matA.empty() || m != m_m || k != m_k)
+    {
+        if (A == nullptr)
+            LogicError("ReducedPrecisionMultiplier: The full-precision A was released before it was converted.");
+        m_m = m;
+        m_k = k;
+        m_matA.resize((size_t) m * k);
+        ConvertToReducedPrecision(A, m_matA.data(), m_matA.size(), m_format);
+    }
+
+    // A is cut into blocks of rows, which are processed in parallel, and each block into tiles of columns.
+    // A tile is a [tileRows x tileCols] sub-matrix of about 64k elements, so its ElemType copy stays in the L2 cache
+    // while BLAS multiplies it with the [tileCols x n] rows of B, and the result is accumulated in C.
+    const int maxTileElements = 64 * 1024;
+    const int tileRows = std::min(m, 256);
+    const int tileCols = std::max(1, std::min(k, maxTileElements / tileRows));
+    const int numRowBlocks = (m + tileRows - 1) / tileRows;
+    const int numThreads = std::max(1, std::min(omp_get_max_threads(), numRowBlocks));
+    m_tile.resize((size_t) numThreads * tileRows * tileCols);
+
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int block = 0; block < numRowBlocks; block++)
+    {
+        ElemType* tile = m_tile.data() + (size_t) omp_get_thread_num() * tileRows * tileCols;
+        int i0 = block * tileRows;
+        int rows = std::min(tileRows, m - i0);
+        for (int l0 = 0; l0 < k; l0 += tileCols)
+        {
+            int cols = std::min(tileCols, k - l0);
+            for (int l = 0; l < cols; l++)
+                ConvertFromReducedPrecision(m_matA.data() + (size_t)(l0 + l) * m + i0, tile + (size_t) l * rows, rows, m_format);
+
+            ElemType beta = l0 == 0 ? 0 : 1;
+            if (sizeof(ElemType) == sizeof(double))
+            {
+                cblas_dgemm((CBLAS_ORDER) (int) MatrixOrder::ColMajor, CblasNoTrans, CblasNoTrans, rows, n, cols, 1, reinterpret_cast<double*>(tile), rows, reinterpret_cast<double*>(B + l0), k, beta, reinterpret_cast<double*>(C + i0), m);
+            }
+            else
+            {
+#pragma warning(suppress : 4244)
+                cblas_sgemm((CBLAS_ORDER) (int) MatrixOrder::ColMajor, CblasNoTrans, CblasNoTrans, rows, n, cols, 1, reinterpret_cast<float*>(tile), rows, reinterpret_cast<float*>(B + l0), k, beta, reinterpret_cast<float*>(C + i0), m);
+            }
+        }
+    }
+}
+
 template <class ElemType>
 void CPUMatrix<ElemType>::Multiply1x1AndWeightedAdd(ElemType alpha, const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b,
                                                     ElemType beta, CPUMatrix<ElemType>& c)
@@ -6791,6 +6980,23 @@ int CPUMatrix<ElemType>::SetNumThreads(int numThreads)
     return numThreads;
 }
 
+// note: this function does not depend on the <ElemType> parameter
+// OpenBLAS has no per-thread setting, so there only the OpenMP loops of CPUMatrix are limited.
+template <class ElemType>
+void CPUMatrix<ElemType>::SetNumThreadsForCurrentThread(int numThreads)
+{
+    if (numThreads <= 0)
+        return;
+
+#ifdef _OPENMP
+    omp_set_num_threads(numThreads);
+
+    #ifdef USE_MKL
+        mkl_set_num_threads_local(numThreads);
+    #endif
+#endif
+}
+
 template <class ElemType>
 int CPUMatrix<ElemType>::GetMaxNumThreads()
 {
@@ -7158,6 +7364,38 @@ static void TensorOpWithFnAndReduction(ElemType beta, array<ElemType*, N> pointe
     }
 }
 
+// operation counts of a tensor operation, for node profiling
+// Every element of the iteration space applies the operation once, and is accumulated once when reducing.
+static inline long long TensorOpFlops(const SmallVector<size_t>& regularOpDims, const SmallVector<size_t>& reducingOpDims)
+{
+    long long numOps = 1;
+    for (size_t k = 0; k < regularOpDims.size(); k++)
+        numOps *= regularOpDims[k];
+    for (size_t k = 0; k < reducingOpDims.size(); k++)
+        numOps *= reducingOpDims[k];
+    return reducingOpDims.empty() ? numOps : 2 * numOps;
+}
+
+// Every operand is read once along the dimensions it is not broadcast along (stride 0); the output is also read if beta != 0.
+template <class ElemType, size_t N>
+static long long TensorOpBytes(ElemType beta, const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides,
+                               const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
+{
+    long long bytes = 0;
+    for (size_t i = 0; i < N; i++)
+    {
+        long long numElements = 1;
+        for (size_t k = 0; k < regularOpDims.size(); k++)
+            if (regularStrides[i][k] != 0)
+                numElements *= regularOpDims[k];
+        for (size_t k = 0; k < reducingOpDims.size(); k++)
+            if (reducingStrides[i][k] != 0)
+                numElements *= reducingOpDims[k];
+        bytes += (i == N - 1 && beta != 0 ? 2 : 1) * numElements * sizeof(ElemType);
+    }
+    return bytes;
+}
+
 // tensor operation, generalized in number of arguments, operation already provided as a lambda
 // This function now expands into different reductionOps
 template <class ElemType, typename OPFN, size_t N>
@@ -7166,6 +7404,9 @@ static void TensorOpWithFn(ElemType beta, array<ElemType*, N> pointers, ElemType
     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides,
     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
 {
+    PROFILE_KERNEL(reducingOpDims.empty() ? profilerKernelTensorElementwise : profilerKernelTensorReduction,
+                   TensorOpFlops(regularOpDims, reducingOpDims), TensorOpBytes(beta, regularOpDims, regularStrides, reducingOpDims, reducingStrides));
+
 // BUGBUG: Using always 'double' as type of aggregator even for ElemType==float. Reason: otherwise some e2e test would fail as historically we 
 // used double for aggregator of sum. But:
 // * for min and max reductions this is meaningless.
@@ -7398,6 +7639,8 @@ void CPUMatrix<ElemType>::TensorArgOp(const CPUMatrix<ElemType>& a, ElementWiseO
         reductionOp != ElementWiseOperator::opArgmax)
         InvalidArgument("TensorOp: Arg reduction operations other than opArgmax, and opArgmin are not implemented.");
 
+    PROFILE_KERNEL(profilerKernelTensorReduction, TensorOpFlops(regularOpDims, reducingOpDims), TensorOpBytes((ElemType) 0, regularOpDims, regularStrides, reducingOpDims, reducingStrides));
+
     if (GetNumElements() == 1)
     {
         Data()[0] = (ElemType) a.ArgOp(reductionOp);
@@ -0,0 +1,232 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "CPUNumaBinding.h"
+#include "CPUCachingMemAllocator.h"
+#include "CPUMatrix.h"
+#include "EnvironmentUtil.h"
+#include "numahelpers.h"
+#include <algorithm>
+#include <thread>
+#include <omp.h>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+using namespace std;
+
+namespace {
+
+#ifdef _WIN32
+typedef DWORD_PTR Affinity;
+#else
+typedef cpu_set_t Affinity;
+#endif
+
+NumaBindingMode s_mode = NumaBindingMode::None;
+vector<int> s_nodesOfThreads;
+bool s_hasOriginalAffinity = false;
+Affinity s_originalAffinity;
+
+Affinity GetCurrentThreadAffinity()
+{
+    Affinity affinity;
+#ifdef _WIN32
+    DWORD_PTR systemAffinity;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &affinity, &systemAffinity))
+        RuntimeError("CPUNumaBinding: cannot get the processor affinity of the process (error %d).", (int)GetLastError());
+#else
+    CPU_ZERO(&affinity);
+    int rc = pthread_getaffinity_np(pthread_self(), sizeof(affinity), &affinity);
+    if (rc != 0)
+        RuntimeError("CPUNumaBinding: cannot get the processor affinity of the thread (error %d).", rc);
+#endif
+    return affinity;
+}
+
+// Returns 0 on success, otherwise the error code.
+int SetCurrentThreadAffinity(const Affinity& affinity)
+{
+#ifdef _WIN32
+    return SetThreadAffinityMask(GetCurrentThread(), affinity) ? 0 : (int)GetLastError();
+#else
+    return pthread_setaffinity_np(pthread_self(), sizeof(affinity), &affinity);
+#endif
+}
+
+// Sets the affinity of every thread of an OpenMP team of the given size.
+template <class AffinityOfThread>
+void SetTeamAffinity(int numThreads, const AffinityOfThread& affinityOfThread)
+{
+    vector<int> errors(numThreads, 0);
+#pragma omp parallel num_threads(numThreads)
+    {
+        int t = omp_get_thread_num();
+        if (t < numThreads)
+            errors[t] = SetCurrentThreadAffinity(affinityOfThread(t));
+    }
+
+    for (auto error : errors)
+    {
+        if (error != 0)
+            RuntimeError("CPUNumaBinding: cannot set the processor affinity of a thread (error %d).", error);
+    }
+}
+
+Affinity ToAffinity(const vector<int>& processors)
+{
+    Affinity affinity;
+#ifdef _WIN32
+    affinity = 0;
+    for (auto p : processors)
+        affinity |= (DWORD_PTR)1 << p;
+#else
+    CPU_ZERO(&affinity);
+    for (auto p : processors)
+        CPU_SET(p, &affinity);
+#endif
+    return affinity;
+}
+
+bool IsAllowed(const Affinity& affinity, int processor)
+{
+#ifdef _WIN32
+    return processor < (int)(8 * sizeof(DWORD_PTR)) && (affinity & ((DWORD_PTR)1 << processor)) != 0;
+#else
+    return processor < CPU_SETSIZE && CPU_ISSET(processor, &affinity);
+#endif
+}
+
+vector<vector<int>> ReadTopology()
+{
+    // Only processors that the process may run on count.
+    Affinity allowed = s_hasOriginalAffinity ? s_originalAffinity : GetCurrentThreadAffinity();
+
+    vector<vector<int>> nodes;
+    for (size_t node = 0; node < msra::numa::getnumnodes(); node++)
+    {
+        vector<int> processors;
+        for (auto p : msra::numa::getnodeprocessors(node))
+        {
+            if (IsAllowed(allowed, p))
+                processors.push_back(p);
+        }
+        if (!processors.empty())
+            nodes.push_back(move(processors));
+    }
+
+    if (nodes.empty())
+    {
+        // No NUMA information, all allowed processors form a single node.
+        vector<int> processors;
+        for (int p = 0; p < (int)max(thread::hardware_concurrency(), 1u); p++)
+        {
+            if (IsAllowed(allowed, p))
+                processors.push_back(p);
+        }
+        if (processors.empty())
+            processors.push_back(0);
+        nodes.push_back(move(processors));
+    }
+    return nodes;
+}
+
+}
+
+NumaBindingMode ParseNumaBindingMode(const wstring& mode)
+{
+    if (mode == L"none" || mode.empty())
+        return NumaBindingMode::None;
+    if (mode == L"all")
+        return NumaBindingMode::AllNodes;
+    if (mode == L"local")
+        return NumaBindingMode::LocalNode;
+    InvalidArgument("Invalid NUMA binding mode '%ls', expected 'none', 'all' or 'local'.", mode.c_str());
+}
+
+/*static*/ const vector<vector<int>>& CPUNumaBinding::Topology()
+{
+    static const vector<vector<int>> s_topology = ReadTopology();
+    return s_topology;
+}
+
+/*static*/ int CPUNumaBinding::Bind(NumaBindingMode mode, int numThreads)
+{
+    if (mode == NumaBindingMode::None)
+    {
+        Unbind();
+        return CPUMatrix<float>::SetNumThreads(numThreads);
+    }
+
+    if (!s_hasOriginalAffinity)
+    {
+        s_originalAffinity = GetCurrentThreadAffinity();
+        s_hasOriginalAffinity = true;
+    }
+
+    const auto& topology = Topology();
+    vector<int> nodes;
+    if (mode == NumaBindingMode::AllNodes)
+    {
+        for (int node = 0; node < (int)topology.size(); node++)
+            nodes.push_back(node);
+    }
+    else
+        nodes.push_back(EnvironmentUtil::GetMPIRankOnHost() % (int)topology.size());
+
+    // Processors of the selected nodes, in node order.
+    vector<int> processorNodes;
+    for (auto node : nodes)
+        processorNodes.insert(processorNodes.end(), topology[node].size(), node);
+
+    if (numThreads == 0)
+        numThreads = (int)processorNodes.size();
+    numThreads = CPUMatrix<float>::SetNumThreads(numThreads);
+
+    // Contiguous blocks of threads go to the same node, in proportion to the number of processors of the nodes,
+    // so that the parts of a matrix processed by a static parallel loop are all local to one node.
+    s_nodesOfThreads.resize(numThreads);
+    for (int t = 0; t < numThreads; t++)
+        s_nodesOfThreads[t] = processorNodes[(size_t)t * processorNodes.size() / numThreads];
+
+    SetTeamAffinity(numThreads, [&](int t) { return ToAffinity(topology[s_nodesOfThreads[t]]); });
+
+    CPUCachingMemAllocator::Instance().SetParallelFirstTouch(true);
+    s_mode = mode;
+
+    fprintf(stderr, "CPUNumaBinding: bound %d CPU threads to %d of %d NUMA node(s):", numThreads, (int)nodes.size(), (int)topology.size());
+    for (auto node : nodes)
+        fprintf(stderr, " %d (%d processors)", node, (int)topology[node].size());
+    fprintf(stderr, "\n");
+    return numThreads;
+}
+
+/*static*/ void CPUNumaBinding::Unbind()
+{
+    if (s_mode == NumaBindingMode::None)
+        return;
+
+    SetTeamAffinity(CPUMatrix<float>::GetMaxNumThreads(), [](int) { return s_originalAffinity; });
+
+    CPUCachingMemAllocator::Instance().SetParallelFirstTouch(false);
+    s_nodesOfThreads.clear();
+    s_mode = NumaBindingMode::None;
+}
+
+/*static*/ NumaBindingMode CPUNumaBinding::Mode()
+{
+    return s_mode;
+}
+
+/*static*/ const vector<int>& CPUNumaBinding::NodesOfThreads()
+{
+    return s_nodesOfThreads;
+}
+} } }
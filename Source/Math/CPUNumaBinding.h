@@ -0,0 +1,56 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+#ifdef _WIN32
+#ifdef MATH_EXPORTS
+#define MATH_API __declspec(dllexport)
+#else
+#define MATH_API __declspec(dllimport)
+#endif
+#else // no DLLs on Linux
+#define MATH_API
+#endif
+
+enum class NumaBindingMode
+{
+    None,      // threads are scheduled by the operating system
+    AllNodes,  // the threads are spread over all NUMA nodes, a contiguous block of OpenMP threads per node
+    LocalNode, // all threads run on a single node, selected by the rank of the MPI worker on the host
+};
+
+// Parses "none", "all" or "local".
+MATH_API NumaBindingMode ParseNumaBindingMode(const std::wstring& mode);
+
+// NUMA mode for CPU execution: binds the OpenMP threads that run the CPUMatrix kernels to NUMA nodes.
+// With static scheduling, a thread always processes the same part of a matrix, so the CPU memory pool
+// is switched to touching new buffers with the same partitioning, which places their pages on the node that computes them.
+// In LocalNode mode, one data parallel MPI worker per node (mpiexec -n <number of sockets>) keeps its
+// parameters, gradients and activations in the memory of its own socket.
+class MATH_API CPUNumaBinding
+{
+public:
+    // Logical processors of every NUMA node that the process is allowed to run on.
+    // Nodes without such processors are skipped; a machine without NUMA information is a single node.
+    static const std::vector<std::vector<int>>& Topology();
+
+    // Binds the OpenMP threads according to the mode. numThreads has the meaning of CPUMatrix::SetNumThreads(),
+    // 0 uses one thread per processor of the selected nodes. Returns the number of threads.
+    static int Bind(NumaBindingMode mode, int numThreads = 0);
+
+    // Restores the affinity the threads had before Bind().
+    static void Unbind();
+
+    static NumaBindingMode Mode();
+
+    // Nodes (indices into Topology()) the OpenMP threads are bound to, indexed by omp_get_thread_num().
+    static const std::vector<int>& NodesOfThreads();
+};
+} } }
@@ -2,19 +2,115 @@
 // Copyright (c) Microsoft. All rights reserved.
 // Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
 //
-// CPUMatrix.cpp : full implementation of all matrix functions on the CPU side
+// CPURNGHandle.cpp: counter-based random number generator of the CPU
 //
 
 #include "stdafx.h"
 #include "CPURNGHandle.h"
+#include <algorithm>
+#include <cstring>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+static const uint32_t c_philoxMultiplier0 = 0xD2511F53;
+static const uint32_t c_philoxMultiplier1 = 0xCD9E8D57;
+static const uint32_t c_philoxWeyl0 = 0x9E3779B9;
+static const uint32_t c_philoxWeyl1 = 0xBB67AE85;
+static const int c_philoxRounds = 10;
+
 CPURNGHandle::CPURNGHandle(int deviceId, uint64_t seed, uint64_t offset)
     : RNGHandle(deviceId),
-    m_generator(seed)
+    m_offset(offset),
+    m_cachedBlock(UINT64_MAX)
+{
+    m_key[0] = (uint32_t)seed;
+    m_key[1] = (uint32_t)(seed >> 32);
+}
+
+/*static*/ void CPURNGHandle::Philox(uint32_t counter[4], const uint32_t key[2])
+{
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < c_philoxRounds; round++)
+    {
+        uint64_t p0 = (uint64_t)c_philoxMultiplier0 * counter[0];
+        uint64_t p1 = (uint64_t)c_philoxMultiplier1 * counter[2];
+        counter[0] = (uint32_t)(p1 >> 32) ^ counter[1] ^ k0;
+        counter[1] = (uint32_t)p1;
+        counter[2] = (uint32_t)(p0 >> 32) ^ counter[3] ^ k1;
+        counter[3] = (uint32_t)p0;
+        k0 += c_philoxWeyl0;
+        k1 += c_philoxWeyl1;
+    }
+}
+
+// Blocks are processed in batches, as a structure of arrays, so that the compiler can vectorize the rounds across blocks.
+void CPURNGHandle::Generate(uint64_t offset, size_t count, uint32_t* words) const
+{
+    const size_t c_blocksPerBatch = 64;
+    uint32_t x0[c_blocksPerBatch], x1[c_blocksPerBatch], x2[c_blocksPerBatch], x3[c_blocksPerBatch];
+
+    while (count > 0)
+    {
+        const uint64_t firstBlock = offset / 4;
+        const size_t skip = (size_t)(offset % 4); // words of the first block before 'offset'
+        const size_t numBlocks = std::min(c_blocksPerBatch, (skip + count + 3) / 4);
+
+        for (size_t b = 0; b < numBlocks; b++)
+        {
+            x0[b] = (uint32_t)(firstBlock + b);
+            x1[b] = (uint32_t)((firstBlock + b) >> 32);
+            x2[b] = 0;
+            x3[b] = 0;
+        }
+
+        uint32_t k0 = m_key[0], k1 = m_key[1];
+        for (int round = 0; round < c_philoxRounds; round++)
+        {
+            for (size_t b = 0; b < numBlocks; b++)
+            {
+                uint64_t p0 = (uint64_t)c_philoxMultiplier0 * x0[b];
+                uint64_t p1 = (uint64_t)c_philoxMultiplier1 * x2[b];
+                uint32_t y0 = (uint32_t)(p1 >> 32) ^ x1[b] ^ k0;
+                uint32_t y2 = (uint32_t)(p0 >> 32) ^ x3[b] ^ k1;
+                x0[b] = y0;
+                x1[b] = (uint32_t)p1;
+                x2[b] = y2;
+                x3[b] = (uint32_t)p0;
+            }
+            k0 += c_philoxWeyl0;
+            k1 += c_philoxWeyl1;
+        }
+
+        uint32_t blockWords[c_blocksPerBatch * 4];
+        for (size_t b = 0; b < numBlocks; b++)
+        {
+            blockWords[4 * b] = x0[b];
+            blockWords[4 * b + 1] = x1[b];
+            blockWords[4 * b + 2] = x2[b];
+            blockWords[4 * b + 3] = x3[b];
+        }
+        const size_t numWords = std::min(count, numBlocks * 4 - skip);
+        memcpy(words, blockWords + skip, numWords * sizeof(uint32_t));
+
+        words += numWords;
+        offset += numWords;
+        count -= numWords;
+    }
+}
+
+CPURNGHandle::result_type CPURNGHandle::operator()()
 {
-    m_generator.discard(offset);
+    uint64_t block = m_offset / 4;
+    if (block != m_cachedBlock)
+    {
+        m_cachedWords[0] = (uint32_t)block;
+        m_cachedWords[1] = (uint32_t)(block >> 32);
+        m_cachedWords[2] = 0;
+        m_cachedWords[3] = 0;
+        Philox(m_cachedWords, m_key);
+        m_cachedBlock = block;
+    }
+    return m_cachedWords[m_offset++ % 4];
 }
 
 }}}
@@ -2,29 +2,75 @@
 // Copyright (c) Microsoft. All rights reserved.
 // Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
 //
-// CPUMatrix.cpp : full implementation of all matrix functions on the CPU side
+// CPURNGHandle.h: counter-based random number generator of the CPU
 //
 
 #pragma once
 
 #include "RNGHandle.h"
+#include <cstdint>
 #include <memory>
-#include <random>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC 2011).
+// The stream of a handle is the sequence of 32-bit words w[i] = Philox(key = seed, counter = i / 4)[i % 4].
+// Any range of the stream can be computed independently of the others, so that kernels can fill a matrix
+// in parallel and still produce the same values for any number of threads, and a handle created with
+// (seed, offset) continues the stream of a handle with the same seed after 'offset' words.
+// The handle also satisfies the requirements of a uniform random bit generator, for the distributions of
+// std and boost that draw from the stream serially, one word per call.
 class CPURNGHandle : public RNGHandle
 {
 public:
+    typedef uint32_t result_type;
+
     CPURNGHandle(int deviceId, uint64_t seed, uint64_t offset = 0);
 
-    std::mt19937_64& Generator()
+    // position of the next word of the stream
+    uint64_t Offset() const
     {
-        return m_generator;
+        return m_offset;
     }
 
+    // Moves the position by 'count' words, e.g. after a kernel consumed them through Generate().
+    void Advance(uint64_t count)
+    {
+        m_offset += count;
+    }
+
+    // Computes 'count' words of the stream, starting at position 'offset'. Does not change the position of the handle
+    // and is safe to call from multiple threads.
+    void Generate(uint64_t offset, size_t count, uint32_t* words) const;
+
+    CPURNGHandle& Generator()
+    {
+        return *this;
+    }
+
+    static constexpr result_type(min)()
+    {
+        return 0;
+    }
+
+    static constexpr result_type(max)()
+    {
+        return UINT32_MAX;
+    }
+
+    // Returns the word at the current position and advances the position by one.
+    result_type operator()();
+
+    // Philox4x32-10 block function: 'counter' is transformed in place.
+    static void Philox(uint32_t counter[4], const uint32_t key[2]);
+
 private:
-    std::mt19937_64 m_generator;
+    uint32_t m_key[2];
+    uint64_t m_offset;
+
+    // block of the stream last used by operator()
+    uint64_t m_cachedBlock;
+    uint32_t m_cachedWords[4];
 };
 
 }}}
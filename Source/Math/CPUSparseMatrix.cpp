@@ -17,6 +17,8 @@
 #include <random>
 #include <chrono>
 #include <iostream>
+#include <numeric>
+#include <unordered_map>
 #ifdef LEAKDETECT
 #include <vld.h>
 #endif
@@ -747,10 +749,10 @@ void CPUSparseMatrix<ElemType>::Allocate(const size_t numRows, const size_t numC
     {
         if (GetFormat() == MatrixFormat::matrixFormatSparseCSC || GetFormat() == MatrixFormat::matrixFormatSparseCSR)
         {
-            // The initialization of the following buffer is done by new []().
-            auto* pArray      = new ElemType[numNZElemToReserve]();
-            auto* unCompIndex = new CPUSPARSE_INDEX_TYPE[numNZElemToReserve]();
-            auto* compIndex   = new CPUSPARSE_INDEX_TYPE[newCompIndexSize]();
+            // The following buffers are zero initialized by the pool.
+            auto* pArray      = CPUCachingMemAllocator::Allocate<ElemType>(numNZElemToReserve, /*zeroFill=*/true);
+            auto* unCompIndex = CPUCachingMemAllocator::Allocate<CPUSPARSE_INDEX_TYPE>(numNZElemToReserve, /*zeroFill=*/true);
+            auto* compIndex   = CPUCachingMemAllocator::Allocate<CPUSPARSE_INDEX_TYPE>(newCompIndexSize, /*zeroFill=*/true);
 
             if (keepExistingValues && (NzCount() > numNZElemToReserve || GetCompIndexSize() > newCompIndexSize))
                 LogicError("Allocate: To keep values m_nz should <= numNZElemToReserve and m_compIndexSize <= newCompIndexSize");
@@ -764,9 +766,9 @@ void CPUSparseMatrix<ElemType>::Allocate(const size_t numRows, const size_t numC
             }
 
             // TODO: This is super ugly. The internals of the storage object should be a shared_ptr.
-            delete[] Buffer();
-            delete[] GetUnCompIndex();
-            delete[] GetCompIndex();
+            CPUCachingMemAllocator::Deallocate(Buffer());
+            CPUCachingMemAllocator::Deallocate(GetUnCompIndex());
+            CPUCachingMemAllocator::Deallocate(GetCompIndex());
 
             SetBuffer(pArray, numNZElemToReserve, false);
             SetUnCompIndex(unCompIndex);
@@ -774,8 +776,8 @@ void CPUSparseMatrix<ElemType>::Allocate(const size_t numRows, const size_t numC
         }
         else if (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol || GetFormat() == MatrixFormat::matrixFormatSparseBlockRow)
         {
-            ElemType* blockVal = new ElemType[numNZElemToReserve];
-            size_t* blockIds = new size_t[newCompIndexSize];
+            ElemType* blockVal = CPUCachingMemAllocator::Allocate<ElemType>(numNZElemToReserve);
+            size_t* blockIds = CPUCachingMemAllocator::Allocate<size_t>(newCompIndexSize);
 
             if (keepExistingValues && (NzCount() > numNZElemToReserve || GetCompIndexSize() > newCompIndexSize))
                 LogicError("Resize: To keep values m_nz should <= numNZElemToReserve and m_compIndexSize <= newCompIndexSize");
@@ -787,8 +789,8 @@ void CPUSparseMatrix<ElemType>::Allocate(const size_t numRows, const size_t numC
                 memcpy(blockIds, GetBlockIds(), sizeof(size_t) * GetCompIndexSize());
             }
 
-            delete[] Buffer();
-            delete[] GetBlockIds();
+            CPUCachingMemAllocator::Deallocate(Buffer());
+            CPUCachingMemAllocator::Deallocate(GetBlockIds());
 
             SetBuffer(blockVal, numNZElemToReserve, false);
             SetBlockIds(blockIds);
@@ -1045,7 +1047,11 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
         if (rhs.GetFormat() != matrixFormatSparseCSC)
             NOT_IMPLEMENTED;
 
-        // allocate enough memory
+        // c = alpha * lhs * rhs^T is only non-zero in the columns of c that correspond to rows of rhs with a
+        // non-zero, so c is kept in block column format and gets a block per touched column. The non-zeros of rhs
+        // are bucketed by their target block (counting sort), and then each block is reduced by a single thread:
+        // no two threads write the same column, and repeated rows (e.g. the same word appearing several times in a
+        // minibatch) are summed in a fixed order, so the result does not depend on the number of threads.
         c.SetFormat(matrixFormatSparseBlockCol);
         size_t blockSizePrev = c.GetBlockSize();
 
@@ -1054,22 +1060,28 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
             c.RequireSizeAndAllocate(m, n, 0, true); // allocate for blockIds
         }
 
-        map<size_t, size_t> col2BlockId;
+        unordered_map<size_t, size_t> col2BlockId;
+        col2BlockId.reserve(blockSizePrev + rhs.NzCount());
         for (size_t blockId = 0; blockId < blockSizePrev; blockId++)
         {
             col2BlockId[c.GetBlockIds()[blockId]] = blockId;
         }
 
+        // Target block of every non-zero of rhs, in rhs storage order.
+        const size_t rhsStart = rhs.SecondaryIndexLocation()[0];
+        const size_t rhsEnd = rhs.SecondaryIndexLocation()[rhs.GetNumCols()];
+        vector<size_t> nzBlockIds(rhsEnd - rhsStart);
         size_t blockSizeCurr = blockSizePrev;
-        for (size_t rhsNz = 0; rhsNz < rhs.NzCount(); rhsNz++)
+        for (size_t p = rhsStart; p < rhsEnd; p++)
         {
-            size_t resultCol = rhs.MajorIndexLocation()[rhsNz];
-            if (col2BlockId.find(resultCol) == col2BlockId.end())
+            size_t resultCol = rhs.MajorIndexLocation()[p];
+            auto result = col2BlockId.insert(make_pair(resultCol, blockSizeCurr));
+            if (result.second)
             {
-                col2BlockId[resultCol] = blockSizeCurr;
                 c.GetBlockIds()[blockSizeCurr] = resultCol;
-                blockSizeCurr ++;
+                blockSizeCurr++;
             }
+            nzBlockIds[p - rhsStart] = result.first->second;
         }
 
         if (blockSizeCurr > blockSizePrev)
@@ -1079,22 +1091,33 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
             memset(c.Data() + m * blockSizePrev, 0, sizeof(ElemType) * m * (blockSizeCurr - blockSizePrev));
         }
 
-        for (size_t rhsCol = 0; rhsCol < rhs.GetNumCols(); rhsCol++)
-        {
-            size_t start = rhs.SecondaryIndexLocation()[rhsCol];
-            size_t end = rhs.SecondaryIndexLocation()[rhsCol + 1];
+        // Counting sort of the (rhs column, rhs non-zero) pairs by target block; pairs of a block stay in storage order.
+        vector<size_t> blockStarts(blockSizeCurr + 1, 0);
+        for (size_t blockId : nzBlockIds)
+            blockStarts[blockId + 1]++;
+        partial_sum(blockStarts.begin(), blockStarts.end(), blockStarts.begin());
 
-            for (size_t p = start; p < end; p++)
+        vector<pair<size_t, size_t>> sortedNz(nzBlockIds.size());
+        {
+            vector<size_t> next(blockStarts.begin(), blockStarts.end() - 1);
+            for (size_t rhsCol = 0; rhsCol < rhs.GetNumCols(); rhsCol++)
             {
-                size_t rhsRow = rhs.MajorIndexLocation()[p];
-                ElemType val = rhs.Buffer()[p];
+                for (size_t p = rhs.SecondaryIndexLocation()[rhsCol]; p < rhs.SecondaryIndexLocation()[rhsCol + 1]; p++)
+                    sortedNz[next[nzBlockIds[p - rhsStart]]++] = make_pair(rhsCol, p);
+            }
+        }
 
-                ElemType* results = c.Buffer() + col2BlockId[rhsRow] * m;
-                #pragma omp parallel for
-                for (int lhsRow = 0; lhsRow < (int)m; lhsRow++)
-                {
-                    results[lhsRow] += alpha * lhs((size_t)lhsRow, rhsCol) * val;
-                }
+        // Segmented reduction, one block per iteration.
+        #pragma omp parallel for schedule(dynamic)
+        for (long blockId = 0; blockId < (long)blockSizeCurr; blockId++)
+        {
+            ElemType* results = c.Buffer() + blockId * m;
+            for (size_t i = blockStarts[blockId]; i < blockStarts[blockId + 1]; i++)
+            {
+                const ElemType* lhsCol = &lhs(0, sortedNz[i].first);
+                ElemType val = alpha * rhs.Buffer()[sortedNz[i].second];
+                for (size_t lhsRow = 0; lhsRow < m; lhsRow++)
+                    results[lhsRow] += lhsCol[lhsRow] * val;
             }
         }
     }
@@ -1304,7 +1327,9 @@ void CPUSparseMatrix<ElemType>::NormalGrad(CPUMatrix<ElemType>& c, const ElemTyp
     if (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol || GetFormat() == MatrixFormat::matrixFormatSparseBlockRow)
     {
         const auto isSparseBlockCol = (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol);
-        for (size_t j = 0; j < GetBlockSize(); j++)
+        // Blocks never share a row/column, so they can be updated independently.
+        #pragma omp parallel for
+        for (long j = 0; j < (long)GetBlockSize(); j++)
         {
             size_t i = GetBlockIds()[j] - GetBlockIdShift();
             size_t len = (isSparseBlockCol) ? GetNumRows() : GetNumCols();
@@ -1325,6 +1350,42 @@ void CPUSparseMatrix<ElemType>::NormalGrad(CPUMatrix<ElemType>& c, const ElemTyp
     }
 }
 
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::GetBlockColumns(std::vector<size_t>& columnIds, std::vector<ElemType>& values) const
+{
+    if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
+        LogicError("CPUSparseMatrix::GetBlockColumns is only applicable to the sparse block column format.");
+
+    columnIds.resize(GetBlockSize());
+    for (size_t j = 0; j < GetBlockSize(); j++)
+        columnIds[j] = GetBlockIds()[j] - GetBlockIdShift();
+
+    values.assign(Buffer(), Buffer() + GetBlockSize() * GetNumRows());
+}
+
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::SetBlockColumns(const std::vector<size_t>& columnIds, const std::vector<ElemType>& values)
+{
+    if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
+        LogicError("CPUSparseMatrix::SetBlockColumns is only applicable to the sparse block column format.");
+    if (values.size() != columnIds.size() * GetNumRows())
+        InvalidArgument("CPUSparseMatrix::SetBlockColumns: Expected %d values for %d columns, got %d.",
+                        (int)(columnIds.size() * GetNumRows()), (int)columnIds.size(), (int)values.size());
+
+    RequireSizeAndAllocate(GetNumRows(), GetNumCols(), values.size(), true, false);
+    for (size_t j = 0; j < columnIds.size(); j++)
+    {
+        if (columnIds[j] >= GetNumCols())
+            InvalidArgument("CPUSparseMatrix::SetBlockColumns: Column index %d is out of range [0, %d).", (int)columnIds[j], (int)GetNumCols());
+        GetBlockIds()[j] = columnIds[j];
+    }
+
+    SetBlockIdShift(0);
+    SetBlockSize(columnIds.size());
+    if (!values.empty())
+        memcpy(Buffer(), values.data(), sizeof(ElemType) * values.size());
+}
+
 // update smoothed gradients c and current gradients (this)
 template <class ElemType>
 ElemType CPUSparseMatrix<ElemType>::Adagrad(CPUMatrix<ElemType>& c, const bool needAveMultiplier)
@@ -233,6 +233,12 @@ public:
     ElemType Adagrad(CPUMatrix<ElemType>& c, const bool needAveMultiplier);
     void AdaDelta(CPUMatrix<ElemType>& c, CPUMatrix<ElemType>& functionValues, ElemType learningRate, ElemType rho, ElemType epsilon);
 
+public:
+    // Access to a block column matrix as (column index, column values) pairs, e.g. to exchange sparse gradients
+    // between workers. Values of all blocks are stored back to back, GetNumRows() values per block.
+    void GetBlockColumns(std::vector<size_t>& columnIds, std::vector<ElemType>& values) const;
+    void SetBlockColumns(const std::vector<size_t>& columnIds, const std::vector<ElemType>& values);
+
 public:
     CPUSparseMatrix<ElemType>& InplaceTruncateTop(const ElemType threshold);
     CPUSparseMatrix<ElemType>& InplaceTruncateBottom(const ElemType threshold);
@@ -15,6 +15,7 @@
 
 #include "Basics.h"
 #include "basetypes.h"
+#include "CPUCachingMemAllocator.h"
 #include <string>
 #include <stdint.h>
 #include <memory>
@@ -73,6 +74,20 @@ private:
     static AllocatedElemType* AllocateNoTrace(int deviceId, size_t numElements);
 };
 
+// -----------------------------------------------------------------------
+// PackedMaskRows -- number of rows of a matrix that stores a mask of one bit per
+// element of a matrix with 'numRows' rows. The bits of every column are packed into
+// 32-bit words (bit i % 32 of word i / 32), so that columns of the mask can be sliced
+// together with the columns of the masked matrix.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+inline size_t PackedMaskRows(size_t numRows)
+{
+    size_t numWords = (numRows + 31) / 32;
+    return (numWords * sizeof(uint32_t) + sizeof(ElemType) - 1) / sizeof(ElemType);
+}
+
 // -----------------------------------------------------------------------
 // ElementWiseOperator -- This enum represents which function to apply.
 // This is shared between all matrix types and tensors.
@@ -268,17 +283,17 @@ public:
         {
             if (m_computeDevice < 0)
             {
-                delete[] m_pArray;
+                CPUCachingMemAllocator::Deallocate(m_pArray);
                 m_pArray = nullptr;
                 m_nzValues = nullptr;
 
-                delete[] m_unCompIndex;
+                CPUCachingMemAllocator::Deallocate(m_unCompIndex);
                 m_unCompIndex = nullptr;
 
-                delete[] m_compIndex;
+                CPUCachingMemAllocator::Deallocate(m_compIndex);
                 m_compIndex = nullptr;
 
-                delete[] m_blockIds;
+                CPUCachingMemAllocator::Deallocate(m_blockIds);
                 m_blockIds = nullptr;
             }
             else
@@ -723,6 +723,28 @@ void Matrix<ElemType>::CopySection(size_t numRows, size_t numCols, ElemType* dst
                             NOT_IMPLEMENTED);
 }
 
+template <class ElemType>
+void Matrix<ElemType>::GetSparseBlockColumns(std::vector<size_t>& columnIds, std::vector<ElemType>& values) const
+{
+    DISPATCH_MATRIX_ON_FLAG(this,
+                            nullptr,
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED,
+                            m_CPUSparseMatrix->GetBlockColumns(columnIds, values),
+                            NOT_IMPLEMENTED);
+}
+
+template <class ElemType>
+void Matrix<ElemType>::SetSparseBlockColumns(const std::vector<size_t>& columnIds, const std::vector<ElemType>& values)
+{
+    DISPATCH_MATRIX_ON_FLAG(this,
+                            this,
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED,
+                            m_CPUSparseMatrix->SetBlockColumns(columnIds, values),
+                            NOT_IMPLEMENTED);
+}
+
 // BUGBUG: Some code checks before calling here whether one of the dimensions is 0.
 //         This function must handle that case properly, that is, preserving the non-zero dimension.
 template <class ElemType>
@@ -1604,6 +1626,73 @@ void Matrix<ElemType>::SetUniformRandomMask(const ElemType maskRate, const ElemT
                             NOT_IMPLEMENTED);
 }
 
+template <class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::AssignDropoutOf(const Matrix<ElemType>& input, Matrix<ElemType>& packedMask, const ElemType dropoutRate, const ElemType scaleValue, RNGHandle& rngHandle)
+{
+    if (input.IsEmpty())
+        LogicError("AssignDropoutOf: Matrix is empty.");
+
+    if (packedMask.GetNumRows() != PackedMaskRows<ElemType>(input.GetNumRows()) || packedMask.GetNumCols() != input.GetNumCols())
+        InvalidArgument("AssignDropoutOf: The mask has %d x %d elements, expected %d x %d.",
+                        (int)packedMask.GetNumRows(), (int)packedMask.GetNumCols(), (int)PackedMaskRows<ElemType>(input.GetNumRows()), (int)input.GetNumCols());
+
+    DecideAndMoveToRightDevice(input, *this, packedMask);
+    SwitchToMatrixType(input.GetMatrixType(), input.GetFormat(), false);
+
+    DISPATCH_MATRIX_ON_FLAG(&input,
+                            this,
+                            {
+                                m_CPUMatrix->AssignDropoutOf(*input.m_CPUMatrix, *packedMask.m_CPUMatrix, dropoutRate, scaleValue, rngHandle);
+                                packedMask.SetDataLocation(CurrentDataLocation::CPU, MatrixType::DENSE);
+                            },
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+
+    return *this;
+}
+
+template <class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::AssignDropoutGradientOf(const Matrix<ElemType>& gradient, const Matrix<ElemType>& packedMask, const ElemType scaleValue)
+{
+    if (gradient.IsEmpty())
+        LogicError("AssignDropoutGradientOf: Matrix is empty.");
+
+    Resize(gradient.GetNumRows(), gradient.GetNumCols());
+    return AddDropoutGradientOfWithBeta(gradient, packedMask, scaleValue, 0);
+}
+
+template <class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::AddDropoutGradientOf(const Matrix<ElemType>& gradient, const Matrix<ElemType>& packedMask, const ElemType scaleValue)
+{
+    if (gradient.IsEmpty())
+        LogicError("AddDropoutGradientOf: Matrix is empty.");
+
+    if (GetNumRows() != gradient.GetNumRows() || GetNumCols() != gradient.GetNumCols())
+        InvalidArgument("AddDropoutGradientOf: The input matrix dimensions do not match [this].");
+
+    return AddDropoutGradientOfWithBeta(gradient, packedMask, scaleValue, 1);
+}
+
+template <class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::AddDropoutGradientOfWithBeta(const Matrix<ElemType>& gradient, const Matrix<ElemType>& packedMask, const ElemType scaleValue, const ElemType beta)
+{
+    if (packedMask.GetNumRows() != PackedMaskRows<ElemType>(gradient.GetNumRows()) || packedMask.GetNumCols() != gradient.GetNumCols())
+        InvalidArgument("AddDropoutGradientOf: The mask has %d x %d elements, expected %d x %d.",
+                        (int)packedMask.GetNumRows(), (int)packedMask.GetNumCols(), (int)PackedMaskRows<ElemType>(gradient.GetNumRows()), (int)gradient.GetNumCols());
+
+    DecideAndMoveToRightDevice(gradient, *this, packedMask);
+
+    DISPATCH_MATRIX_ON_FLAG(&gradient,
+                            this,
+                            m_CPUMatrix->AddDropoutGradientOf(*gradient.m_CPUMatrix, *packedMask.m_CPUMatrix, scaleValue, beta),
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED,
+                            NOT_IMPLEMENTED);
+
+    return *this;
+}
+
 // Vanilla SGD update. 
 // Modifies "this" parameter matrix, on which this method is invoked.
 template <class ElemType>
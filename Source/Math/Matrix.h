@@ -98,6 +98,7 @@ private:
     static void DecideAndMoveToRightDevice(const Matrix<ElemType>& a, const Matrix<ElemType>& b, const Matrix<ElemType>& c);
     static void DecideAndMoveToRightDevice(const Matrix<ElemType>& a, const Matrix<ElemType>& b, const Matrix<ElemType>& c, const Matrix<ElemType>& d);
     static void CopyElementsFromDenseToSparse(CPUMatrix<ElemType>& from, CPUSparseMatrix<ElemType>& dest);
+    Matrix<ElemType>& AddDropoutGradientOfWithBeta(const Matrix<ElemType>& gradient, const Matrix<ElemType>& packedMask, const ElemType scaleValue, const ElemType beta);
 
 public:
     // Constructors, destructors and other static matrix builders
@@ -188,6 +189,10 @@ public:
     // REVIEW alexeyk: GPU version copies from device to host only, implement all versions (device <-> host).
     void CopySection(size_t numRows, size_t numCols, ElemType* dst, size_t colStride) const;
 
+    // Sparse block column matrices on the CPU as (column index, column values) pairs, see CPUSparseMatrix::GetBlockColumns().
+    void GetSparseBlockColumns(std::vector<size_t>& columnIds, std::vector<ElemType>& values) const;
+    void SetSparseBlockColumns(const std::vector<size_t>& columnIds, const std::vector<ElemType>& values);
+
     Matrix<ElemType> ColumnSlice(size_t startColumn, size_t numCols) const; // note: 'const' is misleading here, as the returned matrix is a mutable reference
 
     // difference between AssignColumnSlice and SetColumnSlice
@@ -298,6 +303,12 @@ public:
     void SetGaussianRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed = USE_TIME_BASED_SEED);
     void SetTruncatedNormalRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed = USE_TIME_BASED_SEED);
     void SetUniformRandomMask(const ElemType maskRate, const ElemType scaleValue, RNGHandle& rngHandle);
+    // Dropout with a mask of one bit per element (see PackedMaskRows()), generated and applied in a single pass:
+    // this = mask .* input * scaleValue, where an element is masked out with probability dropoutRate. CPU only.
+    Matrix<ElemType>& AssignDropoutOf(const Matrix<ElemType>& input, Matrix<ElemType>& packedMask, const ElemType dropoutRate, const ElemType scaleValue, RNGHandle& rngHandle);
+    // this = mask .* gradient * scaleValue, resp. this += mask .* gradient * scaleValue, with the mask of AssignDropoutOf(). CPU only.
+    Matrix<ElemType>& AssignDropoutGradientOf(const Matrix<ElemType>& gradient, const Matrix<ElemType>& packedMask, const ElemType scaleValue);
+    Matrix<ElemType>& AddDropoutGradientOf(const Matrix<ElemType>& gradient, const Matrix<ElemType>& packedMask, const ElemType scaleValue);
     void AddGaussianRandomValue(const ElemType mean, const ElemType sigma, unsigned long seed = USE_TIME_BASED_SEED);
     Matrix<ElemType>& AssignNoiseContrastiveEstimation(const Matrix<ElemType>& a, const Matrix<ElemType>& b, const Matrix<ElemType>& c, const Matrix<ElemType>& bias, Matrix<ElemType>& tmp);
 
@@ -40,9 +40,12 @@ public:
         QuantizedMultiplier(pQuantizerA, false, pQuantizerB, false)
     {
     };
+    virtual ~QuantizedMultiplier()
+    {
+    }
 
     // A[m,k]*B[k,n] = C[m,n]
-    void Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C)
+    virtual void Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C)
     {
         // Quantize
         if (!m_isAConstant || m_firstPass)
@@ -84,6 +87,15 @@ public:
 
     void SetIsAConstant(bool v) { m_isAConstant = v; }
     void SetIsBConstant(bool v) { m_isBConstant = v; }
+
+protected:
+    // for derived multipliers that represent the matrices differently and do not use the quantizers
+    QuantizedMultiplier(bool isAConstant, bool isBConstant) :
+        m_isAConstant(isAConstant), m_isBConstant(isBConstant), m_firstPass(true)
+    {
+    }
+
+    bool IsAConstant() const { return m_isAConstant; }
 };
 
 }}}
\ No newline at end of file
@@ -0,0 +1,165 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// ReducedPrecision.h -- 16-bit storage formats for weights, with conversion kernels and a matrix product that
+// computes in full precision
+//
+#pragma once
+#include "CommonMatrix.h"
+#include "QuantizedOperations.h"
+#include "Float16.h"
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// 16-bit storage formats. Values are only stored in these formats; all arithmetic is done in float or double.
+//  - Float16:  IEEE 754 half precision (1 sign, 5 exponent, 10 mantissa bits). Range +-65504, ~3 decimal digits.
+//  - BFloat16: the upper half of an IEEE 754 float (1 sign, 8 exponent, 7 mantissa bits). Range of float, ~2 decimal digits.
+enum class ReducedPrecisionFormat : int
+{
+    Float16,
+    BFloat16
+};
+
+static inline ReducedPrecisionFormat ReducedPrecisionFormatFromName(const std::wstring& name)
+{
+    if (name == L"float16" || name == L"fp16" || name == L"half")
+        return ReducedPrecisionFormat::Float16;
+    else if (name == L"bfloat16" || name == L"bf16")
+        return ReducedPrecisionFormat::BFloat16;
+    else
+        InvalidArgument("Unknown reduced precision format '%ls'; must be 'float16' or 'bfloat16'.", name.c_str());
+}
+
+static inline const wchar_t* ReducedPrecisionFormatName(ReducedPrecisionFormat format)
+{
+    return format == ReducedPrecisionFormat::Float16 ? L"float16" : L"bfloat16";
+}
+
+static inline uint32_t FloatAsBits(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float BitsAsFloat(uint32_t u)
+{
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+// The float16 conversions are FloatToHalf() and HalfToFloat() from Float16.h.
+
+// float -> bfloat16, rounding to nearest even. NaNs stay NaNs.
+static inline uint16_t FloatToBFloat16(float f)
+{
+    uint32_t u = FloatAsBits(f);
+    if ((u & 0x7fffffff) > 0x7f800000)
+        return (uint16_t)((u >> 16) | 0x0040);
+    u += 0x7fff + ((u >> 16) & 1);
+    return (uint16_t)(u >> 16);
+}
+
+// bfloat16 -> float (exact)
+static inline float BFloat16ToFloat(uint16_t b)
+{
+    return BitsAsFloat((uint32_t)b << 16);
+}
+
+// Converts 'n' values to the 16-bit format. Uses all OpenMP threads of the caller.
+template <class ElemType>
+void ConvertToReducedPrecision(const ElemType* from, uint16_t* to, size_t n, ReducedPrecisionFormat format)
+{
+    const long long count = (long long)n;
+    if (format == ReducedPrecisionFormat::BFloat16)
+    {
+#pragma omp parallel for if (count > 65536)
+        for (long long i = 0; i < count; i++)
+            to[i] = FloatToBFloat16((float)from[i]);
+        return;
+    }
+#if defined(__F16C__)
+    if (std::is_same<ElemType, float>::value)
+    {
+        // 8 values per instruction; the rounding mode 0 is round to nearest even, same as FloatToHalf()
+        const long long vectorCount = count & ~7ll;
+#pragma omp parallel for if (count > 65536)
+        for (long long i = 0; i < vectorCount; i += 8)
+            _mm_storeu_si128((__m128i*)(to + i), _mm256_cvtps_ph(_mm256_loadu_ps((const float*)from + i), 0));
+        for (long long i = vectorCount; i < count; i++)
+            to[i] = FloatToHalf((float)from[i]);
+        return;
+    }
+#endif
+#pragma omp parallel for if (count > 65536)
+    for (long long i = 0; i < count; i++)
+        to[i] = FloatToHalf((float)from[i]);
+}
+
+// Converts 'n' values back from the 16-bit format. Called by a single thread per tile in the matrix product,
+// hence not parallelized.
+template <class ElemType>
+void ConvertFromReducedPrecision(const uint16_t* from, ElemType* to, size_t n, ReducedPrecisionFormat format)
+{
+    if (format == ReducedPrecisionFormat::BFloat16)
+    {
+        for (size_t i = 0; i < n; i++)
+            to[i] = (ElemType)BFloat16ToFloat(from[i]);
+        return;
+    }
+    size_t i = 0;
+#if defined(__F16C__)
+    if (std::is_same<ElemType, float>::value)
+    {
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps((float*)to + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(from + i))));
+    }
+#endif
+    for (; i < n; i++)
+        to[i] = (ElemType)HalfToFloat(from[i]);
+}
+
+// Matrix product A * B where the constant matrix A (the weights) is kept in a 16-bit format.
+// A is converted once, at the first Multiply(). Each Multiply() then streams over the 16-bit copy only, converting one
+// cache-sized tile of A at a time back to ElemType and multiplying it with the matching rows of B by BLAS.
+// This halves the memory traffic for A, which dominates inference with small minibatches, while all sums are
+// accumulated in ElemType.
+// B and C stay in ElemType. If A is not constant, the product is computed in full precision since converting it
+// on every call would cost more than it saves.
+template <class ElemType>
+class MATH_API ReducedPrecisionMultiplier : public QuantizedMultiplier<ElemType>
+{
+    typedef QuantizedMultiplier<ElemType> Base;
+
+public:
+    ReducedPrecisionMultiplier(ReducedPrecisionFormat format)
+        : Base(false, false), m_format(format), m_m(0), m_k(0)
+    {
+    }
+
+    // A[m,k]*B[k,n] = C[m,n], defined in CPUMatrixImpl.h
+    virtual void Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C) override;
+
+    ReducedPrecisionFormat Format() const { return m_format; }
+
+    // whether the constant A has been converted, after which Multiply() does not read it anymore
+    bool HasConvertedA() const { return !m_matA.empty(); }
+
+private:
+    ReducedPrecisionFormat m_format;
+    std::vector<uint16_t> m_matA; // A in m_format, column-major [m_m x m_k]
+    int m_m, m_k;
+    std::vector<ElemType> m_tile; // the tile of A that is currently being multiplied, converted back to ElemType
+};
+
+}}}
@@ -17,8 +17,12 @@
 #include "fileutil.h"
 #include "TimerUtility.h"
 #include <algorithm>
+#include <atomic>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 #include <stdio.h>
 #ifndef CPUONLY
 #include <cuda_runtime_api.h>
@@ -57,6 +61,7 @@ static const FixedEventDesc c_fixedEvtDesc[profilerEvtMax] = {
     { "Epoch", profilerEvtTime, false },                            // profilerEvtMainEpoch
     { "_Minibatch Iteration", profilerEvtTime, false },             // profilerEvtMainMinibatch
     { "__Get Minibatch", profilerEvtTime, true },                   // profilerEvtMainGetMinibatch
+    { "___Wait For Prefetch", profilerEvtTime, false },             // profilerEvtMainWaitForPrefetch
     { "__Forward + Backward", profilerEvtTime, true },              // profilerEvtMainFB
     { "__Gradient Aggregation", profilerEvtTime, true },            // profilerEvtMainGradient
     { "__Weight Update", profilerEvtTime, true },                   // profilerEvtMainWeights
@@ -67,6 +72,10 @@ static const FixedEventDesc c_fixedEvtDesc[profilerEvtMax] = {
     { "", profilerEvtSeparator, false },                            // profilerSepSpace2
 
     { "Prefetch Minibatch", profilerEvtTime, false },               // profilerEvtPrefetchMinibatch
+    { "_Read Sequences", profilerEvtTime, false },                  // profilerEvtReadSequences
+    { "__Transform Sequences", profilerEvtTime, false },            // profilerEvtTransformSequences
+    { "_Pack Minibatch", profilerEvtTime, false },                  // profilerEvtPackMinibatch
+    { "_Copy Minibatch", profilerEvtTime, false },                  // profilerEvtCopyMinibatch
 };
 
 
@@ -80,6 +89,36 @@ struct FixedEventRecord
     long long       totalBytes;   // used only for throughput events
 };
 
+//
+// Kernel descriptions
+//
+static const char* c_kernelDesc[profilerKernelMax] = {
+    "Matrix Product (GEMM)",                                        // profilerKernelGemm
+    "Tensor Element-wise",                                          // profilerKernelTensorElementwise
+    "Tensor Reduction",                                             // profilerKernelTensorReduction
+};
+
+// Number of nodes listed in the summary report
+static const size_t c_maxNodesInReport = 50;
+
+
+//
+// Categories of the events in the custom event buffer, which become the categories in the timeline.
+//
+enum CustomEventCategory
+{
+    customEvtMain = 0,                      // Fixed main thread event
+    customEvtDataReader,                    // Fixed data reader event
+    customEvtForward,                       // Forward computation of a node
+    customEvtBackward,                      // Backward computation of a node
+    customEvtOther,                         // Event with a custom description
+
+    customEvtMax
+};
+
+static const char* c_customEvtCategory[customEvtMax] = { "main", "reader", "forward", "backward", "custom" };
+
+
 //
 // The custom event record is a variable size datastructure in memory:
 // NULL terminated description string, followed by CustomEventRecord struct
@@ -89,9 +128,41 @@ struct CustomEventRecord
     long long       beginClock;
     long long       endClock;
     unsigned int    threadId;
+    int             category;
 };
 
 
+//
+// Node profiling records
+//
+struct NodeRecord
+{
+    std::wstring    operationName;
+    int             forwardCnt;
+    int             backwardCnt;
+    long long       forwardSum;   // time (ticks)
+    long long       backwardSum;  // time (ticks)
+    long long       flops;        // floating point operations of the kernels run for the node
+    long long       bytes;        // bytes read and written by the kernels run for the node
+};
+
+struct KernelRecord
+{
+    std::atomic<long long>  cnt;
+    std::atomic<long long>  flops;
+    std::atomic<long long>  bytes;
+};
+
+// Kernel operations counted on the calling thread, used to attribute them to the node being computed
+struct ThreadKernelCounts
+{
+    long long       flops;
+    long long       bytes;
+};
+
+static thread_local ThreadKernelCounts t_kernelCounts;
+
+
 //
 // Global state of the profiler
 //
@@ -99,6 +170,7 @@ struct ProfilerState
 {
     bool                    enabled;                     // Profiler enabled (active)
     bool                    syncGpu;                     // Sync GPU per each profiling event
+    bool                    profileNodes;                // Profile nodes and kernels
     bool                    cudaSyncEnabled;             // Runtime state of CUDA kernel sync
     std::wstring            profilerDir;                 // Directory where reports/logs are saved
     std::wstring            logSuffix;                   // Suffix to append to report/log file names
@@ -107,6 +179,9 @@ struct ProfilerState
     unsigned long long      customEventBufferBytes;      // Number of bytes allocated for the custom event buffer
     unsigned long long      customEventOffset;           // Offset to current place in buffer
     unique_ptr<char[]>      customEventBuffer;           // Pointer to custom event buffer
+    long long               initClock;                   // Time stamp of ProfilerInit(), origin of the timeline
+    std::unordered_map<std::wstring, NodeRecord> nodes;  // Profiling data for each node
+    KernelRecord            kernels[profilerKernelMax];  // Profiling data for each kernel
 };
 
 
@@ -120,10 +195,14 @@ static std::mutex g_mutex;
 unsigned int GetThreadId();
 
 void ProfilerGenerateReport(const std::wstring& fileName, struct tm* timeInfo);
+void ProfilerGenerateNodeReport(FILE* f);
+void ProfilerGenerateKernelReport(FILE* f);
 void FormatTimeStr(char* str, size_t strLen, double value);
 void FormatThroughputStr(char* str, size_t strLen, double value);
 void FormatBytesStr(char* str, size_t strLen, long long bytes);
+std::string EscapeJsonString(const std::string& str);
 void ProfilerGenerateDetailFile(const std::wstring& fileName);
+void ProfilerGenerateTraceFile(const std::wstring& fileName);
 
 
 double TicksToSeconds(long long ticks)
@@ -145,9 +224,10 @@ double TicksSqToSecondsSq(double ticksSq)
 // customEventBufferBytes: Size of the custom event buffer.
 // logSuffix: Suffix string to append to log file names.
 // syncGpu: Wait for GPU to complete processing for each profiling event with syncGpu flag set.
+// profileNodes: Time the forward and backward computation of every node, and count kernel operations.
 //
 void PERF_PROFILER_API ProfilerInit(const std::wstring& profilerDir, const unsigned long long customEventBufferBytes,
-    const std::wstring& logSuffix, const bool syncGpu)
+    const std::wstring& logSuffix, const bool syncGpu, const bool profileNodes)
 {
     if (g_profilerState != nullptr)
     {
@@ -164,7 +244,9 @@ void PERF_PROFILER_API ProfilerInit(const std::wstring& profilerDir, const unsig
     g_profilerState->customEventBuffer.reset(new char[customEventBufferBytes]);
 
     g_profilerState->syncGpu = syncGpu;
+    g_profilerState->profileNodes = profileNodes;
     g_profilerState->enabled = false;
+    g_profilerState->initClock = Clock::GetTimeStamp();
 
     if (_wmkdir(g_profilerState->profilerDir.c_str()) == -1 && errno != EEXIST)
     {
@@ -210,7 +292,7 @@ void ProfilerTimeRecordFixedEvent(const int eventId, const long long beginClock,
     g_profilerState->fixedEvents[eventId].cnt++;
 }
 
-void ProfilerTimeRecordToBuffer(const char* eventDescription, const long long beginClock, const long long endClock)
+void ProfilerTimeRecordToBuffer(const char* eventDescription, const long long beginClock, const long long endClock, const int category)
 {
     std::lock_guard<std::mutex> lock(g_mutex);
 
@@ -236,6 +318,7 @@ void ProfilerTimeRecordToBuffer(const char* eventDescription, const long long be
     eventRecord.beginClock = beginClock;
     eventRecord.endClock = endClock;
     eventRecord.threadId = GetThreadId();
+    eventRecord.category = category;
 
     memcpy(g_profilerState->customEventBuffer.get() + g_profilerState->customEventOffset, &eventRecord, sizeof(CustomEventRecord));
     g_profilerState->customEventOffset += sizeof(CustomEventRecord);
@@ -264,7 +347,8 @@ void PERF_PROFILER_API ProfilerTimeEnd(const long long stateId, const int eventI
 
     long long endClock = Clock::GetTimeStamp();
     ProfilerTimeRecordFixedEvent(eventId, stateId, endClock);
-    ProfilerTimeRecordToBuffer(c_fixedEvtDesc[eventId].eventDescription, stateId, endClock);
+    ProfilerTimeRecordToBuffer(c_fixedEvtDesc[eventId].eventDescription, stateId, endClock,
+        eventId > profilerSepDataReader ? customEvtDataReader : customEvtMain);
 }
 
 
@@ -274,7 +358,7 @@ void PERF_PROFILER_API ProfilerTimeEnd(const long long stateId, const char* even
     if (g_profilerState == nullptr)
         return;
 
-    ProfilerTimeRecordToBuffer(eventDescription, stateId, Clock::GetTimeStamp());
+    ProfilerTimeRecordToBuffer(eventDescription, stateId, Clock::GetTimeStamp(), customEvtOther);
 }
 
 
@@ -342,6 +426,88 @@ void PERF_PROFILER_API ProfilerThroughputEnd(const long long stateId, const int
 }
 
 
+//
+// Measure the time of the forward or backward computation of a node, and the kernel operations
+// executed for it on the calling thread.
+//
+bool PERF_PROFILER_API ProfilerNodesEnabled()
+{
+    // A nullptr state indicates that the profiler is globally disabled, and not initialized
+    return g_profilerState != nullptr && g_profilerState->profileNodes && g_profilerState->enabled;
+}
+
+
+ProfilerNodeState PERF_PROFILER_API ProfilerNodeTimeBegin()
+{
+    ProfilerNodeState state;
+    state.flops = t_kernelCounts.flops;
+    state.bytes = t_kernelCounts.bytes;
+    state.beginClock = Clock::GetTimeStamp();
+    return state;
+}
+
+
+void PERF_PROFILER_API ProfilerNodeTimeEnd(const ProfilerNodeState& state, const std::wstring& nodeName, const std::wstring& operationName,
+    const bool backward, const bool summary, const bool event)
+{
+    // A nullptr state indicates that the profiler is globally disabled, and not initialized
+    if (g_profilerState == nullptr)
+        return;
+
+    ProfilerSyncGpu();
+    long long endClock = Clock::GetTimeStamp();
+
+    if (summary)
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+
+        if (!g_profilerState->enabled)
+            return;
+
+        auto& nodeRecord = g_profilerState->nodes[nodeName];
+        if (nodeRecord.operationName.empty())
+            nodeRecord.operationName = operationName;
+        if (backward)
+        {
+            nodeRecord.backwardCnt++;
+            nodeRecord.backwardSum += endClock - state.beginClock;
+        }
+        else
+        {
+            nodeRecord.forwardCnt++;
+            nodeRecord.forwardSum += endClock - state.beginClock;
+        }
+        nodeRecord.flops += t_kernelCounts.flops - state.flops;
+        nodeRecord.bytes += t_kernelCounts.bytes - state.bytes;
+    }
+
+    if (event)
+    {
+        std::string description = std::string(msra::strfun::utf8(nodeName)) + " (" + std::string(msra::strfun::utf8(operationName)) + ")";
+        ProfilerTimeRecordToBuffer(description.c_str(), state.beginClock, endClock, backward ? customEvtBackward : customEvtForward);
+    }
+}
+
+
+//
+// Count the floating point operations and bytes moved by a kernel.
+//
+void PERF_PROFILER_API ProfilerKernelCount(const int kernelId, const long long flops, const long long bytes)
+{
+    // A nullptr state indicates that the profiler is globally disabled, and not initialized
+    if (g_profilerState == nullptr)
+        return;
+
+    t_kernelCounts.flops += flops;
+    t_kernelCounts.bytes += bytes;
+
+    auto& kernelRecord = g_profilerState->kernels[kernelId];
+    kernelRecord.cnt.fetch_add(1, std::memory_order_relaxed);
+    kernelRecord.flops.fetch_add(flops, std::memory_order_relaxed);
+    kernelRecord.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+
 //
 // Generate reports and release all resources.
 //
@@ -366,6 +532,10 @@ void PERF_PROFILER_API ProfilerClose()
     fileName = g_profilerState->profilerDir + L"/" + std::wstring(timeStr) + L"_detail_" + g_profilerState->logSuffix + L".csv";
     ProfilerGenerateDetailFile(fileName);
 
+    // Generate timeline in Chrome trace event format
+    fileName = g_profilerState->profilerDir + L"/" + std::wstring(timeStr) + L"_trace_" + g_profilerState->logSuffix + L".json";
+    ProfilerGenerateTraceFile(fileName);
+
     g_profilerState.reset();
 }
 
@@ -484,9 +654,79 @@ void ProfilerGenerateReport(const std::wstring& fileName, struct tm* timeInfo)
         if (printLine) fprintfOrDie(f, "\n");
     }
 
+    if (g_profilerState->profileNodes)
+    {
+        ProfilerGenerateNodeReport(f);
+        ProfilerGenerateKernelReport(f);
+    }
+
     fclose(f);
 }
 
+//
+// Summary of the nodes that took the most time. Rates are computed from the kernel operations
+// counted for the node, over its total time.
+//
+void ProfilerGenerateNodeReport(FILE* f)
+{
+    std::vector<std::pair<const std::wstring*, const NodeRecord*>> nodes;
+    long long totalSum = 0;
+    for (const auto& node : g_profilerState->nodes)
+    {
+        nodes.push_back(std::make_pair(&node.first, &node.second));
+        totalSum += node.second.forwardSum + node.second.backwardSum;
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const std::pair<const std::wstring*, const NodeRecord*>& a, const std::pair<const std::wstring*, const NodeRecord*>& b)
+    {
+        return a.second->forwardSum + a.second->backwardSum > b.second->forwardSum + b.second->backwardSum;
+    });
+
+    fprintfOrDie(f, "\n\nNodes (top %d of %d by forward + backward time)\n\n", (int)std::min(nodes.size(), c_maxNodesInReport), (int)nodes.size());
+    fprintfOrDie(f, "Node............................ Operation.............. ..Fwd Count ....Forward Time ..Bwd Count ...Backward Time .......Total Time ..Share ......GFLOP .........GB ....GFLOP/s .......GB/s ..FLOP/B\n\n");
+
+    for (size_t i = 0; i < std::min(nodes.size(), c_maxNodesInReport); i++)
+    {
+        const NodeRecord& nodeRecord = *nodes[i].second;
+        fprintfOrDie(f, "%-32.32s %-23.23s ", std::string(msra::strfun::utf8(*nodes[i].first)).c_str(), std::string(msra::strfun::utf8(nodeRecord.operationName)).c_str());
+
+        char str[32];
+        fprintfOrDie(f, "%11d ", nodeRecord.forwardCnt);
+        FormatTimeStr(str, sizeof(str), TicksToSeconds(nodeRecord.forwardSum));
+        fprintfOrDie(f, "%s ", str);
+        fprintfOrDie(f, "%11d ", nodeRecord.backwardCnt);
+        FormatTimeStr(str, sizeof(str), TicksToSeconds(nodeRecord.backwardSum));
+        fprintfOrDie(f, "%s ", str);
+
+        double seconds = TicksToSeconds(nodeRecord.forwardSum + nodeRecord.backwardSum);
+        FormatTimeStr(str, sizeof(str), seconds);
+        fprintfOrDie(f, "%s ", str);
+        fprintfOrDie(f, "%6.2f%% ", totalSum > 0 ? 100.0 * (nodeRecord.forwardSum + nodeRecord.backwardSum) / totalSum : 0.0);
+
+        fprintfOrDie(f, "%11.3f %11.3f ", nodeRecord.flops / 1e9, nodeRecord.bytes / 1e9);
+        fprintfOrDie(f, "%11.3f %11.3f ", seconds > 0.0 ? nodeRecord.flops / seconds / 1e9 : 0.0, seconds > 0.0 ? nodeRecord.bytes / seconds / 1e9 : 0.0);
+        fprintfOrDie(f, "%8.2f\n", nodeRecord.bytes > 0 ? (double)nodeRecord.flops / nodeRecord.bytes : 0.0);
+    }
+}
+
+//
+// Totals of the counted kernels.
+//
+void ProfilerGenerateKernelReport(FILE* f)
+{
+    fprintfOrDie(f, "\n\nKernels\n\n");
+    fprintfOrDie(f, "Kernel.................... ...........Count ...........GFLOP ..............GB ..........FLOP/B\n\n");
+
+    for (int kernelIdx = 0; kernelIdx < profilerKernelMax; kernelIdx++)
+    {
+        const KernelRecord& kernelRecord = g_profilerState->kernels[kernelIdx];
+        if (kernelRecord.cnt == 0)
+            continue;
+
+        fprintfOrDie(f, "%-26s: %16lld %16.3f %16.3f %16.2f\n", c_kernelDesc[kernelIdx], kernelRecord.cnt.load(),
+            kernelRecord.flops / 1e9, kernelRecord.bytes / 1e9, kernelRecord.bytes > 0 ? (double)kernelRecord.flops / kernelRecord.bytes : 0.0);
+    }
+}
+
 //
 // String formatting helpers for reporting.
 //
@@ -523,6 +763,31 @@ void FormatBytesStr(char* str, size_t strLen, long long bytes)
 
 
 
+std::string EscapeJsonString(const std::string& str)
+{
+    std::string escaped;
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            char code[8];
+            sprintf_s(code, sizeof(code), "\\u%04x", (unsigned int)(unsigned char)c);
+            escaped += code;
+        }
+        else
+        {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+
 //
 // Generate detail event file.
 //
@@ -555,13 +820,69 @@ void ProfilerGenerateDetailFile(const std::wstring& fileName)
 }
 
 
+//
+// Generate timeline in Chrome trace event format, see
+// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+// Every event becomes a complete event ("X") on its thread. Time stamps are in microseconds since ProfilerInit().
+//
+void ProfilerGenerateTraceFile(const std::wstring& fileName)
+{
+    FILE* f = _wfopen(fileName.c_str(), L"wt");
+    if (f == NULL)
+    {
+        RuntimeError("Error: ProfilerGenerateTraceFile: Cannot create file <%ls>.\n", fileName.c_str());
+    }
+
+    // Processes of different workers are told apart by their rank, which is the log suffix.
+    int processId = (int)wcstol(g_profilerState->logSuffix.c_str(), nullptr, 10);
+
+    fprintfOrDie(f, "{\"traceEvents\":[\n");
+    fprintfOrDie(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"CNTK %s\"}}", processId,
+        EscapeJsonString(std::string(msra::strfun::utf8(g_profilerState->logSuffix))).c_str());
+
+    // Threads with data reader events only are named as such.
+    std::map<unsigned int, bool> readerThreads;
+
+    char* eventPtr = g_profilerState->customEventBuffer.get();
+
+    while (eventPtr < (g_profilerState->customEventBuffer.get() + g_profilerState->customEventOffset))
+    {
+        char* descriptionStr = eventPtr;
+        eventPtr += strlen(descriptionStr) + 1;
+
+        CustomEventRecord* eventRecord = (CustomEventRecord*)eventPtr;
+        eventPtr += sizeof(CustomEventRecord);
+
+        fprintfOrDie(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u}",
+            EscapeJsonString(descriptionStr).c_str(), c_customEvtCategory[eventRecord->category],
+            1000000.0 * TicksToSeconds(eventRecord->beginClock - g_profilerState->initClock),
+            1000000.0 * TicksToSeconds(eventRecord->endClock - eventRecord->beginClock),
+            processId, eventRecord->threadId);
+
+        auto thread = readerThreads.insert(std::make_pair(eventRecord->threadId, true)).first;
+        thread->second = thread->second && eventRecord->category == customEvtDataReader;
+    }
+
+    for (const auto& thread : readerThreads)
+    {
+        fprintfOrDie(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+            processId, thread.first, thread.second ? "Data Reader" : "Main Thread");
+    }
+
+    fprintfOrDie(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    fclose(f);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Scoped helpers.
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void ProfilerContext::Init(const std::wstring& profilerDir, const unsigned long long customEventBufferBytes, const std::wstring& logSuffix, const bool syncGpu)
+void ProfilerContext::Init(const std::wstring& profilerDir, const unsigned long long customEventBufferBytes, const std::wstring& logSuffix, const bool syncGpu,
+                           const bool profileNodes)
 {
-    ProfilerInit(profilerDir, customEventBufferBytes, logSuffix, syncGpu);
+    ProfilerInit(profilerDir, customEventBufferBytes, logSuffix, syncGpu, profileNodes);
 }
 
 ProfilerContext::~ProfilerContext()
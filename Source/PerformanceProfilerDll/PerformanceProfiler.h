@@ -26,6 +26,17 @@
 // and ProfilerThroughputEnd() calls should be used. The throughput APIs can only be used
 // with fixed events.
 //
+// Node profiling is opt-in (profileNodes flag of ProfilerInit()). When turned on, the forward and
+// backward computation of every node is timed, and the main CPU kernels count the floating point
+// operations they execute and the bytes they read and write (PROFILE_KERNEL). The kernel counts are
+// attributed to the node computed on the same thread, which gives its arithmetic intensity and
+// achieved FLOP/s and bytes/s, e.g. for placing it on a roofline plot. The summary report then
+// lists the nodes that took the most time, and the kernel totals.
+//
+// Besides the summary report and the detail log, a timeline of all events, including those of
+// the data reader threads and the nodes, is written in the Chrome trace event format
+// (open it in chrome://tracing).
+//
 // CNTK specifics
 //
 // The profiler is turned off during the very first epoch to avoid polluting profile data with
@@ -37,6 +48,7 @@
 #ifdef CNTK_UWP // UWP does not support performance profiler
 
 #define PROFILE_SCOPE(eventId)      /*nothing*/
+#define PROFILE_KERNEL(kernelId, flops, bytes)  /*nothing*/
 
 #else
 
@@ -67,6 +79,7 @@ enum ProfilerEvents
     profilerEvtMainEpoch,                   // Train epoch loop time
     profilerEvtMainMinibatch,               // One minibatch loop time
     profilerEvtMainGetMinibatch,            // GetMinibatch() function time
+    profilerEvtMainWaitForPrefetch,         // Time GetMinibatch() waits for the reader pipeline to deliver a minibatch
     profilerEvtMainFB,                      // Forward + Backward pass time
     profilerEvtMainGradient,                // Gradient aggregation time
     profilerEvtMainWeights,                 // Weight update time
@@ -79,20 +92,40 @@ enum ProfilerEvents
 
     // Data reader events
     profilerEvtPrefetchMinibatch,           // Prefetching the next minibatch in a background thread
+    profilerEvtReadSequences,               // Reading sequences from the randomizer/deserializers (includes transforms)
+    profilerEvtTransformSequences,          // Applying transforms to the read sequences
+    profilerEvtPackMinibatch,               // Packing sequences into the minibatch buffers
+    profilerEvtCopyMinibatch,               // Copying the packed minibatch into the prefetch matrices (host to device)
 
     profilerEvtMax
 };
 
 
+//
+// Kernels that count their floating point operations and memory traffic when node profiling is on.
+// Counts are estimates: every operand element is assumed to be read once, every result element
+// written once (and also read if it is accumulated into).
+//
+enum ProfilerKernels
+{
+    profilerKernelGemm = 0,                 // Dense matrix product (CPUMatrix::MultiplyAndWeightedAdd)
+    profilerKernelTensorElementwise,        // Element-wise tensor operation (CPUMatrix::TensorOp without reduction)
+    profilerKernelTensorReduction,          // Tensor operation with reduction (CPUMatrix::TensorOp, TensorArgOp)
+
+    profilerKernelMax
+};
+
+
 //
 // Initialize all resources to enable profiling.
 // profilerDir: Directory where the profiler logs will be saved.
 // customEventBufferBytes: Bytes to allocate for the custom event buffer.
 // logSuffix: Suffix string to append to log files.
 // syncGpu: Wait for GPU to complete processing for each profiling event.
+// profileNodes: Time the forward and backward computation of every node, and count kernel operations.
 //
 void PERF_PROFILER_API ProfilerInit(const std::wstring& profilerDir, const unsigned long long customEventBufferBytes,
-    const std::wstring& logSuffix, const bool syncGpu);
+    const std::wstring& logSuffix, const bool syncGpu, const bool profileNodes = false);
 
 
 //
@@ -128,6 +161,36 @@ long long PERF_PROFILER_API ProfilerThroughputBegin();
 void PERF_PROFILER_API ProfilerThroughputEnd(const long long stateId, const int eventId, const long long bytes);
 
 
+//
+// Measure the time of the forward or backward computation of a node, and the kernel operations
+// executed for it on the calling thread.
+// ProfilerNodesEnabled() tells whether node profiling is on; ProfilerNodeTimeBegin() returns the
+// state that is passed to ProfilerNodeTimeEnd().
+// summary: Add the measurement to the node table of the summary report.
+// event: Add an event to the detail log and timeline.
+//
+struct ProfilerNodeState
+{
+    long long   beginClock;
+    long long   flops;
+    long long   bytes;
+};
+
+bool PERF_PROFILER_API ProfilerNodesEnabled();
+ProfilerNodeState PERF_PROFILER_API ProfilerNodeTimeBegin();
+void PERF_PROFILER_API ProfilerNodeTimeEnd(const ProfilerNodeState& state, const std::wstring& nodeName, const std::wstring& operationName,
+    const bool backward, const bool summary, const bool event);
+
+
+//
+// Count the floating point operations and bytes moved by a kernel. Use PROFILE_KERNEL, which
+// evaluates the counts only when node profiling is on.
+//
+void PERF_PROFILER_API ProfilerKernelCount(const int kernelId, const long long flops, const long long bytes);
+
+#define PROFILE_KERNEL(kernelId, flops, bytes)  do { if (ProfilerNodesEnabled()) ProfilerKernelCount(kernelId, flops, bytes); } while (0)
+
+
 //
 // Generate reports and release all resources.
 //
@@ -139,7 +202,8 @@ void PERF_PROFILER_API ProfilerClose();
 //
 struct PERF_PROFILER_API ProfilerContext
 {
-    void Init(const std::wstring& profilerDir = L"", const unsigned long long customEventBufferBytes = (32 * 1024 * 1024), const std::wstring& logSuffix = L"", const bool syncGpu = false);
+    void Init(const std::wstring& profilerDir = L"", const unsigned long long customEventBufferBytes = (32 * 1024 * 1024), const std::wstring& logSuffix = L"", const bool syncGpu = false,
+              const bool profileNodes = false);
     ~ProfilerContext();
 };
 
@@ -10,6 +10,7 @@
 #include "BinaryDataChunk.h"
 #include "FileHelper.h"
 #include "Reader.h"
+#include "Float16.h"
 
 
 namespace CNTK {
@@ -28,6 +29,7 @@ public:
         if (precision != DataType::Float && precision != DataType::Double)
             LogicError("Unsupported precision type %u.", (unsigned int)precision);
 
+        // Half precision data is converted to the requested precision.
         if ((m_dataType == ReaderDataType::tfloat && precision != DataType::Float) ||
             (m_dataType == ReaderDataType::tdouble && precision != DataType::Double))
             LogicError("Unsupported combination of the input data type %u and precision %u. "
@@ -61,6 +63,8 @@ public:
             return sizeof(float);
         if (m_dataType == ReaderDataType::tdouble)
             return sizeof(double);
+        if (m_dataType == ReaderDataType::tfloat16)
+            return sizeof(uint16_t);
         
         LogicError("Unsupported input data type %u.", (unsigned int)m_dataType);
     }
@@ -71,6 +75,7 @@ protected:
     {
         tfloat = 0,
         tdouble = 1,
+        tfloat16 = 2, // IEEE half precision, e.g. written by the "write" command with outputFormat=binary
         // TODO: 
         // tbool = 2, 1 bit per value (one-hot data)
         // tbyte = 3, 1 byte per value
@@ -91,7 +96,7 @@ protected:
     void ReadDataType(FILE* file)
     {
         CNTKBinaryFileHelper::ReadOrDie(&m_dataType, sizeof(m_dataType), 1, file);
-        if (m_dataType> ReaderDataType::tdouble)
+        if (m_dataType > ReaderDataType::tfloat16)
             RuntimeError("Unsupported input data type %u.", (unsigned int)m_dataType);
     }
 
@@ -115,6 +120,7 @@ protected:
         void* m_data;
         DataType m_dataType;
         NDShape m_sampleShape;
+        std::vector<char> m_convertedData; // owns m_data if the values had to be converted
     };
 
     struct SparseInputStreamBuffer : SparseSequenceData
@@ -164,6 +170,8 @@ public:
             sequenceDataPtr->m_numberOfSamples = *(uint32_t*)((char*)data + offset);
             offset += sizeof(uint32_t);
             sequenceDataPtr->m_data = (char*)data + offset;
+            if (m_dataType == ReaderDataType::tfloat16)
+                ConvertFromHalf(*sequenceDataPtr);
             sequenceDataPtr->m_sampleShape = GetSampleShape();
             sequenceDataPtr->m_elementType = m_precision;
             result[i]  = sequenceDataPtr;
@@ -172,6 +180,28 @@ public:
 
         return offset;
     }
+
+private:
+    void ConvertFromHalf(DenseInputStreamBuffer& sequence)
+    {
+        size_t numValues = (size_t)m_sampleDimension * sequence.m_numberOfSamples;
+        const uint16_t* values = (const uint16_t*)sequence.m_data;
+        if (m_precision == DataType::Float)
+            sequence.m_convertedData.resize(numValues * sizeof(float));
+        else
+            sequence.m_convertedData.resize(numValues * sizeof(double));
+
+        for (size_t i = 0; i < numValues; i++)
+        {
+            uint16_t value;
+            memcpy(&value, values + i, sizeof(value)); // the sequence data are not necessarily aligned
+            if (m_precision == DataType::Float)
+                ((float*)sequence.m_convertedData.data())[i] = Microsoft::MSR::CNTK::HalfToFloat(value);
+            else
+                ((double*)sequence.m_convertedData.data())[i] = Microsoft::MSR::CNTK::HalfToFloat(value);
+        }
+        sequence.m_data = sequence.m_convertedData.data();
+    }
 };
 
 class SparseBinaryDataDeserializer : public BinaryDataDeserializer
@@ -184,6 +214,9 @@ public:
         {
             RuntimeError("Sample dimension is too large for an IndexType value.");
         }
+
+        if (m_dataType == ReaderDataType::tfloat16)
+            RuntimeError("Half precision values are only supported for dense inputs.");
     }
 
     virtual  StorageFormat GetStorageFormat() override { return StorageFormat::SparseCSC; }
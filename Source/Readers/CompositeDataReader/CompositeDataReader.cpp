@@ -102,6 +102,7 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
         bool cleanse = config(L"checkData", true);
         deserializer = std::make_shared<Bundler>(config, deserializer, m_deserializers, cleanse);
     }
+    m_deserializer = deserializer;
 
     int verbosity = config(L"verbosity", 0);
 
@@ -116,6 +117,29 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
     // i.e. decompression of images.
     bool multiThreadedDeserialization = config(L"multiThreadedDeserialization", ContainsDeserializer(config, L"ImageDeserializer"));
 
+    // Optionally read sequences continuously on a persistent pool of threads, selecting the next minibatches ahead,
+    // so that the reading does not wait for the slowest sequence of every minibatch.
+    // The randomizer loads chunks while the sequences are read, so loading is made exclusive with reading.
+    SequenceDecoderPtr decoder;
+    if (config(L"streamingDeserialization", false))
+    {
+        deserializer = std::make_shared<ChunkLoadingGuard>(deserializer);
+        size_t minibatchesAhead = config(L"minibatchesReadAhead", 2);
+        size_t numberOfThreads = config(L"deserializationThreads", 0);
+        decoder = std::make_shared<SequenceDecoder>(deserializer->StreamInfos().size(), minibatchesAhead, numberOfThreads);
+        if (verbosity > 0)
+            fprintf(stderr, "CompositeDataReader: reading sequences on %d threads, %d minibatches ahead.\n",
+                    (int)decoder->NumberOfThreads(), (int)minibatchesAhead);
+    }
+
+    // Optionally group sequences of similar length into the same minibatch to reduce padding,
+    // by default in buckets of the size of the minibatch.
+    bool bucketByLength = config(L"bucketByLength", false);
+    size_t lengthBucketSizeInSamples = config(L"lengthBucketSizeInSamples", 0);
+    bool reportPaddingEfficiency = config(L"reportPaddingEfficiency", bucketByLength);
+    if (bucketByLength && (!composable || !randomize))
+        fprintf(stderr, "WARNING: 'bucketByLength' is only supported for randomized data of built-in deserializers, the option is ignored.\n");
+
     if (!composable) // Pick up simple interface.
     {
         if (randomize)
@@ -124,10 +148,10 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
             m_sequenceEnumerator = std::make_shared<LTTumblingWindowRandomizer>(deserializer,
                 sampleBasedRandomizationWindow, config(L"randomizationWindow", requestDataSize),
                 GetRandomSeed(config),
-                multiThreadedDeserialization, maxErrors);
+                multiThreadedDeserialization, maxErrors, decoder);
         }
         else
-            m_sequenceEnumerator = std::make_shared<LTNoRandomizer>(deserializer, multiThreadedDeserialization, maxErrors);
+            m_sequenceEnumerator = std::make_shared<LTNoRandomizer>(deserializer, multiThreadedDeserialization, maxErrors, decoder);
     }
     else
     {
@@ -165,10 +189,11 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
 
             bool shouldPrefetch = true;
             m_sequenceEnumerator = std::make_shared<BlockRandomizer>(verbosity, randomizationWindow, deserializer, shouldPrefetch,
-                multiThreadedDeserialization, maxErrors, sampleBasedRandomizationWindow, GetRandomSeed(config));
+                multiThreadedDeserialization, maxErrors, sampleBasedRandomizationWindow, GetRandomSeed(config),
+                bucketByLength, lengthBucketSizeInSamples, decoder);
         }
         else
-            m_sequenceEnumerator = std::make_shared<NoRandomizer>(deserializer, multiThreadedDeserialization, maxErrors);
+            m_sequenceEnumerator = std::make_shared<NoRandomizer>(deserializer, multiThreadedDeserialization, maxErrors, decoder);
     }
 
     // In case when there are transforms, applying them to the data.
@@ -182,7 +207,7 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
 
     // Currently for prefetch we use two alternating buffers,
     // same is the default.
-    size_t numAlternatingBuffers = 2;
+    size_t numAlternatingBuffers = DefaultNumberOfPackerBuffers;
 
     // Check whether to use local timeline, by default we use it for better performance.
     bool localTimeline = config(L"localTimeline", true);
@@ -202,7 +227,8 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
             outputStreams,
             numAlternatingBuffers,
             localTimeline,
-            m_corpus);
+            m_corpus,
+            reportPaddingEfficiency);
         break;
     case PackingMode::truncated:
     {
@@ -361,6 +387,14 @@ void CompositeDataReader::StartEpoch(const EpochConfiguration& cfg, const std::m
     ReaderBase::StartEpoch(config, inputDescriptions);
 }
 
+DataDeserializerPtr CompositeDataReader::GetDeserializerFor(const std::vector<std::wstring>& streamNames)
+{
+    for (const auto& transform : m_transforms)
+        if (std::find(streamNames.begin(), streamNames.end(), transform.m_streamName) != streamNames.end())
+            return nullptr;
+    return m_deserializer;
+}
+
 bool CompositeDataReader::ContainsDeserializer(const ConfigParameters& readerConfig, const wstring& type)
 {
     argvector<ConfigValue> deserializerConfigs =
@@ -60,6 +60,9 @@ public:
     // Starts a new epoch with the provided configuration
     void StartEpoch(const EpochConfiguration& config, const std::map<std::wstring, int>& inputDescriptions) override;
 
+    // The bundled deserializers, unless one of the streams is transformed.
+    DataDeserializerPtr GetDeserializerFor(const std::vector<std::wstring>& streamNames) override;
+
 private:
     bool CreateDeserializers(const Microsoft::MSR::CNTK::ConfigParameters& readerConfig);
     void CreateTransforms(const Microsoft::MSR::CNTK::ConfigParameters& deserializerConfig);
@@ -0,0 +1,64 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "DSSMConfigHelper.h"
+#include "DataReader.h"
+#include "StringUtil.h"
+#include "ReaderConstants.h"
+
+using std::string;
+using std::wstring;
+using std::pair;
+
+namespace CNTK {
+
+    using namespace Microsoft::MSR::CNTK;
+
+    DSSMConfigHelper::DSSMConfigHelper(const ConfigParameters& config)
+    {
+        if (!config.ExistsCurrent(L"input"))
+            InvalidArgument("DSSM deserializer requires an 'input' section, i.e. 'input = [ query = [ file = ... ; dim = ... ] ; doc = [ ... ] ]'.");
+
+        const ConfigParameters& input = config(L"input");
+        for (const pair<string, ConfigParameters>& section : input)
+        {
+            ConfigParameters sectionConfig = section.second;
+
+            DSSMInputDescriptor descriptor;
+            descriptor.m_name = msra::strfun::utf16(section.first);
+            if (sectionConfig.ExistsCurrent(L"alias"))
+                descriptor.m_name = msra::strfun::utf16(sectionConfig(L"alias"));
+
+            descriptor.m_filePath = msra::strfun::utf16(sectionConfig(L"file"));
+            descriptor.m_dimension = sectionConfig(L"dim");
+            if (descriptor.m_dimension == 0)
+                InvalidArgument("Input '%ls' has zero dimension.", descriptor.m_name.c_str());
+
+            m_inputs.push_back(descriptor);
+        }
+
+        if (m_inputs.empty())
+            InvalidArgument("DSSM deserializer requires at least one input.");
+
+        string precision = config.Find("precision", "float");
+        if (AreEqualIgnoreCase(precision, "double"))
+        {
+            m_elementType = DataType::Double;
+        }
+        else if (AreEqualIgnoreCase(precision, "float"))
+        {
+            m_elementType = DataType::Float;
+        }
+        else
+        {
+            RuntimeError("Not supported precision '%s'. Expected 'double' or 'float'.", precision.c_str());
+        }
+
+        m_chunkSizeBytes = config(L"chunkSizeInBytes", g_32MB);
+        m_traceLevel = config(L"traceLevel", 1);
+    }
+
+}
@@ -0,0 +1,52 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Reader.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+    class ConfigParameters;
+}}}
+
+namespace CNTK {
+
+// Description of a single DSSM binary input file (i.e. the query or the document side).
+struct DSSMInputDescriptor
+{
+    std::wstring m_name;     // Name of the stream.
+    std::wstring m_filePath; // Full path to the DSSM binary file.
+    size_t m_dimension;      // Dimension of the sparse samples.
+};
+
+// A helper class for DSSM specific parameters.
+// A simple wrapper around CNTK ConfigParameters.
+class DSSMConfigHelper
+{
+public:
+    explicit DSSMConfigHelper(const Microsoft::MSR::CNTK::ConfigParameters& config);
+
+    // Get all input files that are specified in the configuration.
+    // All files describe the same rows, i.e. row i of the query file is paired with row i of the document file.
+    const std::vector<DSSMInputDescriptor>& GetInputs() const { return m_inputs; }
+
+    DataType GetElementType() const { return m_elementType; }
+
+    size_t GetChunkSize() const { return m_chunkSizeBytes; }
+
+    unsigned int GetTraceLevel() const { return m_traceLevel; }
+
+    DISABLE_COPY_AND_MOVE(DSSMConfigHelper);
+
+private:
+    std::vector<DSSMInputDescriptor> m_inputs;
+    DataType m_elementType;
+    size_t m_chunkSizeBytes; // chunk size in bytes, summed over all input files
+    unsigned int m_traceLevel;
+};
+
+}
@@ -0,0 +1,240 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <algorithm>
+#include "DSSMDeserializer.h"
+#include "ReaderUtil.h"
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+// Header: int64 numRows, int32 numCols, int64 totalNnz.
+static const size_t s_dssmHeaderSize = sizeof(int64_t) + sizeof(int32_t) + sizeof(int64_t);
+
+DSSMInputFile::DSSMInputFile(const DSSMInputDescriptor& descriptor, DataType elementType) :
+    m_file(descriptor.m_filePath),
+    m_name(descriptor.m_name),
+    m_elementType(elementType),
+    m_elementSize(DataTypeSize(elementType)),
+    m_sampleShape(NDShape({ descriptor.m_dimension }))
+{
+    if (m_file.Size() < s_dssmHeaderSize)
+        RuntimeError("DSSM file '%ls' is too small to contain a header.", descriptor.m_filePath.c_str());
+
+    int64_t numRows;
+    memcpy(&numRows, m_file.Data(), sizeof(numRows));
+    if (numRows < 0 || m_file.Size() < s_dssmHeaderSize + numRows * sizeof(int64_t))
+        RuntimeError("DSSM file '%ls' has an invalid number of rows %" PRId64 ".", descriptor.m_filePath.c_str(), numRows);
+
+    m_numRows = (size_t)numRows;
+    m_offsets = m_file.Data() + s_dssmHeaderSize;
+    m_rows = m_offsets + m_numRows * sizeof(int64_t);
+}
+
+size_t DSSMInputFile::RangeSize(size_t begin, size_t end) const
+{
+    assert(begin <= end && end <= m_numRows);
+    if (begin == end)
+        return 0;
+
+    int64_t beginOffset = RowOffset(begin);
+    int64_t endOffset = end < m_numRows ? RowOffset(end) : (int64_t)(m_file.Data() + m_file.Size() - m_rows);
+    return endOffset > beginOffset ? (size_t)(endOffset - beginOffset) : 0;
+}
+
+void DSSMInputFile::GetRow(size_t row, SparseSequenceData& result, const void*& values) const
+{
+    size_t dataSize = m_file.Data() + m_file.Size() - m_rows;
+    int64_t offset = RowOffset(row);
+    if (offset < 0 || (size_t)offset + sizeof(int32_t) > dataSize)
+        RuntimeError("Row %" PRIu64 " of the DSSM input '%ls' points outside of the file.", row, m_name.c_str());
+
+    const char* rowData = m_rows + offset;
+    int32_t nnz;
+    memcpy(&nnz, rowData, sizeof(nnz));
+    if (nnz < 0 || (size_t)offset + sizeof(int32_t) + nnz * (m_elementSize + sizeof(int32_t)) > dataSize)
+        RuntimeError("Row %" PRIu64 " of the DSSM input '%ls' has an invalid number of non zero values %d.", row, m_name.c_str(), (int)nnz);
+
+    // Values and indices are referenced in place, the mapping outlives all sequences of a chunk.
+    values = rowData + sizeof(int32_t);
+    result.m_indices = (SparseIndexType*)(rowData + sizeof(int32_t) + nnz * m_elementSize);
+    result.m_nnzCounts.assign(1, (SparseIndexType)nnz);
+    result.m_totalNnzCount = nnz;
+    result.m_elementType = m_elementType;
+}
+
+StreamInformation DSSMInputFile::GetStreamInformation() const
+{
+    StreamInformation stream;
+    stream.m_name = m_name;
+    stream.m_storageFormat = StorageFormat::SparseCSC;
+    stream.m_elementType = m_elementType;
+    stream.m_sampleLayout = m_sampleShape;
+    return stream;
+}
+
+// Sparse sample that points into the mapped file.
+struct DSSMSequenceData : SparseSequenceData
+{
+    DSSMSequenceData(const NDShape& sampleShape) : SparseSequenceData(1), m_sampleShape(sampleShape), m_values(nullptr)
+    {}
+
+    const void* GetDataBuffer() override
+    {
+        return m_values;
+    }
+
+    const NDShape& GetSampleShape() override
+    {
+        return m_sampleShape;
+    }
+
+    const NDShape& m_sampleShape;
+    const void* m_values;
+};
+
+// A chunk is a contiguous range of rows, it only keeps the mapped files alive.
+class DSSMDeserializer::DSSMChunk : public Chunk
+{
+public:
+    DSSMChunk(const std::vector<DSSMInputFilePtr>& inputs, size_t firstRow, size_t numRows) :
+        m_inputs(inputs), m_firstRow(firstRow), m_numRows(numRows)
+    {}
+
+    void GetSequence(size_t sequenceIndex, std::vector<SequenceDataPtr>& result) override
+    {
+        assert(sequenceIndex < m_numRows);
+        size_t row = m_firstRow + sequenceIndex;
+        result.reserve(result.size() + m_inputs.size());
+        for (const auto& input : m_inputs)
+        {
+            auto sequence = std::make_shared<DSSMSequenceData>(input->SampleShape());
+            input->GetRow(row, *sequence, sequence->m_values);
+            sequence->m_key.m_sequence = row;
+            result.push_back(sequence);
+        }
+    }
+
+private:
+    std::vector<DSSMInputFilePtr> m_inputs;
+    size_t m_firstRow;
+    size_t m_numRows;
+};
+
+DSSMDeserializer::DSSMDeserializer(CorpusDescriptorPtr corpus, const DSSMConfigHelper& helper, bool primary) :
+    DataDeserializerBase(primary),
+    m_numRows(0),
+    m_traceLevel(helper.GetTraceLevel())
+{
+    if (corpus && !corpus->IsNumericSequenceKeys())
+        InvalidArgument("DSSM deserializer does not support non-numeric sequence keys.");
+
+    for (const auto& input : helper.GetInputs())
+    {
+        auto file = std::make_shared<DSSMInputFile>(input, helper.GetElementType());
+        if (!m_inputs.empty() && file->NumRows() != m_numRows)
+        {
+            RuntimeError("DSSM input '%ls' has %" PRIu64 " rows, expected %" PRIu64 " rows as in the other inputs.",
+                input.m_name.c_str(), file->NumRows(), m_numRows);
+        }
+
+        m_numRows = file->NumRows();
+        m_streams.push_back(file->GetStreamInformation());
+        m_streams.back().m_id = m_streams.size() - 1;
+        m_inputs.push_back(file);
+    }
+
+    CreateChunks(helper.GetChunkSize());
+
+    if (m_traceLevel > 1)
+    {
+        fprintf(stderr, "DSSMDeserializer: %" PRIu64 " rows in %" PRIu64 " input(s), split into %" PRIu64 " chunks.\n",
+            m_numRows, m_inputs.size(), m_chunkStartRows.size() - 1);
+    }
+}
+
+void DSSMDeserializer::CreateChunks(size_t chunkSizeBytes)
+{
+    m_chunkStartRows.clear();
+
+    size_t currentChunkSize = 0;
+    for (size_t row = 0; row < m_numRows; ++row)
+    {
+        if (currentChunkSize == 0)
+            m_chunkStartRows.push_back(row);
+
+        for (const auto& input : m_inputs)
+            currentChunkSize += input->RangeSize(row, row + 1);
+
+        if (currentChunkSize >= chunkSizeBytes)
+            currentChunkSize = 0;
+    }
+
+    m_chunkStartRows.push_back(m_numRows);
+}
+
+std::vector<ChunkInfo> DSSMDeserializer::ChunkInfos()
+{
+    std::vector<ChunkInfo> result;
+    result.reserve(m_chunkStartRows.size() - 1);
+    for (ChunkIdType i = 0; i < m_chunkStartRows.size() - 1; ++i)
+    {
+        // Each row is a sequence of a single sample.
+        size_t numRows = m_chunkStartRows[i + 1] - m_chunkStartRows[i];
+        result.push_back(ChunkInfo{ i, numRows, numRows });
+    }
+    return result;
+}
+
+void DSSMDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result)
+{
+    size_t begin = m_chunkStartRows[chunkId];
+    size_t end = m_chunkStartRows[chunkId + 1];
+    result.reserve(result.size() + end - begin);
+    for (size_t row = begin; row < end; ++row)
+    {
+        SequenceInfo info = {};
+        info.m_indexInChunk = row - begin;
+        info.m_numberOfSamples = 1;
+        info.m_chunkId = chunkId;
+        info.m_key.m_sequence = row;
+        info.m_key.m_sample = 0;
+        result.push_back(info);
+    }
+}
+
+bool DSSMDeserializer::GetSequenceInfoByKey(const SequenceKey& key, SequenceInfo& result)
+{
+    if (key.m_sequence >= m_numRows)
+        return false;
+
+    auto chunk = std::upper_bound(m_chunkStartRows.begin(), m_chunkStartRows.end(), key.m_sequence) - 1;
+    result.m_chunkId = (ChunkIdType)(chunk - m_chunkStartRows.begin());
+    result.m_indexInChunk = key.m_sequence - *chunk;
+    result.m_numberOfSamples = 1;
+    result.m_key = key;
+    return true;
+}
+
+ChunkPtr DSSMDeserializer::GetChunk(ChunkIdType chunkId)
+{
+    size_t begin = m_chunkStartRows[chunkId];
+    size_t end = m_chunkStartRows[chunkId + 1];
+
+    // Nothing is read here, let the OS start paging in the rows of the chunk.
+    for (const auto& input : m_inputs)
+    {
+        if (begin < end)
+            input->File().WillNeed(s_dssmHeaderSize + input->NumRows() * sizeof(int64_t) + input->RowOffset(begin), input->RangeSize(begin, end));
+    }
+
+    return std::make_shared<DSSMChunk>(m_inputs, begin, end - begin);
+}
+
+}
@@ -0,0 +1,101 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "DataDeserializerBase.h"
+#include "DSSMConfigHelper.h"
+#include "CorpusDescriptor.h"
+#include "MappedFile.h"
+
+namespace CNTK {
+
+// A single memory mapped file in the DSSM binary format. All values are stored in the element type of the reader:
+//   int64 numRows, int32 numCols, int64 totalNnz,
+//   int64 offsets[numRows]                                   - byte offset of each row relative to the data section,
+//   data section: for each row { int32 nnz, ElemType values[nnz], int32 rowIndices[nnz] }.
+class DSSMInputFile
+{
+public:
+    DSSMInputFile(const DSSMInputDescriptor& descriptor, DataType elementType);
+
+    size_t NumRows() const { return m_numRows; }
+
+    // Offset of the row inside the data section in bytes.
+    int64_t RowOffset(size_t row) const
+    {
+        assert(row < m_numRows);
+        int64_t offset;
+        memcpy(&offset, m_offsets + row * sizeof(int64_t), sizeof(offset));
+        return offset;
+    }
+
+    // Size of the data section occupied by the rows [begin, end) in bytes.
+    size_t RangeSize(size_t begin, size_t end) const;
+
+    // Fills the sparse sequence with pointers into the mapped row.
+    void GetRow(size_t row, SparseSequenceData& result, const void*& values) const;
+
+    const NDShape& SampleShape() const { return m_sampleShape; }
+
+    const MappedFile& File() const { return m_file; }
+
+    StreamInformation GetStreamInformation() const;
+
+private:
+    MappedFile m_file;
+    std::wstring m_name;
+    DataType m_elementType;
+    size_t m_elementSize;
+    NDShape m_sampleShape;
+    size_t m_numRows;
+    const char* m_offsets; // not necessarily aligned, accessed through memcpy
+    const char* m_rows;    // start of the data section
+
+    DISABLE_COPY_AND_MOVE(DSSMInputFile);
+};
+
+typedef std::shared_ptr<DSSMInputFile> DSSMInputFilePtr;
+
+// Data deserializer for the binary DSSM format (row aligned query/document files).
+// The files are memory mapped, sequences reference the mapped values and indices directly without copying,
+// so the packer reads the query/document pairs straight from the page cache.
+// Each row is a sequence of a single sparse sample. Chunks are contiguous row ranges of about chunkSizeInBytes.
+class DSSMDeserializer : public DataDeserializerBase
+{
+public:
+    DSSMDeserializer(CorpusDescriptorPtr corpus, const DSSMConfigHelper& helper, bool primary);
+
+    // Retrieves a chunk of data.
+    ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+    // Get information about chunks.
+    std::vector<ChunkInfo> ChunkInfos() override;
+
+    // Get information about particular chunk.
+    void SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result) override;
+
+protected:
+    // Rows are identified by their numeric sequence key.
+    bool GetSequenceInfoByKey(const SequenceKey& key, SequenceInfo& result) override;
+
+private:
+    class DSSMChunk;
+
+    // Splits the rows into chunks of approximately the requested size using the offset tables only.
+    void CreateChunks(size_t chunkSizeBytes);
+
+    std::vector<DSSMInputFilePtr> m_inputs;
+
+    // First row of each chunk, followed by the total number of rows.
+    std::vector<size_t> m_chunkStartRows;
+
+    size_t m_numRows;
+    unsigned int m_traceLevel;
+
+    DISABLE_COPY_AND_MOVE(DSSMDeserializer);
+};
+
+}
@@ -8,10 +8,16 @@
 #include "stdafx.h"
 #define DATAREADER_EXPORTS
 #include "DataReader.h"
+#ifdef _WIN32
 #include "DSSMReader.h"
+#endif
+#include "DSSMDeserializer.h"
+#include "CorpusDescriptor.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+#ifdef _WIN32
+// The legacy reader relies on Win32 file mappings and is only available on Windows.
 extern "C" DATAREADER_API void GetReaderF(IDataReader** preader)
 {
     *preader = new DSSMReader<float>();
@@ -20,5 +26,25 @@ extern "C" DATAREADER_API void GetReaderD(IDataReader** preader)
 {
     *preader = new DSSMReader<double>();
 }
+#endif
 
 }}}
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+extern "C" DATAREADER_API bool CreateDeserializer(DataDeserializerPtr& deserializer, const std::wstring& type, const ConfigParameters& deserializerConfig, CorpusDescriptorPtr corpus, bool primary)
+{
+    if (type == L"DSSMDeserializer")
+    {
+        deserializer = std::make_shared<DSSMDeserializer>(corpus, DSSMConfigHelper(deserializerConfig), primary);
+    }
+    else
+        InvalidArgument("Unknown deserializer type '%ls'", type.c_str());
+
+    // Deserializer created.
+    return true;
+}
+
+}
@@ -8,7 +8,10 @@
 #include "ConfigHelper.h"
 #include "Basics.h"
 #include "StringUtil.h"
+#include "BufferedFileReader.h"
+#include "ExceptionCapture.h"
 #include <unordered_set>
+#include <sstream>
 
 namespace CNTK {
 
@@ -114,40 +117,88 @@ void HTKDeserializer::InitializeAugmentationWindow(const std::pair<size_t, size_
     }
 }
 
-// Initializes chunks based on the configuration and utterance descriptions.
-void HTKDeserializer::InitializeChunkInfos(ConfigHelper& config)
+namespace {
+
+// Utterance of the script file as stored in the index cache.
+struct CachedUtterance
+{
+    uint64_t id;
+    uint32_t s, e;
+    uint32_t archivePathIndex; // index of the archive path among the strings of the cache.
+    uint8_t isarchive;
+    uint8_t isidxformat;
+    uint16_t reserved;
+};
+
+// Version of the script file index cache, must be bumped every time CachedUtterance changes.
+const uint64_t s_scpCacheVersion = 1;
+
+// Line of the script file parsed without touching any shared state.
+struct ParsedLine
+{
+    htkfeatreader::parsedpath path;
+    string key;
+    string archivePath;
+};
+
+}
+
+// Parses the script file, in parallel for large files.
+// Archive paths are registered and keys are mapped to ids sequentially, in the order of the file.
+void HTKDeserializer::ReadScriptFile(ConfigHelper& config, const string& scriptPath, deque<UtteranceDescription>& utterances,
+    unordered_map<size_t, vector<string>>& duplicates)
 {
-    string scriptPath = config.GetScpFilePath();
     string rootPath = config.GetRootPath();
     string scpDir = config.GetScpDir();
+    wstring scriptFilename = msra::strfun::utf16(scriptPath);
 
-    fprintf(stderr, "Reading script file %s ...", scriptPath.c_str());
-
-    ifstream scp(scriptPath.c_str());
-    if (!scp)
+    FileWrapper scp(scriptFilename, L"rb");
+    if (!scp.IsOpen())
         RuntimeError("Failed to open input file: %s", scriptPath.c_str());
+    size_t fileSize = scp.Filesize();
 
-    deque<UtteranceDescription> utterances;
-    size_t totalNumberOfFrames = 0;
-    std::unordered_map<size_t, std::vector<string>> duplicates;
+    auto ranges = SplitIntoLineAlignedRanges(scriptFilename, fileSize, GetNumberOfIndexingRanges(fileSize));
+    vector<vector<ParsedLine>> lines(ranges.size() - 1);
+    auto parse = [&](int i)
     {
-        std::unordered_set<size_t> uniqueIds;
-        string line, key;
-        while (getline(scp, line))
+        if (ranges[i] == ranges[i + 1])
+            return;
+
+        BufferedFileReader reader(g_2MB, i == 0 ? scp : FileWrapper(scriptFilename, L"rb"), ranges[i]);
+        string line;
+        while (reader.GetFileOffset() < ranges[i + 1] && reader.TryReadLine(line))
         {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+
             config.AdjustUtterancePath(rootPath, scpDir, line);
-            key.clear();
+            lines[i].push_back(ParsedLine());
+            auto& parsed = lines[i].back();
+            parsed.path = htkfeatreader::parsedpath::ParseUnregistered(line, parsed.key, parsed.archivePath);
+        }
+    };
 
-            UtteranceDescription description(htkfeatreader::parsedpath::Parse(line, key));
+    ExceptionCapture capture;
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int)lines.size(); ++i)
+        capture.SafeRun(parse, i);
+    capture.RethrowIfHappened();
+
+    std::unordered_set<size_t> uniqueIds;
+    for (auto& rangeLines : lines)
+    {
+        for (auto& parsed : rangeLines)
+        {
+            parsed.path.archivePathIdx = htkfeatreader::parsedpath::RegisterArchivePath(parsed.archivePath);
+            UtteranceDescription description(std::move(parsed.path));
             size_t numberOfFrames = description.GetNumberOfFrames();
 
             if (m_expandToPrimary && numberOfFrames != 1)
                 RuntimeError("Expanded stream should only contain sequences of length 1, utterance '%s' has %zu",
-                    key.c_str(),
+                    parsed.key.c_str(),
                     numberOfFrames);
 
-            totalNumberOfFrames += numberOfFrames;
-            size_t id = m_corpus->KeyToId(key);
+            size_t id = m_corpus->KeyToId(parsed.key);
             description.SetId(id);
             if (uniqueIds.find(id) == uniqueIds.end())
             {
@@ -156,13 +207,118 @@ void HTKDeserializer::InitializeChunkInfos(ConfigHelper& config)
             }
             else
             {
-                duplicates[id].push_back(key);
+                duplicates[id].push_back(parsed.key);
             }
         }
+        vector<ParsedLine>().swap(rangeLines);
     }
+}
+
+// Restores the utterances of the script file from the index cache.
+bool HTKDeserializer::TryLoadScriptFile(IndexCache& cache, deque<UtteranceDescription>& utterances)
+{
+    if (!cache.TryLoad())
+        return false;
+
+    // Archive paths are stored as a sequence of zero terminated strings.
+    vector<unsigned int> archivePathIndices;
+    for (const char* path = cache.Strings(); path < cache.Strings() + cache.StringsSize(); path += strlen(path) + 1)
+        archivePathIndices.push_back(htkfeatreader::parsedpath::RegisterArchivePath(path));
+
+    auto records = cache.Records<CachedUtterance>();
+    for (size_t i = 0; i < cache.NumberOfRecords(); ++i)
+    {
+        const auto& record = records[i];
+        if (record.archivePathIndex >= archivePathIndices.size())
+            return false;
+
+        htkfeatreader::parsedpath path;
+        path.s = record.s;
+        path.e = record.e;
+        path.archivePathIdx = archivePathIndices[record.archivePathIndex];
+        path.isarchive = record.isarchive != 0;
+        path.isidxformat = record.isidxformat != 0;
+
+        UtteranceDescription description(std::move(path));
+        if (m_expandToPrimary && description.GetNumberOfFrames() != 1)
+            RuntimeError("Expanded stream should only contain sequences of length 1, utterance with id %zu has %zu",
+                (size_t)record.id,
+                (size_t)description.GetNumberOfFrames());
 
-    if (scp.bad())
-        RuntimeError("An error occurred while reading input file: %s", scriptPath.c_str());
+        description.SetId(record.id);
+        utterances.push_back(std::move(description));
+    }
+
+    return true;
+}
+
+// Stores the utterances of the script file in the index cache.
+void HTKDeserializer::WriteScriptFileCacheAsync(const IndexCache& cache, const deque<UtteranceDescription>& utterances)
+{
+    vector<CachedUtterance> records;
+    records.reserve(utterances.size());
+
+    string strings;
+    unordered_map<unsigned int, uint32_t> archivePathIndices;
+    for (const auto& utterance : utterances)
+    {
+        const auto& path = utterance.GetPath();
+        auto index = archivePathIndices.find(path.archivePathIdx);
+        if (index == archivePathIndices.end())
+        {
+            index = archivePathIndices.insert(make_pair(path.archivePathIdx, (uint32_t)archivePathIndices.size())).first;
+            strings += msra::strfun::utf8(path.physicallocation());
+            strings += '\0';
+        }
+
+        CachedUtterance record = {};
+        record.id = utterance.GetId();
+        record.s = path.s;
+        record.e = path.e;
+        record.archivePathIndex = index->second;
+        record.isarchive = path.isarchive ? 1 : 0;
+        record.isidxformat = path.isidxformat ? 1 : 0;
+        records.push_back(record);
+    }
+
+    cache.WriteAsync(move(records), move(strings));
+}
+
+// Initializes chunks based on the configuration and utterance descriptions.
+void HTKDeserializer::InitializeChunkInfos(ConfigHelper& config)
+{
+    string scriptPath = config.GetScpFilePath();
+
+    fprintf(stderr, "Reading script file %s ...", scriptPath.c_str());
+
+    // The script file is only cached if the utterance ids do not depend on the order in which the keys are seen,
+    // i.e. when the keys are numeric or hashed.
+    bool enableCaching = config.GetCacheIndex() && (m_corpus->IsNumericSequenceKeys() || m_corpus->IsHashingEnabled());
+
+    // All options that affect the outcome of parsing the script file.
+    ostringstream options;
+    options << config.GetRootPath() << "\n" << config.GetScpDir() << "\n"
+        << (m_corpus->IsNumericSequenceKeys() ? "1" : "0") << "\n"
+        << (m_corpus->IsHashingEnabled() ? CorpusDescriptor::s_hashVersion : 0);
+
+    wstring scriptFilename = msra::strfun::utf16(scriptPath);
+    IndexCache cache(scriptFilename, scriptFilename + L".v" + to_wstring(s_scpCacheVersion) + L".cache", s_scpCacheVersion, options.str());
+
+    deque<UtteranceDescription> utterances;
+    std::unordered_map<size_t, std::vector<string>> duplicates;
+    if (!enableCaching || !TryLoadScriptFile(cache, utterances))
+    {
+        utterances.clear();
+        ReadScriptFile(config, scriptPath, utterances, duplicates);
+
+        // Duplicates are reported by their keys, which are not stored in the cache.
+        if (enableCaching && duplicates.empty())
+            WriteScriptFileCacheAsync(cache, utterances);
+    }
+
+    size_t totalNumberOfFrames = 0;
+    for (const auto& utterance : utterances)
+        totalNumberOfFrames += utterance.GetNumberOfFrames();
 
     fprintf(stderr, " %zu entries\n", utterances.size());
 
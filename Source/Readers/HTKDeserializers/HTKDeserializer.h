@@ -11,7 +11,9 @@
 #include "UtteranceDescription.h"
 #include "HTKChunkDescription.h"
 #include "ConfigHelper.h"
+#include "IndexCache.h"
 #include <boost/noncopyable.hpp>
+#include <deque>
 
 namespace CNTK {
 
@@ -47,6 +49,12 @@ private:
     void InitializeFeatureInformation();
     void InitializeAugmentationWindow(const std::pair<size_t, size_t>& augmentationWindow);
 
+    // Script file parsing and caching.
+    void ReadScriptFile(ConfigHelper& config, const std::string& scriptPath, std::deque<UtteranceDescription>& utterances,
+        std::unordered_map<size_t, std::vector<std::string>>& duplicates);
+    bool TryLoadScriptFile(IndexCache& cache, std::deque<UtteranceDescription>& utterances);
+    void WriteScriptFileCacheAsync(const IndexCache& cache, const std::deque<UtteranceDescription>& utterances);
+
     // Gets sequence by its chunk id and id inside the chunk.
     void GetSequenceById(ChunkIdType chunkId, size_t id, std::vector<SequenceDataPtr>&);
 
@@ -211,6 +211,16 @@ public:
         // constructor parses a=b[s,e] syntax and fills in the file
         // Can be used implicitly e.g. by passing a string to open().
         static parsedpath Parse(const string& pathParam, string& logicalPath)
+        {
+            string archivepath;
+            parsedpath result = ParseUnregistered(pathParam, logicalPath, archivepath);
+            result.archivePathIdx = RegisterArchivePath(archivepath);
+            return result;
+        }
+
+        // Same as above, but leaves the archive path unregistered (archivePathIdx is not set)
+        // and returns it instead. Does not touch the static state and so is thread-safe.
+        static parsedpath ParseUnregistered(const string& pathParam, string& logicalPath, string& archivepath)
         {
             const static string ubyte("-ubyte");
 
@@ -220,7 +230,8 @@ public:
             const static std::vector<bool> rightBracket = DelimiterHash({ ']' });
 
             parsedpath result;
-            string archivepath;
+            result.archivePathIdx = UINT_MAX;
+            archivepath.clear();
 
             auto start = pathParam.data();
             auto end = start + pathParam.size();
@@ -267,20 +278,21 @@ public:
                 }
             }
 
+            logicalPath = logicalPath.substr(0, logicalPath.find_last_of("."));
+            return result;
+        }
+
+        // Returns the index of the archive path, registering the path if it is seen for the first time.
+        static unsigned int RegisterArchivePath(const string& archivepath)
+        {
             auto iter = archivePathStringMap.find(archivepath);
             if (iter != archivePathStringMap.end())
-            {
-                result.archivePathIdx = iter->second;
-            }
-            else
-            {
-                result.archivePathIdx = (unsigned int)archivePathStringMap.size();
-                archivePathStringMap[archivepath] = result.archivePathIdx;
-                archivePathStringVector.push_back(msra::strfun::utf16(archivepath));
-            }
+                return iter->second;
 
-            logicalPath = logicalPath.substr(0, logicalPath.find_last_of("."));
-            return result;
+            unsigned int index = (unsigned int)archivePathStringMap.size();
+            archivePathStringMap[archivepath] = index;
+            archivePathStringVector.push_back(msra::strfun::utf16(archivepath));
+            return index;
         }
 
         // get the physical path for 'make' test
@@ -14,6 +14,9 @@
 #include "TimerUtility.h"
 #include "ImageTransformers.h"
 #include "ImageUtil.h"
+#include "BufferedFileReader.h"
+#include "ExceptionCapture.h"
+#include "IndexCache.h"
 
 namespace CNTK {
 
@@ -63,7 +66,7 @@ private:
 // that allows composition of deserializers and transforms on inputs.
 ImageDataDeserializer::ImageDataDeserializer(CorpusDescriptorPtr corpus, const ConfigParameters& config, bool primary) : ImageDeserializerBase(corpus, config, primary)
 {
-    CreateSequenceDescriptions(corpus, config(L"file"), m_labelGenerator->LabelDimension(), m_multiViewCrop);
+    CreateSequenceDescriptions(corpus, config(L"file"), m_labelGenerator->LabelDimension(), m_multiViewCrop, config(L"cacheIndex", false));
 }
 
 // TODO: Should be removed at some point.
@@ -135,14 +138,179 @@ void ImageDataDeserializer::SequenceInfosForChunk(ChunkIdType chunkId, std::vect
     result.push_back(m_imageSequences[chunkId]);
 }
 
-void ImageDataDeserializer::CreateSequenceDescriptions(CorpusDescriptorPtr corpus, std::string mapPath, size_t labelDimension, bool isMultiCrop)
+namespace {
+
+// Image of the map file with its sequence id and class label.
+struct MapFileEntry
+{
+    size_t key;
+    size_t classId;
+    std::string path;
+};
+
+// Map file entry as stored in the index cache, the path refers to the strings of the cache.
+struct CachedMapFileEntry
+{
+    uint64_t key;
+    uint64_t classId;
+    uint64_t pathOffset;
+    uint32_t pathSize;
+    uint32_t reserved;
+};
+
+// Version of the map file index cache, must be bumped every time CachedMapFileEntry changes.
+const uint64_t s_mapFileCacheVersion = 1;
+
+// Mimics std::getline(stream, token, '\t') on the remainder of the line that starts at pos.
+bool TryGetNextColumn(const std::string& line, size_t& pos, std::string& token)
+{
+    token.clear();
+    if (pos >= line.size())
+        return false;
+
+    size_t end = std::min(line.find('\t', pos), line.size());
+    token.assign(line, pos, end - pos);
+    pos = end + 1;
+    return true;
+}
+
+// Tab separated columns of a map file line.
+struct MapFileLine
 {
-    std::ifstream mapFile(mapPath);
-    if (!mapFile)
+    std::string sequenceKey;
+    std::string imagePath;
+    std::string classId;
+    bool hasSequenceKey;
+};
+
+// Parses the map file, splitting large files into ranges that are tokenized in parallel.
+// Class ids are validated and sequence keys are mapped to ids sequentially, in the order of the file.
+void ReadMapFile(CorpusDescriptorPtr corpus, const std::string& mapPath, size_t labelDimension, std::vector<MapFileEntry>& entries)
+{
+    std::wstring mapFilename = msra::strfun::utf16(mapPath);
+    FileWrapper mapFile(mapFilename, L"rb");
+    if (!mapFile.IsOpen())
     {
         RuntimeError("Could not open %s for reading.", mapPath.c_str());
     }
+    size_t fileSize = mapFile.Filesize();
+
+    auto ranges = SplitIntoLineAlignedRanges(mapFilename, fileSize, GetNumberOfIndexingRanges(fileSize));
+    std::vector<std::vector<MapFileLine>> lines(ranges.size() - 1);
+    auto tokenize = [&](int i)
+    {
+        if (ranges[i] == ranges[i + 1])
+            return;
+
+        BufferedFileReader reader(g_2MB, i == 0 ? mapFile : FileWrapper(mapFilename, L"rb"), ranges[i]);
+        std::string line;
+        while (reader.GetFileOffset() < ranges[i + 1] && reader.TryReadLine(line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+
+            lines[i].push_back(MapFileLine());
+            auto& columns = lines[i].back();
+            size_t pos = 0;
+            columns.hasSequenceKey = TryGetNextColumn(line, pos, columns.sequenceKey) &&
+                TryGetNextColumn(line, pos, columns.imagePath) &&
+                TryGetNextColumn(line, pos, columns.classId);
+        }
+    };
+
+    ExceptionCapture capture;
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int)lines.size(); ++i)
+        capture.SafeRun(tokenize, i);
+    capture.RethrowIfHappened();
+
+    size_t lineIndex = 0;
+    for (auto& rangeLines : lines)
+    {
+        for (auto& columns : rangeLines)
+        {
+            if (!columns.hasSequenceKey)
+            {
+                // In case when the sequence key is not specified we set it to the line number inside the mapping file.
+                // Assume that only image path and class label is given (old format).
+                columns.classId = columns.imagePath;
+                columns.imagePath = columns.sequenceKey;
+                columns.sequenceKey = std::to_string(lineIndex);
+
+                if (columns.classId.empty() || columns.imagePath.empty())
+                    RuntimeError("Invalid map file format, must contain 2 or 3 tab-delimited columns, line %" PRIu64 " in file %s.", lineIndex, mapPath.c_str());
+            }
+
+            char* eptr;
+            errno = 0;
+            size_t cid = strtoull(columns.classId.c_str(), &eptr, 10);
+            if (columns.classId.c_str() == eptr || errno == ERANGE)
+                RuntimeError("Cannot parse label value on line %" PRIu64 ", second column, in file %s.", lineIndex, mapPath.c_str());
+
+            if (cid >= labelDimension)
+            {
+                RuntimeError(
+                    "Image '%s' has invalid class id '%" PRIu64 "'. It is exceeding the label dimension of '%" PRIu64 "'. Line %" PRIu64 " in file %s.",
+                    columns.imagePath.c_str(), cid, labelDimension, lineIndex, mapPath.c_str());
+            }
+
+            entries.push_back(MapFileEntry{ corpus->KeyToId(columns.sequenceKey), cid, std::move(columns.imagePath) });
+            lineIndex++;
+        }
+        std::vector<MapFileLine>().swap(rangeLines);
+    }
+}
+
+bool TryLoadMapFile(IndexCache& cache, const std::string& mapPath, size_t labelDimension, std::vector<MapFileEntry>& entries)
+{
+    if (!cache.TryLoad())
+        return false;
 
+    auto records = cache.Records<CachedMapFileEntry>();
+    entries.reserve(cache.NumberOfRecords());
+    for (size_t i = 0; i < cache.NumberOfRecords(); ++i)
+    {
+        const auto& record = records[i];
+        if (record.pathOffset + record.pathSize > cache.StringsSize())
+            return false;
+
+        // The label dimension is not a part of the cache options, so class ids are validated again.
+        if (record.classId >= labelDimension)
+        {
+            RuntimeError(
+                "Image '%.*s' has invalid class id '%" PRIu64 "'. It is exceeding the label dimension of '%" PRIu64 "'. Line %" PRIu64 " in file %s.",
+                (int)record.pathSize, cache.Strings() + record.pathOffset, (size_t)record.classId, labelDimension, i, mapPath.c_str());
+        }
+
+        entries.push_back(MapFileEntry{ record.key, record.classId, std::string(cache.Strings() + record.pathOffset, record.pathSize) });
+    }
+    return true;
+}
+
+void WriteMapFileCacheAsync(const IndexCache& cache, const std::vector<MapFileEntry>& entries)
+{
+    std::vector<CachedMapFileEntry> records;
+    records.reserve(entries.size());
+
+    std::string strings;
+    for (const auto& entry : entries)
+    {
+        CachedMapFileEntry record = {};
+        record.key = entry.key;
+        record.classId = entry.classId;
+        record.pathOffset = strings.size();
+        record.pathSize = (uint32_t)entry.path.size();
+        strings += entry.path;
+        records.push_back(record);
+    }
+
+    cache.WriteAsync(std::move(records), std::move(strings));
+}
+
+}
+
+void ImageDataDeserializer::CreateSequenceDescriptions(CorpusDescriptorPtr corpus, std::string mapPath, size_t labelDimension, bool isMultiCrop, bool cacheIndex)
+{
     // Creating the default reader with expanded directory to the map file.
     auto mapFileDirectory = ExtractDirectory(mapPath);
     m_defaultReader = make_unique<FileByteReader>(mapFileDirectory);
@@ -150,46 +318,36 @@ void ImageDataDeserializer::CreateSequenceDescriptions(CorpusDescriptorPtr corpu
     size_t numberOfCopies = isMultiCrop ? ImageDeserializerBase::NumMultiViewCopies : 1;
     static_assert(ImageDeserializerBase::NumMultiViewCopies < std::numeric_limits<uint8_t>::max(), "Do not support more than 256 copies.");
 
+    Timer timer;
+    timer.Start();
+
+    // The map file is only cached if the sequence ids do not depend on the order in which the keys are seen,
+    // i.e. when the keys are numeric or hashed.
+    bool enableCaching = cacheIndex && (corpus->IsNumericSequenceKeys() || corpus->IsHashingEnabled());
+    std::string options = std::string(corpus->IsNumericSequenceKeys() ? "1" : "0") + "\n" +
+        std::to_string(corpus->IsHashingEnabled() ? CorpusDescriptor::s_hashVersion : 0);
+
+    std::wstring mapFilename = msra::strfun::utf16(mapPath);
+    IndexCache cache(mapFilename, mapFilename + L".v" + std::to_wstring(s_mapFileCacheVersion) + L".cache", s_mapFileCacheVersion, options);
+
+    std::vector<MapFileEntry> entries;
+    if (!enableCaching || !TryLoadMapFile(cache, mapPath, labelDimension, entries))
+    {
+        entries.clear();
+        ReadMapFile(corpus, mapPath, labelDimension, entries);
+        if (enableCaching)
+            WriteMapFileCacheAsync(cache, entries);
+    }
+
     size_t curId = 0;
-    std::string line;
     PathReaderMap knownReaders;
     ReaderSequenceMap readerSequences;
     ImageSequenceDescription description;
     description.m_numberOfSamples = 1;
 
-    Timer timer;
-    timer.Start();
-
-    for (size_t lineIndex = 0; std::getline(mapFile, line); ++lineIndex)
+    m_imageSequences.reserve(entries.size() * numberOfCopies);
+    for (auto& entry : entries)
     {
-        std::stringstream ss(line);
-        std::string imagePath, classId, sequenceKey;
-        // Try to parse sequence id, file path and label.
-        if (!std::getline(ss, sequenceKey, '\t') || !std::getline(ss, imagePath, '\t') || !std::getline(ss, classId, '\t'))
-        {
-            // In case when the sequence key is not specified we set it to the line number inside the mapping file.
-            // Assume that only image path and class label is given (old format).
-            classId = imagePath;
-            imagePath = sequenceKey;
-            sequenceKey = std::to_string(lineIndex);
-
-            if (classId.empty() || imagePath.empty())
-                RuntimeError("Invalid map file format, must contain 2 or 3 tab-delimited columns, line %" PRIu64 " in file %s.", lineIndex, mapPath.c_str());
-        }
-
-        char* eptr;
-        errno = 0;
-        size_t cid = strtoull(classId.c_str(), &eptr, 10);
-        if (classId.c_str() == eptr || errno == ERANGE)
-            RuntimeError("Cannot parse label value on line %" PRIu64 ", second column, in file %s.", lineIndex, mapPath.c_str());
-
-        if (cid >= labelDimension)
-        {
-            RuntimeError(
-                "Image '%s' has invalid class id '%" PRIu64 "'. It is exceeding the label dimension of '%" PRIu64 "'. Line %" PRIu64 " in file %s.",
-                imagePath.c_str(), cid, labelDimension, lineIndex, mapPath.c_str());
-        }
-
         if (ChunkIdMax < curId + numberOfCopies)
         {
             RuntimeError("Maximum number of chunks exceeded.");
@@ -197,9 +355,9 @@ void ImageDataDeserializer::CreateSequenceDescriptions(CorpusDescriptorPtr corpu
 
         // Fill in original sequence.
         description.m_indexInChunk = 0;
-        description.m_path = imagePath;
-        description.m_classId = cid;
-        description.m_key.m_sequence = corpus->KeyToId(sequenceKey);
+        description.m_path = std::move(entry.path);
+        description.m_classId = entry.classId;
+        description.m_key.m_sequence = entry.key;
         description.m_key.m_sample = 0;
 
         if (!m_primary)
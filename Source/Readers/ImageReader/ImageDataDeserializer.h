@@ -42,7 +42,8 @@ public:
 
 private:
     // Creates a set of sequence descriptions.
-    void CreateSequenceDescriptions(CorpusDescriptorPtr corpus, std::string mapPath, size_t labelDimension, bool isMultiCrop);
+    // If cacheIndex is set, the parsed map file is cached next to it (only for numeric or hashed sequence keys).
+    void CreateSequenceDescriptions(CorpusDescriptorPtr corpus, std::string mapPath, size_t labelDimension, bool isMultiCrop, bool cacheIndex = false);
 
     // Image sequence descriptions. Currently, a sequence contains a single sample only.
     struct ImageSequenceDescription : public SequenceInfo
@@ -12,7 +12,6 @@
 #include <utility>
 
 #include "DataReader.h"
-#include "ExceptionCapture.h"
 
 namespace CNTK {
 
@@ -24,7 +23,10 @@ BlockRandomizer::BlockRandomizer(
     bool multithreadedGetNextSequence,
     size_t maxNumberOfInvalidSequences,
     bool sampleBasedRandomizationWindow,
-    size_t seedOffset)
+    size_t seedOffset,
+    bool bucketByLength,
+    size_t lengthBucketSizeInSamples,
+    SequenceDecoderPtr decoder)
     : m_verbosity(verbosity),
       m_deserializer(deserializer),
       m_sweep(SIZE_MAX),
@@ -36,7 +38,11 @@ BlockRandomizer::BlockRandomizer(
       m_multithreadedGetNextSequences(multithreadedGetNextSequence),
       m_prefetchedChunk(ChunkIdMax),
       m_cleaner(maxNumberOfInvalidSequences),
-      m_seedOffset(seedOffset)
+      m_seedOffset(seedOffset),
+      m_bucketByLength(bucketByLength),
+      m_lengthBucketSizeInSamples(lengthBucketSizeInSamples),
+      m_isLengthBucketingConfigured(false),
+      m_decoder(decoder)
 {
     assert(deserializer != nullptr);
 
@@ -54,6 +60,15 @@ BlockRandomizer::BlockRandomizer(
 }
 
 std::map<std::wstring, size_t> BlockRandomizer::GetState()
+{
+    // With minibatches selected ahead, the position is that of the next minibatch to be returned.
+    std::map<std::wstring, size_t> state;
+    if (m_decoder && m_decoder->TryGetState(state))
+        return state;
+    return GetTimelineState();
+}
+
+std::map<std::wstring, size_t> BlockRandomizer::GetTimelineState()
 {
     return std::map<std::wstring, size_t>({ { g_minibatchSourcePosition , m_globalSamplePosition } });
 }
@@ -61,6 +76,9 @@ std::map<std::wstring, size_t> BlockRandomizer::GetState()
 // Start a new epoch.
 void BlockRandomizer::StartEpoch(const EpochConfiguration& config)
 {
+    if (m_decoder)
+        m_decoder->Reset(*this);
+
     m_currentWindowRange = ClosedOpenChunkInterval{};
 
     m_config = config;
@@ -82,6 +100,22 @@ void BlockRandomizer::StartEpoch(const EpochConfiguration& config)
     if (m_epochSize > std::numeric_limits<size_t>::max() / 2)
         InvalidArgument("Too big epoch size can cause bit overflow");
 
+    if (m_bucketByLength && !m_isLengthBucketingConfigured)
+    {
+        if (m_lengthBucketSizeInSamples == 0)
+            m_lengthBucketSizeInSamples = config.m_minibatchSizeInSamples;
+
+        m_sequenceRandomizer->EnableLengthBucketing(m_lengthBucketSizeInSamples);
+        m_isLengthBucketingConfigured = true;
+
+        // Make sure the current sweep gets re-randomized with bucketing.
+        m_sweep = SIZE_MAX;
+
+        if (m_verbosity >= Notification)
+            fprintf(stderr, "BlockRandomizer::StartEpoch: grouping sequences of similar length in buckets of %" PRIu64 " samples\n",
+                    m_lengthBucketSizeInSamples);
+    }
+
     m_epochStartPosition = m_epochSize * config.m_epochIndex;
     std::map<std::wstring, size_t> state;
     state[g_minibatchSourcePosition] = m_epochStartPosition;
@@ -123,13 +157,42 @@ void BlockRandomizer::PrepareNewSweepIfNeeded(size_t samplePosition)
 // Gets next sequences not exceeding global and local sample counts.
 Sequences BlockRandomizer::GetNextSequences(size_t globalSampleCount, size_t localSampleCount)
 {
-    // Get next sequence descriptions.
     Sequences result;
+    if (m_decoder)
+    {
+        result = m_decoder->GetNextSequences(*this, globalSampleCount, localSampleCount);
+    }
+    else
+    {
+        SequenceSelection selection;
+        auto windowRange = SelectSequences(globalSampleCount, localSampleCount, selection);
+        ReadSelectedSequences(selection, m_streams.size(), m_multithreadedGetNextSequences, result);
+
+        // Now it is safe to start the new chunk prefetch.
+        if (windowRange.Size() > 0)
+            Prefetch(GetChunkToPrefetch(windowRange));
+    }
+
+    m_cleaner.Clean(result);
+    return result;
+}
+
+void BlockRandomizer::SelectNextSequences(size_t globalSampleCount, size_t localSampleCount, SequenceSelection& selection)
+{
+    // The sequences are read on the threads of the decoder, so the prefetch starts right away.
+    auto windowRange = SelectSequences(globalSampleCount, localSampleCount, selection);
+    if (windowRange.Size() > 0)
+        Prefetch(GetChunkToPrefetch(windowRange));
+}
+
+ClosedOpenChunkInterval BlockRandomizer::SelectSequences(size_t globalSampleCount, size_t localSampleCount, SequenceSelection& selection)
+{
+    ClosedOpenChunkInterval windowRange;
     size_t numGlobalSamplesLoaded = 0, numLocalSamplesLoaded = 0;
     do
     {
         assert(globalSampleCount > numGlobalSamplesLoaded && localSampleCount > numLocalSamplesLoaded);
-        bool atTheSweepBoundary = result.m_endOfSweep;
+        bool atTheSweepBoundary = selection.m_endOfSweep;
         // in case when we continue filling up a minibatch that crosses a sweep boundary, 
         // make sure that it does not exceed the required number of samples. Set the atLeastOnceSequenceNeeded
         // flag to false.
@@ -137,7 +200,7 @@ Sequences BlockRandomizer::GetNextSequences(size_t globalSampleCount, size_t loc
         std::tie(numGlobalSamples, numLocalSamples) = 
             LoadSequenceData(globalSampleCount - numGlobalSamplesLoaded, 
                              localSampleCount - numLocalSamplesLoaded,
-                             result, !atTheSweepBoundary);
+                             selection, windowRange, !atTheSweepBoundary);
 
         if (atTheSweepBoundary && numGlobalSamples == 0)
         {
@@ -148,18 +211,16 @@ Sequences BlockRandomizer::GetNextSequences(size_t globalSampleCount, size_t loc
         numLocalSamplesLoaded += numLocalSamples;
 
     } while (m_config.m_allowMinibatchesToCrossSweepBoundaries && 
-             !result.m_endOfEpoch &&
-             result.m_endOfSweep &&
+             !selection.m_endOfEpoch &&
+             selection.m_endOfSweep &&
              globalSampleCount > numGlobalSamplesLoaded &&
              localSampleCount > numLocalSamplesLoaded);
 
-    m_cleaner.Clean(result);
-
-    return result;
+    return windowRange;
 }
 
 std::pair<size_t, size_t> BlockRandomizer::LoadSequenceData(size_t globalSampleCount, size_t localSampleCount,
-    Sequences& sequences, bool atLeastOneSequenceNeeded)
+    SequenceSelection& selection, ClosedOpenChunkInterval& loadedWindowRange, bool atLeastOneSequenceNeeded)
 {
     ClosedOpenChunkInterval windowRange;
     size_t numGlobalSamples = 0, numLocalSamples = 0; // actual number of samples to load (filled in from the sequence descriptions) 
@@ -168,74 +229,32 @@ std::pair<size_t, size_t> BlockRandomizer::LoadSequenceData(size_t globalSampleC
     std::tie(endOfSweep, endOfEpoch, numGlobalSamples, numLocalSamples) = 
         GetNextSequenceDescriptions(globalSampleCount, localSampleCount, windowRange, atLeastOneSequenceNeeded);
 
-    sequences.m_endOfSweep |= endOfSweep;
-    sequences.m_endOfEpoch |= endOfEpoch;
+    selection.m_endOfSweep |= endOfSweep;
+    selection.m_endOfEpoch |= endOfEpoch;
     
     assert(atLeastOneSequenceNeeded || (numGlobalSamples <= globalSampleCount && numLocalSamples <= localSampleCount));
 
     if (numGlobalSamples == 0)
     {
-        assert(!atLeastOneSequenceNeeded || sequences.m_endOfEpoch);
+        assert(!atLeastOneSequenceNeeded || selection.m_endOfEpoch);
         return {0, 0};
     }
 
     // Retrieve new data chunks if required.
     LoadDataChunks(windowRange);
 
-    auto& data = sequences.m_data;
-    size_t offset = 0;
+    loadedWindowRange = windowRange;
 
-    if (data.empty())
-    {
-        data.resize(m_streams.size(), std::vector<SequenceDataPtr>(m_sequenceBuffer.size()));
-    }
-    else
+    for (const auto& description : m_sequenceBuffer)
     {
-        // sequence data is not empty, we're appending new items to exiting 
-        // sequence data vectors.
-        offset = data.front().size();
-        for (auto& sequenceDataVector : data)
-        {
-            // make sure that all streams contain the same number of sequences
-            assert(sequenceDataVector.size() == offset); 
-            sequenceDataVector.resize(offset + m_sequenceBuffer.size());
-        }
-    }
-
-    auto process = [&](int i) -> void {
-        const auto& description = m_sequenceBuffer[i];
-        std::vector<SequenceDataPtr> sequenceData;
         auto it = m_chunks.find(description.m_chunk->m_original->m_id);
         if (it == m_chunks.end())
         {
             LogicError("Invalid chunk requested.");
         }
 
-        it->second->GetSequence(description.m_indexInOriginalChunk, sequenceData);
-        for (int j = 0; j < m_streams.size(); ++j)
-        {
-            assert(offset + i < data[j].size());
-            data[j][offset + i] = sequenceData[j];
-        }
-    };
-
-    if (m_multithreadedGetNextSequences)
-    {
-        ExceptionCapture capture;
-#pragma omp parallel for schedule(dynamic)
-        for (int i = 0; i < m_sequenceBuffer.size(); ++i)
-            capture.SafeRun(process, i);
-        capture.RethrowIfHappened();
+        selection.m_sequences.push_back(std::make_pair(it->second, (size_t)description.m_indexInOriginalChunk));
     }
-    else
-    {
-        for (int i = 0; i < m_sequenceBuffer.size(); ++i)
-            process(i);
-    }
-
-    // Now it is safe to start the new chunk prefetch.
-    ChunkIdType chunkToPrefetchNext = GetChunkToPrefetch(windowRange);
-    Prefetch(chunkToPrefetchNext);
 
     return { numGlobalSamples, numLocalSamples };
 }
@@ -294,6 +313,13 @@ std::tuple<bool, bool, size_t, size_t> BlockRandomizer::GetNextSequenceDescripti
             // Break if we're exceeding the local requested sample count.
             if (isLocal && actualNumberOfLocalSamples + sequenceLength > localSampleCount)
                 return false;
+
+            // Break at the beginning of a new length bucket that does not fit in the rest of the minibatch,
+            // so that a bucket is not split over two minibatches unless it is larger than a minibatch.
+            if (s.m_numberOfSamplesInLengthBucket != 0 && actualNumberOfGlobalSamples > 0 &&
+                (actualNumberOfGlobalSamples + s.m_numberOfSamplesInLengthBucket > globalSampleCount ||
+                 (isLocal && actualNumberOfLocalSamples + s.m_numberOfSamplesInLengthBucket > localSampleCount)))
+                return false;
         }
 
         if (m_globalSamplePosition + actualNumberOfGlobalSamples >= epochEndPosition)
@@ -469,6 +495,14 @@ void BlockRandomizer::Prefetch(ChunkIdType chunkId)
 }
 
 void BlockRandomizer::SetState(const std::map<std::wstring, size_t>& state)
+{
+    if (m_decoder)
+        m_decoder->Reset(*this);
+
+    SetTimelineState(state);
+}
+
+void BlockRandomizer::SetTimelineState(const std::map<std::wstring, size_t>& state)
 {
     auto it = state.find(g_minibatchSourcePosition);
     if (it == state.end())
@@ -490,6 +524,9 @@ void BlockRandomizer::SetState(const std::map<std::wstring, size_t>& state)
 
 void BlockRandomizer::SetConfiguration(const ReaderConfiguration& config)
 {
+    if (m_decoder)
+        m_decoder->Reset(*this);
+
     // If configuration changes this can lead to reinitialization of worker chunks.
     m_currentWindowRange = ClosedOpenChunkInterval{};
 
@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "SequenceEnumerator.h"
+#include "SequenceDecoder.h"
 #include "DataDeserializer.h"
 #include "ChunkRandomizer.h"
 #include "SequenceRandomizer.h"
@@ -30,10 +31,18 @@ namespace CNTK {
 //         5) decimate sequence descriptions based on the worker rank
 //         6) request chunks of data based on decimated sequences and return sequence data
 //
+// Optionally, sequences of similar length can be grouped into the same minibatch (bucketByLength) to reduce the padding
+// in the minibatch layout. This only changes the order of sequences inside of randomized chunks, so the sample based
+// positions of chunks on the global timeline and the partitioning of the data between workers are not affected.
+// A minibatch is cut short at the beginning of a bucket that does not fit in it, so that buckets are not split over
+// minibatches; some minibatches get fewer samples than requested.
+//
+// With a SequenceDecoder, the sequences are read on its pool of threads, and the following minibatches are selected ahead.
+//
 // This class is responsible for decimation and loading the data chunks in to memory.
 // Actual randomization happens in ChunkRandomizer and SequenceRandomizer.
 // TODO: The behavior can be simplified by only randomizing sequences forward.
-class BlockRandomizer : public SequenceEnumerator
+class BlockRandomizer : public SequenceEnumerator, public SequenceSelector
 {
 public:
     BlockRandomizer(
@@ -44,7 +53,10 @@ public:
         bool multithreadedGetNextSequences = false,
         size_t maxNumberOfInvalidSequences = 0, // per worker
         bool sampleBasedRandomizationWindow = true,
-        size_t seedOffset = 0);
+        size_t seedOffset = 0,
+        bool bucketByLength = false,
+        size_t lengthBucketSizeInSamples = 0, // 0 - the minibatch size of the first epoch
+        SequenceDecoderPtr decoder = nullptr);
 
     // Starts a new epoch.
     virtual void StartEpoch(const EpochConfiguration& config) override;
@@ -75,14 +87,32 @@ public:
 
     void SetConfiguration(const ReaderConfiguration& config) override;
 
+    void WaitForChunkPrefetch() override
+    {
+        if (m_prefetch.valid())
+        {
+            m_prefetch.wait();
+        }
+    }
+
 private:
+    // SequenceSelector, used by the decoder.
+    void SelectNextSequences(size_t globalSampleCount, size_t localSampleCount, SequenceSelection& selection) override;
+    std::map<std::wstring, size_t> GetTimelineState() override;
+    void SetTimelineState(const std::map<std::wstring, size_t>& state) override;
+
+    // Selects the sequences not exceeding global and local sample count, loading the chunks they are in.
+    // Returns the window of chunks of the last of them, used to choose the chunk to prefetch (empty if none are selected).
+    ClosedOpenChunkInterval SelectSequences(size_t globalSampleCount, size_t localSampleCount, SequenceSelection& selection);
+
     // Load data for chunks if needed.
     void LoadDataChunks(const ClosedOpenChunkInterval& windowRange);
 
-    // Load actual sequence data up to the specified global/local sample count
-    // (or at least one sequence when atLeastOneSequenceNeeded is true),
-    // Returns the total number of global and local samples loaded.
-    std::pair<size_t, size_t> LoadSequenceData(size_t globalSampleCount, size_t localSampleCount, Sequences& sequence, bool atLeastOneSequenceNeeded);
+    // Selects sequences up to the specified global/local sample count
+    // (or at least one sequence when atLeastOneSequenceNeeded is true), and loads their chunks.
+    // Returns the total number of global and local samples selected.
+    std::pair<size_t, size_t> LoadSequenceData(size_t globalSampleCount, size_t localSampleCount, SequenceSelection& selection,
+                                               ClosedOpenChunkInterval& windowRange, bool atLeastOneSequenceNeeded);
 
     // Gets the next sequence descriptions with the total number of samples not exceeding 
     // the sample count, when atLeastOneSequenceNeeded is false. Otherwise (when atLeastOneSequenceNeeded is true), 
@@ -121,6 +151,12 @@ private:
     // Offset used together with the current sweep to seed rngs.
     size_t m_seedOffset;
 
+    // Whether to group sequences of similar length and the size of the groups in samples.
+    // The size is fixed for the lifetime of the randomizer, so that the timeline can be restored from a checkpoint.
+    bool m_bucketByLength;
+    size_t m_lengthBucketSizeInSamples;
+    bool m_isLengthBucketingConfigured;
+
     // Total number of samples in a sweep.
     size_t m_sweepSizeInSamples;
 
@@ -168,6 +204,10 @@ private:
 
     // Helper class for removing invalid sequences.
     SequenceCleaner m_cleaner;
+
+    // Reads the sequences ahead in streaming mode, null otherwise.
+    // Declared last, so that its threads are stopped before the chunks and the deserializer are released.
+    SequenceDecoderPtr m_decoder;
 };
 
 }
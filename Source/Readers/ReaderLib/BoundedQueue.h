@@ -0,0 +1,108 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace CNTK {
+
+// Bounded queue for any number of producer and consumer threads, without locks (after D. Vyukov).
+// Every cell carries a sequence number that tells whether it is free to be written or ready to be read
+// in the current round over the ring; producers and consumers claim their position with a compare-and-swap.
+// The capacity is rounded up to a power of two.
+template <class T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size *= 2;
+
+        m_mask = size - 1;
+        m_cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i)
+            m_cells[i].m_sequence.store(i, std::memory_order_relaxed);
+
+        m_pushPosition.store(0, std::memory_order_relaxed);
+        m_popPosition.store(0, std::memory_order_relaxed);
+    }
+
+    // Returns false if the queue is full, 'value' is left untouched then.
+    bool TryPush(T& value)
+    {
+        Cell* cell;
+        size_t position = m_pushPosition.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &m_cells[position & m_mask];
+            size_t sequence = cell->m_sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+            if (difference == 0)
+            {
+                if (m_pushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (difference < 0)
+                return false;
+            else
+                position = m_pushPosition.load(std::memory_order_relaxed);
+        }
+
+        cell->m_value = std::move(value);
+        cell->m_sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns false if the queue is empty.
+    bool TryPop(T& value)
+    {
+        Cell* cell;
+        size_t position = m_popPosition.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &m_cells[position & m_mask];
+            size_t sequence = cell->m_sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+            if (difference == 0)
+            {
+                if (m_popPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (difference < 0)
+                return false;
+            else
+                position = m_popPosition.load(std::memory_order_relaxed);
+        }
+
+        value = std::move(cell->m_value);
+        cell->m_sequence.store(position + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    struct Cell
+    {
+        std::atomic<size_t> m_sequence;
+        T m_value;
+    };
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask;
+
+    // Producers and consumers update different cache lines.
+    alignas(64) std::atomic<size_t> m_pushPosition;
+    alignas(64) std::atomic<size_t> m_popPosition;
+};
+
+}
@@ -10,14 +10,17 @@ namespace CNTK {
 
     using namespace std;
 
-    BufferedFileReader::BufferedFileReader(size_t maxSize, const FileWrapper& file) 
-        : m_maxSize(maxSize), m_file(file)
+    BufferedFileReader::BufferedFileReader(size_t maxSize, const FileWrapper& file, size_t startOffset)
+        : m_maxSize(maxSize), m_fileOffset(startOffset), m_file(file)
     {
         m_file.CheckIsOpenOrDie();
 
         if (maxSize == 0)
             RuntimeError("Max buffer size cannot be zero.");
 
+        if (startOffset != 0)
+            m_file.SeekOrDie(startOffset, SEEK_SET);
+
         m_buffer.reserve(maxSize);
 
         Refill();
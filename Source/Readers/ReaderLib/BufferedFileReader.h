@@ -16,7 +16,8 @@ namespace CNTK {
 class BufferedFileReader
 {
 public:
-    BufferedFileReader(size_t maxSize, const FileWrapper& file);
+    // Reads the file starting at the given offset, line numbers are counted from that offset.
+    BufferedFileReader(size_t maxSize, const FileWrapper& file, size_t startOffset = 0);
 
     // File offset that correspond to the current position.
     inline size_t GetFileOffset() const { return m_fileOffset + m_index; }
@@ -0,0 +1,212 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <algorithm>
+#include <mutex>
+#include <numeric>
+#include "ChunkStatistics.h"
+#include "ExceptionCapture.h"
+#include "Fnv1aHash.h"
+
+namespace CNTK {
+
+using namespace std;
+using Microsoft::MSR::CNTK::Fnv1aHash;
+using Microsoft::MSR::CNTK::Fnv1aHashSeed;
+
+// Positions of the given streams in the stream infos of the deserializer, which is their position in the sequence data of a chunk.
+// Returns false if one of them is not found, or has an unsupported element type or an unknown dimension.
+static bool FindStreams(const DataDeserializerPtr& deserializer, const vector<wstring>& streamNames, vector<StreamInformation>& streams, vector<size_t>& positions)
+{
+    auto streamInfos = deserializer->StreamInfos();
+    for (const auto& name : streamNames)
+    {
+        auto stream = find_if(streamInfos.begin(), streamInfos.end(), [&](const StreamInformation& s) { return s.m_name == name; });
+        if (stream == streamInfos.end())
+            return false;
+        if (stream->m_elementType != DataType::Float && stream->m_elementType != DataType::Double)
+            return false;
+        if (stream->m_storageFormat != StorageFormat::Dense && stream->m_storageFormat != StorageFormat::SparseCSC)
+            return false;
+        if (stream->m_sampleLayout.HasUnboundDimension())
+            return false;
+        streams.push_back(*stream);
+        positions.push_back(stream - streamInfos.begin());
+    }
+    return true;
+}
+
+bool CanComputeChunkStatistics(const DataDeserializerPtr& deserializer, const vector<wstring>& streamNames)
+{
+    vector<StreamInformation> streams;
+    vector<size_t> positions;
+    return FindStreams(deserializer, streamNames, streams, positions);
+}
+
+uint64_t ComputeChunkTableFingerprint(const DataDeserializerPtr& deserializer, const vector<wstring>& streamNames)
+{
+    vector<StreamInformation> streams;
+    vector<size_t> positions;
+    if (!FindStreams(deserializer, streamNames, streams, positions))
+        LogicError("ComputeChunkTableFingerprint: unsupported streams.");
+
+    uint64_t hash = Fnv1aHashSeed;
+    for (const auto& stream : streams)
+    {
+        hash = Fnv1aHash(hash, stream.m_name);
+        hash = Fnv1aHash(hash, (int)stream.m_storageFormat);
+        hash = Fnv1aHash(hash, (int)stream.m_elementType);
+        hash = Fnv1aHash(hash, (uint64_t)stream.m_sampleLayout.TotalSize());
+    }
+
+    auto chunks = deserializer->ChunkInfos();
+    hash = Fnv1aHash(hash, (uint64_t)chunks.size());
+    for (const auto& chunk : chunks)
+    {
+        hash = Fnv1aHash(hash, (uint64_t)chunk.m_numberOfSequences);
+        hash = Fnv1aHash(hash, (uint64_t)chunk.m_numberOfSamples);
+    }
+    return hash;
+}
+
+// statistics of the dense samples of a set of sequences, in two passes
+template <class ElemType>
+static StreamStatistics DenseStatistics(const vector<SequenceDataPtr>& sequences, size_t dimension)
+{
+    size_t count = 0;
+    vector<double> mean(dimension, 0.0);
+    for (const auto& sequence : sequences)
+    {
+        const ElemType* data = static_cast<const ElemType*>(sequence->GetDataBuffer());
+        for (size_t j = 0; j < sequence->m_numberOfSamples * dimension; j += dimension)
+            for (size_t i = 0; i < dimension; i++)
+                mean[i] += data[j + i];
+        count += sequence->m_numberOfSamples;
+    }
+    if (count == 0)
+        return StreamStatistics(dimension);
+    for (auto& m : mean)
+        m /= count;
+
+    vector<double> sumOfSquaredDeviations(dimension, 0.0);
+    for (const auto& sequence : sequences)
+    {
+        const ElemType* data = static_cast<const ElemType*>(sequence->GetDataBuffer());
+        for (size_t j = 0; j < sequence->m_numberOfSamples * dimension; j += dimension)
+            for (size_t i = 0; i < dimension; i++)
+            {
+                double delta = data[j + i] - mean[i];
+                sumOfSquaredDeviations[i] += delta * delta;
+            }
+    }
+    return StreamStatistics(count, move(mean), move(sumOfSquaredDeviations));
+}
+
+// statistics of the sparse samples of a set of sequences, in two passes over the non-zero values
+// The zeros contribute count * mean^2 minus the part of it already covered by the non-zero values.
+template <class ElemType>
+static StreamStatistics SparseStatistics(const vector<SequenceDataPtr>& sequences, size_t dimension)
+{
+    size_t count = 0;
+    vector<double> mean(dimension, 0.0);
+    for (const auto& sequence : sequences)
+    {
+        const auto& sparse = static_cast<const SparseSequenceData&>(*sequence);
+        const ElemType* values = static_cast<const ElemType*>(sequence->GetDataBuffer());
+        size_t numValues = accumulate(sparse.m_nnzCounts.begin(), sparse.m_nnzCounts.end(), (size_t)0);
+        for (size_t k = 0; k < numValues; k++)
+            mean[sparse.m_indices[k]] += values[k];
+        count += sequence->m_numberOfSamples;
+    }
+    if (count == 0)
+        return StreamStatistics(dimension);
+    for (auto& m : mean)
+        m /= count;
+
+    vector<double> sumOfSquaredDeviations(dimension);
+    for (size_t i = 0; i < dimension; i++)
+        sumOfSquaredDeviations[i] = count * mean[i] * mean[i];
+    for (const auto& sequence : sequences)
+    {
+        const auto& sparse = static_cast<const SparseSequenceData&>(*sequence);
+        const ElemType* values = static_cast<const ElemType*>(sequence->GetDataBuffer());
+        size_t numValues = accumulate(sparse.m_nnzCounts.begin(), sparse.m_nnzCounts.end(), (size_t)0);
+        for (size_t k = 0; k < numValues; k++)
+        {
+            auto i = sparse.m_indices[k];
+            double delta = values[k] - mean[i];
+            sumOfSquaredDeviations[i] += delta * delta - mean[i] * mean[i];
+        }
+    }
+    return StreamStatistics(count, move(mean), move(sumOfSquaredDeviations));
+}
+
+static StreamStatistics SequenceStatistics(const StreamInformation& stream, const vector<SequenceDataPtr>& sequences)
+{
+    size_t dimension = stream.m_sampleLayout.TotalSize();
+    if (stream.m_storageFormat == StorageFormat::Dense)
+        return stream.m_elementType == DataType::Float ? DenseStatistics<float>(sequences, dimension) : DenseStatistics<double>(sequences, dimension);
+    else
+        return stream.m_elementType == DataType::Float ? SparseStatistics<float>(sequences, dimension) : SparseStatistics<double>(sequences, dimension);
+}
+
+void ComputeChunkStatistics(const DataDeserializerPtr& deserializer, const vector<wstring>& streamNames, size_t workerRank, size_t numWorkers,
+                            map<wstring, StreamStatistics>& statistics)
+{
+    vector<StreamInformation> streams;
+    vector<size_t> positions;
+    if (!FindStreams(deserializer, streamNames, streams, positions))
+        LogicError("ComputeChunkStatistics: unsupported streams.");
+
+    vector<ChunkIdType> chunkIds;
+    auto chunks = deserializer->ChunkInfos();
+    for (size_t i = workerRank; i < chunks.size(); i += numWorkers)
+        chunkIds.push_back(chunks[i].m_id);
+
+    statistics.clear();
+    for (const auto& stream : streams)
+        statistics[stream.m_name] = StreamStatistics(stream.m_sampleLayout.TotalSize());
+
+    mutex loadLock, mergeLock;
+    auto process = [&](int c)
+    {
+        ChunkPtr chunk;
+        vector<SequenceInfo> sequenceInfos;
+        {
+            lock_guard<mutex> guard(loadLock);
+            chunk = deserializer->GetChunk(chunkIds[c]);
+            deserializer->SequenceInfosForChunk(chunkIds[c], sequenceInfos);
+        }
+
+        vector<vector<SequenceDataPtr>> sequencesOfStream(streams.size());
+        vector<SequenceDataPtr> sequence;
+        for (const auto& info : sequenceInfos)
+        {
+            sequence.clear();
+            chunk->GetSequence(info.m_indexInChunk, sequence);
+            if (any_of(sequence.begin(), sequence.end(), [](const SequenceDataPtr& s) { return !s->m_isValid; }))
+                continue;
+            for (size_t s = 0; s < streams.size(); s++)
+                sequencesOfStream[s].push_back(sequence[positions[s]]);
+        }
+
+        for (size_t s = 0; s < streams.size(); s++)
+        {
+            auto chunkStatistics = SequenceStatistics(streams[s], sequencesOfStream[s]);
+            lock_guard<mutex> guard(mergeLock);
+            statistics[streams[s].m_name].Merge(chunkStatistics);
+        }
+    };
+
+    ExceptionCapture capture;
+#pragma omp parallel for schedule(dynamic)
+    for (int c = 0; c < (int)chunkIds.size(); c++)
+        capture.SafeRun(process, c);
+    capture.RethrowIfHappened();
+}
+
+}
@@ -0,0 +1,35 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include "DataDeserializer.h"
+#include "StreamStatistics.h"
+
+namespace CNTK {
+
+using Microsoft::MSR::CNTK::StreamStatistics;
+
+// Per-dimension statistics of input streams computed directly from the chunks of a deserializer, instead of reading all data
+// through randomizer, packer and network one minibatch at a time as the MeanNode and InvStdDevNode pre-computation does.
+// Chunks are processed on all OpenMP threads; within a chunk, the mean and the squared deviations are computed in two passes,
+// and the per-chunk results are merged into the total (see StreamStatistics::Merge()).
+// Loading of chunks is serialized, since deserializers are not required to support concurrent GetChunk() calls.
+
+// Returns false if one of the streams is not provided by the deserializer, its elements are neither float nor double,
+// or its dimension is not known.
+bool CanComputeChunkStatistics(const DataDeserializerPtr& deserializer, const std::vector<std::wstring>& streamNames);
+
+// Identifies the data of the streams by their layouts and the number of sequences and samples of every chunk.
+uint64_t ComputeChunkTableFingerprint(const DataDeserializerPtr& deserializer, const std::vector<std::wstring>& streamNames);
+
+// Computes the statistics over every numWorkers-th chunk, starting with chunk workerRank.
+void ComputeChunkStatistics(const DataDeserializerPtr& deserializer, const std::vector<std::wstring>& streamNames, size_t workerRank, size_t numWorkers,
+                            std::map<std::wstring, StreamStatistics>& statistics);
+
+}
@@ -16,7 +16,7 @@ public:
     FramePacker(
         SequenceEnumeratorPtr sequenceEnumerator,
         const std::vector<StreamInformation>& streams,
-        size_t numberOfBuffers = 2,
+        size_t numberOfBuffers = DefaultNumberOfPackerBuffers,
         bool useLocalTimeline = false,
         CorpusDescriptorPtr corpus = nullptr) :
         SequencePacker(sequenceEnumerator, streams, numberOfBuffers, useLocalTimeline, corpus)
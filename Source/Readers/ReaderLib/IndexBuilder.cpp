@@ -7,10 +7,12 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include <inttypes.h>
 #include <future>
+#include <algorithm>
 #include "IndexBuilder.h"
 #include "ReaderConstants.h"
 #include "FileWrapper.h"
 #include "EnvironmentUtil.h"
+#include "ExceptionCapture.h"
 #include <sstream>
 
 namespace CNTK {
@@ -30,18 +32,14 @@ shared_ptr<Index> IndexBuilder::Build()
 {
     if (m_isCacheEnabled) 
     {
-        auto cacheFilename = GetCacheFilename();
-        if (msra::files::fuptodate(cacheFilename, m_input.Filename(), true))
+        // try to reconstruct the index from an up-to-date cache.
+        auto index = TryLoadFromCache();
+
+        if (index != nullptr) 
         {
-            // cache file is up-to-date, try to reconstruct the index from cache.
-            auto index = TryLoadFromCache(cacheFilename, m_chunkSize);
-
-            if (index != nullptr) 
-            {
-                if (!m_primary) 
-                    index->MapSequenceKeyToLocation();
-                return index;
-            }
+            if (!m_primary) 
+                index->MapSequenceKeyToLocation();
+            return index;
         }
     }
     
@@ -68,88 +66,36 @@ void IndexBuilder::WriteIndexCacheAsync(shared_ptr<Index>& index)
     if (!m_isCacheEnabled)
         return;
 
-    if (Microsoft::MSR::CNTK::EnvironmentUtil::GetLocalMPINodeRank() != 0)
-        return; // only the main node should write the cache file.
-    
-    auto cacheFilename = GetCacheFilename();
+    vector<IndexedSequence> sequences;
+    sequences.reserve(index->NumberOfSequences());
 
-    // using thread(lambda).detach() as a workaround the blocking
-    // async destructor.
-    thread([cacheFilename, index]()
+    IndexedSequence cachedSequence;
+    for (auto& chunk : index->Chunks())
     {
-        // At this point, it's safe to assume that the previous cache is stale,
-        // remove the cache file if it exists (return value is ignored).
-        _wunlink(cacheFilename.c_str());
-
-        bool isCacheEnabled = true;
-        auto temp = cacheFilename + L".tmp";
+        for (auto& sequence : chunk.Sequences())
         {
-            FileWrapper cache(temp, L"wb");
-            isCacheEnabled = cache.IsOpen();
-
-            Prefix prefix(s_magic, s_version, index->NumberOfSequences(), uint64_t(sizeof(Prefix)));
-
-            isCacheEnabled = isCacheEnabled && cache.TryWrite(prefix);
-
-            IndexedSequence cachedSequence;
-            for (auto& chunk : index->Chunks())
-            {
-                for (auto& sequence : chunk.Sequences())
-                {
-                    cachedSequence.SetKey(sequence.m_key)
-                        .SetNumberOfSamples(sequence.NumberOfSamples())
-                        .SetSize(sequence.SizeInBytes())
-                        .SetOffset(chunk.StartOffset() + sequence.OffsetInChunk());
-
-                    isCacheEnabled = isCacheEnabled && cache.TryWrite(cachedSequence);
-                }
-            }
-
-            isCacheEnabled = isCacheEnabled && cache.TryFlush();
+            cachedSequence.SetKey(sequence.m_key)
+                .SetNumberOfSamples(sequence.NumberOfSamples())
+                .SetSize(sequence.SizeInBytes())
+                .SetOffset(chunk.StartOffset() + sequence.OffsetInChunk());
+            sequences.push_back(cachedSequence);
         }
-        
+    }
 
-        if (isCacheEnabled) 
-        {
-            try 
-            {
-                // TODO: add TryRename that does not throw.
-                renameOrDie(temp, cacheFilename);
-            }
-            catch (...) {}
-        }
-    }).detach();
+    // All the options are encoded in the cache filename.
+    IndexCache(m_input.Filename(), GetCacheFilename(), s_version, string()).WriteAsync(move(sequences));
 }
 
-const static size_t s_sequenceSize = sizeof(IndexedSequence);
-const static size_t s_numSequencesToBuffer = (g_1MB >> 1) / s_sequenceSize;
-
-/*static*/ shared_ptr<Index> IndexBuilder::TryLoadFromCache(const wstring& cacheFilename, size_t chunkSize)
+shared_ptr<Index> IndexBuilder::TryLoadFromCache()
 {
-    FileWrapper cache(cacheFilename.c_str(), L"rb");
-
-    if (!cache.IsOpen())
-        return nullptr;
-
-    Prefix prefix;
-    if (!cache.TryRead(prefix) || prefix.magic != s_magic)
+    IndexCache cache(m_input.Filename(), GetCacheFilename(), s_version, string());
+    if (!cache.TryLoad())
         return nullptr;
 
-    auto index = make_shared<Index>(chunkSize);
-
-    char buffer[s_numSequencesToBuffer * s_sequenceSize];
-    for (uint64_t i = 0; i < prefix.totalNumberOfSequences; )
-    {
-        auto numSequencesToRead = min(s_numSequencesToBuffer, prefix.totalNumberOfSequences - i);
-
-        if (!cache.TryRead(buffer, s_sequenceSize, numSequencesToRead))
-            return nullptr;
-
-        for (int j = 0; j < numSequencesToRead; j++) 
-            index->AddSequence(*reinterpret_cast<IndexedSequence*>(buffer + j * s_sequenceSize));
-        
-        i += numSequencesToRead;
-    }
+    auto index = make_shared<Index>(m_chunkSize);
+    auto sequences = cache.Records<IndexedSequence>();
+    for (size_t i = 0; i < cache.NumberOfRecords(); i++)
+        index->AddSequence(sequences[i]);
 
     return index;
 }
@@ -257,35 +203,84 @@ static const char s_BOM[3] = { '\xEF', '\xBB', '\xBF' };
 }
 
 void TextInputIndexBuilder::PopulateFromLines(shared_ptr<Index>& index)
+{
+    // The first range starts at the current position (i.e., past the BOM and leading spaces).
+    size_t startOffset = m_reader->GetFileOffset();
+    auto ranges = SplitIntoLineAlignedRanges(m_input.Filename(), m_fileSize, GetNumberOfIndexingRanges(m_fileSize));
+    ranges.erase(remove_if(ranges.begin() + 1, ranges.end() - 1, [startOffset](size_t offset) { return offset <= startOffset; }), ranges.end() - 1);
+    ranges.front() = startOffset;
+
+    size_t numberOfRanges = ranges.size() - 1;
+    if (numberOfRanges == 1)
+    {
+        PopulateFromLines(*m_reader, m_fileSize, [&index](const IndexedSequence& sequence) { index->AddSequence(sequence); });
+        return;
+    }
+
+    // Each range is scanned by its own reader, line numbers are local to the range
+    // and are turned into the global ones once all ranges are done.
+    vector<vector<IndexedSequence>> sequences(numberOfRanges);
+    vector<size_t> numberOfLines(numberOfRanges);
+    auto scan = [&](int i)
+    {
+        unique_ptr<BufferedFileReader> reader;
+        if (i != 0)
+            reader.reset(new BufferedFileReader(m_bufferSize, FileWrapper(m_input.Filename(), L"rb"), ranges[i]));
+
+        auto& rangeSequences = sequences[i];
+        numberOfLines[i] = PopulateFromLines(i == 0 ? *m_reader : *reader, ranges[i + 1],
+            [&rangeSequences](const IndexedSequence& sequence) { rangeSequences.push_back(sequence); });
+    };
+
+    ExceptionCapture capture;
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int)numberOfRanges; ++i)
+        capture.SafeRun(scan, i);
+    capture.RethrowIfHappened();
+
+    size_t firstLineNumber = 0;
+    for (size_t i = 0; i < numberOfRanges; ++i)
+    {
+        for (auto& sequence : sequences[i])
+            index->AddSequence(sequence.SetKey(sequence.Key() + firstLineNumber));
+
+        firstLineNumber += numberOfLines[i];
+        vector<IndexedSequence>().swap(sequences[i]);
+    }
+}
+
+size_t TextInputIndexBuilder::PopulateFromLines(BufferedFileReader& reader, size_t endOffset, const function<void(const IndexedSequence&)>& callback) const
 {
     IndexedSequence sequence;
-    while (!m_reader->Empty())
+    while (!reader.Empty() && reader.GetFileOffset() < endOffset)
     {
-        size_t offset = m_reader->GetFileOffset();
+        size_t offset = reader.GetFileOffset();
 
-        if (!FindMainStream())
+        if (!FindMainStream(reader))
         { 
             // skip lines that do not contain main stream name.
-            m_reader->TryMoveToNextLine();
+            reader.TryMoveToNextLine();
             continue;
         }
 
-        sequence.SetNumberOfSamples(1).SetOffset(offset).SetKey(m_reader->CurrentLineNumber());
+        sequence.SetNumberOfSamples(1).SetOffset(offset).SetKey(reader.CurrentLineNumber());
 
-        if (m_reader->TryMoveToNextLine())
+        if (reader.TryMoveToNextLine())
         {
-            sequence.SetSize(m_reader->GetFileOffset() - offset);
-            index->AddSequence(sequence);
+            sequence.SetSize(reader.GetFileOffset() - offset);
+            callback(sequence);
         } 
         else  if (offset < m_fileSize)
         {
             // There's a number of characters, not terminated by a newline,
             // add a sequence to the index, parser will have to deal with it.
             sequence.SetSize(m_fileSize - offset);
-            index->AddSequence(sequence);
+            callback(sequence);
             break;
         }
     }
+
+    return reader.CurrentLineNumber();
 }
 
 void TextInputIndexBuilder::PopulateImpl(shared_ptr<Index>& index)
@@ -344,9 +339,9 @@ void TextInputIndexBuilder::PopulateImpl(shared_ptr<Index>& index)
     }
 }
 
-inline bool TextInputIndexBuilder::FindMainStream()
+bool TextInputIndexBuilder::FindMainStream(BufferedFileReader& reader) const
 {
-    if (m_reader->Empty())
+    if (reader.Empty())
         return false;
     
     if (m_mainStream.empty())
@@ -357,7 +352,7 @@ inline bool TextInputIndexBuilder::FindMainStream()
     int i = 0;
     do  
     {
-        char c = m_reader->Peek();
+        char c = reader.Peek();
         if (i == length)
         {
             // we found a match, check to see if it's followed by either a space, 
@@ -375,7 +370,7 @@ inline bool TextInputIndexBuilder::FindMainStream()
 
         if (c == g_eol)
             break;
-    } while (m_reader->Pop());
+    } while (reader.Pop());
 
     // we hit either the EOL or the EOF, see if we have a match
     return (i == length);
@@ -12,6 +12,7 @@
 #include "CorpusDescriptor.h"
 #include "BufferedFileReader.h"
 #include "FileWrapper.h"
+#include "IndexCache.h"
 
 namespace CNTK {
 
@@ -28,6 +29,8 @@ class IndexedSequence
     
 public:
     IndexedSequence& SetKey(size_t value) { key = value; return *this;  }
+
+    size_t Key() const { return key; }
     
     IndexedSequence& SetNumberOfSamples(uint32_t value) { numberOfSamples = value; return *this; }
     
@@ -45,21 +48,6 @@ public:
 
 class IndexBuilder : private boost::noncopyable
 {
-    struct Prefix {
-        Prefix() = default;
-        Prefix(uint64_t magic, uint64_t version, uint64_t totalNumberOfSequences, 
-            uint64_t firstSequenceOffset = sizeof(Prefix))
-            : magic{ magic }, version{ version },
-            totalNumberOfSequences{ totalNumberOfSequences }, firstSequenceOffset{ firstSequenceOffset }
-        {}
-        uint64_t magic;
-        uint64_t version;
-        uint64_t totalNumberOfSequences;
-        uint64_t firstSequenceOffset; // this offset is set to the size of prefix for the moment
-        // but eventually, this can be used to append additional staff after prefix, without breaking
-        // back compat.
-    };
-
 public:
     // Reads the input file, building and index of chunks and corresponding
     // sequences. Returns input data index (chunk and sequence metadata);
@@ -93,14 +81,12 @@ protected:
 
     bool m_isCacheEnabled;
 
-    static const uint64_t s_version = 1;
+    static const uint64_t s_version = 2;
 
 private:
-    static std::shared_ptr<Index> TryLoadFromCache(const std::wstring& cacheFilename, size_t chunkSize);
+    std::shared_ptr<Index> TryLoadFromCache();
     void WriteIndexCacheAsync(std::shared_ptr<Index>& index);
     std::shared_ptr<Index> m_index;
-
-    static const uint64_t s_magic = 0x636e746b5f696478; // 'cntk_idx'
 };
 
 // A helper class that does a pass over the input file building up
@@ -145,7 +131,9 @@ private:
     std::unique_ptr<BufferedFileReader> m_reader;
 
     // Returns true if main stream name if found on the current line.
-    bool FindMainStream();
+    bool FindMainStream() { return FindMainStream(*m_reader); }
+
+    bool FindMainStream(BufferedFileReader& reader) const;
 
     // Invokes either TryGetNumericSequenceId or TryGetSymbolicSequenceId depending
     // on the specified corpus settings.
@@ -166,7 +154,12 @@ private:
 
     // Parses input line by line, treating each line as an individual sequence.
     // Ignores sequence id information, using the line number instead as the id.
+    // Large inputs are split into line aligned ranges that are scanned in parallel.
     void PopulateFromLines(std::shared_ptr<Index>& index);
+
+    // Scans the lines of the input up to the end offset, passing the sequences to the callback.
+    // Returns the line number of the reader at the end of the range.
+    size_t PopulateFromLines(BufferedFileReader& reader, size_t endOffset, const std::function<void(const IndexedSequence&)>& callback) const;
 };
 
 }
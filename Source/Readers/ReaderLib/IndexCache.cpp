@@ -0,0 +1,225 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <algorithm>
+#include <thread>
+#include <omp.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "IndexCache.h"
+#include "FileWrapper.h"
+#include "EnvironmentUtil.h"
+#include "ReaderConstants.h"
+
+namespace CNTK {
+
+using namespace std;
+
+namespace {
+
+const uint64_t s_magic = 0x636e746b5f696478 + 1; // 'cntk_idx' + 1, distinguishes the new layout from the old index cache.
+
+struct Header
+{
+    uint64_t magic;
+    uint64_t version;
+    uint64_t inputSize;
+    int64_t inputModificationTime;
+    uint64_t optionsSize;
+    uint64_t recordSize;
+    uint64_t numberOfRecords;
+    uint64_t stringsSize;
+};
+
+// Records are aligned on 8 bytes within the cache file.
+inline uint64_t RecordsOffset(uint64_t optionsSize)
+{
+    return (sizeof(Header) + optionsSize + 7) & ~uint64_t(7);
+}
+
+}
+
+IndexCache::IndexCache(const wstring& inputFilename, const wstring& cacheFilename, uint64_t version, const string& options)
+    : m_inputFilename(inputFilename),
+    m_cacheFilename(cacheFilename),
+    m_version(version),
+    m_options(options),
+    m_records(nullptr),
+    m_recordSize(0),
+    m_numberOfRecords(0),
+    m_strings(nullptr),
+    m_stringsSize(0)
+{}
+
+/*static*/ bool IndexCache::TryGetFileStatus(const wstring& filename, uint64_t& size, int64_t& modificationTime)
+{
+#ifdef _WIN32
+    struct _stat64 status;
+    if (_wstat64(filename.c_str(), &status) != 0)
+        return false;
+#else
+    struct stat status;
+    if (stat(msra::strfun::utf8(filename).c_str(), &status) != 0)
+        return false;
+#endif
+    size = (uint64_t)status.st_size;
+    modificationTime = (int64_t)status.st_mtime;
+    return true;
+}
+
+bool IndexCache::TryLoad()
+{
+    uint64_t inputSize;
+    int64_t inputModificationTime;
+    if (!TryGetFileStatus(m_inputFilename, inputSize, inputModificationTime) || !fexists(m_cacheFilename))
+        return false;
+
+    try
+    {
+        m_file.reset(new MappedFile(m_cacheFilename));
+    }
+    catch (const exception&)
+    {
+        // Cache is unreadable, the index will be rebuilt.
+        m_file.reset();
+        return false;
+    }
+
+    const char* data = m_file->Data();
+    uint64_t size = m_file->Size();
+    if (size < sizeof(Header))
+        return false;
+
+    const Header& header = *reinterpret_cast<const Header*>(data);
+    if (header.magic != s_magic || header.version != m_version ||
+        header.inputSize != inputSize || header.inputModificationTime != inputModificationTime ||
+        header.optionsSize != m_options.size() || header.recordSize == 0)
+        return false;
+
+    if (m_options.compare(0, string::npos, data + sizeof(Header), header.optionsSize) != 0)
+        return false;
+
+    uint64_t recordsOffset = RecordsOffset(header.optionsSize);
+    uint64_t stringsOffset = recordsOffset + header.recordSize * header.numberOfRecords;
+    if (stringsOffset + header.stringsSize != size)
+        return false; // truncated or corrupted.
+
+    m_records = data + recordsOffset;
+    m_recordSize = header.recordSize;
+    m_numberOfRecords = header.numberOfRecords;
+    m_strings = data + stringsOffset;
+    m_stringsSize = header.stringsSize;
+    return true;
+}
+
+void IndexCache::WriteAsync(shared_ptr<const void> records, size_t recordSize, size_t numberOfRecords, string&& strings) const
+{
+    if (Microsoft::MSR::CNTK::EnvironmentUtil::GetLocalMPINodeRank() != 0)
+        return; // only the main node should write the cache file.
+
+    Header header;
+    header.magic = s_magic;
+    header.version = m_version;
+    if (!TryGetFileStatus(m_inputFilename, header.inputSize, header.inputModificationTime))
+        return;
+    header.optionsSize = m_options.size();
+    header.recordSize = recordSize;
+    header.numberOfRecords = numberOfRecords;
+    header.stringsSize = strings.size();
+
+    auto cacheFilename = m_cacheFilename;
+    auto options = m_options;
+    auto pool = make_shared<string>(move(strings));
+
+    // using thread(lambda).detach() as a workaround the blocking
+    // async destructor.
+    thread([cacheFilename, header, options, records, pool]()
+    {
+        // At this point, it's safe to assume that the previous cache is stale,
+        // remove the cache file if it exists (return value is ignored).
+        _wunlink(cacheFilename.c_str());
+
+        bool isCacheEnabled = true;
+        auto temp = cacheFilename + L".tmp";
+        {
+            FileWrapper cache(temp, L"wb");
+            isCacheEnabled = cache.IsOpen();
+            isCacheEnabled = isCacheEnabled && cache.TryWrite(header);
+
+            const char padding[8] = {};
+            size_t paddingSize = RecordsOffset(options.size()) - sizeof(Header) - options.size();
+            isCacheEnabled = isCacheEnabled && (options.empty() || cache.TryWrite(options.data(), 1, options.size()));
+            isCacheEnabled = isCacheEnabled && (paddingSize == 0 || cache.TryWrite(padding, 1, paddingSize));
+
+            isCacheEnabled = isCacheEnabled &&
+                (header.numberOfRecords == 0 || cache.TryWrite(records.get(), header.recordSize, header.numberOfRecords));
+            isCacheEnabled = isCacheEnabled && (pool->empty() || cache.TryWrite(pool->data(), 1, pool->size()));
+            isCacheEnabled = isCacheEnabled && cache.TryFlush();
+        }
+
+        if (isCacheEnabled)
+        {
+            try
+            {
+                // TODO: add TryRename that does not throw.
+                renameOrDie(temp, cacheFilename);
+            }
+            catch (...) {}
+        }
+    }).detach();
+}
+
+vector<size_t> SplitIntoLineAlignedRanges(const wstring& filename, size_t fileSize, size_t maxNumberOfRanges)
+{
+    vector<size_t> boundaries(1, 0);
+    if (maxNumberOfRanges > 1 && fileSize > 0)
+    {
+        FileWrapper file(filename, L"rb");
+        file.CheckIsOpenOrDie();
+
+        const size_t rangeSize = fileSize / maxNumberOfRanges;
+        vector<char> buffer(4096);
+        for (size_t i = 1; i < maxNumberOfRanges; ++i)
+        {
+            // Ranges start right after the first end of line at or after the approximate boundary - 1,
+            // so that a boundary that already falls at the beginning of a line stays where it is.
+            size_t offset = max(i * rangeSize, boundaries.back() + 1) - 1;
+            if (offset >= fileSize)
+                break;
+
+            file.SeekOrDie(offset, SEEK_SET);
+            bool found = false;
+            while (!found)
+            {
+                size_t bytesRead = fread(buffer.data(), 1, buffer.size(), file.File());
+                if (bytesRead == 0)
+                    break;
+
+                auto eol = find(buffer.begin(), buffer.begin() + bytesRead, g_eol);
+                offset += eol - buffer.begin();
+                found = eol != buffer.begin() + bytesRead;
+            }
+
+            if (!found || offset + 1 >= fileSize)
+                break;
+
+            if (offset + 1 > boundaries.back())
+                boundaries.push_back(offset + 1);
+        }
+    }
+
+    boundaries.push_back(fileSize);
+    return boundaries;
+}
+
+size_t GetNumberOfIndexingRanges(size_t fileSize)
+{
+    if (fileSize < g_64MB)
+        return 1;
+    return (size_t)max(omp_get_max_threads(), 1);
+}
+
+}
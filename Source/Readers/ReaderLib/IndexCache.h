@@ -0,0 +1,93 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <type_traits>
+#include <boost/noncopyable.hpp>
+#include "MappedFile.h"
+
+namespace CNTK {
+
+// A persistent binary cache of the index of an input file (sequence offsets of a text file,
+// utterances of an HTK script, images of a map file, etc.). The cache file contains:
+//   a header, the indexing options (text), an array of fixed size records,
+//   and a pool of strings that records can refer to by offset.
+// A cache is only used if it was written by the same version of the indexer with the same options
+// for an input file of the same size and modification time. It is loaded by memory mapping
+// the cache file, so loading takes time proportional to the size of the index, not of the input.
+class IndexCache : private boost::noncopyable
+{
+public:
+    // inputFilename - the indexed file;
+    // cacheFilename - the cache file;
+    // version       - version of the record layout, must be bumped every time the indexer output changes;
+    // options       - all options that affect the outcome of indexing.
+    IndexCache(const std::wstring& inputFilename, const std::wstring& cacheFilename, uint64_t version, const std::string& options);
+
+    const std::wstring& Filename() const { return m_cacheFilename; }
+
+    // Maps the cache file. Returns false if there's no up-to-date cache for the input file.
+    bool TryLoad();
+
+    // Records and strings of a loaded cache, valid until the object is destroyed.
+    template <class Record>
+    const Record* Records() const
+    {
+        if (sizeof(Record) != m_recordSize)
+            LogicError("Index cache '%ls' contains records of %zu bytes, expected %zu.", m_cacheFilename.c_str(), (size_t)m_recordSize, sizeof(Record));
+        return reinterpret_cast<const Record*>(m_records);
+    }
+
+    size_t NumberOfRecords() const { return m_numberOfRecords; }
+
+    const char* Strings() const { return m_strings; }
+
+    size_t StringsSize() const { return m_stringsSize; }
+
+    // Writes the cache in a background thread (the records are moved into the writer).
+    // Only the first local MPI rank writes the cache, into a temporary file which is renamed upon completion,
+    // so readers never see a partially written cache. Failures are ignored: the index is simply rebuilt next time.
+    template <class Record>
+    void WriteAsync(std::vector<Record>&& records, std::string&& strings = std::string()) const
+    {
+        static_assert(std::is_pod<Record>::value, "Index cache records must be plain old data.");
+        auto data = std::make_shared<std::vector<Record>>(std::move(records));
+        WriteAsync(std::shared_ptr<const void>(data, data->data()), sizeof(Record), data->size(), std::move(strings));
+    }
+
+private:
+    void WriteAsync(std::shared_ptr<const void> records, size_t recordSize, size_t numberOfRecords, std::string&& strings) const;
+
+    // Returns false if the size or the modification time of the file cannot be determined.
+    static bool TryGetFileStatus(const std::wstring& filename, uint64_t& size, int64_t& modificationTime);
+
+    std::wstring m_inputFilename;
+    std::wstring m_cacheFilename;
+    uint64_t m_version;
+    std::string m_options;
+
+    std::unique_ptr<MappedFile> m_file;
+    const char* m_records;
+    uint64_t m_recordSize;
+    uint64_t m_numberOfRecords;
+    const char* m_strings;
+    uint64_t m_stringsSize;
+};
+
+// Splits the file into at most maxNumberOfRanges ranges of roughly equal size, so that the file can be
+// indexed in parallel. Each range starts at the beginning of a line. Returns the start offsets of
+// the ranges followed by the file size.
+std::vector<size_t> SplitIntoLineAlignedRanges(const std::wstring& filename, size_t fileSize, size_t maxNumberOfRanges);
+
+// Returns the number of ranges a file of the given size should be indexed with:
+// one for files below 64MB, otherwise one per available thread.
+size_t GetNumberOfIndexingRanges(size_t fileSize);
+
+}
@@ -8,8 +8,9 @@
 
 namespace CNTK {
 
-LTNoRandomizer::LTNoRandomizer(DataDeserializerPtr deserializer, bool multithreadedGetNextSequences, size_t maxNumberOfInvalidSequences)
-: Base(deserializer, multithreadedGetNextSequences, maxNumberOfInvalidSequences),
+LTNoRandomizer::LTNoRandomizer(DataDeserializerPtr deserializer, bool multithreadedGetNextSequences, size_t maxNumberOfInvalidSequences,
+                               SequenceDecoderPtr decoder)
+: Base(deserializer, multithreadedGetNextSequences, maxNumberOfInvalidSequences, decoder),
   m_currentChunkPosition(0),
   m_currentSequencePosition(0)
 {
@@ -20,7 +20,8 @@ public:
     LTNoRandomizer(
         DataDeserializerPtr deserializer,
         bool multithreadedGetNextSequences = false,
-        size_t maxNumberOfInvalidSequences = 0); // per worker
+        size_t maxNumberOfInvalidSequences = 0, // per worker
+        SequenceDecoderPtr decoder = nullptr);
 
     std::map<std::wstring, size_t> GetInnerState() override;
     void SetInnerState(const std::map<std::wstring, size_t>& state) override;
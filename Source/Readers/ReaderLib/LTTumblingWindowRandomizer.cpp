@@ -20,8 +20,9 @@ LTTumblingWindowRandomizer::LTTumblingWindowRandomizer(
     size_t randomizationRange,
     size_t seedOffset,
     bool multithreadedGetNextSequences,
-    size_t maxNumberOfInvalidSequences)
-: Base(deserializer, multithreadedGetNextSequences, maxNumberOfInvalidSequences),
+    size_t maxNumberOfInvalidSequences,
+    SequenceDecoderPtr decoder)
+: Base(deserializer, multithreadedGetNextSequences, maxNumberOfInvalidSequences, decoder),
   m_randomizationRange(randomizationRange),
   m_seedOffset(seedOffset),
   m_chunkPosition(0),
@@ -23,7 +23,8 @@ public:
         size_t randomizationRange,
         size_t seedOffset = 0,
         bool multithreadedGetNextSequences = false,
-        size_t maxNumberOfInvalidSequences= 0); // per worker
+        size_t maxNumberOfInvalidSequences= 0, // per worker
+        SequenceDecoderPtr decoder = nullptr);
 
     std::map<std::wstring, size_t> GetInnerState() override;
     void SetInnerState(const std::map<std::wstring, size_t>& state) override;
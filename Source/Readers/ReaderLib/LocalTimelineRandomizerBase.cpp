@@ -8,7 +8,6 @@
 
 #include "LocalTimelineRandomizerBase.h"
 #include "DataReader.h"
-#include "ExceptionCapture.h"
 
 namespace CNTK {
 
@@ -17,13 +16,15 @@ const SequenceInfo LocalTimelineRandomizerBase::s_endOfSweep = { std::numeric_li
 LocalTimelineRandomizerBase::LocalTimelineRandomizerBase(
     DataDeserializerPtr deserializer,
     bool multithreadedGetNextSequences,
-    size_t maxNumberOfInvalidSequences)
+    size_t maxNumberOfInvalidSequences,
+    SequenceDecoderPtr decoder)
 : m_deserializer(deserializer),
   m_multithreadedGetNextSequences(multithreadedGetNextSequences),
   m_cleaner(maxNumberOfInvalidSequences),
   m_sweepCount(0),
   m_sampleCount(0),
-  m_originalChunkDescriptions(deserializer->ChunkInfos())
+  m_originalChunkDescriptions(deserializer->ChunkInfos()),
+  m_decoder(decoder)
 {
     if (m_originalChunkDescriptions.empty())
         RuntimeError("The deserializer does not have any data, the number of chunks is 0.");
@@ -34,6 +35,9 @@ void LocalTimelineRandomizerBase::StartEpoch(const EpochConfiguration& config)
     if(config.m_epochIndex != 0)
         LogicError("LocalTimelineRandomizerBase is not supported for old configs.");
 
+    if (m_decoder)
+        m_decoder->Reset(*this);
+
     m_config = config;
     if (config.m_totalEpochSizeInSweeps == g_infinity && m_config.m_totalEpochSizeInSamples == Microsoft::MSR::CNTK::requestDataSize)
         m_config.m_totalEpochSizeInSweeps = 1;
@@ -99,7 +103,7 @@ void LocalTimelineRandomizerBase::MoveToNextSequence()
 }
 
 // Gets next sequences not exceeding local and global samples.
-void LocalTimelineRandomizerBase::GetNextSequenceDescriptions(size_t maxSampleCount, Sequences& result)
+void LocalTimelineRandomizerBase::GetNextSequenceDescriptions(size_t maxSampleCount, SequenceSelection& result)
 {
     assert(maxSampleCount != 0);
 
@@ -114,8 +118,6 @@ void LocalTimelineRandomizerBase::GetNextSequenceDescriptions(size_t maxSampleCo
     size_t samplesLoaded = 0;
     bool atLeastOneSequenceNeeded = true;
 
-    m_sequenceBuffer.clear();
-    m_chunkBuffer.clear();
     while (samplesLoaded < maxSampleCount && !IsEndReached())
     {
         const SequenceInfo& sequence = m_window.m_sequences[m_window.m_sequencePosition];
@@ -134,14 +136,10 @@ void LocalTimelineRandomizerBase::GetNextSequenceDescriptions(size_t maxSampleCo
             break;
 
         // Ok, the limit is not exceeded, add the sequence to the result.
-        m_sequenceBuffer.push_back(sequence);
-        if (m_chunkBuffer.find(sequence.m_chunkId) == m_chunkBuffer.end())
-        {
-            auto it = m_window.m_dataChunks.find(sequence.m_chunkId);
-            if (it == m_window.m_dataChunks.end())
-                RuntimeError("Cannot find the data for chunk");
-            m_chunkBuffer[sequence.m_chunkId] = it->second;
-        }
+        auto it = m_window.m_dataChunks.find(sequence.m_chunkId);
+        if (it == m_window.m_dataChunks.end())
+            RuntimeError("Cannot find the data for chunk");
+        result.m_sequences.push_back(std::make_pair(it->second, sequence.m_indexInChunk));
 
         samplesLoaded += sequenceLength;
         atLeastOneSequenceNeeded = false;
@@ -154,16 +152,33 @@ void LocalTimelineRandomizerBase::GetNextSequenceDescriptions(size_t maxSampleCo
     result.m_endOfEpoch = IsEndReached();
 }
 
-Sequences LocalTimelineRandomizerBase::GetNextSequences(size_t /*ignoring global sample count*/, size_t sampleCount)
+Sequences LocalTimelineRandomizerBase::GetNextSequences(size_t globalSampleCount, size_t localSampleCount)
+{
+    Sequences result;
+    if (m_decoder)
+    {
+        result = m_decoder->GetNextSequences(*this, globalSampleCount, localSampleCount);
+    }
+    else
+    {
+        SequenceSelection selection;
+        SelectNextSequences(globalSampleCount, localSampleCount, selection);
+        ReadSelectedSequences(selection, GetStreamDescriptions().size(), m_multithreadedGetNextSequences, result);
+    }
+
+    m_cleaner.Clean(result);
+    return result;
+}
+
+void LocalTimelineRandomizerBase::SelectNextSequences(size_t /*ignoring global sample count*/, size_t sampleCount, SequenceSelection& selection)
 {
     if (sampleCount == 0)
         LogicError("Sample count must not be zero.");
 
-    Sequences result;
     if (IsEndReached())
     {
-        result.m_endOfEpoch = true;
-        result.m_endOfSweep = false;
+        selection.m_endOfEpoch = true;
+        selection.m_endOfSweep = false;
 
         // Make sure we do not issue prefetch when the end is reached,
         // Let's wait for the prefetch to finish.
@@ -173,10 +188,10 @@ Sequences LocalTimelineRandomizerBase::GetNextSequences(size_t /*ignoring global
         if(m_prefetch.valid())
             m_prefetch.wait_for(std::chrono::seconds(60));
 
-        return result;
+        return;
     }
 
-    GetNextSequenceDescriptions(sampleCount, result);
+    GetNextSequenceDescriptions(sampleCount, selection);
 
     // Make sure we do not issue prefetch when the end is reached.
     if (IsEndReached() && m_prefetch.valid())
@@ -186,43 +201,6 @@ Sequences LocalTimelineRandomizerBase::GetNextSequences(size_t /*ignoring global
         // We do not want to call prefetch when the Python environment gets destroyed.
         m_prefetch.wait_for(std::chrono::seconds(60));
     }
-
-    if (m_sequenceBuffer.size() == 0) // No data
-        return result;
-
-    // Lets actually fetch data.
-    result.m_data.resize(GetStreamDescriptions().size(), std::vector<SequenceDataPtr>(m_sequenceBuffer.size()));
-    auto process = [&](int i) -> void {
-        std::vector<SequenceDataPtr> sequence;
-        const auto& sequenceDescription = m_sequenceBuffer[i];
-
-        auto it = m_chunkBuffer.find(sequenceDescription.m_chunkId);
-        if (it == m_chunkBuffer.end())
-            LogicError("Invalid chunk requested.");
-
-        it->second->GetSequence(sequenceDescription.m_indexInChunk, sequence);
-        for (int j = 0; j < GetStreamDescriptions().size(); ++j)
-        {
-            result.m_data[j][i] = sequence[j];
-        }
-    };
-
-    if (m_multithreadedGetNextSequences)
-    {
-        ExceptionCapture capture;
-#pragma omp parallel for schedule(dynamic)
-        for (int i = 0; i < m_sequenceBuffer.size(); ++i)
-            capture.SafeRun(process, i);
-        capture.RethrowIfHappened();
-    }
-    else
-    {
-        for (int i = 0; i < m_sequenceBuffer.size(); ++i)
-            process(i);
-    }
-
-    m_cleaner.Clean(result);
-    return result;
 }
 
 // Properties used in the checkpoint.
@@ -231,6 +209,15 @@ const static std::wstring s_numberOfSamplesSeenSoFarProperty = L"baseSampleCount
 const static std::wstring s_sequencePositionProperty = L"baseCurrentSequencePositionInWindow";
 
 std::map<std::wstring, size_t> LocalTimelineRandomizerBase::GetState()
+{
+    // With minibatches selected ahead, the position is that of the next minibatch to be returned.
+    std::map<std::wstring, size_t> state;
+    if (m_decoder && m_decoder->TryGetState(state))
+        return state;
+    return GetTimelineState();
+}
+
+std::map<std::wstring, size_t> LocalTimelineRandomizerBase::GetTimelineState()
 {
     std::map<std::wstring, size_t> state;
     state[s_sweepIndexProperty] = m_sweepCount;
@@ -245,6 +232,14 @@ std::map<std::wstring, size_t> LocalTimelineRandomizerBase::GetState()
 }
 
 void LocalTimelineRandomizerBase::SetState(const std::map<std::wstring, size_t>& state)
+{
+    if (m_decoder)
+        m_decoder->Reset(*this);
+
+    SetTimelineState(state);
+}
+
+void LocalTimelineRandomizerBase::SetTimelineState(const std::map<std::wstring, size_t>& state)
 {
     m_sweepCount = ValueFrom(state, s_sweepIndexProperty);
     m_sampleCount = ValueFrom(state, s_numberOfSamplesSeenSoFarProperty);
@@ -7,6 +7,7 @@
 
 #include <vector>
 #include "SequenceEnumerator.h"
+#include "SequenceDecoder.h"
 #include "DataDeserializer.h"
 #include "ReaderUtil.h"
 
@@ -21,18 +22,23 @@ namespace CNTK {
 // Given a prefetched windows of sequences, this class is responsible for picking 
 // a set of sequences for the next minibatch. It also keeps track whether the end 
 // of data (as specified in the confguration) is reached.
-class LocalTimelineRandomizerBase : public SequenceEnumerator
+// With a SequenceDecoder, the sequences are read on its pool of threads, and the following minibatches are selected ahead.
+class LocalTimelineRandomizerBase : public SequenceEnumerator, public SequenceSelector
 {
 public:
     LocalTimelineRandomizerBase(
         DataDeserializerPtr deserializer,
         bool multithreadedGetNextSequences = false,
-        size_t maxNumberOfInvalidSequences= 0); // per worker
+        size_t maxNumberOfInvalidSequences= 0, // per worker
+        SequenceDecoderPtr decoder = nullptr);
 
     virtual void StartEpoch(const EpochConfiguration& config) override;
 
     void SetConfiguration(const ReaderConfiguration& config) override
     {
+        if (m_decoder)
+            m_decoder->Reset(*this);
+
         *((ReaderConfiguration*)&m_config) = config;
     }
 
@@ -46,6 +52,12 @@ public:
     std::map<std::wstring, size_t> GetState() override;
     void SetState(const std::map<std::wstring, size_t>& state) override;
 
+    void WaitForChunkPrefetch() override
+    {
+        if (m_prefetch.valid())
+            m_prefetch.wait();
+    }
+
 protected:
     // Struct that describes a window of sequences
     // that are currently processed.
@@ -109,11 +121,16 @@ protected:
     }
 
 private:
+    // SequenceSelector, used by the decoder.
+    void SelectNextSequences(size_t globalSampleCount, size_t localSampleCount, SequenceSelection& selection) override;
+    std::map<std::wstring, size_t> GetTimelineState() override;
+    void SetTimelineState(const std::map<std::wstring, size_t>& state) override;
+
     // Refills the current window of sequences.
     void Refill();
 
-    // Gets next sequences not exceeding localSampleCount for this worker and globalSampleCount across workers.
-    void GetNextSequenceDescriptions(size_t maxSampleCount, Sequences& result);
+    // Selects next sequences not exceeding maxSampleCount for this worker.
+    void GetNextSequenceDescriptions(size_t maxSampleCount, SequenceSelection& selection);
 
     // Moves the cursor to the sequence possibly updating the chunk.
     void MoveToNextSequence();
@@ -133,10 +150,6 @@ private:
     // Epoch configuration
     EpochConfiguration m_config;
 
-    // Minibatch sequences, and minibatch chunks.
-    std::vector<SequenceInfo> m_sequenceBuffer;
-    std::map<ChunkIdType, ChunkPtr> m_chunkBuffer;
-
     // Current window of sequence descriptions.
     SequenceWindow m_window;
 
@@ -152,6 +165,10 @@ private:
 
     // Number of samples seen from the beginning.
     size_t m_sampleCount;
+
+    // Reads the sequences ahead in streaming mode, null otherwise.
+    // Declared last, so that its threads are stopped before the chunks and the deserializer are released.
+    SequenceDecoderPtr m_decoder;
 };
 
 }
@@ -0,0 +1,122 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <algorithm>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "MappedFile.h"
+
+namespace CNTK {
+
+using namespace Microsoft::MSR::CNTK;
+
+MappedFile::MappedFile(const std::wstring& filePath) :
+    m_filePath(filePath), m_data(nullptr), m_size(0),
+#ifdef _WIN32
+    m_fileHandle(INVALID_HANDLE_VALUE), m_mappingHandle(NULL)
+#else
+    m_fileDescriptor(-1)
+#endif
+{
+    // The destructor does not run if the constructor throws, so release what has been acquired so far.
+    try
+    {
+        Open(filePath);
+    }
+    catch (...)
+    {
+        Close();
+        throw;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+void MappedFile::Open(const std::wstring& filePath)
+{
+#ifdef _WIN32
+    m_fileHandle = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_fileHandle == INVALID_HANDLE_VALUE)
+        RuntimeError("Unable to open file '%ls' (error %x).", filePath.c_str(), (unsigned int)GetLastError());
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_fileHandle, &size))
+        RuntimeError("Unable to get the size of file '%ls' (error %x).", filePath.c_str(), (unsigned int)GetLastError());
+    m_size = (size_t)size.QuadPart;
+
+    m_mappingHandle = CreateFileMapping(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_mappingHandle == NULL)
+        RuntimeError("Unable to map file '%ls' (error %x).", filePath.c_str(), (unsigned int)GetLastError());
+
+    m_data = (const char*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (m_data == nullptr)
+        RuntimeError("Unable to map a view of file '%ls' (error %x).", filePath.c_str(), (unsigned int)GetLastError());
+#else
+    std::string path = msra::strfun::utf8(filePath);
+    m_fileDescriptor = open(path.c_str(), O_RDONLY);
+    if (m_fileDescriptor < 0)
+        RuntimeError("Unable to open file '%ls' (error %d).", filePath.c_str(), errno);
+
+    struct stat fileStat;
+    if (fstat(m_fileDescriptor, &fileStat) != 0)
+        RuntimeError("Unable to get the size of file '%ls' (error %d).", filePath.c_str(), errno);
+    m_size = (size_t)fileStat.st_size;
+
+    if (m_size != 0)
+    {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fileDescriptor, 0);
+        if (data == MAP_FAILED)
+            RuntimeError("Unable to map file '%ls' (error %d).", filePath.c_str(), errno);
+        m_data = (const char*)data;
+    }
+#endif
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mappingHandle != NULL)
+        CloseHandle(m_mappingHandle);
+    if (m_fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(m_fileHandle);
+    m_mappingHandle = NULL;
+    m_fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (m_data)
+        munmap((void*)m_data, m_size);
+    if (m_fileDescriptor >= 0)
+        close(m_fileDescriptor);
+    m_fileDescriptor = -1;
+#endif
+    m_data = nullptr;
+}
+
+void MappedFile::WillNeed(size_t offset, size_t size) const
+{
+#ifdef _WIN32
+    UNUSED(offset); UNUSED(size);
+#else
+    if (size == 0 || offset >= m_size)
+        return;
+
+    // madvise requires a page aligned address.
+    static const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t alignedOffset = offset - offset % pageSize;
+    size = std::min(size + offset - alignedOffset, m_size - alignedOffset);
+    madvise((void*)(m_data + alignedOffset), size, MADV_WILLNEED);
+#endif
+}
+
+}
@@ -0,0 +1,43 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <string>
+#include "Basics.h"
+
+namespace CNTK {
+
+// Read-only memory mapping of a complete file.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::wstring& filePath);
+    ~MappedFile();
+
+    const char* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+    // Hints the OS that the given byte range will be accessed soon.
+    void WillNeed(size_t offset, size_t size) const;
+
+private:
+    void Open(const std::wstring& filePath);
+    void Close();
+
+    std::wstring m_filePath;
+    const char* m_data;
+    size_t m_size;
+#ifdef _WIN32
+    void* m_fileHandle;
+    void* m_mappingHandle;
+#else
+    int m_fileDescriptor;
+#endif
+
+    DISABLE_COPY_AND_MOVE(MappedFile);
+};
+
+}
@@ -8,11 +8,11 @@
 
 #include "NoRandomizer.h"
 #include "DataReader.h"
-#include "ExceptionCapture.h"
 
 namespace CNTK {
 
-    NoRandomizer::NoRandomizer(DataDeserializerPtr deserializer, bool multithreadedGetNextSequences, size_t maxNumberOfInvalidSequences)
+    NoRandomizer::NoRandomizer(DataDeserializerPtr deserializer, bool multithreadedGetNextSequences, size_t maxNumberOfInvalidSequences,
+                               SequenceDecoderPtr decoder)
     : m_deserializer(deserializer),
       m_currentChunkPosition(ChunkIdMax),
       m_globalSamplePosition(0),
@@ -20,7 +20,8 @@ namespace CNTK {
       m_sweepSizeInSamples(0),
       m_currentSequencePositionInChunk(0),
       m_multithreadedGetNextSequences(multithreadedGetNextSequences),
-      m_cleaner(maxNumberOfInvalidSequences)
+      m_cleaner(maxNumberOfInvalidSequences),
+      m_decoder(decoder)
 {
     assert(deserializer != nullptr);
     m_streams = m_deserializer->StreamInfos();
@@ -52,6 +53,9 @@ ChunkIdType NoRandomizer::GetChunkIndexOf(size_t samplePosition)
 
 void NoRandomizer::StartEpoch(const EpochConfiguration& config)
 {
+    if (m_decoder)
+        m_decoder->Reset(*this);
+
     m_config = config;
 
     if (config.m_totalEpochSizeInSweeps != g_infinity)
@@ -84,7 +88,7 @@ void NoRandomizer::MoveToNextSequence()
 }
 
 // Gets next sequences not exceeding local and global samples.
-void NoRandomizer::GetNextSequenceDescriptions(size_t numGlobalSamplesToLoad, size_t numLocalSamplesToLoad, Sequences& result)
+void NoRandomizer::GetNextSequenceDescriptions(size_t numGlobalSamplesToLoad, size_t numLocalSamplesToLoad, SequenceSelection& result)
 {
     assert(numGlobalSamplesToLoad != 0);
     assert(numLocalSamplesToLoad != 0);
@@ -149,11 +153,40 @@ void NoRandomizer::GetNextSequenceDescriptions(size_t numGlobalSamplesToLoad, si
 }
 
 std::map<std::wstring, size_t> NoRandomizer::GetState()
+{
+    // With minibatches selected ahead, the position is that of the next minibatch to be returned.
+    std::map<std::wstring, size_t> state;
+    if (m_decoder && m_decoder->TryGetState(state))
+        return state;
+    return GetTimelineState();
+}
+
+std::map<std::wstring, size_t> NoRandomizer::GetTimelineState()
 {
     return std::map<std::wstring, size_t>({ { g_minibatchSourcePosition , m_globalSamplePosition } });
 }
 
 Sequences NoRandomizer::GetNextSequences(size_t globalSampleCount, size_t localSampleCount)
+{
+    Sequences result;
+    if (m_decoder)
+    {
+        result = m_decoder->GetNextSequences(*this, globalSampleCount, localSampleCount);
+    }
+    else
+    {
+        SequenceSelection selection;
+        SelectNextSequences(globalSampleCount, localSampleCount, selection);
+
+        // TODO: This will be changed, when we move transformers under the (no-) randomizer, should not deal with multithreading here.
+        ReadSelectedSequences(selection, m_streams.size(), m_multithreadedGetNextSequences, result);
+    }
+
+    m_cleaner.Clean(result);
+    return result;
+}
+
+void NoRandomizer::SelectNextSequences(size_t globalSampleCount, size_t localSampleCount, SequenceSelection& selection)
 {
     if (globalSampleCount == 0)
         LogicError("Global sample count must not be zero.");
@@ -161,14 +194,13 @@ Sequences NoRandomizer::GetNextSequences(size_t globalSampleCount, size_t localS
     if (localSampleCount == 0)
         LogicError("Local sample count must not be zero.");
 
-    Sequences result;
     size_t endOfEpochPosition = GetEndOfEpochPosition();
     if (m_globalSamplePosition >= endOfEpochPosition)
     {
-        result.m_endOfEpoch = true;
-        result.m_endOfSweep = (m_globalSamplePosition >= m_sweepSizeInSamples) &&
+        selection.m_endOfEpoch = true;
+        selection.m_endOfSweep = (m_globalSamplePosition >= m_sweepSizeInSamples) &&
             (m_globalSamplePosition % m_sweepSizeInSamples == 0);
-        return result;
+        return;
     }
 
     if (!m_config.m_allowMinibatchesToCrossSweepBoundaries)
@@ -182,15 +214,13 @@ Sequences NoRandomizer::GetNextSequences(size_t globalSampleCount, size_t localS
     if (globalSampleCount == 0)
         LogicError("Global sample count must not result in zero.");
 
-    GetNextSequenceDescriptions(globalSampleCount, localSampleCount, result);
+    GetNextSequenceDescriptions(globalSampleCount, localSampleCount, selection);
 
     if (m_sequenceBuffer.size() == 0)
     {
-        return result;
+        return;
     }
 
-    result.m_data.resize(m_streams.size(), std::vector<SequenceDataPtr>(m_sequenceBuffer.size()));
-
     // Collect all the chunks that we need
     std::map<ChunkIdType, ChunkPtr> chunks;
     for (const auto& s : m_sequenceBuffer)
@@ -213,43 +243,27 @@ Sequences NoRandomizer::GetNextSequences(size_t globalSampleCount, size_t localS
     // swap current chunks with new ones:
     m_chunks.swap(chunks);
 
-    auto process = [&](int i) -> void {
-        std::vector<SequenceDataPtr> sequence;
-        const auto& sequenceDescription = m_sequenceBuffer[i];
-
+    for (const auto& sequenceDescription : m_sequenceBuffer)
+    {
         auto it = m_chunks.find(sequenceDescription.m_chunkId);
         if (it == m_chunks.end())
         {
             LogicError("Invalid chunk requested.");
         }
 
-        it->second->GetSequence(sequenceDescription.m_indexInChunk, sequence);
-        for (int j = 0; j < m_streams.size(); ++j)
-        {
-            result.m_data[j][i] = sequence[j];
-        }
-    };
-
-    // TODO: This will be changed, when we move transformers under the (no-) randomizer, should not deal with multithreading here.
-    if (m_multithreadedGetNextSequences)
-    {
-        ExceptionCapture capture;
-#pragma omp parallel for schedule(dynamic)
-        for (int i = 0; i < m_sequenceBuffer.size(); ++i)
-            capture.SafeRun(process, i);
-        capture.RethrowIfHappened();
+        selection.m_sequences.push_back(std::make_pair(it->second, sequenceDescription.m_indexInChunk));
     }
-    else
-    {
-        for (int i = 0; i < m_sequenceBuffer.size(); ++i)
-            process(i);
-    }
-
-    m_cleaner.Clean(result);
-    return result;
 }
 
 void NoRandomizer::SetState(const std::map<std::wstring, size_t>& state)
+{
+    if (m_decoder)
+        m_decoder->Reset(*this);
+
+    SetTimelineState(state);
+}
+
+void NoRandomizer::SetTimelineState(const std::map<std::wstring, size_t>& state)
 {
     auto it = state.find(g_minibatchSourcePosition);
     if (it == state.end())
@@ -286,7 +300,14 @@ void NoRandomizer::SetState(const std::map<std::wstring, size_t>& state)
     m_globalSamplePosition = m_globalSamplePosition - sampleOffsetInsideChunk + numberOfSamples;
     assert(m_chunkDescriptions[m_currentChunkPosition].m_numberOfSequences > m_currentSequencePositionInChunk);
 
-    m_globalSequencePosition = 0;
+    // The sequences of earlier sweeps count as well, so that the decimation is the same as when reading from the start.
+    size_t numberOfSequencesInSweep = 0;
+    for (const auto& chunk : m_chunkDescriptions)
+    {
+        numberOfSequencesInSweep += chunk.m_numberOfSequences;
+    }
+
+    m_globalSequencePosition = (m_globalSamplePosition / m_sweepSizeInSamples) * numberOfSequencesInSweep;
     for (size_t i = 0; i < m_currentChunkPosition; ++i)
     {
         m_globalSequencePosition += m_chunkDescriptions[i].m_numberOfSequences;
@@ -296,6 +317,9 @@ void NoRandomizer::SetState(const std::map<std::wstring, size_t>& state)
 
 void NoRandomizer::SetConfiguration(const ReaderConfiguration& config)
 {
+    if (m_decoder)
+        m_decoder->Reset(*this);
+
     *((ReaderConfiguration*)&m_config) = config;
 }
 
@@ -7,6 +7,7 @@
 
 #include <vector>
 #include "SequenceEnumerator.h"
+#include "SequenceDecoder.h"
 #include "DataDeserializer.h"
 #include "ReaderUtil.h"
 
@@ -16,13 +17,15 @@ namespace CNTK {
 // Used training where the training data has already been pre - randomized.
 // TODO: currently this code moved from the old block randomizer.
 // TODO: The class will be further refactored and common based will be extracted with BlockRandomizer.
-class NoRandomizer : public SequenceEnumerator
+// With a SequenceDecoder, the sequences are read on its pool of threads, and the following minibatches are selected ahead.
+class NoRandomizer : public SequenceEnumerator, public SequenceSelector
 {
 public:
     NoRandomizer(
         DataDeserializerPtr deserializer, 
         bool multithreadedGetNextSequences = false,
-        size_t maxNumberOfInvalidSequences = 0); // per worker
+        size_t maxNumberOfInvalidSequences = 0, // per worker
+        SequenceDecoderPtr decoder = nullptr);
 
     virtual void StartEpoch(const EpochConfiguration& config) override;
     virtual Sequences GetNextSequences(size_t globalSampleCount, size_t localSampleCount) override;
@@ -37,8 +40,13 @@ public:
     void SetConfiguration(const ReaderConfiguration& config) override;
 
 private:
+    // SequenceSelector, used by the decoder.
+    void SelectNextSequences(size_t globalSampleCount, size_t localSampleCount, SequenceSelection& selection) override;
+    std::map<std::wstring, size_t> GetTimelineState() override;
+    void SetTimelineState(const std::map<std::wstring, size_t>& state) override;
+
     // Gets next sequences not exceeding localSampleCount for this worker and globalSampleCount across workers.
-    void GetNextSequenceDescriptions(size_t globalSampleCount, size_t localSampleCount, Sequences& result);
+    void GetNextSequenceDescriptions(size_t globalSampleCount, size_t localSampleCount, SequenceSelection& result);
 
     // Get chunk index for the sample offset from the beginning of the sweep.
     ChunkIdType GetChunkIndexOf(size_t samplePosition);
@@ -100,6 +108,10 @@ private:
 
     // Helper class for removing invalid sequences.
     SequenceCleaner m_cleaner;
+
+    // Reads the sequences ahead in streaming mode, null otherwise.
+    // Declared last, so that its threads are stopped before the chunks and the deserializer are released.
+    SequenceDecoderPtr m_decoder;
 };
 
 }
@@ -10,6 +10,10 @@
 
 namespace CNTK {
 
+// Number of pinned buffers a packer cycles through by default: the memory of a minibatch
+// returned by ReadMinibatch stays valid for that many calls.
+const size_t DefaultNumberOfPackerBuffers = 2;
+
 // A packer interface.
 class Packer
 {
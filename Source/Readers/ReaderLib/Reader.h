@@ -118,6 +118,16 @@ public:
     // Set current global position
     virtual void SetState(const std::map<std::wstring, size_t>& state) = 0;
 
+    // Returns the deserializer whose sequences of the given streams are exactly what ends up in the minibatches,
+    // or nullptr if they are transformed in between. Used to compute input statistics directly from the chunks.
+    virtual DataDeserializerPtr GetDeserializerFor(const std::vector<std::wstring>& /*streamNames*/)
+    {
+        return nullptr;
+    }
+
+    // Waits until the chunks that are being loaded in the background are loaded, so that the deserializer is not in use.
+    virtual void WaitForChunkPrefetch() {}
+
     virtual ~Reader() {};
 };
 
@@ -18,6 +18,11 @@ std::vector<StreamInformation> ReaderBase::GetStreamDescriptions()
 ReaderBase::~ReaderBase()
 {}
 
+DataDeserializerPtr ReaderBase::GetDeserializerFor(const std::vector<std::wstring>& /*streamNames*/)
+{
+    return m_deserializer;
+}
+
 void ReaderBase::StartEpoch(const EpochConfiguration& config, const std::map<std::wstring, int>& inputDescriptions)
 {
     if (config.m_totalEpochSizeInSamples == 0)
@@ -74,6 +79,11 @@ void ReaderBase::SetState(const std::map<std::wstring, size_t>& state)
     m_packer->Reset();
 }
 
+void ReaderBase::WaitForChunkPrefetch()
+{
+    m_sequenceEnumerator->WaitForChunkPrefetch();
+}
+
 void ReaderBase::SetConfiguration(const ReaderConfiguration& config, const std::map<std::wstring, int>&)
 {
     m_sequenceEnumerator->SetConfiguration(config);
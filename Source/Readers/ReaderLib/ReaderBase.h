@@ -34,6 +34,11 @@ namespace CNTK {
 
         void SetConfiguration(const ReaderConfiguration& config, const std::map<std::wstring, int>& inputDescriptions) override;
 
+        // Readers that apply transforms do not set m_deserializer, or override this.
+        DataDeserializerPtr GetDeserializerFor(const std::vector<std::wstring>& streamNames) override;
+
+        void WaitForChunkPrefetch() override;
+
         virtual ~ReaderBase() = 0;
 
     protected:
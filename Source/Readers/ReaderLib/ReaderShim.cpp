@@ -17,7 +17,9 @@
 #define DATAREADER_EXPORTS // creating the exports here
 #include "DataReader.h"
 #include "ReaderShim.h"
+#include "ChunkStatistics.h"
 #include "DataTransferer.h"
+#include "Packer.h"
 #include "PerformanceProfiler.h"
 
 namespace CNTK {
@@ -42,8 +44,14 @@ inline TensorShape AsTensorShape(const NDShape& viewShape)
 template <class ElemType>
 ReaderShim<ElemType>::ReaderShim() :
     m_deviceId(CPUDEVICE),
-    m_dataTransferers(2, DataTransfererPtr()),
-    m_currentDataTransferIndex(0),
+    m_prefetch(true),
+    m_prefetchDepth(1),
+    m_prefetchMaxBytes(0),
+    m_readSlotIndex(0),
+    m_writeSlotIndex(0),
+    m_numFilledSlots(0),
+    m_filledBytes(0),
+    m_stopPrefetch(false),
     m_endOfEpoch(false),
     m_endOfSweep(false),
     m_reader(nullptr),
@@ -71,10 +79,16 @@ void ReaderShim<ElemType>::Init(const ConfigParameters& config)
     intargvector numberOfuttsPerMinibatchForAllEpochs =
         config(L"nbruttsineachrecurrentiter", ConfigParameters::Array(intargvector(vector<int> { 1 })));
 
-    bool prefetch = config(L"prefetch", true);
-    // if prefetch - launching asynchronously,
-    // otherwise deferring - synchronous execution during .get() call
-    m_launchType = prefetch ? launch::async : launch::deferred;
+    // if prefetch - minibatches are read ahead on a separate pipeline thread,
+    // otherwise they are read synchronously inside GetMinibatch.
+    m_prefetch = config(L"prefetch", true);
+
+    // Number of minibatches the pipeline thread is allowed to read ahead of the network,
+    // and an optional bound on the memory these minibatches take.
+    m_prefetchDepth = config(L"prefetchDepth", (size_t)1);
+    if (m_prefetchDepth == 0)
+        InvalidArgument("'prefetchDepth' must be at least 1.");
+    m_prefetchMaxBytes = config(L"prefetchMaxBytes", (size_t)0);
 
     m_numParallelSequences = numberOfuttsPerMinibatchForAllEpochs[0];
 
@@ -113,7 +127,7 @@ void ReaderShim<ElemType>::StartDistributedMinibatchLoop(
     config.m_epochIndex = epoch;
 
     StartEpoch(config, inputs);
-    StartAsyncPrefetching();
+    StartPrefetchPipeline();
 }
 
 template <class ElemType>
@@ -122,14 +136,8 @@ void ReaderShim<ElemType>::SetCurrentSamplePosition(size_t currentSamplePosition
     if (GetCurrentSamplePosition() == currentSamplePosition)
         return;
 
-    // Make sure there are no outstanding reads.
-    if (m_prefetchTask.valid())
-        m_prefetchTask.wait();
-
-    // Let's check that there is no outstanding copies.
-    // Wait on all events if there are any pending copy operations in flight.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->WaitForCopyCPUToGPU();
+    // Make sure there are no outstanding reads and copies.
+    StopPrefetchPipeline();
 
     // Set current position.
     std::map<std::wstring, size_t> state;
@@ -143,14 +151,9 @@ void ReaderShim<ElemType>::SetCurrentSamplePosition(size_t currentSamplePosition
 template <class ElemType>
 void ReaderShim<ElemType>::SetConfiguration(const ReaderConfiguration& config, const std::map<std::wstring, int>& inputDescriptions)
 {
-    // Make sure there are no outstanding reads.
-    if (m_prefetchTask.valid())
-        m_prefetchTask.get();
-
-    // Let's check that there is no outstanding copies.
-    // Wait on all events if there are any pending copy operations in flight.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->WaitForCopyCPUToGPU();
+    // Make sure there are no outstanding reads and copies.
+    // The pipeline may have read ahead, so the reader is rewound to the consumed position below.
+    StopPrefetchPipeline();
 
     m_reader->SetConfiguration(config, inputDescriptions);
     m_reader->SetState(m_currentState);
@@ -159,14 +162,8 @@ void ReaderShim<ElemType>::SetConfiguration(const ReaderConfiguration& config, c
 template <class ElemType>
 void ReaderShim<ElemType>::StartEpoch(const EpochConfiguration& config, const std::unordered_set<InputStreamDescription>& inputs)
 {
-    // For adaptive minibatch, make sure there are no outstanding reads.
-    if (m_prefetchTask.valid())
-        m_prefetchTask.get();
-
-    // Let's check that there is no outstanding copies.
-    // Wait on all events if there are any pending copy operations in flight.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->WaitForCopyCPUToGPU();
+    // For adaptive minibatch, make sure there are no outstanding reads and copies.
+    StopPrefetchPipeline();
 
     // Now we can be sure, no prefetch thread is running and there are no outstanding memcopies.
     // Let's check that requested devices are ok and see whether we need to change our data transferers.
@@ -182,28 +179,33 @@ void ReaderShim<ElemType>::StartEpoch(const EpochConfiguration& config, const st
         LogicError("Readers do not support running on several GPUs in the same process, at least two devices found '%d', '%d'", deviceId, secondDevice->GetDeviceId());
     }
 
-    if (m_deviceId != deviceId)
-    {
-        // Device changed. Let's change the data transferers.
-        m_deviceId = deviceId;
-        m_dataTransferers.clear();
-        // We need two in order to support two operations in flight.
-        m_dataTransferers.push_back(m_deviceId == CPUDEVICE ? nullptr : CreatePrefetchDataTransferer(m_deviceId));
-        m_dataTransferers.push_back(m_deviceId == CPUDEVICE ? nullptr : CreatePrefetchDataTransferer(m_deviceId));
-    }
+    bool deviceChanged = m_deviceId != deviceId;
+    m_deviceId = deviceId;
+    m_prefetchSlots.resize(m_prefetchDepth);
 
-    // Let's create the buffers for the prefetch thread.
+    // Let's create the buffers for the pipeline thread, one set per slot of the ring.
     std::map<std::wstring, int> inputDescriptions;
     for (const auto& i : inputs)
-    {
         inputDescriptions[i.GetStreamName()] = i.GetDeviceId();
-        // Creating buffers with the same properties the network expects.
-        m_prefetchBuffers[i.GetStreamName()] = StreamPrefetchBuffer
+
+    for (auto& slot : m_prefetchSlots)
+    {
+        // Each slot has its own data transferer, so that copies of several
+        // minibatches can be in flight at the same time.
+        if (deviceChanged || (m_deviceId != CPUDEVICE && !slot.m_dataTransferer))
+            slot.m_dataTransferer = m_deviceId == CPUDEVICE ? nullptr : CreatePrefetchDataTransferer(m_deviceId);
+
+        slot.m_buffers.clear();
+        for (const auto& i : inputs)
         {
-            std::make_shared<Matrix<ElemType>>(0, 0, i.GetDeviceId(), i.GetMatrixType(), i.GetMatrixFormat()),
-            std::make_shared<MBLayout>(),
-            NDShape::Unknown()
-        };
+            // Creating buffers with the same properties the network expects.
+            slot.m_buffers[i.GetStreamName()] = StreamPrefetchBuffer
+            {
+                std::make_shared<Matrix<ElemType>>(0, 0, i.GetDeviceId(), i.GetMatrixType(), i.GetMatrixFormat()),
+                std::make_shared<MBLayout>(),
+                NDShape::Unknown()
+            };
+        }
     }
 
     m_endOfEpoch = false;
@@ -213,16 +215,101 @@ void ReaderShim<ElemType>::StartEpoch(const EpochConfiguration& config, const st
 }
 
 template <class ElemType>
-void ReaderShim<ElemType>::StartAsyncPrefetching()
+void ReaderShim<ElemType>::StartPrefetchPipeline()
+{
+    if (!m_prefetch || m_prefetchThread.joinable())
+        return;
+
+    // Starting the pipeline thread. It keeps up to m_prefetchDepth minibatches read ahead.
+    // When the network requests a new minibatch, we wait for the oldest slot to be filled, swap the buffers
+    // and release the slot so that the pipeline thread can refill it.
+    m_stopPrefetch = false;
+    m_prefetchThread = std::thread([this]() { PrefetchLoop(); });
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::StopPrefetchPipeline()
 {
-    auto localCurrentDataTransferIndex = m_currentDataTransferIndex;
-    // Starting the prefetch task. There is always a single async read in flight.
-    // When the network requests a new minibatch, we wait for the current async to finish, swap the buffers
-    // and kick off the new prefetch.
-    m_prefetchTask = std::async(m_launchType, [this, localCurrentDataTransferIndex]()
+    if (m_prefetchThread.joinable())
     {
-        return PrefetchMinibatch(localCurrentDataTransferIndex);
-    });
+        {
+            std::lock_guard<std::mutex> lock(m_prefetchMutex);
+            m_stopPrefetch = true;
+        }
+        m_slotReleased.notify_all();
+        m_prefetchThread.join();
+    }
+
+    // Let's check that there is no outstanding copies.
+    // Wait on all events if there are any pending copy operations in flight.
+    for (auto& slot : m_prefetchSlots)
+    {
+        if (slot.m_dataTransferer)
+            slot.m_dataTransferer->WaitForCopyCPUToGPU();
+    }
+
+    // Drop everything that has been read ahead.
+    m_readSlotIndex = m_writeSlotIndex = 0;
+    m_numFilledSlots = 0;
+    m_filledBytes = 0;
+    m_stopPrefetch = false;
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::PrefetchLoop()
+{
+    for (;;)
+    {
+        size_t slotIndex;
+        {
+            // Wait for a free slot, and for the memory bound to allow one more minibatch in flight.
+            std::unique_lock<std::mutex> lock(m_prefetchMutex);
+            m_slotReleased.wait(lock, [this]()
+            {
+                return m_stopPrefetch ||
+                    (m_numFilledSlots < m_prefetchSlots.size() &&
+                     (m_prefetchMaxBytes == 0 || m_numFilledSlots == 0 || m_filledBytes < m_prefetchMaxBytes));
+            });
+
+            if (m_stopPrefetch)
+                return;
+
+            slotIndex = m_writeSlotIndex;
+        }
+
+        auto& slot = m_prefetchSlots[slotIndex];
+        slot.m_exception = nullptr;
+        try
+        {
+            // The packer cycles through fewer buffers than the ring may have slots, so reading the next minibatch
+            // overwrites the buffer of the slot DefaultNumberOfPackerBuffers back. Its copy to the GPU can
+            // still be in flight, because the network waits for it only when it takes that slot.
+            if (m_prefetchSlots.size() > DefaultNumberOfPackerBuffers)
+            {
+                auto& reusedSlot = m_prefetchSlots[(slotIndex + m_prefetchSlots.size() - DefaultNumberOfPackerBuffers) % m_prefetchSlots.size()];
+                if (reusedSlot.m_dataTransferer)
+                    reusedSlot.m_dataTransferer->WaitForCopyCPUToGPU();
+            }
+
+            PrefetchMinibatch(slot);
+        }
+        catch (...)
+        {
+            slot.m_exception = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_prefetchMutex);
+            m_writeSlotIndex = (m_writeSlotIndex + 1) % m_prefetchSlots.size();
+            m_numFilledSlots++;
+            m_filledBytes += slot.m_sizeInBytes;
+        }
+        m_slotFilled.notify_one();
+
+        // Nothing can be read after the end of epoch or an error, the pipeline is restarted by the next epoch.
+        if (slot.m_exception || slot.m_result.m_isEndOfEpoch)
+            return;
+    }
 }
 
 string EnumerateInputs(const unordered_map<wstring, size_t>& nameToStreamId)
@@ -272,41 +359,52 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
         }
     }
 
-    if (!m_prefetchTask.valid())
-        StartAsyncPrefetching();
+    if (!m_prefetch)
+    {
+        // Synchronous mode, read the minibatch on the main thread.
+        PrefetchMinibatch(m_prefetchSlots[m_readSlotIndex]);
+    }
+    else
+    {
+        StartPrefetchPipeline();
 
-    auto result = m_prefetchTask.get();
+        PROFILE_SCOPE(profilerEvtMainWaitForPrefetch);
+        std::unique_lock<std::mutex> lock(m_prefetchMutex);
+        m_slotFilled.wait(lock, [this]() { return m_numFilledSlots > 0; });
+    }
 
     // Ok, prefetch is done.
+    auto& slot = m_prefetchSlots[m_readSlotIndex];
+    if (slot.m_exception)
+    {
+        auto exception = slot.m_exception;
+        StopPrefetchPipeline();
+        m_reader->SetState(m_currentState);
+        std::rethrow_exception(exception);
+    }
+
+    const auto& result = slot.m_result;
 
     // Let's update our sample position.
-    m_currentState = m_reader->GetState();
+    m_currentState = slot.m_state;
 
     m_endOfEpoch = result.m_isEndOfEpoch;
     m_endOfSweep = result.m_isEndOfSweep;
     if (m_endOfEpoch && !result.m_isDataAvailable)
     {
         // No data and end of epoch, simply return.
+        ReleasePrefetchSlot();
         return false;
     }
 
-    // Remember current data transfer, async memcpy for it already started on the prefetch thread.
-    auto currentDataTransferIndex = m_currentDataTransferIndex;
-
+    m_getKeyById = slot.m_getKeyById;
     matrices.m_getKeyById = m_getKeyById;
 
-    // Let's update the current data transferer.
-    m_currentDataTransferIndex = (m_currentDataTransferIndex + 1) % 2;
-
-    // Record an event that prefetch can wait on to ensure that prior compute has finished.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->RecordComputeStreamSyncPoint();
-
     // We have some data - let's swap the matrices.
     // We cannot simply change pointers because it seems they are remembered deeper in the network.
     for (auto i = matrices.begin(); i != matrices.end(); ++i)
     {
-        std::swap(i->second.GetMatrix<ElemType>(), *m_prefetchBuffers[i->first].m_matrix);
+        std::swap(i->second.GetMatrix<ElemType>(), *slot.m_buffers[i->first].m_matrix);
 
         // Resetting layouts.
         i->second.pMBLayout->Init(1, 0);
@@ -318,7 +416,7 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
     // Let's now check the layouts and throw if the same layout is being assigned twice.
     for (auto i = matrices.begin(); i != matrices.end(); ++i)
     {
-        auto streamLayout = m_prefetchBuffers[i->first].m_mbLayout;
+        auto streamLayout = slot.m_buffers[i->first].m_mbLayout;
         auto& layout = i->second.pMBLayout;
         if (layout->GetNumCols() == 0) // just initialized, let's take the layout of the reader.
         {
@@ -335,7 +433,7 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
         }
 
         // Check sample shape.
-        const auto& sampleShape = m_prefetchBuffers[i->first].m_sampleShape;
+        const auto& sampleShape = slot.m_buffers[i->first].m_sampleShape;
         if (i->second.sampleLayout.size() == 0 || AsNDShape(i->second.sampleLayout).IsUnknown()) // Not set.
         {
             i->second.sampleLayout = AsTensorShape(sampleShape);
@@ -351,21 +449,40 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
     // So pick up the first one.
     m_numParallelSequences = matrices.begin()->second.pMBLayout->GetNumParallelSequences();
 
-    // It is time to issue the next prefetch.
-    if (!m_endOfEpoch)
+    bool isDataAvailable = result.m_isDataAvailable;
+    if (slot.m_dataTransferer)
     {
-        StartAsyncPrefetching();
+        // Let's wait till the memcopy of this minibatch has finished.
+        slot.m_dataTransferer->WaitForCopyCPUToGPU();
+
+        // Record an event that the pipeline can wait on before it refills the slot,
+        // to ensure that compute on the matrices we have just swapped in has finished.
+        slot.m_dataTransferer->RecordComputeStreamSyncPoint();
     }
 
-    // Let's wait till the previous memcopy has finished.
-    if (m_dataTransferers[currentDataTransferIndex])
-        m_dataTransferers[currentDataTransferIndex]->WaitForCopyCPUToGPU();
+    // The slot can be refilled now.
+    ReleasePrefetchSlot();
+    return isDataAvailable;
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::ReleasePrefetchSlot()
+{
+    if (!m_prefetch)
+        return;
 
-    return result.m_isDataAvailable;
+    {
+        std::lock_guard<std::mutex> lock(m_prefetchMutex);
+        m_filledBytes -= m_prefetchSlots[m_readSlotIndex].m_sizeInBytes;
+        m_numFilledSlots--;
+        m_readSlotIndex = (m_readSlotIndex + 1) % m_prefetchSlots.size();
+    }
+    m_slotReleased.notify_one();
 }
 
+// Fills the matrix with the packed data of the stream, returns the size of the data in bytes.
 template <class ElemType>
-void FillMatrixFromStream(StorageFormat type, Matrix<ElemType>* matrix, size_t numRows, const StreamMinibatchPtr& stream, DataTransferer* transferer)
+size_t FillMatrixFromStream(StorageFormat type, Matrix<ElemType>* matrix, size_t numRows, const StreamMinibatchPtr& stream, DataTransferer* transferer)
 {
     size_t numCols = stream->m_layout->GetNumCols();
 
@@ -373,6 +490,7 @@ void FillMatrixFromStream(StorageFormat type, Matrix<ElemType>* matrix, size_t n
     {
         auto data = reinterpret_cast<const ElemType*>(stream->m_data);
         matrix->SetValue(numRows, numCols, matrix->GetDeviceId(), const_cast<ElemType*>(data), matrixFlagNormal, transferer);
+        return numRows * numCols * sizeof(ElemType);
     }
     else if (type == StorageFormat::SparseCSC)
     {
@@ -384,36 +502,44 @@ void FillMatrixFromStream(StorageFormat type, Matrix<ElemType>* matrix, size_t n
         IndexType* rows = reinterpret_cast<IndexType*>(values + nnzCount);
         IndexType* columns = reinterpret_cast<IndexType*>(rows + nnzCount);
         matrix->SetMatrixFromCSCFormat(columns, rows, values, nnzCount, numRows, numCols, transferer);
+        return nnzCount * (sizeof(ElemType) + sizeof(IndexType)) + (numCols + 1) * sizeof(IndexType);
     }
     else
         RuntimeError("Storage type %d is not supported.", (int)type);
 }
 
 template <class ElemType>
-typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMinibatch(size_t currentDataTransferIndex)
+void ReaderShim<ElemType>::PrefetchMinibatch(PrefetchSlot& slot)
 {
     PROFILE_SCOPE(profilerEvtPrefetchMinibatch);
 
     // Resetting layouts.
-    for (auto& mx : m_prefetchBuffers)
+    for (auto& mx : slot.m_buffers)
         mx.second.m_mbLayout = std::make_shared<MBLayout>();
 
+    slot.m_sizeInBytes = 0;
     Minibatch minibatch = m_reader->ReadMinibatch();
+    slot.m_state = m_reader->GetState();
 
     // If there is no data we can simply return.
     if (minibatch.m_data.empty())
-        return PrefetchResult{ minibatch.m_endOfSweep, minibatch.m_endOfEpoch, false };
+    {
+        slot.m_result = PrefetchResult{ minibatch.m_endOfSweep, minibatch.m_endOfEpoch, false };
+        return;
+    }
+
+    PROFILE_SCOPE(profilerEvtCopyMinibatch);
 
     // Ok we have some data. Let's load it to GPU.
     // But before we need to make sure that corresponding compute has already finished from the last iteration.
 
     // We need to make sure that the compute for the current transfer is finished before we start prefetch.
-    if (m_dataTransferers[currentDataTransferIndex])
-        m_dataTransferers[currentDataTransferIndex]->WaitForSyncPointOnAssignStreamAsync();
+    if (slot.m_dataTransferer)
+        slot.m_dataTransferer->WaitForSyncPointOnAssignStreamAsync();
 
-    m_getKeyById = minibatch.m_getKeyById;
+    slot.m_getKeyById = minibatch.m_getKeyById;
 
-    for (auto& mx : m_prefetchBuffers)
+    for (auto& mx : slot.m_buffers)
     {
         size_t streamId = m_nameToStreamId[mx.first];
         const auto& stream = minibatch.m_data[streamId];
@@ -428,14 +554,14 @@ typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMini
         }
 
         size_t sampleSize = m_streams[streamId].m_sampleLayout.TotalSize();
-        FillMatrixFromStream(m_streams[streamId].m_storageFormat, mx.second.m_matrix.get(), sampleSize, stream, m_dataTransferers[currentDataTransferIndex].get());
+        slot.m_sizeInBytes += FillMatrixFromStream(m_streams[streamId].m_storageFormat, mx.second.m_matrix.get(), sampleSize, stream, slot.m_dataTransferer.get());
     }
 
     // Let's record that we started the copy, so that the main thread can wait afterwards.
-    if (m_dataTransferers[currentDataTransferIndex])
-        m_dataTransferers[currentDataTransferIndex]->RecordCPUToGPUCopy();
+    if (slot.m_dataTransferer)
+        slot.m_dataTransferer->RecordCPUToGPUCopy();
 
-    return PrefetchResult{ minibatch.m_endOfSweep, minibatch.m_endOfEpoch, true };
+    slot.m_result = PrefetchResult{ minibatch.m_endOfSweep, minibatch.m_endOfEpoch, true };
 }
 
 template <class ElemType>
@@ -468,6 +594,38 @@ size_t ReaderShim<ElemType>::GetCurrentSamplePosition()
 {
     return m_currentState[g_minibatchSourcePosition];
 }
+
+template <class ElemType>
+bool ReaderShim<ElemType>::GetStreamStatisticsFingerprint(const std::vector<std::wstring>& streamNames, uint64_t& fingerprint)
+{
+    auto deserializer = m_reader->GetDeserializerFor(streamNames);
+    if (!deserializer || !CanComputeChunkStatistics(deserializer, streamNames))
+        return false;
+
+    fingerprint = ComputeChunkTableFingerprint(deserializer, streamNames);
+    return true;
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::ComputeStreamStatistics(const std::vector<std::wstring>& streamNames, size_t workerRank, size_t numWorkers,
+                                                   std::map<std::wstring, StreamStatistics>& statistics)
+{
+    auto deserializer = m_reader->GetDeserializerFor(streamNames);
+    if (!deserializer || !CanComputeChunkStatistics(deserializer, streamNames))
+        LogicError("ComputeStreamStatistics: the statistics of these streams cannot be computed from the chunks of the deserializer.");
+
+    // Loading chunks for the statistics must not overlap with reading minibatches, deserializers do not promise concurrent GetChunk().
+    // Once a minibatch loop has started, the pipeline may have read ahead, so it is stopped and the reader is rewound to the consumed
+    // position, as in SetConfiguration(). Then chunks that the randomizer still loads in the background are waited for.
+    if (!m_prefetchSlots.empty())
+    {
+        StopPrefetchPipeline();
+        m_reader->SetState(m_currentState);
+    }
+    m_reader->WaitForChunkPrefetch();
+
+    ComputeChunkStatistics(deserializer, streamNames, workerRank, numWorkers, statistics);
+}
 template <class ElemType>
 const std::map<std::wstring, size_t>& ReaderShim<ElemType>::GetState()
 {
@@ -480,14 +638,8 @@ void ReaderShim<ElemType>::SetState(const std::map<std::wstring, size_t>& state)
     if (m_currentState == state)
         return;
 
-    // Make sure there are no outstanding reads.
-    if (m_prefetchTask.valid())
-        m_prefetchTask.wait();
-
-    // Let's check that there is no outstanding copies.
-    // Wait on all events if there are any pending copy operations in flight.
-    if (m_dataTransferers[m_currentDataTransferIndex])
-        m_dataTransferers[m_currentDataTransferIndex]->WaitForCopyCPUToGPU();
+    // Make sure there are no outstanding reads and copies.
+    StopPrefetchPipeline();
 
     // Set current position.
     m_reader->SetState(state);
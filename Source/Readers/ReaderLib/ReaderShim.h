@@ -10,7 +10,9 @@
 
 #include <unordered_map>
 #include <string>
-#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "DataReader.h"
 #include "Reader.h"
 
@@ -47,16 +49,8 @@ public:
 
     virtual void Destroy() override
     {
-        // Make sure there are no outstanding reads.
-        // Future destructor does not wait as of 2013 so probably it is not in VS2013:
-        // More info can be found here http://www.open-std.org/jtc1/sc22/wg21/docs/papers/2013/n3679.html.
-        if (m_prefetchTask.valid())
-        {
-            // If there are some, give them time to finish.
-            m_prefetchTask.wait_for(std::chrono::seconds(60));
-            // TODO: if the prefetch is still valid, print a warning here!
-        }
-
+        // Make sure there are no outstanding reads and copies.
+        StopPrefetchPipeline();
         delete this;
     }
 
@@ -96,6 +90,12 @@ public:
 
     virtual size_t GetNumParallelSequencesForFixingBPTTMode() override;
 
+    // Statistics directly from the chunks of the deserializer, see ChunkStatistics.h.
+    // Stops the prefetch first; reading minibatches continues from the last consumed one afterwards.
+    virtual bool GetStreamStatisticsFingerprint(const std::vector<std::wstring>& streamNames, uint64_t& fingerprint) override;
+    virtual void ComputeStreamStatistics(const std::vector<std::wstring>& streamNames, size_t workerRank, size_t numWorkers,
+                                         std::map<std::wstring, MSR_CNTK::StreamStatistics>& statistics) override;
+
     // Legacy v1 API
     virtual size_t GetCurrentSamplePosition() override;
     void SetCurrentSamplePosition(size_t currentSamplePosition);
@@ -116,8 +116,6 @@ public:
 
 private:
 
-    void StartAsyncPrefetching();
-
     struct PrefetchResult
     {
         bool m_isEndOfSweep;
@@ -125,9 +123,57 @@ private:
         bool m_isDataAvailable;
     };
 
-    PrefetchResult PrefetchMinibatch(size_t currentDataTransferIndex);
+    // Data structure required for prefetch.
+    struct StreamPrefetchBuffer
+    {
+        std::shared_ptr<MSR_CNTK::Matrix<ElemType>> m_matrix;
+        MSR_CNTK::MBLayoutPtr m_mbLayout;
+        NDShape m_sampleShape;
+    };
+
+    // A single entry of the prefetch ring. The pipeline thread reads, packs and
+    // starts copying a minibatch into the matrices of a free slot; when the network
+    // enters GetMinibatch the main thread swaps the matrices out of the oldest filled slot.
+    struct PrefetchSlot
+    {
+        // Buffers where the pipeline thread puts its data to, per input stream.
+        std::unordered_map<std::wstring, StreamPrefetchBuffer> m_buffers;
+
+        // Data transferer used for the copies of this slot, null on CPU.
+        MSR_CNTK::DataTransfererPtr m_dataTransferer;
+
+        PrefetchResult m_result;
+
+        // Reader state after this minibatch has been read.
+        std::map<std::wstring, size_t> m_state;
+
+        // Id to key mapping of the minibatch.
+        std::function<std::string(size_t)> m_getKeyById;
+
+        // Size of the packed minibatch in bytes, used by the memory bound.
+        size_t m_sizeInBytes;
+
+        // Exception thrown while prefetching this slot, rethrown on the main thread.
+        std::exception_ptr m_exception;
+    };
+
+    // Starts the pipeline thread that keeps the prefetch ring filled.
+    void StartPrefetchPipeline();
+
+    // Stops the pipeline thread, waits for outstanding copies and drops all prefetched minibatches.
+    // Afterwards the reader position is the one after the last minibatch read by the pipeline,
+    // callers that need the consumed position have to reset the reader state.
+    void StopPrefetchPipeline();
+
+    // Body of the pipeline thread.
+    void PrefetchLoop();
+
+    // Hands the slot consumed by GetMinibatch back to the pipeline thread.
+    void ReleasePrefetchSlot();
+
+    // Reads the next minibatch and starts copying it into the slot.
+    void PrefetchMinibatch(PrefetchSlot& slot);
 
-    std::future<PrefetchResult> m_prefetchTask;
     ReaderPtr m_reader;
     ReaderFactory m_factory;
     bool m_endOfEpoch;
@@ -138,33 +184,39 @@ private:
     std::unordered_map<std::wstring, size_t> m_nameToStreamId;
 
     std::vector<StreamInformation> m_streams;
-    launch m_launchType;
 
-    // Data structure required for prefetch.
-    struct StreamPrefetchBuffer
-    {
-        std::shared_ptr<MSR_CNTK::Matrix<ElemType>> m_matrix;
-        MSR_CNTK::MBLayoutPtr m_mbLayout;
-        NDShape m_sampleShape;
-    };
+    // Whether the minibatches are read on the pipeline thread or synchronously inside GetMinibatch.
+    bool m_prefetch;
+
+    // Maximum number of minibatches read ahead of the network (size of the prefetch ring).
+    size_t m_prefetchDepth;
+
+    // Upper bound on the bytes of packed minibatches waiting in the ring, 0 means no bound.
+    // At least one minibatch is always read ahead, even if it alone exceeds the bound.
+    size_t m_prefetchMaxBytes;
 
-    // Intermediate buffer where the prefetch thread puts its data to.
-    // When the main thread enters GetMinibatch it swaps the matrices from this buffer,
-    // triggers the next prefetch and waits if memCpy is still in progress.
-    std::unordered_map<std::wstring, StreamPrefetchBuffer> m_prefetchBuffers;
+    // Ring of prefetched minibatches, m_prefetchDepth entries.
+    std::vector<PrefetchSlot> m_prefetchSlots;
 
-    // Alternating data transfer operations. In the current version these are only two - 
-    // currently waiting on the main thread and the one that can be started by the prefetch thread 
-    // in the meantime.
-    std::vector<MSR_CNTK::DataTransfererPtr> m_dataTransferers;
+    // Next slot to be consumed by the main thread and next slot to be filled by the pipeline thread.
+    size_t m_readSlotIndex;
+    size_t m_writeSlotIndex;
+
+    // Number of filled slots and their total size in bytes. Guarded by m_prefetchMutex.
+    size_t m_numFilledSlots;
+    size_t m_filledBytes;
+
+    // Signals the pipeline thread to stop. Guarded by m_prefetchMutex.
+    bool m_stopPrefetch;
+
+    std::thread m_prefetchThread;
+    std::mutex m_prefetchMutex;
+    std::condition_variable m_slotFilled;
+    std::condition_variable m_slotReleased;
 
     // Id to key mapping.
     std::function<std::string(size_t)> m_getKeyById;
 
-    // Current data transfer. Flips 0 and 1.
-    // Can be changed only from the main thread with no ongoing prefetch.
-    size_t m_currentDataTransferIndex; 
-
     // Device id.
     int m_deviceId;
 
@@ -0,0 +1,305 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <algorithm>
+#include "SequenceDecoder.h"
+
+namespace CNTK {
+
+void ReadSelectedSequences(const SequenceSelection& selection, size_t numberOfStreams, bool multithreaded, Sequences& result)
+{
+    result.m_endOfSweep |= selection.m_endOfSweep;
+    result.m_endOfEpoch |= selection.m_endOfEpoch;
+
+    const auto& sequences = selection.m_sequences;
+    if (sequences.empty())
+        return;
+
+    result.m_data.resize(numberOfStreams, std::vector<SequenceDataPtr>(sequences.size()));
+
+    auto process = [&](int i) -> void {
+        std::vector<SequenceDataPtr> sequence;
+        sequences[i].first->GetSequence(sequences[i].second, sequence);
+        for (size_t j = 0; j < numberOfStreams; ++j)
+            result.m_data[j][i] = sequence[j];
+    };
+
+    if (multithreaded)
+    {
+        ExceptionCapture capture;
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < sequences.size(); ++i)
+            capture.SafeRun(process, i);
+        capture.RethrowIfHappened();
+    }
+    else
+    {
+        for (int i = 0; i < sequences.size(); ++i)
+            process(i);
+    }
+}
+
+// Chunk of the wrapped deserializer, whose sequences are read under the shared lock of the guard.
+class ChunkLoadingGuard::GuardedChunk : public Chunk
+{
+public:
+    GuardedChunk(std::shared_ptr<ChunkLoadingGuard> guard, ChunkPtr chunk) : m_guard(guard), m_chunk(chunk)
+    {
+    }
+
+    void GetSequence(size_t sequenceIndex, std::vector<SequenceDataPtr>& result) override
+    {
+        m_guard->BeginRead();
+        try
+        {
+            m_chunk->GetSequence(sequenceIndex, result);
+        }
+        catch (...)
+        {
+            m_guard->EndRead();
+            throw;
+        }
+        m_guard->EndRead();
+    }
+
+    void SequenceInfos(std::vector<SequenceInfo>& result) override
+    {
+        m_chunk->SequenceInfos(result);
+    }
+
+private:
+    std::shared_ptr<ChunkLoadingGuard> m_guard;
+    ChunkPtr m_chunk;
+};
+
+ChunkLoadingGuard::ChunkLoadingGuard(DataDeserializerPtr deserializer)
+    : m_deserializer(deserializer),
+      m_numberOfReaders(0),
+      m_numberOfWaitingLoads(0),
+      m_loading(false)
+{
+}
+
+ChunkPtr ChunkLoadingGuard::GetChunk(ChunkIdType chunkId)
+{
+    ChunkPtr chunk;
+    BeginLoad();
+    try
+    {
+        chunk = m_deserializer->GetChunk(chunkId);
+    }
+    catch (...)
+    {
+        EndLoad();
+        throw;
+    }
+    EndLoad();
+    return std::make_shared<GuardedChunk>(shared_from_this(), chunk);
+}
+
+void ChunkLoadingGuard::BeginRead()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_released.wait(lock, [this]() { return !m_loading && m_numberOfWaitingLoads == 0; });
+    m_numberOfReaders++;
+}
+
+void ChunkLoadingGuard::EndRead()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_numberOfReaders--;
+    }
+    m_released.notify_all();
+}
+
+void ChunkLoadingGuard::BeginLoad()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_numberOfWaitingLoads++;
+    m_released.wait(lock, [this]() { return !m_loading && m_numberOfReaders == 0; });
+    m_numberOfWaitingLoads--;
+    m_loading = true;
+}
+
+void ChunkLoadingGuard::EndLoad()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_loading = false;
+    }
+    m_released.notify_all();
+}
+
+SequenceDecoder::SequenceDecoder(size_t numberOfStreams, size_t minibatchesAhead, size_t numberOfThreads, size_t queueCapacity)
+    : m_numberOfStreams(numberOfStreams),
+      m_minibatchesAhead(minibatchesAhead),
+      m_queue(queueCapacity),
+      m_numberOfIdleThreads(0),
+      m_stop(false)
+{
+    if (numberOfThreads == 0)
+        numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t i = 0; i < numberOfThreads; ++i)
+        m_threads.push_back(std::thread([this]() { ReadContinuously(); }));
+}
+
+SequenceDecoder::~SequenceDecoder()
+{
+    // Sequences still in the queue are not read any more.
+    {
+        std::lock_guard<std::mutex> lock(m_idleLock);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+Sequences SequenceDecoder::GetNextSequences(SequenceSelector& selector, size_t globalSampleCount, size_t localSampleCount)
+{
+    // Minibatches selected for other sample counts contain the wrong sequences.
+    if (!m_ahead.empty() &&
+        (m_ahead.front()->m_globalSampleCount != globalSampleCount || m_ahead.front()->m_localSampleCount != localSampleCount))
+        Reset(selector);
+
+    if (m_ahead.empty())
+        SelectAhead(selector, globalSampleCount, localSampleCount);
+
+    // Nothing is selected beyond the end of the epoch, the next epoch may be configured differently.
+    while (m_ahead.size() <= m_minibatchesAhead && !m_ahead.back()->m_selection.m_endOfEpoch)
+        SelectAhead(selector, globalSampleCount, localSampleCount);
+
+    auto batch = m_ahead.front();
+    m_ahead.pop_front();
+
+    Wait(*batch);
+    batch->m_exception.RethrowIfHappened();
+    return std::move(batch->m_result);
+}
+
+bool SequenceDecoder::TryGetState(std::map<std::wstring, size_t>& state) const
+{
+    if (m_ahead.empty())
+        return false;
+
+    state = m_ahead.front()->m_stateBefore;
+    return true;
+}
+
+void SequenceDecoder::Reset(SequenceSelector& selector)
+{
+    if (m_ahead.empty())
+        return;
+
+    // The sequences being read refer to chunks of the deserializer, make sure they are done
+    // before the randomizer changes its chunks.
+    for (const auto& batch : m_ahead)
+        Wait(*batch);
+
+    auto state = m_ahead.front()->m_stateBefore;
+    m_ahead.clear();
+    selector.SetTimelineState(state);
+}
+
+void SequenceDecoder::SelectAhead(SequenceSelector& selector, size_t globalSampleCount, size_t localSampleCount)
+{
+    auto batch = std::make_shared<Batch>();
+    batch->m_globalSampleCount = globalSampleCount;
+    batch->m_localSampleCount = localSampleCount;
+    batch->m_stateBefore = selector.GetTimelineState();
+    selector.SelectNextSequences(globalSampleCount, localSampleCount, batch->m_selection);
+
+    const auto& selection = batch->m_selection;
+    batch->m_result.m_endOfSweep = selection.m_endOfSweep;
+    batch->m_result.m_endOfEpoch = selection.m_endOfEpoch;
+    batch->m_remaining = selection.m_sequences.size();
+    if (!selection.m_sequences.empty())
+        batch->m_result.m_data.resize(m_numberOfStreams, std::vector<SequenceDataPtr>(selection.m_sequences.size()));
+
+    m_ahead.push_back(batch);
+
+    for (size_t i = 0; i < selection.m_sequences.size(); ++i)
+    {
+        Task task = { batch, i };
+        Submit(task);
+    }
+}
+
+void SequenceDecoder::Submit(Task& task)
+{
+    if (!m_queue.TryPush(task))
+    {
+        // The queue is full, the selecting thread reads the sequence itself, which also keeps it from running too far ahead.
+        Read(task);
+        return;
+    }
+
+    // Pairs with the fence in ReadContinuously(): either a thread going idle sees the new task, or it is seen as idle here.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_numberOfIdleThreads.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_idleLock);
+        m_wakeUp.notify_one();
+    }
+}
+
+void SequenceDecoder::Read(const Task& task)
+{
+    auto& batch = *task.m_batch;
+    batch.m_exception.SafeRun([&]()
+    {
+        const auto& s = batch.m_selection.m_sequences[task.m_index];
+        std::vector<SequenceDataPtr> sequence;
+        s.first->GetSequence(s.second, sequence);
+        for (size_t j = 0; j < m_numberOfStreams; ++j)
+            batch.m_result.m_data[j][task.m_index] = sequence[j];
+    });
+
+    if (--batch.m_remaining == 0)
+    {
+        std::lock_guard<std::mutex> lock(batch.m_lock);
+        batch.m_done.notify_all();
+    }
+}
+
+void SequenceDecoder::Wait(Batch& batch)
+{
+    std::unique_lock<std::mutex> lock(batch.m_lock);
+    batch.m_done.wait(lock, [&batch]() { return batch.m_remaining == 0; });
+}
+
+void SequenceDecoder::ReadContinuously()
+{
+    Task task;
+    for (;;)
+    {
+        if (m_queue.TryPop(task))
+        {
+            Read(task);
+            task.m_batch.reset();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_idleLock);
+        ++m_numberOfIdleThreads;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_wakeUp.wait(lock, [&]() { return m_stop || m_queue.TryPop(task); });
+        --m_numberOfIdleThreads;
+
+        if (m_stop)
+            return;
+
+        lock.unlock();
+        Read(task);
+        task.m_batch.reset();
+    }
+}
+
+}
@@ -0,0 +1,195 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "SequenceEnumerator.h"
+#include "DataDeserializer.h"
+#include "ExceptionCapture.h"
+#include "BoundedQueue.h"
+
+namespace CNTK {
+
+// Sequences chosen by a randomizer for the next minibatch, before they are read from their chunks.
+struct SequenceSelection
+{
+    SequenceSelection() : m_endOfSweep(false), m_endOfEpoch(false) {}
+
+    // Chunk of every sequence and the index of the sequence in it.
+    // Holding the chunk keeps its data alive after the randomizer has moved its window of chunks further.
+    std::vector<std::pair<ChunkPtr, size_t>> m_sequences;
+
+    bool m_endOfSweep;
+    bool m_endOfEpoch;
+};
+
+// Reads the selected sequences from their chunks into 'result', in parallel on OpenMP threads if 'multithreaded' is set.
+// 'result' gets no data if no sequences are selected.
+void ReadSelectedSequences(const SequenceSelection& selection, size_t numberOfStreams, bool multithreaded, Sequences& result);
+
+// Implemented by the randomizers that can select sequences ahead of the minibatch that is consumed.
+class SequenceSelector
+{
+public:
+    // Selects the sequences of the next minibatch and moves the position on the timeline past them.
+    virtual void SelectNextSequences(size_t globalSampleCount, size_t localSampleCount, SequenceSelection& selection) = 0;
+
+    // Position on the timeline, as stored in a checkpoint.
+    virtual std::map<std::wstring, size_t> GetTimelineState() = 0;
+    virtual void SetTimelineState(const std::map<std::wstring, size_t>& state) = 0;
+
+    virtual ~SequenceSelector()
+    {
+    }
+};
+
+// Wraps a deserializer so that a chunk is loaded only while no sequences are read from its chunks, and the other way round.
+// Sequences are still read concurrently with each other. Deserializers do not promise GetSequence() concurrently with GetChunk(),
+// which happens when the threads of a SequenceDecoder read sequences while the randomizer loads chunks.
+class ChunkLoadingGuard : public DataDeserializer, public std::enable_shared_from_this<ChunkLoadingGuard>
+{
+public:
+    explicit ChunkLoadingGuard(DataDeserializerPtr deserializer);
+
+    std::vector<StreamInformation> StreamInfos() override
+    {
+        return m_deserializer->StreamInfos();
+    }
+
+    std::vector<ChunkInfo> ChunkInfos() override
+    {
+        return m_deserializer->ChunkInfos();
+    }
+
+    void SequenceInfosForChunk(ChunkIdType chunkId, std::vector<SequenceInfo>& result) override
+    {
+        m_deserializer->SequenceInfosForChunk(chunkId, result);
+    }
+
+    bool GetSequenceInfo(const SequenceInfo& primary, SequenceInfo& result) override
+    {
+        return m_deserializer->GetSequenceInfo(primary, result);
+    }
+
+    ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+private:
+    class GuardedChunk;
+
+    // Readers-writer lock: sequences are read shared, chunks are loaded exclusively.
+    // A waiting load keeps new reads from starting, so that it is not delayed by a continuous stream of reads.
+    void BeginRead();
+    void EndRead();
+    void BeginLoad();
+    void EndLoad();
+
+    DataDeserializerPtr m_deserializer;
+
+    std::mutex m_lock;
+    std::condition_variable m_released;
+    size_t m_numberOfReaders;
+    size_t m_numberOfWaitingLoads;
+    bool m_loading;
+};
+
+class SequenceDecoder;
+typedef std::shared_ptr<SequenceDecoder> SequenceDecoderPtr;
+
+// Streaming alternative to reading the sequences of every minibatch with an OpenMP parallel for and waiting for the slowest of them.
+// A persistent pool of threads reads sequences continuously from a bounded lock-free queue. To keep the threads busy while the
+// sequences of one minibatch complete in any order, the sequences of the following minibatches are selected and queued ahead,
+// assuming they will be requested with the same sample counts. Minibatches are still returned in the order of the timeline, each
+// with exactly the sequences the randomizer selects without reading ahead, so results and checkpoints do not change.
+// If the sample counts change, or the position is set, the minibatches selected ahead are dropped and the randomizer
+// is moved back to the position of the first of them.
+// Sequences of different minibatches are read concurrently with the randomizer loading and prefetching chunks,
+// deserializers that do not support GetSequence() concurrently with GetChunk() are wrapped in a ChunkLoadingGuard.
+class SequenceDecoder
+{
+public:
+    // numberOfThreads - 0 means one per hardware thread.
+    SequenceDecoder(size_t numberOfStreams, size_t minibatchesAhead, size_t numberOfThreads = 0, size_t queueCapacity = 4096);
+
+    ~SequenceDecoder();
+
+    // Returns the sequences of the next minibatch of the selector, selecting further minibatches ahead.
+    Sequences GetNextSequences(SequenceSelector& selector, size_t globalSampleCount, size_t localSampleCount);
+
+    // Gets the position of the next minibatch to be returned, if there are minibatches selected ahead.
+    // Otherwise the position of the selector is current, and false is returned.
+    bool TryGetState(std::map<std::wstring, size_t>& state) const;
+
+    // Drops the minibatches selected ahead, and moves the selector back to the position of the first of them.
+    void Reset(SequenceSelector& selector);
+
+    size_t NumberOfThreads() const
+    {
+        return m_threads.size();
+    }
+
+private:
+    SequenceDecoder(const SequenceDecoder&) = delete;
+    SequenceDecoder& operator=(const SequenceDecoder&) = delete;
+
+    // A minibatch selected ahead.
+    struct Batch
+    {
+        size_t m_globalSampleCount;
+        size_t m_localSampleCount;
+        std::map<std::wstring, size_t> m_stateBefore;
+        SequenceSelection m_selection;
+        Sequences m_result;
+
+        // Number of sequences still to be read.
+        std::atomic<size_t> m_remaining;
+        std::mutex m_lock;
+        std::condition_variable m_done;
+        ExceptionCapture m_exception;
+    };
+    typedef std::shared_ptr<Batch> BatchPtr;
+
+    // Reading of a single sequence of a batch.
+    struct Task
+    {
+        BatchPtr m_batch;
+        size_t m_index;
+    };
+
+    // Selects the next minibatch and queues its sequences.
+    void SelectAhead(SequenceSelector& selector, size_t globalSampleCount, size_t localSampleCount);
+
+    void Submit(Task& task);
+    void Read(const Task& task);
+    void Wait(Batch& batch);
+
+    // Body of the threads of the pool.
+    void ReadContinuously();
+
+    const size_t m_numberOfStreams;
+    const size_t m_minibatchesAhead;
+
+    // Minibatches selected ahead, the next one to be returned first.
+    std::deque<BatchPtr> m_ahead;
+
+    BoundedQueue<Task> m_queue;
+
+    // Threads that found the queue empty sleep until new tasks are submitted.
+    std::mutex m_idleLock;
+    std::condition_variable m_wakeUp;
+    std::atomic<size_t> m_numberOfIdleThreads;
+    bool m_stop;
+
+    std::vector<std::thread> m_threads;
+};
+
+}
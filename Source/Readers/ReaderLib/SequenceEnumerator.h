@@ -58,6 +58,9 @@ public:
     // Gets next sequences up to a maximum count of local and global samples.
     virtual Sequences GetNextSequences(size_t globalSampleCount, size_t localSampleCount) = 0;
 
+    // Waits until the chunks that are being loaded in the background are loaded.
+    virtual void WaitForChunkPrefetch() {}
+
     virtual ~SequenceEnumerator()
     {
     }
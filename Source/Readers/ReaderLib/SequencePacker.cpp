@@ -11,6 +11,8 @@
 #include <inttypes.h>
 #include "SequencePacker.h"
 #include "ReaderUtil.h"
+#include "PerformanceProfiler.h"
+#include "ExceptionCapture.h"
 
 namespace CNTK {
 
@@ -40,45 +42,128 @@ MBLayoutPtr SequencePacker::CreateMBLayout(const StreamBatch& batch)
 
 Minibatch SequencePacker::ReadMinibatch()
 {
-    auto sequences = m_sequenceEnumerator->GetNextSequences(m_globalMinibatchSizeInSamples, m_localMinibatchSizeInSamples);
+    Sequences sequences;
+    {
+        PROFILE_SCOPE(profilerEvtReadSequences);
+        sequences = m_sequenceEnumerator->GetNextSequences(m_globalMinibatchSizeInSamples, m_localMinibatchSizeInSamples);
+    }
+
     const auto& batch = sequences.m_data;
 
     Minibatch minibatch(sequences.m_endOfSweep, sequences.m_endOfEpoch);
     if (batch.empty())
+    {
+        UpdatePaddingStatistics(sequences.m_endOfEpoch);
         return minibatch;
+    }
 
-    auto& currentBuffer = m_streamBuffers[m_currentBufferIndex];
+    PROFILE_SCOPE(profilerEvtPackMinibatch);
 
     assert(m_outputStreamDescriptions.size() == batch.size());
+    m_packingInfos.resize(batch.size());
+
+    // Compute layouts and destination offsets of all streams and allocate the buffers.
+    ExceptionCapture prepareCapture;
+#pragma omp parallel for schedule(dynamic) if (batch.size() > 1)
     for (int streamIndex = 0; streamIndex < batch.size(); ++streamIndex)
     {
-        const auto& streamBatch = batch[streamIndex];
-
-        if (m_checkSampleShape[streamIndex])
+        prepareCapture.SafeRun([this, &batch](int i)
         {
-            RefreshSampleShape(streamBatch, m_outputStreamDescriptions[streamIndex]);
-        }
+            if (m_checkSampleShape[i])
+            {
+                RefreshSampleShape(batch[i], m_outputStreamDescriptions[i]);
+            }
 
-        const auto& type = m_outputStreamDescriptions[streamIndex].m_storageFormat;
-        auto pMBLayout = (type == StorageFormat::Dense) ?
-            PackDenseStream(streamBatch, streamIndex) : PackSparseStream(streamBatch, streamIndex);
+            if (m_outputStreamDescriptions[i].m_storageFormat == StorageFormat::Dense)
+                PrepareDenseStream(batch[i], i);
+            else
+                PrepareSparseStream(batch[i], i);
+        }, streamIndex);
+    }
+    prepareCapture.RethrowIfHappened();
 
-        auto& buffer = currentBuffer[streamIndex];
+    // All destination offsets are known now, copy the sequences.
+    CreatePackingRanges();
+    ExceptionCapture packCapture;
+#pragma omp parallel for schedule(dynamic) if (m_packingRanges.size() > 1)
+    for (int rangeIndex = 0; rangeIndex < m_packingRanges.size(); ++rangeIndex)
+    {
+        packCapture.SafeRun([this, &batch](int i)
+        {
+            const auto& range = m_packingRanges[i];
+            if (m_outputStreamDescriptions[range.m_streamIndex].m_storageFormat == StorageFormat::Dense)
+                PackDenseSequences(batch[range.m_streamIndex], range.m_streamIndex, range.m_begin, range.m_end);
+            else
+                PackSparseSequences(batch[range.m_streamIndex], range.m_streamIndex, range.m_begin, range.m_end);
+        }, rangeIndex);
+    }
+    packCapture.RethrowIfHappened();
 
+    auto& currentBuffer = m_streamBuffers[m_currentBufferIndex];
+    for (size_t streamIndex = 0; streamIndex < batch.size(); ++streamIndex)
+    {
         auto streamMinibatch = std::make_shared<StreamMinibatch>();
-        streamMinibatch->m_data = buffer.m_data.get();
-        streamMinibatch->m_layout = pMBLayout;
+        streamMinibatch->m_data = currentBuffer[streamIndex].m_data.get();
+        streamMinibatch->m_layout = m_packingInfos[streamIndex].m_layout;
         streamMinibatch->m_sampleShape = m_outputStreamDescriptions[streamIndex].m_sampleLayout;
 
         minibatch.m_data.push_back(streamMinibatch);
     }
 
     EstablishIdToKey(minibatch, sequences);
+    UpdatePaddingStatistics(sequences.m_endOfEpoch);
 
     m_currentBufferIndex = (m_currentBufferIndex + 1) % m_numberOfBuffers;
     return minibatch;
 }
 
+void SequencePacker::UpdatePaddingStatistics(bool endOfEpoch)
+{
+    if (!m_reportPaddingEfficiency)
+        return;
+
+    if (m_packingInfos.size() == m_epochPadding.size())
+    {
+        for (size_t i = 0; i < m_packingInfos.size(); ++i)
+        {
+            const auto& layout = m_packingInfos[i].m_layout;
+            if (!layout)
+                continue;
+            m_epochPadding[i].m_numberOfSamples += layout->GetActualNumSamples();
+            m_epochPadding[i].m_numberOfColumns += layout->GetNumCols();
+        }
+
+        // Layouts have been accounted for.
+        for (auto& info : m_packingInfos)
+            info.m_layout = nullptr;
+    }
+
+    if (!endOfEpoch)
+        return;
+
+    std::string report;
+    for (size_t i = 0; i < m_epochPadding.size(); ++i)
+    {
+        const auto& padding = m_epochPadding[i];
+        if (padding.m_numberOfColumns == 0)
+            continue;
+
+        char buffer[256];
+        sprintf(buffer, "%s'%ls': %.2f%% (%" PRIu64 " samples in %" PRIu64 " columns)",
+            report.empty() ? "" : ", ",
+            m_outputStreamDescriptions[i].m_name.c_str(),
+            100.0 * padding.m_numberOfSamples / padding.m_numberOfColumns,
+            padding.m_numberOfSamples,
+            padding.m_numberOfColumns);
+        report += buffer;
+    }
+
+    if (!report.empty())
+        fprintf(stderr, "SequencePacker: padding efficiency of the epoch: %s\n", report.c_str());
+
+    m_epochPadding.assign(m_epochPadding.size(), PaddingStatistics());
+}
+
 void SequencePacker::SetConfiguration(const ReaderConfiguration& config, const std::vector<MemoryProviderPtr>& memoryProviders)
 {
     PackerBase::SetConfiguration(config, memoryProviders);
@@ -128,26 +213,55 @@ void SequencePacker::RefreshSampleShape(const std::vector<SequenceDataPtr>& mini
     }
 }
 
-MBLayoutPtr SequencePacker::PackDenseStream(const StreamBatch& batch, size_t streamIndex)
+// Approximate number of bytes copied by a single packing range. Minibatches smaller than that
+// are packed on the calling thread.
+static const size_t s_packingRangeSizeInBytes = 64 * 1024;
+
+void SequencePacker::CreatePackingRanges()
+{
+    m_packingRanges.clear();
+    for (size_t streamIndex = 0; streamIndex < m_packingInfos.size(); ++streamIndex)
+    {
+        const auto& info = m_packingInfos[streamIndex];
+        size_t numberOfSequences = info.m_layout->GetAllSequences().size();
+        size_t numberOfRanges = std::max<size_t>(1, std::min(numberOfSequences, info.m_requiredSize / s_packingRangeSizeInBytes));
+        for (size_t i = 0; i < numberOfRanges; ++i)
+        {
+            m_packingRanges.push_back(PackingRange{ streamIndex,
+                numberOfSequences * i / numberOfRanges,
+                numberOfSequences * (i + 1) / numberOfRanges });
+        }
+    }
+}
+
+void SequencePacker::PrepareDenseStream(const StreamBatch& batch, size_t streamIndex)
 {
     assert(m_outputStreamDescriptions[streamIndex].m_storageFormat == StorageFormat::Dense);
-    const auto& stream = m_inputStreamDescriptions[streamIndex];
+    auto& info = m_packingInfos[streamIndex];
+    info.m_layout = CreateMBLayout(batch);
+    info.m_requiredSize = info.m_layout->GetNumCols() * GetSampleSize(m_outputStreamDescriptions[streamIndex]);
+
     auto& buffer = m_streamBuffers[m_currentBufferIndex][streamIndex];
-    size_t sampleSize = GetSampleSize(m_outputStreamDescriptions[streamIndex]);
-    auto pMBLayout = CreateMBLayout(batch);
-    size_t requiredSize = pMBLayout->GetNumCols() * sampleSize;
-    if (buffer.m_size < requiredSize)
+    if (buffer.m_size < info.m_requiredSize)
     {
-        buffer.Resize(requiredSize);
+        buffer.Resize(info.m_requiredSize);
     }
+}
 
+void SequencePacker::PackDenseSequences(const StreamBatch& batch, size_t streamIndex, size_t begin, size_t end)
+{
+    const auto& stream = m_inputStreamDescriptions[streamIndex];
+    const auto& buffer = m_streamBuffers[m_currentBufferIndex][streamIndex];
+    const auto& pMBLayout = m_packingInfos[streamIndex].m_layout;
+    size_t sampleSize = GetSampleSize(m_outputStreamDescriptions[streamIndex]);
     auto elementSize = DataTypeSize(stream.m_elementType);
 
     const auto& sequenceInfos = pMBLayout->GetAllSequences();
+    assert(end <= sequenceInfos.size());
 
     // Iterate over sequences in the layout, copy samples from the
     // source sequences into the buffer (at appropriate offsets).
-    for (int i = 0; i < sequenceInfos.size(); ++i)
+    for (size_t i = begin; i < end; ++i)
     {
         const auto& sequenceInfo = sequenceInfos[i];
         // skip gaps
@@ -197,11 +311,9 @@ MBLayoutPtr SequencePacker::PackDenseStream(const StreamBatch& batch, size_t str
             }
         }
     }
-
-    return pMBLayout;
 }
 
-MBLayoutPtr SequencePacker::PackSparseStream(const StreamBatch& batch, size_t streamIndex)
+void SequencePacker::PrepareSparseStream(const StreamBatch& batch, size_t streamIndex)
 {
     assert(m_outputStreamDescriptions[streamIndex].m_storageFormat == StorageFormat::SparseCSC);
 
@@ -223,116 +335,109 @@ MBLayoutPtr SequencePacker::PackSparseStream(const StreamBatch& batch, size_t st
     assert(stream.m_storageFormat == StorageFormat::SparseCSC);
     auto elementSize = DataTypeSize(stream.m_elementType);
     auto indexSize = sizeof(IndexType);
-    auto pMBLayout = CreateMBLayout(batch);
+
+    auto& info = m_packingInfos[streamIndex];
+    info.m_layout = CreateMBLayout(batch);
+    info.m_nnzCount = nnzCount;
+    const auto& pMBLayout = info.m_layout;
+
+    // Compute the nnz count of each column (gaps stay empty) and turn it into the column index
+    // array of the packed matrix: column j occupies [columnOffsets[j], columnOffsets[j + 1]).
+    // This is also the position of each sample in the data and index arrays of the buffer.
+    auto& columnOffsets = info.m_columnOffsets;
+    columnOffsets.assign(pMBLayout->GetNumCols() + 1, 0);
+    for (const auto& sequenceInfo : pMBLayout->GetAllSequences())
+    {
+        if (sequenceInfo.seqId == GAP_SEQUENCE_ID)
+        {
+            continue;
+        }
+
+        SparseSequenceDataPtr sparseSequence = static_pointer_cast<SparseSequenceData>(batch[sequenceInfo.seqId]);
+        // make sure that the sequence meta-data is correct.
+        assert(sparseSequence->m_nnzCounts.size() == sparseSequence->m_numberOfSamples);
+        for (size_t sampleIndex = 0; sampleIndex < sparseSequence->m_numberOfSamples; ++sampleIndex)
+        {
+            columnOffsets[pMBLayout->GetColumnIndex(sequenceInfo, sampleIndex) + 1] = sparseSequence->m_nnzCounts[sampleIndex];
+        }
+    }
+    partial_sum(columnOffsets.begin(), columnOffsets.end(), columnOffsets.begin());
+
+    // after the prefix sum the last column offset must be equal to the total nnz count.
+    assert(columnOffsets.back() == nnzCount);
 
     // Compute the required buffer size:
     // size of nnz type + nnz * (size of the element type) + nnz * (size of the row index type) + 
     // (number of columns + 1) * (size of the column index type). 
-    size_t requiredSize =
+    info.m_requiredSize =
         sizeof(nnzCount) +
         nnzCount * (elementSize + indexSize) +
-        indexSize * (pMBLayout->GetNumCols() + 1);
+        indexSize * columnOffsets.size();
 
     auto& buffer = m_streamBuffers[m_currentBufferIndex][streamIndex];
-    if (buffer.m_size < requiredSize)
+    if (buffer.m_size < info.m_requiredSize)
     {
-        buffer.Resize(requiredSize);
+        buffer.Resize(info.m_requiredSize);
     }
 
     auto* destination = buffer.m_data.get();
     // insert the nnzCount as the first element in the buffer.
     memcpy(destination, &nnzCount, sizeof(nnzCount));
 
+    // copy column indices into the buffer, right after the data and index arrays.
+    auto* columnIndicesDst = destination + sizeof(nnzCount) + nnzCount * (elementSize + indexSize);
+    assert(columnIndicesDst + columnOffsets.size() * indexSize <= destination + info.m_requiredSize);
+    memcpy(columnIndicesDst, columnOffsets.data(), columnOffsets.size() * indexSize);
+}
+
+void SequencePacker::PackSparseSequences(const StreamBatch& batch, size_t streamIndex, size_t begin, size_t end)
+{
+    const auto& stream = m_inputStreamDescriptions[streamIndex];
+    const auto& info = m_packingInfos[streamIndex];
+    const auto& pMBLayout = info.m_layout;
+    auto elementSize = DataTypeSize(stream.m_elementType);
+    auto indexSize = sizeof(IndexType);
+
     // create two pointers to the memory blocks inside the buffer,
     // one for data portion and another -- for indices.
-    auto* dataDst = destination + sizeof(nnzCount);
-    auto* indicesDst = dataDst + elementSize* nnzCount;
-    // column index for the current sample (= number of nnz value packed so far).
-    IndexType columnOffset = 0;
-    // a vector to store column index for each sample in the resulting (packed) matrix.
-    vector<IndexType> sparseColumnIndices;
-    // a vector to keep track of the offsets into each input sequence,
-    // there an offset is the number of nnz values packed so far. Current sample
-    // values/indices start of the offset position in the sequence data/index array
-    vector<IndexType>  sequenceOffsets(batch.size(), 0); 
-
-    vector<MBLayout::SequenceInfo> sequenceInfos(pMBLayout->GetAllSequences());
-
-    // sort the vector in ascending order of the parallel sequence index.
-    sort(sequenceInfos.begin(), sequenceInfos.end(),
-        [](const MBLayout::SequenceInfo& a, const MBLayout::SequenceInfo& b){ return a.s < b.s; });
-
-    // Iterate over the all time steps in the layout (total number of samples/columns 
-    // in a parallel sequence), traversing the layout in horizontal direction.
-    for (auto timeStep = 0; timeStep < pMBLayout->GetNumTimeSteps(); ++timeStep)
-    {
-        // For each time step, iterate over all sequences in the minibatch,
-        // traversing the layout in vertical direction.
-        for (const auto& sequenceInfo : sequenceInfos)
-        {
-            // skip the sequence if it does not intersect with the time step
-            if (timeStep < sequenceInfo.tBegin || timeStep >= sequenceInfo.tEnd)
-            {
-                continue;
-            }
+    auto* dataDst = m_streamBuffers[m_currentBufferIndex][streamIndex].m_data.get() + sizeof(info.m_nnzCount);
+    auto* indicesDst = dataDst + elementSize * info.m_nnzCount;
 
-            // store the offset of the current column )...
-            sparseColumnIndices.push_back(columnOffset);
-
-            auto seqId = sequenceInfo.seqId;
-            if (seqId == GAP_SEQUENCE_ID)
-            {
-                continue;
-            }
+    const auto& sequenceInfos = pMBLayout->GetAllSequences();
+    assert(end <= sequenceInfos.size());
 
-            // compute the index of the sample inside the sequence.
-            size_t sampleIndex = timeStep - sequenceInfo.tBegin;
-            const auto& sequence = batch[seqId];
+    for (size_t i = begin; i < end; ++i)
+    {
+        const auto& sequenceInfo = sequenceInfos[i];
+        if (sequenceInfo.seqId == GAP_SEQUENCE_ID)
+        {
+            continue;
+        }
 
-            // make sure the index less than the sequence length in samples.
-            assert(sampleIndex < sequence->m_numberOfSamples);
+        SparseSequenceDataPtr sparseSequence = static_pointer_cast<SparseSequenceData>(batch[sequenceInfo.seqId]);
+        const auto* dataSrc = reinterpret_cast<const char*>(sparseSequence->GetDataBuffer());
+        const auto* indicesSrc = sparseSequence->m_indices;
 
-            auto& sequenceOffset = sequenceOffsets[seqId];
-            SparseSequenceDataPtr sparseSequence = static_pointer_cast<SparseSequenceData>(sequence);
+        // Samples of a sequence are consecutive in the source, but land in different columns of the
+        // packed matrix, whose positions are given by the column offsets.
+        for (size_t sampleIndex = 0; sampleIndex < sparseSequence->m_numberOfSamples; ++sampleIndex)
+        {
             IndexType nnz = sparseSequence->m_nnzCounts[sampleIndex];
+            size_t column = pMBLayout->GetColumnIndex(sequenceInfo, sampleIndex);
+            size_t columnOffset = info.m_columnOffsets[column];
+            assert(info.m_columnOffsets[column + 1] - columnOffset == nnz);
 
-            // compute the sample offset in bytes.
-            size_t sampleOffset = sequenceOffset * elementSize;
-            // copy all nzz values from source sequence into the buffer.
-            const auto* dataSrc = reinterpret_cast<const char*>(sequence->GetDataBuffer()) + sampleOffset;
-            memcpy(dataDst, dataSrc, nnz * elementSize);
-            dataDst += nnz * elementSize; // advance the destination pointer
+            // copy all nzz values and their indices from source sequence into the buffer.
+            memcpy(dataDst + columnOffset * elementSize, dataSrc, nnz * elementSize);
+            memcpy(indicesDst + columnOffset * indexSize, indicesSrc, nnz * indexSize);
 
-            // copy all nzz value indices from source sequence into the buffer.
-            const auto* indicesSrc = sparseSequence->m_indices + sequenceOffset;
-            memcpy(indicesDst, indicesSrc, nnz * indexSize);
-            indicesDst += nnz * indexSize; // advance the destination pointer
-
-            sequenceOffset += nnz;
-            columnOffset += nnz;
+            dataSrc += nnz * elementSize;
+            indicesSrc += nnz;
         }
-    }
-
-    // at this point each element in sequenceOffsets should be equal to the total
-    // nnz count of the respective sequence and the sum of all elements - to the 
-    // overall nnz count.
-    assert(accumulate(sequenceOffsets.begin(), sequenceOffsets.end(), 0) == nnzCount);
-
-    // check the distance between data and index destination pointers.
-    assert(indicesDst == dataDst + nnzCount * indexSize);
-    // after we packed all samples, the column offset must be equal to the total nnz count.
-    assert(columnOffset == nnzCount);
-    sparseColumnIndices.push_back(columnOffset);
-    // check that the number of column indices == N + 1 (where N is the number of
-    // column in the packed matrix)
-    assert((pMBLayout->GetNumCols() + 1) == sparseColumnIndices.size());
-
-    // verify that there's enough space in the buffer for the array of column indices.
-    assert(indicesDst + sparseColumnIndices.size()*indexSize <= destination + requiredSize);
-    // copy column indices into the buffer.
-    memcpy(indicesDst, sparseColumnIndices.data(), sparseColumnIndices.size() * indexSize);
 
-    return pMBLayout;
+        // verify that all values of the sequence have been consumed.
+        assert(indicesSrc == sparseSequence->m_indices + sparseSequence->m_totalNnzCount);
+    }
 }
 
 }
@@ -17,13 +17,16 @@ public:
     SequencePacker(
         SequenceEnumeratorPtr sequenceEnumerator,
         const std::vector<StreamInformation>& streams,
-        size_t numberOfBuffers = 2,
+        size_t numberOfBuffers = DefaultNumberOfPackerBuffers,
         bool useLocalTimeline = false,
-        CorpusDescriptorPtr corpus = nullptr) :
+        CorpusDescriptorPtr corpus = nullptr,
+        bool reportPaddingEfficiency = false) :
         PackerBase(corpus, sequenceEnumerator, streams, numberOfBuffers),
         m_useLocalTimeline(useLocalTimeline),
         m_globalMinibatchSizeInSamples(0),
-        m_localMinibatchSizeInSamples(0)
+        m_localMinibatchSizeInSamples(0),
+        m_reportPaddingEfficiency(reportPaddingEfficiency),
+        m_epochPadding(streams.size())
     {}
 
     virtual Minibatch ReadMinibatch() override;
@@ -31,14 +34,48 @@ public:
     void SetConfiguration(const ReaderConfiguration& config, const std::vector<MemoryProviderPtr>& memoryProviders) override;
 
 protected:
-    virtual MBLayoutPtr PackDenseStream(const StreamBatch& batch, size_t streamIndex);
+    // Packing of a stream is split into two phases: the preparation computes the layout, resizes the buffer
+    // and (for sparse streams) the column offsets; after that sequences can be copied into the buffer
+    // independently of each other, because all destination offsets are known upfront.
+    // Preparation runs in parallel across streams, copying runs in parallel across streams and sequence ranges.
+    struct StreamPackingInfo
+    {
+        MBLayoutPtr m_layout;
+        size_t m_requiredSize;                   // number of bytes used in the stream buffer.
+        size_t m_nnzCount;                       // sparse only: total number of non zero values in the minibatch.
+        std::vector<IndexType> m_columnOffsets;  // sparse only: nnz prefix sum for each column, size == number of columns + 1.
 
-    virtual MBLayoutPtr PackSparseStream(const StreamBatch& batch, size_t streamIndex);
+        StreamPackingInfo() : m_requiredSize(0), m_nnzCount(0)
+        {}
+    };
+
+    // A range of sequences [m_begin, m_end) in the layout of a single stream that is copied as a unit of work.
+    struct PackingRange
+    {
+        size_t m_streamIndex;
+        size_t m_begin;
+        size_t m_end;
+    };
+
+    virtual void PrepareDenseStream(const StreamBatch& batch, size_t streamIndex);
+
+    virtual void PrepareSparseStream(const StreamBatch& batch, size_t streamIndex);
+
+    // Copy the samples of the given layout sequences into the current buffer of the stream.
+    void PackDenseSequences(const StreamBatch& batch, size_t streamIndex, size_t begin, size_t end);
+
+    void PackSparseSequences(const StreamBatch& batch, size_t streamIndex, size_t begin, size_t end);
+
+    // Splits the sequences of all streams into ranges of roughly equal number of bytes to copy.
+    void CreatePackingRanges();
 
     // Given a number of sequences, creates an MB layout that is used to guide
     // the actual packing.
     virtual MBLayoutPtr CreateMBLayout(const StreamBatch& batch);
 
+    // Accumulates the padding statistics of the minibatch layouts and reports them at the end of the epoch.
+    void UpdatePaddingStatistics(bool endOfEpoch);
+
     // Helper function to check and refresh the sample shape of input samples.
     void RefreshSampleShape(const std::vector<SequenceDataPtr>& minibatch, StreamInformation& outputStream);
 
@@ -51,6 +88,26 @@ protected:
     // A minibatch size for this worker in global samples.
     size_t m_globalMinibatchSizeInSamples;
 
+    // Packing information for each stream of the current minibatch.
+    std::vector<StreamPackingInfo> m_packingInfos;
+
+    // Units of work for the current minibatch.
+    std::vector<PackingRange> m_packingRanges;
+
+    // Number of samples and number of columns (samples + gaps) in the layouts of each stream since the start of the epoch.
+    // Their ratio is the fraction of the minibatch computation spent on actual data.
+    struct PaddingStatistics
+    {
+        size_t m_numberOfSamples;
+        size_t m_numberOfColumns;
+
+        PaddingStatistics() : m_numberOfSamples(0), m_numberOfColumns(0)
+        {}
+    };
+
+    bool m_reportPaddingEfficiency;
+    std::vector<PaddingStatistics> m_epochPadding;
+
 };
 
 typedef std::shared_ptr<SequencePacker> SequencePackerPtr;
@@ -28,7 +28,9 @@ namespace CNTK {
         m_currentSequenceCursor(0),
         m_currentChunkCursor(0),
         m_currentSampleCursor(0),
-        m_deserializer(deserializer)
+        m_deserializer(deserializer),
+        m_bucketByLength(false),
+        m_lengthBucketSizeInSamples(0)
     {
         size_t max = 0;
         for (const auto& c : m_randomizedChunks)
@@ -46,6 +48,7 @@ namespace CNTK {
     void SequenceRandomizer::Reset(size_t randSeed)
     {
         m_rng.seed((unsigned long)randSeed);
+        m_bucketRng.seed((unsigned long)randSeed);
 
         m_sequenceWindow.clear();
         m_randomizedChunkInfo.clear();
@@ -63,6 +66,12 @@ namespace CNTK {
         RandomizeNextChunkIfNeeded();
     }
 
+    void SequenceRandomizer::EnableLengthBucketing(size_t bucketSizeInSamples)
+    {
+        m_bucketByLength = true;
+        m_lengthBucketSizeInSamples = bucketSizeInSamples;
+    }
+
     // Repeatedly invokes provided callback passing to it sequence descriptors from the randomized
     // timeline until the callback returns false. On each successful invocation, it advances the
     // current position (cursor) in the timeline.
@@ -229,9 +238,13 @@ namespace CNTK {
             }
         }
 
+        // Sequences of the chunk at m_randomizedWindowEnd have reached their final chunk.
+        size_t randomizedChunk = m_randomizedWindowEnd - m_chunkWindowBegin;
+        if (m_bucketByLength)
+            BucketByLength(m_sequenceWindow[randomizedChunk]);
+
         // Let's recalculate number of samples in the randomized chunks for efficient indexing in seek.
         size_t sampleCount = 0;
-        size_t randomizedChunk = m_randomizedWindowEnd - m_chunkWindowBegin;
         for (size_t index = 0; index < m_sequenceWindow[randomizedChunk].size(); index++)
         {
             sampleCount += m_sequenceWindow[randomizedChunk][index].m_numberOfSamples;
@@ -259,6 +272,48 @@ namespace CNTK {
                 m_randomizationCursor);
     }
 
+    // Reorders the fully randomized sequences of a chunk, so that the sequences that end up in the same minibatch have similar lengths.
+    // The sort is stable, so sequences of the same length stay in random order.
+    void SequenceRandomizer::BucketByLength(std::vector<RandomizedSequenceDescription>& sequences)
+    {
+        std::stable_sort(sequences.begin(), sequences.end(),
+            [](const RandomizedSequenceDescription& a, const RandomizedSequenceDescription& b) { return a.m_numberOfSamples < b.m_numberOfSamples; });
+
+        // Cut into buckets [begin, end) not exceeding the bucket size (a bucket has at least one sequence).
+        std::vector<std::pair<size_t, size_t>> buckets;
+        size_t bucketBegin = 0, bucketSamples = 0;
+        auto addBucket = [&](size_t bucketEnd)
+        {
+            sequences[bucketBegin].m_numberOfSamplesInLengthBucket = (uint32_t)std::min<size_t>(bucketSamples, UINT32_MAX);
+            buckets.push_back(std::make_pair(bucketBegin, bucketEnd));
+        };
+
+        for (size_t i = 0; i < sequences.size(); ++i)
+        {
+            if (m_lengthBucketSizeInSamples != 0 && i > bucketBegin &&
+                bucketSamples + sequences[i].m_numberOfSamples > m_lengthBucketSizeInSamples)
+            {
+                addBucket(i);
+                bucketBegin = i;
+                bucketSamples = 0;
+            }
+            bucketSamples += sequences[i].m_numberOfSamples;
+        }
+
+        if (bucketBegin < sequences.size())
+            addBucket(sequences.size());
+
+        Microsoft::MSR::CNTK::RandomShuffleMT(buckets, 0, buckets.size(), m_bucketRng);
+
+        m_bucketBuffer.clear();
+        m_bucketBuffer.reserve(sequences.size());
+        for (const auto& b : buckets)
+        {
+            m_bucketBuffer.insert(m_bucketBuffer.end(), sequences.begin() + b.first, sequences.begin() + b.second);
+        }
+        sequences.swap(m_bucketBuffer);
+    }
+
     // Sets current cursor to the given sample offset.
     // If offset is in the middle of the sequence, the next sequence is picked up.
     // If there is no sequence, an offset outside the sweep is returned.
@@ -359,6 +414,7 @@ namespace CNTK {
             s.m_indexInOriginalChunk = m_bufferOriginalSequences[k].m_indexInChunk;
             s.m_numberOfSamples = m_bufferOriginalSequences[k].m_numberOfSamples;
             s.m_chunk = &chunk;
+            s.m_numberOfSamplesInLengthBucket = 0;
             chunkSequences.push_back(s);
         }
 
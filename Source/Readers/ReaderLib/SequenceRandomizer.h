@@ -24,6 +24,9 @@ struct RandomizedSequenceDescription
     const RandomizedChunk* m_chunk;
     // Number of samples in sequence.
     uint32_t m_numberOfSamples;
+    // If the sequence starts a bucket of sequences of similar length (see EnableLengthBucketing),
+    // the number of samples in the bucket, 0 otherwise.
+    uint32_t m_numberOfSamplesInLengthBucket;
 };
 
 // Class that given randomized chunks, randomizes sequence descriptions in a window of chunks.
@@ -40,6 +43,13 @@ public:
     // Resets the current sweep according to the randomization seed provided.
     void Reset(size_t seed);
 
+    // Enables grouping of sequences of similar length: once the sequences of a chunk have reached
+    // their final position, they are sorted by length, cut into buckets of at most bucketSizeInSamples
+    // samples (0 - a single bucket), and the buckets are shuffled. The first sequence of each bucket carries
+    // the number of samples in the bucket, so that minibatches can be aligned on buckets. The set of sequences of each chunk does not change.
+    // Has to be set before the sweep is randomized.
+    void EnableLengthBucketing(size_t bucketSizeInSamples);
+
     // Sets the current cursor to the given sample offset.
     // If the offset is in the middle of a sequence, the next sequence is picked up.
     // If the offset points in the middle of last sequence, the end of the sweep is returned.
@@ -76,6 +86,9 @@ private:
     // Release chunks from the chunk window that are not needed anymore.
     void ReleaseChunks();
 
+    // Reorders the fully randomized sequences of a chunk into shuffled buckets of similar length.
+    void BucketByLength(std::vector<RandomizedSequenceDescription>& sequences);
+
     DataDeserializerPtr m_deserializer;
 
     // Used only as a buffer to get sequence descriptions without memory reallocation.
@@ -157,6 +170,13 @@ private:
     int m_verbosity;
 
     std::mt19937_64 m_rng;
+
+    // Length bucketing, uses its own random generator, so that the assignment of sequences to chunks
+    // is the same with and without bucketing.
+    bool m_bucketByLength;
+    size_t m_lengthBucketSizeInSamples;
+    std::mt19937_64 m_bucketRng;
+    std::vector<RandomizedSequenceDescription> m_bucketBuffer;
 };
 
 typedef std::shared_ptr<SequenceRandomizer> SequenceRandomizerPtr;
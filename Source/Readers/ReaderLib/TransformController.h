@@ -10,6 +10,7 @@
 #include "Transformer.h"
 #include "SequenceEnumerator.h"
 #include "ExceptionCapture.h"
+#include "PerformanceProfiler.h"
 
 namespace CNTK {
 
@@ -65,6 +66,11 @@ public:
         m_sequenceProvider->SetState(state);
     }
 
+    void WaitForChunkPrefetch() override
+    {
+        m_sequenceProvider->WaitForChunkPrefetch();
+    }
+
     // Description of streams that the transformer provides.
     virtual std::vector<StreamInformation> GetStreamDescriptions() const override
     {
@@ -82,6 +88,8 @@ public:
             return sequences;
         }
 
+        using namespace Microsoft::MSR::CNTK;
+        PROFILE_SCOPE(profilerEvtTransformSequences);
         ExceptionCapture capture;
 #pragma omp parallel for schedule(dynamic)
         for (int j = 0; j < sequences.m_data.front().size(); ++j)
@@ -9,11 +9,13 @@
 #include <cmath>
 #include "TruncatedBpttPacker.h"
 #include "ReaderUtil.h"
+#include "PerformanceProfiler.h"
 #include <algorithm>
 
 namespace CNTK {
 
 using namespace std;
+using namespace Microsoft::MSR::CNTK;
 
 // Represents a slot where we accumulate sequences from which the minibatch is created.
 // The number of slots equals number of parallel sequences we want to pack.
@@ -208,7 +210,10 @@ void TruncatedBPTTPacker::SetConfiguration(const ReaderConfiguration& config, co
 
 Minibatch TruncatedBPTTPacker::ReadMinibatch()
 {
-    FillOutAvailableSlots();
+    {
+        PROFILE_SCOPE(profilerEvtReadSequences);
+        FillOutAvailableSlots();
+    }
 
     // Currently all we expect sequences of identical length between different streams,
     // so it is sufficient to check a single stream only.
@@ -217,6 +222,7 @@ Minibatch TruncatedBPTTPacker::ReadMinibatch()
         return Minibatch(/*endOfSweep = */false,/*endOfEpoch = */ true);
     }
 
+    PROFILE_SCOPE(profilerEvtPackMinibatch);
     Minibatch result;
 
     // Iterating over the streams/slots and packing them into the minibatch.
@@ -23,7 +23,7 @@ public:
     TruncatedBPTTPacker(
         SequenceEnumeratorPtr sequenceEnumerator,
         const std::vector<StreamInformation>& streams,
-        size_t numberOfBuffers = 2,
+        size_t numberOfBuffers = DefaultNumberOfPackerBuffers,
         CorpusDescriptorPtr corpus = nullptr);
 
     virtual Minibatch ReadMinibatch() override;
@@ -2,7 +2,8 @@
 // Copyright (c) Microsoft. All rights reserved.
 // Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
 //
-// ASGDHelper.cpp : Implements ASGDHelper interface. The implementation is based on Multiverso.
+// ASGDHelper.cpp : Implements ASGDHelper interface. The implementation is based on Multiverso if available,
+//                  and otherwise on a parameter server built into CNTK that runs over MPI.
 //
 
 #define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
@@ -17,6 +18,9 @@
 #include <unordered_map>
 #include <numeric>
 #include <algorithm>
+#include <exception>
+#include <atomic>
+#include <climits>
 
 #ifdef ASGD_PARALLEL_SUPPORT
 
@@ -595,6 +599,380 @@ private:
 
 #endif 
 
+#if HAS_MPI
+
+// ParameterServerASGDHelper is the implementation of ASGDHelper interface with a parameter server over MPI.
+// The model, flattened into one array, is split into one contiguous shard per rank. Every rank runs a server thread
+// that owns its shard: it adds the deltas pushed by the workers, and sends the updated shard back.
+// The worker of a rank (the training thread) pushes at every sync point the change of its model since the previous
+// one, and continues training from the shards it pulls back. With the async buffer, a sync only waits for the
+// exchange of the previous sync, so that the communication overlaps with the training of the next period.
+// Staleness is bounded: a server holds back its answer to a worker that has pushed more than maxStaleness times
+// more than the slowest worker that is still training. All workers call WaitAll() together, and the pushes are
+// counted from the last one. Workers waiting in WaitAll() do not hold back the others, and a worker that has
+// passed it waits for those that have not told the servers yet.
+// With maxStaleness = 0 the workers run in lock step, and a server adds the deltas of a round in the order of the
+// workers once all of them have arrived, so that the model does not depend on the timing of the workers.
+template<class ElemType = float>
+class ParameterServerASGDHelper : public ASGDHelper<ElemType>
+{
+public:
+    typedef shared_ptr<ComputationNode<ElemType>> ComputationNodePtr;
+
+    ParameterServerASGDHelper(const std::list<ComputationNodeBasePtr> & learnableNodes,  // Parameters that needs to be train
+        size_t nodeNumRanks,                                                            // Number of working nodes
+        bool useAsyncBuffer,                                                            // Using asynchonous buffer to hide communication cost
+        bool isSimulatedModelAveragingSGD,                                              // Using parameter server-based MA rather than ASGD
+        AdjustLearningRateAtBeginning adjusttype,                                       // Adjust learning per minibatches at very beginning of training process
+        double adjustCoef,                                                              // see in DecayCoefficient()
+        size_t adjustPerMinibatches,                                                    //
+        int traceLevel,                                                                 // log level
+        size_t maxStaleness) :                                                          // see above
+        m_pMPI(MPIWrapper::GetInstance()), m_numWorkers(nodeNumRanks),
+        m_useAsyncBuffer(useAsyncBuffer), m_ModelAveragingSGDSimulating(isSimulatedModelAveragingSGD), m_maxStaleness(maxStaleness),
+        m_adjustLearningRateAtBeginningType(adjusttype), m_adjustCoefficient(adjustCoef), m_adjustMBNumber(adjustPerMinibatches),
+        m_traceLevel(traceLevel), m_parameterSyncCounter(0), m_serverFailed(false)
+    {
+        if (!m_pMPI)
+            LogicError("ParameterServerASGDHelper: MPI has not been initialized.");
+        if (!m_pMPI->SupportsConcurrentCalls())
+            RuntimeError("DataParallelASGD: The built-in parameter server needs an MPI library that supports MPI_THREAD_MULTIPLE. "
+                         "With BrainScript, set mpiThreadMultiple=true at the top level of the configuration.");
+        m_myRank = (int)m_pMPI->CurrentNodeRank();
+
+        // model averaging is simulated by all workers pushing 1/N of their change in lock step
+        if (m_ModelAveragingSGDSimulating)
+        {
+            m_useAsyncBuffer = false;
+            m_maxStaleness = 0;
+        }
+
+        size_t totalModelSize = 0;
+        for (const auto& node : learnableNodes)
+        {
+            size_t layerSize = dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value().GetNumElements();
+            m_tableOffsets.push_back(totalModelSize);
+            m_tableLength.push_back(layerSize);
+            totalModelSize += layerSize;
+        }
+
+        for (size_t r = 0; r <= m_numWorkers; r++)
+            m_shardOffsets.push_back(totalModelSize / m_numWorkers * r + std::min(r, totalModelSize % m_numWorkers));
+        if (ShardSize(0) > INT_MAX)
+            RuntimeError("DataParallelASGD: The model is too large for %d parameter server shards.", (int)m_numWorkers);
+
+        m_base.resize(totalModelSize);
+        m_pulled.resize(totalModelSize);
+        m_delta.resize(totalModelSize);
+    }
+
+    ~ParameterServerASGDHelper()
+    {
+        if (m_asyncBufferThread.joinable())
+            m_asyncBufferThread.join();
+        if (!m_serverThread.joinable())
+            return;
+
+        // wait until no worker will send requests anymore, unless we are leaving due to an error
+        if (!std::uncaught_exception() && !m_asyncBufferError && !m_serverFailed)
+            WaitAll();
+
+        int request = (int)Request::Stop;
+        MPI_Request mpiRequest;
+        m_pMPI->Isend(&request, 1, MPI_INT, m_myRank, c_requestTag, &mpiRequest);
+        m_pMPI->Wait(&mpiRequest, MPI_STATUS_IGNORE);
+        m_serverThread.join();
+    }
+
+    void InitModel(const std::list<ComputationNodeBasePtr> & learnableNodes) override
+    {
+        // every worker starts from the model of the main node
+        ReadModel(learnableNodes, m_base);
+        m_pMPI->Bcast(m_base.data(), m_base.size(), m_pMPI->MainNodeRank());
+        WriteModel(m_base, learnableNodes);
+        m_pulled = m_base;
+
+        m_shard.assign(m_base.begin() + m_shardOffsets[m_myRank], m_base.begin() + m_shardOffsets[m_myRank + 1]);
+        m_serverThread = std::thread([this]() { RunServer(); });
+
+        if (m_traceLevel > 0)
+            fprintf(stderr, "ParameterServerASGDHelper: %d parameters in %d shards, maxStaleness = %d%s\n",
+                    (int)m_base.size(), (int)m_numWorkers, (int)m_maxStaleness, m_useAsyncBuffer ? ", using async buffer" : "");
+    }
+
+    bool PushAndPullModel(const std::list<ComputationNodeBasePtr> & learnableNodes, size_t sampleSinceLastSynced) override
+    {
+        m_parameterSyncCounter++;
+        WaitAsyncBuffer();
+        if (m_serverFailed)
+            std::rethrow_exception(m_serverError);
+
+        // delta = the change of the model since the last sync, with the learning-rate adjustment applied
+        ReadModel(learnableNodes, m_delta);
+        ElemType factor = m_ModelAveragingSGDSimulating ? (ElemType)1 / m_numWorkers : (ElemType)DecayCoefficient();
+        for (size_t i = 0; i < m_delta.size(); i++)
+            m_delta[i] = factor * (m_delta[i] - m_base[i]);
+
+        if (m_useAsyncBuffer)
+        {
+            // continue from the model pulled at the previous sync, plus the own change, which it does not contain yet
+            for (size_t i = 0; i < m_base.size(); i++)
+                m_base[i] = m_pulled[i] + m_delta[i];
+            WriteModel(m_base, learnableNodes);
+
+            m_asyncBufferThread = std::thread([this]()
+            {
+                try
+                {
+                    Exchange(m_delta.data(), m_pulled.data());
+                }
+                catch (...)
+                {
+                    m_asyncBufferError = std::current_exception();
+                }
+            });
+        }
+        else
+        {
+            Exchange(m_delta.data(), m_pulled.data());
+            m_base = m_pulled;
+            WriteModel(m_base, learnableNodes);
+        }
+        return true;
+    }
+
+    void WaitAll() override
+    {
+        WaitAsyncBuffer();
+
+        // tell the servers not to wait for this worker, then wait for the others
+        int request = (int)Request::Idle;
+        std::vector<MPI_Request> requests(m_numWorkers);
+        for (size_t r = 0; r < m_numWorkers; r++)
+            m_pMPI->Isend(&request, 1, MPI_INT, (int)r, c_requestTag, &requests[r]) || MpiFail("ParameterServerASGDHelper: Isend");
+        m_pMPI->WaitAll(requests) || MpiFail("ParameterServerASGDHelper: Waitall");
+        m_pMPI->WaitAll();
+    }
+
+    void WaitAsyncBuffer() override
+    {
+        if (m_asyncBufferThread.joinable())
+            m_asyncBufferThread.join();
+        if (m_asyncBufferError)
+        {
+            auto error = m_asyncBufferError;
+            m_asyncBufferError = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    // A request to a server is one int, followed by the data of the request on their own tags.
+    // The tags are well above those of the other point-to-point messages of CNTK.
+    enum class Request : int
+    {
+        Push = 0, // a delta for the shard follows; the server answers with the updated shard
+        Idle = 1, // the worker has entered WaitAll(), so the others need not wait for it until they enter it as well
+        Stop = 2, // ends the server thread
+    };
+    static const int c_requestTag = 30001;
+    static const int c_deltaTag = 30002;
+    static const int c_shardTag = 30003;
+
+    size_t ShardSize(size_t rank) const
+    {
+        return m_shardOffsets[rank + 1] - m_shardOffsets[rank];
+    }
+
+    void ReadModel(const std::list<ComputationNodeBasePtr> & learnableNodes, std::vector<ElemType>& model)
+    {
+        int i = 0; // indicate the index of learnable nodes
+        for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++, i++)
+        {
+            ComputationNodePtr node = dynamic_pointer_cast<ComputationNode<ElemType>>(*nodeIter);
+            ElemType* px = model.data() + m_tableOffsets[i];
+            size_t size = m_tableLength[i];
+            node->Value().CopyToArray(px, size);
+        }
+    }
+
+    void WriteModel(std::vector<ElemType>& model, const std::list<ComputationNodeBasePtr> & learnableNodes)
+    {
+        int i = 0; // indicate the index of learnable nodes
+        for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++, i++)
+        {
+            ComputationNodePtr node = dynamic_pointer_cast<ComputationNode<ElemType>>(*nodeIter);
+            Matrix<ElemType> &mat = node->Value();
+            mat.SetValue(mat.GetNumRows(), mat.GetNumCols(), mat.GetDeviceId(), model.data() + m_tableOffsets[i]);
+        }
+    }
+
+    // Pushes the shards of 'delta' to their servers, and receives the updated shards into 'model'.
+    void Exchange(const ElemType* delta, ElemType* model)
+    {
+        int request = (int)Request::Push;
+        std::vector<MPI_Request> requests(3 * m_numWorkers);
+        for (size_t r = 0; r < m_numWorkers; r++)
+        {
+            m_pMPI->Irecv(model + m_shardOffsets[r], (int)ShardSize(r), MPIWrapper::GetDataType(model), (int)r, c_shardTag, &requests[3 * r]) || MpiFail("ParameterServerASGDHelper: Irecv");
+            m_pMPI->Isend(&request, 1, MPI_INT, (int)r, c_requestTag, &requests[3 * r + 1]) || MpiFail("ParameterServerASGDHelper: Isend");
+            m_pMPI->Isend(delta + m_shardOffsets[r], (int)ShardSize(r), MPIWrapper::GetDataType(model), (int)r, c_deltaTag, &requests[3 * r + 2]) || MpiFail("ParameterServerASGDHelper: Isend");
+        }
+        m_pMPI->WaitAll(requests) || MpiFail("ParameterServerASGDHelper: Waitall");
+    }
+
+    // the server thread: serves the requests of all workers for the shard of this rank, until it receives Stop
+    void RunServer()
+    {
+        size_t shardSize = m_shard.size();
+        std::vector<ElemType> delta(shardSize);
+        std::vector<std::vector<ElemType>> roundDeltas(m_maxStaleness == 0 ? m_numWorkers : 0, std::vector<ElemType>(shardSize));
+        std::vector<size_t> numWaits(m_numWorkers, 0);  // number of WaitAll() entered by each worker
+        std::vector<size_t> numPushes(m_numWorkers, 0); // pushes of each worker since it entered the last one
+        std::vector<bool> answerPending(m_numWorkers, false);
+        try
+        {
+            for (;;)
+            {
+                int request;
+                MPI_Status status;
+                m_pMPI->Recv(&request, 1, MPI_INT, MPI_ANY_SOURCE, c_requestTag, &status) || MpiFail("ParameterServerASGDHelper: Recv");
+                int worker = status.MPI_SOURCE;
+
+                if ((Request)request == Request::Stop)
+                    break;
+                else if ((Request)request == Request::Idle)
+                {
+                    numWaits[worker]++;
+                    numPushes[worker] = 0;
+                }
+                else
+                {
+                    ElemType* workerDelta = m_maxStaleness == 0 ? roundDeltas[worker].data() : delta.data();
+                    m_pMPI->Recv(workerDelta, (int)shardSize, MPIWrapper::GetDataType(workerDelta), worker, c_deltaTag, MPI_STATUS_IGNORE) || MpiFail("ParameterServerASGDHelper: Recv");
+                    if (m_maxStaleness != 0)
+                    {
+                        for (size_t i = 0; i < shardSize; i++)
+                            m_shard[i] += delta[i];
+                    }
+                    numPushes[worker]++;
+                    answerPending[worker] = true;
+                }
+
+                // answer the workers that are not too far ahead of the slowest one that is still training with them
+                auto canAnswer = [&](size_t w)
+                {
+                    if (!answerPending[w])
+                        return false;
+                    for (size_t v = 0; v < m_numWorkers; v++)
+                    {
+                        if (numWaits[v] > numWaits[w]) // v waits in a WaitAll() that w has not entered yet
+                            continue;
+                        if (numWaits[v] < numWaits[w]) // the Idle request of v for the last WaitAll() has not arrived yet
+                            return false;
+                        if (numPushes[v] + m_maxStaleness < numPushes[w])
+                            return false;
+                    }
+                    return true;
+                };
+
+                // in lock step, the workers that can be answered are those of the completed round
+                if (m_maxStaleness == 0)
+                {
+                    for (size_t w = 0; w < m_numWorkers; w++)
+                    {
+                        if (!canAnswer(w))
+                            continue;
+                        for (size_t i = 0; i < shardSize; i++)
+                            m_shard[i] += roundDeltas[w][i];
+                    }
+                }
+                for (size_t w = 0; w < m_numWorkers; w++)
+                {
+                    if (!canAnswer(w))
+                        continue;
+                    MPI_Request mpiRequest;
+                    m_pMPI->Isend(m_shard.data(), (int)shardSize, MPIWrapper::GetDataType(m_shard.data()), (int)w, c_shardTag, &mpiRequest) || MpiFail("ParameterServerASGDHelper: Isend");
+                    m_pMPI->Wait(&mpiRequest, MPI_STATUS_IGNORE) || MpiFail("ParameterServerASGDHelper: Wait");
+                    answerPending[w] = false;
+                }
+            }
+        }
+        catch (...)
+        {
+            // The workers waiting for this server cannot continue, and the other ranks may be blocked in MPI calls
+            // that never return. Let the training thread of this rank fail, and take down the whole job.
+            m_serverError = std::current_exception();
+            m_serverFailed = true;
+            try
+            {
+                std::rethrow_exception(m_serverError);
+            }
+            catch (const std::exception& e)
+            {
+                fprintf(stderr, "ParameterServerASGDHelper: The server thread of rank %d failed: %s\n", m_myRank, e.what());
+            }
+            catch (...)
+            {
+                fprintf(stderr, "ParameterServerASGDHelper: The server thread of rank %d failed.\n", m_myRank);
+            }
+            fflush(stderr);
+            m_pMPI->Abort(EXIT_FAILURE);
+        }
+    }
+
+    float DecayCoefficient()
+    {
+        float f = 1.f;
+        switch (m_adjustLearningRateAtBeginningType)
+        {
+        case AdjustLearningRateAtBeginning::None:
+            break;
+        case AdjustLearningRateAtBeginning::Linearly:
+            f = min(f, max(0.f, (float)(m_adjustCoefficient + (1 - m_adjustCoefficient) / m_adjustMBNumber * m_parameterSyncCounter)));
+            break;
+        case AdjustLearningRateAtBeginning::Staircase:
+            f = min(f, max(0.f, (float)(m_adjustCoefficient * (m_parameterSyncCounter / m_adjustMBNumber + 1))));
+            break;
+        default:
+            break;
+        }
+        return f;
+    }
+
+    MPIWrapperPtr m_pMPI;
+    int m_myRank;
+    size_t m_numWorkers;
+
+    bool m_useAsyncBuffer;
+    bool m_ModelAveragingSGDSimulating;
+    size_t m_maxStaleness;
+    AdjustLearningRateAtBeginning m_adjustLearningRateAtBeginningType;
+    double m_adjustCoefficient;
+    size_t m_adjustMBNumber;
+    int m_traceLevel;
+    size_t m_parameterSyncCounter;
+
+    vector<size_t> m_tableLength;
+    vector<size_t> m_tableOffsets;
+    vector<size_t> m_shardOffsets; // shard of rank r is [m_shardOffsets[r], m_shardOffsets[r + 1])
+
+    // worker state
+    std::vector<ElemType> m_base;   // the model as set at the last sync
+    std::vector<ElemType> m_pulled; // the model as received from the servers
+    std::vector<ElemType> m_delta;  // what is pushed to the servers
+    std::thread m_asyncBufferThread;
+    std::exception_ptr m_asyncBufferError;
+
+    // server state, owned by the server thread
+    std::vector<ElemType> m_shard;
+    std::thread m_serverThread;
+    std::exception_ptr m_serverError;
+    std::atomic<bool> m_serverFailed;
+};  // Class ParameterServerASGDHelper
+
+#endif
+
 // A None implementation of ASGDHelper interface which does nothing
 // This is used when CNTK_ENABLE_ASGD = false
 template<class ElemType = float>
@@ -635,11 +1013,15 @@ ASGDHelper<ElemType>* NewASGDHelper(
     double adjustCoef,
     size_t adjustPerMinibatches,
     int traceLevel,
-    int syncPerfStats) 
+    int syncPerfStats,
+    size_t maxStaleness) 
 {
 #ifdef ASGD_PARALLEL_SUPPORT
     return new MultiversoHelper<ElemType>(learnableNodes, nodeNumRanks, useAsyncBuffer, isSimulatedModelAveragingSGD, 
                                       adjusttype, adjustCoef, adjustPerMinibatches, traceLevel, syncPerfStats);
+#elif HAS_MPI
+    return new ParameterServerASGDHelper<ElemType>(learnableNodes, nodeNumRanks, useAsyncBuffer, isSimulatedModelAveragingSGD,
+                                                   adjusttype, adjustCoef, adjustPerMinibatches, traceLevel, maxStaleness);
 #else
     return new NoneASGDHelper<ElemType>(learnableNodes, nodeNumRanks, useAsyncBuffer, isSimulatedModelAveragingSGD, 
                                       adjusttype, adjustCoef, adjustPerMinibatches, traceLevel, syncPerfStats); 
@@ -655,7 +1037,8 @@ template ASGDHelper<float>* NewASGDHelper<float>(
     double adjustCoef,
     size_t adjustPerMinibatches,
     int traceLevel,
-    int syncPerfStats); 
+    int syncPerfStats,
+    size_t maxStaleness); 
 
 template ASGDHelper<double>* NewASGDHelper<double>(
     const std::list<ComputationNodeBasePtr> & learnableNodes,
@@ -666,6 +1049,7 @@ template ASGDHelper<double>* NewASGDHelper<double>(
     double adjustCoef,
     size_t adjustPerMinibatches,
     int traceLevel,
-    int syncPerfStats); 
+    int syncPerfStats,
+    size_t maxStaleness); 
 
 }}} 
@@ -0,0 +1,116 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// AsyncCrossValidator.h -- evaluates the cross-validation set on a snapshot of the model while training continues
+//
+
+#pragma once
+
+#include "SimpleEvaluator.h"
+#include "CPUMatrix.h"
+
+#include <exception>
+#include <thread>
+#include <vector>
+#include <string>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Runs SimpleEvaluator on a snapshot of the model on a background thread.
+// The snapshot is a separate network with the same structure. It is read once from a file that the model is saved
+// to at the first Start(); later Start()s only copy the values of the learnable parameters into it.
+// The evaluation runs its parallel loops and MKL calls with at most 'numThreads' threads, and leaves the other
+// cores to the training. Start() and Wait() must be called alternately, from the same thread.
+template <class ElemType>
+class AsyncCrossValidator
+{
+public:
+    AsyncCrossValidator(int numThreads, const std::wstring& snapshotPath)
+        : m_numThreads(numThreads), m_snapshotPath(snapshotPath), m_epoch(-1)
+    {
+    }
+
+    ~AsyncCrossValidator()
+    {
+        // SimpleEvaluator cannot be interrupted, so this waits for a running evaluation to finish
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    bool IsRunning() const
+    {
+        return m_thread.joinable();
+    }
+
+    // Takes a snapshot of 'net' and starts evaluating it on 'reader'. 'epoch' is handed back by Wait().
+    void Start(const ComputationNetworkPtr& net, IDataReader* reader, const std::vector<std::wstring>& evalNodeNames, size_t mbSize, int epoch)
+    {
+        if (IsRunning())
+            LogicError("AsyncCrossValidator: Start() called while the previous evaluation is still running.");
+
+        bool loadSnapshot = !m_snapshot;
+        if (loadSnapshot)
+            net->Save(m_snapshotPath);
+        else
+            CopyParameters(*net);
+
+        m_epoch = epoch;
+        m_error = nullptr;
+        DEVICEID_TYPE deviceId = net->GetDeviceId();
+        m_thread = std::thread([this, loadSnapshot, deviceId, reader, evalNodeNames, mbSize]()
+        {
+            try
+            {
+                CPUMatrix<ElemType>::SetNumThreadsForCurrentThread(m_numThreads);
+                if (loadSnapshot)
+                {
+                    m_snapshot = ComputationNetwork::CreateFromFile<ElemType>(deviceId, m_snapshotPath);
+                    _wunlink(m_snapshotPath.c_str());
+                }
+
+                SimpleEvaluator<ElemType> evaluator(m_snapshot, nullptr /*mpi*/);
+                m_results = evaluator.Evaluate(reader, evalNodeNames, mbSize);
+            }
+            catch (...)
+            {
+                m_error = std::current_exception();
+            }
+        });
+    }
+
+    // Waits for the evaluation started last and returns its results, or rethrows its error.
+    std::vector<EpochCriterion> Wait(int& epoch)
+    {
+        if (!IsRunning())
+            LogicError("AsyncCrossValidator: Wait() called without a running evaluation.");
+
+        m_thread.join();
+        if (m_error)
+            std::rethrow_exception(m_error);
+
+        epoch = m_epoch;
+        return std::move(m_results);
+    }
+
+private:
+    void CopyParameters(const ComputationNetwork& net)
+    {
+        for (const auto& node : m_snapshot->GetNodesWithType(OperationNameOf(LearnableParameter)))
+        {
+            auto from = dynamic_pointer_cast<ComputationNode<ElemType>>(net.GetNodeFromName(node->NodeName()));
+            dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value().SetValue(from->Value());
+        }
+    }
+
+    int m_numThreads;
+    std::wstring m_snapshotPath;
+
+    ComputationNetworkPtr m_snapshot;
+    std::thread m_thread;
+    int m_epoch;                             // the epoch of the snapshot being evaluated
+    std::vector<EpochCriterion> m_results;
+    std::exception_ptr m_error;
+};
+
+}}}
@@ -0,0 +1,218 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include "Basics.h"
+#include "fileutil.h"
+#include "Float16.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Writes sequences of dense samples into a file in CNTK binary format (CBF) with a single stream,
+// so that the file can be read back with CNTKBinaryReader. The layout is the one written by Scripts/ctf2bin.py:
+//  - magic number, version
+//  - chunks: the number of samples of every sequence of the chunk, then every sequence (number of samples, values)
+//  - header: magic number, number of chunks, number of streams, stream description, chunk table
+//  - offset of the header
+// The keys of the sequences are written in the same order into <path>.keys, one per line.
+class BinaryOutputFile
+{
+public:
+    // Element type codes of the stream description.
+    enum class ElementType : unsigned char
+    {
+        Float = 0,
+        Double = 1,
+        Float16 = 2,
+    };
+
+    static ElementType ParseElementType(const std::wstring& elementType)
+    {
+        if (elementType == L"float")
+            return ElementType::Float;
+        if (elementType == L"double")
+            return ElementType::Double;
+        if (elementType == L"float16")
+            return ElementType::Float16;
+        InvalidArgument("Invalid output precision '%ls', expected 'float', 'double' or 'float16'.", elementType.c_str());
+    }
+
+    BinaryOutputFile(const std::wstring& path, const std::wstring& streamName, size_t sampleDimension, ElementType elementType, size_t chunkSizeInBytes)
+        : m_path(path), m_streamName(msra::strfun::utf8(streamName)), m_sampleDimension(sampleDimension), m_elementType(elementType),
+          m_chunkSizeInBytes(chunkSizeInBytes), m_file(nullptr), m_keysFile(nullptr), m_offset(0), m_numSequences(0), m_numSamples(0)
+    {
+        if (sampleDimension > UINT32_MAX)
+            InvalidArgument("BinaryOutputFile: sample dimension %d of '%ls' is too large.", (int)sampleDimension, streamName.c_str());
+
+        m_file = fopenOrDie(path, L"wb");
+        m_keysFile = fopenOrDie(path + L".keys", L"wt");
+
+        WriteValue(s_magicNumber);
+        WriteValue(s_version);
+    }
+
+    ~BinaryOutputFile()
+    {
+        // Only if Close() was not reached, e.g. because of an exception. The file is incomplete then.
+        if (m_file)
+            fclose(m_file);
+        if (m_keysFile)
+            fclose(m_keysFile);
+    }
+
+    // Appends a sequence of numSamples samples. Sample i starts at data + i * sampleStride.
+    template <class ElemType>
+    void AddSequence(const std::string& key, const ElemType* data, size_t numSamples, size_t sampleStride)
+    {
+        if (numSamples > UINT32_MAX)
+            RuntimeError("BinaryOutputFile: sequence '%s' has too many samples.", key.c_str());
+
+        size_t valueSize = GetElementSize();
+        size_t sampleSize = m_sampleDimension * valueSize;
+        size_t begin = m_chunkData.size();
+        m_chunkData.resize(begin + sizeof(uint32_t) + numSamples * sampleSize);
+
+        uint32_t numSamplesInSequence = (uint32_t)numSamples;
+        memcpy(&m_chunkData[begin], &numSamplesInSequence, sizeof(numSamplesInSequence));
+        char* out = &m_chunkData[begin + sizeof(uint32_t)];
+        for (size_t t = 0; t < numSamples; t++, out += sampleSize)
+            ConvertSample(data + t * sampleStride, out);
+
+        m_sequenceLengths.push_back(numSamplesInSequence);
+        m_numSamples += numSamples;
+        m_numSequences++;
+        fprintfOrDie(m_keysFile, "%s\n", key.c_str());
+
+        if (m_chunkData.size() >= m_chunkSizeInBytes)
+            FlushChunk();
+    }
+
+    // Writes the last chunk and the header.
+    void Close()
+    {
+        FlushChunk();
+
+        int64_t headerOffset = m_offset;
+        WriteValue(s_magicNumber);
+        WriteValue((uint32_t)m_chunks.size());
+        WriteValue((uint32_t)1); // number of streams
+
+        WriteValue((unsigned char)0); // dense encoding
+        WriteValue((uint32_t)m_streamName.size());
+        Write(m_streamName.data(), m_streamName.size());
+        WriteValue(m_elementType);
+        WriteValue((uint32_t)m_sampleDimension);
+
+        for (const auto& chunk : m_chunks)
+        {
+            WriteValue(chunk.m_offset);
+            WriteValue(chunk.m_numSequences);
+            WriteValue(chunk.m_numSamples);
+        }
+        WriteValue(headerOffset);
+
+        fflushOrDie(m_file);
+        fcloseOrDie(m_file);
+        m_file = nullptr;
+        fflushOrDie(m_keysFile);
+        fcloseOrDie(m_keysFile);
+        m_keysFile = nullptr;
+    }
+
+    size_t GetNumSequences() const { return m_numSequences; }
+    size_t GetNumSamples() const { return m_numSamples; }
+
+private:
+    struct ChunkInfo
+    {
+        int64_t m_offset;
+        uint32_t m_numSequences;
+        uint32_t m_numSamples;
+    };
+
+    size_t GetElementSize() const
+    {
+        switch (m_elementType)
+        {
+        case ElementType::Float:   return sizeof(float);
+        case ElementType::Double:  return sizeof(double);
+        case ElementType::Float16: return sizeof(uint16_t);
+        default: LogicError("BinaryOutputFile: unexpected element type %d.", (int)m_elementType);
+        }
+    }
+
+    template <class ElemType>
+    void ConvertSample(const ElemType* sample, char* out) const
+    {
+        if (m_elementType == ElementType::Float)
+            ConvertSample<ElemType, float>(sample, out, [](ElemType value) { return (float)value; });
+        else if (m_elementType == ElementType::Double)
+            ConvertSample<ElemType, double>(sample, out, [](ElemType value) { return (double)value; });
+        else
+            ConvertSample<ElemType, uint16_t>(sample, out, [](ElemType value) { return FloatToHalf((float)value); });
+    }
+
+    // The output is not necessarily aligned.
+    template <class ElemType, class OutputType, class Convert>
+    void ConvertSample(const ElemType* sample, char* out, const Convert& convert) const
+    {
+        for (size_t i = 0; i < m_sampleDimension; i++)
+        {
+            OutputType value = convert(sample[i]);
+            memcpy(out + i * sizeof(value), &value, sizeof(value));
+        }
+    }
+
+    void FlushChunk()
+    {
+        if (m_sequenceLengths.empty())
+            return;
+
+        m_chunks.push_back(ChunkInfo{ m_offset, (uint32_t)m_sequenceLengths.size(), 0 });
+        for (auto length : m_sequenceLengths)
+            m_chunks.back().m_numSamples += length;
+
+        Write(m_sequenceLengths.data(), m_sequenceLengths.size() * sizeof(uint32_t));
+        Write(m_chunkData.data(), m_chunkData.size());
+        m_sequenceLengths.clear();
+        m_chunkData.clear();
+    }
+
+    template <class T>
+    void WriteValue(T value)
+    {
+        Write(&value, sizeof(value));
+    }
+
+    void Write(const void* data, size_t size)
+    {
+        fwriteOrDie(data, 1, size, m_file);
+        m_offset += size;
+    }
+
+    static const uint64_t s_magicNumber = 0x636e746b5f62696eU; // "cntk_bin"
+    static const uint32_t s_version = 1;
+
+    std::wstring m_path;
+    std::string m_streamName;
+    size_t m_sampleDimension;
+    ElementType m_elementType;
+    size_t m_chunkSizeInBytes;
+
+    FILE* m_file;
+    FILE* m_keysFile;
+    int64_t m_offset;
+    std::vector<ChunkInfo> m_chunks;
+    std::vector<uint32_t> m_sequenceLengths; // of the sequences of the current chunk
+    std::vector<char> m_chunkData;           // sequences of the current chunk
+    size_t m_numSequences;
+    size_t m_numSamples;
+};
+
+}}}
@@ -19,6 +19,12 @@ public:
     // Returns a boolean indicating if any samples were processed
     virtual bool AggregateGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool resetState) = 0;
 
+    // Returns whether sparse block column gradients (e.g. of embeddings) can be aggregated
+    virtual bool SupportsSparseBlockColumnGradients() const
+    {
+        return false;
+    }
+
     size_t NumProc()
     {
         return m_mpi->NumNodesInUse();
@@ -15,6 +15,7 @@
 #include "DataReaderHelpers.h"
 #include "MatrixQuantizerImpl.h"
 #include "InputAndParamNodes.h"
+#include "PreComputeNodes.h"
 #include "AccumulatorAggregation.h"
 
 #ifdef CNTK_PARALLEL_TRAINING_SUPPORT
@@ -35,6 +36,7 @@
 #include "V2SimpleDistGradAggregator.h"
 #include "ProgressTracing.h"
 #include "PerformanceProfiler.h"
+#include "AsyncCrossValidator.h"
 
 #include <map>
 #include <set>
@@ -400,6 +402,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
     {
         currentNumGradientBits = m_numGradientBits[startEpoch]; // remember so that we can detect a change
         InitDistGradAgg(evaluationNodes.size(), currentNumGradientBits, net->GetDeviceId(), m_traceLevel);
+        KeepEmbeddingGradientsDense(net);
     }
     else if (GetParallelizationMethod() == ParallelizationMethod::modelAveragingSGD || 
              GetParallelizationMethod() == ParallelizationMethod::blockMomentumSGD)
@@ -496,7 +499,8 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                                          m_adjustCoefficient,
                                          m_adjustPerMinibatches,
                                          m_traceLevel,
-                                         m_syncStatsTrace));
+                                         m_syncStatsTrace,
+                                         m_maxStaleness));
         m_pASGDHelper->InitModel(learnableNodes);
     }
 
@@ -507,6 +511,60 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         tensorBoardWriter = make_shared<::CNTK::Internal::TensorBoardFileWriter>(m_tensorBoardLogDir, net);
     }
 
+    // Evaluating the cross-validation set in the background needs its own reader and no MPI, so it is limited
+    // to non-distributed training. It is also limited to the CPU, where the threads of the evaluation can be budgeted.
+    vector<wstring> cvSetTrainAndEvalNodes;
+    if (criterionNodes.size() > 0)
+        cvSetTrainAndEvalNodes.push_back(criterionNodes[0]->NodeName());
+    for (let node : evaluationNodes)
+        cvSetTrainAndEvalNodes.push_back(node->NodeName());
+
+    unique_ptr<AsyncCrossValidator<ElemType>> asyncCrossValidator;
+    if (m_asyncCrossValidation && validationSetDataReader != trainSetDataReader && validationSetDataReader != nullptr)
+    {
+        if (net->GetDeviceId() != CPUDEVICE || (m_mpi != nullptr && m_mpi->NumNodesInUse() > 1))
+            LOGPRINTF(stderr, "asyncCrossValidation is only supported for non-distributed training on the CPU. Cross validation runs synchronously.\n");
+        // The result of an epoch arrives after the next epoch has trained, too late to roll back or to adjust the learning rate of that one.
+        else if (m_autoLearnRateSearchType == LearningRateSearchAlgorithm::AdjustAfterEpoch && m_useCVSetControlLRIfCVExists)
+            LOGPRINTF(stderr, "asyncCrossValidation is not supported when the cross-validation set controls autoAdjustLR=AdjustAfterEpoch. Cross validation runs synchronously.\n");
+        else
+            asyncCrossValidator.reset(new AsyncCrossValidator<ElemType>(m_asyncCrossValidationThreads, m_modelPath + L".cvsnapshot"));
+    }
+
+    // logs the cross-validation results of an epoch, and takes them into account for model selection and learning-rate control
+    auto processCrossValidationResults = [&](int epoch, const vector<EpochCriterion>& vScore)
+    {
+        LOGPRINTF(stderr, "Finished Epoch[%2d of %d]: [Validate] ", epoch + 1, (int)m_maxEpochs);
+        for (size_t k = 0; k < vScore.size() /*&& k < 2*/; k++)
+            vScore[k].LogCriterion(cvSetTrainAndEvalNodes[k], /*addSemicolon=*/k + 1 < vScore.size());
+            //fprintf(stderr, "%s %ls = %.8f * %d", k ? ";" : "", cvSetTrainAndEvalNodes[k].c_str(), vScore[k].Average(), (int)vScore[k].second);
+        fprintf(stderr, "\n");
+
+        if (tensorBoardWriter)
+        {
+            for (size_t k = 0; k < vScore.size(); k++)
+            {
+                tensorBoardWriter->WriteValue(L"summary/test_" + cvSetTrainAndEvalNodes[k], (float)vScore[k].Average(), epoch + 1);
+            }
+
+            tensorBoardWriter->Flush();
+        }
+
+        if (m_saveBestModelPerCriterion)
+        {
+            // Loops through criteria (i.e. score) and updates the best one if smaller value is found.
+            UpdateBestEpochs(vScore, cvSetTrainAndEvalNodes, epoch, m_criteriaBestEpoch);
+        }
+
+        if (m_useCVSetControlLRIfCVExists)
+        {
+            if (m_useEvalCriterionControlLR && vScore.size() > 1)
+                lrControlCriterion = vScore[1].Average(); // use the first of possibly multiple eval criteria
+            else
+                lrControlCriterion = vScore[0].Average(); // the first one is the training criterion
+        }
+    };
+
     // --- MAIN EPOCH LOOP
     for (int i = startEpoch; i < (int) m_maxEpochs; i++) // TODO: why is this an int, and not a size_t?
     {
@@ -527,6 +585,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         {
             currentNumGradientBits = m_numGradientBits[i];
             InitDistGradAgg(evaluationNodes.size(), currentNumGradientBits, net->GetDeviceId(), m_traceLevel);
+            KeepEmbeddingGradientsDense(net);
         }
 
         Timer timer;
@@ -699,52 +758,27 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
             tensorBoardWriter->Flush();
         }
 
-        if (validationSetDataReader != trainSetDataReader && validationSetDataReader != nullptr)
+        if (asyncCrossValidator)
+        {
+            // The result of the previous epoch, which had the training of this epoch to finish, is logged and counted
+            // for the best epochs now. Then the evaluation of this epoch starts on a snapshot of the model.
+            if (asyncCrossValidator->IsRunning())
+            {
+                int cvEpoch;
+                let vScore = asyncCrossValidator->Wait(cvEpoch);
+                processCrossValidationResults(cvEpoch, vScore);
+            }
+            asyncCrossValidator->Start(net, validationSetDataReader, cvSetTrainAndEvalNodes, m_mbSize[i], i);
+        }
+        else if (validationSetDataReader != trainSetDataReader && validationSetDataReader != nullptr)
         {
             // TODO(dataASGD) making evaluator becoming nondistributed one when using ASGD, since Multiverso has another background thread using MPI.
             //                Making the evaluation serial (non-distributed) will slowdown training especially when validation set is large.
             SimpleEvaluator<ElemType> evalforvalidation(net, UsingAsyncGradientAggregation(i + 1) ?nullptr : m_mpi, m_enableDistributedMBReading);
-            vector<wstring> cvSetTrainAndEvalNodes;
-            if (criterionNodes.size() > 0)
-            {
-                cvSetTrainAndEvalNodes.push_back(criterionNodes[0]->NodeName());
-            }
-            for (let node : evaluationNodes)
-            {
-                cvSetTrainAndEvalNodes.push_back(node->NodeName());
-            }
 
             // BUGBUG: We should not use the training MB size. The training MB size is constrained by both convergence and memory. Eval is only constrained by memory.
             let vScore = evalforvalidation.Evaluate(validationSetDataReader, cvSetTrainAndEvalNodes, UsingAsyncGradientAggregation(i + 1) ? m_mbSize[i] / m_mpi->NumNodesInUse() : m_mbSize[i]);
-            LOGPRINTF(stderr, "Finished Epoch[%2d of %d]: [Validate] ", i + 1, (int)m_maxEpochs);
-            for (size_t k = 0; k < vScore.size() /*&& k < 2*/; k++)
-                vScore[k].LogCriterion(cvSetTrainAndEvalNodes[k], /*addSemicolon=*/k + 1 < vScore.size());
-                //fprintf(stderr, "%s %ls = %.8f * %d", k ? ";" : "", cvSetTrainAndEvalNodes[k].c_str(), vScore[k].Average(), (int)vScore[k].second);
-            fprintf(stderr, "\n");
-
-            if (tensorBoardWriter)
-            {
-                for (size_t k = 0; k < vScore.size(); k++)
-                {
-                    tensorBoardWriter->WriteValue(L"summary/test_" + cvSetTrainAndEvalNodes[k], (float)vScore[k].Average(), i + 1);
-                }
-
-                tensorBoardWriter->Flush();
-            }
-
-            if (m_saveBestModelPerCriterion)
-            {
-                // Loops through criteria (i.e. score) and updates the best one if smaller value is found.
-                UpdateBestEpochs(vScore, cvSetTrainAndEvalNodes, i, m_criteriaBestEpoch);
-            }
-
-            if (m_useCVSetControlLRIfCVExists)
-            {
-                if (m_useEvalCriterionControlLR && vScore.size() > 1)
-                    lrControlCriterion = vScore[1].Average(); // use the first of possibly multiple eval criteria
-                else
-                    lrControlCriterion = vScore[0].Average(); // the first one is the training criterion
-            }
+            processCrossValidationResults(i, vScore);
         }
 
         // broadcast epochCriterion to make sure each processor will have the same learning rate schedule
@@ -936,6 +970,14 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
     }
     // --- END OF MAIN EPOCH LOOP
 
+    // report the cross validation of the last epoch
+    if (asyncCrossValidator && asyncCrossValidator->IsRunning())
+    {
+        int cvEpoch;
+        let vScore = asyncCrossValidator->Wait(cvEpoch);
+        processCrossValidationResults(cvEpoch, vScore);
+    }
+
     // Check if we need to save best model per criterion and this is the main node as well.
     if (m_saveBestModelPerCriterion && ((m_mpi == nullptr) || m_mpi->IsMainNode()))
     {
@@ -1754,6 +1796,18 @@ bool SGD<ElemType>::PreCompute(ComputationNetworkPtr net,
     // compute
     ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::preComputing);
 
+    // Statistics of the inputs can be computed by the reader directly from the chunks, which is much faster than reading all data through the network.
+    if (m_useAllDataForPreComputedNode && m_preComputeFromChunks)
+    {
+        nodes = PreComputeFromChunks(trainSetDataReader, nodes);
+        if (nodes.empty())
+        {
+            fprintf(stderr, "\n");
+            LOGPRINTF(stderr, "Precomputing --> Completed.\n\n");
+            return true;
+        }
+    }
+
     // trainSetDataReader->StartMinibatchLoop(m_mbSize[0],  0 , requestDataSize);
     // trainSetDataReader->StartMinibatchLoop(m_mbSize[0],  0 , m_epochSize); // only based on one epoch
     // To support large dataset, we usually partition whole dataset into several epoch's,
@@ -1792,6 +1846,71 @@ bool SGD<ElemType>::PreCompute(ComputationNetworkPtr net,
     return true;
 }
 
+template <class ElemType>
+std::list<ComputationNodeBasePtr> SGD<ElemType>::PreComputeFromChunks(IDataReader* trainSetDataReader, const std::list<ComputationNodeBasePtr>& nodes)
+{
+    // the input streams whose Mean or InvStdDev are needed
+    auto isInput = [](const ComputationNodeBasePtr& node)
+    {
+        return node->OperationName() == OperationNameOf(InputValue) || node->OperationName() == OperationNameOf(SparseInputValue);
+    };
+    vector<wstring> streamNames;
+    for (const auto& node : nodes)
+    {
+        if (node->OperationName() != OperationNameOf(MeanNode) && node->OperationName() != OperationNameOf(InvStdDevNode))
+            continue;
+        if (isInput(node->Input(0)) && find(streamNames.begin(), streamNames.end(), node->Input(0)->NodeName()) == streamNames.end())
+            streamNames.push_back(node->Input(0)->NodeName());
+    }
+    if (streamNames.empty())
+        return nodes;
+
+    uint64_t fingerprint;
+    if (!trainSetDataReader->GetStreamStatisticsFingerprint(streamNames, fingerprint))
+    {
+        if (m_traceLevel > 0)
+            LOGPRINTF(stderr, "Precomputing --> The reader cannot compute the input statistics from its chunks, reading all minibatches instead.\n");
+        return nodes;
+    }
+
+    map<wstring, StreamStatistics> statistics;
+    bool loaded = !m_preComputedStatisticsFile.empty() && TryLoadStreamStatistics(m_preComputedStatisticsFile, fingerprint, statistics) &&
+                  all_of(streamNames.begin(), streamNames.end(), [&](const wstring& name) { return statistics.find(name) != statistics.end(); });
+    if (loaded)
+        LOGPRINTF(stderr, "Precomputing --> Loaded the statistics of %d inputs from '%ls'.\n", (int)streamNames.size(), m_preComputedStatisticsFile.c_str());
+    else
+    {
+        // every worker takes its share of the chunks
+        size_t workerRank = m_mpi ? m_mpi->CurrentNodeRank() : 0;
+        size_t numWorkers = m_mpi ? m_mpi->NumNodesInUse() : 1;
+        Timer timer;
+        timer.Start();
+        trainSetDataReader->ComputeStreamStatistics(streamNames, workerRank, numWorkers, statistics);
+        if (numWorkers > 1)
+        {
+            for (auto& iter : statistics)
+                iter.second.MergeAcrossWorkers([this](vector<double>& buffer) { m_mpi->AllReduce(buffer); });
+        }
+        timer.Stop();
+        LOGPRINTF(stderr, "Precomputing --> Computed the statistics of %d inputs over %d samples from the chunks in %.2f seconds.\n",
+                  (int)streamNames.size(), (int)statistics.begin()->second.GetCount(), timer.ElapsedSeconds());
+
+        if (!m_preComputedStatisticsFile.empty() && (!m_mpi || m_mpi->IsMainNode()))
+            SaveStreamStatistics(m_preComputedStatisticsFile, fingerprint, statistics);
+    }
+
+    std::list<ComputationNodeBasePtr> remainingNodes;
+    for (const auto& node : nodes)
+    {
+        auto iter = statistics.find(node->Input(0)->NodeName());
+        if (!isInput(node->Input(0)) || iter == statistics.end() || !dynamic_pointer_cast<IPreComputeNode>(node)->SetFromStatistics(iter->second))
+            remainingNodes.push_back(node);
+        else if (m_traceLevel > 0)
+            LOGPRINTF(stderr, "\t%ls = %ls() from the input statistics\n", node->NodeName().c_str(), node->OperationName().c_str());
+    }
+    return remainingNodes;
+}
+
 // return a reasonable initial learning rate based on the initial mbsize
 template <class ElemType>
 double SGD<ElemType>::SearchForBestLearnRate(ComputationNetworkPtr net,
@@ -2284,7 +2403,7 @@ void SGD<ElemType>::InitDistGradAgg(int numEvalNodes, int numGradientBits, int d
         if (traceLevel > 0)
             fprintf(stderr, "Initializing dataParallelSGD with FP%d aggregation.\n", numGradientBits);
         if (Globals::UseV2Aggregator()) // Currently used to check V2 against baselines.
-            m_distGradAgg = std::make_shared<V2SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, deviceId, m_syncStatsTrace, ::CNTK::MPICommunicator(m_packThresholdSizeInBytes));
+            m_distGradAgg = std::make_shared<V2SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, deviceId, m_syncStatsTrace, m_useHierarchicalAllReduce ? ::CNTK::HierarchicalMPICommunicator(m_packThresholdSizeInBytes) : ::CNTK::MPICommunicator(m_packThresholdSizeInBytes));
         else
             m_distGradAgg = std::make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, deviceId, m_syncStatsTrace, m_packThresholdSizeInBytes);
     }
@@ -2292,6 +2411,26 @@ void SGD<ElemType>::InitDistGradAgg(int numEvalNodes, int numGradientBits, int d
     m_gradHeader.reset(DistGradHeader::Create(numEvalNodes), [](DistGradHeader* ptr) { DistGradHeader::Destroy(ptr); });
 }
 
+// LookupTableNode keeps the gradient of its embedding matrix in sparse block column format for sparse input on the CPU.
+// If the gradient aggregation cannot exchange that format, the gradient is kept dense, as it is on the GPU.
+template <class ElemType>
+void SGD<ElemType>::KeepEmbeddingGradientsDense(ComputationNetworkPtr net)
+{
+    if (m_distGradAgg->SupportsSparseBlockColumnGradients())
+        return;
+
+    for (const auto& node : net->GetNodesWithType(OperationNameOf(LookupTableNode)))
+    {
+        auto embedding = dynamic_pointer_cast<ComputationNode<ElemType>>(node->GetInputs()[0]);
+        if (!embedding)
+            continue;
+
+        if (embedding->GradientPtr() && embedding->Gradient().GetMatrixType() != DENSE)
+            embedding->Gradient().SwitchToMatrixType(DENSE, matrixFormatDense, true);
+        embedding->SetPreferredGradientMatrixType(DENSE);
+    }
+}
+
 template <class ElemType>
 void SGD<ElemType>::InitModelAggregationHandler(int traceLevel, DEVICEID_TYPE devID)
 {
@@ -2856,7 +2995,7 @@ static LearningRateSearchAlgorithm ParseLearningRateSearchType(const wstring& s)
     else InvalidArgument("autoAdjustLR: Invalid learning rate search type. Valid values are (none | searchBeforeEpoch | adjustAfterEpoch)");
 }
   
-#ifdef ASGD_PARALLEL_SUPPORT
+#if defined(ASGD_PARALLEL_SUPPORT) || HAS_MPI
 static AdjustLearningRateAtBeginning AdjustLearningRateAtBeginningType(const wstring& s)
 {
     if      (EqualCI(s.c_str(), L"") || EqualCI(s.c_str(), L"none")) return AdjustLearningRateAtBeginning::None;
@@ -3017,6 +3156,13 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     }
 
     m_useAllDataForPreComputedNode = configSGD(L"UseAllDataForPreComputedNode", true);
+    m_preComputeFromChunks = configSGD(L"preComputeFromChunks", true);
+    m_preComputedStatisticsFile = msra::strfun::utf16(configSGD(L"preComputedStatisticsFile", L""));
+
+    m_asyncCrossValidation = configSGD(L"asyncCrossValidation", false);
+    m_asyncCrossValidationThreads = configSGD(L"asyncCrossValidationThreads", (int)1);
+    if (m_asyncCrossValidationThreads < 1)
+        InvalidArgument("asyncCrossValidationThreads must be at least 1.");
 
     // consistency checks
     for (size_t i = 0; i < m_mbSize.size(); i++)
@@ -3120,6 +3266,7 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_zeroThresholdFor1Bit = true;
     m_bufferedAsyncGradientAggregation = false;
     m_enableDistributedMBReading = false;
+    m_useHierarchicalAllReduce = false;
     m_parallelizationStartEpochNum = 0;
     m_modelAggregationBlockSize = 0; 
 
@@ -3144,6 +3291,7 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
             m_enableDistributedMBReadingNotSpecified = !configParallelTrain.Exists(L"distributedMBReading");
             m_enableDistributedMBReading = configParallelTrain(L"distributedMBReading", false);
             m_syncStatsTrace = configParallelTrain(L"syncPerfStats", (int)0);
+            m_useHierarchicalAllReduce = configParallelTrain(L"hierarchicalAllReduce", false); // sum within each host through shared memory before summing across hosts
 
         if (configParallelTrain.Exists(L"DataParallelSGD"))
         {
@@ -3247,7 +3395,7 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
 
         if (configParallelTrain.Exists(L"DataParallelASGD"))
         {
-#ifndef ASGD_PARALLEL_SUPPORT
+#if !defined(ASGD_PARALLEL_SUPPORT) && !HAS_MPI
             InvalidArgument("DataParallelASGD is not enabled in this version.\n");
 #else
             const ConfigRecordType & configDataParallelASGD(configParallelTrain(L"DataParallelASGD", ConfigRecordType::Record()));
@@ -3262,6 +3410,10 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
 #endif
             m_isAsyncBufferEnabled = configDataParallelASGD(L"UsePipeline", false);
             m_isSimulateMA = configDataParallelASGD(L"SimModelAverage", false); // using parameter server-based version of ModelAveragingSGD
+            m_maxStaleness = configDataParallelASGD(L"maxStaleness", (size_t)4); // bound on how many syncs a worker may run ahead of the slowest one (built-in parameter server only)
+            m_adjustLearningRateAtBeginning = AdjustLearningRateAtBeginning::None;
+            m_adjustCoefficient = 0.1;
+            m_adjustPerMinibatches = 256;
             if (configDataParallelASGD.Exists(L"AdjustLearningRateAtBeginning")) // adjust learning rate per m_adjustNumInBatch minibatches until to original one,
                                                                                  // this option could be used to takcle the unstableness of DataParallelASGD if you get a chance
             {
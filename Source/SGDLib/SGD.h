@@ -233,6 +233,11 @@ protected:
     bool m_useCVSetControlLRIfCVExists;
     bool m_useEvalCriterionControlLR;
 
+    // evaluate the cross-validation set on a snapshot of the model in the background (see AsyncCrossValidator.h),
+    // with this many threads. The learning-rate control then uses the result of the previous epoch.
+    bool m_asyncCrossValidation;
+    int m_asyncCrossValidationThreads;
+
     double m_increaseLearnRateIfImproveMoreThan;
     double m_learnRateIncreaseFactor;
     double m_learnRateDecreaseFactor;
@@ -268,6 +273,8 @@ protected:
     bool m_doUnitTest;
 
     bool m_useAllDataForPreComputedNode;
+    bool m_preComputeFromChunks;               // compute Mean and InvStdDev of inputs directly from the deserializer chunks
+    std::wstring m_preComputedStatisticsFile; // if not empty, where these statistics are kept for later jobs on the same data
 
     // Parallel training
     MPIWrapperPtr m_mpi;
@@ -289,6 +296,9 @@ protected:
     // n > 1: Show stats after every n sync
     int m_syncStatsTrace;
 
+    // sum gradients and models within each host through shared memory, and across hosts among one rank per host
+    bool m_useHierarchicalAllReduce;
+
     // Data parallel SGD training parameters
     intargvector m_numGradientBits;
     bool m_bufferedAsyncGradientAggregation;
@@ -309,6 +319,7 @@ protected:
     intargvector m_nSyncSamplesPerWorker;
     bool m_isAsyncBufferEnabled;
     bool m_isSimulateMA;
+    size_t m_maxStaleness;
     AdjustLearningRateAtBeginning m_adjustLearningRateAtBeginning;
     double m_adjustCoefficient;
     size_t m_adjustPerMinibatches;
@@ -380,6 +391,8 @@ public:
 
         if (m_mpi == nullptr)
             m_parallelizationMethod = ParallelizationMethod::none;
+        else if (m_useHierarchicalAllReduce)
+            m_mpi->SetUseHierarchicalAllReduce(true);
         }
 
     void Train(shared_ptr<ComputationNetwork> net, DEVICEID_TYPE deviceId,
@@ -411,6 +424,9 @@ protected:
                     const std::vector<ComputationNodeBasePtr>& labelNodes,
                     StreamMinibatchInputs* inputMatrices);
 
+    // sets the Mean and InvStdDev nodes over inputs from statistics computed by the reader; returns the nodes that are left
+    std::list<ComputationNodeBasePtr> PreComputeFromChunks(IDataReader* trainSetDataReader, const std::list<ComputationNodeBasePtr>& nodes);
+
     // return a reasonable initial learning rate based on the initial mbsize
     double SearchForBestLearnRate(ComputationNetworkPtr net,
                                   ComputationNetworkPtr refNet,
@@ -513,6 +529,7 @@ protected:
                          ::CNTK::Internal::TensorBoardFileWriterPtr tensorBoardWriter = nullptr);
 
     void InitDistGradAgg(int numEvalNodes, int numGradientBits, int deviceId, int traceLevel);
+    void KeepEmbeddingGradientsDense(ComputationNetworkPtr net);
     void InitModelAggregationHandler(int traceLevel, DEVICEID_TYPE devID);
 public:
     // UpdateWeights() - actual weight update, implementing various update rules
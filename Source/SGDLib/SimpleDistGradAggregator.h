@@ -37,6 +37,12 @@ public:
             DistGradHeader::Destroy(m_bufferedGradHeader);
     }
 
+    // Block column gradients on the CPU are exchanged as (column index, column values) pairs, except with async aggregation
+    bool SupportsSparseBlockColumnGradients() const override
+    {
+        return !m_useAsyncAggregation;
+    }
+
     // Aggregate the gradient matrices across all nodes
     bool AggregateGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool resetState) override
     {
@@ -165,60 +171,7 @@ private:
                 m_allocator.reset(new CUDAPageLockedMemAllocator(deviceId));
             }
 
-            size_t packedGradientsSizeInElements = 0;
-            for (size_t i = 0; i < gradients.size(); i++)
-            {
-                if (!m_useAsyncAggregation && sizeof(ElemType) * gradients[i]->GetNumElements() <= m_packThresholdSizeInBytes)
-                {
-                    packedGradientsSizeInElements += gradients[i]->GetNumElements();
-                    m_packedGradientsIndex.push_back(i);
-                }
-                else
-                {
-                    m_gradientIndexToAggregate.push_back(i);
-                }
-
-                // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
-                if (gradients[i]->GetMatrixType() != DENSE)
-                    RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
-
-                if (m_useAsyncAggregation)
-                    m_bufferedGradients[gradients[i]].reset(new Matrix<ElemType>(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), deviceId));
-            }
-
-            // Packing matrices into continous buffer if not doing async aggregation
-            m_aggregationBuffer.reset();
-            if (packedGradientsSizeInElements > 0)
-            {
-                m_aggregationBuffer.reset(new (std::nothrow) Matrix<ElemType>(1, packedGradientsSizeInElements, deviceId));
-            }
-            // If no extra continous buffer allocated or using async aggregation
-            if (m_aggregationBuffer == nullptr)
-            {
-                m_gradientIndexToAggregate.clear();
-                m_packedGradientsIndex.clear();
-                packedGradientsSizeInElements = 0;
-                // Reuse "@param m_gradientIndexToAggregate" for following code, if no continous buffer allocated
-                for (size_t i = 0; i < gradients.size(); i++)
-                {
-                    m_gradientIndexToAggregate.push_back(i);
-                }
-            }
-            else
-            {
-                // First element is reserved for continous buffer
-                m_gradientIndexToAggregate.insert(m_gradientIndexToAggregate.begin(), 1, (size_t)-1);
-            }
-
-            if (ShouldCopyDataToCPU(deviceId))
-            {
-                for (size_t i : m_gradientIndexToAggregate)
-                {
-                    m_gpuDataTransferers.push_back(std::make_unique<GPUDataTransferer>(deviceId, m_useAsyncAggregation));
-                    m_intermediateCPUBuffers.push_back(AllocateIntermediateBuffer(deviceId,
-                        (i == -1) ? packedGradientsSizeInElements : gradients[i]->GetNumElements()));
-                }
-            }
+            IndexGradients(gradients);
 
             if (m_useAsyncAggregation)
             {
@@ -247,6 +200,100 @@ private:
                 m_bufferedGradHeader->Clear();
             }
         }
+
+        // The gradient of an embedding switches between dense and sparse block column with the type of its input,
+        // so the gradients are sorted again when the format of one of them has changed.
+        if (GradientFormatsChanged(gradients))
+            IndexGradients(gradients);
+    }
+
+    // Sorts the gradients into packed, separately all-reduced and sparse ones, and sets up their buffers.
+    void IndexGradients(const std::vector<Matrix<ElemType>*>& gradients)
+    {
+        int deviceId = gradients[0]->GetDeviceId();
+        m_packedGradientsIndex.clear();
+        m_gradientIndexToAggregate.clear();
+        m_sparseGradientsIndex.clear();
+        m_gpuDataTransferers.clear();
+        m_intermediateCPUBuffers.clear();
+        m_gradientFormats.clear();
+
+        size_t packedGradientsSizeInElements = 0;
+        for (size_t i = 0; i < gradients.size(); i++)
+        {
+            m_gradientFormats.push_back(gradients[i]->GetFormat());
+
+            // Sparse block column gradients on the CPU (e.g. of embeddings) are exchanged as (column index, column values) pairs.
+            // Other sparse gradient matrices are currently not supported.
+            if (gradients[i]->GetMatrixType() != DENSE)
+            {
+                if (m_useAsyncAggregation || deviceId != CPUDEVICE || gradients[i]->GetFormat() != matrixFormatSparseBlockCol)
+                    RuntimeError("Gradient aggregation for sparse gradient matrices is currently only supported for block column gradients on the CPU without async aggregation!");
+
+                m_sparseGradientsIndex.push_back(i);
+                continue;
+            }
+
+            if (!m_useAsyncAggregation && sizeof(ElemType) * gradients[i]->GetNumElements() <= m_packThresholdSizeInBytes)
+            {
+                packedGradientsSizeInElements += gradients[i]->GetNumElements();
+                m_packedGradientsIndex.push_back(i);
+            }
+            else
+            {
+                m_gradientIndexToAggregate.push_back(i);
+            }
+
+            if (m_useAsyncAggregation)
+                m_bufferedGradients[gradients[i]].reset(new Matrix<ElemType>(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), deviceId));
+        }
+
+        // Packing matrices into continous buffer if not doing async aggregation
+        m_aggregationBuffer.reset();
+        if (packedGradientsSizeInElements > 0)
+        {
+            m_aggregationBuffer.reset(new (std::nothrow) Matrix<ElemType>(1, packedGradientsSizeInElements, deviceId));
+        }
+        // If no extra continous buffer allocated or using async aggregation
+        if (m_aggregationBuffer == nullptr)
+        {
+            m_gradientIndexToAggregate.clear();
+            m_packedGradientsIndex.clear();
+            packedGradientsSizeInElements = 0;
+            // Reuse "@param m_gradientIndexToAggregate" for following code, if no continous buffer allocated
+            for (size_t i = 0; i < gradients.size(); i++)
+            {
+                if (gradients[i]->GetMatrixType() == DENSE)
+                    m_gradientIndexToAggregate.push_back(i);
+            }
+        }
+        else
+        {
+            // First element is reserved for continous buffer
+            m_gradientIndexToAggregate.insert(m_gradientIndexToAggregate.begin(), 1, (size_t)-1);
+        }
+
+        if (ShouldCopyDataToCPU(deviceId))
+        {
+            for (size_t i : m_gradientIndexToAggregate)
+            {
+                m_gpuDataTransferers.push_back(std::make_unique<GPUDataTransferer>(deviceId, m_useAsyncAggregation));
+                m_intermediateCPUBuffers.push_back(AllocateIntermediateBuffer(deviceId,
+                    (i == -1) ? packedGradientsSizeInElements : gradients[i]->GetNumElements()));
+            }
+        }
+    }
+
+    bool GradientFormatsChanged(const std::vector<Matrix<ElemType>*>& gradients) const
+    {
+        if (gradients.size() != m_gradientFormats.size())
+            return true;
+        for (size_t i = 0; i < gradients.size(); i++)
+        {
+            if (gradients[i]->GetFormat() != m_gradientFormats[i])
+                return true;
+        }
+        return false;
     }
 
     void AggregateGradientsImpl(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool showSyncPerfStats)
@@ -342,7 +389,14 @@ private:
                     reductionBuffer = m_intermediateCPUBuffers[allReduceIndex].get();
                 }
 
-                if (m_mpi->UseGpuGdr() == 0)
+                // The hierarchical AllReduce() has no asynchronous version. It completes here, and the request stays null.
+                if (m_mpi->UseGpuGdr() == 0 && m_mpi->UseHierarchicalAllReduce())
+                {
+                    allReduceRequests.back() = MPI_REQUEST_NULL;
+                    m_mpi->AllReduce(reductionBuffer, (i == -1) ? m_aggregationBuffer->GetNumElements() : gradients[i]->GetNumElements());
+                    allReduceIndex++;
+                }
+                else if (m_mpi->UseGpuGdr() == 0)
                 {
                     m_mpi->Iallreduce(MPI_IN_PLACE, reductionBuffer, (i == -1) ? m_aggregationBuffer->GetNumElements() : gradients[i]->GetNumElements(),
                         MPIWrapper::GetDataType(reductionBuffer), MPI_SUM, &allReduceRequests.back()) || MpiFail("MPI_Iallreduce");
@@ -426,6 +480,9 @@ private:
             offset += gradients[i]->GetNumElements();
         }
 
+        for (size_t i : m_sparseGradientsIndex)
+            AggregateSparseBlockColumnGradient(*gradients[i]);
+
         // Wait for completion of the async send requests
         if (!m_mpi->IsMainNode())
             m_mpi->Wait(&sendHeaderRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
@@ -438,6 +495,57 @@ private:
         }
     }
 
+    // Instead of all-reducing the full matrix, every worker gathers the touched columns of all workers and sums them up.
+    // The number of columns is padded to the maximum over all workers, so that a plain allgather can be used.
+    void AggregateSparseBlockColumnGradient(Matrix<ElemType>& gradient)
+    {
+        if (NumProc() == 1)
+            return;
+
+        const size_t numRows = gradient.GetNumRows();
+        std::vector<size_t> columnIds;
+        std::vector<ElemType> values;
+        gradient.GetSparseBlockColumns(columnIds, values);
+
+        size_t maxNumColumns = columnIds.size();
+        m_mpi->AllReduce(&maxNumColumns, 1, MPI_MAX);
+        if (maxNumColumns == 0)
+            return;
+
+        const size_t noColumn = SIZE_MAX;
+        columnIds.resize(maxNumColumns, noColumn);
+        values.resize(maxNumColumns * numRows, 0);
+
+        std::vector<size_t> allColumnIds(maxNumColumns * NumProc());
+        std::vector<ElemType> allValues(values.size() * NumProc());
+        m_mpi->AllGather(columnIds.data(), columnIds.size(), allColumnIds.data(), columnIds.size());
+        m_mpi->AllGather(values.data(), values.size(), allValues.data(), values.size());
+
+        // Columns are summed up in rank order, so all workers end up with bit-identical gradients.
+        std::unordered_map<size_t, size_t> columnToBlock;
+        columnIds.clear();
+        values.clear();
+        for (size_t k = 0; k < allColumnIds.size(); k++)
+        {
+            if (allColumnIds[k] == noColumn)
+                continue;
+
+            auto result = columnToBlock.insert(std::make_pair(allColumnIds[k], columnIds.size()));
+            if (result.second)
+            {
+                columnIds.push_back(allColumnIds[k]);
+                values.resize(values.size() + numRows, 0);
+            }
+
+            ElemType* target = values.data() + result.first->second * numRows;
+            const ElemType* source = allValues.data() + k * numRows;
+            for (size_t r = 0; r < numRows; r++)
+                target[r] += source[r];
+        }
+
+        gradient.SetSparseBlockColumns(columnIds, values);
+    }
+
 private:
     std::unique_ptr<CUDAPageLockedMemAllocator> m_allocator;
 
@@ -463,6 +571,12 @@ private:
     std::vector<size_t> m_packedGradientsIndex;
     std::vector<size_t> m_gradientIndexToAggregate;
 
+    // Sparse block column gradients, aggregated as (column index, column values) pairs.
+    std::vector<size_t> m_sparseGradientsIndex;
+
+    // Formats of the gradients when they were last sorted into the indices above.
+    std::vector<MatrixFormat> m_gradientFormats;
+
     int m_syncStatsTrace;
 
     // Only used for controlling frequency of measuring/showing gradient aggregation perf stats
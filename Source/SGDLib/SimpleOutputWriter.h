@@ -18,6 +18,9 @@
 #include <cstdio>
 #include "ProgressTracing.h"
 #include "ComputationNetworkBuilder.h"
+#include "BinaryOutputFile.h"
+#include <future>
+#include <memory>
 
 using namespace std;
 
@@ -290,7 +293,150 @@ public:
             iter.second->Flush();
     }
 
+    // Writes the values of the output nodes in CNTK binary format, one file <outputPath>.<node name> per node, see BinaryOutputFile.
+    // With several MPI workers, every worker evaluates its share of the data and writes it to files with the suffix .rank<rank>.
+    // The values of a minibatch are only copied out of the network on the main thread; conversion and writing
+    // run as a background task while the next minibatch is evaluated.
+    // Sequences that do not fit into a minibatch (truncated BPTT) are written as several sequences.
+    void WriteOutputBinary(IDataReader& dataReader, size_t mbSize, std::wstring outputPath, const std::vector<std::wstring>& outputNodeNames,
+                           BinaryOutputFile::ElementType elementType, size_t chunkSizeInBytes, size_t numOutputSamples = requestDataSize, const MPIWrapperPtr& mpi = nullptr)
+    {
+        if (outputPath == L"-")
+            InvalidArgument("write command: binary output cannot be written to stdout.");
+
+        ScopedNetworkOperationMode modeGuard(m_net, NetworkOperationMode::inferring);
+
+        std::vector<ComputationNodeBasePtr> outputNodes = m_net->OutputNodesByName(outputNodeNames);
+        std::vector<ComputationNodeBasePtr> inputNodes = m_net->InputNodesForOutputs(outputNodeNames);
+
+        // allocate memory for forward computation
+        m_net->AllocateAllMatrices({}, outputNodes, nullptr);
+
+        StreamMinibatchInputs inputMatrices = DataReaderHelpers::RetrieveInputMatrices(inputNodes);
+
+        // Legacy readers are decimated in GetMinibatchIntoNetwork().
+        bool useParallel = mpi && mpi->NumNodesInUse() > 1;
+        bool useDistributedMBReading = useParallel && dataReader.SupportsDistributedMBRead();
+        if (useDistributedMBReading)
+            dataReader.StartDistributedMinibatchLoop(mbSize, 0, mpi->CurrentNodeRank(), mpi->NumNodesInUse(), inputMatrices.GetStreamDescriptions(), numOutputSamples);
+        else
+            dataReader.StartMinibatchLoop(mbSize, 0, inputMatrices.GetStreamDescriptions(), numOutputSamples);
+
+        m_net->StartEvaluateMinibatchLoop(outputNodes);
+
+        // open output files
+        std::wstring shardSuffix = useParallel ? msra::strfun::wstrprintf(L".rank%d", (int)mpi->CurrentNodeRank()) : std::wstring();
+        File::MakeIntermediateDirs(outputPath);
+        std::vector<std::unique_ptr<BinaryOutputFile>> outputFiles;
+        for (auto& onode : outputNodes)
+        {
+            outputFiles.push_back(std::make_unique<BinaryOutputFile>(outputPath + L"." + onode->NodeName() + shardSuffix, onode->NodeName(),
+                                                                     onode->GetSampleLayout().GetNumElements(), elementType, chunkSizeInBytes));
+        }
+
+        std::future<void> pendingWrite;
+        size_t totalEpochSamples = 0;
+        size_t actualMBSize;
+        const size_t numIterationsBeforePrintingProgress = 100;
+        size_t numItersSinceLastPrintOfProgress = 0;
+        for (size_t numMBsRun = 0; DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(dataReader, m_net, nullptr, useDistributedMBReading, useParallel, inputMatrices, actualMBSize, mpi); numMBsRun++)
+        {
+            if (actualMBSize == 0)
+                continue;
+
+            ComputationNetwork::BumpEvalTimeStamp(inputNodes);
+            m_net->ForwardProp(outputNodes);
+
+            // The network reuses its buffers and the reader its key mapping for the next minibatch, so copy out everything the write needs.
+            auto outputs = std::make_shared<std::vector<MinibatchOutput>>();
+            for (auto& onode : outputNodes)
+                outputs->push_back(GetMinibatchOutput(dynamic_pointer_cast<ComputationNode<ElemType>>(onode), inputMatrices.m_getKeyById, numMBsRun));
+
+            if (pendingWrite.valid())
+                pendingWrite.get();
+            pendingWrite = std::async(std::launch::async, [&outputFiles, outputs]()
+            {
+                for (size_t i = 0; i < outputs->size(); i++)
+                    WriteMinibatchOutput(*outputFiles[i], (*outputs)[i]);
+            });
+
+            totalEpochSamples += actualMBSize;
+
+            numItersSinceLastPrintOfProgress = ProgressTracing::TraceFakeProgress(numIterationsBeforePrintingProgress, numItersSinceLastPrintOfProgress);
+
+            // call DataEnd function in dataReader to do
+            // reader specific process if sentence ending is reached
+            dataReader.DataEnd();
+        }
+
+        if (pendingWrite.valid())
+            pendingWrite.get();
+
+        for (auto& file : outputFiles)
+            file->Close();
+
+        fprintf(stderr, "Written to %ls*%ls\nTotal Samples Evaluated = %lu, %lu sequences\n", outputPath.c_str(), shardSuffix.c_str(),
+                (unsigned long)totalEpochSamples, outputFiles.empty() ? 0ul : (unsigned long)outputFiles[0]->GetNumSequences());
+    }
+
 private:
+    // Values of an output node for one minibatch, with the sequences to write.
+    struct MinibatchOutput
+    {
+        std::unique_ptr<ElemType[]> m_values;
+        size_t m_numRows;
+        size_t m_numParallelSequences;
+        size_t m_numTimeSteps;
+        std::vector<MBLayout::SequenceInfo> m_sequences; // without gaps
+        std::vector<std::string> m_keys;
+    };
+
+    static MinibatchOutput GetMinibatchOutput(ComputationNodePtr node, const std::function<std::string(size_t)>& getKeyById, size_t numMBsRun)
+    {
+        const auto& values = node->Value();
+
+        MinibatchOutput output;
+        output.m_values.reset(values.CopyToArray());
+        output.m_numRows = values.GetNumRows();
+
+        auto pMBLayout = node->GetMBLayout();
+        if (!pMBLayout) // no MBLayout: all columns form a single sequence, keyed by the minibatch
+        {
+            output.m_numParallelSequences = 1;
+            output.m_numTimeSteps = values.GetNumCols();
+            output.m_sequences.push_back(MBLayout::SequenceInfo{ 0, 0, 0, values.GetNumCols() });
+            output.m_keys.push_back(std::to_string(numMBsRun));
+            return output;
+        }
+
+        output.m_numParallelSequences = pMBLayout->GetNumParallelSequences();
+        output.m_numTimeSteps = pMBLayout->GetNumTimeSteps();
+        for (const auto& sequence : pMBLayout->GetAllSequences())
+        {
+            if (sequence.seqId == GAP_SEQUENCE_ID)
+                continue;
+            output.m_sequences.push_back(sequence);
+            output.m_keys.push_back(getKeyById ? getKeyById(sequence.seqId) : std::to_string(sequence.seqId));
+        }
+        return output;
+    }
+
+    static void WriteMinibatchOutput(BinaryOutputFile& file, const MinibatchOutput& output)
+    {
+        for (size_t i = 0; i < output.m_sequences.size(); i++)
+        {
+            const auto& sequence = output.m_sequences[i];
+            // [tBegin,tEnd) is the part of the sequence in this minibatch
+            size_t tBegin = sequence.tBegin >= 0 ? (size_t)sequence.tBegin : 0;
+            size_t tEnd = std::min(sequence.tEnd, output.m_numTimeSteps);
+            if (tBegin >= tEnd)
+                continue;
+
+            const ElemType* data = output.m_values.get() + (tBegin * output.m_numParallelSequences + sequence.s) * output.m_numRows;
+            file.AddSequence(output.m_keys[i], data, tEnd - tBegin, output.m_numParallelSequences * output.m_numRows);
+        }
+    }
+
     ComputationNetworkPtr m_net;
     int m_verbosity;
     void operator=(const SimpleOutputWriter&); // (not assignable)
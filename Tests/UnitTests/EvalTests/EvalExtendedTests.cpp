@@ -415,5 +415,86 @@ BOOST_AUTO_TEST_CASE(EvalRNNTest)
     eval->Destroy();
 }
 
+BOOST_AUTO_TEST_CASE(EvalMultiSequenceTest)
+{
+    // Running sum over each sequence: o1[t] = i1[t] + o1[t-1]
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(2) \n"
+        "d1 = PastValue(2, o1, timeStep = 1, defaultHiddenActivity = 0) \n"
+        "o1 = Plus(i1, d1, tag=\"output\") \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    // Three sequences of different lengths, computed in one call
+    std::vector<Values<float>> inputs(3, Values<float>(1));
+    inputs[0][0].m_buffer = { 1, 2, 3, 4, 5, 6 };
+    inputs[1][0].m_buffer = { 10, 20 };
+    inputs[2][0].m_buffer = { 1, 1, 2, 2 };
+    std::vector<Values<float>> outputs(3);
+    for (auto& output : outputs)
+        output = outputLayouts.CreateBuffers<float>({ 3 });
+
+    eval->ForwardPass(inputs, { true, true, true }, outputs);
+
+    std::vector<std::vector<float>> expected = { { 1, 2, 4, 6, 9, 12 }, { 10, 20 }, { 1, 1, 3, 3 } };
+    for (size_t s = 0; s < expected.size(); s++)
+    {
+        const auto& buf = outputs[s][0].m_buffer;
+        BOOST_CHECK_EQUAL_COLLECTIONS(buf.begin(), buf.end(), expected[s].begin(), expected[s].end());
+    }
+
+    // Only the longest sequence of the previous call can be continued.
+    BOOST_REQUIRE_THROW(eval->ForwardPass(inputs, { false, false, true }, outputs), std::exception);
+
+    // Continue the first sequence and start new ones in the others, via ValueRefs.
+    std::vector<ValueRefs<float>> inputRefs(3, ValueRefs<float>(1));
+    std::vector<ValueRefs<float>> outputRefs(3, ValueRefs<float>(1));
+    std::vector<std::vector<float>> outputData(3, std::vector<float>(6));
+    for (size_t s = 0; s < inputs.size(); s++)
+    {
+        inputRefs[s][0].m_buffer.InitFrom(inputs[s][0].m_buffer);
+        outputRefs[s][0].m_buffer.InitFrom(outputData[s].data(), outputData[s].size(), 0);
+    }
+    eval->ForwardPass(inputRefs, { false, true, true }, outputRefs);
+
+    expected[0] = { 10, 14, 13, 18, 18, 24 };
+    for (size_t s = 0; s < expected.size(); s++)
+    {
+        BOOST_REQUIRE_EQUAL(outputRefs[s][0].m_buffer.size(), expected[s].size());
+        BOOST_CHECK_EQUAL_COLLECTIONS(outputData[s].begin(), outputData[s].begin() + expected[s].size(), expected[s].begin(), expected[s].end());
+    }
+
+    // The number of parallel sequences cannot change while a sequence is continued.
+    std::vector<Values<float>> twoInputs(inputs.begin(), inputs.begin() + 2);
+    std::vector<Values<float>> twoOutputs(outputs.begin(), outputs.begin() + 2);
+    BOOST_REQUIRE_THROW(eval->ForwardPass(twoInputs, { false, true }, twoOutputs), std::exception);
+
+    // A single sequence is evaluated on the caller's buffer, and leaves the network usable for other sizes.
+    Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 3 });
+    eval->ForwardPass(inputs[2], outputBuffer);
+    eval->ForwardPass(inputs[0], outputBuffer);
+    std::vector<float> expectedSingle = { 1, 2, 4, 6, 9, 12 };
+    auto buf = outputBuffer[0].m_buffer;
+    BOOST_CHECK_EQUAL_COLLECTIONS(buf.begin(), buf.end(), expectedSingle.begin(), expectedSingle.end());
+
+    // Nor can a single sequence be continued in several parallel ones.
+    BOOST_REQUIRE_THROW(eval->ForwardPass(inputs, { false, true, true }, outputs), std::exception);
+    eval->ForwardPass(inputs, { true, true, true }, outputs);
+    buf = outputs[0][0].m_buffer;
+    BOOST_CHECK_EQUAL_COLLECTIONS(buf.begin(), buf.end(), expectedSingle.begin(), expectedSingle.end());
+
+    eval->Destroy();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }}}}
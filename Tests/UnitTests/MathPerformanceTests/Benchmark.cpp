@@ -0,0 +1,185 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Benchmark.cpp -- timing, JSON output and baseline comparison of the micro-benchmarks
+//
+#include "stdafx.h"
+#include "Basics.h"
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Benchmark {
+
+static const size_t c_minSamples = 5;
+
+ProblemSize ParseProblemSize(const string& s)
+{
+    if (s == "small")
+        return ProblemSize::Small;
+    if (s == "medium")
+        return ProblemSize::Medium;
+    if (s == "large")
+        return ProblemSize::Large;
+    InvalidArgument("Invalid problem size '%s', expected 'small', 'medium' or 'large'.", s.c_str());
+}
+
+const char* ToString(ProblemSize size)
+{
+    return size == ProblemSize::Small ? "small" : size == ProblemSize::Medium ? "medium" : "large";
+}
+
+BenchmarkRunner::BenchmarkRunner(ProblemSize size, const string& filter, double minSeconds, bool listOnly)
+    : m_size(size), m_minSeconds(minSeconds), m_listOnly(listOnly)
+{
+    size_t begin = 0;
+    while (begin < filter.size())
+    {
+        size_t end = filter.find(',', begin);
+        if (end == string::npos)
+            end = filter.size();
+        if (end > begin)
+            m_filters.push_back(filter.substr(begin, end - begin));
+        begin = end + 1;
+    }
+}
+
+bool BenchmarkRunner::Wants(const string& name)
+{
+    bool selected = m_filters.empty() || any_of(m_filters.begin(), m_filters.end(), [&](const string& f) { return name.find(f) != string::npos; });
+    if (selected && m_listOnly)
+        fprintf(stdout, "%s\n", name.c_str());
+    return selected && !m_listOnly;
+}
+
+void BenchmarkRunner::Measure(const string& name, double flops, double bytes, const function<void()>& fn)
+{
+    typedef chrono::high_resolution_clock Clock;
+    auto seconds = [](Clock::time_point begin, Clock::time_point end) { return chrono::duration<double>(end - begin).count(); };
+
+    auto warmUpBegin = Clock::now();
+    fn();
+    double warmUpSeconds = max(seconds(warmUpBegin, Clock::now()), 1e-9);
+
+    // calls per sample, so that a sample is long enough to be measured with the resolution of the clock
+    double sampleSeconds = m_minSeconds / c_minSamples;
+    size_t callsPerSample = (size_t)max(1.0, ceil(sampleSeconds / warmUpSeconds));
+
+    vector<double> samples;
+    double totalSeconds = 0;
+    while (samples.size() < c_minSamples || totalSeconds < m_minSeconds)
+    {
+        auto begin = Clock::now();
+        for (size_t i = 0; i < callsPerSample; i++)
+            fn();
+        double elapsed = seconds(begin, Clock::now());
+        samples.push_back(elapsed / (double)callsPerSample);
+        totalSeconds += elapsed;
+    }
+
+    sort(samples.begin(), samples.end());
+    BenchmarkResult result;
+    result.m_name = name;
+    result.m_iterations = samples.size() * callsPerSample;
+    result.m_medianSeconds = samples.size() % 2 ? samples[samples.size() / 2] : (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2;
+    result.m_minSeconds = samples.front();
+    result.m_flops = flops;
+    result.m_bytes = bytes;
+    m_results.push_back(result);
+
+    fprintf(stdout, "%-80s %12.3f us", name.c_str(), result.m_medianSeconds * 1e6);
+    if (flops > 0)
+        fprintf(stdout, " %9.2f GFLOP/s", flops / result.m_medianSeconds * 1e-9);
+    if (bytes > 0)
+        fprintf(stdout, " %9.2f GB/s", bytes / result.m_medianSeconds * 1e-9);
+    fprintf(stdout, "\n");
+    fflush(stdout);
+}
+
+void WriteResults(const string& path, ProblemSize size, int numThreads, const vector<BenchmarkResult>& results)
+{
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f)
+        RuntimeError("Cannot open '%s' for writing.", path.c_str());
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"size\": \"%s\",\n", ToString(size));
+    fprintf(f, "  \"threads\": %d,\n", numThreads);
+    fprintf(f, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const auto& r = results[i];
+        fprintf(f, "    { \"name\": \"%s\", \"iterations\": %d, \"medianSeconds\": %.9g, \"minSeconds\": %.9g, \"gflopsPerSecond\": %.6g, \"gbytesPerSecond\": %.6g }%s\n",
+                r.m_name.c_str(), (int)r.m_iterations, r.m_medianSeconds, r.m_minSeconds,
+                r.m_flops / r.m_medianSeconds * 1e-9, r.m_bytes / r.m_medianSeconds * 1e-9, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+
+    if (fclose(f) != 0)
+        RuntimeError("Error writing '%s'.", path.c_str());
+}
+
+// Not a general JSON parser: relies on the layout written by WriteResults(), one benchmark per line,
+// and on benchmark names without quotes or escapes.
+map<string, double> ReadBaseline(const string& path)
+{
+    ifstream in(path);
+    if (!in)
+        RuntimeError("Cannot open baseline '%s'.", path.c_str());
+
+    const string nameKey = "\"name\": \"";
+    const string medianKey = "\"medianSeconds\": ";
+    map<string, double> baseline;
+    string line;
+    while (getline(in, line))
+    {
+        size_t name = line.find(nameKey);
+        size_t median = line.find(medianKey);
+        if (name == string::npos || median == string::npos)
+            continue;
+
+        name += nameKey.size();
+        size_t nameEnd = line.find('"', name);
+        if (nameEnd == string::npos)
+            RuntimeError("Malformed baseline '%s': %s", path.c_str(), line.c_str());
+        baseline[line.substr(name, nameEnd - name)] = strtod(line.c_str() + median + medianKey.size(), nullptr);
+    }
+
+    if (baseline.empty())
+        RuntimeError("Baseline '%s' contains no benchmarks.", path.c_str());
+    return baseline;
+}
+
+size_t CompareWithBaseline(const vector<BenchmarkResult>& results, const map<string, double>& baseline, double tolerance)
+{
+    fprintf(stdout, "\n%-80s %12s %12s %8s\n", "benchmark", "baseline us", "current us", "change");
+    size_t numRegressions = 0;
+    for (const auto& r : results)
+    {
+        auto b = baseline.find(r.m_name);
+        if (b == baseline.end() || b->second <= 0)
+        {
+            fprintf(stdout, "%-80s %12s %12.3f %8s\n", r.m_name.c_str(), "-", r.m_medianSeconds * 1e6, "new");
+            continue;
+        }
+
+        double change = r.m_medianSeconds / b->second - 1;
+        bool regression = change > tolerance;
+        if (regression)
+            numRegressions++;
+        fprintf(stdout, "%-80s %12.3f %12.3f %+7.1f%%%s\n", r.m_name.c_str(), b->second * 1e6, r.m_medianSeconds * 1e6, change * 100,
+                regression ? "  REGRESSION" : change < -tolerance ? "  improved" : "");
+    }
+
+    fprintf(stdout, "\n%d of %d benchmarks slower than the baseline by more than %.0f%%.\n", (int)numRegressions, (int)results.size(), tolerance * 100);
+    return numRegressions;
+}
+
+}}}}
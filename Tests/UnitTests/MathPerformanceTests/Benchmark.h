@@ -0,0 +1,88 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Benchmark.h -- minimal harness for the micro-benchmarks of the Math and ReaderLib hot paths.
+//
+// Every benchmark is identified by a name that includes its problem size, e.g.
+// "CPUMatrix.MultiplyAndWeightedAdd/float/NN/m=1024,n=256,k=1024", so that results of runs with
+// the same --size can be compared name by name against a baseline file written by an earlier run.
+//
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Benchmark {
+
+enum class ProblemSize
+{
+    Small,
+    Medium,
+    Large
+};
+
+ProblemSize ParseProblemSize(const std::string& s);
+const char* ToString(ProblemSize size);
+
+// picks the parameter for the given problem size
+template <class T>
+T BySize(ProblemSize size, T small, T medium, T large)
+{
+    return size == ProblemSize::Small ? small : size == ProblemSize::Medium ? medium : large;
+}
+
+struct BenchmarkResult
+{
+    std::string m_name;
+    size_t m_iterations;   // number of timed calls
+    double m_medianSeconds; // per call
+    double m_minSeconds;    // per call
+    double m_flops;         // floating point operations per call, 0 if not meaningful
+    double m_bytes;         // bytes read and written per call
+};
+
+class BenchmarkRunner
+{
+public:
+    // filter - comma-separated substrings, a benchmark runs if its name contains one of them (empty: all)
+    // minSeconds - minimum time spent in the timed calls of a single benchmark
+    // listOnly - only print the names of the selected benchmarks
+    BenchmarkRunner(ProblemSize size, const std::string& filter, double minSeconds, bool listOnly);
+
+    ProblemSize Size() const { return m_size; }
+
+    // Returns true if the benchmark is to be run. Benchmarks call this before their (possibly expensive) setup.
+    bool Wants(const std::string& name);
+
+    // Times 'fn': one untimed warm-up call, then samples of a number of calls calibrated on the warm-up,
+    // until at least minSeconds and at least c_minSamples samples are taken. Reports the median and the minimum per call.
+    void Measure(const std::string& name, double flops, double bytes, const std::function<void()>& fn);
+
+    const std::vector<BenchmarkResult>& Results() const { return m_results; }
+
+private:
+    ProblemSize m_size;
+    std::vector<std::string> m_filters;
+    double m_minSeconds;
+    bool m_listOnly;
+    std::vector<BenchmarkResult> m_results;
+};
+
+// benchmark suites, see MathBenchmarks.cpp and ReaderBenchmarks.cpp
+void RunMathBenchmarks(BenchmarkRunner& runner);
+void RunReaderBenchmarks(BenchmarkRunner& runner);
+
+// Writes the results as JSON, one benchmark per line.
+void WriteResults(const std::string& path, ProblemSize size, int numThreads, const std::vector<BenchmarkResult>& results);
+
+// Reads the median time per call of every benchmark from a file written by WriteResults().
+std::map<std::string, double> ReadBaseline(const std::string& path);
+
+// Prints the change of every result against the baseline. Returns the number of benchmarks that are slower
+// than their baseline by more than the relative tolerance.
+size_t CompareWithBaseline(const std::vector<BenchmarkResult>& results, const std::map<std::string, double>& baseline, double tolerance);
+
+}}}}
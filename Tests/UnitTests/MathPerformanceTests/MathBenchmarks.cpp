@@ -0,0 +1,470 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// MathBenchmarks.cpp -- micro-benchmarks of dense and sparse products, random number generation, TensorView operations,
+// convolution and batch normalization engines on the CPU
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "Matrix.h"
+#include "CPUMatrix.h"
+#include "CPUSparseMatrix.h"
+#include "TensorView.h"
+#include "ConvolutionEngine.h"
+#include "BatchNormalizationEngine.h"
+#include <algorithm>
+#include <cstdarg>
+#include <random>
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Benchmark {
+
+static string Format(const char* format, ...)
+{
+    char buffer[1024];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return buffer;
+}
+
+template <class ElemType>
+static const char* TypeName()
+{
+    return sizeof(ElemType) == sizeof(float) ? "float" : "double";
+}
+
+template <class ElemType>
+static vector<ElemType> RandomValues(size_t n, unsigned long seed)
+{
+    mt19937 rng(seed);
+    uniform_real_distribution<float> d(-1, 1);
+    vector<ElemType> values(n);
+    for (auto& v : values)
+        v = d(rng);
+    return values;
+}
+
+template <class ElemType>
+static CPUMatrix<ElemType> RandomCPUMatrix(size_t rows, size_t cols, unsigned long seed)
+{
+    auto values = RandomValues<ElemType>(rows * cols, seed);
+    return CPUMatrix<ElemType>(rows, cols, values.data(), matrixFlagNormal);
+}
+
+template <class ElemType>
+static Matrix<ElemType> RandomMatrix(size_t rows, size_t cols, unsigned long seed)
+{
+    auto values = RandomValues<ElemType>(rows * cols, seed);
+    return Matrix<ElemType>(rows, cols, values.data(), CPUDEVICE, matrixFlagNormal);
+}
+
+// ---------------------------------------------------------------------------
+// CPUMatrix::MultiplyAndWeightedAdd, with the shapes of a fully connected layer:
+// forward (W * X), backward data (W' * G) and weight gradient (G * X', accumulated)
+// ---------------------------------------------------------------------------
+
+template <class ElemType>
+static void GemmBenchmarks(BenchmarkRunner& runner)
+{
+    size_t d = BySize<size_t>(runner.Size(), 256, 1024, 2048);
+    size_t b = BySize<size_t>(runner.Size(), 64, 256, 512);
+
+    struct Case
+    {
+        const char* name;
+        bool transposeA, transposeB;
+        size_t m, n, k;
+        ElemType beta;
+    };
+    const Case cases[] = {
+        { "NN", false, false, d, b, d, 0 },
+        { "TN", true, false, d, b, d, 0 },
+        { "NT", false, true, d, d, b, 1 },
+    };
+
+    for (const auto& c : cases)
+    {
+        string name = Format("CPUMatrix.MultiplyAndWeightedAdd/%s/%s/m=%d,n=%d,k=%d", TypeName<ElemType>(), c.name, (int)c.m, (int)c.n, (int)c.k);
+        if (!runner.Wants(name))
+            continue;
+
+        auto A = c.transposeA ? RandomCPUMatrix<ElemType>(c.k, c.m, 1) : RandomCPUMatrix<ElemType>(c.m, c.k, 1);
+        auto B = c.transposeB ? RandomCPUMatrix<ElemType>(c.n, c.k, 2) : RandomCPUMatrix<ElemType>(c.k, c.n, 2);
+        auto C = RandomCPUMatrix<ElemType>(c.m, c.n, 3);
+
+        double flops = 2.0 * (double)(c.m * c.n * c.k);
+        double bytes = (double)(c.m * c.k + c.k * c.n + (c.beta != 0 ? 2 : 1) * c.m * c.n) * sizeof(ElemType);
+        runner.Measure(name, flops, bytes, [&]()
+        {
+            CPUMatrix<ElemType>::MultiplyAndWeightedAdd(1, A, c.transposeA, B, c.transposeB, c.beta, C);
+        });
+    }
+}
+
+// ---------------------------------------------------------------------------
+// CPUMatrix random number kernels, on the output of a fully connected layer: dropout mask and initialization
+// ---------------------------------------------------------------------------
+
+template <class ElemType>
+static void RandomBenchmarks(BenchmarkRunner& runner)
+{
+    size_t d = BySize<size_t>(runner.Size(), 512, 2048, 4096);
+    size_t b = BySize<size_t>(runner.Size(), 128, 512, 2048);
+    const string shape = Format("%dx%d", (int)d, (int)b);
+    const double bytes = (double)(d * b) * sizeof(ElemType);
+
+    CPURNGHandle rng(CPUDEVICE, 1);
+    CPUMatrix<ElemType> m(d, b);
+
+    string name = Format("CPUMatrix.SetUniformRandomMask/%s/%s", TypeName<ElemType>(), shape.c_str());
+    if (runner.Wants(name))
+        runner.Measure(name, 0, bytes, [&]() { m.SetUniformRandomMask((ElemType)0.5, 2, rng); });
+
+    // forward of dropout with a mask of one bit per element: reads the input, writes the output and the mask
+    name = Format("CPUMatrix.AssignDropoutOf/%s/%s", TypeName<ElemType>(), shape.c_str());
+    if (runner.Wants(name))
+    {
+        auto input = RandomCPUMatrix<ElemType>(d, b, 1);
+        CPUMatrix<ElemType> packedMask(PackedMaskRows<ElemType>(d), b);
+        runner.Measure(name, 0, 2 * bytes + packedMask.GetNumElements() * sizeof(ElemType), [&]() { m.AssignDropoutOf(input, packedMask, (ElemType)0.5, 2, rng); });
+    }
+
+    name = Format("CPUMatrix.SetUniformRandomValue/%s/%s", TypeName<ElemType>(), shape.c_str());
+    if (runner.Wants(name))
+        runner.Measure(name, 0, bytes, [&]() { m.SetUniformRandomValue(rng, -1, 1); });
+
+    name = Format("CPUMatrix.SetGaussianRandomValue/%s/%s", TypeName<ElemType>(), shape.c_str());
+    if (runner.Wants(name))
+        runner.Measure(name, 0, bytes, [&]() { m.SetGaussianRandomValue(rng, 0, 1); });
+}
+
+// ---------------------------------------------------------------------------
+// TensorView elementwise operations, with and without broadcasting, and reductions
+// ---------------------------------------------------------------------------
+
+template <class ElemType>
+static TensorView<ElemType> RandomTensor(const TensorShape& shape, unsigned long seed)
+{
+    auto values = RandomValues<ElemType>(shape.GetNumElements(), seed);
+    auto sob = make_shared<Matrix<ElemType>>(shape.GetNumElements(), 1, values.data(), CPUDEVICE, matrixFlagNormal);
+    return TensorView<ElemType>(sob, shape);
+}
+
+template <class ElemType>
+static void TensorBenchmarks(BenchmarkRunner& runner)
+{
+    size_t d = BySize<size_t>(runner.Size(), 512, 2048, 4096);
+    size_t b = BySize<size_t>(runner.Size(), 128, 512, 2048);
+    size_t imageSize = BySize<size_t>(runner.Size(), 16, 32, 56);
+    size_t channels = BySize<size_t>(runner.Size(), 16, 64, 64);
+    size_t images = BySize<size_t>(runner.Size(), 8, 32, 64);
+
+    const TensorShape layer(d, b);
+    const TensorShape image(imageSize, imageSize, channels, images);
+    const string layerName = Format("%dx%d", (int)d, (int)b);
+    const string imageName = Format("%dx%dx%dx%d", (int)imageSize, (int)imageSize, (int)channels, (int)images);
+    const double layerElements = (double)layer.GetNumElements();
+    const double imageElements = (double)image.GetNumElements();
+    const double e = sizeof(ElemType);
+
+    string name = Format("TensorView.Sigmoid/%s/%s", TypeName<ElemType>(), layerName.c_str());
+    if (runner.Wants(name))
+    {
+        auto a = RandomTensor<ElemType>(layer, 1);
+        auto c = RandomTensor<ElemType>(layer, 2);
+        runner.Measure(name, layerElements, 2 * layerElements * e, [&]() { c.AssignSigmoidOf(a); });
+    }
+
+    name = Format("TensorView.ElementwiseProduct/%s/%s", TypeName<ElemType>(), layerName.c_str());
+    if (runner.Wants(name))
+    {
+        auto a = RandomTensor<ElemType>(layer, 1);
+        auto b2 = RandomTensor<ElemType>(layer, 2);
+        auto c = RandomTensor<ElemType>(layer, 3);
+        runner.Measure(name, layerElements, 3 * layerElements * e, [&]() { c.AssignElementwiseProductOf(a, b2); });
+    }
+
+    name = Format("TensorView.Sum/%s/%s+%d", TypeName<ElemType>(), layerName.c_str(), (int)d);
+    if (runner.Wants(name))
+    {
+        auto a = RandomTensor<ElemType>(layer, 1);
+        auto bias = RandomTensor<ElemType>(TensorShape(d), 2);
+        auto c = RandomTensor<ElemType>(layer, 3);
+        runner.Measure(name, layerElements, (2 * layerElements + (double)d) * e, [&]() { c.AssignSumOf(a, bias); });
+    }
+
+    name = Format("TensorView.Sum/%s/%s+1x1x%d", TypeName<ElemType>(), imageName.c_str(), (int)channels);
+    if (runner.Wants(name))
+    {
+        auto a = RandomTensor<ElemType>(image, 1);
+        auto bias = RandomTensor<ElemType>(TensorShape(1, 1, channels), 2);
+        auto c = RandomTensor<ElemType>(image, 3);
+        runner.Measure(name, imageElements, (2 * imageElements + (double)channels) * e, [&]() { c.AssignSumOf(a, bias); });
+    }
+
+    // bias gradient of a fully connected layer: reduction over the minibatch
+    name = Format("TensorView.Reduce/%s/%s->%d", TypeName<ElemType>(), layerName.c_str(), (int)d);
+    if (runner.Wants(name))
+    {
+        auto a = RandomTensor<ElemType>(layer, 1);
+        auto c = RandomTensor<ElemType>(TensorShape(d), 2);
+        runner.Measure(name, layerElements, (layerElements + (double)d) * e, [&]() { c.AssignCopyOf(a); });
+    }
+
+    // reduction over the rows, e.g. the sum of the outputs of every sample
+    name = Format("TensorView.Reduce/%s/%s->1x%d", TypeName<ElemType>(), layerName.c_str(), (int)b);
+    if (runner.Wants(name))
+    {
+        auto a = RandomTensor<ElemType>(layer, 1);
+        auto c = RandomTensor<ElemType>(TensorShape(1, b), 2);
+        runner.Measure(name, layerElements, (layerElements + (double)b) * e, [&]() { c.AssignCopyOf(a); });
+    }
+
+    // bias gradient of a convolution layer: reduction over everything but the channels
+    name = Format("TensorView.Reduce/%s/%s->1x1x%d", TypeName<ElemType>(), imageName.c_str(), (int)channels);
+    if (runner.Wants(name))
+    {
+        auto a = RandomTensor<ElemType>(image, 1);
+        auto c = RandomTensor<ElemType>(TensorShape(1, 1, channels), 2);
+        runner.Measure(name, imageElements, (imageElements + (double)channels) * e, [&]() { c.AssignCopyOf(a); });
+    }
+}
+
+// ---------------------------------------------------------------------------
+// CPUSparseMatrix products, with the shapes of an embedding of a sparse input:
+// W * X (dense times sparse), X' * E (sparse times dense) and the gradient G * X' into a block column matrix
+// ---------------------------------------------------------------------------
+
+template <class ElemType>
+static CPUSparseMatrix<ElemType> RandomSparseCSC(size_t rows, size_t cols, size_t nnzPerColumn, unsigned long seed)
+{
+    mt19937 rng(seed);
+    vector<CPUSPARSE_INDEX_TYPE> columnStarts(cols + 1);
+    vector<CPUSPARSE_INDEX_TYPE> rowIndices;
+    for (size_t j = 0; j < cols; j++)
+    {
+        columnStarts[j] = (CPUSPARSE_INDEX_TYPE)rowIndices.size();
+        vector<CPUSPARSE_INDEX_TYPE> column;
+        for (size_t i = 0; i < nnzPerColumn; i++)
+            column.push_back((CPUSPARSE_INDEX_TYPE)(rng() % rows));
+        sort(column.begin(), column.end());
+        column.erase(unique(column.begin(), column.end()), column.end());
+        rowIndices.insert(rowIndices.end(), column.begin(), column.end());
+    }
+    columnStarts[cols] = (CPUSPARSE_INDEX_TYPE)rowIndices.size();
+    auto values = RandomValues<ElemType>(rowIndices.size(), seed + 1);
+
+    CPUSparseMatrix<ElemType> m(matrixFormatSparseCSC);
+    m.SetMatrixFromCSCFormat(columnStarts.data(), rowIndices.data(), values.data(), values.size(), rows, cols);
+    return m;
+}
+
+template <class ElemType>
+static void SparseBenchmarks(BenchmarkRunner& runner)
+{
+    size_t vocabulary = BySize<size_t>(runner.Size(), 10000, 50000, 200000);
+    size_t d = BySize<size_t>(runner.Size(), 128, 256, 512);
+    size_t b = BySize<size_t>(runner.Size(), 64, 256, 1024);
+    const size_t nnzPerColumn = 10;
+    const string shape = Format("V=%d,d=%d,b=%d,nnz=%d", (int)vocabulary, (int)d, (int)b, (int)nnzPerColumn);
+    const double e = sizeof(ElemType);
+
+    string name = Format("CPUSparseMatrix.MultiplyAndWeightedAdd/%s/dense*sparse/%s", TypeName<ElemType>(), shape.c_str());
+    if (runner.Wants(name))
+    {
+        auto W = RandomCPUMatrix<ElemType>(d, vocabulary, 1);
+        auto X = RandomSparseCSC<ElemType>(vocabulary, b, nnzPerColumn, 2);
+        CPUMatrix<ElemType> C(d, b);
+        double nnz = (double)X.NzCount();
+        runner.Measure(name, 2 * nnz * (double)d, (nnz * (double)d + (double)(d * b)) * e, [&]()
+        {
+            CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(1, W, false, X, false, 0, C);
+        });
+    }
+
+    name = Format("CPUSparseMatrix.MultiplyAndWeightedAdd/%s/sparse'*dense/%s", TypeName<ElemType>(), shape.c_str());
+    if (runner.Wants(name))
+    {
+        auto X = RandomSparseCSC<ElemType>(vocabulary, b, nnzPerColumn, 2);
+        auto E = RandomCPUMatrix<ElemType>(vocabulary, d, 1);
+        CPUMatrix<ElemType> C(b, d);
+        double nnz = (double)X.NzCount();
+        runner.Measure(name, 2 * nnz * (double)d, (nnz * (double)d + (double)(d * b)) * e, [&]()
+        {
+            CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(1, X, true, E, false, 0, C);
+        });
+    }
+
+    name = Format("CPUSparseMatrix.MultiplyAndAdd/%s/dense*sparse'/%s", TypeName<ElemType>(), shape.c_str());
+    if (runner.Wants(name))
+    {
+        auto G = RandomCPUMatrix<ElemType>(d, b, 1);
+        auto X = RandomSparseCSC<ElemType>(vocabulary, b, nnzPerColumn, 2);
+        CPUSparseMatrix<ElemType> C(matrixFormatSparseBlockCol);
+        double nnz = (double)X.NzCount();
+        runner.Measure(name, 2 * nnz * (double)d, ((double)(d * b) + 2 * nnz * (double)d) * e, [&]()
+        {
+            // the gradient of every minibatch starts from an empty matrix
+            C.Reset();
+            CPUSparseMatrix<ElemType>::MultiplyAndAdd(1, G, false, X, true, C);
+        });
+    }
+}
+
+// ---------------------------------------------------------------------------
+// ConvolutionEngine: forward, backward data and backward kernel of a 3x3 convolution with every engine
+// available on the CPU, and max and average pooling
+// ---------------------------------------------------------------------------
+
+template <class ElemType>
+static void ConvolutionBenchmarks(BenchmarkRunner& runner)
+{
+    size_t imageSize = BySize<size_t>(runner.Size(), 16, 32, 56);
+    size_t channels = BySize<size_t>(runner.Size(), 16, 64, 64);
+    size_t maps = BySize<size_t>(runner.Size(), 32, 64, 64);
+    size_t n = BySize<size_t>(runner.Size(), 8, 32, 64);
+    const double e = sizeof(ElemType);
+
+    auto convolution = make_shared<ConvolveGeometry>(TensorShape(imageSize, imageSize, channels),
+        TensorShape(3, 3, channels), TensorShape(maps), TensorShape(1, 1, channels),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+        TensorShape(0), TensorShape(0));
+    const string convolutionName = Format("%dx%dx%d,3x3,maps=%d,n=%d", (int)imageSize, (int)imageSize, (int)channels, (int)maps, (int)n);
+
+    struct Engine
+    {
+        const char* name;
+        ConvolutionEngineKind kind;
+        ImageLayoutKind layout;
+    };
+    const Engine engines[] = {
+        { "Reference", ConvolutionEngineKind::Reference, ImageLayoutKind::CHW },
+        { "Gemm", ConvolutionEngineKind::Gemm, ImageLayoutKind::CHW },
+        { "Legacy", ConvolutionEngineKind::Legacy, ImageLayoutKind::HWC },
+    };
+
+    size_t inRows = convolution->InputShape().GetNumElements();
+    size_t outRows = convolution->OutputShape().GetNumElements();
+    size_t kernelCols = convolution->KernelShape().GetNumElements();
+    double flops = 2.0 * (double)(outRows * kernelCols * n);
+    double inBytes = (double)(inRows * n) * e, outBytes = (double)(outRows * n) * e, kernelBytes = (double)(maps * kernelCols) * e;
+
+    for (const auto& engine : engines)
+    {
+        string forward = Format("ConvolutionEngine.Forward/%s/%s/%s", TypeName<ElemType>(), engine.name, convolutionName.c_str());
+        string backwardData = Format("ConvolutionEngine.BackwardData/%s/%s/%s", TypeName<ElemType>(), engine.name, convolutionName.c_str());
+        string backwardKernel = Format("ConvolutionEngine.BackwardKernel/%s/%s/%s", TypeName<ElemType>(), engine.name, convolutionName.c_str());
+        bool wantsForward = runner.Wants(forward), wantsBackwardData = runner.Wants(backwardData), wantsBackwardKernel = runner.Wants(backwardKernel);
+        if (!wantsForward && !wantsBackwardData && !wantsBackwardKernel)
+            continue;
+
+        auto eng = ConvolutionEngine<ElemType>::Create(convolution, CPUDEVICE, engine.layout, 0, PoolKind::None, engine.kind);
+        auto in = RandomMatrix<ElemType>(inRows, n, 1);
+        auto kernel = RandomMatrix<ElemType>(maps, kernelCols, 2);
+        auto out = RandomMatrix<ElemType>(outRows, n, 3);
+        Matrix<ElemType> inGrad(inRows, n, CPUDEVICE);
+        Matrix<ElemType> kernelGrad(maps, kernelCols, CPUDEVICE);
+        Matrix<ElemType> workspace(CPUDEVICE);
+
+        if (wantsForward)
+            runner.Measure(forward, flops, inBytes + kernelBytes + outBytes, [&]() { eng->Forward(in, kernel, out, workspace); });
+        if (wantsBackwardData)
+            runner.Measure(backwardData, flops, outBytes + kernelBytes + inBytes, [&]() { eng->BackwardData(out, kernel, inGrad, false, workspace); });
+        if (wantsBackwardKernel)
+            runner.Measure(backwardKernel, flops, outBytes + inBytes + kernelBytes, [&]() { eng->BackwardKernel(out, in, kernelGrad, false, false, workspace); });
+    }
+
+    auto pooling = make_shared<ConvolveGeometry>(TensorShape(imageSize, imageSize, channels),
+        TensorShape(2, 2, 1), TensorShape(1), TensorShape(2, 2, 1),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{false},
+        TensorShape(0), TensorShape(0));
+    const string poolingName = Format("%dx%dx%d,2x2/2,n=%d", (int)imageSize, (int)imageSize, (int)channels, (int)n);
+    inRows = pooling->InputShape().GetNumElements();
+    outRows = pooling->OutputShape().GetNumElements();
+
+    struct Pooling
+    {
+        const char* name;
+        PoolKind kind;
+    };
+    const Pooling poolings[] = { { "Max", PoolKind::Max }, { "Average", PoolKind::Average } };
+
+    for (const auto& engine : { engines[0], engines[2] })
+    {
+        for (const auto& p : poolings)
+        {
+            string forward = Format("ConvolutionEngine.ForwardPooling/%s/%s/%s/%s", TypeName<ElemType>(), engine.name, p.name, poolingName.c_str());
+            string backward = Format("ConvolutionEngine.BackwardPooling/%s/%s/%s/%s", TypeName<ElemType>(), engine.name, p.name, poolingName.c_str());
+            bool wantsForward = runner.Wants(forward), wantsBackward = runner.Wants(backward);
+            if (!wantsForward && !wantsBackward)
+                continue;
+
+            auto eng = ConvolutionEngine<ElemType>::Create(pooling, CPUDEVICE, engine.layout, 0, p.kind, engine.kind);
+            auto in = RandomMatrix<ElemType>(inRows, n, 1);
+            auto out = RandomMatrix<ElemType>(outRows, n, 2);
+            auto outGrad = RandomMatrix<ElemType>(outRows, n, 3);
+            Matrix<ElemType> inGrad(inRows, n, CPUDEVICE);
+            eng->ForwardPooling(in, out);
+
+            if (wantsForward)
+                runner.Measure(forward, (double)(inRows * n), (double)((inRows + outRows) * n) * e, [&]() { eng->ForwardPooling(in, out); });
+            if (wantsBackward)
+                runner.Measure(backward, (double)(inRows * n), (double)((2 * inRows + 2 * outRows) * n) * e, [&]()
+                {
+                    inGrad.SetValue(0);
+                    eng->BackwardPooling(out, outGrad, in, inGrad, true);
+                });
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// BatchNormEngine, spatial, on the output of a convolution layer: inference forward
+// (training on CPU is not implemented, see CPUMatrix::BatchNormalizationForward)
+// ---------------------------------------------------------------------------
+
+template <class ElemType>
+static void BatchNormBenchmarks(BenchmarkRunner& runner)
+{
+    size_t imageSize = BySize<size_t>(runner.Size(), 16, 32, 56);
+    size_t channels = BySize<size_t>(runner.Size(), 16, 64, 64);
+    size_t n = BySize<size_t>(runner.Size(), 8, 32, 64);
+    const TensorShape inOutT(imageSize, imageSize, channels);
+    string name = Format("BatchNormEngine.Forward/%s/inference/%dx%dx%d,n=%d", TypeName<ElemType>(), (int)imageSize, (int)imageSize, (int)channels, (int)n);
+    if (!runner.Wants(name))
+        return;
+
+    auto eng = BatchNormEngine<ElemType>::Create(CPUDEVICE, inOutT, true, ImageLayoutKind::CHW, BatchNormEngineKind::Cntk);
+    size_t rows = inOutT.GetNumElements();
+    auto in = RandomMatrix<ElemType>(rows, n, 1);
+    auto scale = RandomMatrix<ElemType>(channels, 1, 3);
+    auto bias = RandomMatrix<ElemType>(channels, 1, 4);
+    auto runMean = RandomMatrix<ElemType>(channels, 1, 5);
+    Matrix<ElemType> runVariance(channels, 1, CPUDEVICE);
+    Matrix<ElemType> out(rows, n, CPUDEVICE);
+    Matrix<ElemType> saveMean(CPUDEVICE), saveInvStdDev(CPUDEVICE);
+    runVariance.SetValue(1);
+
+    double elements = (double)(rows * n);
+    runner.Measure(name, 2 * elements, 2 * elements * sizeof(ElemType), [&]()
+    {
+        eng->Forward(in, scale, bias, true, 0, 1, runMean, runVariance, out, 1e-5, saveMean, saveInvStdDev);
+    });
+}
+
+void RunMathBenchmarks(BenchmarkRunner& runner)
+{
+    GemmBenchmarks<float>(runner);
+    GemmBenchmarks<double>(runner);
+    RandomBenchmarks<float>(runner);
+    TensorBenchmarks<float>(runner);
+    SparseBenchmarks<float>(runner);
+    ConvolutionBenchmarks<float>(runner);
+    BatchNormBenchmarks<float>(runner);
+}
+
+}}}}
@@ -0,0 +1,310 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// ReaderBenchmarks.cpp -- micro-benchmarks of the text and binary deserializers and of the sequence packer
+//
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "Config.h"
+#include "CorpusDescriptor.h"
+#include "TextConfigHelper.h"
+#include "TextParser.h"
+#include "BinaryConfigHelper.h"
+#include "BinaryChunkDeserializer.h"
+#include "BinaryOutputFile.h"
+#include "SequencePacker.h"
+#include "HeapMemoryProvider.h"
+#include <cstdio>
+#include <random>
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Benchmark {
+
+using namespace ::CNTK;
+
+// Synthetic corpus: sequences of 1 to 2 * c_averageLength - 1 samples, every sample with a dense feature vector
+// and a sparse label vector with c_labelsPerSample non-zero values.
+// The files of the deserializer benchmarks are written to the working directory and removed afterwards.
+static const size_t c_averageLength = 10;
+static const size_t c_featureDimension = 40;
+static const size_t c_labelDimension = 10000;
+static const size_t c_labelsPerSample = 3;
+
+struct Corpus
+{
+    Corpus(size_t numSequences)
+    {
+        mt19937 rng(17);
+        uniform_real_distribution<float> d(-1, 1);
+        for (size_t i = 0; i < numSequences; i++)
+        {
+            size_t length = 1 + rng() % (2 * c_averageLength - 1);
+            m_lengths.push_back(length);
+            for (size_t j = 0; j < length * c_featureDimension; j++)
+                m_features.push_back(d(rng));
+            // distinct and ascending within a sample: the j-th label is drawn from the j-th range of the dimension
+            const size_t range = c_labelDimension / c_labelsPerSample;
+            for (size_t t = 0; t < length; t++)
+                for (size_t j = 0; j < c_labelsPerSample; j++)
+                    m_labels.push_back((SparseIndexType)(j * range + rng() % range));
+        }
+    }
+
+    size_t NumSamples() const
+    {
+        return m_features.size() / c_featureDimension;
+    }
+
+    vector<size_t> m_lengths;
+    vector<float> m_features;
+    vector<SparseIndexType> m_labels;
+};
+
+static size_t FileSize(const string& path)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+        RuntimeError("Cannot open '%s'.", path.c_str());
+    fseek(f, 0, SEEK_END);
+    size_t size = (size_t)ftell(f);
+    fclose(f);
+    return size;
+}
+
+// Reads every sequence of every chunk, as the randomizers do over a sweep.
+static void ReadAllSequences(DataDeserializer& deserializer)
+{
+    vector<SequenceInfo> sequences;
+    vector<SequenceDataPtr> data;
+    for (const auto& chunkInfo : deserializer.ChunkInfos())
+    {
+        auto chunk = deserializer.GetChunk(chunkInfo.m_id);
+        sequences.clear();
+        deserializer.SequenceInfosForChunk(chunkInfo.m_id, sequences);
+        for (const auto& sequence : sequences)
+        {
+            data.clear();
+            chunk->GetSequence(sequence.m_indexInChunk, data);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// TextParser (CNTK text format): indexing of the file, and parsing of all chunks
+// ---------------------------------------------------------------------------
+
+static void TextFormatBenchmarks(BenchmarkRunner& runner, size_t numSequences)
+{
+    string index = "TextParser.Index/float/sequences=" + to_string(numSequences);
+    string read = "TextParser.Read/float/sequences=" + to_string(numSequences);
+    bool wantsIndex = runner.Wants(index), wantsRead = runner.Wants(read);
+    if (!wantsIndex && !wantsRead)
+        return;
+
+    const string path = "BenchmarkData.ctf";
+    Corpus corpus(numSequences);
+    {
+        FILE* f = fopen(path.c_str(), "w");
+        if (!f)
+            RuntimeError("Cannot open '%s' for writing.", path.c_str());
+        const float* features = corpus.m_features.data();
+        const SparseIndexType* labels = corpus.m_labels.data();
+        for (size_t i = 0; i < numSequences; i++)
+        {
+            for (size_t t = 0; t < corpus.m_lengths[i]; t++)
+            {
+                fprintf(f, "%d |x", (int)i);
+                for (size_t j = 0; j < c_featureDimension; j++)
+                    fprintf(f, " %.5f", *features++);
+                fprintf(f, " |y");
+                for (size_t j = 0; j < c_labelsPerSample; j++)
+                    fprintf(f, " %d:1", (int)*labels++);
+                fprintf(f, "\n");
+            }
+        }
+        fclose(f);
+    }
+    double bytes = (double)FileSize(path);
+
+    ConfigParameters config;
+    config.Parse("file=" + path + ";chunkSizeInBytes=1048576;traceLevel=0;"
+                 "input=[x=[dim=" + to_string(c_featureDimension) + ";format=dense];y=[dim=" + to_string(c_labelDimension) + ";format=sparse]]");
+    TextConfigHelper helper(config);
+    auto corpusDescriptor = make_shared<CorpusDescriptor>(true);
+
+    if (wantsIndex)
+        runner.Measure(index, 0, bytes, [&]() { TextParser<float> parser(corpusDescriptor, helper, true); });
+    if (wantsRead)
+    {
+        TextParser<float> parser(corpusDescriptor, helper, true);
+        runner.Measure(read, 0, bytes, [&]() { ReadAllSequences(parser); });
+    }
+
+    remove(path.c_str());
+}
+
+// ---------------------------------------------------------------------------
+// BinaryChunkDeserializer (CNTK binary format, written with BinaryOutputFile): reading of the header and of all chunks
+// ---------------------------------------------------------------------------
+
+static void BinaryFormatBenchmarks(BenchmarkRunner& runner, size_t numSequences)
+{
+    string index = "BinaryChunkDeserializer.Index/float/sequences=" + to_string(numSequences);
+    string read = "BinaryChunkDeserializer.Read/float/sequences=" + to_string(numSequences);
+    bool wantsIndex = runner.Wants(index), wantsRead = runner.Wants(read);
+    if (!wantsIndex && !wantsRead)
+        return;
+
+    const string path = "BenchmarkData.bin";
+    Corpus corpus(numSequences);
+    {
+        BinaryOutputFile file(wstring(path.begin(), path.end()), L"x", c_featureDimension, BinaryOutputFile::ElementType::Float, 1024 * 1024);
+        const float* features = corpus.m_features.data();
+        for (size_t i = 0; i < numSequences; i++)
+        {
+            file.AddSequence(to_string(i), features, corpus.m_lengths[i], c_featureDimension);
+            features += corpus.m_lengths[i] * c_featureDimension;
+        }
+        file.Close();
+    }
+    double bytes = (double)FileSize(path);
+
+    ConfigParameters config;
+    config.Parse("file=" + path + ";traceLevel=0");
+    BinaryConfigHelper helper(config);
+
+    // only the header and the chunk table are read when the deserializer is constructed
+    if (wantsIndex)
+        runner.Measure(index, 0, 0, [&]() { BinaryChunkDeserializer deserializer(helper); });
+    if (wantsRead)
+    {
+        BinaryChunkDeserializer deserializer(helper);
+        runner.Measure(read, 0, bytes, [&]() { ReadAllSequences(deserializer); });
+    }
+
+    remove(path.c_str());
+    remove((path + ".keys").c_str());
+}
+
+// ---------------------------------------------------------------------------
+// SequencePacker: packing of the whole corpus into a single minibatch with a dense and a sparse stream
+// ---------------------------------------------------------------------------
+
+struct BenchmarkDenseSequenceData : DenseSequenceData
+{
+    BenchmarkDenseSequenceData(const NDShape& shape, const float* data) : m_sampleShape(shape), m_data(data) {}
+    const void* GetDataBuffer() override { return m_data; }
+    const NDShape& GetSampleShape() override { return m_sampleShape; }
+
+    NDShape m_sampleShape;
+    const float* m_data;
+};
+
+struct BenchmarkSparseSequenceData : SparseSequenceData
+{
+    BenchmarkSparseSequenceData(const NDShape& shape) : m_sampleShape(shape) {}
+    const void* GetDataBuffer() override { return m_values.data(); }
+    const NDShape& GetSampleShape() override { return m_sampleShape; }
+
+    NDShape m_sampleShape;
+    vector<float> m_values;
+};
+
+// Returns all sequences of the corpus on every call.
+class CorpusSequenceEnumerator : public SequenceEnumerator
+{
+public:
+    CorpusSequenceEnumerator(const Corpus& corpus)
+    {
+        NDShape featureShape({ c_featureDimension });
+        NDShape labelShape({ c_labelDimension });
+        m_streams.push_back(CreateStream(L"x", StorageFormat::Dense, featureShape));
+        m_streams.push_back(CreateStream(L"y", StorageFormat::SparseCSC, labelShape));
+        m_sequences.m_data.resize(2);
+
+        const float* features = corpus.m_features.data();
+        const SparseIndexType* labels = corpus.m_labels.data();
+        for (size_t i = 0; i < corpus.m_lengths.size(); i++)
+        {
+            unsigned int length = (unsigned int)corpus.m_lengths[i];
+
+            auto dense = make_shared<BenchmarkDenseSequenceData>(featureShape, features);
+            dense->m_numberOfSamples = length;
+            dense->m_elementType = DataType::Float;
+            dense->m_key.m_sequence = i;
+            m_sequences.m_data[0].push_back(dense);
+            features += length * c_featureDimension;
+
+            auto sparse = make_shared<BenchmarkSparseSequenceData>(labelShape);
+            sparse->m_numberOfSamples = length;
+            sparse->m_elementType = DataType::Float;
+            sparse->m_key.m_sequence = i;
+            sparse->m_nnzCounts.assign(length, (SparseIndexType)c_labelsPerSample);
+            sparse->m_totalNnzCount = (SparseIndexType)(length * c_labelsPerSample);
+            sparse->m_values.assign(length * c_labelsPerSample, 1.0f);
+            sparse->m_indices = const_cast<SparseIndexType*>(labels);
+            m_sequences.m_data[1].push_back(sparse);
+            labels += length * c_labelsPerSample;
+        }
+    }
+
+    vector<StreamInformation> GetStreamDescriptions() const override { return m_streams; }
+    void StartEpoch(const EpochConfiguration&) override {}
+    void SetConfiguration(const ReaderConfiguration&) override {}
+    void SetState(const map<wstring, size_t>&) override {}
+    map<wstring, size_t> GetState() override { return map<wstring, size_t>(); }
+    Sequences GetNextSequences(size_t, size_t) override { return m_sequences; }
+
+private:
+    StreamInformation CreateStream(const wstring& name, StorageFormat format, const NDShape& shape)
+    {
+        StreamInformation stream;
+        stream.m_id = m_streams.size();
+        stream.m_name = name;
+        stream.m_storageFormat = format;
+        stream.m_elementType = DataType::Float;
+        stream.m_sampleLayout = shape;
+        return stream;
+    }
+
+    vector<StreamInformation> m_streams;
+    Sequences m_sequences;
+};
+
+static void SequencePackerBenchmarks(BenchmarkRunner& runner, size_t numSequences)
+{
+    string name = "SequencePacker.ReadMinibatch/float/sequences=" + to_string(numSequences);
+    if (!runner.Wants(name))
+        return;
+
+    Corpus corpus(numSequences);
+    auto enumerator = make_shared<CorpusSequenceEnumerator>(corpus);
+    auto streams = enumerator->GetStreamDescriptions();
+    auto packer = make_shared<SequencePacker>(enumerator, streams);
+
+    EpochConfiguration config;
+    config.m_minibatchSizeInSamples = SIZE_MAX;
+    config.m_numberOfWorkers = 1;
+    config.m_workerRank = 0;
+    config.m_totalEpochSizeInSamples = SIZE_MAX;
+    config.m_epochIndex = 0;
+    vector<MemoryProviderPtr> providers(streams.size(), make_shared<HeapMemoryProvider>());
+    packer->SetConfiguration(config, providers);
+
+    // source data read, packed data written; padding of the layout is not counted
+    double samples = (double)corpus.NumSamples();
+    double bytes = 2 * samples * (c_featureDimension * sizeof(float) + c_labelsPerSample * (sizeof(float) + sizeof(SparseIndexType)));
+    runner.Measure(name, 0, bytes, [&]() { packer->ReadMinibatch(); });
+}
+
+void RunReaderBenchmarks(BenchmarkRunner& runner)
+{
+    size_t numSequences = BySize<size_t>(runner.Size(), 1000, 5000, 20000);
+    TextFormatBenchmarks(runner, numSequences);
+    BinaryFormatBenchmarks(runner, numSequences);
+    SequencePackerBenchmarks(runner, numSequences);
+}
+
+}}}}
@@ -0,0 +1,143 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include "../../../Source/Math/CPUCachingMemAllocator.h"
+#include "../../../Source/Math/CPUMatrix.h"
+#include "../../../Source/Math/CPUSparseMatrix.h"
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// Restores the cache limit of the pool shared by all tests.
+class CPUCachingMemAllocatorFixture
+{
+public:
+    CPUCachingMemAllocatorFixture() : m_pool(CPUCachingMemAllocator::Instance()), m_maxCachedBytes(m_pool.GetMaxCachedBytes())
+    {
+        m_pool.ReleaseCachedMemory();
+        m_pool.ResetStatistics();
+    }
+
+    ~CPUCachingMemAllocatorFixture()
+    {
+        m_pool.SetMaxCachedBytes(m_maxCachedBytes);
+    }
+
+    CPUCachingMemAllocator& m_pool;
+    size_t m_maxCachedBytes;
+};
+
+BOOST_AUTO_TEST_SUITE(CPUCachingMemAllocatorSuite)
+
+BOOST_FIXTURE_TEST_CASE(CPUCachingMemAllocatorAlignment, CPUCachingMemAllocatorFixture)
+{
+    BOOST_CHECK(m_pool.Malloc(0) == nullptr);
+
+    for (size_t size : { 1, 63, 64, 65, 1000, 1024, 1025, 2048, 2049, 100000, 3000000 })
+    {
+        auto p = static_cast<unsigned char*>(m_pool.Malloc(size, /*zeroFill=*/true));
+        BOOST_REQUIRE(p != nullptr);
+        BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(p) % CPUCachingMemAllocator::Alignment, 0);
+        for (size_t i = 0; i < size; i++)
+            BOOST_REQUIRE_EQUAL(p[i], 0);
+        memset(p, 0xff, size);
+        m_pool.Free(p);
+    }
+
+    // A cached block is zeroed again if requested.
+    auto p = static_cast<unsigned char*>(m_pool.Malloc(3000000, /*zeroFill=*/true));
+    for (size_t i = 0; i < 3000000; i++)
+        BOOST_REQUIRE_EQUAL(p[i], 0);
+    m_pool.Free(p);
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUCachingMemAllocatorReuse, CPUCachingMemAllocatorFixture)
+{
+    void* p = m_pool.Malloc(1000);
+    m_pool.Free(p);
+
+    // Same size class.
+    void* q = m_pool.Malloc(970);
+    BOOST_CHECK_EQUAL(p, q);
+
+    // Different size class.
+    void* r = m_pool.Malloc(5000);
+    BOOST_CHECK_NE(p, r);
+
+    auto statistics = m_pool.GetStatistics();
+    BOOST_CHECK_EQUAL(statistics.m_numberOfAllocations, 3);
+    BOOST_CHECK_EQUAL(statistics.m_numberOfCacheHits, 1);
+    BOOST_CHECK_EQUAL(statistics.m_requestedBytesInUse, 970 + 5000);
+    BOOST_CHECK_EQUAL(statistics.m_bytesInUse, 1024 + 5120);
+    BOOST_CHECK_EQUAL(statistics.m_cachedBytes, 0);
+    BOOST_CHECK_CLOSE(statistics.HitRate(), 1.0 / 3, 1e-6);
+    BOOST_CHECK_CLOSE(statistics.Fragmentation(), 1.0 - (970.0 + 5000) / (1024 + 5120), 1e-6);
+
+    m_pool.Free(q);
+    m_pool.Free(r);
+    statistics = m_pool.GetStatistics();
+    BOOST_CHECK_EQUAL(statistics.m_bytesInUse, 0);
+    BOOST_CHECK_EQUAL(statistics.m_cachedBytes, 1024 + 5120);
+    BOOST_CHECK_EQUAL(statistics.Fragmentation(), 1.0);
+
+    m_pool.ReleaseCachedMemory();
+    BOOST_CHECK_EQUAL(m_pool.GetStatistics().m_cachedBytes, 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUCachingMemAllocatorCacheLimit, CPUCachingMemAllocatorFixture)
+{
+    m_pool.SetMaxCachedBytes(4096);
+
+    void* small = m_pool.Malloc(4000);
+    void* big = m_pool.Malloc(10000);
+    m_pool.Free(small);
+    m_pool.Free(big); // does not fit into the cache any more.
+    BOOST_CHECK_EQUAL(m_pool.GetStatistics().m_cachedBytes, 4096);
+
+    m_pool.SetMaxCachedBytes(0);
+    BOOST_CHECK_EQUAL(m_pool.GetStatistics().m_cachedBytes, 0);
+
+    m_pool.Free(m_pool.Malloc(100));
+    BOOST_CHECK_EQUAL(m_pool.GetStatistics().m_cachedBytes, 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUCachingMemAllocatorMatrixResize, CPUCachingMemAllocatorFixture)
+{
+    // Minibatches of variable length sequences: the number of columns changes on every step.
+    const size_t numRows = 512;
+    const size_t numSteps = 2000;
+    std::mt19937 rng(1);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t step = 0; step < numSteps; step++)
+    {
+        size_t numCols = 1 + rng() % 256;
+        CPUSingleMatrix a(numRows, numCols);
+        CPUSingleMatrix b;
+        b.Resize(numRows, numCols);
+        b.SetValue(1);
+        a += b;
+        BOOST_REQUIRE_EQUAL(a(numRows - 1, numCols - 1), 1);
+
+        CPUSingleSparseMatrix s(MatrixFormat::matrixFormatSparseCSC, numRows, numCols, numCols);
+        BOOST_REQUIRE_EQUAL(s.NzCount(), 0);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    auto statistics = m_pool.GetStatistics();
+    BOOST_CHECK_EQUAL(statistics.m_bytesInUse, 0);
+    BOOST_CHECK_GT(statistics.HitRate(), 0.9);
+    fprintf(stderr, "CPUCachingMemAllocator: %d matrix steps in %.3f ms, %d allocations, hit rate %.1f%%, %.1f MB cached\n",
+            (int)numSteps, std::chrono::duration<double, std::milli>(end - start).count(), (int)statistics.m_numberOfAllocations,
+            statistics.HitRate() * 100, statistics.m_cachedBytes / (1024.0 * 1024.0));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
+} } }
@@ -4,6 +4,9 @@
 //
 #include "stdafx.h"
 #include "../../../Source/Math/CPUMatrix.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -583,6 +586,107 @@ BOOST_FIXTURE_TEST_CASE(CPUMatrixSetValues, RandomSeedFixture)
     BOOST_CHECK_CLOSE(m1.SumOfElements(), static_cast<double>(m1.GetNumElements()), 1);
 }
 
+BOOST_FIXTURE_TEST_CASE(CPURNGHandlePhiloxKnownAnswers, RandomSeedFixture)
+{
+    // test vectors of the reference implementation of Philox4x32-10 (Random123)
+    uint32_t counter0[4] = { 0, 0, 0, 0 };
+    uint32_t key0[2] = { 0, 0 };
+    CPURNGHandle::Philox(counter0, key0);
+    BOOST_CHECK_EQUAL(counter0[0], 0x6627e8d5u);
+    BOOST_CHECK_EQUAL(counter0[1], 0xe169c58du);
+    BOOST_CHECK_EQUAL(counter0[2], 0xbc57ac4cu);
+    BOOST_CHECK_EQUAL(counter0[3], 0x9b00dbd8u);
+
+    uint32_t counter1[4] = { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 };
+    uint32_t key1[2] = { 0xa4093822, 0x299f31d0 };
+    CPURNGHandle::Philox(counter1, key1);
+    BOOST_CHECK_EQUAL(counter1[0], 0xd16cfe09u);
+    BOOST_CHECK_EQUAL(counter1[1], 0x94fdccebu);
+    BOOST_CHECK_EQUAL(counter1[2], 0x5001e420u);
+    BOOST_CHECK_EQUAL(counter1[3], 0x24126ea1u);
+}
+
+BOOST_FIXTURE_TEST_CASE(CPURNGHandleStreamConsistency, RandomSeedFixture)
+{
+    const uint64_t seed = 0x123456789abcdefull;
+    const size_t n = 1000;
+
+    CPURNGHandle serial(CPUDEVICE, seed);
+    std::vector<uint32_t> expected(n);
+    for (size_t i = 0; i < n; i++)
+        expected[i] = serial();
+    BOOST_CHECK_EQUAL(serial.Offset(), n);
+
+    // any range of the stream, at any alignment
+    CPURNGHandle rng(CPUDEVICE, seed);
+    for (size_t offset : std::vector<size_t>{ 0, 1, 3, 4, 257 })
+    {
+        std::vector<uint32_t> words(n - offset);
+        rng.Generate(offset, words.size(), words.data());
+        BOOST_CHECK(std::equal(words.begin(), words.end(), expected.begin() + offset));
+    }
+
+    // a handle created at an offset continues the stream
+    CPURNGHandle resumed(CPUDEVICE, seed, 777);
+    for (size_t i = 777; i < n; i++)
+        BOOST_CHECK_EQUAL(resumed(), expected[i]);
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixRandomValuesIndependentOfThreads, RandomSeedFixture)
+{
+    const uint64_t seed = 42;
+    const size_t rows = 301, cols = 97; // odd number of elements, several batches of the stream
+    const int numThreads = SMatrix::GetMaxNumThreads();
+
+    // not through SetNumThreads(), which limits the number of threads to the number of cores
+    auto generate = [&](int threads, SMatrix& mask, SMatrix& uniform, SMatrix& gaussian, SMatrix& gumbel)
+    {
+#ifdef _OPENMP
+        omp_set_num_threads(threads);
+#endif
+        CPURNGHandle rng(CPUDEVICE, seed);
+        mask.Resize(rows, cols);
+        mask.SetUniformRandomMask(0.3f, 2.0f, rng);
+        uniform.Resize(rows, cols);
+        uniform.SetUniformRandomValue(rng, -1.0f, 1.0f);
+        gaussian.Resize(rows, cols);
+        gaussian.SetGaussianRandomValue(rng, 1.0f, 2.0f);
+        gumbel.Resize(rows, cols);
+        gumbel.SetGumbelRandomValue(rng, 0.0f, 1.0f);
+        return rng.Offset();
+    };
+
+    SMatrix mask1, uniform1, gaussian1, gumbel1, mask4, uniform4, gaussian4, gumbel4;
+    uint64_t offset1 = generate(1, mask1, uniform1, gaussian1, gumbel1);
+    uint64_t offset4 = generate(4, mask4, uniform4, gaussian4, gumbel4);
+#ifdef _OPENMP
+    omp_set_num_threads(numThreads);
+#endif
+
+    // same number of words consumed as accounted for by the nodes (ComputationNetworkLib/TrainingNodes.cpp)
+    const size_t n = rows * cols;
+    BOOST_CHECK_EQUAL(offset1, 3 * n + AsMultipleOf(n, 2));
+    BOOST_CHECK_EQUAL(offset4, offset1);
+    BOOST_CHECK(mask1.IsEqualTo(mask4, 0));
+    BOOST_CHECK(uniform1.IsEqualTo(uniform4, 0));
+    BOOST_CHECK(gaussian1.IsEqualTo(gaussian4, 0));
+    BOOST_CHECK(gumbel1.IsEqualTo(gumbel4, 0));
+
+    // a mask generated from a handle that resumes at the offset of the uniform values equals the uniform values thresholded
+    CPURNGHandle resumed(CPUDEVICE, seed, n);
+    SMatrix mask(rows, cols);
+    mask.SetUniformRandomMask(0.5f, 1.0f, resumed);
+    size_t numMasked = 0;
+    foreach_coord (i, j, mask)
+    {
+        BOOST_CHECK_EQUAL(mask(i, j), uniform1(i, j) <= 0 ? 0.0f : 1.0f);
+        BOOST_CHECK(std::isfinite(gaussian1(i, j)) && std::isfinite(gumbel1(i, j)));
+        numMasked += mask1(i, j) == 0;
+    }
+    BOOST_CHECK_CLOSE((double)numMasked / n, 0.3, 5);
+    BOOST_CHECK_CLOSE(gaussian1.SumOfElements() / n, 1.0, 5);
+}
+
 BOOST_FIXTURE_TEST_CASE(CPUMatrixTranspose, RandomSeedFixture)
 {
     DMatrix m0(2, 3);
@@ -0,0 +1,85 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include <algorithm>
+#include <omp.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "../../../Source/Math/CPUCachingMemAllocator.h"
+#include "../../../Source/Math/CPUMatrix.h"
+#include "../../../Source/Math/CPUNumaBinding.h"
+#include "numahelpers.h"
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(CPUNumaBindingSuite)
+
+BOOST_AUTO_TEST_CASE(CPUNumaBindingParse)
+{
+    auto processors = msra::numa::parseprocessorlist("0-3,8,10-11\n");
+    std::vector<int> expected = { 0, 1, 2, 3, 8, 10, 11 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(processors.begin(), processors.end(), expected.begin(), expected.end());
+    BOOST_CHECK(msra::numa::parseprocessorlist("").empty());
+    BOOST_CHECK_THROW(msra::numa::parseprocessorlist("3-1"), std::invalid_argument);
+    BOOST_CHECK_THROW(msra::numa::parseprocessorlist("a"), std::invalid_argument);
+
+    BOOST_CHECK(ParseNumaBindingMode(L"none") == NumaBindingMode::None);
+    BOOST_CHECK(ParseNumaBindingMode(L"all") == NumaBindingMode::AllNodes);
+    BOOST_CHECK(ParseNumaBindingMode(L"local") == NumaBindingMode::LocalNode);
+    BOOST_CHECK_THROW(ParseNumaBindingMode(L"socket"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(CPUNumaBindingAllNodes)
+{
+    const auto& topology = CPUNumaBinding::Topology();
+    BOOST_REQUIRE(!topology.empty());
+
+    int numThreads = CPUNumaBinding::Bind(NumaBindingMode::AllNodes);
+    BOOST_REQUIRE_GT(numThreads, 0);
+    BOOST_CHECK(CPUNumaBinding::Mode() == NumaBindingMode::AllNodes);
+    BOOST_CHECK(CPUCachingMemAllocator::Instance().GetParallelFirstTouch());
+
+    const auto& nodesOfThreads = CPUNumaBinding::NodesOfThreads();
+    BOOST_REQUIRE_EQUAL(nodesOfThreads.size(), numThreads);
+    BOOST_CHECK(std::is_sorted(nodesOfThreads.begin(), nodesOfThreads.end()));
+
+#ifndef _WIN32
+    // Every thread may only run on the processors of its node.
+    std::vector<int> isOnItsNode(numThreads, 0);
+#pragma omp parallel num_threads(numThreads)
+    {
+        int t = omp_get_thread_num();
+        cpu_set_t affinity;
+        CPU_ZERO(&affinity);
+        pthread_getaffinity_np(pthread_self(), sizeof(affinity), &affinity);
+        const auto& processors = topology[nodesOfThreads[t]];
+        int count = 0;
+        for (auto p : processors)
+            count += CPU_ISSET(p, &affinity) ? 1 : 0;
+        isOnItsNode[t] = count == CPU_COUNT(&affinity) && count == (int)processors.size();
+    }
+    for (int t = 0; t < numThreads; t++)
+        BOOST_CHECK_MESSAGE(isOnItsNode[t], "thread " << t << " is not bound to node " << nodesOfThreads[t]);
+#endif
+
+    // Matrices allocated while bound work as usual.
+    CPUSingleMatrix a(1024, 1024);
+    BOOST_CHECK_EQUAL(a(1023, 1023), 0);
+    a.SetValue(2);
+    BOOST_CHECK_EQUAL(a.SumOfElements(), 2 * 1024 * 1024);
+
+    CPUNumaBinding::Unbind();
+    BOOST_CHECK(CPUNumaBinding::Mode() == NumaBindingMode::None);
+    BOOST_CHECK(!CPUCachingMemAllocator::Instance().GetParallelFirstTouch());
+    BOOST_CHECK(CPUNumaBinding::NodesOfThreads().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+}
+} } }
@@ -116,6 +116,54 @@ BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixMultiplyAndAdd, RandomSeedFixture)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixEmbeddingGradientBlockColumns, RandomSeedFixture)
+{
+    // Gradient of an embedding table for a one-hot input in which some words repeat.
+    const size_t embeddingDim = 20;
+    const size_t vocabSize = 1000;
+    const size_t words[] = { 3, 700, 3, 42, 700, 3, 999, 0 };
+    const size_t n = sizeof(words) / sizeof(words[0]);
+
+    DenseMatrix outputGradient(embeddingDim, n);
+    outputGradient.SetUniformRandomValue(-1, 1, IncrementCounter());
+
+    SparseMatrix input(MatrixFormat::matrixFormatSparseCSC, vocabSize, n, 0);
+    DenseMatrix denseInput(vocabSize, n);
+    denseInput.SetValue(0);
+    for (size_t j = 0; j < n; j++)
+    {
+        input.SetValue(words[j], j, 1);
+        denseInput(words[j], j) = 1;
+    }
+
+    DenseMatrix expected(embeddingDim, vocabSize);
+    expected.SetValue(0);
+    DenseMatrix::MultiplyAndAdd(outputGradient, false, denseInput, true, expected);
+
+    SparseMatrix gradient(MatrixFormat::matrixFormatSparseBlockCol, embeddingDim, vocabSize, 0);
+    SparseMatrix::MultiplyAndAdd(1, outputGradient, false, input, true, gradient);
+
+    // Only the touched columns are stored, each exactly once.
+    std::vector<size_t> columnIds;
+    std::vector<double> values;
+    gradient.GetBlockColumns(columnIds, values);
+    BOOST_CHECK_EQUAL(columnIds.size(), 5);
+    BOOST_CHECK_EQUAL(values.size(), columnIds.size() * embeddingDim);
+
+    foreach_coord (row, col, expected)
+    {
+        BOOST_CHECK(abs(gradient(row, col) - expected(row, col)) < c_epsilonFloatE4);
+    }
+
+    // Round trip through the (column index, column values) representation.
+    SparseMatrix copy(MatrixFormat::matrixFormatSparseBlockCol, embeddingDim, vocabSize, 0);
+    copy.SetBlockColumns(columnIds, values);
+    foreach_coord (row, col, expected)
+    {
+        BOOST_CHECK_EQUAL(copy(row, col), gradient(row, col));
+    }
+}
+
 BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixDoGatherColumnsOf, RandomSeedFixture)
 {
     const size_t m = 100;
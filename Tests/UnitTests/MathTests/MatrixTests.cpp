@@ -221,6 +221,50 @@ BOOST_FIXTURE_TEST_CASE(MatrixInitRandomUniformSeed, RandomSeedFixture)
     // BOOST_CHECK(a.IsEqualTo(b));
 }
 
+BOOST_FIXTURE_TEST_CASE(MatrixPackedDropout, RandomSeedFixture)
+{
+    const size_t rows = 77, cols = 13; // rows not a multiple of the 32 bits of a mask word
+    const float rate = 0.4f;
+    const float scale = 1 / (1 - rate);
+    const uint64_t seed = 1234;
+    SingleMatrix input = SingleMatrix::RandomUniform(rows, cols, CPUDEVICE, -1, 1, IncrementCounter());
+    SingleMatrix gradient = SingleMatrix::RandomUniform(rows, cols, CPUDEVICE, -1, 1, IncrementCounter());
+
+    // the packed mask is drawn from the same random numbers as a mask of SetUniformRandomMask()
+    auto rng = RNGHandle::Create(CPUDEVICE, seed);
+    SingleMatrix mask(rows, cols, CPUDEVICE);
+    mask.SetUniformRandomMask(rate, scale, *rng);
+    SingleMatrix expected(CPUDEVICE);
+    expected.AssignElementProductOf(mask, input);
+
+    auto packedRng = RNGHandle::Create(CPUDEVICE, seed);
+    SingleMatrix packedMask(PackedMaskRows<float>(rows), cols, CPUDEVICE);
+    SingleMatrix output(CPUDEVICE);
+    output.AssignDropoutOf(input, packedMask, rate, scale, *packedRng);
+    BOOST_CHECK(output.IsEqualTo(expected, c_epsilonFloatE5));
+    BOOST_CHECK_EQUAL(dynamic_cast<CPURNGHandle&>(*packedRng).Offset(), rows * cols);
+    BOOST_CHECK_EQUAL(dynamic_cast<CPURNGHandle&>(*rng).Offset(), rows * cols);
+
+    // gradient, on all columns and on a slice of them, assigned and accumulated
+    SingleMatrix expectedGradient(CPUDEVICE);
+    expectedGradient.AssignElementProductOf(mask, gradient);
+    SingleMatrix inputGradient(CPUDEVICE);
+    inputGradient.AssignDropoutGradientOf(gradient, packedMask, scale);
+    BOOST_CHECK(inputGradient.IsEqualTo(expectedGradient, c_epsilonFloatE5));
+
+    SingleMatrix sliceGradient(CPUDEVICE);
+    sliceGradient.AssignDropoutGradientOf(gradient.ColumnSlice(5, 3), packedMask.ColumnSlice(5, 3), scale);
+    BOOST_CHECK(sliceGradient.IsEqualTo(expectedGradient.ColumnSlice(5, 3), c_epsilonFloatE5));
+
+    inputGradient.AddDropoutGradientOf(gradient, packedMask, scale);
+    expectedGradient.AddElementProductOf(mask, gradient);
+    BOOST_CHECK(inputGradient.IsEqualTo(expectedGradient, c_epsilonFloatE5));
+
+    // wrongly sized mask
+    SingleMatrix denseMask(rows, cols, CPUDEVICE);
+    BOOST_CHECK_THROW(output.AssignDropoutOf(input, denseMask, rate, scale, *packedRng), std::invalid_argument);
+}
+
 BOOST_FIXTURE_TEST_CASE(MatrixSetValueMethods, RandomSeedFixture)
 {
     // void SetValue(const ElemType v);
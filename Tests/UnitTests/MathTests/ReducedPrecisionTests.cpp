@@ -0,0 +1,79 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "../../../Source/Math/CPUMatrix.h"
+#include "../../../Source/Math/ReducedPrecision.h"
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(ReducedPrecisionUnitTests)
+
+BOOST_AUTO_TEST_CASE(Float16RoundTrip)
+{
+    // every half value except the NaNs converts to float and back unchanged
+    for (uint32_t h = 0; h < 0x10000; h++)
+    {
+        bool isNaN = (h & 0x7c00) == 0x7c00 && (h & 0x03ff) != 0;
+        if (!isNaN)
+            BOOST_CHECK_EQUAL(FloatToHalf(HalfToFloat((uint16_t) h)), h);
+    }
+
+    BOOST_CHECK_EQUAL(HalfToFloat(FloatToHalf(1.0f + 1.0f / 2048)), 1.0f);              // ties round to even
+    BOOST_CHECK_EQUAL(HalfToFloat(FloatToHalf(1.0f + 3.0f / 2048)), 1.0f + 1.0f / 512); // ties round to even
+    BOOST_CHECK_EQUAL(FloatToHalf(65520.0f), 0x7c00);                                   // overflow to infinity
+    BOOST_CHECK_EQUAL(HalfToFloat(FloatToHalf(-5.9604645e-8f)), -5.9604645e-8f);        // smallest denormal
+}
+
+BOOST_AUTO_TEST_CASE(BFloat16Conversion)
+{
+    BOOST_CHECK_EQUAL(BFloat16ToFloat(FloatToBFloat16(1.0f)), 1.0f);
+    BOOST_CHECK_EQUAL(BFloat16ToFloat(FloatToBFloat16(-3.0e38f)), -3.0040553e38f);
+    BOOST_CHECK_EQUAL(BFloat16ToFloat(FloatToBFloat16(1.0f + 1.0f / 256)), 1.0f); // ties round to even
+    BOOST_CHECK(std::isnan(BFloat16ToFloat(FloatToBFloat16(std::numeric_limits<float>::quiet_NaN()))));
+
+    std::vector<float> values = { 0.1f, -2.5f, 1e-20f, 12345.678f };
+    std::vector<uint16_t> stored(values.size());
+    std::vector<float> restored(values.size());
+    ConvertToReducedPrecision(values.data(), stored.data(), values.size(), ReducedPrecisionFormat::BFloat16);
+    ConvertFromReducedPrecision(stored.data(), restored.data(), values.size(), ReducedPrecisionFormat::BFloat16);
+    for (size_t i = 0; i < values.size(); i++)
+        BOOST_CHECK_CLOSE(restored[i], values[i], 0.4 /*percent*/);
+}
+
+BOOST_AUTO_TEST_CASE(ReducedPrecisionMultiply)
+{
+    // A[m,k]*B[k,n] = C[m,n]; sizes that cover several row blocks and column tiles
+    const int m = 300, n = 3, k = 513;
+    std::vector<float> A(m * k), B(k * n), C(m * n);
+    for (int i = 0; i < m * k; i++)
+        A[i] = (float) ((i * 37) % 101 - 50) / 64; // exactly representable in both formats
+    for (int i = 0; i < k * n; i++)
+        B[i] = (float) ((i * 11) % 23 - 11) / 8;
+
+    for (auto format : { ReducedPrecisionFormat::Float16, ReducedPrecisionFormat::BFloat16 })
+    {
+        ReducedPrecisionMultiplier<float> mult(format);
+        mult.SetIsAConstant(true);
+
+        // second pass reads only the converted copy of A
+        for (int pass = 0; pass < 2; pass++)
+        {
+            mult.Multiply(m, n, k, A.data(), B.data(), C.data());
+            for (int i = 0; i < m; i++)
+                for (int j = 0; j < n; j++)
+                {
+                    double expected = 0;
+                    for (int l = 0; l < k; l++)
+                        expected += (double) A[i + l * m] * B[l + j * k];
+                    BOOST_CHECK_SMALL(C[i + j * m] - expected, 1e-3);
+                }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
@@ -0,0 +1,144 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "TrainingNodes.h"
+#include "TestHelpers.h"
+#include <cmath>
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// Extends the node to give access to its gradient.
+template <class ElemType>
+class ClassBasedCrossEntropyWithSoftmaxNodeTest : public ClassBasedCrossEntropyWithSoftmaxNode<ElemType>
+{
+public:
+    ClassBasedCrossEntropyWithSoftmaxNodeTest() : ClassBasedCrossEntropyWithSoftmaxNode<ElemType>(CPUDEVICE, L"ClassBasedCrossEntropyTest") {}
+
+    void AllocMatrices()
+    {
+        this->CreateValueMatrixIfNull();
+        this->CreateGradientMatrixIfNull();
+        this->Value().Resize(1, 1);
+        this->Gradient().Resize(1, 1);
+        this->Gradient().SetValue(1);
+    }
+};
+
+// Input node whose minibatch layout can be shared with other inputs, or removed for parameters.
+template <class ElemType>
+class LayoutNodeTest : public DummyNodeTest<ElemType>
+{
+public:
+    LayoutNodeTest(size_t minibatchSize, SmallVector<size_t> sampleDimensions, std::vector<ElemType>& data)
+        : DummyNodeTest<ElemType>(CPUDEVICE, minibatchSize, sampleDimensions, data)
+    {
+        this->GetGradient().SetValue(0);
+    }
+
+    void SetLayout(MBLayoutPtr pMBLayout, const TensorShape& sampleLayout)
+    {
+        this->LinkToMBLayout(pMBLayout);
+        this->SetDims(sampleLayout, !!pMBLayout);
+        this->Value().Reshape(sampleLayout[0], this->Value().GetNumElements() / sampleLayout[0]);
+        this->GetGradient().Reshape(sampleLayout[0], this->GetGradient().GetNumElements() / sampleLayout[0]);
+    }
+};
+
+BOOST_AUTO_TEST_SUITE(ClassBasedCrossEntropyTests)
+
+// The CPU implementation groups the frames by class. Compare it with a frame-by-frame computation.
+BOOST_AUTO_TEST_CASE(ClassBasedCrossEntropyWithSoftmaxGroupedByClassTest)
+{
+    // two streams of 3 frames, the last frame of stream 1 is a gap; columns are t * 2 + s
+    const size_t nS = 2, nT = 3, numCols = nS * nT, hdSize = 2, vocabSize = 5, nbrCls = 3;
+    MBLayoutPtr pMBLayout = make_shared<MBLayout>(nS, nT, L"X");
+    pMBLayout->AddSequence(0, 0, 0, 3);
+    pMBLayout->AddSequence(1, 1, 0, 2);
+    pMBLayout->AddGap(1, 2, 3);
+
+    // classes: 0 = words {0, 1}, 1 = words {2, 3, 4}, 2 = no words in the minibatch
+    vector<double> labels = { 1, 0, 0, 2,    3, 1, 2, 5,
+                              0, 0, 0, 2,    4, 1, 2, 5,
+                              2, 1, 2, 5,    0, 0, 0, 0 }; // gap
+    vector<double> obs = { 0.5, -1, 1, 2, -0.5, 0.25, 1.5, 0, 0.75, -0.5, 9, 9 };
+    vector<double> weight = { 0.1, 0.2, -0.3, 0.4, 0.5, -0.6, 0.7, 0.8, -0.9, 1.0 }; // [hdSize x vocabSize]
+    vector<double> clsProb = { 0.1, -0.2, 0.3, 1, 0, -1, 0.5, 0.5, 0, -0.3, 0.2, 0.1, 2, 1, 0, 9, 9, 9 };
+
+    auto labelNode = make_shared<LayoutNodeTest<double>>(numCols, SmallVector<size_t>{ 4 }, labels);
+    auto obsNode = make_shared<LayoutNodeTest<double>>(numCols, SmallVector<size_t>{ hdSize }, obs);
+    auto weightNode = make_shared<LayoutNodeTest<double>>(1, SmallVector<size_t>{ hdSize * vocabSize }, weight);
+    auto clsProbNode = make_shared<LayoutNodeTest<double>>(numCols, SmallVector<size_t>{ nbrCls }, clsProb);
+    labelNode->SetLayout(pMBLayout, TensorShape(4));
+    obsNode->SetLayout(pMBLayout, TensorShape(hdSize));
+    weightNode->SetLayout(nullptr, TensorShape(hdSize, vocabSize));
+    clsProbNode->SetLayout(pMBLayout, TensorShape(nbrCls));
+
+    auto node = make_shared<ClassBasedCrossEntropyWithSoftmaxNodeTest<double>>();
+    node->AttachInputs(vector<ComputationNodeBasePtr>{ labelNode, obsNode, weightNode, clsProbNode });
+    node->Validate(true);
+    node->AllocMatrices();
+
+    ComputationNodeNonLooping<double>& nonLooping = *node;
+    nonLooping.ForwardProp(FrameRange(nullptr));
+    for (size_t inputIndex = 1; inputIndex <= 3; inputIndex++)
+        nonLooping.BackpropTo(inputIndex, FrameRange(nullptr));
+
+    // reference, frame by frame
+    double objective = 0;
+    vector<double> grdObs(obs.size(), 0), grdWeight(weight.size(), 0), grdClsProb(clsProb.size(), 0);
+    for (size_t j = 0; j + 1 < numCols; j++)
+    {
+        size_t y = (size_t)labels[4 * j], c = (size_t)labels[4 * j + 1], lft = (size_t)labels[4 * j + 2], rgt = (size_t)labels[4 * j + 3];
+
+        vector<double> z(rgt - lft);
+        double zMax = -1e30, zSum = 0;
+        for (size_t w = lft; w < rgt; w++)
+        {
+            z[w - lft] = weight[w * hdSize] * obs[j * hdSize] + weight[w * hdSize + 1] * obs[j * hdSize + 1];
+            zMax = max(zMax, z[w - lft]);
+        }
+        for (double zw : z)
+            zSum += exp(zw - zMax);
+
+        double clsMax = -1e30, clsSum = 0;
+        for (size_t i = 0; i < nbrCls; i++)
+            clsMax = max(clsMax, clsProb[j * nbrCls + i]);
+        for (size_t i = 0; i < nbrCls; i++)
+            clsSum += exp(clsProb[j * nbrCls + i] - clsMax);
+
+        objective -= z[y - lft] - zMax - log(zSum) + clsProb[j * nbrCls + c] - clsMax - log(clsSum);
+
+        for (size_t w = lft; w < rgt; w++)
+        {
+            double dz = exp(z[w - lft] - zMax) / zSum - (w == y ? 1 : 0);
+            for (size_t h = 0; h < hdSize; h++)
+            {
+                grdObs[j * hdSize + h] += dz * weight[w * hdSize + h];
+                grdWeight[w * hdSize + h] += dz * obs[j * hdSize + h];
+            }
+        }
+        for (size_t i = 0; i < nbrCls; i++)
+            grdClsProb[j * nbrCls + i] = exp(clsProb[j * nbrCls + i] - clsMax) / clsSum - (i == c ? 1 : 0);
+    }
+
+    BOOST_CHECK_CLOSE(node->Value().Get00Element(), objective, 1e-8);
+
+    unique_ptr<double[]> result(obsNode->GetGradient().CopyToArray());
+    for (size_t i = 0; i < grdObs.size(); i++)
+        BOOST_CHECK_SMALL(result[i] - grdObs[i], 1e-10);
+
+    result.reset(weightNode->GetGradient().CopyToArray());
+    for (size_t i = 0; i < grdWeight.size(); i++)
+        BOOST_CHECK_SMALL(result[i] - grdWeight[i], 1e-10);
+
+    result.reset(clsProbNode->GetGradient().CopyToArray());
+    for (size_t i = 0; i < grdClsProb.size(); i++)
+        BOOST_CHECK_SMALL(result[i] - grdClsProb[i], 1e-10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
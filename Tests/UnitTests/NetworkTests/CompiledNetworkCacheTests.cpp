@@ -0,0 +1,136 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+#include "Globals.h"
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <map>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// A deep stack of layers with a recurrent layer on top and many output heads,
+// as it results from unrolling stacks in BrainScript. All nodes are named, as in a model from BrainScript or a file,
+// since unnamed nodes get process-unique names, which would make every instance another network.
+static ComputationNetworkPtr CreateDeepNetwork(size_t numLayers, size_t numHeads, size_t inputDim)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    const size_t hiddenDim = 16, labelDim = 4;
+
+    auto features = builder.CreateInputNode(L"features", inputDim);
+    auto labels = builder.CreateInputNode(L"labels", labelDim);
+    net->AddToNodeGroup(L"feature", features);
+    net->AddToNodeGroup(L"label", labels);
+
+    auto h = features;
+    for (size_t i = 0; i < numLayers; i++)
+    {
+        auto W = builder.CreateLearnableParameter(msra::strfun::wstrprintf(L"W%d", (int)i), hiddenDim, i == 0 ? inputDim : hiddenDim);
+        auto b = builder.CreateLearnableParameter(msra::strfun::wstrprintf(L"b%d", (int)i), hiddenDim, 1);
+        auto z = builder.Plus(builder.Times(W, h, 1, msra::strfun::wstrprintf(L"Wh%d", (int)i)), b, msra::strfun::wstrprintf(L"z%d", (int)i));
+        h = builder.Sigmoid(z, msra::strfun::wstrprintf(L"h%d", (int)i));
+        if (i % (numLayers / numHeads) == 0)
+        {
+            auto Wo = builder.CreateLearnableParameter(msra::strfun::wstrprintf(L"Wo%d", (int)i), labelDim, hiddenDim);
+            net->AddToNodeGroup(L"output", builder.Times(Wo, h, 1, msra::strfun::wstrprintf(L"head%d", (int)i)));
+        }
+    }
+
+    auto Wx = builder.CreateLearnableParameter(L"Wx", hiddenDim, hiddenDim);
+    auto Wr = builder.CreateLearnableParameter(L"Wr", hiddenDim, hiddenDim);
+    auto pastValue = builder.PastValue(nullptr, 0.1f, hiddenDim, 1, L"pastR");
+    auto r = builder.Sigmoid(builder.Plus(builder.Times(Wx, h, 1, L"Wxh"), builder.Times(Wr, pastValue, 1, L"Wrr"), L"zr"), L"r");
+    pastValue->AttachInputs({ r });
+
+    auto Wout = builder.CreateLearnableParameter(L"Wout", labelDim, hiddenDim);
+    auto ce = builder.CrossEntropyWithSoftmax(labels, builder.Times(Wout, r, 1, L"z"), L"ce");
+    net->AddToNodeGroup(L"criterion", ce);
+    return net;
+}
+
+// compiles the network and plans the memory for training, returns the time taken in seconds
+static double CompileAndAllocate(const ComputationNetworkPtr& net)
+{
+    auto start = chrono::steady_clock::now();
+    net->CompileNetwork();
+    net->AllocateAllMatrices(net->OutputNodes(), {}, net->FinalCriterionNodes().front());
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// for every node, the name of the first node (in name order) whose value shares its matrix
+static map<wstring, wstring> GetValueSharing(const ComputationNetworkPtr& net)
+{
+    map<const MatrixBase*, wstring> firstNodeOfMatrix;
+    map<wstring, wstring> sharing;
+    for (const auto& node : net->GetAllNodes())
+    {
+        auto matrix = node->ValuePtr().get();
+        if (firstNodeOfMatrix.find(matrix) == firstNodeOfMatrix.end())
+            firstNodeOfMatrix[matrix] = node->NodeName();
+        sharing[node->NodeName()] = firstNodeOfMatrix[matrix];
+    }
+    return sharing;
+}
+
+static vector<wstring> GetEvalOrderNames(const ComputationNetworkPtr& net)
+{
+    vector<wstring> names;
+    for (const auto& node : net->GetEvalOrder(nullptr))
+        names.push_back(node->NodeName() + (node->IsPartOfLoop() ? L" (loop)" : L""));
+    return names;
+}
+
+BOOST_AUTO_TEST_SUITE(CompiledNetworkCacheTests)
+
+BOOST_AUTO_TEST_CASE(CompiledNetworkCacheStartup)
+{
+    auto directory = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("CompiledNetworkCache-%%%%-%%%%");
+    Globals::SetCompiledNetworkCacheDirectory(directory.wstring());
+
+    const size_t numLayers = 500, numHeads = 50, inputDim = 32;
+
+    auto coldNet = CreateDeepNetwork(numLayers, numHeads, inputDim);
+    double coldTime = CompileAndAllocate(coldNet);
+    BOOST_CHECK(!coldNet->IsCompiledFromCache());
+
+    // same model in a new process: restored from the cache, with identical results
+    auto warmNet = CreateDeepNetwork(numLayers, numHeads, inputDim);
+    double warmTime = CompileAndAllocate(warmNet);
+    BOOST_CHECK(warmNet->IsCompiledFromCache());
+    BOOST_CHECK_EQUAL(coldNet->GetCompiledNetworkCacheKey(), warmNet->GetCompiledNetworkCacheKey());
+
+    auto coldOrder = GetEvalOrderNames(coldNet);
+    auto warmOrder = GetEvalOrderNames(warmNet);
+    BOOST_CHECK(coldOrder == warmOrder);
+    for (const auto& node : coldNet->GetAllNodes())
+    {
+        auto warmNode = warmNet->GetNodeFromName(node->NodeName());
+        BOOST_CHECK(node->GetSampleLayout() == warmNode->GetSampleLayout());
+        BOOST_CHECK_EQUAL(node->HasMBLayout(), warmNode->HasMBLayout());
+        BOOST_CHECK_EQUAL(node->NeedsGradient(), warmNode->NeedsGradient());
+    }
+    BOOST_CHECK(GetValueSharing(coldNet) == GetValueSharing(warmNet));
+
+    fprintf(stderr, "CompiledNetworkCacheStartup: compiling and allocating %d nodes took %.3f seconds without and %.3f seconds with the cache.\n",
+            (int)coldNet->GetTotalNumberOfNodes(), coldTime, warmTime);
+
+    // another input shape is another network
+    auto otherNet = CreateDeepNetwork(numLayers, numHeads, inputDim + 1);
+    BOOST_CHECK_NE(otherNet->GetCompiledNetworkCacheKey(), coldNet->GetCompiledNetworkCacheKey());
+    CompileAndAllocate(otherNet);
+    BOOST_CHECK(!otherNet->IsCompiledFromCache());
+
+    Globals::SetCompiledNetworkCacheDirectory(L"");
+    boost::filesystem::remove_all(directory);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
@@ -44,6 +44,48 @@ BOOST_AUTO_TEST_CASE(ComputeEditDistanceErrorTest)
     assert((int)ed == 1);
 }
 
+BOOST_AUTO_TEST_CASE(ComputeEditDistanceErrorParallelSequencesTest)
+{
+    // three sequences packed into two parallel streams of 6 frames:
+    //   stream 0: seq A (frames 0..3), gap, gap
+    //   stream 1: seq B (frames 0..1), seq C (frames 2..5)
+    size_t numParallelSequences = 2, numTimeSteps = 6;
+    MBLayoutPtr pMBLayout = make_shared<MBLayout>(numParallelSequences, numTimeSteps, L"X");
+    pMBLayout->AddSequence(0, 0, 0, 4);
+    pMBLayout->AddGap(0, 4, 6);
+    pMBLayout->AddSequence(1, 1, 0, 2);
+    pMBLayout->AddSequence(2, 1, 2, 6);
+
+    Matrix<float> firstSeq(CPUDEVICE);
+    Matrix<float> secondSeq(CPUDEVICE);
+    firstSeq.Resize(1, numParallelSequences * numTimeSteps);
+    secondSeq.Resize(1, numParallelSequences * numTimeSteps);
+    auto set = [&](size_t s, size_t t, float first, float second)
+    {
+        firstSeq(0, t * numParallelSequences + s) = first;
+        secondSeq(0, t * numParallelSequences + s) = second;
+    };
+    // A: 1 2 3 4 vs 1 5 3 4 -> 1 substitution
+    set(0, 0, 1, 1); set(0, 1, 2, 5); set(0, 2, 3, 3); set(0, 3, 4, 4);
+    set(0, 4, 9, 9); set(0, 5, 9, 9); // gap, must be ignored
+    // B: 7 8 vs 7 8 -> no error
+    set(1, 0, 7, 7); set(1, 1, 8, 8);
+    // C: 1 2 3 4 vs 2 3 4 4 -> 1 deletion and 1 insertion
+    set(1, 2, 1, 2); set(1, 3, 2, 3); set(1, 4, 3, 4); set(1, 5, 4, 4);
+
+    unique_ptr<EditDistanceErrorNode<float>> pEDNode(new EditDistanceErrorNode<float>(-1, L"ednode"));
+    vector<size_t> tokensToIgnore;
+
+    // 3 errors in 10 samples of the first input, scaled by the 10 frames
+    float ed = pEDNode->ComputeEditDistanceError(firstSeq, secondSeq, pMBLayout, 1, 1, 1, false, tokensToIgnore);
+    BOOST_CHECK_CLOSE(ed, 3.0f, 1e-4);
+
+    // ignoring token 1 leaves A: 2 3 4 vs 5 3 4 (1 substitution) and C: 2 3 4 vs 2 3 4 4 (1 insertion), in 8 samples
+    tokensToIgnore = { 1 };
+    ed = pEDNode->ComputeEditDistanceError(firstSeq, secondSeq, pMBLayout, 1, 1, 1, false, tokensToIgnore);
+    BOOST_CHECK_CLOSE(ed, 2.0f * 10 / 8, 1e-4);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
\ No newline at end of file
@@ -0,0 +1,96 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "InputAndParamNodes.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// Extends the node to give access to its validation and gradient.
+template <class ElemType>
+class LookupTableNodeTest : public LookupTableNode<ElemType>
+{
+public:
+    LookupTableNodeTest() : LookupTableNode<ElemType>(CPUDEVICE, L"LookupTableTest") {}
+
+    using LookupTableNode<ElemType>::Validate;
+
+    void AllocMatrices(size_t numCols, const vector<ElemType>& gradient)
+    {
+        this->CreateValueMatrixIfNull();
+        this->CreateGradientMatrixIfNull();
+        this->Value().Resize(this->GetSampleLayout().GetNumElements(), numCols);
+        this->Gradient().SetValue(this->GetSampleLayout().GetNumElements(), numCols, CPUDEVICE, const_cast<ElemType*>(gradient.data()));
+    }
+
+    void BackpropToEmbeddingAllSamples()
+    {
+        this->BackpropTo(0, FrameRange(this->GetMBLayout()));
+    }
+};
+
+// Computes the embedding gradient of one-hot words for the given preferred gradient type of the embedding.
+static shared_ptr<ComputationNode<float>> LookupTableEmbeddingGradient(MatrixType preferredGradientType, const vector<float>& words,
+                                                                      const vector<float>& outputGradient, size_t dim, size_t vocabSize)
+{
+    const size_t numSamples = words.size();
+    vector<float> oneHot(vocabSize * numSamples, 0);
+    for (size_t j = 0; j < numSamples; j++)
+        oneHot[j * vocabSize + (size_t)words[j]] = 1;
+
+    shared_ptr<ComputationNode<float>> embeddingNode = make_shared<LearnableParameter<float>>(CPUDEVICE, L"E", dim, vocabSize);
+    embeddingNode->Value().SetValue(0.5f);
+    embeddingNode->CreateGradientMatrixIfNull();
+    embeddingNode->Gradient().Resize(dim, vocabSize);
+    embeddingNode->Gradient().SetValue(0);
+    embeddingNode->SetPreferredGradientMatrixType(preferredGradientType);
+
+    auto inputNode = make_shared<DummyNodeTest<float>>(CPUDEVICE, numSamples, SmallVector<size_t>{ vocabSize }, oneHot);
+    // one column per sample, as the reader delivers it
+    inputNode->Value().SetValue(vocabSize, numSamples, CPUDEVICE, oneHot.data());
+    inputNode->Value().SwitchToMatrixType(SPARSE, matrixFormatSparseCSC, true);
+
+    auto node = make_shared<LookupTableNodeTest<float>>();
+    node->AttachInputs(vector<ComputationNodeBasePtr>{ embeddingNode, inputNode });
+    node->Validate(true);
+    node->AllocMatrices(numSamples, outputGradient);
+    node->BackpropToEmbeddingAllSamples();
+    return embeddingNode;
+}
+
+BOOST_AUTO_TEST_SUITE(LookupTableTests)
+
+// With sparse input on the CPU, the embedding gradient holds only the columns of the words in the minibatch. When the
+// gradient aggregation cannot exchange those, SGD prefers a dense gradient, which must then be kept.
+BOOST_AUTO_TEST_CASE(LookupTableEmbeddingGradientFormat)
+{
+    const size_t dim = 3, vocabSize = 5;
+    vector<float> words = { 1, 3, 1, 4 };
+    vector<float> outputGradient = { 1, 2, 3, -1, 0.5f, 2, 0.25f, -2, 1, 4, 0, -3 }; // [dim x numSamples]
+
+    vector<float> expected(dim * vocabSize, 0);
+    for (size_t j = 0; j < words.size(); j++)
+        for (size_t i = 0; i < dim; i++)
+            expected[(size_t)words[j] * dim + i] += outputGradient[j * dim + i];
+
+    auto sparse = LookupTableEmbeddingGradient(UNDETERMINED, words, outputGradient, dim, vocabSize);
+    BOOST_CHECK(sparse->Gradient().GetMatrixType() == SPARSE);
+    BOOST_CHECK(sparse->Gradient().GetFormat() == matrixFormatSparseBlockCol);
+    sparse->Gradient().SwitchToMatrixType(DENSE, matrixFormatDense, true);
+    unique_ptr<float[]> result(sparse->Gradient().CopyToArray());
+    for (size_t i = 0; i < expected.size(); i++)
+        BOOST_CHECK_EQUAL(result[i], expected[i]);
+
+    auto dense = LookupTableEmbeddingGradient(DENSE, words, outputGradient, dim, vocabSize);
+    BOOST_CHECK(dense->Gradient().GetMatrixType() == DENSE);
+    result.reset(dense->Gradient().CopyToArray());
+    for (size_t i = 0; i < expected.size(); i++)
+        BOOST_CHECK_EQUAL(result[i], expected[i]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
@@ -0,0 +1,123 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "LinearAlgebraNodes.h"
+#include "InputAndParamNodes.h"
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+#include "ComputationEnvironment.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// Extends the node to give access to its validation and evaluation.
+template <class ElemType>
+class ReducedPrecisionTimesNodeTest : public ReducedPrecisionTimesNode<ElemType>
+{
+public:
+    ReducedPrecisionTimesNodeTest(const wstring& precision) : ReducedPrecisionTimesNode<ElemType>(CPUDEVICE, L"ReducedPrecisionTimesTest", precision) {}
+
+    using ReducedPrecisionTimesNode<ElemType>::Validate;
+
+    void AllocMatrices(size_t numCols)
+    {
+        this->CreateValueMatrixIfNull();
+        this->Value().Resize(this->GetSampleLayout().GetNumElements(), numCols);
+    }
+
+    void ForwardPropAllSamples()
+    {
+        this->ForwardProp(FrameRange(this->GetMBLayout()));
+    }
+};
+
+BOOST_AUTO_TEST_SUITE(ReducedPrecisionTimesTests)
+
+// In inference mode, the first evaluation converts the weights and releases the full-precision ones. The following
+// evaluations read only the 16-bit copy.
+BOOST_AUTO_TEST_CASE(ReducedPrecisionTimesReleasesWeightsWhenInferring)
+{
+    // all values are exact in float16 and bfloat16, so the products are exact
+    const size_t rows = 3, cols = 4, numSamples = 2;
+    vector<float> weight = { 0.5f, -1, 2, 0.25f, 1.5f, -0.75f, 3, 0, -2, 1, 0.125f, -4 }; // [rows x cols]
+    vector<float> x = { 1, 2, -1, 0.5f, -3, 0.25f, 4, 1 };                                 // [cols x numSamples]
+    vector<float> expected(rows * numSamples, 0);
+    for (size_t j = 0; j < numSamples; j++)
+        for (size_t i = 0; i < rows; i++)
+            for (size_t l = 0; l < cols; l++)
+                expected[j * rows + i] += weight[l * rows + i] * x[j * cols + l];
+
+    for (auto precision : { L"float16", L"bfloat16" })
+    {
+        auto weightNode = make_shared<LearnableParameter<float>>(CPUDEVICE, L"W", rows, cols);
+        weightNode->Value().SetValue(rows, cols, CPUDEVICE, weight.data());
+        auto inputNode = make_shared<DummyNodeTest<float>>(CPUDEVICE, numSamples, SmallVector<size_t>{ cols }, x);
+
+        auto node = make_shared<ReducedPrecisionTimesNodeTest<float>>(precision);
+        node->AttachInputs(vector<ComputationNodeBasePtr>{ weightNode, inputNode });
+        node->SetEnvironment(make_shared<ComputationEnvironment>()); // inferring by default
+        node->Validate(true);
+        node->AllocMatrices(numSamples);
+
+        for (size_t evaluation = 0; evaluation < 2; evaluation++)
+        {
+            node->Value().SetValue(0);
+            node->ForwardPropAllSamples();
+
+            BOOST_CHECK_EQUAL(weightNode->Value().GetNumElements(), 0);
+            unique_ptr<float[]> result(node->Value().CopyToArray());
+            for (size_t i = 0; i < expected.size(); i++)
+                BOOST_CHECK_EQUAL(result[i], expected[i]);
+        }
+    }
+}
+
+// Weights that other nodes read as well (e.g. tied embeddings) are kept in full precision.
+BOOST_AUTO_TEST_CASE(ReducedPrecisionTimesKeepsSharedWeights)
+{
+    const size_t rows = 3, cols = 4, numSamples = 2;
+    vector<float> weight = { 0.5f, -1, 2, 0.25f, 1.5f, -0.75f, 3, 0, -2, 1, 0.125f, -4 }; // [rows x cols]
+    vector<float> x = { 1, 2, -1, 0.5f, -3, 0.25f, 4, 1 };                                 // [cols x numSamples]
+
+    for (bool shared : { false, true })
+    {
+        auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+        net->SetTraceLevel(0);
+        ComputationNetworkBuilder<float> builder(*net);
+        auto features = builder.CreateInputNode(L"features", cols);
+        auto W = builder.CreateLearnableParameter(L"W", rows, cols);
+        net->AddToNodeGroup(L"feature", features);
+        vector<ComputationNodeBasePtr> outputs = { builder.ReducedPrecisionTimes(W, features, L"bfloat16", 1, L"reduced") };
+        if (shared)
+            outputs.push_back(builder.Times(W, features, 1, L"full"));
+        for (auto& output : outputs)
+            net->AddToNodeGroup(L"output", output);
+        net->CompileNetwork();
+        net->AllocateAllMatrices({}, outputs, nullptr);
+
+        W->Value().SetValue(rows, cols, CPUDEVICE, weight.data());
+        net->GetMBLayoutPtrOfNetwork()->InitAsFrameMode(numSamples);
+        features->Value().SetValue(cols, numSamples, CPUDEVICE, x.data());
+        net->StartEvaluateMinibatchLoop(outputs);
+        features->BumpEvalTimeStamp();
+        ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::inferring);
+        net->ForwardProp(outputs);
+
+        BOOST_CHECK_EQUAL(W->Value().GetNumElements(), shared ? rows * cols : 0);
+        if (shared)
+        {
+            // all values are exact in bfloat16, so the products agree
+            unique_ptr<float[]> reduced(outputs[0]->As<ComputationNode<float>>()->Value().CopyToArray());
+            unique_ptr<float[]> full(outputs[1]->As<ComputationNode<float>>()->Value().CopyToArray());
+            for (size_t i = 0; i < rows * numSamples; i++)
+                BOOST_CHECK_EQUAL(reduced[i], full[i]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
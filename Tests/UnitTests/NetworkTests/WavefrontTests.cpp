@@ -0,0 +1,150 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+#include "ComputationEnvironment.h"
+#include "TrainingNodes.h"
+#include "Globals.h"
+#include "TestHelpers.h"
+#include <map>
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+static const size_t c_inputDim = 5, c_hiddenDim = 7, c_labelDim = 3;
+static const size_t c_numSequences = 3, c_numTimeSteps = 9;
+
+// Three stacked recurrent layers; the second one has a delay of 2 steps. Non-recurrent nodes between the layers,
+// among them a Dropout, and an output head on the first layer that is computed after the wavefront.
+// The layers run forward in time over PastValue, or backward over FutureValue.
+static ComputationNetworkPtr CreateStackedNetwork(bool futureValue)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    net->SetTraceLevel(0);
+    ComputationNetworkBuilder<float> builder(*net);
+
+    auto features = builder.CreateInputNode(L"features", c_inputDim);
+    auto labels = builder.CreateInputNode(L"labels", c_labelDim);
+    net->AddToNodeGroup(L"feature", features);
+    net->AddToNodeGroup(L"label", labels);
+
+    auto x = features;
+    shared_ptr<ComputationNode<float>> firstLayer;
+    for (size_t i = 0; i < 3; i++)
+    {
+        auto W = builder.CreateLearnableParameter(msra::strfun::wstrprintf(L"W%d", (int)i), c_hiddenDim, i == 0 ? c_inputDim : c_hiddenDim);
+        auto R = builder.CreateLearnableParameter(msra::strfun::wstrprintf(L"R%d", (int)i), c_hiddenDim, c_hiddenDim);
+        auto delayName = msra::strfun::wstrprintf(futureValue ? L"future%d" : L"past%d", (int)i);
+        auto delay = futureValue ? builder.FutureValue(nullptr, 0.1f, c_hiddenDim, i == 1 ? 2 : 1, delayName)
+                                 : builder.PastValue(nullptr, 0.1f, c_hiddenDim, i == 1 ? 2 : 1, delayName);
+        auto input = i == 0 ? x : builder.Sigmoid(x);
+        if (i == 2)
+        {
+            input = builder.Dropout(input, L"dropout");
+            input->As<DropoutNodeBase>()->SetDropoutRate(0.5);
+            input->As<RngUser>()->SetRngState(1); // the same mask in both networks
+        }
+        auto h = builder.Tanh(builder.Plus(builder.Times(W, input), builder.Times(R, delay)), msra::strfun::wstrprintf(L"h%d", (int)i));
+        delay->AttachInputs({ h });
+        x = h;
+        if (i == 0)
+            firstLayer = h;
+    }
+
+    auto Wout = builder.CreateLearnableParameter(L"Wout", c_labelDim, c_hiddenDim);
+    auto Whead = builder.CreateLearnableParameter(L"Whead", c_labelDim, c_hiddenDim);
+    auto ce = builder.CrossEntropyWithSoftmax(labels, builder.Times(Wout, x), L"ce");
+    auto ceHead = builder.CrossEntropyWithSoftmax(labels, builder.Times(Whead, firstLayer), L"ceHead");
+    auto criterion = builder.Plus(ce, ceHead, L"criterion");
+    net->AddToNodeGroup(L"criterion", criterion);
+    return net;
+}
+
+static vector<float> ToVector(const Matrix<float>& matrix)
+{
+    return vector<float>(matrix.Data(), matrix.Data() + matrix.GetNumElements());
+}
+
+// runs one minibatch forward and backward, and returns the criterion and the gradients of all parameters
+static map<wstring, vector<float>> TrainOneMinibatch(bool pipelineRecurrentLoops, bool futureValue)
+{
+    Globals::SetRecurrentLoopPipelining(pipelineRecurrentLoops);
+    auto net = CreateStackedNetwork(futureValue);
+    net->CompileNetwork();
+    Globals::SetRecurrentLoopPipelining(false);
+
+    unsigned long seed = 1;
+    for (const auto& node : net->LearnableParameterNodes(net->FinalCriterionNodes().front()))
+        node->As<ComputationNode<float>>()->Value().SetUniformRandomValue(-0.5f, 0.5f, seed++);
+
+    // sequences of different lengths, so that the minibatch has gaps
+    auto layout = net->GetMBLayoutPtrOfNetwork();
+    layout->Init(c_numSequences, c_numTimeSteps);
+    for (size_t s = 0; s < c_numSequences; s++)
+    {
+        size_t length = c_numTimeSteps - 3 * s;
+        layout->AddSequence(s, s, 0, length);
+        if (length < c_numTimeSteps)
+            layout->AddGap(s, length, c_numTimeSteps);
+    }
+    auto& features = net->GetNodeFromName(L"features")->As<ComputationNode<float>>()->Value();
+    features.Resize(c_inputDim, c_numSequences * c_numTimeSteps);
+    features.SetUniformRandomValue(-1.0f, 1.0f, seed++);
+    auto& labels = net->GetNodeFromName(L"labels")->As<ComputationNode<float>>()->Value();
+    labels.Resize(c_labelDim, c_numSequences * c_numTimeSteps);
+    labels.SetValue(0);
+    for (size_t j = 0; j < labels.GetNumCols(); j++)
+        labels.SetValue(j % c_labelDim, j, 1);
+
+    auto criterion = net->FinalCriterionNodes().front();
+    net->AllocateAllMatrices({}, {}, criterion);
+    net->StartEvaluateMinibatchLoop(criterion);
+    for (const auto& input : net->InputNodes(criterion))
+        input->BumpEvalTimeStamp();
+
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+    net->ForwardProp(criterion);
+    net->Backprop(criterion);
+
+    map<wstring, vector<float>> results;
+    results[L"criterion"] = ToVector(criterion->As<ComputationNode<float>>()->Value());
+    for (const auto& node : net->LearnableParameterNodes(criterion))
+        results[node->NodeName()] = ToVector(node->As<ComputationNode<float>>()->Gradient());
+    return results;
+}
+
+static void CheckWavefrontMatchesLoopByLoop(bool futureValue)
+{
+    auto expected = TrainOneMinibatch(/*pipelineRecurrentLoops=*/false, futureValue);
+    auto actual = TrainOneMinibatch(/*pipelineRecurrentLoops=*/true, futureValue);
+
+    BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+    for (const auto& result : expected)
+    {
+        const auto& values = actual[result.first];
+        BOOST_REQUIRE_EQUAL(result.second.size(), values.size());
+        BOOST_CHECK_MESSAGE(AreEqual(result.second.data(), values.data(), values.size(), 1e-5f), "Mismatch in " << msra::strfun::utf8(result.first));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(WavefrontTests)
+
+BOOST_AUTO_TEST_CASE(WavefrontMatchesLoopByLoop)
+{
+    CheckWavefrontMatchesLoopByLoop(/*futureValue=*/false);
+}
+
+// The frames are visited in reverse, so the Dropout in between the layers must not be computed frame by frame.
+BOOST_AUTO_TEST_CASE(WavefrontMatchesLoopByLoopWithFutureValue)
+{
+    CheckWavefrontMatchesLoopByLoop(/*futureValue=*/true);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
@@ -6,11 +6,47 @@
 #include <algorithm>
 #include <boost/scope_exit.hpp>
 #include "Common/ReaderTestHelper.h"
+#include "BinaryChunkDeserializer.h"
+#include "BinaryOutputFile.h"
 
 using namespace Microsoft::MSR::CNTK;
 
+namespace CNTK {
+
+    // Reads all sequences of a file with a single dense stream.
+    class CNTKBinaryReaderTestRunner
+    {
+    public:
+        static std::vector<std::vector<float>> ReadDenseSequences(const wstring& filename, wstring& streamName)
+        {
+            BinaryChunkDeserializer deserializer(filename);
+            deserializer.Initialize({}, DataType::Float);
+
+            auto streams = deserializer.StreamInfos();
+            BOOST_REQUIRE_EQUAL(streams.size(), 1);
+            streamName = streams[0].m_name;
+
+            std::vector<std::vector<float>> result;
+            for (const auto& chunkInfo : deserializer.ChunkInfos())
+            {
+                auto chunk = deserializer.GetChunk(chunkInfo.m_id);
+                for (size_t i = 0; i < chunkInfo.m_numberOfSequences; i++)
+                {
+                    std::vector<SequenceDataPtr> data;
+                    chunk->GetSequence(i, data);
+                    auto values = static_cast<const float*>(data[0]->GetDataBuffer());
+                    result.emplace_back(values, values + data[0]->m_numberOfSamples * streams[0].m_sampleLayout.TotalSize());
+                }
+            }
+            return result;
+        }
+    };
+}
+
 namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
 
+using namespace ::CNTK;
+
 struct CNTKBinaryReaderFixture : ReaderFixture
 {
     CNTKBinaryReaderFixture()
@@ -131,6 +167,52 @@ BOOST_AUTO_TEST_CASE(CNTKBinaryReader_50x20_jagged_sequences_sparse)
         true);
 };
 
+// Output of the "write" command with outputFormat=binary, read back by the reader.
+BOOST_AUTO_TEST_CASE(CNTKBinaryReader_BinaryOutputFile)
+{
+    // Two parallel sequences with interleaved samples of dimension 3, as in a minibatch.
+    const size_t dimension = 3, numParallelSequences = 2, numTimeSteps = 7;
+    std::vector<float> minibatch(dimension * numParallelSequences * numTimeSteps);
+    for (size_t i = 0; i < minibatch.size(); i++)
+        minibatch[i] = i * 0.5f - 10; // exact in half precision
+
+    for (auto elementType : { BinaryOutputFile::ElementType::Float, BinaryOutputFile::ElementType::Float16 })
+    {
+        const string filename = "BinaryOutputFile.bin";
+
+        // Sequences of 1 to 7 samples, small chunks.
+        BinaryOutputFile file(wstring(filename.begin(), filename.end()), L"output", dimension, elementType, 64);
+        for (size_t length = 1; length <= numTimeSteps; length++)
+            file.AddSequence("seq" + std::to_string(length), minibatch.data() + (length % numParallelSequences) * dimension, length, numParallelSequences * dimension);
+        file.Close();
+        BOOST_CHECK_EQUAL(file.GetNumSequences(), numTimeSteps);
+        BOOST_CHECK_EQUAL(file.GetNumSamples(), numTimeSteps * (numTimeSteps + 1) / 2);
+
+        wstring streamName;
+        auto sequences = CNTKBinaryReaderTestRunner::ReadDenseSequences(wstring(filename.begin(), filename.end()), streamName);
+        BOOST_CHECK(streamName == L"output");
+        BOOST_REQUIRE_EQUAL(sequences.size(), numTimeSteps);
+
+        std::ifstream keys(filename + ".keys");
+        for (size_t length = 1; length <= numTimeSteps; length++)
+        {
+            const auto& sequence = sequences[length - 1];
+            BOOST_REQUIRE_EQUAL(sequence.size(), length * dimension);
+            for (size_t t = 0; t < length; t++)
+                for (size_t i = 0; i < dimension; i++)
+                    BOOST_REQUIRE_EQUAL(sequence[t * dimension + i], minibatch[(t * numParallelSequences + length % numParallelSequences) * dimension + i]);
+
+            std::string key;
+            BOOST_REQUIRE(std::getline(keys, key));
+            BOOST_CHECK_EQUAL(key, "seq" + std::to_string(length));
+        }
+        keys.close();
+
+        boost::filesystem::remove(filename);
+        boost::filesystem::remove(filename + ".keys");
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
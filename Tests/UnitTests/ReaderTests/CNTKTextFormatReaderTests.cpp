@@ -86,6 +86,8 @@ BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_Simple_dense)
     };
     test({});
     test({ L"defMBSize=true" });
+    test({ L"prefetchDepth=4" });
+    test({ L"prefetchDepth=3", L"prefetchMaxBytes=1" });
 };
 
 BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_Simple_dense_single_stream)
@@ -138,6 +140,34 @@ BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_MNIST_dense)
     test({ L"defMBSize=true" });
 };
 
+// Several minibatches in flight: the prefetch ring is deeper than the number of packer buffers,
+// so the copies to the device must complete before the packer reuses their memory.
+BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_MNIST_dense_deep_prefetch)
+{
+    auto test = [this](const vector<wstring>& parameters)
+    {
+        HelperRunReaderTest<double>(
+            testDataPath() + "/Config/CNTKTextFormatReader/dense.cntk",
+            testDataPath() + "/Control/CNTKTextFormatReader/MNIST_dense_mb100.txt",
+            testDataPath() + "/Control/CNTKTextFormatReader/MNIST_dense_mb100_Output.txt",
+            "MNIST",
+            "reader",
+            1000, // epoch size
+            100,  // mb size
+            1,   // num epochs
+            1,
+            1,
+            0,
+            1,
+            false, false, true,
+            parameters);
+    };
+
+    test({});
+    test({ L"prefetchDepth=3" });
+    test({ L"prefetchDepth=5" });
+};
+
 // 1 single sample sequence
 BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_1x1_1_dense)
 {
@@ -0,0 +1,131 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include <cstdio>
+#include <boost/scope_exit.hpp>
+#include "Common/ReaderTestHelper.h"
+#include "DSSMDeserializer.h"
+
+using namespace Microsoft::MSR::CNTK;
+
+#pragma warning(disable: 4459) // declaration of 'boost_scope_exit_aux_args' hides global declaration
+
+namespace CNTK { namespace Test {
+
+// Writes a file in the DSSM binary format, row i contains indices [0, i % 4) with value (row + index).
+static void WriteDSSMFile(const std::string& fileName, size_t numRows)
+{
+    std::vector<char> data;
+    std::vector<int64_t> offsets;
+    int64_t totalNnz = 0;
+    for (size_t row = 0; row < numRows; ++row)
+    {
+        offsets.push_back((int64_t)data.size());
+        int32_t nnz = (int32_t)(row % 4);
+        totalNnz += nnz;
+        const char* nnzBytes = (const char*)&nnz;
+        data.insert(data.end(), nnzBytes, nnzBytes + sizeof(nnz));
+        for (int32_t i = 0; i < nnz; ++i)
+        {
+            float value = (float)(row + i);
+            data.insert(data.end(), (const char*)&value, (const char*)&value + sizeof(value));
+        }
+        for (int32_t i = 0; i < nnz; ++i)
+            data.insert(data.end(), (const char*)&i, (const char*)&i + sizeof(i));
+    }
+
+    FILE* f = fopen(fileName.c_str(), "wb");
+    BOOST_REQUIRE(f != nullptr);
+    int64_t rows = (int64_t)numRows;
+    int32_t cols = 10;
+    fwrite(&rows, sizeof(rows), 1, f);
+    fwrite(&cols, sizeof(cols), 1, f);
+    fwrite(&totalNnz, sizeof(totalNnz), 1, f);
+    fwrite(offsets.data(), sizeof(int64_t), offsets.size(), f);
+    fwrite(data.data(), 1, data.size(), f);
+    fclose(f);
+}
+
+BOOST_AUTO_TEST_SUITE(DSSMReaderTestSuite)
+
+BOOST_AUTO_TEST_CASE(DSSMDeserializer_ZeroCopyRows)
+{
+    const size_t numRows = 17;
+    WriteDSSMFile("dssm_query.bin", numRows);
+    WriteDSSMFile("dssm_doc.bin", numRows);
+    BOOST_SCOPE_EXIT(void)
+    {
+        remove("dssm_query.bin");
+        remove("dssm_doc.bin");
+    }
+    BOOST_SCOPE_EXIT_END
+
+    ConfigParameters config;
+    config.Parse("input=[query=[file=dssm_query.bin;dim=10];doc=[file=dssm_doc.bin;dim=10]];chunkSizeInBytes=64");
+    DSSMDeserializer deserializer(std::make_shared<CorpusDescriptor>(true), DSSMConfigHelper(config), true);
+
+    auto streams = deserializer.StreamInfos();
+    BOOST_REQUIRE_EQUAL(streams.size(), 2);
+    BOOST_CHECK(streams[0].m_storageFormat == StorageFormat::SparseCSC);
+
+    auto chunks = deserializer.ChunkInfos();
+    BOOST_REQUIRE(chunks.size() > 1);
+
+    size_t row = 0;
+    for (const auto& chunkInfo : chunks)
+    {
+        std::vector<SequenceInfo> sequences;
+        deserializer.SequenceInfosForChunk(chunkInfo.m_id, sequences);
+        BOOST_REQUIRE_EQUAL(sequences.size(), chunkInfo.m_numberOfSequences);
+
+        auto chunk = deserializer.GetChunk(chunkInfo.m_id);
+        for (const auto& sequence : sequences)
+        {
+            BOOST_REQUIRE_EQUAL(sequence.m_key.m_sequence, row);
+
+            SequenceInfo byKey;
+            BOOST_REQUIRE(deserializer.GetSequenceInfo(sequence, byKey));
+            BOOST_CHECK_EQUAL(byKey.m_chunkId, chunkInfo.m_id);
+            BOOST_CHECK_EQUAL(byKey.m_indexInChunk, sequence.m_indexInChunk);
+
+            std::vector<SequenceDataPtr> data;
+            chunk->GetSequence(sequence.m_indexInChunk, data);
+            BOOST_REQUIRE_EQUAL(data.size(), 2);
+            for (const auto& d : data)
+            {
+                auto sparse = std::static_pointer_cast<SparseSequenceData>(d);
+                BOOST_REQUIRE_EQUAL(sparse->m_totalNnzCount, (SparseIndexType)(row % 4));
+                const float* values = (const float*)sparse->GetDataBuffer();
+                for (SparseIndexType i = 0; i < sparse->m_totalNnzCount; ++i)
+                {
+                    BOOST_CHECK_EQUAL(sparse->m_indices[i], i);
+                    BOOST_CHECK_EQUAL(values[i], (float)(row + i));
+                }
+            }
+            row++;
+        }
+    }
+    BOOST_CHECK_EQUAL(row, numRows);
+}
+
+BOOST_AUTO_TEST_CASE(DSSMDeserializer_MismatchedRowCounts)
+{
+    WriteDSSMFile("dssm_query.bin", 5);
+    WriteDSSMFile("dssm_doc.bin", 6);
+    BOOST_SCOPE_EXIT(void)
+    {
+        remove("dssm_query.bin");
+        remove("dssm_doc.bin");
+    }
+    BOOST_SCOPE_EXIT_END
+
+    ConfigParameters config;
+    config.Parse("input=[query=[file=dssm_query.bin;dim=10];doc=[file=dssm_doc.bin;dim=10]]");
+    BOOST_CHECK_THROW(DSSMDeserializer(std::make_shared<CorpusDescriptor>(true), DSSMConfigHelper(config), true), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}
@@ -10,6 +10,8 @@
 #include "NoRandomizer.h"
 #include "DataDeserializer.h"
 #include "BlockRandomizer.h"
+#include "LTTumblingWindowRandomizer.h"
+#include "SequenceDecoder.h"
 #include "CorpusDescriptor.h"
 #include "FramePacker.h"
 #include "SequencePacker.h"
@@ -17,6 +19,11 @@
 #include "CudaMemoryProvider.h"
 #include "HeapMemoryProvider.h"
 #include "BufferedFileReader.h"
+#include "ChunkStatistics.h"
+#include "ReaderBase.h"
+#include "ReaderShim.h"
+#include <atomic>
+#include <thread>
 
 #pragma warning(push)
 // disable warning about possible mod 0 operation in uniform_int_distribution
@@ -68,6 +75,13 @@ public:
         result.push_back(data);
     }
 
+    void SequenceInfos(vector<SequenceInfo>& result) override
+    {
+        auto chunkId = (ChunkIdType)(m_chunkBegin / (m_chunkEnd - m_chunkBegin));
+        for (size_t i = m_chunkBegin; i < m_chunkEnd; i++)
+            result.push_back(SequenceInfo{ i, m_sequenceLength, chunkId, { 0, static_cast<uint32_t>(i) } });
+    }
+
     ~MockChunk() override {};
 };
 
@@ -87,7 +101,7 @@ public:
     MockDeserializer(size_t numChunks, size_t numSequencesPerChunks, const vector<float>& data, uint32_t sequenceLength = 1)
         : m_numChunks(numChunks),
           m_numSequencesPerChunk(numSequencesPerChunks),
-          m_sampleShape(NDShape(1)),
+          m_sampleShape(NDShape({ 1 })),
           m_sequenceLength(sequenceLength)
     {
         m_sequenceData.reserve(data.size());
@@ -1201,6 +1215,311 @@ BOOST_AUTO_TEST_CASE(CheckNoDegenerateMinibatches)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ChunkStatisticsMatchDirectComputation)
+{
+    // a large offset, which a naive sum of squares would not survive in single precision
+    const size_t numChunks = 7, numSequencesPerChunk = 13;
+    const uint32_t sequenceLength = 3;
+    vector<float> data(numChunks * numSequencesPerChunk);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = 1e6f + (i % 17) * 0.5f;
+    auto deserializer = make_shared<MockDeserializer>(numChunks, numSequencesPerChunk, data, sequenceLength);
+
+    double expectedMean = accumulate(data.begin(), data.end(), 0.0) / data.size();
+    double expectedVariance = 0;
+    for (auto d : data)
+        expectedVariance += (d - expectedMean) * (d - expectedMean);
+    expectedVariance /= data.size();
+
+    BOOST_REQUIRE(CanComputeChunkStatistics(deserializer, { L"input" }));
+    BOOST_CHECK(!CanComputeChunkStatistics(deserializer, { L"input", L"labels" }));
+
+    map<wstring, StreamStatistics> statistics;
+    ComputeChunkStatistics(deserializer, { L"input" }, 0, 1, statistics);
+    const auto& total = statistics.at(L"input");
+    BOOST_CHECK_EQUAL(total.GetCount(), data.size() * sequenceLength);
+    BOOST_CHECK_CLOSE(total.GetMean()[0], expectedMean, 1e-10);
+    BOOST_CHECK_CLOSE(total.GetVariance()[0], expectedVariance, 1e-8);
+
+    // the shares of two workers merge into the same result
+    map<wstring, StreamStatistics> first, second;
+    ComputeChunkStatistics(deserializer, { L"input" }, 0, 2, first);
+    ComputeChunkStatistics(deserializer, { L"input" }, 1, 2, second);
+    BOOST_CHECK_EQUAL(first.at(L"input").GetCount() + second.at(L"input").GetCount(), total.GetCount());
+    auto merged = first.at(L"input");
+    merged.Merge(second.at(L"input"));
+    BOOST_CHECK_EQUAL(merged.GetCount(), total.GetCount());
+    BOOST_CHECK_CLOSE(merged.GetMean()[0], expectedMean, 1e-10);
+    BOOST_CHECK_CLOSE(merged.GetVariance()[0], expectedVariance, 1e-8);
+
+    // a single worker is unchanged by merging across workers
+    auto single = total;
+    single.MergeAcrossWorkers([](vector<double>&) {});
+    BOOST_CHECK_EQUAL(single.GetCount(), total.GetCount());
+    BOOST_CHECK_CLOSE(single.GetMean()[0], expectedMean, 1e-10);
+    BOOST_CHECK_CLOSE(single.GetVariance()[0], expectedVariance, 1e-8);
+
+    // the fingerprint depends on the chunk table
+    auto other = make_shared<MockDeserializer>(numChunks, numSequencesPerChunk, data, sequenceLength + 1);
+    BOOST_CHECK_EQUAL(ComputeChunkTableFingerprint(deserializer, { L"input" }), ComputeChunkTableFingerprint(deserializer, { L"input" }));
+    BOOST_CHECK_NE(ComputeChunkTableFingerprint(deserializer, { L"input" }), ComputeChunkTableFingerprint(other, { L"input" }));
+}
+
+// Detects GetChunk() calls that overlap, which deserializers do not have to support.
+class ExclusiveChunkDeserializer : public MockDeserializer
+{
+public:
+    ExclusiveChunkDeserializer(size_t numChunks, size_t numSequencesPerChunks, const vector<float>& data)
+        : MockDeserializer(numChunks, numSequencesPerChunks, data), m_numLoading(0), m_overlapped(false)
+    {}
+
+    ChunkPtr GetChunk(ChunkIdType chunkId) override
+    {
+        if (++m_numLoading > 1)
+            m_overlapped = true;
+        this_thread::sleep_for(chrono::milliseconds(1));
+        auto chunk = MockDeserializer::GetChunk(chunkId);
+        --m_numLoading;
+        return chunk;
+    }
+
+    bool Overlapped() const { return m_overlapped; }
+
+private:
+    atomic<int> m_numLoading;
+    atomic<bool> m_overlapped;
+};
+
+// Reader over a deserializer with a block randomizer that loads chunks ahead.
+class MockReader : public ReaderBase
+{
+public:
+    MockReader(DataDeserializerPtr deserializer, size_t randomizationWindow)
+    {
+        m_deserializer = deserializer;
+        m_sequenceEnumerator = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true);
+        m_packer = make_shared<SequencePacker>(m_sequenceEnumerator, deserializer->StreamInfos());
+    }
+};
+
+BOOST_AUTO_TEST_CASE(ReaderShimStreamStatisticsDuringMinibatchLoop)
+{
+    const size_t numChunks = 20, numSequencesPerChunk = 10, minibatchSize = 7;
+    vector<float> data(numChunks * numSequencesPerChunk);
+    iota(data.begin(), data.end(), 0.0f);
+
+    // Reads an epoch, optionally computing the statistics while minibatches are read ahead.
+    auto readEpoch = [&](bool computeStatistics)
+    {
+        auto deserializer = make_shared<ExclusiveChunkDeserializer>(numChunks, numSequencesPerChunk, data);
+        auto shim = new ReaderShim<float>(make_shared<MockReader>(deserializer, 2 * numSequencesPerChunk));
+        ConfigParameters config;
+        config.Parse("prefetchDepth=3");
+        shim->Init(config);
+
+        StreamMinibatchInputs inputs;
+        inputs.AddInput(L"input", make_shared<Matrix<float>>(CPUDEVICE), make_shared<MBLayout>(), TensorShape(1));
+        shim->StartMinibatchLoop(minibatchSize, 0, inputs.GetStreamDescriptions(), data.size());
+
+        vector<float> result;
+        for (size_t i = 0; shim->GetMinibatch(inputs); i++)
+        {
+            const auto& matrix = inputs.GetInputMatrix<float>(L"input");
+            unique_ptr<float[]> values(matrix.CopyToArray());
+            result.insert(result.end(), values.get(), values.get() + matrix.GetNumElements());
+
+            if (computeStatistics && i == 2)
+            {
+                map<wstring, StreamStatistics> statistics;
+                shim->ComputeStreamStatistics({ L"input" }, 0, 1, statistics);
+                BOOST_CHECK_EQUAL(statistics.at(L"input").GetCount(), data.size());
+            }
+        }
+
+        shim->Destroy();
+        BOOST_CHECK(!deserializer->Overlapped());
+        return result;
+    };
+
+    // Reading continues from the last minibatch consumed before the statistics.
+    auto expected = readEpoch(false);
+    BOOST_CHECK_EQUAL(expected.size(), data.size());
+    auto actual = readEpoch(true);
+    BOOST_CHECK_EQUAL_COLLECTIONS(actual.begin(), actual.end(), expected.begin(), expected.end());
+}
+
+// the samples of the first stream followed by the end of sweep and end of epoch flags
+static vector<float> FlattenSequences(const Sequences& sequences)
+{
+    vector<float> result;
+    if (!sequences.m_data.empty())
+    {
+        for (const auto& sequence : sequences.m_data.front())
+        {
+            const float* data = static_cast<const float*>(sequence->GetDataBuffer());
+            result.insert(result.end(), data, data + sequence->m_numberOfSamples);
+        }
+    }
+    result.push_back(sequences.m_endOfSweep ? 1.0f : 0.0f);
+    result.push_back(sequences.m_endOfEpoch ? 1.0f : 0.0f);
+    return result;
+}
+
+// Reads an epoch from a randomizer that reads sequences ahead on the threads of a SequenceDecoder, and from one that does not.
+// The minibatch size changes now and then, which drops the minibatches read ahead. Then rolls back to a checkpoint.
+static void CheckStreamingDeserialization(SequenceEnumerator& expected, SequenceEnumerator& streaming, const EpochConfiguration& config)
+{
+    auto minibatchSize = [](size_t i) { return i % 7 == 6 ? (size_t)3 : (size_t)10; };
+    const size_t checkpointAt = 5;
+
+    expected.StartEpoch(config);
+    streaming.StartEpoch(config);
+
+    map<wstring, size_t> checkpoint;
+    vector<vector<float>> afterCheckpoint;
+    for (size_t i = 0;; i++)
+    {
+        if (i == checkpointAt)
+        {
+            checkpoint = streaming.GetState();
+            BOOST_REQUIRE(checkpoint == expected.GetState());
+        }
+
+        auto expectedSequences = FlattenSequences(expected.GetNextSequences(minibatchSize(i), minibatchSize(i)));
+        auto streamedSequences = FlattenSequences(streaming.GetNextSequences(minibatchSize(i), minibatchSize(i)));
+        BOOST_REQUIRE(expectedSequences == streamedSequences);
+
+        if (i >= checkpointAt)
+            afterCheckpoint.push_back(streamedSequences);
+        if (streamedSequences.back() != 0) // end of epoch
+            break;
+    }
+
+    streaming.SetState(checkpoint);
+    for (size_t i = 0; i < afterCheckpoint.size(); i++)
+    {
+        size_t size = minibatchSize(checkpointAt + i);
+        BOOST_REQUIRE(FlattenSequences(streaming.GetNextSequences(size, size)) == afterCheckpoint[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(StreamingDeserializationMatchesRandomizers)
+{
+    const size_t numChunks = 20, numSequencesPerChunk = 10;
+    const uint32_t sequenceLength = 2;
+    vector<float> data(numChunks * numSequencesPerChunk);
+    iota(data.begin(), data.end(), 0.0f);
+    auto deserializer = make_shared<MockDeserializer>(numChunks, numSequencesPerChunk, data, sequenceLength);
+    const size_t sweepSize = data.size() * sequenceLength;
+
+    auto decoder = []() { return make_shared<SequenceDecoder>(1, /*minibatchesAhead =*/ 2, /*numberOfThreads =*/ 3); };
+
+    for (size_t numberOfWorkers : { 1, 3 })
+    {
+        EpochConfiguration config;
+        config.m_numberOfWorkers = numberOfWorkers;
+        config.m_workerRank = numberOfWorkers - 1;
+        config.m_minibatchSizeInSamples = 10;
+        config.m_totalEpochSizeInSamples = sweepSize * 3 / 2;
+        config.m_allowMinibatchesToCrossSweepBoundaries = true;
+
+        for (size_t epoch = 0; epoch < 2; epoch++)
+        {
+            config.m_epochIndex = epoch;
+
+            BlockRandomizer block(0, 5, deserializer, true, false, 0, false, 0);
+            BlockRandomizer streamingBlock(0, 5, deserializer, true, false, 0, false, 0, false, 0, decoder());
+            CheckStreamingDeserialization(block, streamingBlock, config);
+
+            NoRandomizer no(deserializer);
+            NoRandomizer streamingNo(deserializer, false, 0, decoder());
+            CheckStreamingDeserialization(no, streamingNo, config);
+        }
+
+        // local timeline randomizers have a single epoch
+        config.m_epochIndex = 0;
+        LTTumblingWindowRandomizer local(deserializer, false, 5);
+        LTTumblingWindowRandomizer streamingLocal(deserializer, false, 5, 0, false, 0, decoder());
+        CheckStreamingDeserialization(local, streamingLocal, config);
+    }
+}
+
+// Detects sequences that are read while a chunk is loaded.
+class ChunkLoadingDeserializer : public MockDeserializer
+{
+    class LoadedChunk : public Chunk
+    {
+    public:
+        LoadedChunk(ChunkLoadingDeserializer& parent, ChunkPtr chunk) : m_parent(parent), m_chunk(chunk)
+        {}
+
+        void GetSequence(size_t sequenceIndex, vector<SequenceDataPtr>& result) override
+        {
+            if (m_parent.m_loading)
+                m_parent.m_overlapped = true;
+            this_thread::sleep_for(chrono::microseconds(100));
+            m_chunk->GetSequence(sequenceIndex, result);
+        }
+
+    private:
+        ChunkLoadingDeserializer& m_parent;
+        ChunkPtr m_chunk;
+    };
+
+public:
+    ChunkLoadingDeserializer(size_t numChunks, size_t numSequencesPerChunks, const vector<float>& data)
+        : MockDeserializer(numChunks, numSequencesPerChunks, data), m_loading(false), m_overlapped(false)
+    {}
+
+    ChunkPtr GetChunk(ChunkIdType chunkId) override
+    {
+        m_loading = true;
+        this_thread::sleep_for(chrono::milliseconds(1));
+        auto chunk = make_shared<LoadedChunk>(*this, MockDeserializer::GetChunk(chunkId));
+        m_loading = false;
+        return chunk;
+    }
+
+    bool Overlapped() const { return m_overlapped; }
+
+private:
+    atomic<bool> m_loading;
+    atomic<bool> m_overlapped;
+};
+
+BOOST_AUTO_TEST_CASE(StreamingDeserializationLoadsChunksExclusively)
+{
+    const size_t numChunks = 20, numSequencesPerChunk = 10;
+    vector<float> data(numChunks * numSequencesPerChunk);
+    iota(data.begin(), data.end(), 0.0f);
+    auto deserializer = make_shared<ChunkLoadingDeserializer>(numChunks, numSequencesPerChunk, data);
+    auto guarded = make_shared<ChunkLoadingGuard>(deserializer);
+
+    EpochConfiguration config;
+    config.m_numberOfWorkers = 1;
+    config.m_workerRank = 0;
+    config.m_minibatchSizeInSamples = 10;
+    config.m_totalEpochSizeInSamples = data.size();
+    config.m_epochIndex = 0;
+
+    BlockRandomizer expected(0, 2, make_shared<MockDeserializer>(numChunks, numSequencesPerChunk, data), true, false, 0, false, 0);
+    BlockRandomizer streaming(0, 2, guarded, true, false, 0, false, 0, false, 0,
+                              make_shared<SequenceDecoder>(1, /*minibatchesAhead =*/ 3, /*numberOfThreads =*/ 4));
+    expected.StartEpoch(config);
+    streaming.StartEpoch(config);
+
+    for (;;)
+    {
+        auto expectedSequences = FlattenSequences(expected.GetNextSequences(10, 10));
+        auto streamedSequences = FlattenSequences(streaming.GetNextSequences(10, 10));
+        BOOST_REQUIRE(expectedSequences == streamedSequences);
+        if (streamedSequences.back() != 0) // end of epoch
+            break;
+    }
+
+    BOOST_CHECK(!deserializer->Overlapped());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(PackerTests)
@@ -1627,6 +1946,104 @@ BOOST_AUTO_TEST_CASE(SequencePackerSmallChunksWithSequences1Sweep)
     }
 }
 
+BOOST_AUTO_TEST_CASE(SequencePackerLengthBucketingWithSequences1Sweep)
+{
+    size_t chunkSizeInSamples = 998;
+    size_t sweepNumberOfSamples = 21335;
+    uint32_t maxSequenceLength = 300;
+    size_t randomizationWindow = chunkSizeInSamples * 5;
+
+    auto deserializer = make_shared<SequentialDeserializer>(0, chunkSizeInSamples, sweepNumberOfSamples, maxSequenceLength);
+
+    // Bucketing must not change the epoch sizes, the partitioning of chunks between workers or the data of a sweep.
+    auto blockRandomizer = make_shared<BlockRandomizer>(0, randomizationWindow, deserializer, true, false, 0, true, 0, true);
+    PackerPtr packer = std::make_shared<SequencePacker>(blockRandomizer, deserializer->StreamInfos(), 1, true, nullptr, true);
+
+    CheckPackerOnSweep(packer, blockRandomizer, deserializer, 1, 64, false, true);
+    CheckPackerOnSweep(packer, blockRandomizer, deserializer, 5, 64, false, true);
+}
+
+// Returns the number of columns of all minibatches of a sweep, fills in the first sample of all sequences.
+static size_t GetNumberOfColumnsInSweep(size_t sweepNumberOfSamples, size_t minibatchSize, bool bucketByLength, std::multiset<float>& sequences,
+                                        size_t lengthBucketSizeInSamples = 0, size_t* numberOfMinibatches = nullptr)
+{
+    // Chunks are much bigger than minibatches, so that every chunk gets split into many buckets.
+    auto deserializer = make_shared<SequentialDeserializer>(0, 20000, sweepNumberOfSamples, 200);
+    auto randomizer = make_shared<BlockRandomizer>(0, 40000, deserializer, true, false, 0, true, 0, bucketByLength, lengthBucketSizeInSamples);
+    auto packer = std::make_shared<SequencePacker>(randomizer, deserializer->StreamInfos(), 1, false);
+
+    EpochConfiguration config;
+    config.m_minibatchSizeInSamples = minibatchSize;
+    config.m_truncationSize = 0;
+    config.m_epochIndex = 0;
+    config.m_totalEpochSizeInSamples = sweepNumberOfSamples;
+    config.m_numberOfWorkers = 1;
+    config.m_workerRank = 0;
+    packer->SetConfiguration(config, std::vector<MemoryProviderPtr> { std::make_shared<HeapMemoryProvider>() });
+    randomizer->StartEpoch(config);
+
+    size_t numberOfColumns = 0, numberOfSamples = 0;
+    if (numberOfMinibatches)
+        *numberOfMinibatches = 0;
+    for (;;)
+    {
+        auto minibatch = packer->ReadMinibatch();
+        if (!minibatch.m_data.empty())
+        {
+            if (numberOfMinibatches)
+                (*numberOfMinibatches)++;
+
+            const auto& layout = minibatch.m_data.front()->m_layout;
+            const float* data = (const float*)minibatch.m_data.front()->m_data;
+            numberOfColumns += layout->GetNumCols();
+            numberOfSamples += layout->GetActualNumSamples();
+            for (const auto& s : layout->GetAllSequences())
+            {
+                if (s.seqId != GAP_SEQUENCE_ID)
+                    sequences.insert(data[layout->GetColumnIndex(s, 0)]);
+            }
+        }
+
+        if (minibatch.m_endOfEpoch)
+            break;
+    }
+
+    BOOST_REQUIRE_EQUAL(numberOfSamples, sweepNumberOfSamples);
+    return numberOfColumns;
+}
+
+BOOST_AUTO_TEST_CASE(SequencePackerLengthBucketingReducesPadding)
+{
+    size_t sweepNumberOfSamples = 100000;
+    size_t minibatchSize = 1000;
+
+    std::multiset<float> sequences, bucketedSequences;
+    size_t columns = GetNumberOfColumnsInSweep(sweepNumberOfSamples, minibatchSize, false, sequences);
+    size_t bucketedColumns = GetNumberOfColumnsInSweep(sweepNumberOfSamples, minibatchSize, true, bucketedSequences);
+
+    BOOST_REQUIRE(sequences == bucketedSequences);
+    BOOST_TEST_MESSAGE("Padding efficiency without bucketing " << 100.0 * sweepNumberOfSamples / columns
+                       << "%, with bucketing " << 100.0 * sweepNumberOfSamples / bucketedColumns << "%");
+
+    // Minibatches are aligned on buckets of sequences of similar length, so there is hardly any padding left.
+    BOOST_CHECK(bucketedColumns < columns);
+    BOOST_CHECK(bucketedColumns < sweepNumberOfSamples * 1.1);
+}
+
+BOOST_AUTO_TEST_CASE(SequencePackerLengthBucketsSmallerThanMinibatch)
+{
+    size_t sweepNumberOfSamples = 100000;
+    size_t minibatchSize = 1000;
+
+    // Several buckets fit into a minibatch, so minibatches must not be cut at every bucket.
+    std::multiset<float> sequences;
+    size_t numberOfMinibatches = 0;
+    GetNumberOfColumnsInSweep(sweepNumberOfSamples, minibatchSize, true, sequences, minibatchSize / 4, &numberOfMinibatches);
+
+    BOOST_TEST_MESSAGE("Average minibatch size " << sweepNumberOfSamples / numberOfMinibatches << " samples");
+    BOOST_CHECK(numberOfMinibatches < 2 * sweepNumberOfSamples / minibatchSize);
+}
+
 ////
 ////
 //// On two sweeps
@@ -10,6 +10,8 @@
 #include "Index.h"
 #include "Platform.h"
 #include "IndexBuilder.h"
+#include "IndexCache.h"
+#include "MappedFile.h"
 #include "ReaderUtil.h"
 #include "Common/ReaderTestHelper.h"
 #include <boost/algorithm/string/replace.hpp>
@@ -724,6 +726,97 @@ BOOST_AUTO_TEST_CASE(Index_with_caching)
     CheckIdentical(index, cachedIndex);
 }
 
+BOOST_AUTO_TEST_CASE(Index_cache_round_trip)
+{
+    auto filename = L"cache.test.tmp";
+    auto cacheFilename = L"cache.test.tmp.cache";
+    CreateTestFile(s_textData, filename);
+
+    vector<IndexedSequence> records(3);
+    for (size_t i = 0; i < records.size(); i++)
+        records[i].SetKey(i).SetNumberOfSamples(uint32_t(i + 1)).SetOffset(i * 16).SetSize(16);
+
+    IndexCache(filename, cacheFilename, 1, "options").WriteAsync(vector<IndexedSequence>(records), "strings");
+    // Cache is written out asynchronously in a separate thread, 
+    Sleep(1000);  // sleep for a second to give enough time to finish writing.
+
+    {
+        IndexCache cache(filename, cacheFilename, 1, "options");
+        BOOST_REQUIRE(cache.TryLoad());
+        BOOST_REQUIRE_EQUAL(cache.NumberOfRecords(), records.size());
+        BOOST_REQUIRE_EQUAL(string(cache.Strings(), cache.StringsSize()), "strings");
+        for (size_t i = 0; i < records.size(); i++)
+            BOOST_REQUIRE_EQUAL(cache.Records<IndexedSequence>()[i].Key(), i);
+    }
+
+    // A cache written with a different version or options is ignored.
+    BOOST_REQUIRE(!IndexCache(filename, cacheFilename, 2, "options").TryLoad());
+    BOOST_REQUIRE(!IndexCache(filename, cacheFilename, 1, "other options").TryLoad());
+
+    // So is a cache of a modified input.
+    CreateTestFile(s_textData + "\n", filename);
+    BOOST_REQUIRE(!IndexCache(filename, cacheFilename, 1, "options").TryLoad());
+
+    _wunlink(filename);
+    _wunlink(cacheFilename);
+}
+
+#ifndef _WIN32
+// A directory can be opened and stat-ed, but not mapped: the descriptor must not leak when mapping fails.
+BOOST_AUTO_TEST_CASE(MappedFile_failure_releases_descriptor)
+{
+    auto numberOfOpenDescriptors = []()
+    {
+        return distance(boost::filesystem::directory_iterator("/proc/self/fd"), boost::filesystem::directory_iterator());
+    };
+
+    boost::filesystem::create_directory("mapped.test.dir");
+    auto before = numberOfOpenDescriptors();
+    for (int i = 0; i < 10; i++)
+        BOOST_REQUIRE_THROW(MappedFile(L"mapped.test.dir"), std::runtime_error);
+    BOOST_REQUIRE_EQUAL(numberOfOpenDescriptors(), before);
+
+    boost::filesystem::remove("mapped.test.dir");
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(Index_line_aligned_ranges)
+{
+    auto filename = L"ranges.test.tmp";
+    CreateTestFile(s_textData, filename);
+
+    for (size_t numberOfRanges : { 1, 2, 3, 7, 10, 1000 })
+    {
+        auto ranges = SplitIntoLineAlignedRanges(filename, s_textData.size(), numberOfRanges);
+        BOOST_REQUIRE(ranges.size() >= 2);
+        BOOST_REQUIRE(ranges.size() <= numberOfRanges + 1);
+        BOOST_REQUIRE_EQUAL(ranges.front(), 0);
+        BOOST_REQUIRE_EQUAL(ranges.back(), s_textData.size());
+
+        // Each range starts at the beginning of a line and reading a range from its start offset
+        // yields the same lines as reading the whole file.
+        auto f = FileWrapper::OpenOrDie(filename, L"rb");
+        BufferedFileReader wholeFile(7, f);
+        for (size_t i = 0; i + 1 < ranges.size(); i++)
+        {
+            BOOST_REQUIRE(ranges[i] < ranges[i + 1]);
+            BOOST_REQUIRE(ranges[i] == 0 || s_textData[ranges[i] - 1] == g_eol);
+
+            BufferedFileReader range(7, FileWrapper::OpenOrDie(filename, L"rb"), ranges[i]);
+            string expected, actual;
+            while (range.GetFileOffset() < ranges[i + 1] && range.TryReadLine(actual))
+            {
+                BOOST_REQUIRE(wholeFile.TryReadLine(expected));
+                BOOST_REQUIRE_EQUAL(actual, expected);
+            }
+            BOOST_REQUIRE_EQUAL(range.GetFileOffset(), wholeFile.GetFileOffset());
+        }
+        BOOST_REQUIRE(wholeFile.Empty());
+    }
+
+    _wunlink(filename);
+}
+
 BOOST_AUTO_TEST_CASE(Index_64MB_with_caching_check_perf)
 {
     auto content = s_textData;
@@ -0,0 +1,283 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include <chrono>
+#include <random>
+#include "SequencePacker.h"
+#include "HeapMemoryProvider.h"
+
+using namespace Microsoft::MSR::CNTK;
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+using namespace ::CNTK;
+
+struct BenchmarkDenseSequenceData : DenseSequenceData
+{
+    BenchmarkDenseSequenceData(const NDShape& shape) : m_sampleShape(shape)
+    {}
+
+    const void* GetDataBuffer() override
+    {
+        return m_values.data();
+    }
+
+    const NDShape& GetSampleShape() override
+    {
+        return m_sampleShape;
+    }
+
+    vector<float> m_values;
+    NDShape m_sampleShape;
+};
+
+struct BenchmarkSparseSequenceData : SparseSequenceData
+{
+    BenchmarkSparseSequenceData(const NDShape& shape) : m_sampleShape(shape)
+    {}
+
+    const void* GetDataBuffer() override
+    {
+        return m_values.data();
+    }
+
+    const NDShape& GetSampleShape() override
+    {
+        return m_sampleShape;
+    }
+
+    vector<float> m_values;
+    vector<SparseIndexType> m_indexStorage;
+    NDShape m_sampleShape;
+};
+
+// Returns the same pregenerated set of variable length sequences on every call:
+// one dense stream followed by a number of sparse streams.
+class FixedSequenceEnumerator : public SequenceEnumerator
+{
+public:
+    FixedSequenceEnumerator(size_t numberOfSequences, size_t maxSequenceLength,
+        size_t denseDimension, size_t numberOfSparseStreams, size_t sparseDimension, size_t maxNnzPerSample)
+    {
+        std::mt19937 rng(17);
+        vector<size_t> lengths(numberOfSequences);
+        for (auto& l : lengths)
+            l = 1 + rng() % maxSequenceLength;
+
+        NDShape denseShape({ denseDimension });
+        m_streams.push_back(CreateStream(L"dense", StorageFormat::Dense, denseShape));
+        m_sequences.m_data.push_back({});
+        for (size_t i = 0; i < numberOfSequences; ++i)
+        {
+            auto sequence = make_shared<BenchmarkDenseSequenceData>(denseShape);
+            sequence->m_numberOfSamples = (unsigned int)lengths[i];
+            sequence->m_elementType = DataType::Float;
+            sequence->m_key.m_sequence = i;
+            sequence->m_values.resize(lengths[i] * denseDimension);
+            for (size_t j = 0; j < sequence->m_values.size(); ++j)
+                sequence->m_values[j] = (float)(i * 1000 + j);
+            m_sequences.m_data.back().push_back(sequence);
+        }
+
+        NDShape sparseShape({ sparseDimension });
+        for (size_t s = 0; s < numberOfSparseStreams; ++s)
+        {
+            m_streams.push_back(CreateStream(L"sparse" + to_wstring(s), StorageFormat::SparseCSC, sparseShape));
+            m_sequences.m_data.push_back({});
+            for (size_t i = 0; i < numberOfSequences; ++i)
+            {
+                auto sequence = make_shared<BenchmarkSparseSequenceData>(sparseShape);
+                sequence->m_numberOfSamples = (unsigned int)lengths[i];
+                sequence->m_elementType = DataType::Float;
+                sequence->m_key.m_sequence = i;
+                for (size_t j = 0; j < lengths[i]; ++j)
+                {
+                    // Some samples are empty on purpose.
+                    SparseIndexType nnz = (SparseIndexType)(rng() % (maxNnzPerSample + 1));
+                    sequence->m_nnzCounts.push_back(nnz);
+                    for (SparseIndexType k = 0; k < nnz; ++k)
+                    {
+                        sequence->m_indexStorage.push_back((SparseIndexType)(rng() % sparseDimension));
+                        sequence->m_values.push_back((float)(s * 1000000 + sequence->m_values.size()));
+                    }
+                }
+                sequence->m_totalNnzCount = (SparseIndexType)sequence->m_values.size();
+                sequence->m_indices = sequence->m_indexStorage.data();
+                m_sequences.m_data.back().push_back(sequence);
+            }
+        }
+    }
+
+    vector<StreamInformation> GetStreamDescriptions() const override
+    {
+        return m_streams;
+    }
+
+    void StartEpoch(const EpochConfiguration&) override {}
+    void SetConfiguration(const ReaderConfiguration&) override {}
+    void SetState(const map<wstring, size_t>&) override {}
+    map<wstring, size_t> GetState() override { return map<wstring, size_t>(); }
+
+    Sequences GetNextSequences(size_t, size_t) override
+    {
+        return m_sequences;
+    }
+
+    const Sequences& AllSequences() const
+    {
+        return m_sequences;
+    }
+
+private:
+    StreamInformation CreateStream(const wstring& name, StorageFormat format, const NDShape& shape)
+    {
+        StreamInformation stream;
+        stream.m_id = m_streams.size();
+        stream.m_name = name;
+        stream.m_storageFormat = format;
+        stream.m_elementType = DataType::Float;
+        stream.m_sampleLayout = shape;
+        return stream;
+    }
+
+    vector<StreamInformation> m_streams;
+    Sequences m_sequences;
+};
+
+static SequencePackerPtr CreateBenchmarkPacker(SequenceEnumeratorPtr enumerator, size_t minibatchSize)
+{
+    auto streams = enumerator->GetStreamDescriptions();
+    auto packer = make_shared<SequencePacker>(enumerator, streams);
+
+    EpochConfiguration config;
+    config.m_minibatchSizeInSamples = minibatchSize;
+    config.m_numberOfWorkers = 1;
+    config.m_workerRank = 0;
+    config.m_totalEpochSizeInSamples = minibatchSize;
+    config.m_epochIndex = 0;
+
+    vector<MemoryProviderPtr> providers(streams.size(), make_shared<HeapMemoryProvider>());
+    packer->SetConfiguration(config, providers);
+    return packer;
+}
+
+// Checks the packed minibatch against the source sequences.
+static void VerifyPackedMinibatch(const Minibatch& minibatch, const Sequences& sequences, size_t denseDimension)
+{
+    BOOST_REQUIRE_EQUAL(minibatch.m_data.size(), sequences.m_data.size());
+
+    // Dense stream.
+    {
+        const auto& layout = minibatch.m_data[0]->m_layout;
+        const float* data = (const float*)minibatch.m_data[0]->m_data;
+        for (const auto& s : layout->GetAllSequences())
+        {
+            if (s.seqId == GAP_SEQUENCE_ID)
+                continue;
+
+            auto source = static_pointer_cast<BenchmarkDenseSequenceData>(sequences.m_data[0][s.seqId]);
+            for (size_t t = 0; t < s.GetNumTimeSteps(); ++t)
+            {
+                size_t column = layout->GetColumnIndex(s, t);
+                BOOST_REQUIRE(equal(source->m_values.begin() + t * denseDimension,
+                    source->m_values.begin() + (t + 1) * denseDimension,
+                    data + column * denseDimension));
+            }
+        }
+    }
+
+    // Sparse streams: nnz count, values, row indices, column indices.
+    for (size_t streamIndex = 1; streamIndex < minibatch.m_data.size(); ++streamIndex)
+    {
+        const auto& layout = minibatch.m_data[streamIndex]->m_layout;
+        const char* buffer = (const char*)minibatch.m_data[streamIndex]->m_data;
+        size_t nnzCount = *(const size_t*)buffer;
+        const float* values = (const float*)(buffer + sizeof(size_t));
+        const IndexType* rowIndices = (const IndexType*)(values + nnzCount);
+        const IndexType* columnIndices = rowIndices + nnzCount;
+
+        BOOST_REQUIRE_EQUAL(columnIndices[0], 0);
+        BOOST_REQUIRE_EQUAL((size_t)columnIndices[layout->GetNumCols()], nnzCount);
+
+        size_t totalNnz = 0;
+        for (const auto& s : layout->GetAllSequences())
+        {
+            if (s.seqId == GAP_SEQUENCE_ID)
+                continue;
+
+            auto source = static_pointer_cast<BenchmarkSparseSequenceData>(sequences.m_data[streamIndex][s.seqId]);
+            size_t sourceOffset = 0;
+            for (size_t t = 0; t < s.GetNumTimeSteps(); ++t)
+            {
+                size_t column = layout->GetColumnIndex(s, t);
+                IndexType begin = columnIndices[column];
+                IndexType end = columnIndices[column + 1];
+                BOOST_REQUIRE_EQUAL(end - begin, source->m_nnzCounts[t]);
+                for (IndexType k = begin; k < end; ++k, ++sourceOffset)
+                {
+                    BOOST_REQUIRE_EQUAL(values[k], source->m_values[sourceOffset]);
+                    BOOST_REQUIRE_EQUAL(rowIndices[k], source->m_indexStorage[sourceOffset]);
+                }
+            }
+            totalNnz += sourceOffset;
+        }
+        BOOST_REQUIRE_EQUAL(totalNnz, nnzCount);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(SequencePackerBenchmark)
+
+BOOST_AUTO_TEST_CASE(SequencePackerMultiStreamPacking)
+{
+    const size_t denseDimension = 16;
+    auto enumerator = make_shared<FixedSequenceEnumerator>(300, 20, denseDimension, 5, 100000, 30);
+    auto packer = CreateBenchmarkPacker(enumerator, SIZE_MAX);
+
+    auto minibatch = packer->ReadMinibatch();
+    VerifyPackedMinibatch(minibatch, enumerator->AllSequences(), denseDimension);
+
+    // Second buffer of the packer is reused and packed the same way.
+    minibatch = packer->ReadMinibatch();
+    VerifyPackedMinibatch(minibatch, enumerator->AllSequences(), denseDimension);
+}
+
+BOOST_AUTO_TEST_CASE(SequencePackerPackingThroughput)
+{
+    // A wide input: a dense feature stream plus many sparse feature streams.
+    const size_t denseDimension = 512;
+    const size_t numberOfMinibatches = 20;
+    auto enumerator = make_shared<FixedSequenceEnumerator>(1000, 40, denseDimension, 16, 1000000, 50);
+    auto packer = CreateBenchmarkPacker(enumerator, SIZE_MAX);
+
+    // Warm up the buffers.
+    packer->ReadMinibatch();
+
+    size_t bytes = 0;
+    auto start = chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < numberOfMinibatches; ++i)
+    {
+        auto minibatch = packer->ReadMinibatch();
+        BOOST_REQUIRE_EQUAL(minibatch.m_data.size(), 17);
+        for (const auto& stream : minibatch.m_data)
+        {
+            if (stream == minibatch.m_data.front())
+                bytes += stream->m_layout->GetNumCols() * denseDimension * sizeof(float);
+            else
+                bytes += *(const size_t*)stream->m_data * (sizeof(float) + sizeof(IndexType));
+        }
+    }
+    auto end = chrono::high_resolution_clock::now();
+
+    double seconds = chrono::duration<double>(end - start).count();
+    fprintf(stderr, "SequencePacker: packed %d minibatches of %d streams in %.3f ms per minibatch, %.1f MB/s\n",
+        (int)numberOfMinibatches, (int)enumerator->GetStreamDescriptions().size(),
+        seconds * 1000 / numberOfMinibatches, bytes / seconds / (1024 * 1024));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
@@ -0,0 +1,238 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "CNTKLibrary.h"
+#include "Common.h"
+#include <chrono>
+#include <random>
+
+using namespace CNTK;
+
+namespace CNTK { namespace Test {
+
+// A single step of a simple recurrent decoder: h' = tanh(W token + U h + C context), logProbabilities = LogSoftmax(O h').
+struct DecoderStep
+{
+    DecoderStep(size_t vocabularySize, size_t hiddenDim, size_t contextDim, const DeviceDescriptor& device)
+    {
+        unsigned long seed = 1;
+        auto parameter = [&](size_t outputDim, size_t inputDim)
+        {
+            return Parameter(NDArrayView::RandomUniform<float>({ outputDim, inputDim }, -1, 1, seed++, device));
+        };
+
+        token = InputVariable({ vocabularySize }, /*isSparse =*/ true, DataType::Float, L"token", { Axis::DefaultBatchAxis() });
+        state = InputVariable({ hiddenDim }, DataType::Float, L"state", { Axis::DefaultBatchAxis() });
+        context = InputVariable({ contextDim }, DataType::Float, L"context", { Axis::DefaultBatchAxis() });
+
+        auto newState = Tanh(Plus(Plus(Times(parameter(hiddenDim, vocabularySize), token), Times(parameter(hiddenDim, hiddenDim), state)),
+                                  Times(parameter(hiddenDim, contextDim), context)), L"newState");
+        auto logits = Times(parameter(vocabularySize, hiddenDim), newState);
+        auto logProbabilities = Minus(logits, ReduceLogSum(logits, Axis(0)), L"logProbabilities");
+
+        function = Combine({ logProbabilities, newState });
+        logProbabilitiesOutput = logProbabilities->Output();
+        stateOutput = newState->Output();
+    }
+
+    // Evaluates one step for a single hypothesis.
+    void Evaluate(size_t previousToken, std::vector<float>& hiddenState, const std::vector<float>& contextValue, std::vector<float>& logProbabilities, const DeviceDescriptor& device)
+    {
+        std::unordered_map<Variable, ValuePtr> arguments = {
+            { token, Value::CreateBatch<float>(token.Shape().TotalSize(), std::vector<size_t>{ previousToken }, device) },
+            { state, Value::CreateBatch<float>(state.Shape(), hiddenState, device) },
+            { context, Value::CreateBatch<float>(context.Shape(), contextValue, device) }
+        };
+        std::unordered_map<Variable, ValuePtr> outputs = { { logProbabilitiesOutput, nullptr }, { stateOutput, nullptr } };
+        function->Forward(arguments, outputs, device);
+
+        auto copyToVector = [](const ValuePtr& value, std::vector<float>& result)
+        {
+            auto cpuData = value->Data()->DeepClone(DeviceDescriptor::CPUDevice());
+            result.assign(cpuData->DataBuffer<float>(), cpuData->DataBuffer<float>() + cpuData->Shape().TotalSize());
+        };
+        copyToVector(outputs[logProbabilitiesOutput], logProbabilities);
+        copyToVector(outputs[stateOutput], hiddenState);
+    }
+
+    Variable token;
+    Variable state;
+    Variable context;
+    Variable logProbabilitiesOutput;
+    Variable stateOutput;
+    FunctionPtr function;
+};
+
+static std::vector<float> RandomVector(size_t size, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    std::vector<float> result(size);
+    for (auto& v : result)
+        v = distribution(rng);
+    return result;
+}
+
+static std::vector<float> Column(const std::vector<float>& matrix, size_t rows, size_t column)
+{
+    return std::vector<float>(matrix.begin() + column * rows, matrix.begin() + (column + 1) * rows);
+}
+
+void TestBeamSearchMatchesGreedyDecoding(const DeviceDescriptor& device)
+{
+    const size_t vocabularySize = 20, hiddenDim = 16, contextDim = 8, numberOfUtterances = 5, maxLength = 12;
+    const size_t startToken = 0, endToken = 1;
+    DecoderStep step(vocabularySize, hiddenDim, contextDim, device);
+
+    std::mt19937 rng(7);
+    auto initialStates = RandomVector(hiddenDim * numberOfUtterances, rng);
+    auto contexts = RandomVector(contextDim * numberOfUtterances, rng);
+
+    auto decoder = CreateBeamSearchDecoder(step.function, step.token, step.logProbabilitiesOutput, { { step.state, step.stateOutput } },
+                                           startToken, endToken, /*beamWidth =*/ 1, maxLength);
+    auto result = decoder->Decode(numberOfUtterances,
+                                  { { step.state, Value::CreateBatch<float>(step.state.Shape(), initialStates, device) } },
+                                  { { step.context, Value::CreateBatch<float>(step.context.Shape(), contexts, device) } },
+                                  device);
+    BOOST_REQUIRE_EQUAL(result.size(), numberOfUtterances);
+
+    for (size_t u = 0; u < numberOfUtterances; ++u)
+    {
+        auto hiddenState = Column(initialStates, hiddenDim, u);
+        auto context = Column(contexts, contextDim, u);
+        std::vector<float> logProbabilities;
+        std::vector<size_t> tokens;
+        double score = 0;
+        size_t token = startToken;
+        bool isComplete = false;
+        for (size_t t = 0; t < maxLength && !isComplete; ++t)
+        {
+            step.Evaluate(token, hiddenState, context, logProbabilities, device);
+            token = std::max_element(logProbabilities.begin(), logProbabilities.end()) - logProbabilities.begin();
+            score += logProbabilities[token];
+            isComplete = token == endToken;
+            if (!isComplete)
+                tokens.push_back(token);
+        }
+
+        BOOST_REQUIRE_EQUAL(result[u].size(), 1);
+        BOOST_CHECK(result[u][0].m_tokens == tokens);
+        BOOST_CHECK_EQUAL(result[u][0].m_isComplete, isComplete);
+        BOOST_CHECK_CLOSE(result[u][0].m_score, score, 1e-3);
+    }
+}
+
+void TestBeamSearchHypothesisScores(const DeviceDescriptor& device)
+{
+    const size_t vocabularySize = 12, hiddenDim = 10, contextDim = 4, numberOfUtterances = 4, maxLength = 10, beamWidth = 5;
+    const size_t startToken = 0, endToken = 1;
+    DecoderStep step(vocabularySize, hiddenDim, contextDim, device);
+
+    std::mt19937 rng(11);
+    auto contexts = RandomVector(contextDim * numberOfUtterances, rng);
+
+    // The initial state is zero.
+    auto decoder = CreateBeamSearchDecoder(step.function, step.token, step.logProbabilitiesOutput, { { step.state, step.stateOutput } },
+                                           startToken, endToken, beamWidth, maxLength);
+    auto result = decoder->Decode(numberOfUtterances, {}, { { step.context, Value::CreateBatch<float>(step.context.Shape(), contexts, device) } }, device);
+    BOOST_REQUIRE_EQUAL(result.size(), numberOfUtterances);
+
+    // Replaying every hypothesis one token at a time gives its score, which checks that the recurrent state
+    // has followed the hypothesis through all reorderings of the beam.
+    for (size_t u = 0; u < numberOfUtterances; ++u)
+    {
+        BOOST_REQUIRE(!result[u].empty());
+        BOOST_REQUIRE(result[u].size() <= beamWidth);
+        for (size_t i = 0; i < result[u].size(); ++i)
+        {
+            const auto& hypothesis = result[u][i];
+            if (i > 0)
+                BOOST_CHECK(hypothesis.m_score <= result[u][i - 1].m_score);
+
+            auto tokens = hypothesis.m_tokens;
+            if (hypothesis.m_isComplete)
+                tokens.push_back(endToken);
+            else
+                BOOST_CHECK_EQUAL(tokens.size(), maxLength);
+
+            std::vector<float> hiddenState(hiddenDim, 0);
+            auto context = Column(contexts, contextDim, u);
+            std::vector<float> logProbabilities;
+            double score = 0;
+            size_t previousToken = startToken;
+            for (auto token : tokens)
+            {
+                step.Evaluate(previousToken, hiddenState, context, logProbabilities, device);
+                score += logProbabilities[token];
+                previousToken = token;
+            }
+            BOOST_CHECK_CLOSE(hypothesis.m_score, score, 1e-3);
+        }
+    }
+}
+
+void BenchmarkBeamSearch(const DeviceDescriptor& device)
+{
+    const size_t vocabularySize = 2000, hiddenDim = 256, contextDim = 256, numberOfUtterances = 64, maxLength = 30, beamWidth = 8;
+    DecoderStep step(vocabularySize, hiddenDim, contextDim, device);
+
+    std::mt19937 rng(3);
+    auto contexts = RandomVector(contextDim * numberOfUtterances, rng);
+    auto contextValue = Value::CreateBatch<float>(step.context.Shape(), contexts, device);
+
+    auto decoder = CreateBeamSearchDecoder(step.function, step.token, step.logProbabilitiesOutput, { { step.state, step.stateOutput } },
+                                           /*startToken =*/ 0, /*endToken =*/ 1, beamWidth, maxLength);
+
+    // Warm up.
+    decoder->Decode(1, {}, { { step.context, Value::CreateBatch<float>(step.context.Shape(), Column(contexts, contextDim, 0), device) } }, device);
+
+    auto tokensBefore = decoder->TotalNumberOfEvaluatedTokens();
+    auto stepsBefore = decoder->TotalNumberOfSteps();
+    auto start = std::chrono::high_resolution_clock::now();
+    auto result = decoder->Decode(numberOfUtterances, {}, { { step.context, contextValue } }, device);
+    auto end = std::chrono::high_resolution_clock::now();
+    BOOST_REQUIRE_EQUAL(result.size(), numberOfUtterances);
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    size_t tokens = decoder->TotalNumberOfEvaluatedTokens() - tokensBefore;
+    fprintf(stderr, "BeamSearchDecoder on %S: %d utterances, beam %d, vocabulary %d: %d steps, %d tokens in %.3f s, %.1f tokens/second\n",
+            device.AsString().c_str(), (int)numberOfUtterances, (int)beamWidth, (int)vocabularySize,
+            (int)(decoder->TotalNumberOfSteps() - stepsBefore), (int)tokens, seconds, tokens / seconds);
+}
+
+BOOST_AUTO_TEST_SUITE(BeamSearchSuite)
+
+BOOST_AUTO_TEST_CASE(BeamSearchGreedyInCPU)
+{
+    if (ShouldRunOnCpu())
+        TestBeamSearchMatchesGreedyDecoding(DeviceDescriptor::CPUDevice());
+}
+
+BOOST_AUTO_TEST_CASE(BeamSearchGreedyInGPU)
+{
+    if (ShouldRunOnGpu())
+        TestBeamSearchMatchesGreedyDecoding(DeviceDescriptor::GPUDevice(0));
+}
+
+BOOST_AUTO_TEST_CASE(BeamSearchHypothesisScoresInCPU)
+{
+    if (ShouldRunOnCpu())
+        TestBeamSearchHypothesisScores(DeviceDescriptor::CPUDevice());
+}
+
+BOOST_AUTO_TEST_CASE(BeamSearchHypothesisScoresInGPU)
+{
+    if (ShouldRunOnGpu())
+        TestBeamSearchHypothesisScores(DeviceDescriptor::GPUDevice(0));
+}
+
+BOOST_AUTO_TEST_CASE(BeamSearchThroughputInCPU)
+{
+    if (ShouldRunOnCpu())
+        BenchmarkBeamSearch(DeviceDescriptor::CPUDevice());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}
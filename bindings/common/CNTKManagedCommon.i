@@ -290,6 +290,9 @@ IGNORE_CLASS CNTK::Trainer;
 IGNORE_FUNCTION CNTK::CreateTrainer;
 IGNORE_CLASS CNTK::Evaluator;
 IGNORE_FUNCTION CNTK::CreateEvaluator;
+IGNORE_STRUCT CNTK::BeamSearchHypothesis;
+IGNORE_CLASS CNTK::BeamSearchDecoder;
+IGNORE_FUNCTION CNTK::CreateBeamSearchDecoder;
 IGNORE_STRUCT CNTK::StreamInformation;
 IGNORE_STRUCT std::hash<::CNTK::StreamInformation>;
 %ignore operator==(const StreamInformation& left, const StreamInformation& right);
@@ -309,6 +312,7 @@ IGNORE_STRUCT CNTK::DistributedWorkerDescriptor;
 IGNORE_CLASS CNTK::DistributedCommunicator;
 IGNORE_CLASS CNTK::QuantizedDistributedCommunicator;
 IGNORE_FUNCTION CNTK::MPICommunicator;
+IGNORE_FUNCTION CNTK::HierarchicalMPICommunicator;
 IGNORE_FUNCTION CNTK::QuantizedMPICommunicator;
 IGNORE_STRUCT CNTK::CrossValidationConfig;
 IGNORE_STRUCT CNTK::CheckpointConfig;
@@ -371,6 +375,8 @@ IGNORE_FUNCTION CNTK::Internal::EnableForwardValuesSharing;
 IGNORE_FUNCTION CNTK::Internal::DisableForwardValuesSharing;
 IGNORE_FUNCTION CNTK::Internal::EnableGradientAccumulationOptimization;
 IGNORE_FUNCTION CNTK::Internal::DisableGradientAccumulationOptimization;
+IGNORE_FUNCTION CNTK::Internal::EnableRecurrentLoopPipelining;
+IGNORE_FUNCTION CNTK::Internal::DisableRecurrentLoopPipelining;
 %ignore CNTK::Internal::DefaultProfilerBufferSize;
 IGNORE_FUNCTION CNTK::Internal::StartProfiler;
 IGNORE_FUNCTION CNTK::Internal::StopProfiler;
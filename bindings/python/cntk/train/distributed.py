@@ -120,7 +120,7 @@ class DistributedLearner(cntk_py.DistributedLearner):
         return super(DistributedLearner, self).total_number_of_samples_seen()
 
 @typemap
-def data_parallel_distributed_learner(learner, distributed_after=0, num_quantization_bits=32, use_async_buffered_parameter_update=False):
+def data_parallel_distributed_learner(learner, distributed_after=0, num_quantization_bits=32, use_async_buffered_parameter_update=False, use_hierarchical_allreduce=False):
     '''
     Creates a data parallel distributed learner
 
@@ -129,6 +129,8 @@ def data_parallel_distributed_learner(learner, distributed_after=0, num_quantiza
         distributed_after (int): number of samples after which distributed training starts
         num_quantization_bits (int): number of bits for quantization (1 to 32)
         use_async_buffered_parameter_update (bool): use async buffered parameter update
+        use_hierarchical_allreduce (bool): aggregate through shared memory among
+         the workers on the same host (non-quantized aggregation only)
     Returns:
         a distributed learner instance
     '''
@@ -140,7 +142,7 @@ def data_parallel_distributed_learner(learner, distributed_after=0, num_quantiza
             use_async_buffered_parameter_update)
     else:
         return cntk_py.create_data_parallel_distributed_learner(
-            cntk_py.mpicommunicator(),
+            cntk_py.hierarchical_mpicommunicator() if use_hierarchical_allreduce else cntk_py.mpicommunicator(),
             learner,
             distributed_after,
             use_async_buffered_parameter_update)
@@ -202,3 +204,12 @@ def mpi_communicator():
     Creates a non quantized MPI communicator.
     '''
     return cntk_py.mpicommunicator()
+
+@typemap
+def hierarchical_mpi_communicator():
+    '''
+    Creates a non quantized MPI communicator that aggregates through shared
+    memory among the workers on the same host, and through MPI only among one
+    worker per host.
+    '''
+    return cntk_py.hierarchical_mpicommunicator()